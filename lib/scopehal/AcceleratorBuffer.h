@@ -37,6 +37,7 @@
 
 #include "AlignedAllocator.h"
 #include "QueueManager.h"
+#include "TraceRecorder.h"
 
 #ifdef _WIN32
 #undef MemoryBarrier
@@ -295,6 +296,9 @@ protected:
 	///@brief Size of the memory actually being used
 	size_t m_size;
 
+	///@brief Number of items removed by pop_front() which are still at the start of the CPU-side buffer
+	size_t m_start;
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Hint configuration
 public:
@@ -332,6 +336,7 @@ public:
 		#endif
 		, m_capacity(0)
 		, m_size(0)
+		, m_start(0)
 		, m_cpuAccessHint(HINT_LIKELY)	//default access hint: CPU-side pinned memory
 		, m_gpuAccessHint(HINT_UNLIKELY)
 		, m_name(name)
@@ -428,6 +433,8 @@ public:
 	 */
 	vk::Buffer GetBuffer()
 	{
+		Compact();
+
 		if(m_gpuBuffer != nullptr)
 			return **m_gpuBuffer;
 		else
@@ -438,7 +445,7 @@ public:
 		@brief Gets a pointer to the CPU-side buffer
 	 */
 	T* GetCpuPointer()
-	{ return m_cpuPtr; }
+	{ return m_cpuPtr + m_start; }
 
 	/**
 		@brief Returns a vk::DescriptorBufferInfo suitable for binding this object to
@@ -456,20 +463,23 @@ public:
 	 */
 	void resize(size_t size)
 	{
-		//Need to grow?
-		if(size > m_capacity)
+		//Need to grow? Space left at the start by pop_front() isn't available until the buffer is reallocated.
+		size_t needed = m_start + size;
+		if(needed > m_capacity)
 		{
 			//Default to doubling in size each time to avoid excessive copying.
 			if(m_capacity == 0)
-				reserve(size);
-			else if(size > m_capacity*2)
-				reserve(size);
+				reserve(needed);
+			else if(needed > m_capacity*2)
+				reserve(needed);
 			else
 				reserve(m_capacity * 2);
 		}
 
 		//Update our size
 		m_size = size;
+		if(m_size == 0)
+			m_start = 0;
 	}
 
 	/**
@@ -505,6 +515,9 @@ public:
 		//Copy placement hints from the other instance, then resize to match
 		SetCpuAccessHint(rhs.m_cpuAccessHint);
 		SetGpuAccessHint(rhs.m_gpuAccessHint, true);
+
+		//Our old content is about to be overwritten, so there's no need to move it down first
+		m_start = 0;
 		resize(rhs.m_size);
 
 		//Valid data CPU side? Copy it to here
@@ -514,12 +527,12 @@ public:
 			if(!std::is_trivially_copyable<T>::value)
 			{
 				for(size_t i=0; i<m_size; i++)
-					m_cpuPtr[i] = rhs.m_cpuPtr[i];
+					m_cpuPtr[i] = rhs.m_cpuPtr[rhs.m_start + i];
 			}
 
 			//Trivially copyable types can be done more efficiently in a block
 			else
-				memcpy(m_cpuPtr, rhs.m_cpuPtr, m_size * sizeof(T));
+				memcpy(m_cpuPtr, rhs.m_cpuPtr + rhs.m_start, m_size * sizeof(T));
 		}
 		m_cpuPhysMemIsStale = rhs.m_cpuPhysMemIsStale;
 
@@ -597,7 +610,7 @@ protected:
 					if(!std::is_trivially_copyable<T>::value)
 					{
 						for(size_t i=0; i<m_size; i++)
-							m_cpuPtr[i] = std::move(pOld[i]);
+							m_cpuPtr[i] = std::move(pOld[m_start + i]);
 					}
 
 					//Trivially copyable types can be done more efficiently in a block
@@ -608,12 +621,15 @@ protected:
 						#pragma GCC diagnostic push
 						#pragma GCC diagnostic ignored "-Wclass-memaccess"
 
-						memcpy(m_cpuPtr, pOld, m_size * sizeof(T));
+						memcpy(m_cpuPtr, pOld + m_start, m_size * sizeof(T));
 
 						#pragma GCC diagnostic pop
 					}
 				}
 
+				//Anything skipped by pop_front() was left behind in the old buffer
+				m_start = 0;
+
 				//If CPU-side data is stale, just allocate the new buffer but leave it as stale
 				//(don't do a potentially unnecessary copy from the GPU)
 
@@ -741,10 +757,10 @@ protected:
 public:
 
 	const T& operator[](size_t i) const
-	{ return m_cpuPtr[i]; }
+	{ return m_cpuPtr[m_start + i]; }
 
 	T& operator[](size_t i)
-	{ return m_cpuPtr[i]; }
+	{ return m_cpuPtr[m_start + i]; }
 
 	/**
 		@brief Adds a new element to the end of the container, allocating space if needed
@@ -753,7 +769,7 @@ public:
 	{
 		size_t cursize = m_size;
 		resize(m_size + 1);
-		m_cpuPtr[cursize] = value;
+		m_cpuPtr[m_start + cursize] = value;
 
 		MarkModifiedFromCpu();
 	}
@@ -778,55 +794,80 @@ public:
 		resize(m_size + 1);
 
 		PrepareForCpuAccess();
+		auto p = GetCpuPointer();
 
 		//non-trivially-copyable types have to be copied one at a time
 		if(!std::is_trivially_copyable<T>::value)
 		{
-			for(size_t i=0; i<cursize; i++)
-				m_cpuPtr[i+1] = std::move(m_cpuPtr[i]);
+			for(size_t i=cursize; i>0; i--)
+				p[i] = std::move(p[i-1]);
 		}
 
 		//Trivially copyable types can be done more efficiently in a block
 		else
-			memmove(m_cpuPtr+1, m_cpuPtr, sizeof(T) * (cursize));
+			memmove(p+1, p, sizeof(T) * (cursize));
 
 		//Insert the new first element
-		m_cpuPtr[0] = value;
+		p[0] = value;
 
 		MarkModifiedFromCpu();
 	}
 
 	/**
-		@brief Removes the first item in the container
+		@brief Removes the first item(s) in the container
+
+		Nothing is moved right away: the removed items are skipped over, and the remaining items are only moved down to
+		the start of the buffer once the skipped space is as large as the items left, or the buffer is needed on the GPU.
+		This keeps the cost of removing items from the front of a large buffer (e.g. a fixed depth history, which drops
+		one item every time it gains one) constant on average.
 
 		TODO: GPU implementation of this?
+
+		@param n	Number of items to remove
 	 */
-	void pop_front()
+	void pop_front(size_t n = 1)
 	{
-		//No need to move data if popping last element
-		if(m_size == 1)
+		//No need to move data if popping everything
+		if(n >= m_size)
 		{
 			clear();
 			return;
 		}
+		if(n == 0)
+			return;
 
 		//Don't touch GPU side buffer
 
 		PrepareForCpuAccess();
 
+		m_start += n;
+		m_size -= n;
+		if(m_start >= m_size)
+			Compact();
+
+		MarkModifiedFromCpu();
+	}
+
+	/**
+		@brief Moves the content down to the start of the buffer, reclaiming the space skipped over by pop_front()
+	 */
+	void Compact()
+	{
+		if(m_start == 0)
+			return;
+
 		//non-trivially-copyable types have to be copied one at a time
 		if(!std::is_trivially_copyable<T>::value)
 		{
-			for(size_t i=0; i<m_size-1; i++)
-				m_cpuPtr[i] = std::move(m_cpuPtr[i+1]);
+			for(size_t i=0; i<m_size; i++)
+				m_cpuPtr[i] = std::move(m_cpuPtr[m_start + i]);
 		}
 
 		//Trivially copyable types can be done more efficiently in a block
 		else
-			memmove(m_cpuPtr, m_cpuPtr+1, sizeof(T) * (m_size-1));
-
-		resize(m_size - 1);
+			memmove(m_cpuPtr, m_cpuPtr + m_start, sizeof(T) * m_size);
 
+		m_start = 0;
 		MarkModifiedFromCpu();
 	}
 
@@ -930,6 +971,9 @@ public:
 	 */
 	void PrepareForGpuAccess(bool outputOnly = false)
 	{
+		//The GPU always sees the content starting at the beginning of the buffer
+		Compact();
+
 		//Early out if no content or if unified memory
 		if(m_size == 0 || g_vulkanDeviceHasUnifiedMemory)
 			return;
@@ -960,6 +1004,9 @@ public:
 	 */
 	void PrepareForGpuAccessNonblocking(bool outputOnly, vk::raii::CommandBuffer& cmdBuf)
 	{
+		//The GPU always sees the content starting at the beginning of the buffer
+		Compact();
+
 		//Early out if no content or if unified memory
 		if(m_size == 0 || g_vulkanDeviceHasUnifiedMemory)
 			return;
@@ -992,6 +1039,8 @@ protected:
 	{
 		assert(std::is_trivially_copyable<T>::value);
 
+		TraceSpan span("CopyToCpu", "transfer");
+
 		std::lock_guard<std::mutex> lock(g_vkTransferMutex);
 
 		//Make the transfer request
@@ -1013,6 +1062,8 @@ protected:
 	{
 		assert(std::is_trivially_copyable<T>::value);
 
+		TraceSpan span("CopyToGpu", "transfer");
+
 		std::lock_guard<std::mutex> lock(g_vkTransferMutex);
 
 		//Make the transfer request
@@ -1089,7 +1140,10 @@ protected:
 		//We have a buffer on the GPU.
 		//If it's stale, need to push our updated content there before freeing the CPU-side copy
 		if( (m_gpuMemoryType != MEM_TYPE_NULL) && m_gpuPhysMemIsStale && !empty())
+		{
+			Compact();
 			CopyToGpu();
+		}
 
 		//Free the Vulkan buffer object
 		m_cpuBuffer = nullptr;
@@ -1099,6 +1153,7 @@ protected:
 
 		//Mark CPU-side buffer as empty
 		m_cpuPtr = nullptr;
+		m_start = 0;
 		m_cpuPhysMem = nullptr;
 		m_cpuMemoryType = MEM_TYPE_NULL;
 		m_buffersAreSame = false;
@@ -0,0 +1,291 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Software implementation of the waveform rendering shader
+
+	This is a line-for-line port of waveform-compute.glsl and must produce the same output. Any change to the shader
+	needs to be mirrored here.
+ */
+#include "scopehal.h"
+
+using namespace std;
+
+//Must match the constants in waveform-compute.glsl
+#define MAX_HEIGHT		2048
+#define ROWS_PER_BLOCK	128
+
+/**
+	@brief Rasterizes every pixel column of one waveform
+
+	@tparam S				Sample type (float for analog, bool for digital)
+	@tparam dense			True for uniform waveforms, false for sparse
+	@tparam digital			True for digital waveforms
+	@tparam interpolate		True to linearly interpolate analog signals (false in zero-hold and histogram mode)
+	@tparam histogram		True to draw filled bars from the Y axis offset to each sample
+ */
+template<class S, bool dense, bool digital, bool interpolate, bool histogram>
+static void RasterizeColumns(
+	const ConfigPushConstants& config,
+	const S* samples,
+	const int64_t* xpos,
+	const int64_t* durations,
+	const uint32_t* xind,
+	float* outval)
+{
+	//Analog zero-hold rendering is the only mode which draws each sample out to its duration
+	//rather than connecting it to the next one
+	const bool useNextCoords = interpolate || histogram || digital;
+	const uint32_t addtlNeededSamples = useNextCoords ? 1 : 0;
+
+	uint32_t windowWidth = config.windowWidth;
+	uint32_t windowHeight = config.windowHeight;
+	uint32_t memDepth = config.memDepth;
+	if(windowHeight > MAX_HEIGHT)
+		return;
+	if(memDepth < (1 + addtlNeededSamples))
+		return;
+
+	auto FetchX = [&](uint32_t i)
+	{
+		if constexpr(dense)
+			return float(int64_t(i) + config.innerXoff);
+		else
+			return float(xpos[i] + config.innerXoff);
+	};
+
+	auto FetchY = [&](uint32_t i)
+	{
+		return (float(samples[i]) + config.yoff)*config.yscale + config.ybase;
+	};
+
+	#pragma omp parallel
+	{
+		//Per-thread equivalent of the shader's shared working buffer
+		vector<uint32_t> workingBuffer(windowHeight);
+
+		#pragma omp for schedule(dynamic, 16)
+		for(uint32_t x=0; x<windowWidth; x++)
+		{
+			memset(&workingBuffer[0], 0, windowHeight * sizeof(uint32_t));
+			float fx = x;
+
+			bool done = false;
+			uint32_t istart;
+			if constexpr(dense)
+			{
+				istart = uint32_t(floor(fx / config.xscale)) + config.offset_samples;
+				uint32_t iend = uint32_t(floor((fx + 1) / config.xscale)) + config.offset_samples;
+				if(iend == 0)
+					done = true;
+			}
+			else
+			{
+				istart = xind[x];
+				if( (x + 1) < windowWidth)
+				{
+					uint32_t iend = xind[x + 1];
+					if(iend == 0)
+						done = true;
+				}
+			}
+
+			//The shader processes ROWS_PER_BLOCK samples in lockstep and only checks for completion between blocks.
+			//Do the same so that we touch exactly the same set of samples.
+			for(uint32_t blockStart = istart; ; blockStart += ROWS_PER_BLOCK)
+			{
+				for(uint32_t row=0; row<ROWS_PER_BLOCK; row++)
+				{
+					uint32_t i = blockStart + row;
+					if(i >= (memDepth - addtlNeededSamples))
+					{
+						done = true;
+						continue;
+					}
+
+					//Fetch coordinates
+					float leftx = FetchX(i) * config.xscale + config.xoff;
+					float lefty = FetchY(i);
+					float rightx;
+					float righty;
+					if(useNextCoords)
+					{
+						rightx = FetchX(i+1) * config.xscale + config.xoff;
+						righty = FetchY(i+1);
+					}
+					else
+					{
+						rightx = leftx + (dense ? 1.0f : float(durations[i])) * config.xscale;
+						righty = lefty;
+					}
+
+					//Check if we're at the end of the pixel
+					if(rightx > fx + 1)
+						done = true;
+
+					//Skip offscreen samples
+					if( (rightx < fx) || (leftx > fx + 1) )
+						continue;
+
+					//To start, assume we're drawing the entire segment
+					float starty = lefty;
+					float endy = righty;
+
+					//Interpolate analog signals if either end is outside our column
+					if constexpr(interpolate && !digital)
+					{
+						float slope = (righty - lefty) / (rightx - leftx);
+						if(leftx < fx)
+							starty = lefty + (fx - leftx) * slope;
+						if(rightx > fx + 1)
+							endy = lefty + (fx + 1 - leftx) * slope;
+					}
+
+					//Digital: draw a vertical line if we are very near the right edge, otherwise a single pixel
+					if constexpr(digital)
+					{
+						starty = lefty;
+						if(fabs(rightx - fx) <= 1)
+							endy = righty;
+						else
+							endy = lefty;
+					}
+
+					if constexpr(histogram)
+					{
+						//Don't draw zero-height histogram bars
+						if(samples[i] <= 0)
+							continue;
+
+						starty = config.yoff*config.yscale + config.ybase;
+						endy = lefty;
+					}
+
+					//If start and end are both off screen, nothing to draw
+					if( ( (starty < 0) && (endy < 0) ) ||
+						( (starty >= windowHeight) && (endy >= windowHeight) ) )
+					{
+						continue;
+					}
+
+					//Something is visible. Clip to window size in case anything is partially offscreen
+					starty = max(min(starty, float(windowHeight - 1)), 0.0f);
+					endy = max(min(endy, float(windowHeight - 1)), 0.0f);
+					int blockmin = int(min(starty, endy));
+					int blockmax = int(max(starty, endy));
+
+					//Integrate intensity graded output
+					uint32_t* p = &workingBuffer[0];
+					if constexpr(histogram)
+					{
+						for(int y=blockmin; y<=blockmax; y++)
+							p[y] = 1;
+					}
+					else
+					{
+						for(int y=blockmin; y<=blockmax; y++)
+							p[y] ++;
+					}
+				}
+
+				if(done)
+					break;
+			}
+
+			//Copy working buffer to float[] output and apply persistence if needed
+			for(uint32_t y=0; y<windowHeight; y++)
+			{
+				float fout = workingBuffer[y] * config.alpha;
+				size_t npix = (size_t(windowWidth) * y) + x;
+
+				if(config.persistScale != 0)
+					fout += outval[npix] * config.persistScale;
+
+				outval[npix] = fout;
+			}
+		}
+	}
+}
+
+/**
+	@brief Rasterizes an analog or digital waveform on the CPU, producing the same output as waveform-compute.glsl
+
+	@param config		Rendering configuration (same as the shader push constants)
+	@param data			The waveform to draw. Must be a uniform or sparse analog or digital waveform.
+	@param xind			Index of the first sample in each pixel column (sparse waveforms only)
+	@param histogram	True to draw as a filled histogram (uniform analog waveforms only)
+	@param zeroHold		True to draw analog samples as horizontal steps rather than interpolating
+	@param outval		Output buffer, windowWidth * windowHeight pixels
+ */
+void RasterizeWaveformCPU(
+	const ConfigPushConstants& config,
+	WaveformBase* data,
+	const uint32_t* xind,
+	bool histogram,
+	bool zeroHold,
+	float* outval)
+{
+	auto uadata = dynamic_cast<UniformAnalogWaveform*>(data);
+	auto sadata = dynamic_cast<SparseAnalogWaveform*>(data);
+	auto uddata = dynamic_cast<UniformDigitalWaveform*>(data);
+	auto sddata = dynamic_cast<SparseDigitalWaveform*>(data);
+
+	if(uadata)
+	{
+		auto p = uadata->m_samples.GetCpuPointer();
+		if(histogram)
+			RasterizeColumns<float, true, false, false, true>(config, p, nullptr, nullptr, nullptr, outval);
+		else if(zeroHold)
+			RasterizeColumns<float, true, false, false, false>(config, p, nullptr, nullptr, nullptr, outval);
+		else
+			RasterizeColumns<float, true, false, true, false>(config, p, nullptr, nullptr, nullptr, outval);
+	}
+	else if(sadata)
+	{
+		auto p = sadata->m_samples.GetCpuPointer();
+		auto poff = sadata->m_offsets.GetCpuPointer();
+		auto pdur = sadata->m_durations.GetCpuPointer();
+		if(zeroHold)
+			RasterizeColumns<float, false, false, false, false>(config, p, poff, pdur, xind, outval);
+		else
+			RasterizeColumns<float, false, false, true, false>(config, p, poff, pdur, xind, outval);
+	}
+	else if(uddata)
+	{
+		RasterizeColumns<bool, true, true, false, false>(
+			config, uddata->m_samples.GetCpuPointer(), nullptr, nullptr, nullptr, outval);
+	}
+	else if(sddata)
+	{
+		RasterizeColumns<bool, false, true, false, false>(
+			config, sddata->m_samples.GetCpuPointer(), sddata->m_offsets.GetCpuPointer(), nullptr, xind, outval);
+	}
+}
@@ -195,20 +195,32 @@ Oscilloscope::TriggerMode DemoOscilloscope::PollTrigger()
 
 void DemoOscilloscope::StartSingleTrigger()
 {
-	m_triggerArmed = true;
-	m_triggerOneShot = true;
+	{
+		lock_guard<mutex> lock(m_triggerWaitMutex);
+		m_triggerArmed = true;
+		m_triggerOneShot = true;
+	}
+	m_triggerWaitCond.notify_all();
 }
 
 void DemoOscilloscope::Start()
 {
-	m_triggerArmed = true;
-	m_triggerOneShot = false;
+	{
+		lock_guard<mutex> lock(m_triggerWaitMutex);
+		m_triggerArmed = true;
+		m_triggerOneShot = false;
+	}
+	m_triggerWaitCond.notify_all();
 }
 
 void DemoOscilloscope::Stop()
 {
-	m_triggerArmed = false;
-	m_triggerOneShot = false;
+	{
+		lock_guard<mutex> lock(m_triggerWaitMutex);
+		m_triggerArmed = false;
+		m_triggerOneShot = false;
+	}
+	m_triggerWaitCond.notify_all();
 }
 
 void DemoOscilloscope::ForceTrigger()
@@ -221,6 +233,20 @@ bool DemoOscilloscope::IsTriggerArmed()
 	return m_triggerArmed;
 }
 
+bool DemoOscilloscope::IsTriggerActivityWaitSupported()
+{
+	return true;
+}
+
+/**
+	@brief Synthetic waveforms are available immediately whenever the trigger is armed, so only block while disarmed
+ */
+bool DemoOscilloscope::WaitForTriggerActivity(std::chrono::microseconds timeout)
+{
+	unique_lock<mutex> lock(m_triggerWaitMutex);
+	return m_triggerWaitCond.wait_for(lock, timeout, [&]{ return m_triggerArmed.load(); });
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Serialization
 
@@ -617,7 +643,13 @@ bool DemoOscilloscope::AcquireData()
 	m_pendingWaveformsMutex.unlock();
 
 	if(m_triggerOneShot)
-		m_triggerArmed = false;
+	{
+		{
+			lock_guard<mutex> lock(m_triggerWaitMutex);
+			m_triggerArmed = false;
+		}
+		m_triggerWaitCond.notify_all();
+	}
 
 	// Tell the download monitor that waveform download has finished
 	ChannelsDownloadFinished();
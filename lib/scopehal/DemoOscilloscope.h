@@ -39,6 +39,8 @@
 
 #include "TestWaveformSource.h"
 #include <random>
+#include <atomic>
+#include <condition_variable>
 
 /**
 	@brief Simulated oscilloscope for demonstrations and testing
@@ -91,6 +93,8 @@ public:
 	virtual void Stop() override;
 	virtual void ForceTrigger() override;
 	virtual bool IsTriggerArmed() override;
+	virtual bool IsTriggerActivityWaitSupported() override;
+	virtual bool WaitForTriggerActivity(std::chrono::microseconds timeout) override;
 	virtual void PushTrigger() override;
 	virtual void PullTrigger() override;
 
@@ -158,11 +162,22 @@ protected:
 		CHANNEL_MODE_NOISE_LPF
 	};
 
-	///@brief True if trigger is armed
-	bool m_triggerArmed;
+	/**
+		@brief True if trigger is armed
+
+		Only written with m_triggerWaitMutex held, so WaitForTriggerActivity() can't miss a change, but atomic so
+		PollTrigger() and friends can read it without locking.
+	 */
+	std::atomic<bool> m_triggerArmed;
+
+	///@brief True if most recent trigger arm was a single-shot trigger (same locking rules as m_triggerArmed)
+	std::atomic<bool> m_triggerOneShot;
+
+	///@brief Mutex for writes to m_triggerArmed and m_triggerOneShot
+	std::mutex m_triggerWaitMutex;
 
-	///@brief True if most recent trigger arm was a single-shot trigger
-	bool m_triggerOneShot;
+	///@brief Signaled when the trigger is armed
+	std::condition_variable m_triggerWaitCond;
 
 	///@brief Current frequency within the sweep for channel 2
 	float m_sweepFreq;
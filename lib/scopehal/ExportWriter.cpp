@@ -0,0 +1,342 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of ExportWriter
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "ExportWriter.h"
+#include <charconv>
+
+using namespace std;
+
+///@brief Protects g_exportWriters
+static mutex g_exportWritersMutex;
+
+///@brief All writers which currently have a file open
+static set<ExportWriter*> g_exportWriters;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+ExportWriter::ExportWriter()
+	: m_fp(nullptr)
+	, m_size(0)
+	, m_failed(false)
+	, m_busy(false)
+	, m_terminating(false)
+{
+}
+
+ExportWriter::~ExportWriter()
+{
+	Close();
+}
+
+/**
+	@brief Closes every open writer, making sure all pending data reaches the disk
+
+	Called during library cleanup, since export filters are not always destroyed before the application exits.
+ */
+void ExportWriter::CloseAll()
+{
+	set<ExportWriter*> writers;
+	{
+		lock_guard<mutex> lock(g_exportWritersMutex);
+		writers = g_exportWriters;
+	}
+
+	for(auto w : writers)
+		w->Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// File management
+
+/**
+	@brief Opens a file and starts the writer thread
+
+	Any file which was already open is closed first.
+
+	@param path		Path to the file
+	@param append	True to append to an existing file, false to truncate it
+
+	@return True on success, false if the file could not be opened
+ */
+bool ExportWriter::Open(const string& path, bool append)
+{
+	Close();
+
+	m_fp = fopen(path.c_str(), append ? "ab" : "wb");
+	if(!m_fp)
+	{
+		LogError("Failed to open file %s for writing\n", path.c_str());
+		return false;
+	}
+
+	fseek(m_fp, 0, SEEK_END);
+	m_size = ftell(m_fp);
+	m_path = path;
+	m_failed = false;
+	m_terminating = false;
+	m_thread = thread(&ExportWriter::WriterThread, this);
+
+	lock_guard<mutex> lock(g_exportWritersMutex);
+	g_exportWriters.emplace(this);
+	return true;
+}
+
+/**
+	@brief Writes all pending data, stops the writer thread, and closes the file
+
+	@return True if all data written since the file was opened made it to the disk
+ */
+bool ExportWriter::Close()
+{
+	if(!m_fp)
+		return true;
+
+	{
+		lock_guard<mutex> lock(g_exportWritersMutex);
+		g_exportWriters.erase(this);
+	}
+
+	Submit();
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_terminating = true;
+	}
+	m_writeCvar.notify_all();
+	m_thread.join();
+
+	if(fclose(m_fp) != 0)
+		m_failed = true;
+	m_fp = nullptr;
+
+	return !m_failed;
+}
+
+/**
+	@brief Blocks until all data written so far has been handed to the OS
+
+	@return True if all data written since the file was opened made it to the disk
+ */
+bool ExportWriter::Flush()
+{
+	if(!m_fp)
+		return !m_failed;
+
+	Submit();
+
+	unique_lock<mutex> lock(m_mutex);
+	m_doneCvar.wait(lock, [this]{ return m_queue.empty() && !m_busy; });
+	if(fflush(m_fp) != 0)
+		m_failed = true;
+
+	return !m_failed;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Producer side
+
+/**
+	@brief Appends data to the file
+
+	Only blocks if the writer thread has fallen too far behind.
+ */
+void ExportWriter::Write(const void* data, size_t len)
+{
+	auto p = static_cast<const uint8_t*>(data);
+	m_size += len;
+
+	while(len > 0)
+	{
+		if(!m_current)
+			m_current = GetFreeBuffer();
+
+		size_t chunk = min(len, BUFFER_SIZE - m_current->size());
+		m_current->insert(m_current->end(), p, p + chunk);
+		p += chunk;
+		len -= chunk;
+
+		if(m_current->size() == BUFFER_SIZE)
+			Submit();
+	}
+}
+
+/**
+	@brief Hands the partially filled current buffer to the writer thread without waiting for it to be written
+
+	Export filters call this at the end of each export so the data shows up in the file promptly.
+ */
+void ExportWriter::Submit()
+{
+	if(!m_current || m_current->empty())
+		return;
+
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_doneCvar.wait(lock, [this]{ return m_queue.size() < MAX_QUEUED_BUFFERS; });
+		m_queue.push_back(std::move(m_current));
+	}
+	m_writeCvar.notify_one();
+}
+
+/**
+	@brief Gets an empty buffer, reusing one which has already been written if possible
+ */
+unique_ptr<ExportWriter::Buffer> ExportWriter::GetFreeBuffer()
+{
+	unique_ptr<Buffer> ret;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if(!m_freeBuffers.empty())
+		{
+			ret = std::move(m_freeBuffers.back());
+			m_freeBuffers.pop_back();
+		}
+	}
+
+	if(!ret)
+	{
+		ret = make_unique<Buffer>();
+		ret->reserve(BUFFER_SIZE);
+	}
+	ret->clear();
+	return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Writer thread
+
+void ExportWriter::WriterThread()
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "ExportWriter");
+	#endif
+	TraceRecorder::SetThreadName("ExportWriter");
+
+	while(true)
+	{
+		unique_ptr<Buffer> buf;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_writeCvar.wait(lock, [this]{ return m_terminating || !m_queue.empty(); });
+			if(m_queue.empty())
+				return;
+
+			buf = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_busy = true;
+		}
+
+		{
+			TraceSpan span("ExportWrite", "export");
+
+			bool ok = (fwrite(buf->data(), 1, buf->size(), m_fp) == buf->size());
+
+			//Push data to the OS once we've caught up, so the file is up to date while idle
+			bool idle;
+			{
+				lock_guard<mutex> lock(m_mutex);
+				idle = m_queue.empty();
+			}
+			if(ok && idle)
+				ok = (fflush(m_fp) == 0);
+
+			if(!ok && !m_failed.exchange(true))
+				LogError("Failed to write to file %s\n", m_path.c_str());
+		}
+
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_busy = false;
+			if(m_freeBuffers.size() <= MAX_QUEUED_BUFFERS)
+				m_freeBuffers.push_back(std::move(buf));
+		}
+		m_doneCvar.notify_all();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Number formatting
+
+/**
+	@brief Appends a floating point value in fixed point notation, equivalent to printf("%.*f", precision, value)
+ */
+void ExportWriter::AppendFixed(string& str, double value, int precision)
+{
+	//Worst case is DBL_MAX: 309 integer digits plus sign, decimal point, and fraction
+	char tmp[512];
+#ifdef __cpp_lib_to_chars
+	auto result = to_chars(tmp, tmp + sizeof(tmp), value, chars_format::fixed, precision);
+	if(result.ec == errc())
+	{
+		str.append(tmp, result.ptr);
+		return;
+	}
+#endif
+
+	//Fall back to stdio if the standard library doesn't support floating point to_chars, or we ran out of space
+	int len = snprintf(tmp, sizeof(tmp), "%.*f", precision, value);
+	str.append(tmp, min<size_t>(max(len, 0), sizeof(tmp) - 1));
+}
+
+/**
+	@brief Appends a floating point value in scientific notation, equivalent to printf("%.*e", precision, value)
+ */
+void ExportWriter::AppendScientific(string& str, double value, int precision)
+{
+	char tmp[512];
+#ifdef __cpp_lib_to_chars
+	auto result = to_chars(tmp, tmp + sizeof(tmp), value, chars_format::scientific, precision);
+	if(result.ec == errc())
+	{
+		str.append(tmp, result.ptr);
+		return;
+	}
+#endif
+
+	int len = snprintf(tmp, sizeof(tmp), "%.*e", precision, value);
+	str.append(tmp, min<size_t>(max(len, 0), sizeof(tmp) - 1));
+}
+
+/**
+	@brief Appends an integer in decimal
+ */
+void ExportWriter::AppendInteger(string& str, int64_t value)
+{
+	char tmp[24];
+	auto result = to_chars(tmp, tmp + sizeof(tmp), value);
+	str.append(tmp, result.ptr);
+}
@@ -0,0 +1,172 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of ExportWriter
+	@ingroup core
+ */
+
+#ifndef ExportWriter_h
+#define ExportWriter_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AlignedAllocator.h"
+
+/**
+	@brief Buffered file writer which does the actual file I/O on a background thread
+
+	Data is accumulated into large, page aligned buffers. Full buffers are handed off to a dedicated writer thread, so
+	the caller (typically an export filter running in the filter graph) only blocks on disk I/O if the writer falls more
+	than MAX_QUEUED_BUFFERS buffers behind.
+
+	Write() and the other producer side methods must only be called from one thread at a time.
+
+	Also provides locale independent number formatting helpers built on std::to_chars, which produce exactly the same
+	text as the equivalent printf() format in the C locale.
+
+	@ingroup core
+ */
+class ExportWriter
+{
+public:
+	ExportWriter();
+	~ExportWriter();
+
+	ExportWriter(const ExportWriter&) =delete;
+	ExportWriter& operator=(const ExportWriter&) =delete;
+
+	bool Open(const std::string& path, bool append);
+	bool Close();
+	bool Flush();
+	void Submit();
+
+	/**
+		@brief Checks if a file is currently open
+	 */
+	bool IsOpen()
+	{ return m_fp != nullptr; }
+
+	/**
+		@brief Gets the size of the file, including data which has been written but not yet committed to disk
+	 */
+	uint64_t GetSize()
+	{ return m_size; }
+
+	/**
+		@brief Checks if any write to the file has failed since it was opened
+	 */
+	bool HasFailed()
+	{ return m_failed; }
+
+	void Write(const void* data, size_t len);
+
+	/**
+		@brief Writes a string to the file
+	 */
+	void Write(const std::string& str)
+	{ Write(str.data(), str.length()); }
+
+	/**
+		@brief Writes the raw in-memory representation of a trivially copyable object to the file
+	 */
+	template<class T>
+	void WriteObject(const T& obj)
+	{ Write(&obj, sizeof(obj)); }
+
+	static void CloseAll();
+
+	static void AppendFixed(std::string& str, double value, int precision = 6);
+	static void AppendScientific(std::string& str, double value, int precision);
+	static void AppendInteger(std::string& str, int64_t value);
+
+	///@brief Size of each write buffer
+	static constexpr size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+	///@brief Maximum number of full buffers waiting for the writer thread before Write() blocks
+	static constexpr size_t MAX_QUEUED_BUFFERS = 4;
+
+protected:
+
+	///@brief A single write buffer
+	typedef std::vector<uint8_t, AlignedAllocator<uint8_t, 4096> > Buffer;
+
+	void WriterThread();
+	std::unique_ptr<Buffer> GetFreeBuffer();
+
+	///@brief The file being written
+	FILE* m_fp;
+
+	///@brief Path to the file being written (for error messages)
+	std::string m_path;
+
+	///@brief Size of the file, including data not yet written
+	uint64_t m_size;
+
+	///@brief Set if any write has failed
+	std::atomic<bool> m_failed;
+
+	///@brief Buffer currently being filled by the producer
+	std::unique_ptr<Buffer> m_current;
+
+	///@brief Protects m_queue, m_freeBuffers, m_busy, and m_terminating
+	std::mutex m_mutex;
+
+	///@brief Signaled when a buffer is queued for writing, or the writer should terminate
+	std::condition_variable m_writeCvar;
+
+	///@brief Signaled when the writer thread finishes writing a buffer
+	std::condition_variable m_doneCvar;
+
+	///@brief Buffers waiting to be written
+	std::deque< std::unique_ptr<Buffer> > m_queue;
+
+	///@brief Buffers which have been written and can be reused
+	std::vector< std::unique_ptr<Buffer> > m_freeBuffers;
+
+	///@brief True while the writer thread is writing a buffer it has removed from the queue
+	bool m_busy;
+
+	///@brief Set to make the writer thread exit once the queue is empty
+	bool m_terminating;
+
+	///@brief The writer thread
+	std::thread m_thread;
+};
+
+#endif
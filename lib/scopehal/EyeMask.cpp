@@ -45,6 +45,9 @@
 
 #include <time.h>
 #include <iostream>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -55,6 +58,13 @@ using namespace std;
 EyeMask::EyeMask()
 	: m_hitrate(0)
 	, m_timebaseIsRelative(false)
+	, m_width(0)
+	, m_height(0)
+	, m_wordsPerRow(0)
+	, m_renderedRange(0)
+	, m_renderedXscale(0)
+	, m_renderedXoff(0)
+	, m_renderedUIWidth(0)
 {
 }
 
@@ -110,6 +120,9 @@ bool EyeMask::Load(const YAML::Node& node)
 	m_timebaseIsRelative = false;
 	m_maskname = "";
 
+	//Force the new polygons to be rendered next time the mask is used
+	m_canvas = nullptr;
+
 	//Load protocol section
 	auto proto = node["protocol"];
 	for(auto it : proto)
@@ -221,87 +234,211 @@ void EyeMask::RenderForAnalysis(
 }
 
 /**
-	@brief Checks a raw eye pattern dataset against the mask
+	@brief Renders the mask for hit testing, if the cached bitmap is out of date
+
+	The bitmap is only redrawn if the mask was reloaded or the size, scale, or UI width of the eye has changed since
+	the last call.
+
+	@param cap				The eye pattern being tested
+	@param width			Width of the eye, in pixels
+	@param height			Height of the eye, in pixels
+	@param fullscalerange	Full scale vertical range of the eye
+	@param xscale			Horizontal scale of the eye, in pixels per X axis unit
+	@param xoff				X axis position of the left edge of the eye
+
+	@return True if the mask was re-rendered, false if the cached bitmap was still valid
  */
-float EyeMask::CalculateHitRate(
+bool EyeMask::UpdateBitmap(
 	EyeWaveform* cap,
 	size_t width,
 	size_t height,
 	float fullscalerange,
 	float xscale,
-	float xoff
-	)
+	float xoff)
 {
-	if(!m_canvas || (m_width != width) || (m_height != height))
+	float uiWidth = m_timebaseIsRelative ? cap->GetUIWidth() : 0;
+	if(m_canvas &&
+		(m_width == width) &&
+		(m_height == height) &&
+		(m_renderedRange == fullscalerange) &&
+		(m_renderedXscale == xscale) &&
+		(m_renderedXoff == xoff) &&
+		(m_renderedUIWidth == uiWidth) )
 	{
-		m_width = width;
-		m_height = height;
-		m_canvas = std::make_unique< canvas_ity::canvas >( width, height );
-
-		//Software rendering
-		float yscale = height / fullscalerange;
-		RenderForAnalysis(
-			cap,
-			xscale,
-			xoff,
-			yscale,
-			0,
-			height);
+		return false;
 	}
 
-	//Test each pixel of the eye pattern against the mask
-
+	m_width = width;
+	m_height = height;
+	m_renderedRange = fullscalerange;
+	m_renderedXscale = xscale;
+	m_renderedXoff = xoff;
+	m_renderedUIWidth = uiWidth;
+	m_canvas = std::make_unique< canvas_ity::canvas >( width, height );
+
+	//Software rendering
+	float yscale = height / fullscalerange;
+	RenderForAnalysis(
+		cap,
+		xscale,
+		xoff,
+		yscale,
+		0,
+		height);
+
+	//Pack into a bitmap (any pixel that isn't black is part of the mask)
 	vector<uint8_t> image_data(width*height*4);
 	m_canvas->get_image_data(image_data.data(), width, height, m_width*4, 0,0);
 
-	if(cap->GetType() == EyeWaveform::EYE_NORMAL)
-	{
-		auto accum = cap->GetAccumData();
-		size_t nhits = 0;
+	m_wordsPerRow = (width + 63) / 64;
+	m_bitmap.clear();
+	m_bitmap.resize(m_wordsPerRow * height, 0);
 
-		uint32_t* data = reinterpret_cast<uint32_t*>(&image_data[0]);
-		for(size_t y=0; y<height; y++)
+	uint32_t* data = reinterpret_cast<uint32_t*>(&image_data[0]);
+	for(size_t y=0; y<height; y++)
+	{
+		auto row = data + (y*width);
+		auto bitrow = &m_bitmap[y*m_wordsPerRow];
+		for(size_t x=0; x<width; x++)
 		{
-			auto row = data + (y*width);
-			auto eyerow = accum + (y*width);
+			if(row[x] & 0xff)
+				bitrow[x / 64] |= (1ULL << (x % 64));
+		}
+	}
+
+	return true;
+}
+
+/**
+	@brief Sums the raw accumulator values of every pixel inside the mask
+ */
+int64_t EyeMask::CountHits(const int64_t* accum) const
+{
+	int64_t nhits = 0;
+	for(size_t y=0; y<m_height; y++)
+	{
+		auto bitrow = &m_bitmap[y*m_wordsPerRow];
+		auto eyerow = accum + (y*m_width);
 
-			for(size_t x=0; x<width; x++)
+		for(size_t w=0; w<m_wordsPerRow; w++)
+		{
+			//Visit only the pixels that are actually in the mask
+			auto bits = bitrow[w];
+			auto block = eyerow + w*64;
+			while(bits)
 			{
-				//If mask pixel isn't black, count violations
-				uint32_t pix = row[x];
-				auto hits = eyerow[x];
-				if(pix & 0xff)
-					nhits += hits;
+				nhits += block[__builtin_ctzll(bits)];
+				bits &= (bits - 1);
 			}
 		}
+	}
 
-		//LogTrace("Total %zu hits out of %zu samples\n", nhits / EYE_ACCUM_SCALE, cap->GetTotalSamples());
-		return nhits * 1.0 / (cap->GetTotalSamples() * EYE_ACCUM_SCALE);
+	return nhits;
+}
+
+#ifdef __x86_64__
+/**
+	@brief Sums the raw accumulator values of every pixel inside the mask
+
+	Words entirely inside the mask (the usual case away from polygon edges) are summed four pixels at a time.
+ */
+__attribute__((target("avx2")))
+int64_t EyeMask::CountHitsAVX2(const int64_t* accum) const
+{
+	int64_t nhits = 0;
+	__m256i vhits = _mm256_setzero_si256();
+	for(size_t y=0; y<m_height; y++)
+	{
+		auto bitrow = &m_bitmap[y*m_wordsPerRow];
+		auto eyerow = accum + (y*m_width);
+
+		for(size_t w=0; w<m_wordsPerRow; w++)
+		{
+			auto bits = bitrow[w];
+			auto block = eyerow + w*64;
+
+			//Padding bits are always zero, so a full word is always 64 pixels inside the row
+			if(bits == ~0ULL)
+			{
+				for(size_t i=0; i<64; i += 4)
+					vhits = _mm256_add_epi64(vhits, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i)));
+				continue;
+			}
+
+			while(bits)
+			{
+				nhits += block[__builtin_ctzll(bits)];
+				bits &= (bits - 1);
+			}
+		}
 	}
-	else //if(cap->GetType() == EyeWaveform::EYE_BER)
+
+	int64_t lanes[4] __attribute__((aligned(32)));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vhits);
+	return nhits + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif /* __x86_64__ */
+
+/**
+	@brief Finds the highest BER of any pixel inside the mask
+ */
+float EyeMask::FindMaxBER(const float* data) const
+{
+	float nmax = 0;
+	for(size_t y=0; y<m_height; y++)
 	{
-		auto accum = cap->GetData();
-		float nmax = 0;
+		auto bitrow = &m_bitmap[y*m_wordsPerRow];
+		auto eyerow = data + (y*m_width);
 
-		uint32_t* data = reinterpret_cast<uint32_t*>(&image_data[0]);
-		for(size_t y=0; y<height; y++)
+		for(size_t w=0; w<m_wordsPerRow; w++)
 		{
-			auto row = data + (y*width);
-			auto eyerow = accum + (y*width);
-			for(size_t x=0; x<width; x++)
+			auto bits = bitrow[w];
+			auto block = eyerow + w*64;
+			while(bits)
 			{
-				//If mask pixel isn't black, count violations
-				uint32_t pix = row[x];
-				if( (pix & 0xff) != 0)
-				{
-					//BER eyes don't need any preprocessing since the pixel values are already raw BER
-					float rate = eyerow[x];
-					if(rate > nmax)
-						nmax = rate;
-				}
+				//BER eyes don't need any preprocessing since the pixel values are already raw BER
+				float rate = block[__builtin_ctzll(bits)];
+				if(rate > nmax)
+					nmax = rate;
+				bits &= (bits - 1);
 			}
 		}
+	}
+
+	return nmax;
+}
+
+/**
+	@brief Checks a raw eye pattern dataset against the mask
 
-		return nmax;
+	The rasterized mask is cached between calls (see UpdateBitmap) so in the common case of an eye which is
+	accumulating more UIs with unchanged geometry, this only touches the accumulator pixels inside the mask.
+ */
+float EyeMask::CalculateHitRate(
+	EyeWaveform* cap,
+	size_t width,
+	size_t height,
+	float fullscalerange,
+	float xscale,
+	float xoff
+	)
+{
+	UpdateBitmap(cap, width, height, fullscalerange, xscale, xoff);
+
+	//Test each pixel of the eye pattern against the mask
+	if(cap->GetType() == EyeWaveform::EYE_NORMAL)
+	{
+		int64_t nhits;
+		#ifdef __x86_64__
+		if(g_hasAvx2)
+			nhits = CountHitsAVX2(cap->GetAccumData());
+		else
+		#endif
+			nhits = CountHits(cap->GetAccumData());
+
+		//LogTrace("Total %zu hits out of %zu samples\n", nhits / EYE_ACCUM_SCALE, cap->GetTotalSamples());
+		return nhits * 1.0 / (cap->GetTotalSamples() * EYE_ACCUM_SCALE);
 	}
+	else //if(cap->GetType() == EyeWaveform::EYE_BER)
+		return FindMaxBER(cap->GetData());
 }
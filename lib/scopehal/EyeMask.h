@@ -136,6 +136,31 @@ public:
 		float xscale,
 		float xoff);
 
+	bool UpdateBitmap(
+		EyeWaveform* cap,
+		size_t width,
+		size_t height,
+		float fullscalerange,
+		float xscale,
+		float xoff);
+
+	///@brief Returns true if the pixel at (x, y) of the most recently rendered mask is inside a polygon
+	bool IsMasked(size_t x, size_t y) const
+	{ return (m_bitmap[y*m_wordsPerRow + x/64] >> (x % 64)) & 1; }
+
+	/**
+		@brief Get the rasterized mask as a packed bitmap
+
+		Each row is m_wordsPerRow 64-bit words long, with bit N of word M being pixel (M*64 + N).
+		Padding bits past the end of the row are always zero.
+	 */
+	const std::vector<uint64_t>& GetBitmap() const
+	{ return m_bitmap; }
+
+	///@brief Get the number of 64-bit words in each row of the bitmap
+	size_t GetWordsPerRow() const
+	{ return m_wordsPerRow; }
+
 	///@brief Return true if there are no polygons in the mask
 	bool empty() const
 	{ return m_polygons.empty(); }
@@ -171,6 +196,11 @@ public:
 	}
 
 protected:
+	int64_t CountHits(const int64_t* accum) const;
+#ifdef __x86_64__
+	int64_t CountHitsAVX2(const int64_t* accum) const;
+#endif
+	float FindMaxBER(const float* data) const;
 
 	///@brief Filename of the mask
 	std::string m_fname;
@@ -195,6 +225,24 @@ protected:
 
     ///@brief Current height
     size_t m_height;
+
+	///@brief Rasterized mask, one bit per pixel (see GetBitmap)
+	std::vector<uint64_t> m_bitmap;
+
+	///@brief Number of 64-bit words in each row of m_bitmap
+	size_t m_wordsPerRow;
+
+	///@brief Full scale vertical range the bitmap was rendered for
+	float m_renderedRange;
+
+	///@brief Horizontal scale the bitmap was rendered for
+	float m_renderedXscale;
+
+	///@brief Horizontal offset the bitmap was rendered for
+	float m_renderedXoff;
+
+	///@brief UI width the bitmap was rendered for (only meaningful if the timebase is relative)
+	float m_renderedUIWidth;
 };
 
 #endif
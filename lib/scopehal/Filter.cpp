@@ -60,6 +60,7 @@ Filter::Filter(
 	: OscilloscopeChannel(NULL, "", color, xunit, 0)	//TODO: handle this better?
 	, m_category(cat)
 	, m_usingDefault(true)
+	, m_traceName(nullptr)
 {
 	m_instanceNum = 0;
 	m_filters.emplace(this);
@@ -947,6 +948,23 @@ bool Filter::ShouldPersistWaveform()
 	return false;
 }
 
+/**
+	@brief Gets the name of this filter for use in TraceSpan
+
+	The display name is only interned again if it has changed since the last call, so the trace recorder's global
+	mutex isn't taken on every refresh. Must only be called by the thread currently refreshing the filter.
+ */
+const char* Filter::GetTraceName()
+{
+	auto name = GetDisplayName();
+	if( (m_traceName == nullptr) || (name != m_traceNameSource) )
+	{
+		m_traceName = TraceRecorder::Intern(name);
+		m_traceNameSource = name;
+	}
+	return m_traceName;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Interpolation helpers
 
@@ -1267,6 +1285,130 @@ SparseDigitalWaveform* Filter::SetupSparseDigitalOutputWaveform(SparseWaveformBa
 	return cap;
 }
 
+/**
+	@brief Sets up an analog output waveform which accumulates data from the input across multiple triggers
+
+	The existing output waveform is reused, and its contents left intact, as long as it still matches the geometry
+	(memory depth and sample rate) of the input. Otherwise the output is resized and reset is set to true, in which
+	case the caller must initialize every sample rather than merging new data into the old.
+
+	Calling SetData(nullptr, stream) (typically from ClearSweeps()) forces a reset on the next call.
+
+	@param din			Input waveform
+	@param stream		Stream index
+	@param reset		Set to true if the output has no valid accumulated data, false otherwise
+
+	@return	The ready-to-use output waveform, with CPU side buffers valid
+ */
+UniformAnalogWaveform* Filter::SetupPersistentUniformAnalogOutputWaveform(
+	UniformWaveformBase* din, size_t stream, bool& reset)
+{
+	//Create the waveform, but only if necessary
+	auto cap = dynamic_cast<UniformAnalogWaveform*>(GetData(stream));
+	reset = false;
+	if(cap == NULL)
+	{
+		cap = new UniformAnalogWaveform;
+		SetData(cap, stream);
+		reset = true;
+	}
+
+	//Old data is meaningless if the input geometry changed
+	size_t len = din->size();
+	if( (cap->size() != len) || (cap->m_timescale != din->m_timescale) )
+	{
+		cap->Resize(len);
+		reset = true;
+	}
+
+	//Copy configuration
+	cap->m_startTimestamp 		= din->m_startTimestamp;
+	cap->m_startFemtoseconds	= din->m_startFemtoseconds;
+	cap->m_triggerPhase			= din->m_triggerPhase;
+	cap->m_timescale			= din->m_timescale;
+
+	//Bump rev number
+	cap->m_revision ++;
+
+	cap->PrepareForCpuAccess();
+	return cap;
+}
+
+/**
+	@brief Sets up an analog output waveform which accumulates data from the input across multiple triggers
+
+	The existing output waveform is reused, and its contents left intact, as long as it still matches the geometry
+	(number of samples and timebase) of the input. Otherwise the output is resized and reset is set to true, in which
+	case the caller must initialize every sample rather than merging new data into the old.
+
+	Timestamps are copied from the input to the output.
+
+	Calling SetData(nullptr, stream) (typically from ClearSweeps()) forces a reset on the next call.
+
+	@param din			Input waveform
+	@param stream		Stream index
+	@param reset		Set to true if the output has no valid accumulated data, false otherwise
+
+	@return	The ready-to-use output waveform, with CPU side buffers valid
+ */
+SparseAnalogWaveform* Filter::SetupPersistentSparseAnalogOutputWaveform(
+	SparseWaveformBase* din, size_t stream, bool& reset)
+{
+	//Create the waveform, but only if necessary
+	auto cap = dynamic_cast<SparseAnalogWaveform*>(GetData(stream));
+	reset = false;
+	if(cap == NULL)
+	{
+		cap = new SparseAnalogWaveform;
+		SetData(cap, stream);
+		reset = true;
+	}
+
+	//Old data is meaningless if the input geometry changed
+	size_t len = din->size();
+	if( (cap->size() != len) || (cap->m_timescale != din->m_timescale) )
+	{
+		cap->Resize(len);
+		reset = true;
+	}
+
+	//Copy configuration
+	cap->m_startTimestamp 		= din->m_startTimestamp;
+	cap->m_startFemtoseconds	= din->m_startFemtoseconds;
+	cap->m_triggerPhase			= din->m_triggerPhase;
+	cap->m_timescale			= din->m_timescale;
+	cap->CopyTimestamps(din);
+
+	//Bump rev number
+	cap->m_revision ++;
+
+	cap->PrepareForCpuAccess();
+	return cap;
+}
+
+/**
+	@brief Discards the oldest samples from a waveform used as a fixed-depth history buffer
+
+	The history never holds more than depth samples. The oldest samples are only skipped over by pop_front(), so a full
+	history doesn't have to be moved every time a sample is added: it is compacted once as many samples have been
+	dropped as it holds, or when it is next uploaded to the GPU for rendering. Offsets are relative to a fixed epoch and
+	are not rewritten.
+
+	@param wfm		The history waveform
+	@param depth	Maximum number of samples to keep
+ */
+void Filter::TrimHistory(SparseAnalogWaveform* wfm, size_t depth)
+{
+	size_t len = wfm->size();
+	if(len <= depth)
+		return;
+
+	size_t n = len - depth;
+	wfm->m_samples.pop_front(n);
+	wfm->m_offsets.pop_front(n);
+	wfm->m_durations.pop_front(n);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Event driven filter processing
 
@@ -1369,6 +1511,44 @@ void Filter::AdvanceToTimestampScaled(UniformWaveformBase* wfm, size_t& i, size_
 		i ++;
 }
 
+/**
+	@brief Finds the sample index that AdvanceToTimestampScaled() would reach from the start of the waveform
+
+	Uses a binary search, so it's cheap to jump to an arbitrary point in the waveform.
+
+	Works in native X axis units
+ */
+size_t Filter::GetIndexAtTimestampScaled(SparseWaveformBase* wfm, size_t len, int64_t timestamp)
+{
+	if(len == 0)
+		return 0;
+
+	timestamp -= wfm->m_triggerPhase;
+	int64_t timescale = wfm->m_timescale;
+
+	auto offsets = wfm->m_offsets.GetCpuPointer();
+	auto it = upper_bound(
+		offsets + 1,
+		offsets + len,
+		timestamp,
+		[timescale](int64_t t, int64_t offset) { return t < offset * timescale; });
+	return (it - offsets) - 1;
+}
+
+/**
+	@brief Finds the sample index that AdvanceToTimestampScaled() would reach from the start of the waveform
+
+	Works in native X axis units
+ */
+size_t Filter::GetIndexAtTimestampScaled(UniformWaveformBase* wfm, size_t len, int64_t timestamp)
+{
+	timestamp -= wfm->m_triggerPhase;
+	if( (len == 0) || (timestamp < 0) )
+		return 0;
+
+	return min(len - 1, static_cast<size_t>(timestamp / wfm->m_timescale));
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Common DSP helpers
 
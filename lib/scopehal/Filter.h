@@ -261,6 +261,8 @@ public:
 
 	virtual bool ShouldPersistWaveform() override;
 
+	const char* GetTraceName();
+
 protected:
 
 	///@brief Category this filter should be displayed under
@@ -269,6 +271,12 @@ protected:
 	///@brief If true, we're using an auto-generated name
 	bool m_usingDefault;
 
+	///@brief Display name that m_traceName was interned from
+	std::string m_traceNameSource;
+
+	///@brief Interned copy of the display name for trace spans (see GetTraceName)
+	const char* m_traceName;
+
 	bool VerifyAllInputsOK(bool allowEmpty = false);
 	bool VerifyInputOK(size_t i, bool allowEmpty = false);
 	bool VerifyAllInputsOKAndUniformAnalog();
@@ -327,6 +335,18 @@ public:
 			return GetNextEventTimestampScaled(uwfm, i, len, timestamp);
 	}
 
+	static size_t GetIndexAtTimestampScaled(SparseWaveformBase* wfm, size_t len, int64_t timestamp);
+	static size_t GetIndexAtTimestampScaled(UniformWaveformBase* wfm, size_t len, int64_t timestamp);
+
+	static size_t GetIndexAtTimestampScaled(
+		SparseWaveformBase* swfm, UniformWaveformBase* uwfm, size_t len, int64_t timestamp)
+	{
+		if(swfm)
+			return GetIndexAtTimestampScaled(swfm, len, timestamp);
+		else
+			return GetIndexAtTimestampScaled(uwfm, len, timestamp);
+	}
+
 protected:
 	UniformAnalogWaveform* SetupEmptyUniformAnalogOutputWaveform(WaveformBase* din, size_t stream, bool clear=true);
 	SparseAnalogWaveform* SetupEmptySparseAnalogOutputWaveform(WaveformBase* din, size_t stream, bool clear=true);
@@ -335,6 +355,13 @@ protected:
 	SparseAnalogWaveform* SetupSparseOutputWaveform(SparseWaveformBase* din, size_t stream, size_t skipstart, size_t skipend);
 	SparseDigitalWaveform* SetupSparseDigitalOutputWaveform(SparseWaveformBase* din, size_t stream, size_t skipstart, size_t skipend);
 
+	//Helpers for filters which accumulate data across triggers
+	UniformAnalogWaveform* SetupPersistentUniformAnalogOutputWaveform(
+		UniformWaveformBase* din, size_t stream, bool& reset);
+	SparseAnalogWaveform* SetupPersistentSparseAnalogOutputWaveform(
+		SparseWaveformBase* din, size_t stream, bool& reset);
+	static void TrimHistory(SparseAnalogWaveform* wfm, size_t depth);
+
 public:
 	//Helpers for sub-sample interpolation
 
@@ -406,15 +433,18 @@ public:
 	{
 		AssertTypeIsAnalogWaveform(cap);
 
-		vmin = FLT_MAX;
-		vmax = FLT_MIN;
-		for(float f : cap->m_samples)
-		{
-			if(f < vmin)
-				vmin = f;
-			if(f > vmax)
-				vmax = f;
-		}
+		Histogram::GetMinMax(cap->m_samples.GetCpuPointer(), cap->m_samples.size(), vmin, vmax);
+	}
+
+	/**
+		@brief Gets the lowest and highest voltage of a waveform which may be sparse or uniform
+	 */
+	static void GetMinMaxVoltage(SparseAnalogWaveform* s, UniformAnalogWaveform* u, float& vmin, float& vmax)
+	{
+		if(s)
+			GetMinMaxVoltage(s, vmin, vmax);
+		else
+			GetMinMaxVoltage(u, vmin, vmax);
 	}
 
 	/**
@@ -486,8 +516,9 @@ public:
 	{
 		AssertTypeIsAnalogWaveform(cap);
 
-		float vmin = GetMinVoltage(cap);
-		float vmax = GetMaxVoltage(cap);
+		float vmin;
+		float vmax;
+		GetMinMaxVoltage(cap, vmin, vmax);
 		float delta = vmax - vmin;
 		const int nbins = 100;
 		auto hist = MakeHistogram(cap, vmin, vmax, nbins);
@@ -528,8 +559,9 @@ public:
 	{
 		AssertTypeIsAnalogWaveform(cap);
 
-		float vmin = GetMinVoltage(cap);
-		float vmax = GetMaxVoltage(cap);
+		float vmin;
+		float vmax;
+		GetMinMaxVoltage(cap, vmin, vmax);
 		float delta = vmax - vmin;
 		const int nbins = 100;
 		auto hist = MakeHistogram(cap, vmin, vmax, nbins);
@@ -604,28 +636,9 @@ public:
 	{
 		AssertTypeIsAnalogWaveform(cap);
 
-		std::vector<size_t> ret;
-		for(size_t i=0; i<bins; i++)
-			ret.push_back(0);
-
-		//Early out if we have zero span
-		if(bins == 0)
-			return ret;
-
-		float delta = high-low;
-
-		for(float v : cap->m_samples)
-		{
-			float fbin = (v-low) / delta;
-			size_t bin = floor(fbin * bins);
-			if(fbin < 0)
-				bin = 0;
-			else
-				bin = std::min(bin, bins-1);
-			ret[bin] ++;
-		}
-
-		return ret;
+		Histogram hist(low, high, bins, Histogram::RANGE_CLAMP);
+		hist.Add(cap->m_samples.GetCpuPointer(), cap->m_samples.size());
+		return hist.GetBins();
 	}
 
 	/**
@@ -661,27 +674,9 @@ public:
 	{
 		AssertTypeIsAnalogWaveform(cap);
 
-		std::vector<size_t> ret;
-		for(size_t i=0; i<bins; i++)
-			ret.push_back(0);
-
-		//Early out if we have zero span
-		if(bins == 0)
-			return ret;
-
-		float delta = high-low;
-
-		for(float v : cap->m_samples)
-		{
-			float fbin = (v-low) / delta;
-			// must cast through a signed int type to avoid UB (e.g. saturates to 0 on arm64) [conv.fpint]
-			size_t bin = static_cast<ssize_t>(floor(fbin * bins));
-			if(bin >= bins)	//negative values wrap to huge positive and get caught here
-				continue;
-			ret[bin] ++;
-		}
-
-		return ret;
+		Histogram hist(low, high, bins, Histogram::RANGE_CLIP);
+		hist.Add(cap->m_samples.GetCpuPointer(), cap->m_samples.size());
+		return hist.GetBins();
 	}
 
 	/**
@@ -704,54 +699,7 @@ public:
 		AssertTypeIsDigitalWaveform(clock);
 		AssertSampleTypesAreSame(data, &samples);
 
-		samples.clear();
-		samples.SetGpuAccessHint(AcceleratorBuffer<S>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
-
-		//If the clock is sparse, assume it probably has edges on every sample and allocate that much buffer to start
-		//(we might overallocate here but it'll be a lot faster)
-		if(dynamic_cast<SparseDigitalWaveform*>(clock) != nullptr)
-			samples.Reserve(clock->size());
-		else
-		{
-			samples.Reserve(1 * 1024 * 1024);	//preallocate 1 MB sample buffer to avoid lots of reallocation when small
-												//if it's smaller than this, we won't waste a lot of memory
-		}
-		samples.PrepareForCpuAccess();
-
-		//TODO: split up into blocks and multithread?
-		//TODO: AVX vcompress?
-
-		size_t len = clock->size();
-		size_t dlen = data->size();
-
-		size_t ndata = 0;
-		for(size_t i=1; i<len; i++)
-		{
-			//Throw away clock samples until we find an edge
-			if(clock->m_samples[i] == clock->m_samples[i-1])
-				continue;
-
-			//Throw away data samples until the data is synced with us
-			int64_t clkstart = GetOffsetScaled(clock, i);
-			while( (ndata+1 < dlen) && (GetOffsetScaled(data, ndata+1) < clkstart) )
-				ndata ++;
-			if(ndata >= dlen)
-				break;
-
-			//Add the new sample
-			samples.m_offsets.push_back(clkstart);
-			samples.m_samples.push_back(data->m_samples[ndata]);
-		}
-
-		//Compute sample durations
-		#ifdef __x86_64__
-		if(g_hasAvx2)
-			FillDurationsAVX2(samples);
-		else
-		#endif
-			FillDurationsGeneric(samples);
-
-		samples.MarkModifiedFromCpu();
+		SampleOnEdgesInternal<SAMPLE_ANY_EDGE, false>(data, clock, samples);
 	}
 
 	/**
@@ -811,45 +759,7 @@ public:
 		AssertTypeIsSparseWaveform(&samples);
 		AssertSampleTypesAreSame(data, &samples);
 
-		samples.clear();
-		samples.SetGpuAccessHint(AcceleratorBuffer<S>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
-		samples.Reserve(1 * 1024 * 1024);	//preallocate 1 MB sample buffer to avoid lots of reallocation when small
-											//if it's smaller than this, we won't waste a lot of memory
-
-		//TODO: split up into blocks and multithread?
-		//TODO: AVX vcompress?
-
-		size_t len = clock->size();
-		size_t dlen = data->size();
-
-		size_t ndata = 0;
-		for(size_t i=1; i<len; i++)
-		{
-			//Throw away clock samples until we find a rising edge
-			if(!(clock->m_samples[i] && !clock->m_samples[i-1]))
-				continue;
-
-			//Throw away data samples until the data is synced with us
-			int64_t clkstart = GetOffsetScaled(clock, i);
-			while( (ndata+1 < dlen) && (GetOffsetScaled(data, ndata+1) < clkstart) )
-				ndata ++;
-			if(ndata >= dlen)
-				break;
-
-			//Add the new sample
-			samples.m_offsets.push_back(clkstart);
-			samples.m_samples.push_back(data->m_samples[ndata]);
-		}
-
-		//Compute sample durations
-		#ifdef __x86_64__
-		if(g_hasAvx2)
-			FillDurationsAVX2(samples);
-		else
-		#endif
-			FillDurationsGeneric(samples);
-
-		samples.MarkModifiedFromCpu();
+		SampleOnEdgesInternal<SAMPLE_RISING_EDGE, false>(data, clock, samples);
 	}
 
 	/**
@@ -909,45 +819,7 @@ public:
 		AssertTypeIsSparseWaveform(&samples);
 		AssertSampleTypesAreSame(data, &samples);
 
-		samples.clear();
-		samples.SetGpuAccessHint(AcceleratorBuffer<S>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
-		samples.Reserve(1 * 1024 * 1024);	//preallocate 1 MB sample buffer to avoid lots of reallocation when small
-											//if it's smaller than this, we won't waste a lot of memory
-
-		//TODO: split up into blocks and multithread?
-		//TODO: AVX vcompress?
-
-		size_t len = clock->size();
-		size_t dlen = data->size();
-
-		size_t ndata = 0;
-		for(size_t i=1; i<len; i++)
-		{
-			//Throw away clock samples until we find a falling edge
-			if(!(!clock->m_samples[i] && clock->m_samples[i-1]))
-				continue;
-
-			//Throw away data samples until the data is synced with us
-			int64_t clkstart = GetOffsetScaled(clock, i);
-			while( (ndata+1 < dlen) && (GetOffsetScaled(data, ndata+1) < clkstart) )
-				ndata ++;
-			if(ndata >= dlen)
-				break;
-
-			//Add the new sample
-			samples.m_offsets.push_back(clkstart);
-			samples.m_samples.push_back(data->m_samples[ndata]);
-		}
-
-		//Compute sample durations
-		#ifdef __x86_64__
-		if(g_hasAvx2)
-			FillDurationsAVX2(samples);
-		else
-		#endif
-			FillDurationsGeneric(samples);
-
-		samples.MarkModifiedFromCpu();
+		SampleOnEdgesInternal<SAMPLE_FALLING_EDGE, false>(data, clock, samples);
 	}
 
 	/**
@@ -969,50 +841,7 @@ public:
 		AssertTypeIsAnalogWaveform(data);
 		AssertTypeIsDigitalWaveform(clock);
 
-		samples.clear();
-		samples.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
-		samples.Reserve(1 * 1024 * 1024);	//preallocate 1 MB sample buffer to avoid lots of reallocation when small
-											//if it's smaller than this, we won't waste a lot of memory
-
-		//TODO: split up into blocks and multithread?
-		//TODO: AVX vcompress
-
-		size_t len = clock->size();
-		size_t dlen = data->size();
-
-		size_t ndata = 0;
-		for(size_t i=1; i<len; i++)
-		{
-			//Throw away clock samples until we find an edge
-			if(clock->m_samples[i] == clock->m_samples[i-1])
-				continue;
-
-			//Throw away data samples until the data is synced with us
-			int64_t clkstart = GetOffsetScaled(clock, i);
-			while( (ndata+1 < dlen) && (GetOffsetScaled(data, ndata+1) < clkstart) )
-				ndata ++;
-			if(ndata >= dlen)
-				break;
-
-			//Find the fractional position of the clock edge
-			int64_t tsample = GetOffsetScaled(data, ndata);
-			int64_t delta = clkstart - tsample;
-			float frac = delta * 1.0 / data->m_timescale;
-
-			//Add the new sample
-			samples.m_offsets.push_back(clkstart);
-			samples.m_samples.push_back(InterpolateValue(data, ndata, frac));
-		}
-
-		//Compute sample durations
-		#ifdef __x86_64__
-		if(g_hasAvx2)
-			FillDurationsAVX2(samples);
-		else
-		#endif
-			FillDurationsGeneric(samples);
-
-		samples.MarkModifiedFromCpu();
+		SampleOnEdgesInternal<SAMPLE_ANY_EDGE, true>(data, clock, samples);
 	}
 
 	/**
@@ -1169,6 +998,188 @@ protected:
 	static void FillDurationsAVX2(SparseWaveformBase& wfm);
 #endif
 
+	/**
+		@brief Which clock edges SampleOnEdgesInternal() samples on
+	 */
+	enum SamplingEdgeType
+	{
+		SAMPLE_ANY_EDGE,
+		SAMPLE_RISING_EDGE,
+		SAMPLE_FALLING_EDGE
+	};
+
+	///@brief Number of clock samples processed per thread by SampleOnEdgesInternal()
+	static constexpr size_t SAMPLING_BLOCK_SIZE = 262144;
+
+	/**
+		@brief Checks if there is a clock edge of the requested type at a given sample of the clock
+	 */
+	template<SamplingEdgeType type, class R>
+	static inline bool IsSamplingEdge(R* clock, size_t i)
+	{
+		if constexpr(type == SAMPLE_RISING_EDGE)
+			return clock->m_samples[i] && !clock->m_samples[i-1];
+		else if constexpr(type == SAMPLE_FALLING_EDGE)
+			return !clock->m_samples[i] && clock->m_samples[i-1];
+		else
+			return clock->m_samples[i] != clock->m_samples[i-1];
+	}
+
+	/**
+		@brief Finds the index of the last sample of a uniform waveform starting before a given time
+
+		Returns 0 if the first sample starts at or after the target time.
+
+		Uniform waveforms don't need a search at all, the index can be calculated directly.
+	 */
+	template<class S>
+	static inline size_t FindSampleIndex(UniformWaveform<S>* data, [[maybe_unused]] size_t hint, int64_t t)
+	{
+		int64_t rel = t - data->m_triggerPhase;
+		if(rel <= 0)
+			return 0;
+
+		//Index of the first sample starting at or after t
+		int64_t first = (rel + data->m_timescale - 1) / data->m_timescale;
+		first = std::min(first, static_cast<int64_t>(data->size()));
+		return first - 1;
+	}
+
+	/**
+		@brief Finds the index of the last sample of a sparse waveform starting before a given time
+
+		Returns hint if no sample after hint starts before the target time.
+
+		Gallops forward from the hint (normally the result for the previous clock edge) to bracket the target, then
+		does a branchless binary search within the bracket. This is O(1) when the data and clock are about the same
+		rate, and O(log n) when the data is heavily oversampled relative to the clock.
+	 */
+	template<class S>
+	static inline size_t FindSampleIndex(SparseWaveform<S>* data, size_t hint, int64_t t)
+	{
+		size_t dlen = data->size();
+		const int64_t* offsets = data->m_offsets.GetCpuPointer();
+		int64_t timescale = data->m_timescale;
+		int64_t phase = data->m_triggerPhase;
+
+		//Bracket the target: lo is known to be before it, hi is past it (or the end of the waveform)
+		size_t lo = hint;
+		size_t step = 1;
+		size_t hi = lo + 1;
+		while( (hi < dlen) && (offsets[hi]*timescale + phase < t) )
+		{
+			lo = hi;
+			step <<= 1;
+			hi = lo + step;
+		}
+		hi = std::min(hi, dlen);
+
+		//Search within the bracket
+		size_t n = hi - lo;
+		while(n > 1)
+		{
+			size_t half = n / 2;
+			lo = (offsets[lo + half]*timescale + phase < t) ? (lo + half) : lo;
+			n -= half;
+		}
+		return lo;
+	}
+
+	/**
+		@brief Common implementation of SampleOnAnyEdges(), SampleOnRisingEdges(), SampleOnFallingEdges(), and
+		SampleOnAnyEdgesWithInterpolation()
+
+		The clock is split into blocks of SAMPLING_BLOCK_SIZE samples. Edges in each block are counted first, so the
+		output can be allocated once at its final size and every block knows where its output goes. The blocks are
+		then sampled in parallel.
+
+		For each clock edge, the sampled value is that of the last data sample starting before the edge (or the first
+		data sample, if the edge is before the start of the data).
+	 */
+	template<SamplingEdgeType type, bool interpolate, class T, class R, class S>
+	__attribute__((noinline))
+	static void SampleOnEdgesInternal(T* data, R* clock, SparseWaveform<S>& samples)
+	{
+		samples.clear();
+		samples.SetGpuAccessHint(AcceleratorBuffer<S>::HINT_NEVER);	//assume we're being used as part of a CPU-side filter
+		samples.PrepareForCpuAccess();
+
+		size_t len = clock->size();
+		size_t dlen = data->size();
+		if( (len < 2) || (dlen == 0) )
+		{
+			samples.MarkModifiedFromCpu();
+			return;
+		}
+
+		//Count edges in each block
+		size_t nblocks = (len + SAMPLING_BLOCK_SIZE - 1) / SAMPLING_BLOCK_SIZE;
+		std::vector<size_t> blockStart(nblocks);
+		#pragma omp parallel for if(nblocks > 1)
+		for(size_t b=0; b<nblocks; b++)
+		{
+			size_t start = std::max(static_cast<size_t>(1), b*SAMPLING_BLOCK_SIZE);
+			size_t end = std::min(len, (b+1)*SAMPLING_BLOCK_SIZE);
+
+			size_t count = 0;
+			for(size_t i=start; i<end; i++)
+				count += IsSamplingEdge<type>(clock, i);
+			blockStart[b] = count;
+		}
+
+		//Convert counts to output positions and allocate the output
+		size_t nedges = 0;
+		for(size_t b=0; b<nblocks; b++)
+		{
+			size_t count = blockStart[b];
+			blockStart[b] = nedges;
+			nedges += count;
+		}
+		samples.Resize(nedges);
+
+		//Do the actual sampling
+		#pragma omp parallel for if(nblocks > 1)
+		for(size_t b=0; b<nblocks; b++)
+		{
+			size_t start = std::max(static_cast<size_t>(1), b*SAMPLING_BLOCK_SIZE);
+			size_t end = std::min(len, (b+1)*SAMPLING_BLOCK_SIZE);
+
+			size_t nout = blockStart[b];
+			size_t ndata = 0;
+			for(size_t i=start; i<end; i++)
+			{
+				if(!IsSamplingEdge<type>(clock, i))
+					continue;
+
+				int64_t clkstart = GetOffsetScaled(clock, i);
+				ndata = FindSampleIndex(data, ndata, clkstart);
+
+				samples.m_offsets[nout] = clkstart;
+				if constexpr(interpolate)
+				{
+					//Find the fractional position of the clock edge
+					int64_t tsample = GetOffsetScaled(data, ndata);
+					int64_t delta = clkstart - tsample;
+					float frac = delta * 1.0 / data->m_timescale;
+					samples.m_samples[nout] = InterpolateValue(data, ndata, frac);
+				}
+				else
+					samples.m_samples[nout] = data->m_samples[ndata];
+				nout ++;
+			}
+		}
+
+		//Compute sample durations
+		#ifdef __x86_64__
+		if(g_hasAvx2)
+			FillDurationsAVX2(samples);
+		else
+		#endif
+			FillDurationsGeneric(samples);
+
+		samples.MarkModifiedFromCpu();
+	}
+
 public:
 	sigc::signal<void()> signal_outputsChanged()
 	{ return m_outputsChangedSignal; }
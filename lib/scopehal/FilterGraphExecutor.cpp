@@ -72,6 +72,8 @@ void FilterGraphExecutor::RunBlocking(const set<FlowGraphNode*>& nodes)
 	if(nodes.empty())
 		return;
 
+	TraceSpan span("FilterGraph", "filter");
+
 	{
 		lock_guard<mutex> lock(m_perfStatsMutex);
 		m_currentExecutionTime.clear();
@@ -210,6 +212,7 @@ void FilterGraphExecutor::ExecutorThread(FilterGraphExecutor* pThis, size_t i)
 	#ifdef __linux__
 	pthread_setname_np(pthread_self(), "FilterGraph");
 	#endif
+	TraceRecorder::SetThreadName("FilterGraph " + to_string(i));
 
 	//Make locale handling thread safe on Windows
 	#ifdef _WIN32
@@ -297,7 +300,17 @@ void FilterGraphExecutor::DoExecutorThread(size_t i)
 
 			//Actually execute the filter
 			double start = GetTime();
-			f->Refresh(cmdbuf, queue);
+			{
+				const char* traceName = nullptr;
+				if(TraceRecorder::IsEnabled())
+				{
+					auto filter = dynamic_cast<Filter*>(f);
+					traceName = filter ? filter->GetTraceName() : "FlowGraphNode";
+				}
+				TraceSpan span(traceName, "filter");
+
+				f->Refresh(cmdbuf, queue);
+			}
 			double dt = GetTime() - start;
 			{
 				lock_guard<mutex> slock(m_perfStatsMutex);
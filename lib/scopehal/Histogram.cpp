@@ -0,0 +1,446 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of Histogram
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+#ifdef __x86_64__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates an empty histogram
+
+	@param low		Low end of the range
+	@param high		High end of the range
+	@param bins		Number of bins
+	@param mode		What to do with samples outside the range
+ */
+Histogram::Histogram(float low, float high, size_t bins, RangeMode mode)
+	: m_low(low)
+	, m_high(high)
+	, m_mode(mode)
+	, m_bins(bins, 0)
+	, m_count(0)
+	, m_min(FLT_MAX)
+	, m_max(-FLT_MAX)
+{
+}
+
+/**
+	@brief Resets all bins and statistics to zero
+ */
+void Histogram::Clear()
+{
+	for(auto& b : m_bins)
+		b = 0;
+	m_count = 0;
+	m_min = FLT_MAX;
+	m_max = -FLT_MAX;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Binning
+
+/**
+	@brief Adds a block of samples to the histogram
+
+	@param samples	The samples
+	@param count	Number of samples
+ */
+void Histogram::Add(const float* samples, size_t count)
+{
+	//Nothing to bin into, but keep the statistics up to date
+	if(m_bins.empty())
+	{
+		float vmin;
+		float vmax;
+		GetMinMax(samples, count, vmin, vmax);
+		m_min = min(m_min, vmin);
+		m_max = max(m_max, vmax);
+		return;
+	}
+
+	size_t nchunks = min(static_cast<size_t>(omp_get_max_threads()), count / MIN_SAMPLES_PER_CHUNK);
+	if(nchunks <= 1)
+	{
+		AddChunk(samples, count, m_bins.data(), m_count, m_min, m_max);
+		return;
+	}
+
+	//Each chunk after the first goes into its own partial histogram, then they're all summed
+	size_t nbins = m_bins.size();
+	size_t chunkSize = (count + nchunks - 1) / nchunks;
+	m_partialBins.resize(nchunks - 1);
+	vector<size_t> binned(nchunks, 0);
+	vector<float> mins(nchunks, FLT_MAX);
+	vector<float> maxes(nchunks, -FLT_MAX);
+
+	#pragma omp parallel for schedule(static, 1)
+	for(size_t i=0; i<nchunks; i++)
+	{
+		size_t* bins = m_bins.data();
+		if(i > 0)
+		{
+			auto& partial = m_partialBins[i-1];
+			partial.resize(nbins);
+			memset(partial.data(), 0, nbins * sizeof(size_t));
+			bins = partial.data();
+		}
+
+		size_t start = min(i * chunkSize, count);
+		size_t end = min(start + chunkSize, count);
+		AddChunk(samples + start, end - start, bins, binned[i], mins[i], maxes[i]);
+	}
+
+	#ifdef __x86_64__
+	if(g_hasAvx2)
+		ReducePartialBinsAVX2();
+	else
+	#endif
+		ReducePartialBins();
+
+	for(size_t i=0; i<nchunks; i++)
+	{
+		m_count += binned[i];
+		if(mins[i] < m_min)
+			m_min = mins[i];
+		if(maxes[i] > m_max)
+			m_max = maxes[i];
+	}
+}
+
+/**
+	@brief Bins one chunk of samples using the best available implementation
+
+	@param samples	The samples
+	@param count	Number of samples
+	@param bins		Bins to add the samples to
+	@param binned	Incremented by the number of samples which were put in a bin
+	@param vmin		Updated with the lowest sample value
+	@param vmax		Updated with the highest sample value
+ */
+void Histogram::AddChunk(const float* samples, size_t count, size_t* bins, size_t& binned, float& vmin, float& vmax)
+{
+	#ifdef __x86_64__
+	if(g_hasAvx2 && (m_bins.size() <= MAX_SIMD_BINS) )
+		AddChunkAVX2(samples, count, bins, binned, vmin, vmax);
+	else
+	#endif
+		AddChunkGeneric(samples, count, bins, binned, vmin, vmax);
+}
+
+void Histogram::AddChunkGeneric(
+	const float* samples,
+	size_t count,
+	size_t* bins,
+	size_t& binned,
+	float& vmin,
+	float& vmax)
+{
+	size_t nbins = m_bins.size();
+	float delta = m_high - m_low;
+
+	if(m_mode == RANGE_CLAMP)
+	{
+		for(size_t i=0; i<count; i++)
+		{
+			float v = samples[i];
+			if(v < vmin)
+				vmin = v;
+			if(v > vmax)
+				vmax = v;
+
+			//Compare in float before converting, since out of range float to int conversions are undefined
+			float fbin = (v - m_low) / delta;
+			float fidx = floor(fbin * nbins);
+			size_t bin;
+			if(fbin < 0)
+				bin = 0;
+			else if(fidx < nbins)
+				bin = min(static_cast<size_t>(fidx), nbins-1);
+			else	//above the range, or NaN
+				bin = nbins-1;
+			bins[bin] ++;
+		}
+		binned += count;
+	}
+
+	else
+	{
+		for(size_t i=0; i<count; i++)
+		{
+			float v = samples[i];
+			if(v < vmin)
+				vmin = v;
+			if(v > vmax)
+				vmax = v;
+
+			//Ordered compares are false for NaN, so those get discarded too
+			float fbin = (v - m_low) / delta;
+			float fidx = floor(fbin * nbins);
+			if( !(fidx >= 0) || !(fidx < nbins) )
+				continue;
+			size_t bin = static_cast<size_t>(fidx);
+			if(bin >= nbins)
+				continue;
+			bins[bin] ++;
+			binned ++;
+		}
+	}
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+void Histogram::AddChunkAVX2(
+	const float* samples,
+	size_t count,
+	size_t* bins,
+	size_t& binned,
+	float& vmin,
+	float& vmax)
+{
+	size_t nbins = m_bins.size();
+	size_t end = count - (count % 8);
+
+	__m256 vlow = _mm256_set1_ps(m_low);
+	__m256 vdelta = _mm256_set1_ps(m_high - m_low);
+	__m256 vnbins = _mm256_set1_ps(nbins);
+	__m256 vlast = _mm256_set1_ps(nbins - 1);
+	__m256 vzero = _mm256_setzero_ps();
+	__m256 vmins = _mm256_set1_ps(vmin);
+	__m256 vmaxes = _mm256_set1_ps(vmax);
+
+	alignas(32) int32_t idx[8];
+
+	size_t i = 0;
+	for(; i<end; i += 8)
+	{
+		__m256 v = _mm256_loadu_ps(samples + i);
+
+		//min/max return the second operand if either is NaN, so NaNs are ignored just like in the scalar loop
+		vmins = _mm256_min_ps(v, vmins);
+		vmaxes = _mm256_max_ps(v, vmaxes);
+
+		__m256 fbin = _mm256_div_ps(_mm256_sub_ps(v, vlow), vdelta);
+		__m256 fidx = _mm256_floor_ps(_mm256_mul_ps(fbin, vnbins));
+
+		if(m_mode == RANGE_CLAMP)
+		{
+			//Negative values go in the first bin, NaN and values above the range in the last one
+			fidx = _mm256_min_ps(fidx, vlast);
+			fidx = _mm256_blendv_ps(fidx, vzero, _mm256_cmp_ps(fbin, vzero, _CMP_LT_OQ));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(idx), _mm256_cvttps_epi32(fidx));
+
+			for(size_t j=0; j<8; j++)
+				bins[idx[j]] ++;
+			binned += 8;
+		}
+
+		else
+		{
+			//Ordered compares are false for NaN, so those get discarded too
+			__m256 valid = _mm256_and_ps(
+				_mm256_cmp_ps(fidx, vzero, _CMP_GE_OQ),
+				_mm256_cmp_ps(fidx, vnbins, _CMP_LT_OQ));
+			unsigned int mask = _mm256_movemask_ps(valid);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(idx), _mm256_cvttps_epi32(fidx));
+
+			while(mask)
+			{
+				bins[idx[__builtin_ctz(mask)]] ++;
+				binned ++;
+				mask &= mask - 1;
+			}
+		}
+	}
+
+	//Reduce the per-lane statistics
+	alignas(32) float lanemin[8];
+	alignas(32) float lanemax[8];
+	_mm256_store_ps(lanemin, vmins);
+	_mm256_store_ps(lanemax, vmaxes);
+	for(size_t j=0; j<8; j++)
+	{
+		if(lanemin[j] < vmin)
+			vmin = lanemin[j];
+		if(lanemax[j] > vmax)
+			vmax = lanemax[j];
+	}
+
+	//Do the last few samples the slow way
+	if(i < count)
+		AddChunkGeneric(samples + i, count - i, bins, binned, vmin, vmax);
+}
+#endif /* __x86_64__ */
+
+/**
+	@brief Sums the partial histograms from a parallel update into the main one
+ */
+void Histogram::ReducePartialBins()
+{
+	size_t nbins = m_bins.size();
+	auto data = m_bins.data();
+	for(auto& partial : m_partialBins)
+	{
+		auto p = partial.data();
+		for(size_t i=0; i<nbins; i++)
+			data[i] += p[i];
+	}
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+void Histogram::ReducePartialBinsAVX2()
+{
+	size_t nbins = m_bins.size();
+	size_t end = nbins - (nbins % 4);
+	auto data = m_bins.data();
+
+	for(auto& partial : m_partialBins)
+	{
+		auto p = partial.data();
+
+		size_t i = 0;
+		for(; i<end; i += 4)
+		{
+			__m256i vdata = _mm256_loadu_si256(reinterpret_cast<__m256i*>(data + i));
+			__m256i vpart = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_add_epi64(vdata, vpart));
+		}
+
+		for(; i<nbins; i++)
+			data[i] += p[i];
+	}
+}
+#endif /* __x86_64__ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Statistics
+
+/**
+	@brief Finds the lowest and highest value in a block of samples, ignoring NaNs
+
+	@param samples	The samples
+	@param count	Number of samples
+	@param vmin		Lowest value (FLT_MAX if there were no samples)
+	@param vmax		Highest value (-FLT_MAX if there were no samples)
+ */
+void Histogram::GetMinMax(const float* samples, size_t count, float& vmin, float& vmax)
+{
+	vmin = FLT_MAX;
+	vmax = -FLT_MAX;
+
+	size_t nchunks = min(static_cast<size_t>(omp_get_max_threads()), count / MIN_SAMPLES_PER_CHUNK);
+	nchunks = max(nchunks, static_cast<size_t>(1));
+	size_t chunkSize = (count + nchunks - 1) / nchunks;
+	vector<float> mins(nchunks, FLT_MAX);
+	vector<float> maxes(nchunks, -FLT_MAX);
+
+	#pragma omp parallel for schedule(static, 1) if(nchunks > 1)
+	for(size_t i=0; i<nchunks; i++)
+	{
+		size_t start = min(i * chunkSize, count);
+		size_t end = min(start + chunkSize, count);
+
+		#ifdef __x86_64__
+		if(g_hasAvx2)
+			GetMinMaxAVX2(samples + start, end - start, mins[i], maxes[i]);
+		else
+		#endif
+			GetMinMaxGeneric(samples + start, end - start, mins[i], maxes[i]);
+	}
+
+	for(size_t i=0; i<nchunks; i++)
+	{
+		if(mins[i] < vmin)
+			vmin = mins[i];
+		if(maxes[i] > vmax)
+			vmax = maxes[i];
+	}
+}
+
+void Histogram::GetMinMaxGeneric(const float* samples, size_t count, float& vmin, float& vmax)
+{
+	for(size_t i=0; i<count; i++)
+	{
+		float v = samples[i];
+		if(v < vmin)
+			vmin = v;
+		if(v > vmax)
+			vmax = v;
+	}
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+void Histogram::GetMinMaxAVX2(const float* samples, size_t count, float& vmin, float& vmax)
+{
+	size_t end = count - (count % 8);
+
+	__m256 vmins = _mm256_set1_ps(vmin);
+	__m256 vmaxes = _mm256_set1_ps(vmax);
+
+	size_t i = 0;
+	for(; i<end; i += 8)
+	{
+		__m256 v = _mm256_loadu_ps(samples + i);
+		vmins = _mm256_min_ps(v, vmins);
+		vmaxes = _mm256_max_ps(v, vmaxes);
+	}
+
+	alignas(32) float lanemin[8];
+	alignas(32) float lanemax[8];
+	_mm256_store_ps(lanemin, vmins);
+	_mm256_store_ps(lanemax, vmaxes);
+	for(size_t j=0; j<8; j++)
+	{
+		if(lanemin[j] < vmin)
+			vmin = lanemin[j];
+		if(lanemax[j] > vmax)
+			vmax = lanemax[j];
+	}
+
+	GetMinMaxGeneric(samples + i, count - i, vmin, vmax);
+}
+#endif /* __x86_64__ */
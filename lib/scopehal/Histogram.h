@@ -0,0 +1,136 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of Histogram
+	@ingroup core
+ */
+
+#ifndef Histogram_h
+#define Histogram_h
+
+/**
+	@brief A histogram of floating point samples with equal width bins
+
+	The bin for a sample v is floor((v - low) / (high - low) * bins), calculated in single precision. Samples outside
+	the range are either clamped into the first or last bin, or discarded.
+
+	Deep inputs are split into chunks which are binned in parallel, each chunk into its own private set of bins, and
+	the partial histograms are summed at the end. Bin indexes are calculated the same way on every code path and
+	integer addition is associative, so the result doesn't depend on the number of threads or the instruction set.
+
+	The minimum and maximum of the input, and the number of samples binned, are collected in the same pass.
+
+	@ingroup core
+ */
+class Histogram
+{
+public:
+
+	///@brief What to do with samples outside the range of the histogram
+	enum RangeMode
+	{
+		///@brief Samples below the range go in the first bin, samples above it in the last bin
+		RANGE_CLAMP,
+
+		///@brief Samples outside the range are discarded
+		RANGE_CLIP
+	};
+
+	Histogram(float low, float high, size_t bins, RangeMode mode = RANGE_CLAMP);
+
+	void Clear();
+	void Add(const float* samples, size_t count);
+
+	///@brief Gets the number of samples in each bin
+	const std::vector<size_t>& GetBins() const
+	{ return m_bins; }
+
+	///@brief Gets the number of samples which were put in a bin (discarded samples are not counted)
+	size_t GetCount() const
+	{ return m_count; }
+
+	///@brief Gets the lowest sample value seen, including discarded samples (FLT_MAX if there were none)
+	float GetMin() const
+	{ return m_min; }
+
+	///@brief Gets the highest sample value seen, including discarded samples (-FLT_MAX if there were none)
+	float GetMax() const
+	{ return m_max; }
+
+	static void GetMinMax(const float* samples, size_t count, float& vmin, float& vmax);
+
+	///@brief Don't bother splitting the input into chunks smaller than this
+	static constexpr size_t MIN_SAMPLES_PER_CHUNK = 256 * 1024;
+
+	///@brief Largest number of bins for which bin indexes can be calculated exactly with SIMD float math
+	static constexpr size_t MAX_SIMD_BINS = 1 << 24;
+
+protected:
+	void AddChunk(const float* samples, size_t count, size_t* bins, size_t& binned, float& vmin, float& vmax);
+	void AddChunkGeneric(const float* samples, size_t count, size_t* bins, size_t& binned, float& vmin, float& vmax);
+	void ReducePartialBins();
+
+	static void GetMinMaxGeneric(const float* samples, size_t count, float& vmin, float& vmax);
+
+#ifdef __x86_64__
+	void AddChunkAVX2(const float* samples, size_t count, size_t* bins, size_t& binned, float& vmin, float& vmax);
+	void ReducePartialBinsAVX2();
+
+	static void GetMinMaxAVX2(const float* samples, size_t count, float& vmin, float& vmax);
+#endif
+
+	///@brief Low end of the range
+	float m_low;
+
+	///@brief High end of the range
+	float m_high;
+
+	///@brief What to do with samples outside the range
+	RangeMode m_mode;
+
+	///@brief Number of samples in each bin
+	std::vector<size_t> m_bins;
+
+	///@brief Bins for all but the first chunk of a parallel update
+	std::vector< std::vector<size_t> > m_partialBins;
+
+	///@brief Number of samples binned so far
+	size_t m_count;
+
+	///@brief Lowest sample value seen so far
+	float m_min;
+
+	///@brief Highest sample value seen so far
+	float m_max;
+};
+
+#endif
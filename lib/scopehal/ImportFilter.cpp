@@ -165,3 +165,79 @@ bool ImportFilter::TryNormalizeTimebase(SparseWaveformBase* wfm)
 	}
 	return true;
 }
+
+/**
+	@brief Converts raw integer samples from a file to analog waveforms
+
+	Each block is converted by the vectorized Oscilloscope::Convert8BitSamples() / Convert16BitSamples() kernels.
+	Blocks are converted in parallel with each other, so files with many segments or channels load quickly. A single
+	block is split across threads by the kernel itself instead.
+
+	All output waveforms are resized, converted, and marked as modified from the CPU.
+
+	@param blocks	The blocks to convert
+ */
+void ImportFilter::ConvertRawSamples(vector<RawSampleBlock>& blocks)
+{
+	//Allocate all of the output buffers up front
+	for(auto& b : blocks)
+	{
+		b.m_wfm->Resize(b.m_count);
+		b.m_wfm->PrepareForCpuAccess();
+	}
+
+	if(blocks.size() == 1)
+		ConvertRawSampleBlock(blocks[0]);
+	else
+	{
+		#pragma omp parallel for schedule(dynamic)
+		for(size_t i=0; i<blocks.size(); i++)
+			ConvertRawSampleBlock(blocks[i]);
+	}
+
+	for(auto& b : blocks)
+		b.m_wfm->MarkModifiedFromCpu();
+}
+
+/**
+	@brief Converts a single block of raw integer samples
+
+	@param block	The block to convert
+ */
+void ImportFilter::ConvertRawSampleBlock(RawSampleBlock& block)
+{
+	auto out = block.m_wfm->m_samples.GetCpuPointer();
+
+	if(!block.m_wide)
+	{
+		Oscilloscope::Convert8BitSamples(
+			out,
+			reinterpret_cast<const int8_t*>(block.m_data),
+			block.m_gain,
+			block.m_offset,
+			block.m_count);
+		return;
+	}
+
+	//16-bit samples can be converted straight from the file if they're aligned and in our byte order
+	if(!block.m_byteswap && ( (reinterpret_cast<uintptr_t>(block.m_data) % alignof(int16_t)) == 0) )
+	{
+		Oscilloscope::Convert16BitSamples(
+			out,
+			reinterpret_cast<const int16_t*>(block.m_data),
+			block.m_gain,
+			block.m_offset,
+			block.m_count);
+		return;
+	}
+
+	//Otherwise, fix them up in a temporary buffer first
+	vector<int16_t> tmp(block.m_count);
+	memcpy(tmp.data(), block.m_data, block.m_count * sizeof(int16_t));
+	if(block.m_byteswap)
+	{
+		for(auto& s : tmp)
+			s = MappedFile::ByteSwap(s);
+	}
+	Oscilloscope::Convert16BitSamples(out, tmp.data(), block.m_gain, block.m_offset, block.m_count);
+}
@@ -63,6 +63,54 @@ protected:
 	std::string m_fpname;
 
 	bool TryNormalizeTimebase(SparseWaveformBase* wfm);
+
+	/**
+		@brief A block of raw integer ADC codes in a file, to be converted to an analog waveform
+	 */
+	class RawSampleBlock
+	{
+	public:
+		RawSampleBlock(
+			UniformAnalogWaveform* wfm,
+			const char* data,
+			size_t count,
+			bool wide,
+			bool byteswap,
+			float gain,
+			float offset)
+			: m_wfm(wfm)
+			, m_data(data)
+			, m_count(count)
+			, m_wide(wide)
+			, m_byteswap(byteswap)
+			, m_gain(gain)
+			, m_offset(offset)
+		{}
+
+		///@brief Waveform to store the converted samples in (resized during conversion)
+		UniformAnalogWaveform* m_wfm;
+
+		///@brief First raw sample (no alignment requirement)
+		const char* m_data;
+
+		///@brief Number of samples
+		size_t m_count;
+
+		///@brief True for int16_t samples, false for int8_t
+		bool m_wide;
+
+		///@brief True if int16_t samples are in the opposite byte order from ours
+		bool m_byteswap;
+
+		///@brief Gain applied to each sample
+		float m_gain;
+
+		///@brief Offset subtracted from each sample after applying the gain
+		float m_offset;
+	};
+
+	void ConvertRawSamples(std::vector<RawSampleBlock>& blocks);
+	void ConvertRawSampleBlock(RawSampleBlock& block);
 };
 
 #endif
@@ -2557,16 +2557,55 @@ vector<WaveformBase*> LeCroyOscilloscope::ProcessAnalogWaveform(
 {
 	vector<WaveformBase*> ret;
 
+	//Raw waveform data
+	size_t num_samples;
+	size_t bytesPerSample;
+	if(m_highDefinition)
+	{
+		num_samples = datalen/2;
+		bytesPerSample = 2;
+	}
+	else
+	{
+		num_samples = datalen;
+		bytesPerSample = 1;
+	}
+	size_t num_per_segment = num_samples / num_sequences;
+	auto udata = reinterpret_cast<const uint8_t*>(data);
+
+	for(size_t j=0; j<num_sequences; j++)
+	{
+		auto cap = SetupAnalogWaveform(wavedesc, j, num_per_segment, ttime, basetime, wavetime);
+		ConvertAnalogSamples(cap, udata + j*num_per_segment*bytesPerSample, 0, num_per_segment, wavedesc);
+		cap->MarkSamplesModifiedFromCpu();
+		ret.push_back(cap);
+	}
+
+	return ret;
+}
+
+/**
+	@brief Allocates a waveform for one segment of an analog capture and fills in its timebase from the WAVEDESC
+
+	@param wavedesc		WAVEDESC block for the channel
+	@param segment		Segment index within a sequence capture (0 if not a sequence capture)
+	@param num_samples	Number of samples in the segment
+	@param ttime		Integer part of the trigger timestamp
+	@param basetime		Fractional part of the trigger timestamp
+	@param wavetime		Per-segment trigger times, or nullptr if not a sequence capture
+ */
+UniformAnalogWaveform* LeCroyOscilloscope::SetupAnalogWaveform(
+	string& wavedesc,
+	size_t segment,
+	size_t num_samples,
+	time_t ttime,
+	double basetime,
+	double* wavetime)
+{
 	//Parse the wavedesc headers
 	auto pdesc = (unsigned char*)(&wavedesc[0]);
 	//uint32_t wavedesc_len = *reinterpret_cast<uint32_t*>(pdesc + 36);
 
-	//cppcheck-suppress invalidPointerCast
-	float v_gain = *reinterpret_cast<float*>(pdesc + 156);
-
-	//cppcheck-suppress invalidPointerCast
-	float v_off = *reinterpret_cast<float*>(pdesc + 160);
-
 	//cppcheck-suppress invalidPointerCast
 	float interval = *reinterpret_cast<float*>(pdesc + 176) * FS_PER_SECOND;
 
@@ -2577,58 +2616,69 @@ vector<WaveformBase*> LeCroyOscilloscope::ProcessAnalogWaveform(
 	if(h_off_frac < 0)
 		h_off_frac = interval + h_off_frac;		//double h_unit = *reinterpret_cast<double*>(pdesc + 244);
 
-	//Raw waveform data
-	size_t num_samples;
-	if(m_highDefinition)
-		num_samples = datalen/2;
+	//Set up the capture we're going to store our data into
+	auto cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(segment)->GetHwname());
+	cap->m_timescale = round(interval);
+	cap->m_triggerPhase = h_off_frac;
+	cap->m_startTimestamp = ttime;
+	cap->PrepareForCpuAccess();
+
+	//Parse the time
+	if(wavetime)
+		cap->m_startFemtoseconds = static_cast<int64_t>( (basetime + wavetime[segment*2]) * FS_PER_SECOND );
 	else
-		num_samples = datalen;
-	size_t num_per_segment = num_samples / num_sequences;
-	const int16_t* wdata = reinterpret_cast<const int16_t*>(data);
-	const int8_t* bdata = reinterpret_cast<const int8_t*>(data);
+		cap->m_startFemtoseconds = static_cast<int64_t>(basetime * FS_PER_SECOND);
 
-	for(size_t j=0; j<num_sequences; j++)
-	{
-		//Set up the capture we're going to store our data into
-		auto cap = AllocateAnalogWaveform(m_nickname + "." + GetChannel(j)->GetHwname());
-		cap->m_timescale = round(interval);
-		cap->m_triggerPhase = h_off_frac;
-		cap->m_startTimestamp = ttime;
-		cap->PrepareForCpuAccess();
+	cap->Resize(num_samples);
+	return cap;
+}
 
-		//Parse the time
-		if(wavetime)
-			cap->m_startFemtoseconds = static_cast<int64_t>( (basetime + wavetime[j*2]) * FS_PER_SECOND );
-		else
-			cap->m_startFemtoseconds = static_cast<int64_t>(basetime * FS_PER_SECOND);
+/**
+	@brief Converts a range of raw ADC samples to volts
 
-		cap->Resize(num_per_segment);
+	Does not mark the samples as modified, so that several ranges of one waveform can be converted in parallel.
+	The caller must call MarkSamplesModifiedFromCpu() once all of them are done.
 
-		//Convert raw ADC samples to volts
-		if(m_highDefinition)
-		{
-			Convert16BitSamples(
-				cap->m_samples.GetCpuPointer(),
-				wdata + j*num_per_segment,
-				v_gain,
-				v_off,
-				num_per_segment);
-		}
-		else
-		{
-			Convert8BitSamples(
-				cap->m_samples.GetCpuPointer(),
-				bdata + j*num_per_segment,
-				v_gain,
-				v_off,
-				num_per_segment);
-		}
+	@param cap			Waveform to store the converted samples in
+	@param data			Raw ADC samples for the segment, starting at sample 0
+	@param start		Index of the first sample to convert
+	@param count		Number of samples to convert
+	@param wavedesc		WAVEDESC block for the channel
+ */
+void LeCroyOscilloscope::ConvertAnalogSamples(
+	UniformAnalogWaveform* cap,
+	const uint8_t* data,
+	size_t start,
+	size_t count,
+	string& wavedesc)
+{
+	auto pdesc = (unsigned char*)(&wavedesc[0]);
 
-		cap->MarkSamplesModifiedFromCpu();
-		ret.push_back(cap);
-	}
+	//cppcheck-suppress invalidPointerCast
+	float v_gain = *reinterpret_cast<float*>(pdesc + 156);
 
-	return ret;
+	//cppcheck-suppress invalidPointerCast
+	float v_off = *reinterpret_cast<float*>(pdesc + 160);
+
+	//Convert raw ADC samples to volts
+	if(m_highDefinition)
+	{
+		Convert16BitSamples(
+			cap->m_samples.GetCpuPointer() + start,
+			reinterpret_cast<const int16_t*>(data) + start,
+			v_gain,
+			v_off,
+			count);
+	}
+	else
+	{
+		Convert8BitSamples(
+			cap->m_samples.GetCpuPointer() + start,
+			reinterpret_cast<const int8_t*>(data) + start,
+			v_gain,
+			v_off,
+			count);
+	}
 }
 
 map<int, SparseDigitalWaveform*> LeCroyOscilloscope::ProcessDigitalWaveform(string& data, int64_t analog_hoff)
@@ -2710,8 +2760,8 @@ map<int, SparseDigitalWaveform*> LeCroyOscilloscope::ProcessDigitalWaveform(stri
 	base64_decode_block(tmp.c_str(), tmp.length(), (char*)block, &bstate);
 
 	//We have each channel's data from start to finish before the next (no interleaving).
-	//TODO: Multithread across waveforms
-	unsigned int icapchan = 0;
+	//Allocate all of the output waveforms up front, then deduplicate the channels in parallel.
+	vector<SparseDigitalWaveform*> caps;
 	for(unsigned int i=0; i<m_digitalChannelCount; i++)
 	{
 		if(enabledChannels[i])
@@ -2728,63 +2778,68 @@ map<int, SparseDigitalWaveform*> LeCroyOscilloscope::ProcessDigitalWaveform(stri
 			//Preallocate memory assuming no deduplication possible
 			cap->Resize(num_samples);
 
-			//Save the first sample (can't merge with sample -1 because that doesn't exist)
-			size_t base = icapchan*num_samples;
-			size_t k = 0;
-			cap->m_offsets[0] = 0;
-			cap->m_durations[0] = 1;
-			cap->m_samples[0] = block[base];
-
-			//Read and de-duplicate the other samples
-			//TODO: can we vectorize this somehow?
-			bool last = block[base];
-			for(size_t j=1; j<num_samples; j++)
-			{
-				bool sample = block[base + j];
+			caps.push_back(cap);
+			ret[m_digitalChannels[i]->GetIndex()] = cap;
+		}
 
-				//Deduplicate consecutive samples with same value
-				//FIXME: temporary workaround for rendering bugs
-				//if(last == sample)
-				if( (last == sample) && ((j+3) < num_samples) )
-					cap->m_durations[k] ++;
+		//No data here for us!
+		else
+			ret[m_digitalChannels[i]->GetIndex()] = NULL;
+	}
 
-				//Nope, it toggled - store the new value
-				else
-				{
-					k++;
-					cap->m_offsets[k] = j;
-					cap->m_durations[k] = 1;
-					cap->m_samples[k] = sample;
-					last = sample;
-				}
+	#pragma omp parallel for
+	for(size_t icapchan=0; icapchan<caps.size(); icapchan++)
+	{
+		auto cap = caps[icapchan];
+
+		//Save the first sample (can't merge with sample -1 because that doesn't exist)
+		size_t base = icapchan*num_samples;
+		size_t k = 0;
+		cap->m_offsets[0] = 0;
+		cap->m_durations[0] = 1;
+		cap->m_samples[0] = block[base];
+
+		//Read and de-duplicate the other samples
+		//TODO: can we vectorize this somehow?
+		bool last = block[base];
+		for(size_t j=1; j<num_samples; j++)
+		{
+			bool sample = block[base + j];
 
+			//Deduplicate consecutive samples with same value
+			//FIXME: temporary workaround for rendering bugs
+			//if(last == sample)
+			if( (last == sample) && ((j+3) < num_samples) )
+				cap->m_durations[k] ++;
+
+			//Nope, it toggled - store the new value
+			else
+			{
+				k++;
+				cap->m_offsets[k] = j;
+				cap->m_durations[k] = 1;
+				cap->m_samples[k] = sample;
+				last = sample;
 			}
 
-			//Done, shrink any unused space
-			cap->Resize(k);
-			cap->m_offsets.shrink_to_fit();
-			cap->m_durations.shrink_to_fit();
-			cap->m_samples.shrink_to_fit();
-			cap->MarkSamplesModifiedFromCpu();
-			cap->MarkTimestampsModifiedFromCpu();
-
-			//See how much space we saved
-			/*
-			LogDebug("%s: %zu samples deduplicated to %zu (%.1f %%)\n",
-				m_digitalChannels[i]->GetDisplayName().c_str(),
-				num_samples,
-				k,
-				(k * 100.0f) / num_samples);
-			*/
-
-			//Done, save data and go on to next
-			ret[m_digitalChannels[i]->GetIndex()] = cap;
-			icapchan ++;
 		}
 
-		//No data here for us!
-		else
-			ret[m_digitalChannels[i]->GetIndex()] = NULL;
+		//Done, shrink any unused space
+		cap->Resize(k);
+		cap->m_offsets.shrink_to_fit();
+		cap->m_durations.shrink_to_fit();
+		cap->m_samples.shrink_to_fit();
+		cap->MarkSamplesModifiedFromCpu();
+		cap->MarkTimestampsModifiedFromCpu();
+
+		//See how much space we saved
+		/*
+		LogDebug("%s: %zu samples deduplicated to %zu (%.1f %%)\n",
+			cap->GetName().c_str(),
+			num_samples,
+			k,
+			(k * 100.0f) / num_samples);
+		*/
 	}
 	delete[] block;
 	return ret;
@@ -2799,12 +2854,29 @@ bool LeCroyOscilloscope::AcquireData()
 	time_t ttime = 0;
 	double basetime = 0;
 	bool denabled = false;
-	map<int, string> analogWaveformData;
 	string wavetime;
 	bool enabled[8] = {false};
 	vector<string> wavedescs;
 	double* pwtime = nullptr;
 	string digitalWaveformData;
+	map<int, SparseDigitalWaveform*> digwaves;
+
+	//Offset from start of waveform to trigger
+	double analog_hoff = 0;
+
+	vector< vector<WaveformBase*> > waveforms;
+	waveforms.resize(m_analogChannelCount);
+
+	//Make sure we have somewhere to put raw sample data.
+	//Use pinned memory so we can download straight into it
+	while(m_analogRawWaveformBuffers.size() < m_analogChannelCount)
+	{
+		m_analogRawWaveformBuffers.push_back(std::make_unique<AcceleratorBuffer<uint8_t> >());
+		m_analogRawWaveformBuffers.back()->SetCpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_LIKELY);
+		m_analogRawWaveformBuffers.back()->SetGpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_NEVER);
+	}
+	if(!m_conversionQueue)
+		m_conversionQueue = make_unique<WaveformConversionQueue>();
 
 	ChannelsDownloadStarted();
 
@@ -2902,16 +2974,75 @@ bool LeCroyOscilloscope::AcquireData()
 				basetime = t - ttime;
 			}
 
-			//Read the data from each analog waveform
+			//Read the data from each analog waveform.
+			//Conversion is done by the worker pool, overlapping with download of the following channels.
 			for(unsigned int i=0; i<m_analogChannelCount; i++)
 			{
-				if(enabled[i])
+				if(!enabled[i])
+					continue;
+
+				//If not a sequence capture, convert each chunk of samples as soon as it arrives
+				//while the rest of the block is still in flight.
+				//(Segments of sequence captures are converted once the whole block is here since we don't know where
+				//the boundaries are until then.)
+				auto& buf = *m_analogRawWaveformBuffers[i];
+				auto& desc = wavedescs[i];
+				UniformAnalogWaveform* cap = nullptr;
+				function<void(size_t, size_t)> chunkDone = nullptr;
+				size_t bytesPerSample = m_highDefinition ? 2 : 1;
+				if(num_sequences == 1)
+				{
+					chunkDone = [&](size_t offset, size_t len)
+					{
+						if(!cap)
+						{
+							cap = SetupAnalogWaveform(desc, 0, buf.size() / bytesPerSample, ttime, basetime, nullptr);
+							waveforms[i].push_back(cap);
+						}
+
+						size_t first = offset / bytesPerSample;
+						size_t count = min(len / bytesPerSample, cap->size() - first);
+						auto pcap = cap;
+						m_conversionQueue->Submit([this, pcap, &buf, &desc, first, count]
+							{ ConvertAnalogSamples(pcap, buf.GetCpuPointer(), first, count, desc); });
+					};
+				}
+
+				//Prefix is "DAT1," followed by the block, then a newline
+				if(!m_transport->ReadBinaryBlock(
+					buf,
+					chunkDone,
+					[i, this] (float progress) { ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); },
+					true))
+				{
+					LogError("Failed to download waveform data for channel %u\n", i);
+
+					//Short read: the waveform was sized for the whole block, trim it to what actually arrived.
+					//Shrinking doesn't reallocate, and conversions already queued only touch received samples.
+					if(cap)
+						cap->Resize(buf.size() / bytesPerSample);
+				}
+				ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
+
+				//Sequence capture (or nothing arrived at all): process the whole block
+				if(!cap)
 				{
-					analogWaveformData[i] = m_transport->ReadReply(
-						false,
-						[i, this] (float progress) { ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); });
-					ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
+					m_conversionQueue->Submit([this, i, &buf, &desc, &waveforms, num_sequences, ttime, basetime, pwtime]
+					{
+						waveforms[i] = ProcessAnalogWaveform(
+							reinterpret_cast<const char*>(buf.GetCpuPointer()),
+							buf.size(),
+							desc,
+							num_sequences,
+							ttime,
+							basetime,
+							pwtime);
+					});
 				}
+
+				//Extract trigger offset of waveform
+				//cppcheck-suppress invalidPointerCast
+				analog_hoff = *reinterpret_cast<double*>(&desc[180]) * FS_PER_SECOND;
 			}
 		}
 
@@ -2921,8 +3052,20 @@ bool LeCroyOscilloscope::AcquireData()
 			if(!ReadWaveformBlock(digitalWaveformData))
 			{
 				LogDebug("failed to download digital waveform\n");
+
+				//Analog waveforms may already have been converted, throw them away
+				m_conversionQueue->Wait();
+				for(auto& v : waveforms)
+				{
+					for(auto w : v)
+						delete w;
+				}
 				return false;
 			}
+
+			//This is a weird XML-y format but I can't find any other way to get it :(
+			m_conversionQueue->Submit([&]
+				{ digwaves = ProcessDigitalWaveform(digitalWaveformData, analog_hoff); });
 		}
 	}
 
@@ -2935,20 +3078,15 @@ bool LeCroyOscilloscope::AcquireData()
 		m_triggerArmed = true;
 	}
 
-	//Offset from start of waveform to trigger
-	double analog_hoff = 0;
+	//Wait for conversions still in progress
+	m_conversionQueue->Wait();
 
 	//Process analog waveforms
-	vector< vector<WaveformBase*> > waveforms;
-	waveforms.resize(m_analogChannelCount);
 	for(unsigned int i=0; i<m_analogChannelCount; i++)
 	{
 		if(enabled[i])
 		{
-			//Extract timestamp of waveform
 			auto pdesc = (unsigned char*)(&wavedescs[i][0]);
-			//cppcheck-suppress invalidPointerCast
-			analog_hoff = *reinterpret_cast<double*>(pdesc + 180) * FS_PER_SECOND;
 
 			///Handle units
 			auto pvunit = reinterpret_cast<const char*>(pdesc + 196);
@@ -2962,14 +3100,12 @@ bool LeCroyOscilloscope::AcquireData()
 				m_channels[i]->SetYAxisUnits(Unit(Unit::UNIT_AMPS), 0);
 			//else unknown unit, ignore for now
 
-			waveforms[i] = ProcessAnalogWaveform(
-				&analogWaveformData[i][16],			//skip 16-byte SCPI header DATA,\n#9xxxxxxxx
-				analogWaveformData[i].size() - 17,	//skip header plus \n at end
-				wavedescs[i],
-				num_sequences,
-				ttime,
-				basetime,
-				pwtime);
+			//Chunks converted in parallel during download aren't marked as modified until all are done
+			if(num_sequences == 1)
+			{
+				for(auto w : waveforms[i])
+					w->MarkSamplesModifiedFromCpu();
+			}
 		}
 	}
 
@@ -2986,15 +3122,8 @@ bool LeCroyOscilloscope::AcquireData()
 
 	//TODO: proper support for sequenced capture when digital channels are active
 	//(seems like this doesn't work right on at least wavesurfer 3000 series)
-	if(denabled)
-	{
-		//This is a weird XML-y format but I can't find any other way to get it :(
-		map<int, SparseDigitalWaveform*> digwaves = ProcessDigitalWaveform(digitalWaveformData, analog_hoff);
-
-		//Done, update the data
-		for(auto it : digwaves)
-			pending_waveforms[it.first].push_back(it.second);
-	}
+	for(auto it : digwaves)
+		pending_waveforms[it.first].push_back(it.second);
 
 	//Now that we have all of the pending waveforms, save them in sets across all channels
 	m_pendingWaveformsMutex.lock();
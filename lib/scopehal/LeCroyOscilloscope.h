@@ -324,6 +324,19 @@ protected:
 		double basetime,
 		double* wavetime
 		);
+	UniformAnalogWaveform* SetupAnalogWaveform(
+		std::string& wavedesc,
+		size_t segment,
+		size_t num_samples,
+		time_t ttime,
+		double basetime,
+		double* wavetime);
+	void ConvertAnalogSamples(
+		UniformAnalogWaveform* cap,
+		const uint8_t* data,
+		size_t start,
+		size_t count,
+		std::string& wavedesc);
 	std::map<int, SparseDigitalWaveform*> ProcessDigitalWaveform(std::string& data, int64_t analog_hoff);
 
 	//hardware analog channel count, independent of LA option etc
@@ -382,6 +395,12 @@ protected:
 	//True if we have >8 bit capture depth
 	bool m_highDefinition;
 
+	///@brief Buffers for raw ADC samples as downloaded from the instrument, before conversion to volts
+	std::vector<std::unique_ptr<AcceleratorBuffer<uint8_t> > > m_analogRawWaveformBuffers;
+
+	///@brief Workers for converting waveforms while later channels are still downloading
+	std::unique_ptr<WaveformConversionQueue> m_conversionQueue;
+
 	///@brief External trigger input
 	OscilloscopeChannel* m_extTrigChannel;
 
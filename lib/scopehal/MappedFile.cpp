@@ -0,0 +1,303 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of MappedFile
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "MappedFile.h"
+#include <charconv>
+#include <omp.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+MappedFile::MappedFile()
+	: m_open(false)
+	, m_data(nullptr)
+	, m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// File access
+
+/**
+	@brief Opens a file and makes its entire content available in memory
+
+	@param path	Path to the file
+
+	@return True on success, false if the file could not be opened
+ */
+bool MappedFile::Open(const string& path)
+{
+	Close();
+
+	//Windows: read the whole file into a buffer
+	#ifdef _WIN32
+		FILE* fp = fopen(path.c_str(), "rb");
+		if(!fp)
+			return false;
+
+		//Use the 64-bit variants, since long is only 32 bits on Windows and captures can exceed 2 GB
+		int64_t end = -1;
+		if(_fseeki64(fp, 0, SEEK_END) == 0)
+			end = _ftelli64(fp);
+		if( (end < 0) || (_fseeki64(fp, 0, SEEK_SET) != 0) )
+		{
+			fclose(fp);
+			return false;
+		}
+		size_t len = end;
+		m_buffer.resize(len);
+		if( (len > 0) && (len != fread(m_buffer.data(), 1, len, fp)) )
+		{
+			fclose(fp);
+			m_buffer.clear();
+			return false;
+		}
+		fclose(fp);
+
+		m_size = len;
+		if(len > 0)
+			m_data = m_buffer.data();
+
+	//On POSIX, just memory map the file
+	#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if(fd < 0)
+			return false;
+
+		off_t end = lseek(fd, 0, SEEK_END);
+		if(end < 0)
+		{
+			::close(fd);
+			return false;
+		}
+
+		size_t len = end;
+		if(len > 0)
+		{
+			void* buf = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(buf == MAP_FAILED)
+			{
+				::close(fd);
+				return false;
+			}
+
+			//Importers read the whole file front to back, so have the kernel start reading ahead right away
+			madvise(buf, len, MADV_SEQUENTIAL);
+			madvise(buf, len, MADV_WILLNEED);
+
+			m_data = static_cast<const char*>(buf);
+			m_size = len;
+		}
+
+		//The mapping stays valid after the descriptor is closed
+		::close(fd);
+	#endif
+
+	m_open = true;
+	return true;
+}
+
+/**
+	@brief Closes the file, invalidating all pointers into it
+ */
+void MappedFile::Close()
+{
+	#ifdef _WIN32
+		m_buffer.clear();
+		m_buffer.shrink_to_fit();
+	#else
+		if(m_data)
+			munmap(const_cast<char*>(m_data), m_size);
+	#endif
+
+	m_open = false;
+	m_data = nullptr;
+	m_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Text helpers
+
+/**
+	@brief Splits part of the file into blocks of whole lines, so they can be parsed in parallel
+
+	@param start		Offset of the first byte to split (normally the start of a line)
+	@param minBlockSize	Smallest block worth handing to a thread
+
+	@return Offsets of the start of each block, followed by the end of the file. Every block except the first begins
+			at the start of a line, and none are empty.
+ */
+vector<size_t> MappedFile::SplitLines(size_t start, size_t minBlockSize)
+{
+	vector<size_t> ret;
+	ret.push_back(start);
+	if(start >= m_size)
+		return ret;
+
+	//Use a few blocks per thread so a block with unusually expensive lines doesn't hold everyone up
+	size_t len = m_size - start;
+	size_t nblocks = min(len / max(minBlockSize, static_cast<size_t>(1)), static_cast<size_t>(4 * omp_get_max_threads()));
+	for(size_t i=1; i<nblocks; i++)
+	{
+		//Move the nominal split point forward to the start of the next line
+		size_t pos = max(start + (i * len) / nblocks, ret.back());
+		auto eol = static_cast<const char*>(memchr(m_data + pos, '\n', m_size - pos));
+		if(!eol)
+			break;
+		pos = (eol - m_data) + 1;
+
+		if( (pos > ret.back()) && (pos < m_size) )
+			ret.push_back(pos);
+	}
+
+	ret.push_back(m_size);
+	return ret;
+}
+
+/**
+	@brief Removes leading and trailing whitespace from a string, like the global Trim()
+ */
+string_view MappedFile::Trim(string_view str)
+{
+	size_t start = 0;
+	while( (start < str.length()) && isspace(static_cast<unsigned char>(str[start])) )
+		start ++;
+
+	size_t end = str.length();
+	while( (end > start) && isspace(static_cast<unsigned char>(str[end-1])) )
+		end --;
+
+	return str.substr(start, end - start);
+}
+
+/**
+	@brief Removes the leading whitespace and plus sign which scanf() accepts but std::from_chars does not
+ */
+static string_view StripNumberPrefix(string_view str)
+{
+	size_t i = 0;
+	while( (i < str.length()) && isspace(static_cast<unsigned char>(str[i])) )
+		i ++;
+	if( (i+1 < str.length()) && (str[i] == '+') && (str[i+1] != '-') && (str[i+1] != '+') )
+		i ++;
+	return str.substr(i);
+}
+
+/**
+	@brief Parses a floating point value at the start of a string, equivalent to sscanf("%f")
+
+	@param str		The string to parse
+	@param value	Parsed value (unchanged if parsing failed)
+
+	@return True if a number was found
+ */
+bool MappedFile::ParseFloat(string_view str, float& value)
+{
+	str = StripNumberPrefix(str);
+
+#ifdef __cpp_lib_to_chars
+	auto result = from_chars(str.data(), str.data() + str.length(), value);
+	if(result.ec == errc())
+		return true;
+#endif
+
+	//Fall back to stdio if the standard library doesn't support floating point from_chars, or for things it rejects
+	//that scanf is fine with (hex floats, and values which under/overflow)
+	string tmp(str);
+	char* end;
+	float f = strtof(tmp.c_str(), &end);
+	if(end == tmp.c_str())
+		return false;
+	value = f;
+	return true;
+}
+
+/**
+	@brief Parses a floating point value at the start of a string, equivalent to sscanf("%lf")
+
+	@param str		The string to parse
+	@param value	Parsed value (unchanged if parsing failed)
+
+	@return True if a number was found
+ */
+bool MappedFile::ParseDouble(string_view str, double& value)
+{
+	str = StripNumberPrefix(str);
+
+#ifdef __cpp_lib_to_chars
+	auto result = from_chars(str.data(), str.data() + str.length(), value);
+	if(result.ec == errc())
+		return true;
+#endif
+
+	string tmp(str);
+	char* end;
+	double d = strtod(tmp.c_str(), &end);
+	if(end == tmp.c_str())
+		return false;
+	value = d;
+	return true;
+}
+
+/**
+	@brief Parses a decimal integer at the start of a string, equivalent to stoll() but without throwing
+
+	@param str		The string to parse
+	@param value	Parsed value (unchanged if parsing failed)
+
+	@return True if a number was found
+ */
+bool MappedFile::ParseInteger(string_view str, int64_t& value)
+{
+	str = StripNumberPrefix(str);
+
+	auto result = from_chars(str.data(), str.data() + str.length(), value);
+	return (result.ec == errc());
+}
@@ -0,0 +1,187 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of MappedFile
+	@ingroup core
+ */
+
+#ifndef MappedFile_h
+#define MappedFile_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+	@brief Read-only view of an entire file in memory, for import filters
+
+	On POSIX systems the file is memory mapped, so huge files can be parsed without copying them first. On Windows the
+	file is read into a buffer up front.
+
+	Binary formats can copy packed header structures out of the file with Read(), which checks that the entire
+	structure is within the file, and fix up their byte order with ByteSwap().
+
+	Also provides helpers for splitting text files into blocks of whole lines which can be parsed in parallel, and
+	locale independent number parsing built on std::from_chars which accepts the same input as the equivalent scanf()
+	format in the C locale.
+
+	@ingroup core
+ */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) =delete;
+	MappedFile& operator=(const MappedFile&) =delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	/**
+		@brief Checks if a file is currently open
+	 */
+	bool IsOpen()
+	{ return m_open; }
+
+	/**
+		@brief Gets a pointer to the start of the file content (may be null if the file is empty)
+	 */
+	const char* GetData()
+	{ return m_data; }
+
+	/**
+		@brief Gets the size of the file, in bytes
+	 */
+	size_t GetSize()
+	{ return m_size; }
+
+	/**
+		@brief Checks if a range of bytes is entirely within the file
+
+		@param offset	Offset of the first byte
+		@param len		Number of bytes
+	 */
+	bool Contains(size_t offset, size_t len)
+	{ return (offset <= m_size) && (len <= (m_size - offset)); }
+
+	/**
+		@brief Copies a structure (normally a packed file header) out of the file
+
+		@param offset	Offset of the structure from the start of the file
+		@param value	The structure to fill in
+
+		@return False if the structure is not entirely within the file
+	 */
+	template<class T>
+	bool Read(size_t offset, T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "MappedFile::Read() needs a trivially copyable type");
+
+		if(!Contains(offset, sizeof(T)))
+			return false;
+		memcpy(&value, m_data + offset, sizeof(T));
+		return true;
+	}
+
+	/**
+		@brief Reverses the byte order of a scalar value
+
+		Takes and returns the value by copy, so it can be used on fields of packed structures.
+	 */
+	template<class T>
+	static T ByteSwap(T value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "MappedFile::ByteSwap() needs a trivially copyable type");
+
+		uint8_t tmp[sizeof(T)];
+		memcpy(tmp, &value, sizeof(T));
+		std::reverse(tmp, tmp + sizeof(T));
+		memcpy(&value, tmp, sizeof(T));
+		return value;
+	}
+
+	std::vector<size_t> SplitLines(size_t start, size_t minBlockSize);
+
+	/**
+		@brief Extracts the next line of text and moves past it
+
+		@param p	Start of the line, updated to point to the start of the following line
+		@param end	End of the buffer
+
+		@return The line, without the trailing newline
+	 */
+	static std::string_view GetLine(const char*& p, const char* end)
+	{
+		auto start = p;
+		auto eol = static_cast<const char*>(memchr(p, '\n', end - p));
+		if(eol)
+		{
+			p = eol + 1;
+			return std::string_view(start, eol - start);
+		}
+
+		p = end;
+		return std::string_view(start, end - start);
+	}
+
+	static std::string_view Trim(std::string_view str);
+
+	static bool ParseFloat(std::string_view str, float& value);
+	static bool ParseDouble(std::string_view str, double& value);
+	static bool ParseInteger(std::string_view str, int64_t& value);
+
+	///@brief Default minimum size of a block returned by SplitLines()
+	static constexpr size_t MIN_BLOCK_SIZE = 1024 * 1024;
+
+protected:
+	///@brief True if a file is open
+	bool m_open;
+
+	///@brief Start of the file content
+	const char* m_data;
+
+	///@brief Size of the file content
+	size_t m_size;
+
+#ifdef _WIN32
+	///@brief Buffer holding the file content
+	std::vector<char> m_buffer;
+#endif
+};
+
+#endif
@@ -902,6 +902,17 @@ bool Oscilloscope::PeekTriggerArmed()
 	return (PollTrigger() == TRIGGER_MODE_RUN);
 }
 
+bool Oscilloscope::IsTriggerActivityWaitSupported()
+{
+	return false;
+}
+
+bool Oscilloscope::WaitForTriggerActivity(std::chrono::microseconds timeout)
+{
+	this_thread::sleep_for(timeout);
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Spectrum analyzer configuration (default no-op for scopes without SA feature)
 
@@ -431,6 +431,30 @@ public:
 	 */
 	virtual bool PeekTriggerArmed();
 
+	/**
+		@brief Checks if WaitForTriggerActivity() can return as soon as the instrument has something to report.
+
+		If this returns false, WaitForTriggerActivity() is just a fixed-length sleep and callers should poll instead.
+	 */
+	virtual bool IsTriggerActivityWaitSupported();
+
+	/**
+		@brief Block until PollTrigger() or AcquireData() may have something new to report, or a timeout elapses.
+
+		This is intended for the acquisition polling loop, so it can wake up as soon as a waveform arrives (for
+		example, when the data socket of a streaming bridge becomes readable) instead of sleeping for a fixed interval.
+
+		Spurious wakeups are allowed; the caller must still check PollTrigger() afterwards. Implementations must not
+		hold the transport mutex while blocking.
+
+		The default implementation sleeps for the full timeout.
+
+		@param timeout	Maximum time to wait
+
+		@return True if there may be new activity, false if the timeout expired
+	 */
+	virtual bool WaitForTriggerActivity(std::chrono::microseconds timeout);
+
 	/**
 		@brief Block until a trigger happens or a timeout elapses.
 
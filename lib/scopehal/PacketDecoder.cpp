@@ -29,6 +29,7 @@
 
 #include "scopehal.h"
 #include "PacketDecoder.h"
+#include <omp.h>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Color schemes
@@ -122,3 +123,15 @@ Packet* PacketDecoder::CreateMergedHeader(Packet* /*pack*/, size_t /*i*/)
 {
 	return NULL;
 }
+
+/**
+	@brief Decides how many chunks to split a capture into for ChunkedDecoder
+
+	@param len	Number of samples in the input
+ */
+size_t PacketDecoder::GetChunkCount(size_t len)
+{
+	return std::max(
+		static_cast<size_t>(1),
+		std::min(static_cast<size_t>(omp_get_max_threads()), len / MIN_SAMPLES_PER_CHUNK));
+}
@@ -126,10 +126,147 @@ public:
 	void DetachPackets()
 	{ m_packets.clear(); }
 
+	static size_t GetChunkCount(size_t len);
+
+	///@brief Minimum number of input samples per chunk when decoding in parallel
+	static constexpr size_t MIN_SAMPLES_PER_CHUNK = 65536;
+
 protected:
 	void ClearPackets();
 
 	std::vector<Packet*> m_packets;
 };
 
+/**
+	@brief Decodes a long capture in parallel chunks, resynchronizing at frame boundaries
+
+	Low speed serial decoders are state machines which have to walk the input from the start. To parallelize them,
+	the input is split into chunks and every chunk after the first is decoded speculatively from an arbitrary starting
+	state. Once the speculative decoder reaches a frame boundary (a "sync point") its state usually matches what the
+	real decoder would have had there.
+
+	The chunks are then stitched together in order. The real decoder state at the end of each chunk is run forward
+	until it's at the same position as one of the sync points recorded by the next chunk, with an identical state.
+	From there on the two decoders are guaranteed to produce the same output, so the speculative output from that
+	point on is appended and the real decoder jumps to the end of the next chunk. If no matching sync point is found
+	the real decoder just keeps going, so the output is always identical to a serial decode.
+
+	The Decoder class must provide:
+	 * State: copyable decoder state with operator==, including the current position
+	 * Output: default constructible output buffer. Anything it owns must be freed by its destructor.
+	 * Mark: a position within an Output
+	 * State Begin(): the initial state for decoding the entire capture
+	 * State Resync(int64_t position): an arbitrary state at the given position, to start a speculative decode
+	 * bool Step(State& s, Output& out): decodes one step, returning false at the end of the input
+	 * int64_t GetPosition(const State& s): current position, strictly increasing with each step
+	 * bool IsSyncPoint(const State& s): true if the state fully determines all future output, and no future step
+	   will modify output from before this point
+	 * Mark GetMark(const Output& out): the current end of an output buffer
+	 * void Append(Output& dst, Output& src, const Mark& from): moves everything in src after from to the end of dst
+
+	All methods must be safe to call from multiple threads on different states and outputs at once.
+ */
+template<class Decoder>
+class ChunkedDecoder
+{
+public:
+	typedef typename Decoder::State State;
+	typedef typename Decoder::Output Output;
+	typedef typename Decoder::Mark Mark;
+
+	///@brief Maximum number of sync points remembered for each chunk
+	static constexpr size_t MAX_SYNC_POINTS = 256;
+
+	/**
+		@brief Decodes a capture
+
+		@param dec			The decoder
+		@param boundaries	Start positions of the second and subsequent chunks, in increasing order
+		@param out			Output buffer, which receives exactly what a serial decode would have produced
+	 */
+	static void Decode(const Decoder& dec, const std::vector<int64_t>& boundaries, Output& out)
+	{
+		size_t nchunks = boundaries.size() + 1;
+
+		//Decode the first chunk for real and the rest speculatively
+		std::vector<Chunk> chunks(nchunks);
+		#pragma omp parallel for schedule(dynamic, 1)
+		for(size_t i=0; i<nchunks; i++)
+		{
+			auto& chunk = chunks[i];
+			Output& cbuf = (i == 0) ? out : chunk.m_out;
+			int64_t end = (i+1 < nchunks) ? boundaries[i] : INT64_MAX;
+
+			State s = (i == 0) ? dec.Begin() : dec.Resync(boundaries[i-1]);
+			chunk.m_done = false;
+			while(dec.GetPosition(s) < end)
+			{
+				if( (i > 0) && (chunk.m_syncs.size() < MAX_SYNC_POINTS) && dec.IsSyncPoint(s) )
+					chunk.m_syncs.push_back(std::pair<State, Mark>(s, dec.GetMark(cbuf)));
+
+				if(!dec.Step(s, cbuf))
+				{
+					chunk.m_done = true;
+					break;
+				}
+			}
+			chunk.m_end = s;
+		}
+
+		//Stitch the chunks together
+		State s = chunks[0].m_end;
+		bool done = chunks[0].m_done;
+		for(size_t i=1; (i < nchunks) && !done; i++)
+		{
+			auto& chunk = chunks[i];
+			int64_t end = (i+1 < nchunks) ? boundaries[i] : INT64_MAX;
+
+			size_t isync = 0;
+			while(!done && (dec.GetPosition(s) < end) )
+			{
+				//Did we catch up with the speculative decode?
+				if(dec.IsSyncPoint(s))
+				{
+					int64_t pos = dec.GetPosition(s);
+					while( (isync < chunk.m_syncs.size()) && (dec.GetPosition(chunk.m_syncs[isync].first) < pos) )
+						isync ++;
+
+					if( (isync < chunk.m_syncs.size()) && (chunk.m_syncs[isync].first == s) )
+					{
+						dec.Append(out, chunk.m_out, chunk.m_syncs[isync].second);
+						s = chunk.m_end;
+						done = chunk.m_done;
+						break;
+					}
+				}
+
+				//Nope, keep going
+				if(!dec.Step(s, out))
+					done = true;
+			}
+		}
+	}
+
+protected:
+
+	/**
+		@brief Working state for one chunk
+	 */
+	class Chunk
+	{
+	public:
+		///@brief Output of the speculative decode (unused for the first chunk)
+		Output m_out;
+
+		///@brief Decoder state after the chunk
+		State m_end;
+
+		///@brief True if the decoder hit the end of the input
+		bool m_done;
+
+		///@brief Sync points seen in the chunk, and how much output had been generated at each
+		std::vector< std::pair<State, Mark> > m_syncs;
+	};
+};
+
 #endif
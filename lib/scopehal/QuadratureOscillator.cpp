@@ -0,0 +1,569 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of QuadratureOscillator
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+#ifdef __x86_64__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
+
+using namespace std;
+
+//Range reduction constants (pi/4 split into three parts, so each multiple of it is exact in float)
+#define SINCOS_DP1		0.78515625f
+#define SINCOS_DP2		2.4187564849853515625e-4f
+#define SINCOS_DP3		3.77489497744594108e-8f
+#define SINCOS_FOPI		1.27323954473516f
+
+//Minimax polynomial coefficients for sin and cos on [-pi/4, pi/4]
+#define SINCOS_S0		-1.9515295891e-4f
+#define SINCOS_S1		8.3321608736e-3f
+#define SINCOS_S2		-1.6666654611e-1f
+#define SINCOS_C0		2.443315711809948e-5f
+#define SINCOS_C1		-1.388731625493765e-3f
+#define SINCOS_C2		4.166664568298827e-2f
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates an oscillator
+
+	@param frequencyHz	Frequency of the oscillator, in Hz
+	@param phase		Phase of the oscillator at t=0, in radians
+ */
+QuadratureOscillator::QuadratureOscillator(double frequencyHz, double phase)
+	: m_radPerFs(2 * M_PI * frequencyHz / FS_PER_SECOND)
+	, m_phase(phase)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+/**
+	@brief Gets the phase of the oscillator at a given time, wrapped to [0, 2*pi)
+ */
+double QuadratureOscillator::ReducePhase(double t)
+{
+	double p = GetPhase(t);
+	return p - 2*M_PI*floor(p / (2*M_PI));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Uniform sampling
+
+/**
+	@brief Generates sin and cos of the oscillator phase for a uniformly sampled waveform
+
+	@param sines		Output sines
+	@param cosines		Output cosines
+	@param n			Number of samples
+	@param timescale	Sample interval, in fs
+	@param triggerPhase	Time of the first sample, in fs
+ */
+void QuadratureOscillator::Generate(float* sines, float* cosines, size_t n, int64_t timescale, int64_t triggerPhase)
+{
+	MixUniform(nullptr, sines, cosines, n, timescale, triggerPhase);
+}
+
+/**
+	@brief Mixes a uniformly sampled waveform with the oscillator
+
+	Sample i of the outputs is in[i] * sin(phase) and in[i] * cos(phase), where phase is the oscillator phase at
+	i*timescale + triggerPhase.
+
+	@param in			Input samples, or nullptr to generate the oscillator output alone
+	@param iout			In-phase output (input times sin)
+	@param qout			Quadrature output (input times cos)
+	@param n			Number of samples
+	@param timescale	Sample interval, in fs
+	@param triggerPhase	Time of the first sample, in fs
+ */
+void QuadratureOscillator::MixUniform(
+	const float* in,
+	float* iout,
+	float* qout,
+	size_t n,
+	int64_t timescale,
+	int64_t triggerPhase)
+{
+	size_t nchunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	#pragma omp parallel for
+	for(size_t i=0; i<nchunks; i++)
+	{
+		size_t start = i*CHUNK_SIZE;
+		size_t count = min(CHUNK_SIZE, n - start);
+		auto pin = in ? (in + start) : nullptr;
+
+		#ifdef __x86_64__
+		if(g_hasAvx512F)
+			MixBlockAVX512F(pin, iout + start, qout + start, start, count, timescale, triggerPhase);
+		else if(g_hasAvx2)
+			MixBlockAVX2(pin, iout + start, qout + start, start, count, timescale, triggerPhase);
+		else
+		#endif
+			MixBlockGeneric(pin, iout + start, qout + start, start, count, timescale, triggerPhase);
+	}
+}
+
+/**
+	@brief Mixes a block of a uniformly sampled waveform with the oscillator
+
+	@param in			Input samples for this block, or nullptr
+	@param iout			In-phase output for this block
+	@param qout			Quadrature output for this block
+	@param istart		Index of the first sample of the block within the waveform
+	@param count		Number of samples in the block
+	@param timescale	Sample interval, in fs
+	@param triggerPhase	Time of the first sample of the waveform, in fs
+ */
+void QuadratureOscillator::MixBlockGeneric(
+	const float* in,
+	float* iout,
+	float* qout,
+	size_t istart,
+	size_t count,
+	int64_t timescale,
+	int64_t triggerPhase)
+{
+	double w = m_radPerFs * timescale;
+	double cw = cos(w);
+	double sw = sin(w);
+
+	for(size_t base=0; base<count; base += RESEED_INTERVAL)
+	{
+		size_t end = min(count, base + RESEED_INTERVAL);
+
+		double p = ReducePhase(static_cast<double>(istart + base) * timescale + triggerPhase);
+		double s = sin(p);
+		double c = cos(p);
+
+		for(size_t i=base; i<end; i++)
+		{
+			float x = in ? in[i] : 1.0f;
+			iout[i] = x * static_cast<float>(s);
+			qout[i] = x * static_cast<float>(c);
+
+			//Rotate the phasor by one sample
+			double ns = s*cw + c*sw;
+			c = c*cw - s*sw;
+			s = ns;
+		}
+	}
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+void QuadratureOscillator::MixBlockAVX2(
+	const float* in,
+	float* iout,
+	float* qout,
+	size_t istart,
+	size_t count,
+	int64_t timescale,
+	int64_t triggerPhase)
+{
+	//Each vector lane is one of 8 consecutive samples, so every iteration rotates by 8 samples
+	double w8 = m_radPerFs * timescale * 8;
+	__m256d vcw = _mm256_set1_pd(cos(w8));
+	__m256d vsw = _mm256_set1_pd(sin(w8));
+
+	for(size_t base=0; base<count; base += RESEED_INTERVAL)
+	{
+		size_t len = min(count - base, RESEED_INTERVAL);
+		size_t vend = base + len - (len % 8);
+
+		//Seed each lane with an exact sin/cos
+		double seeds[8];
+		double seedc[8];
+		for(size_t k=0; k<8; k++)
+		{
+			double p = ReducePhase(static_cast<double>(istart + base + k) * timescale + triggerPhase);
+			seeds[k] = sin(p);
+			seedc[k] = cos(p);
+		}
+		__m256d vs0 = _mm256_loadu_pd(seeds);
+		__m256d vs1 = _mm256_loadu_pd(seeds + 4);
+		__m256d vc0 = _mm256_loadu_pd(seedc);
+		__m256d vc1 = _mm256_loadu_pd(seedc + 4);
+
+		for(size_t i=base; i<vend; i += 8)
+		{
+			__m256 vs = _mm256_set_m128(_mm256_cvtpd_ps(vs1), _mm256_cvtpd_ps(vs0));
+			__m256 vc = _mm256_set_m128(_mm256_cvtpd_ps(vc1), _mm256_cvtpd_ps(vc0));
+			if(in)
+			{
+				__m256 vx = _mm256_loadu_ps(in + i);
+				vs = _mm256_mul_ps(vs, vx);
+				vc = _mm256_mul_ps(vc, vx);
+			}
+			_mm256_storeu_ps(iout + i, vs);
+			_mm256_storeu_ps(qout + i, vc);
+
+			//Rotate the phasors
+			__m256d ns0 = _mm256_add_pd(_mm256_mul_pd(vs0, vcw), _mm256_mul_pd(vc0, vsw));
+			__m256d ns1 = _mm256_add_pd(_mm256_mul_pd(vs1, vcw), _mm256_mul_pd(vc1, vsw));
+			vc0 = _mm256_sub_pd(_mm256_mul_pd(vc0, vcw), _mm256_mul_pd(vs0, vsw));
+			vc1 = _mm256_sub_pd(_mm256_mul_pd(vc1, vcw), _mm256_mul_pd(vs1, vsw));
+			vs0 = ns0;
+			vs1 = ns1;
+		}
+
+		//Last few samples of the block that didn't fit in a vector
+		if(vend < base + len)
+		{
+			MixBlockGeneric(
+				in ? (in + vend) : nullptr,
+				iout + vend,
+				qout + vend,
+				istart + vend,
+				base + len - vend,
+				timescale,
+				triggerPhase);
+		}
+	}
+}
+
+__attribute__((target("avx512f")))
+void QuadratureOscillator::MixBlockAVX512F(
+	const float* in,
+	float* iout,
+	float* qout,
+	size_t istart,
+	size_t count,
+	int64_t timescale,
+	int64_t triggerPhase)
+{
+	//Each vector lane is one of 8 consecutive samples, so every iteration rotates by 8 samples
+	double w8 = m_radPerFs * timescale * 8;
+	__m512d vcw = _mm512_set1_pd(cos(w8));
+	__m512d vsw = _mm512_set1_pd(sin(w8));
+
+	for(size_t base=0; base<count; base += RESEED_INTERVAL)
+	{
+		size_t len = min(count - base, RESEED_INTERVAL);
+		size_t vend = base + len - (len % 8);
+
+		//Seed each lane with an exact sin/cos
+		double seeds[8];
+		double seedc[8];
+		for(size_t k=0; k<8; k++)
+		{
+			double p = ReducePhase(static_cast<double>(istart + base + k) * timescale + triggerPhase);
+			seeds[k] = sin(p);
+			seedc[k] = cos(p);
+		}
+		__m512d vs = _mm512_loadu_pd(seeds);
+		__m512d vc = _mm512_loadu_pd(seedc);
+
+		for(size_t i=base; i<vend; i += 8)
+		{
+			__m256 fs = _mm512_cvtpd_ps(vs);
+			__m256 fc = _mm512_cvtpd_ps(vc);
+			if(in)
+			{
+				__m256 vx = _mm256_loadu_ps(in + i);
+				fs = _mm256_mul_ps(fs, vx);
+				fc = _mm256_mul_ps(fc, vx);
+			}
+			_mm256_storeu_ps(iout + i, fs);
+			_mm256_storeu_ps(qout + i, fc);
+
+			//Rotate the phasors
+			__m512d ns = _mm512_add_pd(_mm512_mul_pd(vs, vcw), _mm512_mul_pd(vc, vsw));
+			vc = _mm512_sub_pd(_mm512_mul_pd(vc, vcw), _mm512_mul_pd(vs, vsw));
+			vs = ns;
+		}
+
+		//Last few samples of the block that didn't fit in a vector
+		if(vend < base + len)
+		{
+			MixBlockGeneric(
+				in ? (in + vend) : nullptr,
+				iout + vend,
+				qout + vend,
+				istart + vend,
+				base + len - vend,
+				timescale,
+				triggerPhase);
+		}
+	}
+}
+#endif /* __x86_64__ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sparse sampling
+
+/**
+	@brief Mixes a sparse waveform with the oscillator
+
+	Sample i of the outputs is in[i] * sin(phase) and in[i] * cos(phase), where phase is the oscillator phase at
+	offsets[i]*timescale + triggerPhase.
+
+	@param in			Input samples
+	@param offsets		Timestamps of the input samples, in units of timescale
+	@param iout			In-phase output (input times sin)
+	@param qout			Quadrature output (input times cos)
+	@param n			Number of samples
+	@param timescale	Timebase units, in fs
+	@param triggerPhase	Offset of all timestamps, in fs
+ */
+void QuadratureOscillator::MixSparse(
+	const float* in,
+	const int64_t* offsets,
+	float* iout,
+	float* qout,
+	size_t n,
+	int64_t timescale,
+	int64_t triggerPhase)
+{
+	size_t nblocks = (n + SPARSE_BLOCK_SIZE - 1) / SPARSE_BLOCK_SIZE;
+
+	#pragma omp parallel for
+	for(size_t i=0; i<nblocks; i++)
+	{
+		size_t start = i*SPARSE_BLOCK_SIZE;
+		size_t count = min(SPARSE_BLOCK_SIZE, n - start);
+
+		//Calculate phases in double precision and wrap them before handing off to the single precision trig
+		float phase[SPARSE_BLOCK_SIZE];
+		for(size_t j=0; j<count; j++)
+			phase[j] = ReducePhase(static_cast<double>(offsets[start + j]) * timescale + triggerPhase);
+
+		SinCos(phase, iout + start, qout + start, count);
+
+		for(size_t j=0; j<count; j++)
+		{
+			iout[start + j] *= in[start + j];
+			qout[start + j] *= in[start + j];
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Vectorized sin/cos
+
+/**
+	@brief Calculates sin and cos of an array of angles
+
+	Uses the same range reduction and polynomials as the Cephes sinf/cosf. Accurate to a few ULPs for |x| < 8192.
+
+	@param x		Input angles, in radians
+	@param sines	Output sines
+	@param cosines	Output cosines
+	@param n		Number of points
+ */
+void QuadratureOscillator::SinCos(const float* x, float* sines, float* cosines, size_t n)
+{
+	#ifdef __x86_64__
+	if(g_hasAvx512F)
+		SinCosAVX512F(x, sines, cosines, n);
+	else if(g_hasAvx2)
+		SinCosAVX2(x, sines, cosines, n);
+	else
+	#endif
+		SinCosGeneric(x, sines, cosines, n);
+}
+
+void QuadratureOscillator::SinCosGeneric(const float* x, float* sines, float* cosines, size_t n)
+{
+	for(size_t i=0; i<n; i++)
+	{
+		float ax = fabs(x[i]);
+
+		//Reduce to an octant
+		int32_t j = static_cast<int32_t>(ax * SINCOS_FOPI);
+		j = (j + 1) & ~1;
+		float y = j;
+		float z = ((ax - y*SINCOS_DP1) - y*SINCOS_DP2) - y*SINCOS_DP3;
+		float zz = z*z;
+
+		//Evaluate both polynomials
+		float ps = ((SINCOS_S0*zz + SINCOS_S1)*zz + SINCOS_S2)*zz*z + z;
+		float pc = ((SINCOS_C0*zz + SINCOS_C1)*zz + SINCOS_C2)*zz*zz - 0.5f*zz + 1.0f;
+
+		//Pick the right polynomial and sign for each output
+		bool swap = (j & 2) != 0;
+		float s = swap ? pc : ps;
+		float c = swap ? ps : pc;
+		if( ((j & 4) != 0) != (x[i] < 0) )
+			s = -s;
+		if( (j + 2) & 4)
+			c = -c;
+
+		sines[i] = s;
+		cosines[i] = c;
+	}
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+void QuadratureOscillator::SinCosAVX2(const float* x, float* sines, float* cosines, size_t n)
+{
+	__m256 vsignmask	= _mm256_set1_ps(-0.0f);
+	__m256 vfopi		= _mm256_set1_ps(SINCOS_FOPI);
+	__m256 vdp1			= _mm256_set1_ps(SINCOS_DP1);
+	__m256 vdp2			= _mm256_set1_ps(SINCOS_DP2);
+	__m256 vdp3			= _mm256_set1_ps(SINCOS_DP3);
+	__m256 vs0			= _mm256_set1_ps(SINCOS_S0);
+	__m256 vs1			= _mm256_set1_ps(SINCOS_S1);
+	__m256 vs2			= _mm256_set1_ps(SINCOS_S2);
+	__m256 vc0			= _mm256_set1_ps(SINCOS_C0);
+	__m256 vc1			= _mm256_set1_ps(SINCOS_C1);
+	__m256 vc2			= _mm256_set1_ps(SINCOS_C2);
+	__m256 vhalf		= _mm256_set1_ps(0.5f);
+	__m256 vone			= _mm256_set1_ps(1.0f);
+	__m256i vione		= _mm256_set1_epi32(1);
+	__m256i vitwo		= _mm256_set1_epi32(2);
+	__m256i vifour		= _mm256_set1_epi32(4);
+	__m256i vizero		= _mm256_setzero_si256();
+
+	size_t end = n - (n % 8);
+	size_t i = 0;
+	for(; i<end; i += 8)
+	{
+		__m256 vx = _mm256_loadu_ps(x + i);
+		__m256 vxsign = _mm256_and_ps(vx, vsignmask);
+		__m256 vax = _mm256_andnot_ps(vsignmask, vx);
+
+		//Reduce to an octant
+		__m256i vj = _mm256_cvttps_epi32(_mm256_mul_ps(vax, vfopi));
+		vj = _mm256_andnot_si256(vione, _mm256_add_epi32(vj, vione));
+		__m256 vy = _mm256_cvtepi32_ps(vj);
+		__m256 vz = _mm256_sub_ps(vax, _mm256_mul_ps(vy, vdp1));
+		vz = _mm256_sub_ps(vz, _mm256_mul_ps(vy, vdp2));
+		vz = _mm256_sub_ps(vz, _mm256_mul_ps(vy, vdp3));
+		__m256 vzz = _mm256_mul_ps(vz, vz);
+
+		//Evaluate both polynomials
+		__m256 vps = _mm256_add_ps(_mm256_mul_ps(vs0, vzz), vs1);
+		vps = _mm256_add_ps(_mm256_mul_ps(vps, vzz), vs2);
+		vps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(vps, vzz), vz), vz);
+
+		__m256 vpc = _mm256_add_ps(_mm256_mul_ps(vc0, vzz), vc1);
+		vpc = _mm256_add_ps(_mm256_mul_ps(vpc, vzz), vc2);
+		vpc = _mm256_mul_ps(_mm256_mul_ps(vpc, vzz), vzz);
+		vpc = _mm256_add_ps(_mm256_sub_ps(vpc, _mm256_mul_ps(vhalf, vzz)), vone);
+
+		//Pick the right polynomial for each output
+		__m256 vswap = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_and_si256(vj, vitwo), vizero));
+		__m256 vs = _mm256_blendv_ps(vps, vpc, vswap);
+		__m256 vc = _mm256_blendv_ps(vpc, vps, vswap);
+
+		//and fix up the signs
+		__m256 vssign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(vj, vifour), 29));
+		vssign = _mm256_xor_ps(vssign, vxsign);
+		__m256 vcsign = _mm256_castsi256_ps(
+			_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(vj, vitwo), vifour), 29));
+
+		_mm256_storeu_ps(sines + i, _mm256_xor_ps(vs, vssign));
+		_mm256_storeu_ps(cosines + i, _mm256_xor_ps(vc, vcsign));
+	}
+
+	if(i < n)
+		SinCosGeneric(x + i, sines + i, cosines + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+void QuadratureOscillator::SinCosAVX512F(const float* x, float* sines, float* cosines, size_t n)
+{
+	__m512i vsignmask	= _mm512_set1_epi32(0x80000000);
+	__m512 vfopi		= _mm512_set1_ps(SINCOS_FOPI);
+	__m512 vdp1			= _mm512_set1_ps(SINCOS_DP1);
+	__m512 vdp2			= _mm512_set1_ps(SINCOS_DP2);
+	__m512 vdp3			= _mm512_set1_ps(SINCOS_DP3);
+	__m512 vs0			= _mm512_set1_ps(SINCOS_S0);
+	__m512 vs1			= _mm512_set1_ps(SINCOS_S1);
+	__m512 vs2			= _mm512_set1_ps(SINCOS_S2);
+	__m512 vc0			= _mm512_set1_ps(SINCOS_C0);
+	__m512 vc1			= _mm512_set1_ps(SINCOS_C1);
+	__m512 vc2			= _mm512_set1_ps(SINCOS_C2);
+	__m512 vhalf		= _mm512_set1_ps(0.5f);
+	__m512 vone			= _mm512_set1_ps(1.0f);
+	__m512i vione		= _mm512_set1_epi32(1);
+	__m512i vitwo		= _mm512_set1_epi32(2);
+	__m512i vifour		= _mm512_set1_epi32(4);
+
+	size_t end = n - (n % 16);
+	size_t i = 0;
+	for(; i<end; i += 16)
+	{
+		__m512i vxi = _mm512_castps_si512(_mm512_loadu_ps(x + i));
+		__m512i vxsign = _mm512_and_si512(vxi, vsignmask);
+		__m512 vax = _mm512_castsi512_ps(_mm512_andnot_si512(vsignmask, vxi));
+
+		//Reduce to an octant
+		__m512i vj = _mm512_cvttps_epi32(_mm512_mul_ps(vax, vfopi));
+		vj = _mm512_andnot_si512(vione, _mm512_add_epi32(vj, vione));
+		__m512 vy = _mm512_cvtepi32_ps(vj);
+		__m512 vz = _mm512_sub_ps(vax, _mm512_mul_ps(vy, vdp1));
+		vz = _mm512_sub_ps(vz, _mm512_mul_ps(vy, vdp2));
+		vz = _mm512_sub_ps(vz, _mm512_mul_ps(vy, vdp3));
+		__m512 vzz = _mm512_mul_ps(vz, vz);
+
+		//Evaluate both polynomials
+		__m512 vps = _mm512_add_ps(_mm512_mul_ps(vs0, vzz), vs1);
+		vps = _mm512_add_ps(_mm512_mul_ps(vps, vzz), vs2);
+		vps = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(vps, vzz), vz), vz);
+
+		__m512 vpc = _mm512_add_ps(_mm512_mul_ps(vc0, vzz), vc1);
+		vpc = _mm512_add_ps(_mm512_mul_ps(vpc, vzz), vc2);
+		vpc = _mm512_mul_ps(_mm512_mul_ps(vpc, vzz), vzz);
+		vpc = _mm512_add_ps(_mm512_sub_ps(vpc, _mm512_mul_ps(vhalf, vzz)), vone);
+
+		//Pick the right polynomial for each output
+		__mmask16 swap = _mm512_test_epi32_mask(vj, vitwo);
+		__m512 vs = _mm512_mask_blend_ps(swap, vps, vpc);
+		__m512 vc = _mm512_mask_blend_ps(swap, vpc, vps);
+
+		//and fix up the signs
+		__m512i vssign = _mm512_slli_epi32(_mm512_and_si512(vj, vifour), 29);
+		vssign = _mm512_xor_si512(vssign, vxsign);
+		__m512i vcsign = _mm512_slli_epi32(_mm512_and_si512(_mm512_add_epi32(vj, vitwo), vifour), 29);
+
+		_mm512_storeu_ps(sines + i, _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(vs), vssign)));
+		_mm512_storeu_ps(cosines + i, _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(vc), vcsign)));
+	}
+
+	if(i < n)
+		SinCosGeneric(x + i, sines + i, cosines + i, n - i);
+}
+#endif /* __x86_64__ */
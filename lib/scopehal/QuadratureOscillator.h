@@ -0,0 +1,139 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of QuadratureOscillator
+	@ingroup core
+ */
+
+#ifndef QuadratureOscillator_h
+#define QuadratureOscillator_h
+
+/**
+	@brief A numerically controlled oscillator producing sin and cos of a fixed frequency, optionally mixed with a signal
+
+	The phase of the oscillator at time t (in femtoseconds from the start of the waveform) is phase + 2*pi*f*t, so the
+	output is continuous across calls and doesn't depend on how the work is split up between threads.
+
+	Uniformly sampled outputs are generated by rotating a complex phasor in double precision, which needs only a few
+	multiplies per sample. To keep rounding errors from accumulating, the phasor is reseeded with an exact sin/cos
+	every RESEED_INTERVAL samples. Each thread works on whole reseed intervals, so results are identical no matter how
+	many threads are used.
+
+	Sparse outputs don't have a constant phase step, so the phase of each sample is calculated from its timestamp and
+	fed to the vectorized polynomial sin/cos.
+
+	@ingroup core
+ */
+class QuadratureOscillator
+{
+public:
+	QuadratureOscillator(double frequencyHz, double phase = 0);
+
+	void Generate(float* sines, float* cosines, size_t n, int64_t timescale, int64_t triggerPhase);
+
+	void MixUniform(
+		const float* in,
+		float* iout,
+		float* qout,
+		size_t n,
+		int64_t timescale,
+		int64_t triggerPhase);
+
+	void MixSparse(
+		const float* in,
+		const int64_t* offsets,
+		float* iout,
+		float* qout,
+		size_t n,
+		int64_t timescale,
+		int64_t triggerPhase);
+
+	///@brief Gets the phase of the oscillator, in radians, at a given time (in fs)
+	double GetPhase(double t)
+	{ return m_phase + m_radPerFs * t; }
+
+	static void SinCos(const float* x, float* sines, float* cosines, size_t n);
+
+	///@brief Number of samples between reseeds of the phasor
+	static constexpr size_t RESEED_INTERVAL = 1024;
+
+	///@brief Number of samples processed by each thread at a time (must be a multiple of RESEED_INTERVAL)
+	static constexpr size_t CHUNK_SIZE = 65536;
+
+	///@brief Number of sparse samples whose phases are calculated at a time
+	static constexpr size_t SPARSE_BLOCK_SIZE = 256;
+
+protected:
+	double ReducePhase(double t);
+
+	void MixBlockGeneric(
+		const float* in,
+		float* iout,
+		float* qout,
+		size_t istart,
+		size_t count,
+		int64_t timescale,
+		int64_t triggerPhase);
+
+	static void SinCosGeneric(const float* x, float* sines, float* cosines, size_t n);
+
+#ifdef __x86_64__
+	void MixBlockAVX2(
+		const float* in,
+		float* iout,
+		float* qout,
+		size_t istart,
+		size_t count,
+		int64_t timescale,
+		int64_t triggerPhase);
+
+	void MixBlockAVX512F(
+		const float* in,
+		float* iout,
+		float* qout,
+		size_t istart,
+		size_t count,
+		int64_t timescale,
+		int64_t triggerPhase);
+
+	static void SinCosAVX2(const float* x, float* sines, float* cosines, size_t n);
+	static void SinCosAVX512F(const float* x, float* sines, float* cosines, size_t n);
+#endif
+
+	///@brief Phase velocity of the oscillator, in radians per femtosecond
+	double m_radPerFs;
+
+	///@brief Phase of the oscillator at t=0, in radians
+	double m_phase;
+};
+
+#endif
@@ -196,6 +196,19 @@ bool RemoteBridgeOscilloscope::IsTriggerArmed()
 	return m_triggerArmed;
 }
 
+/**
+	@brief Bridges push waveforms over the data socket as soon as they're acquired, so we can wait for it to be readable
+ */
+bool RemoteBridgeOscilloscope::IsTriggerActivityWaitSupported()
+{
+	return m_transport->IsRawDataWaitSupported();
+}
+
+bool RemoteBridgeOscilloscope::WaitForTriggerActivity(std::chrono::microseconds timeout)
+{
+	return m_transport->WaitForRawData(timeout);
+}
+
 //
 
 bool RemoteBridgeOscilloscope::IsChannelEnabled(size_t i)
@@ -65,6 +65,8 @@ public:
 	virtual void PullTrigger() override;
 	virtual bool IsTriggerArmed() override;
 	virtual bool PeekTriggerArmed() override;
+	virtual bool IsTriggerActivityWaitSupported() override;
+	virtual bool WaitForTriggerActivity(std::chrono::microseconds timeout) override;
 
 	// Timebase
 	virtual void SetTriggerOffset(int64_t offset) override;
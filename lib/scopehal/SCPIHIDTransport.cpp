@@ -117,6 +117,8 @@ string SCPIHIDTransport::ReadReply(
 	[[maybe_unused]] bool endOnSemicolon,
 	[[maybe_unused]] function<void(float)> progress)
 {	// Max HID report size is 1024 byte according to literature
+	TraceSpan span("ReadReply", "scpi");
+
 	unsigned char buffer[1025];
 	string ret;
 	if(m_hid.Read((unsigned char*)&buffer, 1024)>=0)
@@ -149,6 +151,8 @@ size_t SCPIHIDTransport::ReadRawData(
 	unsigned char* buf,
 	[[maybe_unused]] function<void(float)> progress)
 {
+	TraceSpan span("ReadRawData", "scpi");
+
 	int result = m_hid.Read(buf, len);
 	if(result < 0)
 	{
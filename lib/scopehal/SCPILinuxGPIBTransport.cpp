@@ -120,6 +120,8 @@ bool SCPILinuxGPIBTransport::SendCommand(const string& cmd)
 
 string SCPILinuxGPIBTransport::ReadReply(bool endOnSemicolon, [[maybe_unused]] function<void(float)> progress)
 {
+	TraceSpan span("ReadReply", "scpi");
+
 	string ret;
 	if (!IsConnected())
 		return ret;
@@ -148,6 +150,8 @@ void SCPILinuxGPIBTransport::SendRawData(size_t len, const unsigned char* buf)
 
 size_t SCPILinuxGPIBTransport::ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> /*progress*/)
 {
+	TraceSpan span("ReadRawData", "scpi");
+
 	if (!IsConnected())
 		return 0;
 
@@ -0,0 +1,503 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of SCPIReplayTransport
+	@ingroup transports
+ */
+
+#include "scopehal.h"
+#include <thread>
+
+using namespace std;
+
+///@brief Magic number at the start of a recording
+static const char g_replayMagic[8] = {'S', 'C', 'P', 'I', 'R', 'E', 'C', '3'};
+
+///@brief Header flag indicating the recorded transport supports command batching
+#define REPLAY_FLAG_BATCHING 1
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SCPIReplayTransport::SCPIReplayTransport(const string& args)
+	: m_args(args)
+	, m_fp(nullptr)
+	, m_startTime(GetTime())
+	, m_pendingReadTime(0)
+	, m_batchingSupported(false)
+	, m_writeIndex(0)
+	, m_readIndex(0)
+	, m_readOffset(0)
+	, m_mismatches(0)
+	, m_bandwidth(0)
+	, m_latency(0)
+	, m_linkReady(0)
+	, m_latencyPending(false)
+	, m_recordedTiming(false)
+	, m_refRecordedTime(0)
+	, m_refReplayTime(0)
+{
+	auto fields = explode(args, ';');
+	if(fields.size() < 2)
+	{
+		LogError("SCPIReplayTransport: invalid connection string \"%s\"\n", args.c_str());
+		return;
+	}
+	m_fname = fields[1];
+
+	if(fields[0] == "record")
+	{
+		if(fields.size() < 3)
+		{
+			LogError("SCPIReplayTransport: record mode needs a transport to record from\n");
+			return;
+		}
+
+		//Everything after the transport name is passed through untouched
+		string innerArgs;
+		size_t pos = args.find(';', args.find(';', args.find(';') + 1) + 1);
+		if(pos != string::npos)
+			innerArgs = args.substr(pos + 1);
+
+		//Connect to the real instrument
+		m_inner.reset(SCPITransport::CreateTransport(fields[2], innerArgs));
+		if(!m_inner || !m_inner->IsConnected())
+		{
+			LogError("SCPIReplayTransport: failed to connect to instrument for recording\n");
+			m_inner = nullptr;
+			return;
+		}
+		m_batchingSupported = m_inner->IsCommandBatchingSupported();
+
+		m_fp = fopen(m_fname.c_str(), "wb");
+		if(!m_fp)
+		{
+			LogError("SCPIReplayTransport: failed to create %s\n", m_fname.c_str());
+			m_inner = nullptr;
+			return;
+		}
+
+		//Write the file header
+		uint32_t flags = m_batchingSupported ? REPLAY_FLAG_BATCHING : 0;
+		fwrite(g_replayMagic, sizeof(g_replayMagic), 1, m_fp);
+		fwrite(&flags, sizeof(flags), 1, m_fp);
+	}
+
+	else if(fields[0] == "replay")
+	{
+		if( (fields.size() >= 3) && (fields[2] == "recorded") )
+			m_recordedTiming = true;
+		else
+		{
+			if(fields.size() >= 3)
+				m_bandwidth = stod(fields[2]);
+			if(fields.size() >= 4)
+				m_latency = stod(fields[3]);
+		}
+
+		if(!LoadRecording())
+		{
+			m_writes.clear();
+			m_reads.clear();
+		}
+	}
+
+	else
+		LogError("SCPIReplayTransport: unknown mode \"%s\"\n", fields[0].c_str());
+}
+
+SCPIReplayTransport::~SCPIReplayTransport()
+{
+	if(m_fp)
+	{
+		FlushRawRead();
+		fclose(m_fp);
+	}
+}
+
+bool SCPIReplayTransport::IsConnected()
+{
+	if(m_inner)
+		return (m_fp != nullptr);
+	return !m_reads.empty() || !m_writes.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// File I/O
+
+/**
+	@brief Appends one entry to the recording
+
+	Entries are stored as a one byte type, an eight byte timestamp, an eight byte length, then the data.
+
+	Any raw read data still waiting to be merged is written out first, so records stay in the order they happened.
+ */
+void SCPIReplayTransport::WriteRecord(RecordType type, double timestamp, const void* data, size_t len)
+{
+	if(!m_fp)
+		return;
+
+	if(type != RECORD_RAW_READ)
+		FlushRawRead();
+
+	uint8_t t = type;
+	uint64_t len64 = len;
+	fwrite(&t, sizeof(t), 1, m_fp);
+	fwrite(&timestamp, sizeof(timestamp), 1, m_fp);
+	fwrite(&len64, sizeof(len64), 1, m_fp);
+	if(len)
+		fwrite(data, 1, len, m_fp);
+}
+
+/**
+	@brief Adds raw read data to the recording, merging it with any raw reads immediately before it
+
+	Block headers are read a byte at a time, and large payloads in chunks, so without merging a single waveform
+	download would produce many records.
+ */
+void SCPIReplayTransport::RecordRawRead(const void* data, size_t len)
+{
+	m_pendingRead.append(reinterpret_cast<const char*>(data), len);
+	m_pendingReadTime = GetTime() - m_startTime;
+}
+
+/**
+	@brief Writes out any raw read data waiting to be merged
+ */
+void SCPIReplayTransport::FlushRawRead()
+{
+	if(m_pendingRead.empty())
+		return;
+
+	WriteRecord(RECORD_RAW_READ, m_pendingReadTime, m_pendingRead.data(), m_pendingRead.length());
+	m_pendingRead.clear();
+}
+
+/**
+	@brief Loads a recording into memory for playback
+ */
+bool SCPIReplayTransport::LoadRecording()
+{
+	FILE* fp = fopen(m_fname.c_str(), "rb");
+	if(!fp)
+	{
+		LogError("SCPIReplayTransport: failed to open %s\n", m_fname.c_str());
+		return false;
+	}
+
+	//Check the header
+	char magic[sizeof(g_replayMagic)];
+	uint32_t flags;
+	if( (1 != fread(magic, sizeof(magic), 1, fp)) ||
+		(1 != fread(&flags, sizeof(flags), 1, fp)) ||
+		(0 != memcmp(magic, g_replayMagic, sizeof(magic))) )
+	{
+		LogError("SCPIReplayTransport: %s is not a valid recording\n", m_fname.c_str());
+		fclose(fp);
+		return false;
+	}
+	m_batchingSupported = (flags & REPLAY_FLAG_BATCHING) != 0;
+
+	//Read records until we hit the end of the file
+	while(true)
+	{
+		uint8_t t;
+		Record rec;
+		uint64_t len;
+		if(1 != fread(&t, sizeof(t), 1, fp))
+			break;
+		if( (1 != fread(&rec.m_timestamp, sizeof(rec.m_timestamp), 1, fp)) ||
+			(1 != fread(&len, sizeof(len), 1, fp)) ||
+			(t > RECORD_RAW_READ) )
+		{
+			LogError("SCPIReplayTransport: %s is truncated or corrupted\n", m_fname.c_str());
+			fclose(fp);
+			return false;
+		}
+		rec.m_type = static_cast<RecordType>(t);
+
+		rec.m_data.resize(len);
+		if(len && (len != fread(&rec.m_data[0], 1, len, fp)))
+		{
+			LogError("SCPIReplayTransport: %s is truncated\n", m_fname.c_str());
+			fclose(fp);
+			return false;
+		}
+
+		if( (rec.m_type == RECORD_COMMAND) || (rec.m_type == RECORD_RAW_SEND) )
+			m_writes.push_back(std::move(rec));
+		else
+			m_reads.push_back(std::move(rec));
+	}
+
+	fclose(fp);
+
+	LogDebug("SCPIReplayTransport: loaded %zu writes and %zu reads from %s\n",
+		m_writes.size(), m_reads.size(), m_fname.c_str());
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Link modeling
+
+/**
+	@brief Blocks for as long as the link would take to deliver len more bytes of a recorded response
+
+	When replaying with recorded timing, the response is spread evenly over the time between the previous command or
+	response and its own timestamp in the recording.
+
+	Otherwise, the modeled link is used and latency is added to the first read after each command, since that is when
+	the instrument would have to turn the link around.
+
+	@param rec			The response being served
+	@param offset		Offset within the response of the bytes being delivered
+	@param len			Number of bytes being delivered
+ */
+void SCPIReplayTransport::ModelLinkDelay(const Record& rec, size_t offset, size_t len)
+{
+	bool newMessage = m_latencyPending;
+	m_latencyPending = false;
+
+	if(m_recordedTiming)
+	{
+		double span = max(0.0, rec.m_timestamp - m_refRecordedTime);
+		double target = m_refReplayTime + span * (offset + len) / max(rec.m_data.length(), (size_t)1);
+
+		double dt = target - GetTime();
+		if(dt > 0)
+			this_thread::sleep_for(chrono::duration<double>(dt));
+
+		//The next response is timed from the end of this one
+		if(offset + len >= rec.m_data.length())
+		{
+			m_refRecordedTime = rec.m_timestamp;
+			m_refReplayTime = GetTime();
+		}
+		return;
+	}
+
+	if( (m_bandwidth <= 0) && (m_latency <= 0) )
+		return;
+
+	double now = GetTime();
+	if(m_linkReady < now)
+		m_linkReady = now;
+	if(newMessage)
+		m_linkReady += m_latency;
+	if(m_bandwidth > 0)
+		m_linkReady += len / m_bandwidth;
+
+	double dt = m_linkReady - now;
+	if(dt > 0)
+		this_thread::sleep_for(chrono::duration<double>(dt));
+}
+
+/**
+	@brief Starts timing the next response from a command being sent now
+
+	@param writeIndex	Index in m_writes of the command being sent
+ */
+void SCPIReplayTransport::SetReplayReference(size_t writeIndex)
+{
+	if(writeIndex < m_writes.size())
+		m_refRecordedTime = m_writes[writeIndex].m_timestamp;
+	m_refReplayTime = GetTime();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual transport code
+
+string SCPIReplayTransport::GetTransportName()
+{
+	return "replay";
+}
+
+string SCPIReplayTransport::GetConnectionString()
+{
+	return m_args;
+}
+
+bool SCPIReplayTransport::IsCommandBatchingSupported()
+{
+	return m_batchingSupported;
+}
+
+void SCPIReplayTransport::FlushRXBuffer()
+{
+	if(m_inner)
+		m_inner->FlushRXBuffer();
+}
+
+bool SCPIReplayTransport::SendCommand(const string& cmd)
+{
+	if(m_inner)
+	{
+		WriteRecord(RECORD_COMMAND, GetTime() - m_startTime, cmd.c_str(), cmd.length());
+		return m_inner->SendCommand(cmd);
+	}
+
+	m_latencyPending = true;
+	SetReplayReference(m_writeIndex);
+
+	//Make sure the driver is still doing what it did when we recorded
+	if(m_writeIndex >= m_writes.size())
+	{
+		LogWarning("SCPIReplayTransport: sent \"%s\" after end of recording\n", cmd.c_str());
+		m_mismatches ++;
+		return true;
+	}
+	auto& rec = m_writes[m_writeIndex++];
+	if( (rec.m_type != RECORD_COMMAND) || (rec.m_data != cmd) )
+	{
+		LogWarning("SCPIReplayTransport: sent \"%s\", recording has \"%s\"\n", cmd.c_str(), rec.m_data.c_str());
+		m_mismatches ++;
+	}
+	return true;
+}
+
+void SCPIReplayTransport::SendRawData(size_t len, const unsigned char* buf)
+{
+	if(m_inner)
+	{
+		WriteRecord(RECORD_RAW_SEND, GetTime() - m_startTime, buf, len);
+		m_inner->SendRawData(len, buf);
+		return;
+	}
+
+	m_latencyPending = true;
+	SetReplayReference(m_writeIndex);
+
+	if(m_writeIndex >= m_writes.size())
+	{
+		LogWarning("SCPIReplayTransport: sent %zu bytes of raw data after end of recording\n", len);
+		m_mismatches ++;
+		return;
+	}
+	auto& rec = m_writes[m_writeIndex++];
+	if( (rec.m_type != RECORD_RAW_SEND) || (rec.m_data.length() != len) || (0 != memcmp(rec.m_data.data(), buf, len)) )
+	{
+		LogWarning("SCPIReplayTransport: raw data sent does not match recording\n");
+		m_mismatches ++;
+	}
+}
+
+string SCPIReplayTransport::ReadReply(bool endOnSemicolon, function<void(float)> progress)
+{
+	if(m_inner)
+	{
+		auto ret = m_inner->ReadReply(endOnSemicolon, progress);
+		WriteRecord(RECORD_REPLY, GetTime() - m_startTime, ret.c_str(), ret.length());
+		return ret;
+	}
+
+	if(m_readIndex >= m_reads.size())
+	{
+		LogWarning("SCPIReplayTransport: read reply after end of recording\n");
+		return "";
+	}
+
+	//Serve whatever is left of the current response
+	auto& rec = m_reads[m_readIndex];
+	if(rec.m_type != RECORD_REPLY)
+		LogWarning("SCPIReplayTransport: read reply, but recording has raw data\n");
+
+	string ret = rec.m_data.substr(m_readOffset);
+	ModelLinkDelay(rec, m_readOffset, ret.length());
+	m_readIndex ++;
+	m_readOffset = 0;
+
+	if(progress)
+		progress(1.0);
+	return ret;
+}
+
+size_t SCPIReplayTransport::ReadRawData(size_t len, unsigned char* buf, function<void(float)> progress)
+{
+	if(m_inner)
+	{
+		size_t ret = m_inner->ReadRawData(len, buf, progress);
+		RecordRawRead(buf, ret);
+		return ret;
+	}
+
+	//Raw reads may span several recorded reads (or only part of one)
+	size_t nread = 0;
+	while( (nread < len) && (m_readIndex < m_reads.size()) )
+	{
+		auto& rec = m_reads[m_readIndex];
+		size_t n = min(len - nread, rec.m_data.length() - m_readOffset);
+		ModelLinkDelay(rec, m_readOffset, n);
+		memcpy(buf + nread, rec.m_data.data() + m_readOffset, n);
+		nread += n;
+		m_readOffset += n;
+
+		if(m_readOffset >= rec.m_data.length())
+		{
+			m_readIndex ++;
+			m_readOffset = 0;
+		}
+
+		if(progress)
+			progress(nread * 1.0f / len);
+	}
+
+	if(nread < len)
+		LogWarning("SCPIReplayTransport: read %zu bytes of raw data, only %zu left in recording\n", len, nread);
+	return nread;
+}
+
+/**
+	@brief Reads part of a binary block, recording it with any framing already stripped by the real transport
+ */
+size_t SCPIReplayTransport::ReadBlockData(size_t len, unsigned char* buf)
+{
+	if(m_inner)
+	{
+		size_t ret = m_inner->ReadBlockData(len, buf);
+		RecordRawRead(buf, ret);
+		return ret;
+	}
+
+	return ReadRawData(len, buf);
+}
+
+/**
+	@brief Ends a binary block
+
+	Whatever follows the payload (newline, transport framing, etc) is discarded by the real transport and not recorded,
+	so there is nothing to skip during replay.
+ */
+void SCPIReplayTransport::FinishBlock(bool consumeTerminator)
+{
+	if(m_inner)
+		m_inner->FinishBlock(consumeTerminator);
+}
@@ -0,0 +1,199 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SCPIReplayTransport
+	@ingroup transports
+ */
+
+#ifndef SCPIReplayTransport_h
+#define SCPIReplayTransport_h
+
+/**
+	@brief SCPITransport which records a session with a real instrument to a file, or plays one back
+
+	Connection string formats:
+
+	* record;<file>;<transport>;<transport args>
+		Connects to the instrument using the named transport, and logs every command sent and every response read
+		to the file.
+	* replay;<file>[;<bandwidth>[;<latency>]]
+		Serves the responses from a previously recorded file without any instrument attached. If specified, the
+		bandwidth (in bytes per second) and latency (in seconds, applied to the first read after each command) are used to
+		model the speed of the original link, so driver throughput can be benchmarked realistically.
+	* replay;<file>;recorded
+		Serves the responses at the pace they arrived during recording. Each response is delivered no sooner after the
+		command (or previous response) it follows than it was in the original session, so instrument and link delays are
+		reproduced but the driver's own processing time is not.
+
+	Every record is timestamped. Consecutive raw reads are merged into a single record, so a block read one header
+	byte at a time does not turn into dozens of tiny records.
+
+	Commands sent during replay are compared against the recording, and any differences are reported since they mean
+	the responses being served probably no longer match what the driver expects.
+
+	@ingroup transports
+ */
+class SCPIReplayTransport : public SCPITransport
+{
+public:
+	SCPIReplayTransport(const std::string& args);
+	virtual ~SCPIReplayTransport();
+
+	virtual std::string GetConnectionString() override;
+	static std::string GetTransportName();
+
+	virtual void FlushRXBuffer(void) override;
+	virtual bool SendCommand(const std::string& cmd) override;
+	virtual std::string ReadReply(bool endOnSemicolon = true, std::function<void(float)> progress = nullptr) override;
+	virtual size_t ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress = nullptr) override;
+	virtual void SendRawData(size_t len, const unsigned char* buf) override;
+
+	virtual bool IsCommandBatchingSupported() override;
+	virtual bool IsConnected() override;
+
+	///@brief Returns true if recording a live session, false if replaying
+	bool IsRecording()
+	{ return m_inner != nullptr; }
+
+	///@brief Number of commands sent during replay which did not match the recording
+	size_t GetMismatchCount()
+	{ return m_mismatches; }
+
+	///@brief Returns true if every recorded response has been served
+	bool IsReplayComplete()
+	{ return m_readIndex >= m_reads.size(); }
+
+	///@brief Number of records loaded for replay
+	size_t GetRecordCount()
+	{ return m_writes.size() + m_reads.size(); }
+
+	TRANSPORT_INITPROC(SCPIReplayTransport)
+
+	///@brief Types of entries in a recording
+	enum RecordType : uint8_t
+	{
+		RECORD_COMMAND	= 0,	///< SendCommand()
+		RECORD_RAW_SEND	= 1,	///< SendRawData()
+		RECORD_REPLY	= 2,	///< ReadReply()
+		RECORD_RAW_READ	= 3		///< ReadRawData() or part of a binary block
+	};
+
+	///@brief One entry in a recording
+	struct Record
+	{
+		///@brief Type of the record
+		RecordType m_type;
+
+		///@brief Time since the start of the session, in seconds, at which the command was sent or the response
+		///completely received
+		double m_timestamp;
+
+		///@brief The data sent or received
+		std::string m_data;
+	};
+
+protected:
+	virtual size_t ReadBlockData(size_t len, unsigned char* buf) override;
+	virtual void FinishBlock(bool consumeTerminator) override;
+
+	void WriteRecord(RecordType type, double timestamp, const void* data, size_t len);
+	void RecordRawRead(const void* data, size_t len);
+	void FlushRawRead();
+	bool LoadRecording();
+	void ModelLinkDelay(const Record& rec, size_t offset, size_t len);
+	void SetReplayReference(size_t writeIndex);
+
+	///@brief Connection string we were created with
+	std::string m_args;
+
+	///@brief Path to the recording
+	std::string m_fname;
+
+	///@brief The real transport (record mode only)
+	std::unique_ptr<SCPITransport> m_inner;
+
+	///@brief File being recorded to (record mode only)
+	FILE* m_fp;
+
+	///@brief Time the recording was started
+	double m_startTime;
+
+	///@brief Raw read data not yet written to the file, so consecutive reads can be merged (record mode only)
+	std::string m_pendingRead;
+
+	///@brief Timestamp of the last read merged into m_pendingRead
+	double m_pendingReadTime;
+
+	///@brief True if the recorded transport supports command batching
+	bool m_batchingSupported;
+
+	///@brief Commands and raw data sent during the recorded session (replay mode only)
+	std::vector<Record> m_writes;
+
+	///@brief Responses received during the recorded session (replay mode only)
+	std::vector<Record> m_reads;
+
+	///@brief Index of the next entry in m_writes we expect to be sent
+	size_t m_writeIndex;
+
+	///@brief Index of the entry in m_reads currently being served
+	size_t m_readIndex;
+
+	///@brief Number of bytes of m_reads[m_readIndex] already served
+	size_t m_readOffset;
+
+	///@brief Number of commands which did not match the recording
+	size_t m_mismatches;
+
+	///@brief Modeled link bandwidth in bytes per second (zero for unlimited)
+	double m_bandwidth;
+
+	///@brief Modeled link latency in seconds
+	double m_latency;
+
+	///@brief Time at which the modeled link will have delivered everything read so far
+	double m_linkReady;
+
+	///@brief True if a command has been sent since the last read, so the next read incurs latency
+	bool m_latencyPending;
+
+	///@brief True to serve responses at the pace they were recorded, rather than using the modeled link
+	bool m_recordedTiming;
+
+	///@brief Recorded timestamp of the last command sent or response completed
+	double m_refRecordedTime;
+
+	///@brief Time during replay at which that command was sent or response completed
+	double m_refReplayTime;
+};
+
+#endif
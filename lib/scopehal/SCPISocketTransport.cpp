@@ -146,6 +146,8 @@ bool SCPISocketTransport::SendCommand(const string& cmd)
 
 string SCPISocketTransport::ReadReply(bool endOnSemicolon, [[maybe_unused]] function<void(float)> progress)
 {
+	TraceSpan span("ReadReply", "scpi");
+
 	//FIXME: there *has* to be a more efficient way to do this...
 	char tmp = ' ';
 	string ret;
@@ -174,6 +176,8 @@ void SCPISocketTransport::SendRawData(size_t len, const unsigned char* buf)
 
 size_t SCPISocketTransport::ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress)
 {
+	TraceSpan span("ReadRawData", "scpi");
+
 	size_t chunk_size = len;
 	if (progress)
 	{
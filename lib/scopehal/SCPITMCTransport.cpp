@@ -141,6 +141,8 @@ bool SCPITMCTransport::SendCommand(const string& cmd)
 
 string SCPITMCTransport::ReadReply(bool endOnSemicolon, [[maybe_unused]] function<void(float)> progress)
 {
+	TraceSpan span("ReadReply", "scpi");
+
 	string ret;
 
 	if (!m_staging_buf || !IsConnected())
@@ -170,6 +172,8 @@ void SCPITMCTransport::SendRawData(size_t len, const unsigned char* buf)
 
 size_t SCPITMCTransport::ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> /*progress*/)
 {
+	TraceSpan span("ReadRawData", "scpi");
+
 	// Data in the staging buffer is assumed to always be a consequence of a SendCommand request.
 	// Since we fetch all the reply data in one go, once all this data has been fetched, we mark
 	// the staging buffer as depleted and don't issue a new read until a new SendCommand
@@ -253,25 +253,209 @@ void* SCPITransport::SendCommandImmediateWithRawBlockReply(string cmd, size_t& l
 	SendCommand(cmd);
 
 	//Read the length
-	char tmplen[3] = {0};
-	if(2 != ReadRawData(2, (unsigned char*)tmplen))			//expect #n
-		return NULL;
-	if(tmplen[0] == 0)	//Not sure how this happens, but sometimes occurs on Tek MSO6?
-		return NULL;
-	size_t ndigits = stoull(tmplen+1);
-
-	//Read the digits
-	char digits[10] = {0};
-	if(ndigits != ReadRawData(ndigits, (unsigned char*)digits))
+	if(!ReadBlockHeader(len, 0))
+	{
+		FinishBlock(false);
 		return NULL;
-	len = stoull(digits);
+	}
 
 	//Read the actual data
 	unsigned char* buf = new unsigned char[len];
-	len = ReadRawData(len, buf);
+	len = ReadBlockData(len, buf);
+	FinishBlock(false);
 	return buf;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// IEEE 488.2 definite length blocks
+
+/**
+	@brief Reads the header of an IEEE 488.2 definite length block (#<n><length>)
+
+	The caller must hold the transport mutex.
+
+	@param len			Length of the block payload, in bytes
+	@param maxPrefix	Maximum number of bytes to discard before the '#' (some instruments prefix blocks with
+						a command echo or other junk, e.g. LeCroy's "DAT1,")
+
+	@return True on success, false if no valid header was found
+ */
+bool SCPITransport::ReadBlockHeader(size_t& len, size_t maxPrefix)
+{
+	len = 0;
+
+	//Discard data until we see the '#'
+	unsigned char tmp = 0;
+	for(size_t i=0; ; i++)
+	{
+		if(1 != ReadBlockData(1, &tmp))
+			return false;
+		if(tmp == '#')
+			break;
+
+		//Not sure how this happens, but Tek MSO6 sometimes sends a NUL where the block should start.
+		//There's no block to read, so fail quietly rather than treating it as junk to skip.
+		if( (i == 0) && (tmp == 0) )
+			return false;
+
+		if(i >= maxPrefix)
+		{
+			LogError("ReadBlockHeader: threw away %zu bytes of data and never saw a '#'\n", i+1);
+			return false;
+		}
+	}
+
+	//Read length of the length field
+	if(1 != ReadBlockData(1, &tmp))
+		return false;
+	if( (tmp < '1') || (tmp > '9') )
+	{
+		if(tmp == '0')
+			LogError("ReadBlockHeader: indefinite length blocks are not supported\n");
+		else
+			LogError("ReadBlockHeader: bad length-of-length character 0x%02x\n", tmp);
+		return false;
+	}
+	size_t ndigits = tmp - '0';
+
+	//Read and parse the actual length field
+	unsigned char digits[9];
+	if(ndigits != ReadBlockData(ndigits, digits))
+		return false;
+	for(size_t i=0; i<ndigits; i++)
+	{
+		if( (digits[i] < '0') || (digits[i] > '9') )
+		{
+			LogError("ReadBlockHeader: bad length digit 0x%02x\n", digits[i]);
+			return false;
+		}
+		len = (len * 10) + (digits[i] - '0');
+	}
+
+	return true;
+}
+
+/**
+	@brief Reads an IEEE 488.2 definite length block directly into a buffer, one chunk at a time
+
+	The payload is written straight into the buffer with no intermediate copies. Each time a chunk has been received,
+	chunkDone is called with its offset and length so that the caller can start processing it (e.g. converting ADC
+	codes to volts) while the rest of the block is still in flight. Chunks other than the last are always a multiple
+	of chunkSize, so callers converting multi-byte samples should pick a chunk size that is a multiple of the sample
+	size.
+
+	The caller must hold the transport mutex if it needs the block to be atomic with the command that requested it.
+
+	@param buf					Buffer to store the payload in. Resized to the block length.
+								For best performance, this should be a pinned buffer reused across acquisitions.
+	@param chunkDone			Optional callback invoked after each chunk is received
+	@param progress				Optional callback for download progress reporting
+	@param consumeTerminator	True to read and discard the newline after the block (or the rest of the message,
+								for transports with message framing)
+	@param chunkSize			Number of bytes to read at a time
+
+	@return True if the entire block was read, false on a malformed header or short read
+ */
+bool SCPITransport::ReadBinaryBlock(
+	AcceleratorBuffer<uint8_t>& buf,
+	function<void(size_t, size_t)> chunkDone,
+	function<void(float)> progress,
+	bool consumeTerminator,
+	size_t chunkSize)
+{
+	lock_guard<recursive_mutex> lock(m_netMutex);
+
+	size_t len;
+	if(!ReadBlockHeader(len))
+	{
+		buf.clear();
+		FinishBlock(false);
+		return false;
+	}
+
+	buf.resize(len);
+	buf.PrepareForCpuAccess();
+	auto ptr = buf.GetCpuPointer();
+
+	size_t offset = 0;
+	while(offset < len)
+	{
+		size_t n = min(chunkSize, len - offset);
+		size_t nread = ReadBlockData(n, ptr + offset);
+
+		if(nread > 0)
+		{
+			if(chunkDone)
+				chunkDone(offset, nread);
+			offset += nread;
+			if(progress)
+				progress(offset * 1.0f / len);
+		}
+
+		if(nread < n)
+		{
+			LogError("ReadBinaryBlock: expected %zu bytes, got %zu\n", len, offset);
+			buf.resize(offset);
+			break;
+		}
+	}
+
+	buf.MarkModifiedFromCpu();
+	FinishBlock(consumeTerminator);
+	return (offset == len);
+}
+
+/**
+	@brief Reads part of a binary block
+
+	The default implementation simply reads raw data from the transport. Transports which wrap payload data in their
+	own framing (e.g. VICP) must override this to strip the framing.
+ */
+size_t SCPITransport::ReadBlockData(size_t len, unsigned char* buf)
+{
+	return ReadRawData(len, buf);
+}
+
+/**
+	@brief Called after a binary block has been read
+
+	@param consumeTerminator	True to read and discard the newline after the block
+ */
+void SCPITransport::FinishBlock(bool consumeTerminator)
+{
+	if(consumeTerminator)
+	{
+		unsigned char tmp;
+		ReadBlockData(1, &tmp);
+	}
+}
+
+/**
+	@brief Checks if WaitForRawData() is able to block until data actually arrives
+
+	If this returns false, WaitForRawData() simply sleeps for the requested timeout.
+ */
+bool SCPITransport::IsRawDataWaitSupported()
+{
+	return false;
+}
+
+/**
+	@brief Blocks until data is available for ReadRawData(), or a timeout expires
+
+	Does not take the transport mutex, so it's safe to call from a polling thread while other threads are sending
+	commands.
+
+	@param timeout	Maximum time to wait
+
+	@return True if data may be available, false if the timeout expired with no data
+ */
+bool SCPITransport::WaitForRawData(std::chrono::microseconds timeout)
+{
+	this_thread::sleep_for(timeout);
+	return true;
+}
+
 void SCPITransport::FlushRXBuffer(void)
 {
 	LogError("SCPITransport::FlushRXBuffer is unimplemented\n");
@@ -83,6 +83,22 @@ public:
 	virtual bool IsCommandBatchingSupported() =0;
 	virtual bool IsConnected() =0;
 
+	//Waiting for data the instrument sends without being asked (e.g. waveforms from a streaming bridge)
+	virtual bool IsRawDataWaitSupported();
+	virtual bool WaitForRawData(std::chrono::microseconds timeout);
+
+	//IEEE 488.2 definite length block API
+	bool ReadBlockHeader(size_t& len, size_t maxPrefix = 32);
+	bool ReadBinaryBlock(
+		AcceleratorBuffer<uint8_t>& buf,
+		std::function<void(size_t, size_t)> chunkDone = nullptr,
+		std::function<void(float)> progress = nullptr,
+		bool consumeTerminator = false,
+		size_t chunkSize = BLOCK_CHUNK_SIZE);
+
+	///@brief Default number of bytes per chunk read by ReadBinaryBlock()
+	static constexpr size_t BLOCK_CHUNK_SIZE = 1024 * 1024;
+
 	/**
 		@brief Enables rate limiting. Rate limiting is only applied to the queued command API.
 
@@ -130,6 +146,12 @@ public:
 protected:
 	void RateLimitingWait();
 
+	//The replay transport needs to call the block hooks of the transport it wraps
+	friend class SCPIReplayTransport;
+
+	virtual size_t ReadBlockData(size_t len, unsigned char* buf);
+	virtual void FinishBlock(bool consumeTerminator);
+
 	//Class enumeration
 	typedef std::map< std::string, CreateProcType > CreateMapType;
 	static CreateMapType m_createprocs;
@@ -94,6 +94,8 @@ string SCPITwinLanTransport::GetConnectionString()
 
 size_t SCPITwinLanTransport::ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> /*progress*/)
 {
+	TraceSpan span("ReadRawData", "scpi");
+
 	if(m_secondarysocket.RecvLooped(buf, len))
 		return len;
 	else
@@ -104,3 +106,16 @@ void SCPITwinLanTransport::SendRawData(size_t len, const unsigned char* buf)
 {
 	m_secondarysocket.SendLooped(buf, len);
 }
+
+bool SCPITwinLanTransport::IsRawDataWaitSupported()
+{
+	return true;
+}
+
+/**
+	@brief Blocks until the secondary socket is readable, or the timeout expires
+ */
+bool SCPITwinLanTransport::WaitForRawData(std::chrono::microseconds timeout)
+{
+	return m_secondarysocket.WaitForReadable(timeout.count());
+}
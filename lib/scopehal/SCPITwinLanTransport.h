@@ -57,6 +57,9 @@ public:
 	virtual size_t ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress = nullptr) override;
 	virtual void SendRawData(size_t len, const unsigned char* buf) override;
 
+	virtual bool IsRawDataWaitSupported() override;
+	virtual bool WaitForRawData(std::chrono::microseconds timeout) override;
+
 	TRANSPORT_INITPROC(SCPITwinLanTransport)
 
 	const Socket& GetSecondarySocket()
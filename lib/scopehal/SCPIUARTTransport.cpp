@@ -111,6 +111,8 @@ bool SCPIUARTTransport::SendCommand(const string& cmd)
 
 string SCPIUARTTransport::ReadReply(bool endOnSemicolon, [[maybe_unused]] function<void(float)> progress)
 {
+	TraceSpan span("ReadReply", "scpi");
+
 	//FIXME: there *has* to be a more efficient way to do this...
 	// (see the same code in Socket)
 	char tmp = ' ';
@@ -137,6 +139,8 @@ void SCPIUARTTransport::SendRawData(size_t len, const unsigned char* buf)
 
 size_t SCPIUARTTransport::ReadRawData(size_t len, unsigned char* buf, std::function<void(float)> progress)
 {
+	TraceSpan span("ReadRawData", "scpi");
+
 	size_t chunk_size = len;
 	if (progress && len > 1)
 	{
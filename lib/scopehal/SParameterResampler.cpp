@@ -0,0 +1,248 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of SParameterResampler
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include <string.h>
+
+using namespace std;
+
+mutex SParameterResampler::m_cacheMutex;
+vector< shared_ptr<SParameterResampler::CacheEntry> > SParameterResampler::m_cache;
+uint64_t SParameterResampler::m_cacheClock = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Resampling
+
+/**
+	@brief Resamples an S-parameter vector onto a grid of FFT bins
+
+	@param params	The S-parameters
+	@param bin_hz	Size of each FFT bin, in Hz
+	@param nouts	Number of FFT bins
+	@param invert	True to calculate the inverse response (for de-embedding), false for channel emulation
+	@param maxGain	Maximum gain (V/V) of the inverse response. Ignored if invert is false.
+	@param sines	Output buffer for sin(phase) * gain, resized to nouts
+	@param cosines	Output buffer for cos(phase) * gain, resized to nouts
+ */
+void SParameterResampler::Resample(
+	const SParameterVector& params,
+	float bin_hz,
+	size_t nouts,
+	bool invert,
+	float maxGain,
+	AcceleratorBuffer<float>& sines,
+	AcceleratorBuffer<float>& cosines)
+{
+	sines.resize(nouts);
+	cosines.resize(nouts);
+	sines.PrepareForCpuAccess();
+	cosines.PrepareForCpuAccess();
+
+	if(!invert)
+		maxGain = 0;
+
+	//See if we already have this result
+	uint64_t hash = Hash(params);
+	size_t npoints = params.size();
+	{
+		lock_guard<mutex> lock(m_cacheMutex);
+		for(auto& entry : m_cache)
+		{
+			if( (entry->m_hash != hash) ||
+				(entry->m_binHz != bin_hz) ||
+				(entry->m_nouts != nouts) ||
+				(entry->m_invert != invert) ||
+				(entry->m_maxGain != maxGain) ||
+				(entry->m_points.size() != npoints) )
+			{
+				continue;
+			}
+			if( (npoints > 0) &&
+				(0 != memcmp(entry->m_points.data(), &params.m_points[0], npoints * sizeof(SParameterPoint))) )
+			{
+				continue;
+			}
+
+			entry->m_lastUsed = ++m_cacheClock;
+			memcpy(sines.GetCpuPointer(), entry->m_sines.data(), nouts * sizeof(float));
+			memcpy(cosines.GetCpuPointer(), entry->m_cosines.data(), nouts * sizeof(float));
+			sines.MarkModifiedFromCpu();
+			cosines.MarkModifiedFromCpu();
+			return;
+		}
+	}
+
+	//Not found, calculate it
+	Calculate(params, bin_hz, nouts, invert, maxGain, sines.GetCpuPointer(), cosines.GetCpuPointer());
+	sines.MarkModifiedFromCpu();
+	cosines.MarkModifiedFromCpu();
+
+	//Don't bother caching anything that would take up most of the cache by itself
+	if( (nouts*2*sizeof(float) + npoints*sizeof(SParameterPoint)) > MAX_CACHE_BYTES / 2)
+		return;
+
+	auto entry = make_shared<CacheEntry>();
+	entry->m_hash = hash;
+	entry->m_binHz = bin_hz;
+	entry->m_nouts = nouts;
+	entry->m_invert = invert;
+	entry->m_maxGain = maxGain;
+	if(npoints > 0)
+		entry->m_points.assign(&params.m_points[0], &params.m_points[0] + npoints);
+	entry->m_sines.assign(sines.GetCpuPointer(), sines.GetCpuPointer() + nouts);
+	entry->m_cosines.assign(cosines.GetCpuPointer(), cosines.GetCpuPointer() + nouts);
+
+	lock_guard<mutex> lock(m_cacheMutex);
+	entry->m_lastUsed = ++m_cacheClock;
+	m_cache.push_back(entry);
+
+	//Evict least recently used entries until we're under the limit
+	while(true)
+	{
+		size_t total = 0;
+		size_t oldest = 0;
+		for(size_t i=0; i<m_cache.size(); i++)
+		{
+			total += m_cache[i]->GetSize();
+			if(m_cache[i]->m_lastUsed < m_cache[oldest]->m_lastUsed)
+				oldest = i;
+		}
+		if(total <= MAX_CACHE_BYTES)
+			break;
+		m_cache.erase(m_cache.begin() + oldest);
+	}
+}
+
+/**
+	@brief Frees all cached results
+ */
+void SParameterResampler::ClearCache()
+{
+	lock_guard<mutex> lock(m_cacheMutex);
+	m_cache.clear();
+}
+
+/**
+	@brief Hashes the contents of an S-parameter vector (64-bit FNV-1a)
+ */
+uint64_t SParameterResampler::Hash(const SParameterVector& params)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t len = params.size() * sizeof(SParameterPoint);
+	if(len == 0)
+		return hash;
+
+	auto bytes = reinterpret_cast<const uint8_t*>(&params.m_points[0]);
+	for(size_t i=0; i<len; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/**
+	@brief Does the actual resampling, in blocks spread across all threads
+ */
+void SParameterResampler::Calculate(
+	const SParameterVector& params,
+	float bin_hz,
+	size_t nouts,
+	bool invert,
+	float maxGain,
+	float* sines,
+	float* cosines)
+{
+	size_t nblocks = (nouts + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	#pragma omp parallel for
+	for(size_t i=0; i<nblocks; i++)
+	{
+		size_t start = i * BLOCK_SIZE;
+		size_t count = min(BLOCK_SIZE, nouts - start);
+
+		//Interpolate magnitude into the sine buffer and phase into the cosine buffer, then convert in place
+		params.InterpolateUniform(bin_hz, start, count, sines + start, cosines + start);
+		ToRectangular(sines + start, cosines + start, count, invert, maxGain);
+	}
+}
+
+/**
+	@brief Converts magnitude and phase to rectangular form in place
+
+	@param sines	On entry, magnitudes. On exit, sin(phase) * gain
+	@param cosines	On entry, phases. On exit, cos(phase) * gain
+	@param n		Number of points
+	@param invert	True to invert the response (negate the phase and use the reciprocal of the magnitude)
+	@param maxGain	Maximum gain of the inverted response
+ */
+void SParameterResampler::ToRectangular(float* sines, float* cosines, size_t n, bool invert, float maxGain)
+{
+	//Calculate gain and phase of each point
+	float gain[256];
+	float phase[256];
+	for(size_t base=0; base<n; base += 256)
+	{
+		size_t count = min(n - base, (size_t)256);
+		for(size_t i=0; i<count; i++)
+		{
+			float mag = sines[base + i];
+			float ang = cosines[base + i];
+
+			if(invert)
+			{
+				float amp = 0;
+				if(fabs(mag) > FLT_EPSILON)
+					amp = 1.0f / mag;
+				gain[i] = min(amp, maxGain);
+				phase[i] = -ang;
+			}
+			else
+			{
+				gain[i] = mag;
+				phase[i] = ang;
+			}
+		}
+
+		QuadratureOscillator::SinCos(phase, sines + base, cosines + base, count);
+
+		for(size_t i=0; i<count; i++)
+		{
+			sines[base + i] *= gain[i];
+			cosines[base + i] *= gain[i];
+		}
+	}
+}
@@ -0,0 +1,146 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SParameterResampler
+	@ingroup core
+ */
+
+#ifndef SParameterResampler_h
+#define SParameterResampler_h
+
+#include <memory>
+#include <mutex>
+
+/**
+	@brief Resamples S-parameters onto a uniform grid of FFT bins, in the rectangular form used by the de-embed shaders
+
+	Every bin gets sin(phase) * gain and cos(phase) * gain, with the gain and phase interpolated from the S-parameter
+	vector. For de-embedding (invert = true) the phase is negated and the gain is the reciprocal of the magnitude,
+	clamped to a maximum.
+
+	Interpolation is a single forward walk over the S-parameter points, and sin/cos are evaluated with the vectorized
+	polynomial approximation in QuadratureOscillator::SinCos().
+
+	Results are cached by S-parameter content, bin size, bin count, direction, and gain limit, so multiple filters using
+	the same Touchstone data, or a filter going back and forth between capture lengths, don't recompute anything.
+
+	@ingroup core
+ */
+class SParameterResampler
+{
+public:
+	static void Resample(
+		const SParameterVector& params,
+		float bin_hz,
+		size_t nouts,
+		bool invert,
+		float maxGain,
+		AcceleratorBuffer<float>& sines,
+		AcceleratorBuffer<float>& cosines);
+
+	static void ToRectangular(float* sines, float* cosines, size_t n, bool invert, float maxGain);
+
+	static void ClearCache();
+
+	///@brief Number of results currently in the cache
+	static size_t GetCacheSize()
+	{
+		std::lock_guard<std::mutex> lock(m_cacheMutex);
+		return m_cache.size();
+	}
+
+	///@brief Maximum total size of all cached results, in bytes
+	static constexpr size_t MAX_CACHE_BYTES = 256 * 1024 * 1024;
+
+	///@brief Number of bins processed by each thread at a time
+	static constexpr size_t BLOCK_SIZE = 65536;
+
+protected:
+	static void Calculate(
+		const SParameterVector& params,
+		float bin_hz,
+		size_t nouts,
+		bool invert,
+		float maxGain,
+		float* sines,
+		float* cosines);
+
+	/**
+		@brief A single cached result
+	 */
+	class CacheEntry
+	{
+	public:
+		///@brief Hash of the S-parameter points
+		uint64_t m_hash;
+
+		///@brief Copy of the S-parameter points, to rule out hash collisions
+		std::vector<SParameterPoint> m_points;
+
+		///@brief Bin size the result was calculated for
+		float m_binHz;
+
+		///@brief Number of bins
+		size_t m_nouts;
+
+		///@brief True if the result is for de-embedding, false for channel emulation
+		bool m_invert;
+
+		///@brief Gain limit (only meaningful if m_invert is set)
+		float m_maxGain;
+
+		///@brief Resampled sin(phase) * gain
+		std::vector<float> m_sines;
+
+		///@brief Resampled cos(phase) * gain
+		std::vector<float> m_cosines;
+
+		///@brief Value of m_cacheClock when this entry was last used
+		uint64_t m_lastUsed;
+
+		size_t GetSize() const
+		{ return (m_sines.size() + m_cosines.size()) * sizeof(float) + m_points.size() * sizeof(SParameterPoint); }
+	};
+
+	static uint64_t Hash(const SParameterVector& params);
+
+	///@brief Mutex protecting the cache
+	static std::mutex m_cacheMutex;
+
+	///@brief The cache
+	static std::vector< std::shared_ptr<CacheEntry> > m_cache;
+
+	///@brief Counter used to find the least recently used entry
+	static uint64_t m_cacheClock;
+};
+
+#endif
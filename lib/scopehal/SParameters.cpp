@@ -166,6 +166,135 @@ SParameterPoint SParameterVector::InterpolatePoint(float frequency) const
 	return ret;
 }
 
+/**
+	@brief Interpolates the vector at a series of ascending frequencies in a single pass
+
+	Produces exactly the same results as calling InterpolatePoint() for each frequency, but walks the input points
+	forward as it goes instead of doing a binary search per output. Descending frequencies are still handled correctly,
+	they just cost a new search.
+
+	@param n		Number of output points
+	@param freqAt	Functor returning the frequency of the i'th output point
+	@param emit		Functor called with (i, frequency, amplitude, phase) for each output point
+ */
+template<class F, class T>
+void SParameterVector::InterpolateSorted(size_t n, F freqAt, T emit) const
+{
+	size_t len = m_points.size();
+	if(len == 0)
+	{
+		for(size_t i=0; i<n; i++)
+			emit(i, freqAt(i), 0.0f, 0.0f);
+		return;
+	}
+
+	float fmin = m_points[0].m_frequency;
+	float fmax = m_points[len-1].m_frequency;
+	size_t lo = 0;
+	bool searched = false;
+	for(size_t i=0; i<n; i++)
+	{
+		float frequency = freqAt(i);
+
+		//If out of range, clip (same as InterpolatePoint)
+		if(frequency < fmin)
+		{
+			float phase = InterpolatePhase(0, m_points[0].m_phase, frequency / fmin);
+			emit(i, frequency, m_points[0].m_amplitude, phase);
+			continue;
+		}
+		else if(frequency > fmax)
+		{
+			emit(i, frequency, 0.0f, 0.0f);
+			continue;
+		}
+
+		//Find the first point to start walking from, or start over if we went backwards
+		if(!searched || (m_points[lo].m_frequency > frequency) )
+		{
+			size_t first = 0;
+			size_t count = (len > 1) ? len - 1 : 0;
+			while(count > 0)
+			{
+				size_t step = count / 2;
+				if(m_points[first + step].m_frequency <= frequency)
+				{
+					first += step + 1;
+					count -= step + 1;
+				}
+				else
+					count = step;
+			}
+			lo = (first > 0) ? first - 1 : 0;
+			searched = true;
+		}
+
+		//Move up to the last point at or below us, stopping one short of the end so we always have a pair
+		while( (lo+2 < len) && (m_points[lo+1].m_frequency <= frequency) )
+			lo ++;
+		size_t hi = min(lo + 1, len - 1);
+
+		//Find position between the points for interpolation
+		float freq_lo = m_points[lo].m_frequency;
+		float freq_hi = m_points[hi].m_frequency;
+		float dfreq = freq_hi - freq_lo;
+		float frac;
+		if(dfreq > FLT_EPSILON)
+			frac = (frequency - freq_lo) / dfreq;
+		else
+			frac = 0;
+
+		//Interpolate amplitude and phase
+		float amp_lo = m_points[lo].m_amplitude;
+		float amp_hi = m_points[hi].m_amplitude;
+		emit(
+			i,
+			frequency,
+			amp_lo + (amp_hi - amp_lo)*frac,
+			InterpolatePhase(m_points[lo].m_phase, m_points[hi].m_phase, frac));
+	}
+}
+
+/**
+	@brief Interpolates the vector onto a uniform grid of FFT bins
+
+	@param bin_hz	Size of each bin, in Hz
+	@param istart	Index of the first bin to calculate
+	@param n		Number of bins to calculate
+	@param mag		Output magnitude of each bin (n entries)
+	@param phase	Output phase of each bin (n entries)
+ */
+void SParameterVector::InterpolateUniform(float bin_hz, size_t istart, size_t n, float* mag, float* phase) const
+{
+	InterpolateSorted(
+		n,
+		[&](size_t i) -> float
+		{ return bin_hz * (istart + i); },
+		[&](size_t i, float /*frequency*/, float amplitude, float ang)
+		{
+			mag[i] = amplitude;
+			phase[i] = ang;
+		});
+}
+
+/**
+	@brief Interpolates the vector at the frequencies of every point in another vector
+
+	@param grid		Vector whose frequencies are to be used (normally ascending)
+	@param out		Output vector, resized to match the grid
+ */
+void SParameterVector::InterpolatePoints(const SParameterVector& grid, SParameterVector& out) const
+{
+	size_t n = grid.size();
+	out.resize(n);
+	InterpolateSorted(
+		n,
+		[&](size_t i) -> float
+		{ return grid.m_points[i].m_frequency; },
+		[&](size_t i, float frequency, float amplitude, float ang)
+		{ out.m_points[i] = SParameterPoint(frequency, amplitude, ang); });
+}
+
 /**
 	@brief Interpolates a phase angle, wrapping appropriately
  */
@@ -272,12 +401,9 @@ void SParameters::SaveToFile(const string& path, ParameterFormat format, FreqUni
 	if(format != FORMAT_MAG_ANGLE)
 		LogWarning("Formats other than mag-angle not implemented yet (exporting as mag-angle)\n");
 
-	FILE* fp = fopen(path.c_str(), "w");
-	if(!fp)
-	{
-		LogError("Couldn't open %s for writing\n", path.c_str());
+	ExportWriter writer;
+	if(!writer.Open(path, false))
 		return;
-	}
 
 	//File header
 	string freqText;
@@ -305,7 +431,7 @@ void SParameters::SaveToFile(const string& path, ParameterFormat format, FreqUni
 			freqScale = 1e-9;
 			break;
 	}
-	fprintf(fp, "# %s S MA R 50.000\n", freqText.c_str());
+	writer.Write("# " + freqText + " S MA R 50.000\n");
 
 	//Get the parameters
 	auto& s11 = (*this)[SPair(1, 1)];
@@ -315,15 +441,30 @@ void SParameters::SaveToFile(const string& path, ParameterFormat format, FreqUni
 
 	//Mag-angle format
 	float rad2deg = 180 / M_PI;
+	string line;
 	for(size_t i=0; i<s11.size(); i++)
 	{
 		float freq = s11[i].m_frequency;
-		fprintf(fp, "%f %f %f %f %f %f %f %f %f\n", freq * freqScale,
+		float values[9] =
+		{
+			freq * freqScale,
 			s11[i].m_amplitude, s11[i].m_phase * rad2deg,
 			s21[i].m_amplitude, s21[i].m_phase * rad2deg,
 			s12[i].m_amplitude, s12[i].m_phase * rad2deg,
-			s22[i].m_amplitude, s22[i].m_phase * rad2deg);
+			s22[i].m_amplitude, s22[i].m_phase * rad2deg
+		};
+
+		//Same text as printf("%f") for each value, separated by spaces
+		line.clear();
+		for(size_t j=0; j<9; j++)
+		{
+			if(j > 0)
+				line += ' ';
+			ExportWriter::AppendFixed(line, values[j]);
+		}
+		line += '\n';
+		writer.Write(line);
 	}
 
-	fclose(fp);
+	writer.Close();
 }
@@ -172,6 +172,9 @@ public:
 	float InterpolateMagnitude(float frequency) const;
 	float InterpolateAngle(float frequency) const;
 
+	void InterpolateUniform(float bin_hz, size_t istart, size_t n, float* mag, float* phase) const;
+	void InterpolatePoints(const SParameterVector& grid, SParameterVector& out) const;
+
 	AcceleratorBuffer<SParameterPoint> m_points;
 
 	void resize(size_t nsize)
@@ -190,6 +193,9 @@ public:
 
 protected:
 	float InterpolatePhase(float phase_lo, float phase_hi, float frac) const;
+
+	template<class F, class T>
+	void InterpolateSorted(size_t n, F freqAt, T emit) const;
 };
 
 typedef std::pair<int, int> SPair;
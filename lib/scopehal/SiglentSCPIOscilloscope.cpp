@@ -1547,30 +1547,10 @@ Oscilloscope::TriggerMode SiglentSCPIOscilloscope::PollTrigger()
 
 int SiglentSCPIOscilloscope::ReadWaveformBlock(uint32_t maxsize, char* data, bool hdSizeWorkaround, std::function<void(float)> progress)
 {
-	//Read and discard data until we see the '#'
-	uint8_t tmp;
-	for(int i=0; i<20; i++)
-	{
-		m_transport->ReadRawData(1, &tmp);
-		if(tmp == '#')
-			break;
-
-		//shouldn't ever get here
-		if(i == 19)
-		{
-			LogError("ReadWaveformBlock: threw away 20 bytes of data and never saw a '#'\n");
-			return 0;
-		}
-	}
-
-	//Read length of the length field
-	m_transport->ReadRawData(1, &tmp);
-	int lengthOfLength = tmp - '0';
-
-	//Read the actual length field
-	char textlen[10] = {0};
-	m_transport->ReadRawData(lengthOfLength, (unsigned char*)textlen);
-	uint32_t getLength = atoi(textlen);
+	size_t blockLength;
+	if(!m_transport->ReadBlockHeader(blockLength, 19))
+		return 0;
+	uint32_t getLength = blockLength;
 
 	uint32_t len = getLength;
 	if(hdSizeWorkaround)
@@ -1705,7 +1685,7 @@ vector<WaveformBase*> SiglentSCPIOscilloscope::ProcessAnalogWaveform(const char*
 	time_t ttime,
 	double basetime,
 	double* wavetime,
-	int ch)
+	float vrange)
 {
 	vector<WaveformBase*> ret;
 
@@ -1754,7 +1734,7 @@ vector<WaveformBase*> SiglentSCPIOscilloscope::ProcessAnalogWaveform(const char*
 	//Larger scales: 170 codes per div
 	if(m_modelid == MODEL_SIGLENT_SDS6000A)
 	{
-		float volts_per_div = GetChannelVoltageRange(ch, 0) / 8;
+		float volts_per_div = vrange / 8;
 
 		if(volts_per_div < 0.001)
 			codes_per_div = 63.75;
@@ -1966,7 +1946,10 @@ bool SiglentSCPIOscilloscope::AcquireData()
 	double* pwtime = NULL;
 	char tmp[128];
 
-	//Acquire the data (but don't parse it)
+	if(!m_conversionQueue)
+		m_conversionQueue = make_unique<WaveformConversionQueue>();
+
+	//Acquire the data, converting each channel in the background while the next one downloads
 
 	lock_guard<recursive_mutex> lock(m_transport->GetMutex());
 	start = GetTime();
@@ -1990,6 +1973,7 @@ bool SiglentSCPIOscilloscope::AcquireData()
 			ChannelsDownloadStarted();
 
 			start = GetTime();
+			waveforms.resize(m_analogChannelCount);
 			for(unsigned int i = 0; i < m_analogChannelCount; i++)
 			{
 				if(analogEnabled[i])
@@ -2000,6 +1984,39 @@ bool SiglentSCPIOscilloscope::AcquireData()
 					analogWaveformDataSize[i] = ReadWaveformBlock(WAVEFORM_SIZE, analogWaveformData[i],false, [i, this] (float progress) { ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, progress); });
 					// This is the 0x0a0a at the end
 					m_transport->ReadRawData(2, (unsigned char*)tmp);
+
+					//Convert in the background
+					float gain;
+					float offset;
+					{
+						lock_guard<recursive_mutex> lock2(m_cacheMutex);
+						gain = m_channelVoltageRanges[i] / (8 * 25);
+						offset = m_channelOffsets[i];
+					}
+					int64_t timescale = FS_PER_SECOND / m_sampleRate;
+					m_conversionQueue->Submit(
+						[&waveforms, &analogWaveformData, &analogWaveformDataSize, i, gain, offset, timescale, h_off_frac, start]
+					{
+						auto cap = new UniformAnalogWaveform;
+						cap->m_timescale = timescale;
+						// no high res timer on scope ?
+						cap->m_triggerPhase = h_off_frac;
+						cap->m_startTimestamp = time(NULL);
+						// Fixme
+						cap->m_startFemtoseconds = (start - floor(start)) * FS_PER_SECOND;
+
+						cap->Resize(analogWaveformDataSize[i]);
+						cap->PrepareForCpuAccess();
+
+						Convert8BitSamples(
+							cap->m_samples.GetCpuPointer(),
+							(int8_t*)analogWaveformData[i],
+							gain,
+							offset,
+							analogWaveformDataSize[i]);
+						cap->MarkSamplesModifiedFromCpu();
+						waveforms[i].push_back(cap);
+					});
 				}
 				ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
 			}
@@ -2012,43 +2029,8 @@ bool SiglentSCPIOscilloscope::AcquireData()
 				m_triggerArmed = true;
 			}
 
-			//Process analog waveforms
-			waveforms.resize(m_analogChannelCount);
-			for(unsigned int i = 0; i < m_analogChannelCount; i++)
-			{
-				std::vector<WaveformBase*> ret;
-				if(m_channelsEnabled[i])
-				{
-					auto cap = new UniformAnalogWaveform;
-					cap->m_timescale = FS_PER_SECOND / m_sampleRate;
-					// no high res timer on scope ?
-					cap->m_triggerPhase = h_off_frac;
-					cap->m_startTimestamp = time(NULL);
-					// Fixme
-					cap->m_startFemtoseconds = (start - floor(start)) * FS_PER_SECOND;
-
-					cap->Resize(analogWaveformDataSize[i]);
-					cap->PrepareForCpuAccess();
-
-					Convert8BitSamples(
-						cap->m_samples.GetCpuPointer(),
-						(int8_t*)analogWaveformData[i],
-						m_channelVoltageRanges[i] / (8 * 25),
-						m_channelOffsets[i],
-						analogWaveformDataSize[i]);
-					cap->MarkSamplesModifiedFromCpu();
-					ret.push_back(cap);
-				}
-#if (defined(__GNUC__) && !defined(__clang__))
-//WORKAROUND likely GCC bug in newer versions
-#pragma GCC diagnostic push
-#pragma GCC diagnostic warning "-Warray-bounds"
-#endif
-				waveforms[i] = ret;
-#if (defined(__GNUC__) && !defined(__clang__))
-#pragma GCC diagnostic pop
-#endif
-			}
+			//Wait for conversions still in progress
+			m_conversionQueue->Wait();
 
 			//Save analog waveform data
 			for(unsigned int i = 0; i < m_analogChannelCount; i++)
@@ -2124,6 +2106,7 @@ bool SiglentSCPIOscilloscope::AcquireData()
 				uint64_t acqBytes = m_highDefinition ? (acqPoints*2) : acqPoints;
 				bool paginated = (pages > 1);
 				//Read the data from each analog waveform
+				waveforms.resize(m_analogChannelCount);
 				for(unsigned int i = 0; i < m_analogChannelCount; i++)
 				{
 					if(analogEnabled[i])
@@ -2154,6 +2137,25 @@ bool SiglentSCPIOscilloscope::AcquireData()
 							}
 						}
 						ChannelsDownloadStatusUpdate(i, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
+
+						//Convert in the background while the next channel downloads.
+						//The worker can't talk to the instrument, so look up the V/div (if needed) here.
+						float vrange = 0;
+						if(m_modelid == MODEL_SIGLENT_SDS6000A)
+							vrange = GetChannelVoltageRange(i, 0);
+						m_conversionQueue->Submit(
+							[this, i, &waveforms, &analogWaveformData, &analogWaveformDataSize, &wavedescs,
+								num_sequences, ttime, basetime, pwtime, vrange]
+						{
+							waveforms[i] = ProcessAnalogWaveform(&analogWaveformData[i][0],
+								analogWaveformDataSize[i],
+								&wavedescs[i][0],
+								num_sequences,
+								ttime,
+								basetime,
+								pwtime,
+								vrange);
+						});
 					}
 				}
 				if(anyDigitalEnabled)
@@ -2171,6 +2173,7 @@ bool SiglentSCPIOscilloscope::AcquireData()
 						m_transport->SendCommand(":WAVEFORM:START 0");
 					}
 					//Read the data from each digital waveform
+					digitalWaveforms.resize(m_digitalChannelCount);
 					for(size_t i = 0; i < m_digitalChannelCount; i++)
 					{
 						if(digitalEnabled[i])
@@ -2202,6 +2205,21 @@ bool SiglentSCPIOscilloscope::AcquireData()
 								}
 							}
 							ChannelsDownloadStatusUpdate(i + m_analogChannelCount, InstrumentChannel::DownloadState::DOWNLOAD_FINISHED, 1.0);
+
+							//Unpack in the background while the next channel downloads
+							m_conversionQueue->Submit(
+								[this, i, &digitalWaveforms, &digitalWaveformDataBytes, &digitalWaveformDataSize,
+									pdesc, num_sequences, ttime, basetime, pwtime]
+							{
+								digitalWaveforms[i] = ProcessDigitalWaveform(&digitalWaveformDataBytes[i][0],
+									digitalWaveformDataSize[i],
+									(char*)pdesc,
+									num_sequences,
+									ttime,
+									basetime,
+									pwtime,
+									i);
+							});
 						}
 					}
 				}
@@ -2214,22 +2232,8 @@ bool SiglentSCPIOscilloscope::AcquireData()
 					m_triggerArmed = true;
 				}
 
-				//Process analog waveforms
-				waveforms.resize(m_analogChannelCount);
-				for(unsigned int i = 0; i < m_analogChannelCount; i++)
-				{
-					if(analogEnabled[i])
-					{
-						waveforms[i] = ProcessAnalogWaveform(&analogWaveformData[i][0],
-							analogWaveformDataSize[i],
-							&wavedescs[i][0],
-							num_sequences,
-							ttime,
-							basetime,
-							pwtime,
-							i);
-					}
-				}
+				//Wait for conversions still in progress
+				m_conversionQueue->Wait();
 
 				//Save analog waveform data
 				for(unsigned int i = 0; i < m_analogChannelCount; i++)
@@ -2242,23 +2246,6 @@ bool SiglentSCPIOscilloscope::AcquireData()
 						pending_waveforms[i].push_back(waveforms[i][j]);
 				}
 
-				//Process digital waveforms
-				digitalWaveforms.resize(m_digitalChannelCount);
-				for(unsigned int i = 0; i < m_digitalChannelCount; i++)
-				{
-					if(digitalEnabled[i])
-					{
-						digitalWaveforms[i] = ProcessDigitalWaveform(&digitalWaveformDataBytes[i][0],
-							digitalWaveformDataSize[i],
-							(char*)pdesc,
-							num_sequences,
-							ttime,
-							basetime,
-							pwtime,
-							i);
-					}
-				}
-
 				//Save digital waveform data
 				for(unsigned int i = 0; i < m_digitalChannelCount; i++)
 				{
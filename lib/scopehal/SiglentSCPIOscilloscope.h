@@ -296,7 +296,7 @@ protected:
 		time_t ttime,
 		double basetime,
 		double* wavetime,
-		int i);
+		float vrange);
 	
 	std::vector<SparseDigitalWaveform*> ProcessDigitalWaveform(const char* data,
 		size_t datalen,
@@ -382,6 +382,9 @@ protected:
 	//True if we have >8 bit capture depth
 	bool m_highDefinition;
 
+	///@brief Workers for converting waveforms while later channels are still downloading
+	std::unique_ptr<WaveformConversionQueue> m_conversionQueue;
+
 	//Other channels
 	OscilloscopeChannel* m_extTrigChannel;
 	FunctionGeneratorChannel* m_awgChannel;
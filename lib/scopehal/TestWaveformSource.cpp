@@ -531,20 +531,12 @@ void TestWaveformSource::InterpolateSparameters(float bin_hz, size_t nouts)
 
 	auto& s21 = m_sparams[SPair(2, 1)];
 
-	m_resampledSparamSines.resize(nouts);
-	m_resampledSparamCosines.resize(nouts);
-
-	for(size_t i=0; i<nouts; i++)
-	{
-		float freq = bin_hz * i;
-		auto pt = s21.InterpolatePoint(freq);
-		float mag = pt.m_amplitude;
-		float ang = pt.m_phase;
-
-		m_resampledSparamSines[i] = sin(ang) * mag;
-		m_resampledSparamCosines[i] = cos(ang) * mag;
-	}
-
-	m_resampledSparamSines.MarkModifiedFromCpu();
-	m_resampledSparamCosines.MarkModifiedFromCpu();
+	SParameterResampler::Resample(
+		s21,
+		bin_hz,
+		nouts,
+		false,
+		0,
+		m_resampledSparamSines,
+		m_resampledSparamCosines);
 }
@@ -0,0 +1,356 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of TraceRecorder
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include "TraceRecorder.h"
+
+using namespace std;
+
+/**
+	@brief Ring buffer of events recorded by a single thread
+ */
+class TraceRecorder::ThreadBuffer
+{
+public:
+	ThreadBuffer(int tid)
+	: m_tid(tid)
+	, m_count(0)
+	{}
+
+	///@brief Protects the ring against concurrent Record() and readout calls
+	std::mutex m_mutex;
+
+	///@brief Sequential ID of the thread, used as the "tid" field of the trace
+	int m_tid;
+
+	///@brief Name of the thread
+	std::string m_name;
+
+	///@brief Event storage, allocated the first time an event is recorded
+	std::vector<Event> m_events;
+
+	///@brief Total number of events recorded since the ring was last cleared
+	uint64_t m_count;
+};
+
+atomic<bool> TraceRecorder::m_enabled(false);
+
+///@brief Protects g_traceThreads and g_traceStrings
+static mutex g_traceMutex;
+
+///@brief Ring buffers for every thread which has ever recorded an event or been named
+static vector< shared_ptr<TraceRecorder::ThreadBuffer> > g_traceThreads;
+
+///@brief Interned names (std::set nodes never move, so c_str() pointers stay valid)
+static set<string> g_traceStrings;
+
+///@brief Ring buffer capacity for each thread
+static atomic<size_t> g_traceCapacity(TraceRecorder::DEFAULT_EVENTS_PER_THREAD);
+
+///@brief Timestamp all events are reported relative to
+static atomic<int64_t> g_traceEpoch(0);
+
+///@brief Next thread ID to assign
+static int g_traceNextTid = 1;
+
+///@brief The ring buffer for the current thread
+static thread_local shared_ptr<TraceRecorder::ThreadBuffer> g_traceThreadBuffer;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Control
+
+/**
+	@brief Starts recording spans
+
+	@param eventsPerThread	Capacity of each thread's ring buffer. Changing the capacity discards any existing events.
+ */
+void TraceRecorder::Enable(size_t eventsPerThread)
+{
+	if(eventsPerThread == 0)
+		eventsPerThread = 1;
+
+	int64_t zero = 0;
+	g_traceEpoch.compare_exchange_strong(zero, GetTimestamp());
+
+	if(g_traceCapacity.exchange(eventsPerThread) != eventsPerThread)
+		Clear();
+
+	m_enabled = true;
+}
+
+/**
+	@brief Stops recording spans
+
+	Events recorded so far are kept and can still be written out.
+ */
+void TraceRecorder::Disable()
+{
+	m_enabled = false;
+}
+
+/**
+	@brief Discards all recorded events, and frees buffers belonging to threads which have since exited
+ */
+void TraceRecorder::Clear()
+{
+	lock_guard<mutex> lock(g_traceMutex);
+
+	vector< shared_ptr<ThreadBuffer> > live;
+	for(auto& buf : g_traceThreads)
+	{
+		//If we hold the only reference, the owning thread is gone
+		if(buf.use_count() == 1)
+			continue;
+
+		lock_guard<mutex> lock2(buf->m_mutex);
+		buf->m_events.clear();
+		buf->m_events.shrink_to_fit();
+		buf->m_count = 0;
+		live.push_back(buf);
+	}
+	g_traceThreads = live;
+}
+
+/**
+	@brief Returns a pointer to a copy of a string which remains valid for the lifetime of the process
+
+	Interning the same string twice returns the same pointer.
+ */
+const char* TraceRecorder::Intern(const string& str)
+{
+	lock_guard<mutex> lock(g_traceMutex);
+	return g_traceStrings.insert(str).first->c_str();
+}
+
+/**
+	@brief Sets the name under which the current thread appears in the trace
+ */
+void TraceRecorder::SetThreadName(const string& name)
+{
+	auto buf = GetThreadBuffer();
+	lock_guard<mutex> lock(buf->m_mutex);
+	buf->m_name = name;
+}
+
+/**
+	@brief Gets (creating if necessary) the ring buffer for the current thread
+ */
+TraceRecorder::ThreadBuffer* TraceRecorder::GetThreadBuffer()
+{
+	if(!g_traceThreadBuffer)
+	{
+		lock_guard<mutex> lock(g_traceMutex);
+		g_traceThreadBuffer = make_shared<ThreadBuffer>(g_traceNextTid ++);
+		g_traceThreads.push_back(g_traceThreadBuffer);
+	}
+	return g_traceThreadBuffer.get();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recording
+
+/**
+	@brief Records a completed span on the current thread
+
+	Normally called by TraceSpan rather than directly.
+
+	@param name		Name of the span
+	@param category	Category of the span
+	@param start	Start time, as returned by GetTimestamp()
+	@param end		End time, as returned by GetTimestamp()
+ */
+void TraceRecorder::Record(const char* name, const char* category, int64_t start, int64_t end)
+{
+	auto buf = GetThreadBuffer();
+	lock_guard<mutex> lock(buf->m_mutex);
+
+	//Allocate the ring the first time we record anything, so threads that never trace don't waste memory
+	size_t cap = g_traceCapacity;
+	if(buf->m_events.size() != cap)
+	{
+		buf->m_events.resize(cap);
+		buf->m_count = 0;
+	}
+
+	auto& ev = buf->m_events[buf->m_count % cap];
+	ev.m_name = name;
+	ev.m_category = category;
+	ev.m_start = start - g_traceEpoch;
+	ev.m_duration = end - start;
+	buf->m_count ++;
+}
+
+/**
+	@brief Gets the total number of events currently held in all ring buffers
+ */
+size_t TraceRecorder::GetEventCount()
+{
+	lock_guard<mutex> lock(g_traceMutex);
+
+	size_t total = 0;
+	for(auto& buf : g_traceThreads)
+	{
+		lock_guard<mutex> lock2(buf->m_mutex);
+		total += min<uint64_t>(buf->m_count, buf->m_events.size());
+	}
+	return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Output
+
+/**
+	@brief Appends a string to a JSON document as a quoted, escaped string literal
+ */
+static void AppendJSONString(string& out, const char* str)
+{
+	out += '\"';
+	for(const char* p = str; *p; p++)
+	{
+		char c = *p;
+		if( (c == '\"') || (c == '\\') )
+		{
+			out += '\\';
+			out += c;
+		}
+		else if(static_cast<unsigned char>(c) < 0x20)
+		{
+			char tmp[8];
+			snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+			out += tmp;
+		}
+		else
+			out += c;
+	}
+	out += '\"';
+}
+
+/**
+	@brief Appends a nanosecond count to a JSON document, in microseconds
+
+	Formatted by hand rather than with %f so the output doesn't depend on the current locale's decimal separator.
+ */
+static void AppendMicroseconds(string& out, int64_t ns)
+{
+	char tmp[32];
+	if(ns < 0)
+	{
+		out += '-';
+		ns = -ns;
+	}
+	snprintf(tmp, sizeof(tmp), "%" PRId64 ".%03d", ns / 1000, static_cast<int>(ns % 1000));
+	out += tmp;
+}
+
+/**
+	@brief Serializes all recorded events to a Chrome trace (JSON object format) document
+ */
+string TraceRecorder::GetChromeTrace()
+{
+	string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	bool first = true;
+
+	lock_guard<mutex> lock(g_traceMutex);
+	for(auto& buf : g_traceThreads)
+	{
+		lock_guard<mutex> lock2(buf->m_mutex);
+		string tid = to_string(buf->m_tid);
+
+		//Thread name metadata
+		if(!buf->m_name.empty())
+		{
+			if(!first)
+				out += ",\n";
+			first = false;
+
+			out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":";
+			AppendJSONString(out, buf->m_name.c_str());
+			out += "}}";
+		}
+
+		//Spans, oldest first
+		size_t cap = buf->m_events.size();
+		uint64_t nevents = min<uint64_t>(buf->m_count, cap);
+		for(uint64_t i = buf->m_count - nevents; i < buf->m_count; i++)
+		{
+			auto& ev = buf->m_events[i % cap];
+
+			if(!first)
+				out += ",\n";
+			first = false;
+
+			out += "{\"name\":";
+			AppendJSONString(out, ev.m_name);
+			out += ",\"cat\":";
+			AppendJSONString(out, ev.m_category);
+			out += ",\"ph\":\"X\",\"ts\":";
+			AppendMicroseconds(out, ev.m_start);
+			out += ",\"dur\":";
+			AppendMicroseconds(out, ev.m_duration);
+			out += ",\"pid\":1,\"tid\":" + tid + "}";
+		}
+	}
+
+	out += "\n]}\n";
+	return out;
+}
+
+/**
+	@brief Writes all recorded events to a Chrome trace JSON file
+
+	@param path	Path of the file to write
+
+	@return True on success, false on failure
+ */
+bool TraceRecorder::WriteChromeTrace(const string& path)
+{
+	auto json = GetChromeTrace();
+
+	FILE* fp = fopen(path.c_str(), "wb");
+	if(!fp)
+	{
+		LogError("Failed to open trace file %s\n", path.c_str());
+		return false;
+	}
+
+	bool ok = (fwrite(json.c_str(), 1, json.length(), fp) == json.length());
+	if(fclose(fp) != 0)
+		ok = false;
+
+	if(!ok)
+		LogError("Failed to write trace file %s\n", path.c_str());
+	return ok;
+}
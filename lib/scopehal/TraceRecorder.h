@@ -0,0 +1,171 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of TraceRecorder and TraceSpan
+	@ingroup core
+ */
+
+#ifndef TraceRecorder_h
+#define TraceRecorder_h
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+	@brief Low overhead timeline tracing of work done by acquisition, filter graph, and rendering threads
+
+	Each thread records begin/end spans (see TraceSpan) into its own fixed size ring buffer, so recording never blocks
+	on other threads and memory usage is bounded no matter how long tracing runs for. Once the ring is full, the oldest
+	events are overwritten.
+
+	While tracing is disabled, a span costs a single relaxed atomic load on entry and a branch on exit.
+
+	The recorded timeline can be written out as a Chrome trace JSON file, for viewing in ui.perfetto.dev or
+	chrome://tracing.
+
+	Span names and categories are stored by pointer and must remain valid until the trace has been written. String
+	literals can be used directly; dynamically generated names (e.g. filter names) must go through Intern() first.
+
+	@ingroup core
+ */
+class TraceRecorder
+{
+public:
+
+	///@brief A single completed span
+	struct Event
+	{
+		///@brief Name of the span
+		const char* m_name;
+
+		///@brief Category of the span
+		const char* m_category;
+
+		///@brief Start time, in nanoseconds since tracing was first enabled
+		int64_t m_start;
+
+		///@brief Duration, in nanoseconds
+		int64_t m_duration;
+	};
+
+	///@brief Default ring buffer capacity, in events per thread
+	static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 65536;
+
+	/**
+		@brief Checks if tracing is currently enabled
+	 */
+	static bool IsEnabled()
+	{ return m_enabled.load(std::memory_order_relaxed); }
+
+	static void Enable(size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+	static void Disable();
+	static void Clear();
+
+	static const char* Intern(const std::string& str);
+	static void SetThreadName(const std::string& name);
+
+	static void Record(const char* name, const char* category, int64_t start, int64_t end);
+
+	static size_t GetEventCount();
+	static std::string GetChromeTrace();
+	static bool WriteChromeTrace(const std::string& path);
+
+	/**
+		@brief Gets the current timestamp used for trace events, in nanoseconds
+	 */
+	static int64_t GetTimestamp()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	///@brief Ring buffer of events recorded by a single thread (opaque outside the implementation)
+	class ThreadBuffer;
+
+protected:
+	static ThreadBuffer* GetThreadBuffer();
+
+	///@brief True if spans should be recorded
+	static std::atomic<bool> m_enabled;
+};
+
+/**
+	@brief RAII helper recording a span in the TraceRecorder from construction to destruction
+
+	Does nothing (beyond checking the enable flag) if tracing was disabled at construction time, or if name is null.
+
+	@ingroup core
+ */
+class TraceSpan
+{
+public:
+	/**
+		@brief Begins a span
+
+		@param name		Name of the span (must outlive the trace, see TraceRecorder::Intern)
+		@param category	Category of the span, e.g. "filter" or "scpi"
+	 */
+	TraceSpan(const char* name, const char* category)
+	: m_name(TraceRecorder::IsEnabled() ? name : nullptr)
+	, m_category(category)
+	, m_start(0)
+	{
+		if(m_name)
+			m_start = TraceRecorder::GetTimestamp();
+	}
+
+	/**
+		@brief Ends the span and records it
+	 */
+	~TraceSpan()
+	{
+		if(m_name)
+			TraceRecorder::Record(m_name, m_category, m_start, TraceRecorder::GetTimestamp());
+	}
+
+	TraceSpan(const TraceSpan&) =delete;
+	TraceSpan& operator=(const TraceSpan&) =delete;
+
+protected:
+
+	///@brief Name of the span, or null if not recording
+	const char* m_name;
+
+	///@brief Category of the span
+	const char* m_category;
+
+	///@brief Start time of the span
+	int64_t m_start;
+};
+
+#endif
@@ -50,6 +50,9 @@ VICPSocketTransport::VICPSocketTransport(const string& args)
 	: m_nextSequence(1)
 	, m_lastSequence(1)
 	, m_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)
+	, m_blockFrameRemaining(0)
+	, m_blockFrameEOI(false)
+	, m_blockBytesRead(0)
 {
 	char hostname[128];
 	unsigned int port = 0;
@@ -156,6 +159,8 @@ bool VICPSocketTransport::SendCommand(const string& cmd)
 //ignore endOnSemicolon, VICP uses EOI for framing
 string VICPSocketTransport::ReadReply([[maybe_unused]] bool endOnSemicolon, function<void(float)> progress)
 {
+	TraceSpan span("ReadReply", "scpi");
+
 	string payload;
 	size_t nblocks = 0;
 	size_t expectedBytes = 0;
@@ -246,6 +251,8 @@ void VICPSocketTransport::SendRawData(size_t len, const unsigned char* buf)
 
 size_t VICPSocketTransport::ReadRawData(size_t len, unsigned char* buf, function<void(float)> progress)
 {
+	TraceSpan span("ReadRawData", "scpi");
+
 	size_t chunk_size = len;
 	if (progress)
 	{
@@ -276,6 +283,90 @@ size_t VICPSocketTransport::ReadRawData(size_t len, unsigned char* buf, function
 	return len;
 }
 
+/**
+	@brief Reads payload data of a binary block, stripping VICP framing
+ */
+size_t VICPSocketTransport::ReadBlockData(size_t len, unsigned char* buf)
+{
+	size_t pos = 0;
+	while(pos < len)
+	{
+		//Need to start a new frame?
+		if(m_blockFrameRemaining == 0)
+		{
+			//End of message, no more data
+			if(m_blockFrameEOI)
+				break;
+
+			if(!ReadBlockFrameHeader())
+				break;
+
+			//Empty frames with EOI before any data are not the end of the message (see ReadReply)
+			if( (m_blockFrameRemaining == 0) && (m_blockBytesRead == 0) )
+				m_blockFrameEOI = false;
+			continue;
+		}
+
+		size_t n = min(len - pos, m_blockFrameRemaining);
+		if(n != ReadRawData(n, buf + pos))
+			break;
+		pos += n;
+		m_blockFrameRemaining -= n;
+		m_blockBytesRead += n;
+	}
+
+	return pos;
+}
+
+/**
+	@brief Reads the header of the next VICP frame during a binary block read
+ */
+bool VICPSocketTransport::ReadBlockFrameHeader()
+{
+	unsigned char header[8];
+	if(8 != ReadRawData(8, header))
+		return false;
+
+	if(header[1] != 1)
+	{
+		LogError("Bad VICP protocol version\n");
+		return false;
+	}
+
+	m_blockFrameRemaining = (header[4] << 24) | (header[5] << 16) | (header[6] << 8) | header[7];
+	m_blockFrameEOI = (header[0] & OP_EOI) != 0;
+	return true;
+}
+
+/**
+	@brief Discards the rest of the message after a binary block
+
+	VICP messages are always delimited by EOI, so the trailing newline (if any) is discarded regardless of
+	consumeTerminator.
+ */
+void VICPSocketTransport::FinishBlock(bool /*consumeTerminator*/)
+{
+	unsigned char tmp[256];
+	while(true)
+	{
+		if(m_blockFrameRemaining > 0)
+		{
+			size_t n = min(sizeof(tmp), m_blockFrameRemaining);
+			if(n != ReadRawData(n, tmp))
+				break;
+			m_blockFrameRemaining -= n;
+		}
+		else if(m_blockFrameEOI)
+			break;
+		else if(!ReadBlockFrameHeader())
+			break;
+	}
+
+	m_blockFrameRemaining = 0;
+	m_blockFrameEOI = false;
+	m_blockBytesRead = 0;
+}
+
 void VICPSocketTransport::FlushRXBuffer(void)
 {
 	m_socket.FlushRxBuffer();
@@ -101,6 +101,10 @@ public:
 protected:
 	uint8_t GetNextSequenceNumber();
 
+	virtual size_t ReadBlockData(size_t len, unsigned char* buf) override;
+	virtual void FinishBlock(bool consumeTerminator) override;
+	bool ReadBlockFrameHeader();
+
 	///@brief Next sequence number
 	uint8_t m_nextSequence;
 
@@ -115,6 +119,15 @@ protected:
 
 	///@brief Port our socket is connected to
 	unsigned short m_port;
+
+	///@brief Number of payload bytes left in the VICP frame currently being read by ReadBlockData()
+	size_t m_blockFrameRemaining;
+
+	///@brief True if the VICP frame currently being read by ReadBlockData() is the last of its message
+	bool m_blockFrameEOI;
+
+	///@brief Number of payload bytes read by ReadBlockData() since the last FinishBlock() call
+	size_t m_blockBytesRead;
 };
 
 #endif
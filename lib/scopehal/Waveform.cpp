@@ -326,3 +326,35 @@ void WaveformBase::CacheColors()
 
 	m_protocolColors.MarkModifiedFromCpu();
 }
+
+/**
+	@brief Builds or refreshes the min/max pyramid used to render this waveform when zoomed far out
+
+	Does nothing if the pyramid is already up to date with the current revision of the waveform. Waveforms too small
+	(or of a type which can't be summarized) don't get a pyramid at all.
+ */
+void WaveformBase::UpdatePyramid()
+{
+	if(size() < WaveformPyramid::MIN_DEPTH)
+	{
+		m_pyramid = nullptr;
+		return;
+	}
+
+	if(!m_pyramid)
+		m_pyramid = make_shared<WaveformPyramid>();
+	if(!m_pyramid->Update(this))
+		m_pyramid = nullptr;
+}
+
+/**
+	@brief Gets the min/max pyramid for this waveform
+
+	@return The pyramid, or nullptr if none has been built from the current revision of the waveform
+ */
+WaveformPyramid* WaveformBase::GetPyramid()
+{
+	if(m_pyramid && m_pyramid->IsCurrent(this))
+		return m_pyramid.get();
+	return nullptr;
+}
@@ -38,12 +38,15 @@
 #define Waveform_h
 
 #include <vector>
+#include <memory>
 #include <optional>
 #include <AlignedAllocator.h>
 
 #include "StandardColors.h"
 #include "AcceleratorBuffer.h"
 
+class WaveformPyramid;
+
 /**
 	@brief Base class for all Waveform specializations
 	@ingroup datamodel
@@ -240,6 +243,9 @@ public:
 
 	virtual void CacheColors();
 
+	void UpdatePyramid();
+	WaveformPyramid* GetPyramid();
+
 	///@brief Free GPU-side memory if we are short on VRAM or do not anticipate using this waveform for a while
 	virtual void FreeGpuMemory() =0;
 
@@ -253,6 +259,9 @@ protected:
 
 	///@brief Revision we last cached colors of
 	uint64_t m_cachedColorRevision;
+
+	///@brief Min/max summary used to render this waveform when zoomed far out (null if not needed)
+	std::shared_ptr<WaveformPyramid> m_pyramid;
 };
 
 template<class S> class SparseWaveform;
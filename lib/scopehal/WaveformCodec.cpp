@@ -0,0 +1,705 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of WaveformCodec
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+///@brief Magic number at the start of every compressed waveform
+static const char g_codecMagic[4] = {'W', 'F', 'M', 'Z'};
+
+///@brief Current version of the compressed waveform format
+static const uint32_t CODEC_VERSION = 1;
+
+///@brief Size of each entry in the block directory (uint32 length + uint8 method)
+static const size_t DIRECTORY_ENTRY_SIZE = 5;
+
+///@brief Largest block size accepted when reading a file (to reject corrupted headers early)
+static const size_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+
+///@brief Minimum length of an LZ match
+static const size_t LZ_MIN_MATCH = 4;
+
+///@brief The last few bytes of a buffer are always emitted as literals
+static const size_t LZ_LAST_LITERALS = 5;
+
+///@brief No match may start closer than this to the end of the buffer
+static const size_t LZ_MF_LIMIT = 12;
+
+///@brief Maximum backwards distance of an LZ match
+static const size_t LZ_MAX_DISTANCE = 65535;
+
+///@brief log2 of the number of entries in the LZ match finder hash table
+static const size_t LZ_HASH_BITS = 16;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+template<class T>
+static void Append(vector<uint8_t>& out, T value)
+{
+	size_t pos = out.size();
+	out.resize(pos + sizeof(T));
+	memcpy(&out[pos], &value, sizeof(T));
+}
+
+template<class T>
+static T ReadAt(const uint8_t* buf, size_t pos)
+{
+	T value;
+	memcpy(&value, buf + pos, sizeof(T));
+	return value;
+}
+
+/**
+	@brief Transposes an array of multi-byte elements so that byte N of every element is stored contiguously
+ */
+static void Shuffle(const uint8_t* in, uint8_t* out, size_t count, size_t elementSize)
+{
+	if(elementSize == 1)
+	{
+		memcpy(out, in, count);
+		return;
+	}
+
+	for(size_t b=0; b<elementSize; b++)
+	{
+		uint8_t* plane = out + b*count;
+		for(size_t i=0; i<count; i++)
+			plane[i] = in[i*elementSize + b];
+	}
+}
+
+/**
+	@brief Inverse of Shuffle()
+ */
+static void Unshuffle(const uint8_t* in, uint8_t* out, size_t count, size_t elementSize)
+{
+	if(elementSize == 1)
+	{
+		memcpy(out, in, count);
+		return;
+	}
+
+	for(size_t b=0; b<elementSize; b++)
+	{
+		const uint8_t* plane = in + b*count;
+		for(size_t i=0; i<count; i++)
+			out[i*elementSize + b] = plane[i];
+	}
+}
+
+/**
+	@brief Parses the header and column formats of a compressed waveform
+
+	@param buf			Compressed data
+	@param len			Length of the compressed data
+	@param nsamples		Number of samples in each column
+	@param blockSize	Number of samples per block
+	@param formats		Element size and flags of each column
+	@param pos			Offset of the block directory
+
+	@return True on success, false if the header is malformed
+ */
+static bool ParseHeader(
+	const uint8_t* buf,
+	size_t len,
+	size_t& nsamples,
+	size_t& blockSize,
+	vector<pair<uint8_t, uint8_t>>& formats,
+	size_t& pos)
+{
+	const size_t fixedSize = sizeof(g_codecMagic) + sizeof(uint32_t) + sizeof(uint64_t) + 2*sizeof(uint32_t);
+	if(len < fixedSize)
+		return false;
+	if(0 != memcmp(buf, g_codecMagic, sizeof(g_codecMagic)))
+		return false;
+	pos = sizeof(g_codecMagic);
+
+	if(ReadAt<uint32_t>(buf, pos) != CODEC_VERSION)
+		return false;
+	pos += sizeof(uint32_t);
+
+	nsamples = ReadAt<uint64_t>(buf, pos);
+	pos += sizeof(uint64_t);
+	blockSize = ReadAt<uint32_t>(buf, pos);
+	pos += sizeof(uint32_t);
+	size_t ncols = ReadAt<uint32_t>(buf, pos);
+	pos += sizeof(uint32_t);
+
+	if( (blockSize == 0) || (blockSize > MAX_BLOCK_SIZE) || (ncols == 0) || (pos + 2*ncols > len) )
+		return false;
+
+	formats.clear();
+	for(size_t i=0; i<ncols; i++)
+	{
+		formats.push_back(pair<uint8_t, uint8_t>(buf[pos], buf[pos+1]));
+		pos += 2;
+	}
+
+	//The block directory has to fit in the buffer, which also puts a sane upper bound on the sample count
+	size_t nblocks = (nsamples + blockSize - 1) / blockSize;
+	if(nblocks > (len - pos) / (ncols * DIRECTORY_ENTRY_SIZE) )
+		return false;
+
+	return true;
+}
+
+/**
+	@brief Gets the list of columns making up a waveform's sample data
+
+	@return False if the waveform type is not supported
+ */
+static bool GetWaveformColumns(WaveformBase* wfm, vector<WaveformCodec::Column>& cols)
+{
+	auto sa = dynamic_cast<SparseAnalogWaveform*>(wfm);
+	auto sd = dynamic_cast<SparseDigitalWaveform*>(wfm);
+	auto ua = dynamic_cast<UniformAnalogWaveform*>(wfm);
+	auto ud = dynamic_cast<UniformDigitalWaveform*>(wfm);
+
+	cols.clear();
+	if(sa)
+	{
+		cols.push_back(WaveformCodec::Column(sa->m_offsets.GetCpuPointer(), sizeof(int64_t), true));
+		cols.push_back(WaveformCodec::Column(sa->m_durations.GetCpuPointer(), sizeof(int64_t), true));
+		cols.push_back(WaveformCodec::Column(sa->m_samples.GetCpuPointer(), sizeof(float)));
+	}
+	else if(sd)
+	{
+		cols.push_back(WaveformCodec::Column(sd->m_offsets.GetCpuPointer(), sizeof(int64_t), true));
+		cols.push_back(WaveformCodec::Column(sd->m_durations.GetCpuPointer(), sizeof(int64_t), true));
+		cols.push_back(WaveformCodec::Column(sd->m_samples.GetCpuPointer(), sizeof(bool)));
+	}
+	else if(ua)
+		cols.push_back(WaveformCodec::Column(ua->m_samples.GetCpuPointer(), sizeof(float)));
+	else if(ud)
+		cols.push_back(WaveformCodec::Column(ud->m_samples.GetCpuPointer(), sizeof(bool)));
+	else
+		return false;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Column API
+
+/**
+	@brief Compresses a set of columns
+
+	@param columns	The data to compress. All columns must contain nsamples elements.
+	@param nsamples	Number of elements in each column
+	@param out		Output buffer (any existing content is discarded)
+ */
+void WaveformCodec::Compress(const vector<Column>& columns, size_t nsamples, vector<uint8_t>& out)
+{
+	size_t ncols = columns.size();
+	size_t nblocks = (nsamples + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	size_t nentries = nblocks * ncols;
+
+	//Encode every block of every column in parallel
+	vector< vector<uint8_t> > encoded(nentries);
+	vector<uint8_t> methods(nentries);
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(size_t i=0; i<nentries; i++)
+	{
+		size_t block = i / ncols;
+		size_t start = block * BLOCK_SIZE;
+		size_t count = min(BLOCK_SIZE, nsamples - start);
+		EncodeBlock(columns[i % ncols], start, count, encoded[i], methods[i]);
+	}
+
+	//Header
+	out.resize(sizeof(g_codecMagic));
+	memcpy(out.data(), g_codecMagic, sizeof(g_codecMagic));
+	Append<uint32_t>(out, CODEC_VERSION);
+	Append<uint64_t>(out, nsamples);
+	Append<uint32_t>(out, BLOCK_SIZE);
+	Append<uint32_t>(out, ncols);
+	for(auto& col : columns)
+	{
+		Append<uint8_t>(out, col.m_elementSize);
+		Append<uint8_t>(out, col.m_delta ? 1 : 0);
+	}
+
+	//Block directory
+	size_t total = out.size() + nentries*DIRECTORY_ENTRY_SIZE;
+	for(size_t i=0; i<nentries; i++)
+	{
+		Append<uint32_t>(out, encoded[i].size());
+		Append<uint8_t>(out, methods[i]);
+		total += encoded[i].size();
+	}
+
+	//Block data
+	out.reserve(total);
+	for(auto& e : encoded)
+		out.insert(out.end(), e.begin(), e.end());
+}
+
+/**
+	@brief Reads the sample and column counts of a compressed waveform, so the caller can allocate space for it
+
+	@return True on success, false if the data is not a valid compressed waveform
+ */
+bool WaveformCodec::ReadHeader(const uint8_t* buf, size_t len, size_t& nsamples, size_t& ncolumns)
+{
+	size_t blockSize;
+	size_t pos;
+	vector<pair<uint8_t, uint8_t>> formats;
+	if(!ParseHeader(buf, len, nsamples, blockSize, formats, pos))
+		return false;
+	ncolumns = formats.size();
+	return true;
+}
+
+/**
+	@brief Decompresses a set of columns
+
+	@param buf		Compressed data
+	@param len		Length of the compressed data
+	@param columns	Output columns. These must match the formats they were compressed with, and have room for the number
+					of samples reported by ReadHeader().
+
+	@return True on success, false if the data is corrupted or does not match the columns
+ */
+bool WaveformCodec::Decompress(const uint8_t* buf, size_t len, const vector<Column>& columns)
+{
+	size_t nsamples;
+	size_t blockSize;
+	size_t pos;
+	vector<pair<uint8_t, uint8_t>> formats;
+	if(!ParseHeader(buf, len, nsamples, blockSize, formats, pos))
+		return false;
+
+	//Make sure the caller is expecting the same layout we have
+	size_t ncols = columns.size();
+	if(formats.size() != ncols)
+		return false;
+	for(size_t i=0; i<ncols; i++)
+	{
+		if( (formats[i].first != columns[i].m_elementSize) || ((formats[i].second & 1) != columns[i].m_delta) )
+			return false;
+	}
+
+	//Read the directory and find where each block starts
+	size_t nblocks = (nsamples + blockSize - 1) / blockSize;
+	size_t nentries = nblocks * ncols;
+	vector<size_t> offsets(nentries);
+	vector<size_t> lengths(nentries);
+	vector<uint8_t> methods(nentries);
+	size_t dataStart = pos + nentries*DIRECTORY_ENTRY_SIZE;
+	size_t offset = dataStart;
+	for(size_t i=0; i<nentries; i++)
+	{
+		lengths[i] = ReadAt<uint32_t>(buf, pos);
+		methods[i] = buf[pos + sizeof(uint32_t)];
+		pos += DIRECTORY_ENTRY_SIZE;
+
+		offsets[i] = offset;
+		offset += lengths[i];
+	}
+	if(offset > len)
+		return false;
+
+	//Decode all blocks in parallel
+	bool ok = true;
+	#pragma omp parallel for schedule(dynamic, 1) reduction(&&:ok)
+	for(size_t i=0; i<nentries; i++)
+	{
+		size_t block = i / ncols;
+		size_t start = block * blockSize;
+		size_t count = min(blockSize, nsamples - start);
+		ok = DecodeBlock(columns[i % ncols], start, count, buf + offsets[i], lengths[i], methods[i]) && ok;
+	}
+
+	return ok;
+}
+
+/**
+	@brief Delta codes, shuffles, and compresses one block of a column
+ */
+void WaveformCodec::EncodeBlock(const Column& col, size_t start, size_t count, vector<uint8_t>& out, uint8_t& method)
+{
+	size_t es = col.m_elementSize;
+	size_t nbytes = count * es;
+	const uint8_t* src = reinterpret_cast<const uint8_t*>(col.m_data) + start*es;
+
+	//Delta code timestamps
+	vector<uint64_t> deltas;
+	if(col.m_delta && (es == sizeof(uint64_t)) )
+	{
+		deltas.resize(count);
+		uint64_t last = 0;
+		for(size_t i=0; i<count; i++)
+		{
+			uint64_t v = ReadAt<uint64_t>(src, i*sizeof(uint64_t));
+			deltas[i] = v - last;
+			last = v;
+		}
+		src = reinterpret_cast<const uint8_t*>(deltas.data());
+	}
+
+	vector<uint8_t> shuffled(nbytes);
+	Shuffle(src, shuffled.data(), count, es);
+
+	//Compress, but keep the shuffled data if it didn't get any smaller
+	out.resize(nbytes);
+	size_t clen = LZCompress(shuffled.data(), nbytes, out.data(), nbytes);
+	if(clen == 0)
+	{
+		method = METHOD_STORED;
+		out.swap(shuffled);
+	}
+	else
+	{
+		method = METHOD_LZ;
+		out.resize(clen);
+	}
+}
+
+/**
+	@brief Decompresses, unshuffles, and undoes delta coding for one block of a column
+ */
+bool WaveformCodec::DecodeBlock(
+	const Column& col,
+	size_t start,
+	size_t count,
+	const uint8_t* in,
+	size_t len,
+	uint8_t method)
+{
+	size_t es = col.m_elementSize;
+	size_t nbytes = count * es;
+
+	vector<uint8_t> shuffled;
+	const uint8_t* src = in;
+	if(method == METHOD_LZ)
+	{
+		shuffled.resize(nbytes);
+		if(!LZDecompress(in, len, shuffled.data(), nbytes))
+			return false;
+		src = shuffled.data();
+	}
+	else if(method == METHOD_STORED)
+	{
+		if(len != nbytes)
+			return false;
+	}
+	else
+		return false;
+
+	uint8_t* dst = reinterpret_cast<uint8_t*>(col.m_data) + start*es;
+	Unshuffle(src, dst, count, es);
+
+	//Undo delta coding
+	if(col.m_delta && (es == sizeof(uint64_t)) )
+	{
+		uint64_t acc = 0;
+		for(size_t i=0; i<count; i++)
+		{
+			acc += ReadAt<uint64_t>(dst, i*sizeof(uint64_t));
+			memcpy(dst + i*sizeof(uint64_t), &acc, sizeof(acc));
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Waveform API
+
+/**
+	@brief Compresses the sample data of a sparse or uniform analog or digital waveform
+
+	Timestamps and other metadata are not included, the caller has to store them separately.
+
+	@return False if the waveform type is not supported
+ */
+bool WaveformCodec::CompressWaveform(WaveformBase* wfm, vector<uint8_t>& out)
+{
+	wfm->PrepareForCpuAccess();
+
+	vector<Column> cols;
+	if(!GetWaveformColumns(wfm, cols))
+		return false;
+
+	Compress(cols, wfm->size(), out);
+	return true;
+}
+
+/**
+	@brief Decompresses data written by CompressWaveform() into an existing waveform of the same type
+
+	The waveform is resized to fit the decompressed data.
+
+	@return True on success, false if the data is corrupted or was compressed from a different waveform type
+ */
+bool WaveformCodec::DecompressWaveform(const uint8_t* buf, size_t len, WaveformBase* wfm)
+{
+	size_t nsamples;
+	size_t ncols;
+	if(!ReadHeader(buf, len, nsamples, ncols))
+		return false;
+
+	wfm->PrepareForCpuAccess();
+	wfm->Resize(nsamples);
+
+	vector<Column> cols;
+	if(!GetWaveformColumns(wfm, cols))
+		return false;
+	if(!Decompress(buf, len, cols))
+		return false;
+
+	wfm->MarkModifiedFromCpu();
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// LZ coder
+
+/*
+	Each sequence is a token byte, literal length extension, literals, match offset, and match length extension:
+	* Token bits 7:4 are the literal count, bits 3:0 are the match length minus LZ_MIN_MATCH
+	* If either token field is 15, it's followed by extension bytes which are added to it until one isn't 255
+	* The match offset is 16 bits little endian, and always nonzero
+	* The final sequence has only literals, and no offset or match length
+ */
+
+static bool EmitLength(uint8_t* out, size_t outlen, size_t& op, size_t len)
+{
+	while(len >= 255)
+	{
+		if(op >= outlen)
+			return false;
+		out[op++] = 255;
+		len -= 255;
+	}
+	if(op >= outlen)
+		return false;
+	out[op++] = len;
+	return true;
+}
+
+static bool EmitSequence(
+	uint8_t* out,
+	size_t outlen,
+	size_t& op,
+	const uint8_t* literals,
+	size_t nliterals,
+	size_t offset,
+	size_t matchLen)
+{
+	if(op >= outlen)
+		return false;
+
+	//Token
+	size_t mcode = matchLen - LZ_MIN_MATCH;
+	uint8_t token = (min(nliterals, (size_t)15) << 4);
+	if(offset)
+		token |= min(mcode, (size_t)15);
+	out[op++] = token;
+
+	//Literals
+	if( (nliterals >= 15) && !EmitLength(out, outlen, op, nliterals - 15) )
+		return false;
+	if(op + nliterals > outlen)
+		return false;
+	memcpy(out + op, literals, nliterals);
+	op += nliterals;
+
+	//Final sequence stops here
+	if(!offset)
+		return true;
+
+	//Match
+	if(op + 2 > outlen)
+		return false;
+	out[op++] = offset & 0xff;
+	out[op++] = offset >> 8;
+	if( (mcode >= 15) && !EmitLength(out, outlen, op, mcode - 15) )
+		return false;
+
+	return true;
+}
+
+/**
+	@brief Compresses a buffer
+
+	@param in		Input data
+	@param len		Length of the input
+	@param out		Output buffer
+	@param outlen	Size of the output buffer
+
+	@return Size of the compressed data, or zero if it did not fit in the output buffer
+ */
+size_t WaveformCodec::LZCompress(const uint8_t* in, size_t len, uint8_t* out, size_t outlen)
+{
+	size_t op = 0;
+	size_t anchor = 0;
+
+	if(len >= LZ_MF_LIMIT)
+	{
+		//Position (plus one, so zero means empty) of the last occurrence of each hashed 4-byte sequence
+		vector<uint32_t> table(1 << LZ_HASH_BITS, 0);
+
+		size_t matchLimit = len - LZ_MF_LIMIT;
+		size_t extendLimit = len - LZ_LAST_LITERALS;
+		size_t misses = 0;
+		size_t ip = 0;
+		while(ip < matchLimit)
+		{
+			uint32_t seq = ReadAt<uint32_t>(in, ip);
+			uint32_t h = (seq * 2654435761U) >> (32 - LZ_HASH_BITS);
+			size_t ref = table[h];
+			table[h] = ip + 1;
+
+			if( (ref != 0) && (ip - (ref - 1) <= LZ_MAX_DISTANCE) && (ReadAt<uint32_t>(in, ref - 1) == seq) )
+			{
+				ref --;
+
+				//Extend the match as far as possible, eight bytes at a time then byte by byte
+				size_t mlen = LZ_MIN_MATCH;
+				while( (ip + mlen + 8 <= extendLimit) &&
+					(ReadAt<uint64_t>(in, ref + mlen) == ReadAt<uint64_t>(in, ip + mlen)) )
+				{
+					mlen += 8;
+				}
+				while( (ip + mlen < extendLimit) && (in[ref + mlen] == in[ip + mlen]) )
+					mlen ++;
+
+				if(!EmitSequence(out, outlen, op, in + anchor, ip - anchor, ip - ref, mlen))
+					return 0;
+
+				ip += mlen;
+				anchor = ip;
+				misses = 0;
+			}
+
+			//Skip ahead faster through data that doesn't seem to compress
+			else
+			{
+				misses ++;
+				ip += 1 + (misses >> 6);
+			}
+		}
+	}
+
+	//Whatever is left over goes out as literals
+	if(!EmitSequence(out, outlen, op, in + anchor, len - anchor, 0, LZ_MIN_MATCH))
+		return 0;
+
+	return op;
+}
+
+/**
+	@brief Decompresses a buffer
+
+	@param in		Compressed data
+	@param len		Length of the compressed data
+	@param out		Output buffer
+	@param outlen	Expected size of the decompressed data
+
+	@return True on success, false if the data is corrupted or doesn't decompress to exactly outlen bytes
+ */
+bool WaveformCodec::LZDecompress(const uint8_t* in, size_t len, uint8_t* out, size_t outlen)
+{
+	size_t ip = 0;
+	size_t op = 0;
+	while(ip < len)
+	{
+		uint8_t token = in[ip++];
+
+		//Literals
+		size_t nliterals = token >> 4;
+		if(nliterals == 15)
+		{
+			uint8_t b;
+			do
+			{
+				if(ip >= len)
+					return false;
+				b = in[ip++];
+				nliterals += b;
+			} while(b == 255);
+		}
+		if( (ip + nliterals > len) || (op + nliterals > outlen) )
+			return false;
+		memcpy(out + op, in + ip, nliterals);
+		ip += nliterals;
+		op += nliterals;
+
+		//End of the final sequence
+		if(ip == len)
+			break;
+
+		//Match
+		if(ip + 2 > len)
+			return false;
+		size_t offset = in[ip] | (in[ip+1] << 8);
+		ip += 2;
+		if( (offset == 0) || (offset > op) )
+			return false;
+
+		size_t mlen = token & 15;
+		if(mlen == 15)
+		{
+			uint8_t b;
+			do
+			{
+				if(ip >= len)
+					return false;
+				b = in[ip++];
+				mlen += b;
+			} while(b == 255);
+		}
+		mlen += LZ_MIN_MATCH;
+		if(op + mlen > outlen)
+			return false;
+
+		//Matches may overlap the data being written (e.g. runs of a repeated value).
+		//Copy in chunks no larger than the distance between source and destination, which doubles every time.
+		size_t src = op - offset;
+		while(mlen > 0)
+		{
+			size_t n = min(mlen, op - src);
+			memcpy(out + op, out + src, n);
+			op += n;
+			mlen -= n;
+		}
+	}
+
+	return (op == outlen);
+}
@@ -0,0 +1,116 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of WaveformCodec
+	@ingroup core
+ */
+
+#ifndef WaveformCodec_h
+#define WaveformCodec_h
+
+/**
+	@brief Lossless compression for waveform sample data stored on disk
+
+	Data is handled as a set of columns of equal length (for example offsets, durations, and samples of a sparse
+	waveform). Each column is split into fixed size blocks which are compressed independently, so both compression and
+	decompression of large waveforms run in parallel.
+
+	Each block of a column goes through up to three stages:
+	* Delta coding (integer columns only, e.g. timestamps). Monotonic offsets and mostly constant durations turn into
+	  long runs of small or identical values.
+	* Byte shuffling: byte 0 of every element, then byte 1 of every element, etc. High-order bytes of timestamps and
+	  the sign/exponent bytes of floats are nearly constant and end up grouped together.
+	* A simple byte-oriented LZ77 coder, in the spirit of LZ4. It's fast enough to not be the bottleneck when saving or
+	  loading from disk, and falls back to storing the block uncompressed if that would be smaller.
+
+	The file starts with a header giving the sample count, block size, and the format of each column, followed by a
+	directory with the encoded size of each block and then the block data itself.
+
+	@ingroup core
+ */
+class WaveformCodec
+{
+public:
+
+	/**
+		@brief A single column of sample data to compress
+	 */
+	class Column
+	{
+	public:
+		Column(void* data, size_t elementSize, bool delta = false)
+		: m_data(data)
+		, m_elementSize(elementSize)
+		, m_delta(delta)
+		{}
+
+		///@brief Pointer to the first element
+		void* m_data;
+
+		///@brief Size of each element, in bytes (1, 2, 4, or 8)
+		size_t m_elementSize;
+
+		///@brief True to delta code the column before compressing it (only valid for 8-byte integer columns)
+		bool m_delta;
+	};
+
+	static void Compress(const std::vector<Column>& columns, size_t nsamples, std::vector<uint8_t>& out);
+	static bool ReadHeader(const uint8_t* buf, size_t len, size_t& nsamples, size_t& ncolumns);
+	static bool Decompress(const uint8_t* buf, size_t len, const std::vector<Column>& columns);
+
+	static bool CompressWaveform(WaveformBase* wfm, std::vector<uint8_t>& out);
+	static bool DecompressWaveform(const uint8_t* buf, size_t len, WaveformBase* wfm);
+
+	static size_t LZCompress(const uint8_t* in, size_t len, uint8_t* out, size_t outlen);
+	static bool LZDecompress(const uint8_t* in, size_t len, uint8_t* out, size_t outlen);
+
+	///@brief Number of samples in each independently compressed block
+	static constexpr size_t BLOCK_SIZE = 256 * 1024;
+
+protected:
+	static void EncodeBlock(const Column& col, size_t start, size_t count, std::vector<uint8_t>& out, uint8_t& method);
+	static bool DecodeBlock(
+		const Column& col,
+		size_t start,
+		size_t count,
+		const uint8_t* in,
+		size_t len,
+		uint8_t method);
+
+	///@brief Block was stored uncompressed (after delta coding and shuffling)
+	static constexpr uint8_t METHOD_STORED = 0;
+
+	///@brief Block was compressed with LZCompress()
+	static constexpr uint8_t METHOD_LZ = 1;
+};
+
+#endif
@@ -0,0 +1,149 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of WaveformConversionQueue
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates the queue and starts the worker threads
+
+	@param numThreads	Number of worker threads. Conversion primitives are already multithreaded internally for
+						large waveforms, so a couple of workers is usually enough to keep up with the transport.
+ */
+WaveformConversionQueue::WaveformConversionQueue(size_t numThreads)
+	: m_pendingJobs(0)
+	, m_terminating(false)
+{
+	for(size_t i=0; i<numThreads; i++)
+		m_threads.push_back(make_unique<thread>(&WaveformConversionQueue::WorkerThread, this));
+}
+
+WaveformConversionQueue::~WaveformConversionQueue()
+{
+	//Terminate worker threads
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_terminating = true;
+	}
+	m_workerCvar.notify_all();
+	for(auto& t : m_threads)
+		t->join();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Job control
+
+/**
+	@brief Adds a job to the queue. It will run as soon as a worker is free.
+ */
+void WaveformConversionQueue::Submit(function<void()> job)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+		m_pendingJobs ++;
+	}
+	m_workerCvar.notify_one();
+}
+
+/**
+	@brief Blocks until every job submitted so far has completed
+ */
+void WaveformConversionQueue::Wait()
+{
+	unique_lock<mutex> lock(m_mutex);
+	m_completionCvar.wait(lock, [this]{ return m_pendingJobs == 0; });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Worker threads
+
+/**
+	@brief Thread function for conversion workers
+ */
+void WaveformConversionQueue::WorkerThread(WaveformConversionQueue* pThis)
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "WfmConvert");
+	#endif
+	TraceRecorder::SetThreadName("WfmConvert");
+
+	//Make locale handling thread safe on Windows
+	#ifdef _WIN32
+	_configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+	Unit::SetDefaultLocale();
+	#endif
+
+	pThis->DoWorkerThread();
+}
+
+void WaveformConversionQueue::DoWorkerThread()
+{
+	while(true)
+	{
+		function<void()> job;
+
+		//Wait for something to do
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_workerCvar.wait(lock, [this]{ return m_terminating || !m_jobs.empty(); });
+			if(m_jobs.empty())
+				return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		{
+			TraceSpan span("WaveformConversion", "acquisition");
+			job();
+		}
+
+		//Wake up anyone waiting for the queue to drain
+		bool done;
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_pendingJobs --;
+			done = (m_pendingJobs == 0);
+		}
+		if(done)
+			m_completionCvar.notify_all();
+	}
+}
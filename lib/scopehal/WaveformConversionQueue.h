@@ -0,0 +1,91 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of WaveformConversionQueue
+	@ingroup core
+ */
+
+#ifndef WaveformConversionQueue_h
+#define WaveformConversionQueue_h
+
+#include <condition_variable>
+#include <deque>
+
+/**
+	@brief Small worker pool used by instrument drivers to process waveform data while downloading more
+
+	The typical pattern in a driver's AcquireData() is to download channel N, Submit() a job converting it to a
+	waveform, then go on to download channel N+1 while a worker crunches the previous channel. Once everything has been
+	downloaded, Wait() blocks until the conversions are finished.
+
+	Jobs run on plain CPU threads with no Vulkan queue, and must not touch the transport (the driver normally still
+	holds the transport mutex while downloading, so this would deadlock). Anything that needs the instrument, such as
+	querying a setting that might not be cached, has to be done before submitting the job.
+
+	@ingroup core
+ */
+class WaveformConversionQueue
+{
+public:
+	WaveformConversionQueue(size_t numThreads = 2);
+	~WaveformConversionQueue();
+
+	void Submit(std::function<void()> job);
+	void Wait();
+
+protected:
+	static void WorkerThread(WaveformConversionQueue* pThis);
+	void DoWorkerThread();
+
+	///@brief Mutex for access to shared state
+	std::mutex m_mutex;
+
+	///@brief Jobs which have been submitted but not yet started
+	std::deque< std::function<void()> > m_jobs;
+
+	///@brief Number of jobs which have been submitted but not yet completed
+	size_t m_pendingJobs;
+
+	///@brief Condition variable for waking up worker threads when work arrives
+	std::condition_variable m_workerCvar;
+
+	///@brief Condition variable for waking up Wait() when all work is complete
+	std::condition_variable m_completionCvar;
+
+	///@brief Shutdown flag
+	bool m_terminating;
+
+	///@brief Set of thread contexts
+	std::vector<std::unique_ptr<std::thread>> m_threads;
+};
+
+#endif
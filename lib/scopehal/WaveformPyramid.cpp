@@ -0,0 +1,516 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of WaveformPyramid
+	@ingroup datamodel
+ */
+#include "scopehal.h"
+#include "WaveformPyramid.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+WaveformPyramid::WaveformPyramid()
+	: m_sourceRevision(0)
+	, m_sourceDepth(0)
+	, m_sourceTimestamp(0)
+	, m_sourceFemtoseconds(0)
+	, m_sourceEnd(0)
+{
+}
+
+/**
+	@brief Discards all levels of the pyramid
+ */
+void WaveformPyramid::Clear()
+{
+	m_sourceRevision = 0;
+	m_sourceDepth = 0;
+	m_sourceTimestamp = 0;
+	m_sourceFemtoseconds = 0;
+	m_sourceEnd = 0;
+	m_levels.clear();
+	m_bucketStarts.clear();
+	m_transitions.clear();
+	m_lastValues.clear();
+	m_first.clear();
+	m_second.clear();
+	m_counts.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Checks if the pyramid was built from the current revision of a waveform
+
+	@param data		The waveform the pyramid summarizes
+ */
+bool WaveformPyramid::IsCurrent(WaveformBase* data)
+{
+	return
+		(m_sourceDepth != 0) &&
+		(data->m_revision == m_sourceRevision) &&
+		(data->size() == m_sourceDepth) &&
+		(data->m_startTimestamp == m_sourceTimestamp) &&
+		(data->m_startFemtoseconds == m_sourceFemtoseconds);
+}
+
+/**
+	@brief Returns the coarsest level which still has enough samples per pixel to render faithfully
+
+	@param samplesPerPixel	Number of samples of the source waveform per pixel column at the current zoom
+
+	@return The level to render, or nullptr if the source waveform should be rendered directly
+ */
+WaveformBase* WaveformPyramid::GetLevelForSamplesPerPixel(float samplesPerPixel)
+{
+	if(m_sourceDepth == 0)
+		return nullptr;
+
+	for(size_t i=m_levels.size(); i>0; i--)
+	{
+		auto level = m_levels[i-1].get();
+		float levelSamplesPerPixel = samplesPerPixel * level->size() / m_sourceDepth;
+		if(levelSamplesPerPixel >= MIN_SAMPLES_PER_PIXEL)
+			return level;
+	}
+
+	return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pyramid construction
+
+/**
+	@brief Rebuilds the pyramid if the source waveform has changed since the last call
+
+	@param data		The waveform to summarize
+
+	@return True if a pyramid is available for this waveform, false if it's too small (or an unsupported type) and
+			should always be rendered directly
+ */
+bool WaveformPyramid::Update(WaveformBase* data)
+{
+	if( (data == nullptr) || (data->size() < MIN_DEPTH) )
+	{
+		Clear();
+		return false;
+	}
+
+	//Already up to date?
+	if(IsCurrent(data))
+		return true;
+
+	auto uadata = dynamic_cast<UniformAnalogWaveform*>(data);
+	auto sadata = dynamic_cast<SparseAnalogWaveform*>(data);
+	auto uddata = dynamic_cast<UniformDigitalWaveform*>(data);
+	auto sddata = dynamic_cast<SparseDigitalWaveform*>(data);
+	bool analog = (uadata || sadata);
+	bool digital = (uddata || sddata);
+	if(!analog && !digital)
+	{
+		Clear();
+		return false;
+	}
+
+	double tstart = GetTime();
+
+	m_sourceRevision = data->m_revision;
+	m_sourceDepth = data->size();
+	m_sourceTimestamp = data->m_startTimestamp;
+	m_sourceFemtoseconds = data->m_startFemtoseconds;
+	data->PrepareForCpuAccess();
+
+	auto sdata = dynamic_cast<SparseWaveformBase*>(data);
+	if(sdata)
+		m_sourceEnd = sdata->m_offsets[m_sourceDepth-1] + sdata->m_durations[m_sourceDepth-1];
+	else
+		m_sourceEnd = m_sourceDepth;
+
+	//Figure out how many levels we need
+	vector<size_t> bucketCounts;
+	size_t nbuckets = (m_sourceDepth + BASE_BUCKET_SIZE - 1) / BASE_BUCKET_SIZE;
+	while(true)
+	{
+		bucketCounts.push_back(nbuckets);
+		if(nbuckets < MIN_LEVEL_BUCKETS)
+			break;
+		nbuckets = (nbuckets + LEVEL_BUCKET_SIZE - 1) / LEVEL_BUCKET_SIZE;
+	}
+	size_t nlevels = bucketCounts.size();
+
+	//Reuse existing level buffers where possible to avoid reallocating pinned memory every acquisition
+	m_levels.resize(nlevels);
+	m_bucketStarts.resize(nlevels);
+	for(size_t i=0; i<nlevels; i++)
+	{
+		auto& level = m_levels[i];
+		if(analog && !dynamic_cast<SparseAnalogWaveform*>(level.get()))
+			level = make_unique<SparseAnalogWaveform>();
+		else if(digital && !dynamic_cast<SparseDigitalWaveform*>(level.get()))
+			level = make_unique<SparseDigitalWaveform>();
+
+		level->m_timescale = data->m_timescale;
+		level->m_triggerPhase = data->m_triggerPhase;
+		level->m_startTimestamp = data->m_startTimestamp;
+		level->m_startFemtoseconds = data->m_startFemtoseconds;
+		level->m_revision = data->m_revision;
+
+		m_bucketStarts[i].resize(bucketCounts[i] + 1);
+	}
+	if(digital)
+	{
+		m_transitions.resize(nlevels);
+		m_lastValues.resize(nlevels);
+		for(size_t i=0; i<nlevels; i++)
+		{
+			m_transitions[i].resize(bucketCounts[i]);
+			m_lastValues[i].resize(bucketCounts[i]);
+		}
+	}
+	else
+	{
+		m_transitions.clear();
+		m_lastValues.clear();
+	}
+
+	//Level 0 has the most buckets, so scratch space sized for it fits every level
+	m_first.resize(bucketCounts[0]);
+	m_second.resize(bucketCounts[0]);
+	m_counts.resize(bucketCounts[0]);
+
+	//Build level 0 from the source data
+	if(uadata)
+		BuildAnalogBaseLevel(uadata, dynamic_cast<SparseAnalogWaveform*>(m_levels[0].get()));
+	else if(sadata)
+		BuildAnalogBaseLevel(sadata, dynamic_cast<SparseAnalogWaveform*>(m_levels[0].get()));
+	else if(uddata)
+		BuildDigitalBaseLevel(uddata, dynamic_cast<SparseDigitalWaveform*>(m_levels[0].get()));
+	else
+		BuildDigitalBaseLevel(sddata, dynamic_cast<SparseDigitalWaveform*>(m_levels[0].get()));
+
+	//then each following level from its predecessor
+	for(size_t i=1; i<nlevels; i++)
+	{
+		if(analog)
+			BuildAnalogLevel(i);
+		else
+			BuildDigitalLevel(i);
+	}
+
+	for(auto& level : m_levels)
+		FinishLevel(dynamic_cast<SparseWaveformBase*>(level.get()), m_sourceEnd);
+
+	LogTrace("Built %zu-level waveform pyramid for %zu samples in %.2f ms\n",
+		nlevels, m_sourceDepth, (GetTime() - tstart) * 1000);
+
+	return true;
+}
+
+/**
+	@brief Lays out the buckets of a level once the number of samples each one emits (m_counts) is known
+
+	@param level		Index of the level
+	@param nbuckets		Number of buckets in the level
+
+	@return Total number of samples in the level
+ */
+size_t WaveformPyramid::AllocateBuckets(size_t level, size_t nbuckets)
+{
+	auto& starts = m_bucketStarts[level];
+	size_t total = 0;
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		starts[b] = total;
+		total += m_counts[b];
+	}
+	starts[nbuckets] = total;
+
+	m_levels[level]->Resize(total);
+	m_levels[level]->PrepareForCpuAccess();
+	return total;
+}
+
+/**
+	@brief Reduces each BASE_BUCKET_SIZE samples of an analog waveform to its minimum and maximum
+ */
+template<class T>
+void WaveformPyramid::BuildAnalogBaseLevel(T* data, SparseAnalogWaveform* out)
+{
+	size_t len = data->size();
+	size_t nbuckets = m_bucketStarts[0].size() - 1;
+	auto pin = data->m_samples.GetCpuPointer();
+
+	//Find the extrema of each bucket
+	#pragma omp parallel for
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		size_t start = b * BASE_BUCKET_SIZE;
+		size_t end = min(len, start + BASE_BUCKET_SIZE);
+
+		size_t imin = start;
+		size_t imax = start;
+		for(size_t i=start+1; i<end; i++)
+		{
+			if(pin[i] < pin[imin])
+				imin = i;
+			if(pin[i] > pin[imax])
+				imax = i;
+		}
+
+		//Emit them in the order they occurred, or just once for a flat bucket
+		m_first[b] = min(imin, imax);
+		m_second[b] = max(imin, imax);
+		m_counts[b] = (imin == imax) ? 1 : 2;
+	}
+
+	AllocateBuckets(0, nbuckets);
+
+	auto& starts = m_bucketStarts[0];
+	auto poff = out->m_offsets.GetCpuPointer();
+	auto psamp = out->m_samples.GetCpuPointer();
+
+	#pragma omp parallel for
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		size_t j = starts[b];
+		poff[j] = GetOffset(data, m_first[b]);
+		psamp[j] = pin[m_first[b]];
+		if(m_counts[b] == 2)
+		{
+			poff[j+1] = GetOffset(data, m_second[b]);
+			psamp[j+1] = pin[m_second[b]];
+		}
+	}
+}
+
+/**
+	@brief Merges each LEVEL_BUCKET_SIZE buckets of an analog level into one bucket of the next level
+ */
+void WaveformPyramid::BuildAnalogLevel(size_t level)
+{
+	auto in = dynamic_cast<SparseAnalogWaveform*>(m_levels[level-1].get());
+	auto out = dynamic_cast<SparseAnalogWaveform*>(m_levels[level].get());
+	auto& inStarts = m_bucketStarts[level-1];
+	size_t inBuckets = inStarts.size() - 1;
+	size_t nbuckets = m_bucketStarts[level].size() - 1;
+
+	auto pinOff = in->m_offsets.GetCpuPointer();
+	auto pinSamp = in->m_samples.GetCpuPointer();
+
+	#pragma omp parallel for
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		size_t start = inStarts[b * LEVEL_BUCKET_SIZE];
+		size_t end = inStarts[min(inBuckets, (b+1) * LEVEL_BUCKET_SIZE)];
+
+		size_t imin = start;
+		size_t imax = start;
+		for(size_t i=start+1; i<end; i++)
+		{
+			if(pinSamp[i] < pinSamp[imin])
+				imin = i;
+			if(pinSamp[i] > pinSamp[imax])
+				imax = i;
+		}
+
+		//Samples within a level are already in time order, so index order is time order
+		m_first[b] = min(imin, imax);
+		m_second[b] = max(imin, imax);
+		m_counts[b] = (imin == imax) ? 1 : 2;
+	}
+
+	AllocateBuckets(level, nbuckets);
+
+	auto& starts = m_bucketStarts[level];
+	auto poff = out->m_offsets.GetCpuPointer();
+	auto psamp = out->m_samples.GetCpuPointer();
+
+	#pragma omp parallel for
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		size_t j = starts[b];
+		poff[j] = pinOff[m_first[b]];
+		psamp[j] = pinSamp[m_first[b]];
+		if(m_counts[b] == 2)
+		{
+			poff[j+1] = pinOff[m_second[b]];
+			psamp[j+1] = pinSamp[m_second[b]];
+		}
+	}
+}
+
+/**
+	@brief Reduces each BASE_BUCKET_SIZE samples of a digital waveform to its initial value and activity
+ */
+template<class T>
+void WaveformPyramid::BuildDigitalBaseLevel(T* data, SparseDigitalWaveform* out)
+{
+	size_t len = data->size();
+	size_t nbuckets = m_bucketStarts[0].size() - 1;
+	auto pin = data->m_samples.GetCpuPointer();
+	auto& transitions = m_transitions[0];
+	auto& lastValues = m_lastValues[0];
+
+	//Count activity in each bucket
+	#pragma omp parallel for
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		size_t start = b * BASE_BUCKET_SIZE;
+		size_t end = min(len, start + BASE_BUCKET_SIZE);
+
+		uint64_t count = 0;
+		for(size_t i=start+1; i<end; i++)
+			count += (pin[i] != pin[i-1]);
+
+		transitions[b] = count;
+		lastValues[b] = pin[end-1];
+		m_counts[b] = count ? 2 : 1;
+	}
+
+	AllocateBuckets(0, nbuckets);
+
+	auto& starts = m_bucketStarts[0];
+	int64_t sourceEnd = m_sourceEnd;
+
+	#pragma omp parallel for
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		size_t start = b * BASE_BUCKET_SIZE;
+		size_t end = start + BASE_BUCKET_SIZE;
+
+		int64_t tstart = GetOffset(data, start);
+		int64_t tend = (end < len) ? GetOffset(data, end) : sourceEnd;
+		EmitDigitalBucket(out, starts[b], tstart, tend, pin[start], lastValues[b], transitions[b]);
+	}
+}
+
+/**
+	@brief Merges each LEVEL_BUCKET_SIZE buckets of a digital level into one bucket of the next level
+ */
+void WaveformPyramid::BuildDigitalLevel(size_t level)
+{
+	auto in = dynamic_cast<SparseDigitalWaveform*>(m_levels[level-1].get());
+	auto out = dynamic_cast<SparseDigitalWaveform*>(m_levels[level].get());
+	auto& inStarts = m_bucketStarts[level-1];
+	auto& inTransitions = m_transitions[level-1];
+	auto& inLastValues = m_lastValues[level-1];
+	auto& transitions = m_transitions[level];
+	auto& lastValues = m_lastValues[level];
+	size_t inBuckets = inStarts.size() - 1;
+	size_t nbuckets = m_bucketStarts[level].size() - 1;
+
+	auto pinOff = in->m_offsets.GetCpuPointer();
+	auto pinSamp = in->m_samples.GetCpuPointer();
+
+	#pragma omp parallel for
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		size_t start = b * LEVEL_BUCKET_SIZE;
+		size_t end = min(inBuckets, start + LEVEL_BUCKET_SIZE);
+
+		//Activity inside each child, plus any edges at the boundaries between adjacent children
+		uint64_t count = inTransitions[start];
+		for(size_t i=start+1; i<end; i++)
+			count += inTransitions[i] + (pinSamp[inStarts[i]] != inLastValues[i-1]);
+
+		transitions[b] = count;
+		lastValues[b] = inLastValues[end-1];
+		m_counts[b] = count ? 2 : 1;
+	}
+
+	AllocateBuckets(level, nbuckets);
+
+	auto& starts = m_bucketStarts[level];
+	int64_t sourceEnd = m_sourceEnd;
+
+	#pragma omp parallel for
+	for(size_t b=0; b<nbuckets; b++)
+	{
+		size_t start = b * LEVEL_BUCKET_SIZE;
+		size_t end = start + LEVEL_BUCKET_SIZE;
+
+		int64_t tstart = pinOff[inStarts[start]];
+		int64_t tend = (end < inBuckets) ? pinOff[inStarts[end]] : sourceEnd;
+		EmitDigitalBucket(
+			out, starts[b], tstart, tend, pinSamp[inStarts[start]], lastValues[b], transitions[b]);
+	}
+}
+
+/**
+	@brief Writes the display samples for one bucket of a digital level
+
+	The first sample is the initial value at the start of the bucket. If there was any activity in the bucket, a
+	second sample at the midpoint of the bucket is the final value if it differs from the initial one, or the inverse
+	of the initial value if there were an even number of transitions, so the burst still shows up as an edge.
+ */
+void WaveformPyramid::EmitDigitalBucket(
+	SparseDigitalWaveform* out,
+	size_t index,
+	int64_t start,
+	int64_t end,
+	bool first,
+	bool last,
+	uint64_t transitions)
+{
+	out->m_offsets[index] = start;
+	out->m_samples[index] = first;
+
+	if(transitions != 0)
+	{
+		out->m_offsets[index + 1] = start + (end - start) / 2;
+		out->m_samples[index + 1] = (first != last) ? last : !first;
+	}
+}
+
+/**
+	@brief Fills sample durations for a completed level and flags it as modified so it gets pushed to the GPU
+
+	@param level		The level to finish
+	@param endOffset	Offset of the end of the source waveform
+ */
+void WaveformPyramid::FinishLevel(SparseWaveformBase* level, int64_t endOffset)
+{
+	size_t len = level->size();
+	auto poff = level->m_offsets.GetCpuPointer();
+	auto pdur = level->m_durations.GetCpuPointer();
+
+	#pragma omp parallel for
+	for(size_t i=0; i<len-1; i++)
+		pdur[i] = poff[i+1] - poff[i];
+	pdur[len-1] = max((int64_t)1, endOffset - poff[len-1]);
+
+	level->MarkModifiedFromCpu();
+}
@@ -0,0 +1,164 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of WaveformPyramid
+	@ingroup datamodel
+ */
+#ifndef WaveformPyramid_h
+#define WaveformPyramid_h
+
+/**
+	@brief Multi-resolution min/max summary of a deep waveform, used to render zoomed-out views
+
+	Each level is itself a sparse waveform with the same timebase as the source waveform, so it can be fed to the
+	normal rendering shaders unmodified.
+
+	For analog waveforms, every bucket of the source is reduced to its minimum and maximum, in the order they occur,
+	at their original timestamps. Linear interpolation between consecutive points then covers exactly the same
+	vertical extent as the full resolution data would in each pixel column. If the minimum and maximum are the same
+	sample (a flat bucket), only that one sample is emitted.
+
+	For digital waveforms, every bucket is reduced to its initial value, plus a second sample with the opposite or
+	final value if there was any activity in the bucket, so that bursts of edges narrower than a pixel remain visible.
+	The number of transitions in each bucket is kept alongside so coarser levels can be merged without going back to
+	the source.
+
+	Level 0 is built from the source data, and each following level is built from the previous one, so the total cost
+	of building the pyramid is only slightly more than one pass over the source.
+
+	A pyramid is attached to each waveform (see WaveformBase::UpdatePyramid()) and built by the waveform processing
+	thread right after the filter graph has run, so rendering never has to wait for it.
+ */
+class WaveformPyramid
+{
+public:
+	WaveformPyramid();
+
+	void Clear();
+	bool Update(WaveformBase* data);
+	bool IsCurrent(WaveformBase* data);
+
+	WaveformBase* GetLevelForSamplesPerPixel(float samplesPerPixel);
+
+	///@brief Number of levels currently in the pyramid
+	size_t GetLevelCount()
+	{ return m_levels.size(); }
+
+	///@brief Gets a level of the pyramid (0 is the finest)
+	SparseWaveformBase* GetLevel(size_t i)
+	{ return dynamic_cast<SparseWaveformBase*>(m_levels[i].get()); }
+
+	/**
+		@brief Gets the index of the first sample of a bucket within a level
+
+		Bucket i of level n summarizes BASE_BUCKET_SIZE * LEVEL_BUCKET_SIZE^n source samples, and its samples are
+		[GetBucketStart(n, i), GetBucketStart(n, i+1)) of the level.
+	 */
+	size_t GetBucketStart(size_t level, size_t bucket)
+	{ return m_bucketStarts[level][bucket]; }
+
+	///@brief Number of source samples summarized by each bucket of level 0
+	static constexpr size_t BASE_BUCKET_SIZE = 64;
+
+	///@brief Number of buckets of a level merged into each bucket of the next level
+	static constexpr size_t LEVEL_BUCKET_SIZE = 8;
+
+	///@brief Minimum memory depth for which a pyramid is built at all
+	static constexpr size_t MIN_DEPTH = 1024 * 1024;
+
+	///@brief Stop adding levels once a level has fewer buckets than this
+	static constexpr size_t MIN_LEVEL_BUCKETS = 2048;
+
+	///@brief Minimum number of level samples per pixel a level must provide to be used for rendering
+	static constexpr float MIN_SAMPLES_PER_PIXEL = 8;
+
+protected:
+	template<class T>
+	void BuildAnalogBaseLevel(T* data, SparseAnalogWaveform* out);
+
+	template<class T>
+	void BuildDigitalBaseLevel(T* data, SparseDigitalWaveform* out);
+
+	void BuildAnalogLevel(size_t level);
+	void BuildDigitalLevel(size_t level);
+
+	size_t AllocateBuckets(size_t level, size_t nbuckets);
+
+	static void EmitDigitalBucket(
+		SparseDigitalWaveform* out,
+		size_t index,
+		int64_t start,
+		int64_t end,
+		bool first,
+		bool last,
+		uint64_t transitions);
+
+	static void FinishLevel(SparseWaveformBase* level, int64_t endOffset);
+
+	///@brief Revision of the source waveform the pyramid was last built from
+	uint64_t m_sourceRevision;
+
+	///@brief Number of samples in the source waveform
+	size_t m_sourceDepth;
+
+	///@brief Start time of the source waveform
+	time_t m_sourceTimestamp;
+
+	///@brief Fractional start time of the source waveform
+	int64_t m_sourceFemtoseconds;
+
+	///@brief Offset (in source timebase units) of the end of the last source sample
+	int64_t m_sourceEnd;
+
+	///@brief The levels of the pyramid, finest first
+	std::vector< std::unique_ptr<WaveformBase> > m_levels;
+
+	///@brief Index of the first sample of each bucket in each level, plus one past the end of the level
+	std::vector< std::vector<size_t> > m_bucketStarts;
+
+	///@brief Number of transitions in each bucket of each level (only used for digital waveforms)
+	std::vector< std::vector<uint64_t> > m_transitions;
+
+	///@brief Final value of each bucket of each level (only used for digital waveforms)
+	std::vector< std::vector<uint8_t> > m_lastValues;
+
+	///@brief Scratch space: index of the first sample to emit for each bucket of the level being built
+	std::vector<size_t> m_first;
+
+	///@brief Scratch space: index of the second sample to emit for each bucket of the level being built
+	std::vector<size_t> m_second;
+
+	///@brief Scratch space: number of samples to emit for each bucket of the level being built
+	std::vector<uint8_t> m_counts;
+};
+
+#endif
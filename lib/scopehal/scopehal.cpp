@@ -167,6 +167,7 @@ void TransportStaticInit()
 	AddTransportClass(SCPIUARTTransport);
 	AddTransportClass(SCPIHIDTransport);
 	AddTransportClass(SCPINullTransport);
+	AddTransportClass(SCPIReplayTransport);
 	AddTransportClass(VICPSocketTransport);
 
 	//SocketCAN is a Linux-specific feature
@@ -221,6 +222,8 @@ void DetectCPUFeatures()
 
 void ScopehalStaticCleanup()
 {
+	ExportWriter::CloseAll();
+	SParameterResampler::ClearCache();
 	VulkanCleanup();
 }
 
@@ -113,6 +113,7 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "Unit.h"
 #include "Bijection.h"
 #include "IDTable.h"
+#include "TraceRecorder.h"
 
 #include "AcceleratorBuffer.h"
 #include "ComputePipeline.h"
@@ -123,6 +124,7 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "SCPILinuxGPIBTransport.h"
 #include "SCPILxiTransport.h"
 #include "SCPINullTransport.h"
+#include "SCPIReplayTransport.h"
 #include "SCPIUARTTransport.h"
 #include "SCPIHIDTransport.h"
 #include "VICPSocketTransport.h"
@@ -158,6 +160,10 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "CANChannel.h"
 #include "Multimeter.h"
 #include "MultimeterChannel.h"
+#include "WaveformConversionQueue.h"
+#include "WaveformCodec.h"
+#include "ExportWriter.h"
+#include "MappedFile.h"
 #include "Oscilloscope.h"
 #include "SParameterChannel.h"
 #include "PowerSupply.h"
@@ -183,6 +189,11 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "SwitchMatrix.h"
 
 #include "SParameters.h"
+#include "QuadratureOscillator.h"
+#include "Histogram.h"
+#include "WaveformPyramid.h"
+#include "CpuRasterizer.h"
+#include "SParameterResampler.h"
 #include "TouchstoneParser.h"
 #include "IBISParser.h"
 
@@ -86,19 +86,22 @@ void AverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, shared_ptr<Queu
 		}
 		auto udata = dynamic_cast<UniformAnalogWaveform*>(data);
 		auto sdata = dynamic_cast<SparseAnalogWaveform*>(data);
-		double total = 0;
 		size_t len = data->size();
+		if(len == 0)
+			return;
 
+		//Only the new samples are touched, history is kept as a running sum
+		const float* samples = nullptr;
 		if(udata)
-		{
-			for(auto sample : udata->m_samples)
-				total += sample;
-		}
+			samples = udata->m_samples.GetCpuPointer();
 		else if(sdata)
-		{
-			for(auto sample : sdata->m_samples)
-				total += sample;
-		}
+			samples = sdata->m_samples.GetCpuPointer();
+		else
+			return;
+
+		double total = 0;
+		for(size_t i=0; i<len; i++)
+			total += samples[i];
 		m_pastCount += len;
 		m_pastSum += total;
 
@@ -70,11 +70,20 @@ void BINImportFilter::OnFileNameChanged()
 	int64_t fs = 0;
 	GetTimestampOfFile(fname, timestamp, fs);
 
-	string f = ReadFile(fname);
-	uint32_t fpos = 0;
+	MappedFile f;
+	if(!f.Open(fname))
+	{
+		LogError("Couldn't open BIN file \"%s\"\n", fname.c_str());
+		return;
+	}
+	size_t fpos = 0;
 
 	FileHeader fh;
-	f.copy((char*)&fh, sizeof(FileHeader), fpos);
+	if(!f.Read(fpos, fh))
+	{
+		LogError("Fail to read file header\n");
+		return;
+	}
 	fpos += sizeof(FileHeader);
 
 	//Get vendor from file signature
@@ -97,9 +106,10 @@ void BINImportFilter::OnFileNameChanged()
 	//LogDebug("File size: %i bytes\n", fh.length);
 	LogDebug("Waveforms: %i\n\n", fh.count);
 
-	//Process each stream in the file
+	//Walk the headers of each stream in the file, creating the output waveforms and finding the sample data
 	string hwname;
 	string serial;
+	vector<BufferInfo> buffers;
 	for(size_t i=0; i<fh.count; i++)
 	{
 		LogDebug("Waveform %i:\n", (int)i+1);
@@ -107,7 +117,11 @@ void BINImportFilter::OnFileNameChanged()
 
 		//Parse waveform header
 		WaveHeader wh;
-		f.copy((char*)&wh, sizeof(WaveHeader), fpos);
+		if(!f.Read(fpos, wh))
+		{
+			LogError("Fail to read header of waveform %zu\n", i+1);
+			break;
+		}
 		fpos += sizeof(WaveHeader);	//do not trust reported length in f.size
 
 		//TODO: make this metadata readable somewhere via properties etc
@@ -130,7 +144,7 @@ void BINImportFilter::OnFileNameChanged()
 		}
 
 		//Create output stream
-		string name = wh.label;
+		string name(wh.label, strnlen(wh.label, sizeof(wh.label)));
 		if(name == "")
 			name = string("CH") + to_string(i+1);
 
@@ -147,15 +161,77 @@ void BINImportFilter::OnFileNameChanged()
 		LogDebug("Label:        %s\n", name.c_str());
 		LogDebug("Serial:       %s\n\n", serial.c_str());
 
-		//Grab the initial data header and figure out what it is
-		DataHeader dh;
-		f.copy((char*)&dh, sizeof(DataHeader), fpos);
+		//Find all of the buffers for this waveform
+		bool digital = (wh.type == 6);
+		bool ok = true;
+		size_t nbuffers = buffers.size();
+		for(size_t j=0; j<wh.buffers; j++)
+		{
+			LogDebug("Buffer %i:\n", (int)j+1);
+			LogIndenter li_b;
+
+			//Parse waveform data header
+			DataHeader dh;
+			if(!f.Read(fpos, dh))
+			{
+				LogError("Fail to read header of buffer %zu\n", j+1);
+				ok = false;
+				break;
+			}
+			fpos += sizeof(DataHeader);
+
+			LogDebug("Data Type:      %i\n", dh.type);
+			LogDebug("Sample depth:   %i bits\n", dh.depth*8);
+			LogDebug("Buffer length:  %i KB\n\n\n", dh.length/1024);
 
-		//Digital logic waveform
-		if(wh.type == 6)
+			//Logic samples are 32-bit float counts (type 5) or unsigned 8-bit characters (type 6),
+			//analog samples are 32-bit floats
+			size_t width = sizeof(float);
+			if(digital)
+			{
+				if(dh.type == 6)
+					width = 1;
+				else if(dh.type != 5)
+				{
+					LogDebug("Invalid buffer type for logic waveform\n");
+					ok = false;
+					break;
+				}
+			}
+
+			//Make sure the samples are all in the file
+			if( (dh.depth < 0) || ( (wh.samples > 0) && !f.Contains(fpos, (static_cast<size_t>(wh.samples) - 1) * dh.depth + width) ) )
+			{
+				LogError("Sample data for buffer %zu is truncated\n", j+1);
+				ok = false;
+				break;
+			}
+
+			BufferInfo info;
+			info.m_offset = fpos;
+			info.m_stride = dh.depth;
+			info.m_type = dh.type;
+			info.m_stream = m_streams.size();
+			info.m_digital = digital;
+			info.m_start = j * wh.samples;
+			info.m_count = wh.samples;
+			buffers.push_back(info);
+
+			fpos += static_cast<size_t>(wh.samples) * dh.depth;
+		}
+
+		//Skip the whole waveform if anything was wrong with it, and don't look any further
+		if(!ok)
+		{
+			buffers.resize(nbuffers);
+			break;
+		}
+
+		size_t len = static_cast<size_t>(wh.buffers) * wh.samples;
+
+		//Digital logic waveform: create 8 streams of digital data
+		if(digital)
 		{
-			//Create 8 streams of digital data
-			vector<UniformDigitalWaveform*> wfms;
 			for(size_t j=0; j<8; j++)
 			{
 				AddStream(Unit(Unit::UNIT_VOLTS), name + "[" + to_string(j) + "]", Stream::STREAM_TYPE_DIGITAL);
@@ -165,62 +241,10 @@ void BINImportFilter::OnFileNameChanged()
 				wfm->m_startTimestamp = timestamp;
 				wfm->m_startFemtoseconds = fs;
 				wfm->m_triggerPhase = 0;
-				SetData(wfm, m_streams.size()-1);
-				wfms.push_back(wfm);
-
+				wfm->Resize(len);
 				wfm->PrepareForCpuAccess();
+				SetData(wfm, m_streams.size()-1);
 			}
-
-			for(size_t j=0; j<wh.buffers; j++)
-			{
-				LogDebug("Buffer %i:\n", (int)j+1);
-				LogIndenter li_b;
-
-				//Parse waveform data header
-				f.copy((char*)&dh, sizeof(DataHeader), fpos);
-				fpos += sizeof(DataHeader);
-
-				LogDebug("Data Type:      %i\n", dh.type);
-				LogDebug("Sample depth:   %i bits\n", dh.depth*8);
-				LogDebug("Buffer length:  %i KB\n\n\n", dh.length/1024);
-
-				for(size_t k=0; k<wh.samples; k++)
-				{
-					uint8_t s = -1;
-
-					//Logic samples (counts 32-bit float data waveforms)
-					if (dh.type == 5)
-					{
-						//Do not violate strict aliasing, compiler will optimize out the memcpy
-						float val;
-						memcpy(&val, f.c_str() + fpos, sizeof(float));
-						s = static_cast<uint8_t>(val);
-					}
-					//Logic samples (digital unsigned 8-bit character data)
-					else if (dh.type == 6)
-					{
-						s = *(uint8_t*)(f.c_str() + fpos);
-					}
-					else
-					{
-						LogDebug("Invalid buffer type for logic waveform\n");
-						return;
-					}
-
-					for(size_t m=0; m<8; m++)
-					{
-						if(s & (1 << m) )
-							wfms[m]->m_samples.push_back(true);
-						else
-							wfms[m]->m_samples.push_back(false);
-					}
-
-					fpos += dh.depth;
-				}
-			}
-
-			for(auto w : wfms)
-				w->MarkModifiedFromCpu();
 		}
 
 		//Analog waveform
@@ -234,36 +258,72 @@ void BINImportFilter::OnFileNameChanged()
 			wfm->m_startTimestamp = timestamp;
 			wfm->m_startFemtoseconds = fs;
 			wfm->m_triggerPhase = 0;
+			wfm->Resize(len);
 			wfm->PrepareForCpuAccess();
 			SetData(wfm, m_streams.size()-1);
+		}
+	}
 
-			for(size_t j=0; j<wh.buffers; j++)
-			{
-				LogDebug("Buffer %i:\n", (int)j+1);
-				LogIndenter li_b;
+	//Copy all buffers of all waveforms in parallel
+	auto data = f.GetData();
+	#pragma omp parallel for schedule(dynamic)
+	for(size_t i=0; i<buffers.size(); i++)
+	{
+		auto& info = buffers[i];
+		auto p = data + info.m_offset;
 
-				//Parse waveform data header
-				f.copy((char*)&dh, sizeof(DataHeader), fpos);
-				fpos += sizeof(DataHeader);
+		if(info.m_digital)
+		{
+			bool* samples[8];
+			for(size_t m=0; m<8; m++)
+				samples[m] = dynamic_cast<UniformDigitalWaveform*>(GetData(info.m_stream + m))->m_samples.GetCpuPointer();
 
-				LogDebug("Data Type:      %i\n", dh.type);
-				LogDebug("Sample depth:   %i bits\n", dh.depth*8);
-				LogDebug("Buffer length:  %i KB\n\n\n", dh.length/1024);
+			for(size_t k=0; k<info.m_count; k++)
+			{
+				uint8_t s;
 
-				//Float samples (analog waveforms)
-				for(size_t k=0; k<wh.samples; k++)
+				//Logic samples (counts 32-bit float data waveforms)
+				if(info.m_type == 5)
 				{
 					//Do not violate strict aliasing, compiler will optimize out the memcpy
-					float sample_f;
-					memcpy(&sample_f, f.c_str() + fpos, sizeof(float));
-					wfm->m_samples.push_back(sample_f);
-					fpos += dh.depth;
+					float val;
+					memcpy(&val, p, sizeof(float));
+					s = static_cast<uint8_t>(val);
 				}
+
+				//Logic samples (digital unsigned 8-bit character data)
+				else
+					s = *reinterpret_cast<const uint8_t*>(p);
+
+				for(size_t m=0; m<8; m++)
+					samples[m][info.m_start + k] = (s & (1 << m)) != 0;
+
+				p += info.m_stride;
 			}
+		}
 
-			wfm->MarkModifiedFromCpu();
+		else
+		{
+			auto samples = dynamic_cast<UniformAnalogWaveform*>(GetData(info.m_stream))->m_samples.GetCpuPointer();
+
+			//Float samples (analog waveforms)
+			//Do not violate strict aliasing, compiler will optimize out the memcpy
+			if(info.m_stride == sizeof(float))
+				memcpy(samples + info.m_start, p, info.m_count * sizeof(float));
+			else
+			{
+				for(size_t k=0; k<info.m_count; k++)
+				{
+					memcpy(samples + info.m_start + k, p, sizeof(float));
+					p += info.m_stride;
+				}
+			}
 		}
+	}
 
+	for(size_t i=0; i<m_streams.size(); i++)
+	{
+		GetData(i)->MarkModifiedFromCpu();
 		AutoscaleVertical(i);
 	}
 
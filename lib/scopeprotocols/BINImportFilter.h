@@ -87,6 +87,34 @@ public:
 
 protected:
 	void OnFileNameChanged();
+
+	/**
+		@brief Location of one buffer of samples in the file, and where its samples go
+	 */
+	class BufferInfo
+	{
+	public:
+		///@brief Offset of the first sample in the file
+		size_t m_offset;
+
+		///@brief Distance between consecutive samples in the file
+		size_t m_stride;
+
+		///@brief Sample data type
+		short m_type;
+
+		///@brief Index of the first stream the buffer is written to (eight consecutive streams for logic waveforms)
+		size_t m_stream;
+
+		///@brief True for logic waveforms
+		bool m_digital;
+
+		///@brief Index of the first output sample
+		size_t m_start;
+
+		///@brief Number of samples
+		size_t m_count;
+	};
 };
 
 #endif
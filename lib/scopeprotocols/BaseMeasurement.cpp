@@ -88,8 +88,9 @@ void BaseMeasurement::Refresh()
 	SetYAxisUnits(m_inputs[0].GetYAxisUnits(), 1);
 
 	//Make a histogram of the waveform
-	float vmin = GetMinVoltage(sin, uin);
-	float vmax = GetMaxVoltage(sin, uin);
+	float vmin;
+	float vmax;
+	GetMinMaxVoltage(sin, uin, vmin, vmax);
 	size_t nbins = 64;
 	vector<size_t> hist = MakeHistogram(sin, uin, vmin, vmax, nbins);
 
@@ -30,8 +30,6 @@
 #include "../scopehal/scopehal.h"
 #include "CSVExportFilter.h"
 
-#include <cinttypes>
-
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -100,59 +98,67 @@ void CSVExportFilter::Export()
 
 	//If file is not open, open it and write a header row
 	Unit xunit = GetInput(0).GetXAxisUnits();
-	if(!m_fp)
+	if(!m_writer.IsOpen())
 	{
 		auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
 
 		bool append = (mode == MODE_CONTINUOUS_APPEND) || (mode == MODE_MANUAL_APPEND);
-		if(append)
-			m_fp = fopen(m_parameters[m_fname].GetFileName().c_str(), "ab");
-		else
-			m_fp = fopen(m_parameters[m_fname].GetFileName().c_str(), "wb");
+		if(!m_writer.Open(m_parameters[m_fname].GetFileName(), append))
+			return;
 
 		//See if file is empty. If so, write header
-		fseek(m_fp, 0, SEEK_END);
-		if(ftell(m_fp) == 0)
+		if(m_writer.GetSize() == 0)
 		{
+			string header;
 			if(xunit == Unit(Unit::UNIT_FS))
-				fprintf(m_fp, "Time (s)");
+				header = "Time (s)";
 			else if(xunit == Unit(Unit::UNIT_HZ))
-				fprintf(m_fp, "Frequency (Hz)");
+				header = "Frequency (Hz)";
 			else
-				fprintf(m_fp, "X Unit");
+				header = "X Unit";
 
 			//Write other fields
 			for(size_t i=0; i<GetInputCount(); i++)
 			{
 				string colname = GetInput(i).GetName();
 				colname = str_replace(",", "_", colname);
-				fprintf(m_fp, ",%s", colname.c_str());
+				header += "," + colname;
 			}
-			fprintf(m_fp, "\n");
+			header += "\n";
+			m_writer.Write(header);
 		}
 	}
 
 	//Pre-cast some waveforms so we don't have to do it a lot
-	std::vector<SparseWaveformBase*> sparse;
-	std::vector<UniformWaveformBase*> uniform;
-	std::vector<SparseAnalogWaveform*> sa;
-	std::vector<UniformAnalogWaveform*> ua;
-	std::vector<SparseDigitalWaveform*> sd;
-	std::vector<UniformDigitalWaveform*> ud;
-	std::vector<size_t> indexes;
-	std::vector<size_t> lens;
-	for(size_t i=0; i<GetInputCount(); i++)
+	size_t ncols = GetInputCount();
+	vector<Column> columns;
+	vector<size_t> indexes;
+	vector<size_t> lens;
+	for(size_t i=0; i<ncols; i++)
 	{
 		auto data = GetInput(i).GetData();
-		sparse.push_back(dynamic_cast<SparseWaveformBase*>(data));
-		uniform.push_back(dynamic_cast<UniformWaveformBase*>(data));
-		sa.push_back(dynamic_cast<SparseAnalogWaveform*>(data));
-		ua.push_back(dynamic_cast<UniformAnalogWaveform*>(data));
-		sd.push_back(dynamic_cast<SparseDigitalWaveform*>(data));
-		ud.push_back(dynamic_cast<UniformDigitalWaveform*>(data));
+
+		Column col;
+		col.m_type = GetInput(i).GetType();
+		col.m_sparse = dynamic_cast<SparseWaveformBase*>(data);
+		col.m_uniform = dynamic_cast<UniformWaveformBase*>(data);
+		col.m_sa = dynamic_cast<SparseAnalogWaveform*>(data);
+		col.m_ua = dynamic_cast<UniformAnalogWaveform*>(data);
+		col.m_sd = dynamic_cast<SparseDigitalWaveform*>(data);
+		col.m_ud = dynamic_cast<UniformDigitalWaveform*>(data);
+		columns.push_back(col);
+
 		indexes.push_back(0);
 		lens.push_back(data->size());
 	}
+	bool timeInSeconds = (xunit == Unit(Unit::UNIT_FS));
+
+	//Walking the inputs to line up samples is inherently serial but cheap. Formatting the text is not, so figure out
+	//which sample of each input goes in each row for a batch of rows, then format chunks of the batch in parallel.
+	vector<int64_t> rowTimestamps;
+	vector<size_t> rowIndexes;
+	rowTimestamps.reserve(BATCH_ROWS);
+	rowIndexes.reserve(BATCH_ROWS * ncols);
 
 	//Main export path
 	int64_t timestamp = INT64_MIN;
@@ -164,8 +170,8 @@ void CSVExportFilter::Export()
 
 		//Find next edge on any input
 		int64_t next = INT64_MAX;
-		for(size_t i=0; i<GetInputCount(); i++)
-			next = min(next, GetNextEventTimestampScaled(sparse[i], uniform[i], indexes[i], lens[i], timestamp));
+		for(size_t i=0; i<ncols; i++)
+			next = min(next, GetNextEventTimestampScaled(columns[i].m_sparse, columns[i].m_uniform, indexes[i], lens[i], timestamp));
 
 		//If we can't advance any more, we're done
 		if( (next == INT64_MAX) || (next == timestamp) )
@@ -174,56 +180,114 @@ void CSVExportFilter::Export()
 		//First iteration is just indexing
 		if(!first)
 		{
-			//Write timestamp
-			if(xunit == Unit(Unit::UNIT_FS))
-				fprintf(m_fp, "%.10e", timestamp / FS_PER_SECOND);
-			else if(xunit == Unit(Unit::UNIT_HZ))
-				fprintf(m_fp, "%" PRId64 "", timestamp);
-			else
-				fprintf(m_fp, "%" PRId64 "", timestamp);
+			rowTimestamps.push_back(timestamp);
+			rowIndexes.insert(rowIndexes.end(), indexes.begin(), indexes.end());
 
-			//Write values
-			for(size_t i=0; i<GetInputCount(); i++)
+			if(rowTimestamps.size() == BATCH_ROWS)
 			{
-				switch(GetInput(i).GetType())
-				{
-					case Stream::STREAM_TYPE_ANALOG:
-					fprintf(m_fp, ",%f", GetValue(sa[i], ua[i], indexes[i]));
-					break;
-
-					case Stream::STREAM_TYPE_DIGITAL:
-						fprintf(m_fp, ",%d", GetValue(sd[i], ud[i], indexes[i]));
-						break;
-
-					case Stream::STREAM_TYPE_PROTOCOL:
-						if(sparse[i])
-							fprintf(m_fp, ",%s", sparse[i]->GetText(indexes[i]).c_str());
-						else
-							fprintf(m_fp, ",%s", uniform[i]->GetText(indexes[i]).c_str());
-						break;
-
-					default:
-						fprintf(m_fp, ",%s", "[unimplemented]");
-						break;
-				}
+				WriteRows(columns, timeInSeconds, rowTimestamps, rowIndexes);
+				rowTimestamps.clear();
+				rowIndexes.clear();
 			}
-			fprintf(m_fp, "\n");
 		}
 		first = false;
 
 		//All good, move on
 		timestamp = next;
-		for(size_t i=0; i<GetInputCount(); i++)
-			AdvanceToTimestampScaled(sparse[i], uniform[i], indexes[i], lens[i], timestamp);
+		for(size_t i=0; i<ncols; i++)
+			AdvanceToTimestampScaled(columns[i].m_sparse, columns[i].m_uniform, indexes[i], lens[i], timestamp);
+	}
+
+	WriteRows(columns, timeInSeconds, rowTimestamps, rowIndexes);
+
+	//Let the writer thread push everything to disk in the background
+	m_writer.Submit();
+}
+
+/**
+	@brief Formats a batch of rows in parallel and writes them to the file
+
+	@param columns			Input waveforms
+	@param timeInSeconds	True to print the X axis in seconds, false to print raw X axis values
+	@param timestamps		X axis value for each row
+	@param indexes			Sample index of each column for each row (row major)
+ */
+void CSVExportFilter::WriteRows(
+	const vector<Column>& columns,
+	bool timeInSeconds,
+	const vector<int64_t>& timestamps,
+	const vector<size_t>& indexes)
+{
+	size_t nrows = timestamps.size();
+	size_t ncols = columns.size();
+	size_t nchunks = (nrows + CHUNK_ROWS - 1) / CHUNK_ROWS;
+
+	vector<string> chunks(nchunks);
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(size_t i=0; i<nchunks; i++)
+	{
+		size_t start = i * CHUNK_ROWS;
+		size_t end = min(start + CHUNK_ROWS, nrows);
+		for(size_t j=start; j<end; j++)
+			FormatRow(chunks[i], columns, timeInSeconds, timestamps[j], &indexes[j * ncols]);
+	}
+
+	for(auto& c : chunks)
+		m_writer.Write(c);
+}
+
+/**
+	@brief Formats a single row of the file
+
+	The output matches what printf would produce for "%.10e" (time) and "%f" (analog values) in the C locale.
+ */
+void CSVExportFilter::FormatRow(
+	string& out,
+	const vector<Column>& columns,
+	bool timeInSeconds,
+	int64_t timestamp,
+	const size_t* indexes)
+{
+	//Write timestamp
+	if(timeInSeconds)
+		ExportWriter::AppendScientific(out, timestamp / FS_PER_SECOND, 10);
+	else
+		ExportWriter::AppendInteger(out, timestamp);
+
+	//Write values
+	for(size_t i=0; i<columns.size(); i++)
+	{
+		auto& col = columns[i];
+		out += ',';
+		switch(col.m_type)
+		{
+			case Stream::STREAM_TYPE_ANALOG:
+				ExportWriter::AppendFixed(out, GetValue(col.m_sa, col.m_ua, indexes[i]));
+				break;
+
+			case Stream::STREAM_TYPE_DIGITAL:
+				out += GetValue(col.m_sd, col.m_ud, indexes[i]) ? '1' : '0';
+				break;
+
+			case Stream::STREAM_TYPE_PROTOCOL:
+				if(col.m_sparse)
+					out += col.m_sparse->GetText(indexes[i]);
+				else
+					out += col.m_uniform->GetText(indexes[i]);
+				break;
+
+			default:
+				out += "[unimplemented]";
+				break;
+		}
 	}
+	out += '\n';
 }
 
 void CSVExportFilter::OnColumnCountChanged()
 {
 	//Close the existing file
-	if(m_fp)
-		fclose(m_fp);
-	m_fp = nullptr;
+	m_writer.Close();
 
 	//Add new ports
 	size_t sizeNew = m_parameters[m_inputCount].GetIntVal();
@@ -53,6 +53,37 @@ protected:
 
 	void OnColumnCountChanged();
 
+	///@brief Pre-cast pointers to one input, so rows can be formatted without repeated dynamic_cast
+	struct Column
+	{
+		Stream::StreamType m_type;
+		SparseWaveformBase* m_sparse;
+		UniformWaveformBase* m_uniform;
+		SparseAnalogWaveform* m_sa;
+		UniformAnalogWaveform* m_ua;
+		SparseDigitalWaveform* m_sd;
+		UniformDigitalWaveform* m_ud;
+	};
+
+	void WriteRows(
+		const std::vector<Column>& columns,
+		bool timeInSeconds,
+		const std::vector<int64_t>& timestamps,
+		const std::vector<size_t>& indexes);
+
+	static void FormatRow(
+		std::string& out,
+		const std::vector<Column>& columns,
+		bool timeInSeconds,
+		int64_t timestamp,
+		const size_t* indexes);
+
+	///@brief Number of rows to line up before formatting them
+	static constexpr size_t BATCH_ROWS = 262144;
+
+	///@brief Number of rows formatted by each thread at a time
+	static constexpr size_t CHUNK_ROWS = 4096;
+
 	std::string m_inputCount;
 };
 
@@ -66,6 +66,144 @@ string CSVImportFilter::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
+/**
+	@brief Splits a trimmed CSV line into a timestamp and data fields
+
+	A trailing empty field (from a comma at the end of the line) is ignored.
+
+	@param line		The line to split
+	@param time		Timestamp field
+	@param fields	Data fields
+
+	@return False if the line has no timestamp (no commas at all)
+ */
+static bool SplitRow(string_view line, string_view& time, vector<string_view>& fields)
+{
+	fields.clear();
+
+	auto comma = line.find(',');
+	if(comma == string_view::npos)
+		return false;
+	time = line.substr(0, comma);
+
+	size_t pos = comma + 1;
+	while(true)
+	{
+		auto next = line.find(',', pos);
+		if(next == string_view::npos)
+		{
+			if(pos < line.length())
+				fields.push_back(line.substr(pos));
+			break;
+		}
+
+		fields.push_back(line.substr(pos, next - pos));
+		pos = next + 1;
+	}
+	return true;
+}
+
+/**
+	@brief Checks if a line is a header row, i.e. has multiple fields and something other than numbers in it
+ */
+static bool IsHeaderRow(string_view line)
+{
+	if(line.find(',') == string_view::npos)
+		return false;
+
+	for(auto c : line)
+	{
+		if(	!isdigit(c) && !isspace(c) &&
+			(c != ',') && (c != '.') && (c != '-') && (c != 'e') && (c != '+'))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+	@brief Fills in the timestamps of a waveform, making each sample last until the next one starts
+
+	The last sample gets the same duration as the one before it.
+ */
+static void FillTimestamps(SparseWaveformBase* wfm, const vector<int64_t>& timestamps)
+{
+	size_t len = timestamps.size();
+	auto offsets = wfm->m_offsets.GetCpuPointer();
+	auto durations = wfm->m_durations.GetCpuPointer();
+
+	#pragma omp parallel for
+	for(size_t j=0; j<len; j++)
+	{
+		offsets[j] = timestamps[j];
+		if(j+1 < len)
+			durations[j] = timestamps[j+1] - timestamps[j];
+		else if(j > 0)
+			durations[j] = timestamps[j] - timestamps[j-1];
+		else
+			durations[j] = 1;
+	}
+}
+
+/**
+	@brief Extracts metadata from a comment line
+
+	@param s				The comment
+	@param digilentFormat	Set once we've seen the Digilent WaveForms header
+	@param timestamp		Start time of the waveform
+	@param fs				Fractional start time of the waveform
+ */
+void CSVImportFilter::ParseComment(const string& s, bool& digilentFormat, time_t& timestamp, int64_t& fs)
+{
+	if(s == "#Digilent WaveForms Oscilloscope Acquisition")
+	{
+		digilentFormat = true;
+		LogTrace("Found Digilent metadata header\n");
+	}
+
+	else if(digilentFormat)
+	{
+		if(s.find("#Date Time: ") == 0)
+		{
+			//yyyy-mm-dd hh:mm:ss.ms.us.ns
+			//No time zone information provided. For now, assume current time zone.
+			string stimestamp = s.substr(12);
+
+			tm now;
+			time_t tnow;
+			time(&tnow);
+			localtime_r(&tnow, &now);
+
+			tm stamp;
+			int ms;
+			int us;
+			int ns;
+			if(9 == sscanf(stimestamp.c_str(), "%d-%d-%d %d:%d:%d.%d.%d.%d",
+				&stamp.tm_year, &stamp.tm_mon, &stamp.tm_mday,
+				&stamp.tm_hour, &stamp.tm_min, &stamp.tm_sec,
+				&ms, &us, &ns))
+			{
+				//tm_year isn't absolute year, it's offset from 1900
+				stamp.tm_year -= 1900;
+
+				//TODO: figure out if this day/month/year was DST or not.
+				//For now, assume same as current. This is going to be off by an hour for half the year!
+				stamp.tm_isdst = now.tm_isdst;
+
+				//We can finally get the actual time_t
+				timestamp = mktime(&stamp);
+
+				//Convert to femtoseconds for internal scopehal format
+				fs = ms * 1000;
+				fs = (fs + us) * 1000;
+				fs = (fs + ns) * 1000;
+				fs *= 1000;
+			}
+		}
+	}
+}
+
 void CSVImportFilter::OnFileNameChanged()
 {
 	auto fname = m_parameters[m_fpname].ToString();
@@ -77,14 +215,15 @@ void CSVImportFilter::OnFileNameChanged()
 
 	//Set unit
 	SetXAxisUnits(Unit(static_cast<Unit::UnitType>(m_parameters[m_xunit].GetIntVal())));
+	bool fsUnits = (m_parameters[m_xunit].GetIntVal() == Unit::UNIT_FS);
 
 	//Set waveform timestamp to file timestamp
 	time_t timestamp = 0;
 	int64_t fs = 0;
 	GetTimestampOfFile(fname, timestamp, fs);
 
-	FILE* fp = fopen(fname.c_str(), "r");
-	if(!fp)
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		LogError("Couldn't open CSV file \"%s\"\n", fname.c_str());
 		return;
@@ -92,174 +231,129 @@ void CSVImportFilter::OnFileNameChanged()
 
 	ClearStreams();
 
-	//Read the file
+	//Read comments, metadata, and the header row (if any) up to the first line of data
+	const char* data = file.GetData();
+	const char* end = data + file.GetSize();
+	const char* p = data;
+	const char* dataStart = end;
 	vector<string> names;
-	vector< vector<string> > lines;
-	vector<int64_t> timestamps;
-	char line[1024];
-	bool digilentFormat;
+	bool digilentFormat = false;
 	size_t nrow = 0;
-	size_t ncols = 0;
-	while(!feof(fp))
+	while(p < end)
 	{
-		if(!fgets(line, sizeof(line), fp))
-			break;
-
+		auto lineStart = p;
+		auto line = MappedFile::Trim(MappedFile::GetLine(p, end));
 		nrow ++;
 
 		//Discard blank lines
-		string s = Trim(line);
-		if(s.empty())
+		if(line.empty())
 			continue;
 
 		//If the line starts with a #, it's a comment. Discard it, but save timestamp metadata if present
-		if(s[0] == '#')
+		if(line[0] == '#')
 		{
-			if(s == "#Digilent WaveForms Oscilloscope Acquisition")
-			{
-				digilentFormat = true;
-				LogTrace("Found Digilent metadata header\n");
-			}
-
-			else if(digilentFormat)
-			{
-				if(s.find("#Date Time: ") == 0)
-				{
-					//yyyy-mm-dd hh:mm:ss.ms.us.ns
-					//No time zone information provided. For now, assume current time zone.
-					string stimestamp = s.substr(12);
-
-					tm now;
-					time_t tnow;
-					time(&tnow);
-					localtime_r(&tnow, &now);
-
-					tm stamp;
-					int ms;
-					int us;
-					int ns;
-					if(9 == sscanf(stimestamp.c_str(), "%d-%d-%d %d:%d:%d.%d.%d.%d",
-						&stamp.tm_year, &stamp.tm_mon, &stamp.tm_mday,
-						&stamp.tm_hour, &stamp.tm_min, &stamp.tm_sec,
-						&ms, &us, &ns))
-					{
-						//tm_year isn't absolute year, it's offset from 1900
-						stamp.tm_year -= 1900;
-
-						//TODO: figure out if this day/month/year was DST or not.
-						//For now, assume same as current. This is going to be off by an hour for half the year!
-						stamp.tm_isdst = now.tm_isdst;
-
-						//We can finally get the actual time_t
-						timestamp = mktime(&stamp);
-
-						//Convert to femtoseconds for internal scopehal format
-						fs = ms * 1000;
-						fs = (fs + us) * 1000;
-						fs = (fs + ns) * 1000;
-						fs *= 1000;
-					}
-				}
-			}
+			ParseComment(string(line), digilentFormat, timestamp, fs);
 			continue;
 		}
 
-		//Parse into 2D vector of timestamps and strings
-		string tmp;
-		bool foundTimestamp = false;
-		vector<string> fields;
-		bool headerRow = false;
-		for(size_t i=0; i<s.length(); i++)
+		//Header row? Save the names, but not the name of the timestamp column
+		if(names.empty() && IsHeaderRow(line))
 		{
-			//End of field
-			if( (s[i] == ',') || (s[i] == '\n') )
-			{
-				//If this is the first row, check if it's numeric
-				if(names.empty() && timestamps.empty())
-				{
-					//See if it's a header row
-					for(size_t j=0; (j<sizeof(line)) && (line[j] != '\0'); j++)
-					{
-						auto c = line[j];
-						if(	!isdigit(c) && !isspace(c) &&
-							(c != ',') && (c != '.') && (c != '-') && (c != 'e') && (c != '+'))
-						{
-							headerRow = true;
-							auto trimline = Trim(line);
-							LogTrace("Found header row: %s\n", trimline.c_str());
-							break;
-						}
-					}
-
-					//Save the header values
-					if(headerRow)
-						fields.push_back(tmp);
-				}
+			LogTrace("Found header row: %s\n", string(line).c_str());
 
-				//If this is a header row, don't also try to parse it as a timestamp
-				if(headerRow)
-					continue;
+			string_view time;
+			vector<string_view> fields;
+			SplitRow(line, time, fields);
+			for(auto f : fields)
+				names.push_back(string(f));
+			continue;
+		}
 
-				//Load timestamp
-				if(!foundTimestamp)
-				{
-					foundTimestamp = true;
-
-					//Parse time to a float and convert to fs
-					if(m_parameters[m_xunit].GetIntVal() == Unit::UNIT_FS)
-					{
-						double timeSec;
-						if(tmp.find("e") == string::npos)
-							sscanf(tmp.c_str(), "%lf", &timeSec);
-						else
-							sscanf(tmp.c_str(), "%le", &timeSec);
-						timestamps.push_back(FS_PER_SECOND * timeSec);
-					}
-
-					//other units are as-is
-					else
-						timestamps.push_back(stoll(tmp));
-				}
+		//Nope, it's data
+		dataStart = lineStart;
+		nrow --;
+		break;
+	}
 
-				//Data field. Save it
-				else
-					fields.push_back(tmp);
-				tmp = "";
-			}
+	//Look at the first few rows of data to see how many columns there are and what's in them
+	size_t ncols = 0;
+	vector< vector<string_view> > firstRows;
+	p = dataStart;
+	while( (p < end) && (firstRows.size() < 10) )
+	{
+		auto line = MappedFile::Trim(MappedFile::GetLine(p, end));
+		if(line.empty() || (line[0] == '#'))
+			continue;
 
-			//Add to field
-			else
-				tmp += s[i];
+		string_view time;
+		vector<string_view> fields;
+		bool hasTime = SplitRow(line, time, fields);
+		if(firstRows.empty())
+		{
+			if(!hasTime)
+			{
+				LogError("Malformed file (first line of data has no timestamp)\n");
+				return;
+			}
+			ncols = fields.size();
 		}
-		if(tmp != "")
-			fields.push_back(tmp);
+		else if(!hasTime || (fields.size() != ncols) )
+			break;
+		firstRows.push_back(fields);
+	}
 
-		//Header row gets special treatment
-		if(headerRow)
+	//Split the rest of the file into blocks of whole lines, and count rows in each of them in parallel
+	auto blocks = file.SplitLines(dataStart - data, MappedFile::MIN_BLOCK_SIZE);
+	size_t nblocks = blocks.size() - 1;
+	vector<size_t> blockRows(nblocks, 0);
+	vector<size_t> blockLines(nblocks, 0);
+	vector<size_t> blockErrorFields(nblocks, 0);
+	vector<bool> blockError(nblocks, false);
+	#pragma omp parallel for
+	for(size_t i=0; i<nblocks; i++)
+	{
+		string_view time;
+		vector<string_view> fields;
+		const char* bp = data + blocks[i];
+		const char* bend = data + blocks[i+1];
+		while(bp < bend)
 		{
-			//delete name of timestamp column
-			fields.erase(fields.begin());
+			auto line = MappedFile::Trim(MappedFile::GetLine(bp, bend));
+			blockLines[i] ++;
+			if(line.empty() || (line[0] == '#'))
+				continue;
 
-			names = fields;
-			continue;
+			//Sanity check field count
+			if(!SplitRow(line, time, fields) || (fields.size() != ncols))
+			{
+				blockError[i] = true;
+				blockErrorFields[i] = fields.size();
+				break;
+			}
+			blockRows[i] ++;
 		}
+	}
 
-		//Sanity check field count
-		if(ncols == 0)
-			ncols = fields.size();
-		else if(ncols != fields.size())
+	//Stop at the first malformed line
+	vector<size_t> blockStartRow(nblocks, 0);
+	size_t nrows = 0;
+	for(size_t i=0; i<nblocks; i++)
+	{
+		blockStartRow[i] = nrows;
+		nrows += blockRows[i];
+
+		if(blockError[i])
 		{
 			LogError("Malformed file (line %zu contains %zu fields, but file started with %zu fields)\n",
-				nrow, fields.size(), ncols);
+				nrow + blockLines[i], blockErrorFields[i], ncols);
+			nblocks = i+1;
 			break;
 		}
-
-		lines.push_back(fields);
+		nrow += blockLines[i];
 	}
 
 	//Assign default names to channels if there's no header row or not enough names
-	LogTrace("Initial parsing completed, %zu lines, %zu columns, %zu names, %zu timestamps\n",
-		lines.size(), ncols, names.size(), timestamps.size());
+	LogTrace("Initial parsing completed, %zu lines, %zu columns, %zu names\n", nrows, ncols, names.size());
 	for(size_t i=0; i<ncols; i++)
 	{
 		if(names.size() <= i)
@@ -269,16 +363,17 @@ void CSVImportFilter::OnFileNameChanged()
 	//Figure out if channels are analog or digital and create output streams/waveforms
 	vector<SparseDigitalWaveform*> digwaves;
 	vector<SparseAnalogWaveform*> anwaves;
+	vector<bool*> digsamples;
+	vector<float*> ansamples;
 	for(size_t i=0; i<ncols; i++)
 	{
 		LogIndenter li2;
 
 		//Assume digital, then change to analog if we see anything other than a 0/1 in the first 10 lines
 		bool digital = true;
-		for(size_t j=0; j<lines.size() && j<10; j++)
+		for(auto& row : firstRows)
 		{
-			string field = lines[j][i];
-			if( (field != "0") && (field != "1") )
+			if( (row[i] != "0") && (row[i] != "1") )
 			{
 				digital = false;
 				break;
@@ -295,11 +390,13 @@ void CSVImportFilter::OnFileNameChanged()
 			wfm->m_startTimestamp = timestamp;
 			wfm->m_startFemtoseconds = fs;
 			wfm->m_triggerPhase = 0;
-			wfm->Resize(lines.size());
+			wfm->Resize(nrows);
 			digwaves.push_back(wfm);
+			digsamples.push_back(wfm->m_samples.GetCpuPointer());
 
 			//no analog waveform
 			anwaves.push_back(NULL);
+			ansamples.push_back(NULL);
 			SetData(wfm, i);
 		}
 		else
@@ -315,45 +412,78 @@ void CSVImportFilter::OnFileNameChanged()
 			wfm->m_startTimestamp = timestamp;
 			wfm->m_startFemtoseconds = fs;
 			wfm->m_triggerPhase = 0;
-			wfm->Resize(lines.size());
+			wfm->Resize(nrows);
 			anwaves.push_back(wfm);
+			ansamples.push_back(wfm->m_samples.GetCpuPointer());
 
 			//no digital waveform
 			digwaves.push_back(NULL);
+			digsamples.push_back(NULL);
 			SetData(wfm, i);
 		}
 	}
 
 	m_outputsChangedSignal.emit();
 
-	//Process each actual waveform and figure out how to handle it
-	for(size_t i=0; i<ncols; i++)
+	//Parse the actual data in parallel, straight into the output waveforms
+	vector<int64_t> timestamps(nrows);
+	#pragma omp parallel for
+	for(size_t i=0; i<nblocks; i++)
 	{
-		if(digwaves[i])
+		string_view time;
+		vector<string_view> fields;
+		const char* bp = data + blocks[i];
+		const char* bend = data + blocks[i+1];
+		size_t row = blockStartRow[i];
+		size_t rowEnd = row + blockRows[i];
+		while( (bp < bend) && (row < rowEnd) )
 		{
-			auto wfm = digwaves[i];
+			auto line = MappedFile::Trim(MappedFile::GetLine(bp, bend));
+			if(line.empty() || (line[0] == '#'))
+				continue;
+			SplitRow(line, time, fields);
 
-			//Read the sample data
-			auto nlines = min(lines.size(), timestamps.size());
-			for(size_t j=0; j<nlines; j++)
+			//Parse time to a float and convert to fs
+			if(fsUnits)
 			{
-				wfm->m_offsets[j] = timestamps[j];
-
-				//Last one? copy previous sample duration
-				if(j+1 == lines.size())
-					wfm->m_durations[j] = wfm->m_durations[j-1];
+				double timeSec = 0;
+				MappedFile::ParseDouble(time, timeSec);
+				timestamps[row] = static_cast<int64_t>(FS_PER_SECOND * timeSec);
+			}
 
-				//Set sample duration of previous sample
-				if(j > 0)
-					wfm->m_durations[j-1] = wfm->m_offsets[j] - wfm->m_offsets[j-1];
+			//other units are as-is
+			else
+			{
+				int64_t t = 0;
+				MappedFile::ParseInteger(time, t);
+				timestamps[row] = t;
+			}
 
-				//Read waveform data
-				if(lines[j][i] == "1")
-					wfm->m_samples[j] = true;
+			//Read waveform data
+			for(size_t j=0; j<ncols; j++)
+			{
+				if(digsamples[j])
+					digsamples[j][row] = (fields[j] == "1");
 				else
-					wfm->m_samples[j] = false;
+				{
+					float v = 0;
+					MappedFile::ParseFloat(fields[j], v);
+					ansamples[j][row] = v;
+				}
 			}
 
+			row ++;
+		}
+	}
+
+	//Process each actual waveform and figure out how to handle it
+	for(size_t i=0; i<ncols; i++)
+	{
+		if(digwaves[i])
+		{
+			auto wfm = digwaves[i];
+			FillTimestamps(wfm, timestamps);
+
 			if(TryNormalizeTimebase(wfm))
 			{
 				auto dense = new UniformDigitalWaveform(*wfm);
@@ -374,30 +504,7 @@ void CSVImportFilter::OnFileNameChanged()
 		else
 		{
 			auto wfm = anwaves[i];
-
-			//Read the sample data
-			auto nlines = min(lines.size(), timestamps.size());
-			for(size_t j=0; j<nlines; j++)
-			{
-				wfm->m_offsets[j] = timestamps[j];
-
-				//Last one? copy previous sample duration
-				if(j+1 == lines.size())
-					wfm->m_durations[j] = wfm->m_durations[j-1];
-
-				//Set sample duration of previous sample
-				if(j > 0)
-					wfm->m_durations[j-1] = wfm->m_offsets[j] - wfm->m_offsets[j-1];
-
-				//Read waveform data
-				float v;
-				auto tmp = lines[j][i];
-				if(tmp.find("e") == string::npos)
-					sscanf(tmp.c_str(), "%f", &v);
-				else
-					sscanf(tmp.c_str(), "%e", &v);
-				wfm->m_samples[j] = v;
-			}
+			FillTimestamps(wfm, timestamps);
 
 			if(TryNormalizeTimebase(wfm))
 			{
@@ -410,7 +517,7 @@ void CSVImportFilter::OnFileNameChanged()
 				wfm->MarkModifiedFromCpu();
 
 				//If we end up with zero length samples due to invalid configuration, nuke the channel
-				if(wfm->m_durations[0] == 0)
+				if(wfm->empty() || (wfm->m_durations[0] == 0) )
 					SetData(nullptr, i);
 			}
 		}
@@ -46,6 +46,7 @@ public:
 
 protected:
 	void OnFileNameChanged();
+	void ParseComment(const std::string& s, bool& digilentFormat, time_t& timestamp, int64_t& fs);
 
 	std::string m_xunit;
 	std::string m_yunit0;
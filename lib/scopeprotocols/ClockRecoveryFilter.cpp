@@ -29,6 +29,8 @@
 
 #include "../scopehal/scopehal.h"
 #include "ClockRecoveryFilter.h"
+#include <algorithm>
+#include <omp.h>
 
 #ifdef __x86_64__
 #include <immintrin.h>
@@ -56,6 +58,16 @@ ClockRecoveryFilter::ClockRecoveryFilter(const string& color)
 	m_parameters[m_threshname] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_VOLTS));
 	m_parameters[m_threshname].SetFloatVal(0);
 
+	m_parallelname = "Parallel PLL";
+	m_parameters[m_parallelname] = FilterParameter(FilterParameter::TYPE_BOOL, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_parallelname].SetBoolVal(false);
+
+	m_warmupname = "Lock-in Warmup";
+	m_parameters[m_warmupname] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_warmupname].SetIntVal(8192);
+
+	m_stitchFailures = 0;
+
 	#ifdef PLL_DEBUG_OUTPUTS
 	AddStream(Unit::UNIT_FS, "period", Stream::STREAM_TYPE_ANALOG);
 	AddStream(Unit::UNIT_FS, "dphase", Stream::STREAM_TYPE_ANALOG);
@@ -108,6 +120,9 @@ void ClockRecoveryFilter::Refresh(
 	[[maybe_unused]] vk::raii::CommandBuffer& cmdBuf,
 	[[maybe_unused]] shared_ptr<QueueHandle> queue)
 {
+	//Only the parallel path can have stitch failures, don't report stale ones from a previous refresh
+	m_stitchFailures = 0;
+
 	//Require a data signal, but not necessarily a gate
 	if(!VerifyInputOK(0))
 	{
@@ -178,10 +193,13 @@ void ClockRecoveryFilter::Refresh(
 	//The actual PLL NCO
 	//TODO: use the real fibre channel PLL.
 	cap->m_offsets.reserve(edges.size());
+	//Gating resets the PLL at arbitrary points, so that path is always serial
 	if(gate)
 		InnerLoopWithGating(*cap, edges, tend, initialPeriod, halfPeriod, fnyquist, gate, sgate, ugate);
+	else if(m_parameters[m_parallelname].GetBoolVal())
+		ParallelLoopWithNoGating(*cap, edges, tend, initialPeriod, halfPeriod, fnyquist);
 	else
-		InnerLoopWithNoGating(*cap, edges, tend, initialPeriod, halfPeriod, fnyquist);
+		InnerLoopWithNoGating(cap->m_offsets, edges, 0, edges.size()-1, tend, initialPeriod, halfPeriod, fnyquist);
 
 	//Generate the squarewave and duration values to match the calculated timestamps
 	//TODO: GPU this?
@@ -414,23 +432,35 @@ void ClockRecoveryFilter::InnerLoopWithGating(
 	//LogTrace("average phase error %zu\n", total_error);
 }
 
+/**
+	@brief Main PLL inner loop with no gating
+
+	@param offsets		Output buffer for timestamps of the recovered clock edges
+	@param edges		Timestamps of the data edges
+	@param nedgeStart	Index of the data edge to start the PLL at
+	@param nedgeEnd		Index of the data edge to stop the PLL at
+	@param tend			Timestamp of the end of the input waveform
+ */
+template<class T>
 void ClockRecoveryFilter::InnerLoopWithNoGating(
-	SparseDigitalWaveform& cap,
+	T& offsets,
 	vector<int64_t>& edges,
+	size_t nedgeStart,
+	size_t nedgeEnd,
 	int64_t tend,
 	int64_t initialPeriod,
 	int64_t halfPeriod,
 	int64_t fnyquist)
 {
-	size_t nedge = 1;
-	int64_t edgepos = edges[0];
+	size_t nedge = nedgeStart + 1;
+	int64_t edgepos = edges[nedgeStart];
 	int64_t period = initialPeriod;
 
 	[[maybe_unused]] int64_t total_error = 0;
 
 	float initialFrequency = 1.0 / initialPeriod;
 	int64_t glitchCutoff = initialPeriod / 10;
-	size_t edgemax = edges.size() - 1;
+	size_t edgemax = nedgeEnd;
 
 	int64_t tlast = 0;
 	for(; (edgepos < tend) && (nedge < edgemax); edgepos += period)
@@ -512,13 +542,137 @@ void ClockRecoveryFilter::InnerLoopWithNoGating(
 		}
 
 		//Add the sample (90 deg phase offset from the internal NCO)
-		cap.m_offsets.push_back(edgepos + center);
+		offsets.push_back(edgepos + center);
 	}
 
 	total_error /= edges.size();
 	//LogTrace("average phase error %zu\n", total_error);
 }
 
+/**
+	@brief Segmented PLL with no gating
+
+	The edge list is split into segments which are processed in parallel by independent PLLs. Each PLL starts a
+	configurable number of edges before its segment so it has time to lock by the time it gets there. The recovered
+	clocks are then stitched together at the last point in each overlap region where both PLLs put an edge at
+	(nearly) the same time. If there is no such point, the outputs are cut over at the segment boundary and the
+	failure is counted.
+ */
+void ClockRecoveryFilter::ParallelLoopWithNoGating(
+	SparseDigitalWaveform& cap,
+	vector<int64_t>& edges,
+	int64_t tend,
+	int64_t initialPeriod,
+	int64_t halfPeriod,
+	int64_t fnyquist)
+{
+	size_t nedges = edges.size();
+	size_t warmup = max((int64_t)2, m_parameters[m_warmupname].GetIntVal());
+
+	//A few segments per thread for load balancing, but keep each segment long enough
+	//that the warmup isn't a significant fraction of the total work
+	size_t nsegs = min(static_cast<size_t>(omp_get_max_threads()) * 4, nedges / (warmup * 8));
+	if(nsegs < 2)
+	{
+		InnerLoopWithNoGating(cap.m_offsets, edges, 0, nedges-1, tend, initialPeriod, halfPeriod, fnyquist);
+		return;
+	}
+	size_t seglen = nedges / nsegs;
+
+	//Run the PLLs
+	vector< vector<int64_t> > outputs(nsegs);
+	#pragma omp parallel for
+	for(size_t i=0; i<nsegs; i++)
+	{
+		size_t start = i*seglen;
+		if(i > 0)
+			start -= warmup;
+
+		size_t end = (i+1)*seglen;
+		if(i == nsegs-1)
+			end = nedges - 1;
+
+		outputs[i].reserve(2*(end - start));
+		InnerLoopWithNoGating(outputs[i], edges, start, end, tend, initialPeriod, halfPeriod, fnyquist);
+	}
+
+	//Clock edges closer together than this are considered to agree
+	int64_t tolerance = initialPeriod / 8;
+
+	//Figure out which range of each segment's output to keep
+	vector<size_t> keepStart(nsegs, 0);
+	vector<size_t> keepEnd(nsegs);
+	for(size_t i=0; i<nsegs; i++)
+		keepEnd[i] = outputs[i].size();
+	for(size_t i=1; i<nsegs; i++)
+	{
+		auto& prev = outputs[i-1];
+		auto& cur = outputs[i];
+
+		//Only look at the second half of the warmup period, so the new PLL has had some time to lock
+		int64_t tmin = edges[i*seglen - warmup/2];
+		size_t ia = lower_bound(prev.begin() + keepStart[i-1], prev.begin() + keepEnd[i-1], tmin) - prev.begin();
+		size_t ib = lower_bound(cur.begin(), cur.end(), tmin) - cur.begin();
+
+		//Find the last pair of edges in the overlap region that agree
+		bool found = false;
+		size_t besta = 0;
+		size_t bestb = 0;
+		while( (ia < keepEnd[i-1]) && (ib < cur.size()) )
+		{
+			int64_t delta = prev[ia] - cur[ib];
+			if(i64abs(delta) < tolerance)
+			{
+				found = true;
+				besta = ia;
+				bestb = ib;
+				ia ++;
+				ib ++;
+			}
+			else if(delta < 0)
+				ia ++;
+			else
+				ib ++;
+		}
+
+		if(found)
+		{
+			keepEnd[i-1] = besta + 1;
+			keepStart[i] = bestb + 1;
+		}
+
+		//No agreement, just cut over at the segment boundary
+		else
+		{
+			int64_t tcut = edges[i*seglen];
+			keepEnd[i-1] = lower_bound(prev.begin() + keepStart[i-1], prev.begin() + keepEnd[i-1], tcut) - prev.begin();
+			keepStart[i] = lower_bound(cur.begin(), cur.end(), tcut) - cur.begin();
+			m_stitchFailures ++;
+		}
+	}
+
+	if(m_stitchFailures)
+		LogTrace("PLL outputs did not agree at %zu of %zu segment boundaries\n", m_stitchFailures, nsegs-1);
+
+	//Copy the stitched output
+	vector<size_t> outStart(nsegs);
+	size_t total = 0;
+	for(size_t i=0; i<nsegs; i++)
+	{
+		outStart[i] = total;
+		total += keepEnd[i] - keepStart[i];
+	}
+	cap.m_offsets.resize(total);
+
+	#pragma omp parallel for
+	for(size_t i=0; i<nsegs; i++)
+	{
+		size_t len = keepEnd[i] - keepStart[i];
+		if(len)
+			memcpy(&cap.m_offsets[outStart[i]], &outputs[i][keepStart[i]], len * sizeof(int64_t));
+	}
+}
+
 #ifdef __x86_64__
 /**
 	@brief AVX2 optimized version of FillSquarewaveGeneric()
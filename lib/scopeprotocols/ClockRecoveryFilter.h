@@ -48,6 +48,10 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	///@brief Number of segment boundaries where the parallel PLL outputs did not agree during the last refresh
+	size_t GetStitchFailures()
+	{ return m_stitchFailures; }
+
 	PROTOCOL_DECODER_INITPROC(ClockRecoveryFilter)
 
 protected:
@@ -64,7 +68,18 @@ protected:
 		SparseDigitalWaveform* sgate,
 		UniformDigitalWaveform* ugate);
 
+	template<class T>
 	void InnerLoopWithNoGating(
+		T& offsets,
+		std::vector<int64_t>& edges,
+		size_t nedgeStart,
+		size_t nedgeEnd,
+		int64_t tend,
+		int64_t initialPeriod,
+		int64_t halfPeriod,
+		int64_t fnyquist);
+
+	void ParallelLoopWithNoGating(
 		SparseDigitalWaveform& cap,
 		std::vector<int64_t>& edges,
 		int64_t tend,
@@ -78,6 +93,11 @@ protected:
 
 	std::string m_baudname;
 	std::string m_threshname;
+	std::string m_parallelname;
+	std::string m_warmupname;
+
+	///@brief Number of segment boundaries where the parallel PLL outputs did not agree during the last refresh
+	size_t m_stitchFailures;
 };
 
 #endif
@@ -550,44 +550,12 @@ void CouplerSParameters::InterpolateSparameters(
 	else
 		m_cachedSparams.ConvertFromWaveforms(umag, uang);
 
-	m_resampledSparamSines.resize(nouts);
-	m_resampledSparamCosines.resize(nouts);
-
-	//De-embedding
-	if(invert)
-	{
-		for(size_t i=0; i<nouts; i++)
-		{
-			float freq = bin_hz * i;
-			auto pt = m_cachedSparams.InterpolatePoint(freq);
-			float mag = pt.m_amplitude;
-			float ang = pt.m_phase;
-
-			float amp = 0;
-			if(fabs(mag) > FLT_EPSILON)
-				amp = 1.0f / mag;
-			amp = min(amp, maxGain);
-
-			m_resampledSparamSines[i] = sin(-ang) * amp;
-			m_resampledSparamCosines[i] = cos(-ang) * amp;
-		}
-	}
-
-	//Channel emulation
-	else
-	{
-		for(size_t i=0; i<nouts; i++)
-		{
-			float freq = bin_hz * i;
-			auto pt = m_cachedSparams.InterpolatePoint(freq);
-			float mag = pt.m_amplitude;
-			float ang = pt.m_phase;
-
-			m_resampledSparamSines[i] = sin(ang) * mag;
-			m_resampledSparamCosines[i] = cos(ang) * mag;
-		}
-	}
-
-	m_resampledSparamSines.MarkModifiedFromCpu();
-	m_resampledSparamCosines.MarkModifiedFromCpu();
+	SParameterResampler::Resample(
+		m_cachedSparams,
+		bin_hz,
+		nouts,
+		invert,
+		maxGain,
+		m_resampledSparamSines,
+		m_resampledSparamCosines);
 }
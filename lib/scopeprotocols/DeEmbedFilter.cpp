@@ -227,7 +227,6 @@ void DeEmbedFilter::DoRefresh(bool invert, vk::raii::CommandBuffer& cmdBuf, shar
 	}
 
 	//Resample our parameter to our FFT bin size if needed.
-	//Cache trig function output because there's no AVX instructions for this.
 	if( (fabs(m_cachedBinSize - bin_hz) > FLT_EPSILON) || sizechange || clipchange || inchange)
 	{
 		m_resampledSparamCosines.clear();
@@ -342,7 +341,8 @@ int64_t DeEmbedFilter::GetGroupDelay()
 /**
 	@brief Recalculate the cached S-parameters (and clamp gain if requested)
 
-	Since there's no AVX sin/cos instructions, precompute sin(phase) and cos(phase)
+	The resampled sin(phase) and cos(phase) are shared with any other filter using the same S-parameters and bin size
+	(see SParameterResampler)
  */
 void DeEmbedFilter::InterpolateSparameters(float bin_hz, bool invert, size_t nouts)
 {
@@ -372,44 +372,12 @@ void DeEmbedFilter::InterpolateSparameters(float bin_hz, bool invert, size_t nou
 	else
 		m_cachedSparams.ConvertFromWaveforms(umag, uang);
 
-	m_resampledSparamSines.resize(nouts);
-	m_resampledSparamCosines.resize(nouts);
-
-	//De-embedding
-	if(invert)
-	{
-		for(size_t i=0; i<nouts; i++)
-		{
-			float freq = bin_hz * i;
-			auto pt = m_cachedSparams.InterpolatePoint(freq);
-			float mag = pt.m_amplitude;
-			float ang = pt.m_phase;
-
-			float amp = 0;
-			if(fabs(mag) > FLT_EPSILON)
-				amp = 1.0f / mag;
-			amp = min(amp, maxGain);
-
-			m_resampledSparamSines[i] = sin(-ang) * amp;
-			m_resampledSparamCosines[i] = cos(-ang) * amp;
-		}
-	}
-
-	//Channel emulation
-	else
-	{
-		for(size_t i=0; i<nouts; i++)
-		{
-			float freq = bin_hz * i;
-			auto pt = m_cachedSparams.InterpolatePoint(freq);
-			float mag = pt.m_amplitude;
-			float ang = pt.m_phase;
-
-			m_resampledSparamSines[i] = sin(ang) * mag;
-			m_resampledSparamCosines[i] = cos(ang) * mag;
-		}
-	}
-
-	m_resampledSparamSines.MarkModifiedFromCpu();
-	m_resampledSparamCosines.MarkModifiedFromCpu();
+	SParameterResampler::Resample(
+		m_cachedSparams,
+		bin_hz,
+		nouts,
+		invert,
+		maxGain,
+		m_resampledSparamSines,
+		m_resampledSparamCosines);
 }
@@ -108,73 +108,37 @@ void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/
 	m_xAxisUnit = m_inputs[0].m_channel->GetXAxisUnits();
 	SetYAxisUnits(m_inputs[0].GetYAxisUnits(), 0);
 
-	//See if we already had valid output data
-	auto cap = GetData(0);
-	auto scap = dynamic_cast<SparseAnalogWaveform*>(cap);
-	auto ucap = dynamic_cast<UniformAnalogWaveform*>(cap);
-	if(cap)
-		cap->PrepareForCpuAccess();
-
-	//Sparse path
+	//Set up the output, reusing the previous average if the input geometry is unchanged
+	bool reset;
+	WaveformBase* cap;
+	float* pout;
+	const float* pin;
 	if(sdin)
 	{
-		//No data? Just copy
-		if(!scap)
-		{
-			scap = new SparseAnalogWaveform;
-			scap->Resize(din->size());
-			cap = scap;
-
-			scap->m_samples.CopyFrom(sdin->m_samples);
-		}
-
-		//Actual filter code path
-		else
-		{
-			auto pin = sdin->m_samples.GetCpuPointer();
-			auto pout = scap->m_samples.GetCpuPointer();
-
-			for(size_t i=0; i<len; i++)
-				pout[i] = pout[i]*decay + pin[i]*(1-decay);
-		}
-
-		//Either way we want to reuse the timestamps
-		scap->CopyTimestamps(sdin);
+		auto scap = SetupPersistentSparseAnalogOutputWaveform(sdin, 0, reset);
+		cap = scap;
+		pout = scap->m_samples.GetCpuPointer();
+		pin = sdin->m_samples.GetCpuPointer();
 	}
-
-	//Uniform path
 	else
 	{
-		//No data? Just copy
-		if(!ucap)
-		{
-			ucap = new UniformAnalogWaveform;
-			ucap->Resize(din->size());
-			cap = ucap;
-
-			ucap->m_samples.CopyFrom(udin->m_samples);
-		}
-
-		//Actual filter code path
-		else
-		{
-			auto pin = udin->m_samples.GetCpuPointer();
-			auto pout = ucap->m_samples.GetCpuPointer();
-
-			for(size_t i=0; i<len; i++)
-				pout[i] = pout[i]*decay + pin[i]*(1-decay);
-		}
+		auto ucap = SetupPersistentUniformAnalogOutputWaveform(udin, 0, reset);
+		cap = ucap;
+		pout = ucap->m_samples.GetCpuPointer();
+		pin = udin->m_samples.GetCpuPointer();
 	}
 
-	//Update timestamps
-	cap->m_startTimestamp 		= din->m_startTimestamp;
-	cap->m_startFemtoseconds	= din->m_startFemtoseconds;
-	cap->m_triggerPhase			= din->m_triggerPhase;
-	cap->m_timescale			= din->m_timescale;
-	cap->m_revision ++;
+	//No data? Just copy
+	if(reset)
+		memcpy(pout, pin, len * sizeof(float));
+
+	//Actual filter code path
+	else
+	{
+		for(size_t i=0; i<len; i++)
+			pout[i] = pout[i]*decay + pin[i]*(1-decay);
+	}
 
-	//Done
-	SetData(cap, 0);
 	cap->MarkModifiedFromCpu();
 }
 
@@ -39,7 +39,6 @@ ExportFilter::ExportFilter(const string& color)
 	: Filter(color, CAT_EXPORT)
 	, m_fname("File name")
 	, m_mode("Update mode")
-	, m_fp(nullptr)
 {
 	//No output stream
 
@@ -66,9 +65,6 @@ ExportFilter::ExportFilter(const string& color)
 
 ExportFilter::~ExportFilter()
 {
-	if(m_fp)
-		fclose(m_fp);
-	m_fp = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -93,6 +89,15 @@ void ExportFilter::Refresh()
 	}
 }
 
+/**
+	@brief Returns true if the filter exports every time it's refreshed, false if it waits for the "Export" action
+ */
+bool ExportFilter::IsContinuous()
+{
+	auto mode = static_cast<ExportMode_t>(m_parameters[m_mode].GetIntVal());
+	return (mode == MODE_CONTINUOUS_APPEND) || (mode == MODE_CONTINUOUS_OVERWRITE);
+}
+
 vector<string> ExportFilter::EnumActions()
 {
 	vector<string> ret;
@@ -118,9 +123,7 @@ bool ExportFilter::PerformAction(const string& id)
  */
 void ExportFilter::OnFileNameChanged()
 {
-	if(m_fp)
-		fclose(m_fp);
-	m_fp = nullptr;
+	m_writer.Close();
 }
 
 /**
@@ -129,9 +132,7 @@ void ExportFilter::OnFileNameChanged()
 void ExportFilter::Clear()
 {
 	//Close the file if it was open
-	if(m_fp)
-		fclose(m_fp);
-	m_fp = nullptr;
+	m_writer.Close();
 
 	//Open and truncate it, but do not keep open (so the next Export() treats the file as not open and writes headers)
 	FILE* ftmp = fopen(m_parameters[m_fname].GetFileName().c_str(), "wb");
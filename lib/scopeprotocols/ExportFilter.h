@@ -53,6 +53,8 @@ public:
 	virtual std::vector<std::string> EnumActions() override;
 	virtual bool PerformAction(const std::string& id) override;
 
+	bool IsContinuous();
+
 protected:
 
 	/**
@@ -76,7 +78,8 @@ protected:
 	std::string m_fname;
 	std::string m_mode;
 
-	FILE* m_fp;
+	///@brief Output file (opened on the first export)
+	ExportWriter m_writer;
 
 	void OnFileNameChanged();
 };
@@ -30,6 +30,7 @@
 #include "../scopehal/scopehal.h"
 #include "EyePattern.h"
 #include <algorithm>
+#include <omp.h>
 #ifdef __x86_64__
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
@@ -260,27 +261,56 @@ void EyePattern::Refresh(
 	auto uwfm = dynamic_cast<UniformAnalogWaveform*>(waveform);
 	if(m_xscale > FLT_EPSILON)
 	{
-		//Optimized inner loop for uniformly sampled waveforms
-		if(uwfm)
+		//Split deep waveforms into chunks which can be accumulated in parallel
+		vector<size_t> chunkStarts;
+		vector<size_t> chunkClocks;
+		size_t nchunks = min(static_cast<size_t>(omp_get_max_threads()), wend / MIN_SAMPLES_PER_CHUNK);
+		bool parallel = false;
+		if(nchunks > 1)
 		{
-			#ifdef __x86_64__
-			if(g_hasAvx512F && g_hasFMA)
-				DensePackedInnerLoopAVX512F(uwfm, clock_edges, data, wend, cend, xmax, ymax, xtimescale, yscale, yoff);
-			else if(g_hasAvx2)
+			if(uwfm)
+				parallel = PlanChunks(uwfm, clock_edges, cend, wend, nchunks, chunkStarts, chunkClocks);
+			else
+				parallel = PlanChunks(swfm, clock_edges, cend, wend, nchunks, chunkStarts, chunkClocks);
+		}
+
+		if(!parallel)
+			InnerLoop(uwfm, swfm, clock_edges, data, 0, wend, 0, cend, xmax, ymax, xtimescale, yscale, yoff);
+
+		//Each chunk after the first goes into its own partial accumulator, then they're all summed.
+		//Integer addition is associative, so the result is bit-identical to a single pass over the whole waveform.
+		else
+		{
+			nchunks = chunkStarts.size();
+			size_t npixels = m_width * m_height;
+			m_partialAccumulators.resize(nchunks - 1);
+
+			#pragma omp parallel for schedule(static, 1)
+			for(size_t i=0; i<nchunks; i++)
 			{
-				if(g_hasFMA)
-					DensePackedInnerLoopAVX2FMA(uwfm, clock_edges, data, wend, cend, xmax, ymax, xtimescale, yscale, yoff);
-				else
-					DensePackedInnerLoopAVX2(uwfm, clock_edges, data, wend, cend, xmax, ymax, xtimescale, yscale, yoff);
+				int64_t* accum = data;
+				if(i > 0)
+				{
+					auto& partial = m_partialAccumulators[i-1];
+					partial.resize(npixels);
+					memset(partial.data(), 0, npixels * sizeof(int64_t));
+					accum = partial.data();
+				}
+
+				size_t iend = (i+1 < nchunks) ? chunkStarts[i+1] : wend;
+				InnerLoop(
+					uwfm, swfm, clock_edges, accum,
+					chunkStarts[i], iend, chunkClocks[i], cend,
+					xmax, ymax, xtimescale, yscale, yoff);
 			}
+
+			#ifdef __x86_64__
+			if(g_hasAvx2)
+				ReducePartialAccumulatorsAVX2(data, npixels);
 			else
 			#endif
-				DensePackedInnerLoop(uwfm, clock_edges, data, wend, cend, xmax, ymax, xtimescale, yscale, yoff);
+				ReducePartialAccumulators(data, npixels);
 		}
-
-		//Normal main loop
-		else
-			SparsePackedInnerLoop(swfm, clock_edges, data, wend, cend, xmax, ymax, xtimescale, yscale, yoff);
 	}
 
 	//Count total number of UIs we've integrated
@@ -294,13 +324,198 @@ void EyePattern::Refresh(
 		DoMaskTest(cap);
 }
 
+/**
+	@brief Runs the best available inner loop over samples istart to iend (exclusive) of the waveform
+
+	@param uwfm			The waveform, if uniformly sampled
+	@param swfm			The waveform, if sparsely sampled
+	@param clock_edges	Timestamps of the (center aligned) clock edges
+	@param data			Accumulator to add samples to
+	@param istart		First sample to process. Must be a multiple of CHUNK_ALIGNMENT.
+	@param iend			End of the sample range. Must be a multiple of CHUNK_ALIGNMENT, or the last sample.
+	@param iclockStart	Index of the clock edge which was current as of sample istart (see PlanChunks)
+ */
+void EyePattern::InnerLoop(
+	UniformAnalogWaveform* uwfm,
+	SparseAnalogWaveform* swfm,
+	vector<int64_t>& clock_edges,
+	int64_t* data,
+	size_t istart,
+	size_t iend,
+	size_t iclockStart,
+	size_t cend,
+	int32_t xmax,
+	int32_t ymax,
+	float xtimescale,
+	float yscale,
+	float yoff)
+{
+	//Optimized inner loop for uniformly sampled waveforms
+	if(uwfm)
+	{
+		#ifdef __x86_64__
+		if(g_hasAvx512F && g_hasFMA)
+		{
+			DensePackedInnerLoopAVX512F(
+				uwfm, clock_edges, data, istart, iend, iclockStart, cend, xmax, ymax, xtimescale, yscale, yoff);
+		}
+		else if(g_hasAvx2)
+		{
+			if(g_hasFMA)
+			{
+				DensePackedInnerLoopAVX2FMA(
+					uwfm, clock_edges, data, istart, iend, iclockStart, cend, xmax, ymax, xtimescale, yscale, yoff);
+			}
+			else
+			{
+				DensePackedInnerLoopAVX2(
+					uwfm, clock_edges, data, istart, iend, iclockStart, cend, xmax, ymax, xtimescale, yscale, yoff);
+			}
+		}
+		else
+		#endif
+		{
+			DensePackedInnerLoop(
+				uwfm, clock_edges, data, istart, iend, iclockStart, cend, xmax, ymax, xtimescale, yscale, yoff);
+		}
+	}
+
+	//Normal main loop
+	else
+		SparsePackedInnerLoop(swfm, clock_edges, data, istart, iend, iclockStart, cend, xmax, ymax, xtimescale, yscale, yoff);
+}
+
+static int64_t GetSampleTime(UniformAnalogWaveform* wfm, size_t i)
+{
+	return i * wfm->m_timescale + wfm->m_triggerPhase;
+}
+
+static int64_t GetSampleTime(SparseAnalogWaveform* wfm, size_t i)
+{
+	return wfm->m_offsets[i] * wfm->m_timescale + wfm->m_triggerPhase;
+}
+
+static int64_t GetMaxSampleSpacing(UniformAnalogWaveform* wfm, size_t /*wend*/)
+{
+	return wfm->m_timescale;
+}
+
+static int64_t GetMaxSampleSpacing(SparseAnalogWaveform* wfm, size_t wend)
+{
+	int64_t spacing = 0;
+	#pragma omp parallel for reduction(max:spacing)
+	for(size_t i=0; i<wend; i++)
+		spacing = max(spacing, wfm->m_offsets[i+1] - wfm->m_offsets[i]);
+	return spacing * wfm->m_timescale;
+}
+
+/**
+	@brief Splits the waveform into chunks which can be accumulated independently
+
+	The inner loops keep track of the current clock edge, moving on by at most one edge per sample. Once that has
+	caught up with the waveform, and as long as no UI is shorter than the gap between two samples, the current edge
+	after any sample is simply the last edge at or before that sample. This lets every chunk start with exactly the
+	same state a single pass over the whole waveform would have had at that point.
+
+	@param wfm			The waveform
+	@param clock_edges	Timestamps of the (center aligned) clock edges
+	@param cend			Index of the last clock edge
+	@param wend			Index of the last sample
+	@param nchunks		Desired number of chunks
+	@param starts		Output: first sample of each chunk
+	@param clocks		Output: index of the current clock edge at the start of each chunk
+
+	@return False if the waveform can't safely be split, and must be processed in one pass
+ */
+template<class T>
+bool EyePattern::PlanChunks(
+	T* wfm,
+	vector<int64_t>& clock_edges,
+	size_t cend,
+	size_t wend,
+	size_t nchunks,
+	vector<size_t>& starts,
+	vector<size_t>& clocks)
+{
+	if(cend < 1)
+		return false;
+
+	//Every UI must be longer than the largest gap between samples
+	int64_t minUI = INT64_MAX;
+	#pragma omp parallel for reduction(min:minUI)
+	for(size_t i=0; i<cend; i++)
+		minUI = min(minUI, clock_edges[i+1] - clock_edges[i]);
+	if(GetMaxSampleSpacing(wfm, wend) >= minUI)
+		return false;
+
+	//If the waveform starts after the first few clock edges, the inner loop lags behind for a while.
+	//Step through that exactly the same way the inner loop does.
+	size_t icaught = 0;
+	size_t iclock = 0;
+	for(; icaught < wend; icaught++)
+	{
+		if(GetSampleTime(wfm, icaught) < clock_edges[iclock+1])
+			break;
+		iclock ++;
+		if(iclock >= cend)
+			return false;
+	}
+
+	//Pick chunk boundaries after that point, and figure out which clock edge is current at each
+	size_t chunksize = (wend - icaught) / nchunks;
+	starts.clear();
+	clocks.clear();
+	starts.push_back(0);
+	clocks.push_back(0);
+	for(size_t i=1; i<nchunks; i++)
+	{
+		size_t start = icaught + i*chunksize;
+		start += CHUNK_ALIGNMENT - (start % CHUNK_ALIGNMENT);
+		if( (start >= wend) || (start <= starts.back()) )
+			continue;
+
+		//Last edge at or before the previous sample
+		auto tprev = GetSampleTime(wfm, start - 1);
+		size_t nbefore = upper_bound(clock_edges.begin(), clock_edges.end(), tprev) - clock_edges.begin();
+		size_t clock = (nbefore > 0) ? nbefore - 1 : 0;
+
+		starts.push_back(start);
+		clocks.push_back(min(clock, cend));
+	}
+
+	return (starts.size() > 1);
+}
+
+/**
+	@brief Adds the partial accumulators from all chunks after the first into the main accumulator
+ */
+void EyePattern::ReducePartialAccumulators(int64_t* data, size_t npixels)
+{
+	size_t nblocks = (npixels + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE;
+
+	#pragma omp parallel for
+	for(size_t i=0; i<nblocks; i++)
+	{
+		size_t start = i * REDUCE_BLOCK_SIZE;
+		size_t end = min(start + REDUCE_BLOCK_SIZE, npixels);
+		for(auto& partial : m_partialAccumulators)
+		{
+			auto p = partial.data();
+			for(size_t j=start; j<end; j++)
+				data[j] += p[j];
+		}
+	}
+}
+
 #ifdef __x86_64__
 __attribute__((target("avx2")))
 void EyePattern::DensePackedInnerLoopAVX2(
 	UniformAnalogWaveform* waveform,
 	vector<int64_t>& clock_edges,
 	int64_t* data,
-	size_t wend,
+	size_t istart,
+	size_t iend,
+	size_t iclockStart,
 	size_t cend,
 	int32_t xmax,
 	int32_t ymax,
@@ -313,9 +528,9 @@ void EyePattern::DensePackedInnerLoopAVX2(
 	int64_t width = cap->GetUIWidth();
 	int64_t halfwidth = width/2;
 
-	size_t iclock = 0;
+	size_t iclock = iclockStart;
 
-	size_t wend_rounded = wend - (wend % 8);
+	size_t iend_rounded = iend - (iend % 8);
 
 	//Splat some constants into vector regs
 	__m256i vxoff 		= _mm256_set1_epi32((int)m_xoff);
@@ -331,10 +546,10 @@ void EyePattern::DensePackedInnerLoopAVX2(
 	float* samples = (float*)&waveform->m_samples[0];
 
 	//Main unrolled loop, 8 samples per iteration
-	size_t i = 0;
+	size_t i = istart;
 	uint32_t bufmax = m_width * (m_height - 1);
 	__m256i vbufmax		= _mm256_set1_epi32(bufmax - 1);
-	for(; i<wend_rounded && iclock < cend; i+= 8)
+	for(; i<iend_rounded && iclock < cend; i+= 8)
 	{
 		//Figure out timestamp of this sample within the UI.
 		//This doesn't vectorize well, but it's pretty fast.
@@ -358,7 +573,7 @@ void EyePattern::DensePackedInnerLoopAVX2(
 				if(iclock >= cend)
 				{
 					//done, skip any trailing samples
-					for(; j<16; j++)
+					for(; j<8; j++)
 						offset[j] = -INT_MAX;
 					break;
 				}
@@ -436,7 +651,7 @@ void EyePattern::DensePackedInnerLoopAVX2(
 	}
 
 	//Catch any stragglers
-	for(; i<wend && iclock < cend; i++)
+	for(; i<iend && iclock < cend; i++)
 	{
 		//Find time of this sample.
 		//If it's past the end of the current UI, move to the next clock edge
@@ -497,7 +712,9 @@ void EyePattern::DensePackedInnerLoopAVX2FMA(
 	UniformAnalogWaveform* waveform,
 	vector<int64_t>& clock_edges,
 	int64_t* data,
-	size_t wend,
+	size_t istart,
+	size_t iend,
+	size_t iclockStart,
 	size_t cend,
 	int32_t xmax,
 	int32_t ymax,
@@ -510,9 +727,9 @@ void EyePattern::DensePackedInnerLoopAVX2FMA(
 	int64_t width = cap->GetUIWidth();
 	int64_t halfwidth = width/2;
 
-	size_t iclock = 0;
+	size_t iclock = iclockStart;
 
-	size_t wend_rounded = wend - (wend % 8);
+	size_t iend_rounded = iend - (iend % 8);
 
 	//Splat some constants into vector regs
 	__m256i vxoff 		= _mm256_set1_epi32((int)m_xoff);
@@ -528,10 +745,10 @@ void EyePattern::DensePackedInnerLoopAVX2FMA(
 	float* samples = (float*)&waveform->m_samples[0];
 
 	//Main unrolled loop, 8 samples per iteration
-	size_t i = 0;
+	size_t i = istart;
 	uint32_t bufmax = m_width * (m_height - 1);
 	__m256i vbufmax		= _mm256_set1_epi32(bufmax - 1);
-	for(; i<wend_rounded && iclock < cend; i+= 8)
+	for(; i<iend_rounded && iclock < cend; i+= 8)
 	{
 		//Figure out timestamp of this sample within the UI.
 		//This doesn't vectorize well, but it's pretty fast.
@@ -555,7 +772,7 @@ void EyePattern::DensePackedInnerLoopAVX2FMA(
 				if(iclock >= cend)
 				{
 					//done, skip any trailing samples
-					for(; j<16; j++)
+					for(; j<8; j++)
 						offset[j] = -INT_MAX;
 					break;
 				}
@@ -630,7 +847,7 @@ void EyePattern::DensePackedInnerLoopAVX2FMA(
 	}
 
 	//Catch any stragglers
-	for(; i<wend && iclock < cend; i++)
+	for(; i<iend && iclock < cend; i++)
 	{
 		//Find time of this sample.
 		//If it's past the end of the current UI, move to the next clock edge
@@ -691,7 +908,9 @@ void EyePattern::DensePackedInnerLoopAVX512F(
 	UniformAnalogWaveform* waveform,
 	vector<int64_t>& clock_edges,
 	int64_t* data,
-	size_t wend,
+	size_t istart,
+	size_t iend,
+	size_t iclockStart,
 	size_t cend,
 	int32_t xmax,
 	int32_t ymax,
@@ -704,9 +923,9 @@ void EyePattern::DensePackedInnerLoopAVX512F(
 	int64_t width = cap->GetUIWidth();
 	int64_t halfwidth = width/2;
 
-	size_t iclock = 0;
+	size_t iclock = iclockStart;
 
-	size_t wend_rounded = wend - (wend % 16);
+	size_t iend_rounded = iend - (iend % 16);
 
 	//Splat some constants into vector regs
 	__m512i vxoff 		= _mm512_set1_epi32((int)m_xoff);
@@ -721,9 +940,9 @@ void EyePattern::DensePackedInnerLoopAVX512F(
 	float* samples = (float*)&waveform->m_samples[0];
 
 	//Main unrolled loop, 16 samples per iteration
-	size_t i = 0;
+	size_t i = istart;
 	uint32_t bufmax = m_width * (m_height - 1);
-	for(; i<wend_rounded && iclock < cend; i+= 16)
+	for(; i<iend_rounded && iclock < cend; i+= 16)
 	{
 		//Figure out timestamp of this sample within the UI.
 		//This doesn't vectorize well, but it's pretty fast.
@@ -815,7 +1034,7 @@ void EyePattern::DensePackedInnerLoopAVX512F(
 	}
 
 	//Catch any stragglers
-	for(; i<wend && iclock < cend; i++)
+	for(; i<iend && iclock < cend; i++)
 	{
 		//Find time of this sample.
 		//If it's past the end of the current UI, move to the next clock edge
@@ -870,13 +1089,45 @@ void EyePattern::DensePackedInnerLoopAVX512F(
 		pix[m_width] += bin2;
 	}
 }
+
+__attribute__((target("avx2")))
+void EyePattern::ReducePartialAccumulatorsAVX2(int64_t* data, size_t npixels)
+{
+	size_t nblocks = (npixels + REDUCE_BLOCK_SIZE - 1) / REDUCE_BLOCK_SIZE;
+
+	#pragma omp parallel for
+	for(size_t i=0; i<nblocks; i++)
+	{
+		size_t start = i * REDUCE_BLOCK_SIZE;
+		size_t end = min(start + REDUCE_BLOCK_SIZE, npixels);
+		size_t end_rounded = end - ((end - start) % 4);
+
+		for(auto& partial : m_partialAccumulators)
+		{
+			auto p = partial.data();
+
+			size_t j = start;
+			for(; j<end_rounded; j += 4)
+			{
+				__m256i vdata = _mm256_loadu_si256(reinterpret_cast<__m256i*>(data + j));
+				__m256i vpart = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + j));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + j), _mm256_add_epi64(vdata, vpart));
+			}
+
+			for(; j<end; j++)
+				data[j] += p[j];
+		}
+	}
+}
 #endif /* __x86_64__ */
 
 void EyePattern::DensePackedInnerLoop(
 	UniformAnalogWaveform* waveform,
 	vector<int64_t>& clock_edges,
 	int64_t* data,
-	size_t wend,
+	size_t istart,
+	size_t iend,
+	size_t iclockStart,
 	size_t cend,
 	int32_t xmax,
 	int32_t ymax,
@@ -889,8 +1140,8 @@ void EyePattern::DensePackedInnerLoop(
 	int64_t width = cap->GetUIWidth();
 	int64_t halfwidth = width/2;
 
-	size_t iclock = 0;
-	for(size_t i=0; i<wend && iclock < cend; i++)
+	size_t iclock = iclockStart;
+	for(size_t i=istart; i<iend && iclock < cend; i++)
 	{
 		//Find time of this sample.
 		//If it's past the end of the current UI, move to the next clock edge
@@ -950,7 +1201,9 @@ void EyePattern::SparsePackedInnerLoop(
 	SparseAnalogWaveform* waveform,
 	vector<int64_t>& clock_edges,
 	int64_t* data,
-	size_t wend,
+	size_t istart,
+	size_t iend,
+	size_t iclockStart,
 	size_t cend,
 	int32_t xmax,
 	int32_t ymax,
@@ -963,8 +1216,8 @@ void EyePattern::SparsePackedInnerLoop(
 	int64_t width = cap->GetUIWidth();
 	int64_t halfwidth = width/2;
 
-	size_t iclock = 0;
-	for(size_t i=0; i<wend && iclock < cend; i++)
+	size_t iclock = iclockStart;
+	for(size_t i=istart; i<iend && iclock < cend; i++)
 	{
 		//Find time of this sample.
 		//If it's past the end of the current UI, move to the next clock edge
@@ -122,11 +122,41 @@ protected:
 
 	void RecalculateUIWidth(std::vector<int64_t>& clock_edges, EyeWaveform* cap);
 
+	void InnerLoop(
+		UniformAnalogWaveform* uwfm,
+		SparseAnalogWaveform* swfm,
+		std::vector<int64_t>& clock_edges,
+		int64_t* data,
+		size_t istart,
+		size_t iend,
+		size_t iclockStart,
+		size_t cend,
+		int32_t xmax,
+		int32_t ymax,
+		float xtimescale,
+		float yscale,
+		float yoff
+		);
+
+	template<class T>
+	bool PlanChunks(
+		T* wfm,
+		std::vector<int64_t>& clock_edges,
+		size_t cend,
+		size_t wend,
+		size_t nchunks,
+		std::vector<size_t>& starts,
+		std::vector<size_t>& clocks);
+
+	void ReducePartialAccumulators(int64_t* data, size_t npixels);
+
 	void SparsePackedInnerLoop(
 		SparseAnalogWaveform* waveform,
 		std::vector<int64_t>& clock_edges,
 		int64_t* data,
-		size_t wend,
+		size_t istart,
+		size_t iend,
+		size_t iclockStart,
 		size_t cend,
 		int32_t xmax,
 		int32_t ymax,
@@ -139,7 +169,9 @@ protected:
 		UniformAnalogWaveform* waveform,
 		std::vector<int64_t>& clock_edges,
 		int64_t* data,
-		size_t wend,
+		size_t istart,
+		size_t iend,
+		size_t iclockStart,
 		size_t cend,
 		int32_t xmax,
 		int32_t ymax,
@@ -153,7 +185,9 @@ protected:
 		UniformAnalogWaveform* waveform,
 		std::vector<int64_t>& clock_edges,
 		int64_t* data,
-		size_t wend,
+		size_t istart,
+		size_t iend,
+		size_t iclockStart,
 		size_t cend,
 		int32_t xmax,
 		int32_t ymax,
@@ -166,7 +200,9 @@ protected:
 		UniformAnalogWaveform* waveform,
 		std::vector<int64_t>& clock_edges,
 		int64_t* data,
-		size_t wend,
+		size_t istart,
+		size_t iend,
+		size_t iclockStart,
 		size_t cend,
 		int32_t xmax,
 		int32_t ymax,
@@ -179,7 +215,9 @@ protected:
 		UniformAnalogWaveform* waveform,
 		std::vector<int64_t>& clock_edges,
 		int64_t* data,
-		size_t wend,
+		size_t istart,
+		size_t iend,
+		size_t iclockStart,
 		size_t cend,
 		int32_t xmax,
 		int32_t ymax,
@@ -187,8 +225,22 @@ protected:
 		float yscale,
 		float yoff
 		);
+
+	void ReducePartialAccumulatorsAVX2(int64_t* data, size_t npixels);
 #endif
 
+	///@brief Don't bother splitting the waveform into chunks smaller than this
+	static constexpr size_t MIN_SAMPLES_PER_CHUNK = 256 * 1024;
+
+	///@brief Chunk boundaries are multiples of this, so the vector inner loops see the same blocks as a single pass
+	static constexpr size_t CHUNK_ALIGNMENT = 64;
+
+	///@brief Number of pixels summed by each thread at a time when reducing partial accumulators
+	static constexpr size_t REDUCE_BLOCK_SIZE = 4096;
+
+	///@brief Per-chunk accumulators for all but the first chunk of a parallel refresh
+	std::vector< std::vector<int64_t, AlignedAllocator<int64_t, 64> > > m_partialAccumulators;
+
 	size_t m_height;
 	size_t m_width;
 
@@ -162,8 +162,9 @@ void HistogramFilter::Refresh()
 	m_parameters[m_binSizeName].SetUnit(m_xAxisUnit);
 
 	//Calculate min/max of the input data
-	float nmin = GetMinVoltage(sdin, udin);
-	float nmax = GetMaxVoltage(sdin, udin);
+	float nmin;
+	float nmax;
+	GetMinMaxVoltage(sdin, udin, nmin, nmax);
 	LogTrace("nmin = %s, nmax = %s\n", xunit.PrettyPrint(nmin).c_str(), xunit.PrettyPrint(nmax).c_str());
 
 	//Calculate bin count
@@ -84,201 +84,29 @@ vector<string> I2CDecoder::GetHeaders()
 template<class T, class U>
 void I2CDecoder::InnerLoop(T* sda, U* scl, I2CWaveform* cap)
 {
-	Packet* pack = nullptr;
-
-	//Loop over the data and look for transactions
-	bool				last_scl = true;
-	bool 				last_sda = true;
-	int64_t				tstart	= 0;
-	I2CSymbol::stype	current_type = I2CSymbol::TYPE_ERROR;
-	uint8_t				current_byte = 0;
-	uint8_t				bitcount = 0;
-	bool				last_was_start	= 0;
-	size_t				sdalen = sda->size();
-	size_t 				scllen = scl->size();
-	size_t 				isda = 0;
-	size_t 				iscl = 0;
-	int64_t 			timestamp	= 0;
-
-	while(true)
-	{
-		bool cur_sda = sda->m_samples[isda];
-		bool cur_scl = scl->m_samples[iscl];
-
-		//SDA falling with SCL high is beginning of a start condition
-		if(!cur_sda && last_sda && cur_scl)
-		{
-			LogTrace("found i2c start at time %" PRId64 "\n", timestamp);
-
-			//If we're following an ACK, this is a restart
-			if(current_type == I2CSymbol::TYPE_DATA)
-			{
-				current_type = I2CSymbol::TYPE_RESTART;
-
-				//Finish existing packet, if we have one
-				if(pack)
-				{
-					pack->m_len = timestamp - pack->m_offset;
-					pack->m_headers["Len"] = to_string(pack->m_data.size());
-					m_packets.push_back(pack);
-					pack = nullptr;
-				}
-			}
-
-			//Otherwise, regular start
-			else
-			{
-				tstart = timestamp;
-				current_type = I2CSymbol::TYPE_START;
-			}
-
-			//Create a new packet. If we already have an incomplete one that got aborted, reset it
-			if(pack)
-			{
-				pack->m_data.clear();
-				pack->m_headers.clear();
-			}
-			else
-				pack = new Packet;
-			pack->m_offset = timestamp;
-			pack->m_len = 0;
-		}
-
-		//End a start bit when SDA goes high if the first data bit is a 1
-		//Otherwise end on a falling clock edge
-		else if( ((current_type == I2CSymbol::TYPE_START) || (current_type == I2CSymbol::TYPE_RESTART)) &&
-				(cur_sda || !cur_scl) )
-		{
-			cap->m_offsets.push_back(tstart);
-			cap->m_durations.push_back(timestamp - tstart);
-			cap->m_samples.push_back(I2CSymbol(current_type, 0));
-
-			last_was_start	= true;
-			current_type = I2CSymbol::TYPE_DATA;
-			tstart = timestamp;
-			bitcount = 0;
-			current_byte = 0;
-		}
-
-		//SDA rising with SCL high is a stop condition
-		else if(cur_sda && !last_sda && cur_scl)
-		{
-			LogTrace("found i2c stop at time %" PRIx64 "\n", timestamp);
-
-			cap->m_offsets.push_back(tstart);
-			cap->m_durations.push_back(timestamp - tstart);
-			cap->m_samples.push_back(I2CSymbol(I2CSymbol::TYPE_STOP, 0));
-
-			last_was_start	= false;
-
-			tstart = timestamp;
-
-			//Finish existing packet, if we have one
-			if(pack)
-			{
-				pack->m_len = timestamp - pack->m_offset;
-				pack->m_headers["Len"] = to_string(pack->m_data.size());
-				m_packets.push_back(pack);
-				pack = nullptr;
-			}
-		}
-
-		//On a rising SCL edge, end the current bit
-		else if(cur_scl && !last_scl)
-		{
-			if(current_type == I2CSymbol::TYPE_DATA)
-			{
-				//Save the current data bit
-				bitcount ++;
-				current_byte = (current_byte << 1);
-				if(cur_sda)
-					current_byte |= 1;
-
-				//Add a sample if the byte is over
-				if(bitcount == 8)
-				{
-					int64_t this_len = timestamp - tstart;
-
-					if(last_was_start)
-					{
-						//If the start bit was insanely long, shorten it
-						size_t nlast = cap->m_offsets.size() - 1;
-						if(cap->m_durations[nlast] > 3*this_len)
-						{
-							int64_t tend = cap->m_offsets[nlast] + cap->m_durations[nlast];
-							cap->m_durations[nlast] = this_len;
-							cap->m_offsets[nlast] = tend - this_len;
-						}
-
-						cap->m_samples.push_back(I2CSymbol(I2CSymbol::TYPE_ADDRESS, current_byte));
-
-						if(pack)
-						{
-							pack->m_headers["Address"] = to_string_hex(current_byte & 0xfe);
-							if(current_byte & 1)
-							{
-								pack->m_headers["Op"] = "Read";
-								pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
-							}
-							else
-							{
-								pack->m_headers["Op"] = "Write";
-								pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
-							}
-						}
-					}
-					else
-					{
-						cap->m_samples.push_back(I2CSymbol(I2CSymbol::TYPE_DATA, current_byte));
-
-						if(pack)
-							pack->m_data.push_back(current_byte);
-					}
+	I2CStateMachine<T, U> dec(sda, scl);
 
-					cap->m_offsets.push_back(tstart);
-					cap->m_durations.push_back(this_len);
+	//Split long captures into chunks at clock samples, and decode them in parallel
+	size_t scllen = scl->size();
+	size_t nchunks = GetChunkCount(scllen);
+	vector<int64_t> boundaries;
+	for(size_t i=1; i<nchunks; i++)
+		boundaries.push_back(GetOffsetScaled(scl, i * scllen / nchunks));
 
-					last_was_start	= false;
+	typename I2CStateMachine<T, U>::Output out;
+	ChunkedDecoder< I2CStateMachine<T, U> >::Decode(dec, boundaries, out);
 
-					bitcount = 0;
-					current_byte = 0;
-					tstart = timestamp;
-
-					current_type = I2CSymbol::TYPE_ACK;
-				}
-			}
-
-			//ACK/NAK
-			else if(current_type == I2CSymbol::TYPE_ACK)
-			{
-				cap->m_offsets.push_back(tstart);
-				cap->m_durations.push_back(timestamp - tstart);
-				cap->m_samples.push_back(I2CSymbol(I2CSymbol::TYPE_ACK, cur_sda));
-
-				last_was_start	= false;
-
-				tstart = timestamp;
-				current_type = I2CSymbol::TYPE_DATA;
-			}
-		}
-
-		//Save old state of both pins
-		last_sda = cur_sda;
-		last_scl = cur_scl;
-
-		//Move on
-		int64_t next_sda = Filter::GetNextEventTimestampScaled(sda, isda, sdalen, timestamp);
-		int64_t next_scl = Filter::GetNextEventTimestampScaled(scl, iscl, scllen, timestamp);
-		int64_t next_timestamp = min(next_sda, next_scl);
-		if(next_timestamp == timestamp)
-			break;
-		timestamp = next_timestamp;
-		Filter::AdvanceToTimestampScaled(sda, isda, sdalen, timestamp);
-		Filter::AdvanceToTimestampScaled(scl, iscl, scllen, timestamp);
+	size_t nsymbols = out.m_samples.size();
+	cap->Resize(nsymbols);
+	for(size_t i=0; i<nsymbols; i++)
+	{
+		cap->m_offsets[i] = out.m_offsets[i];
+		cap->m_durations[i] = out.m_durations[i];
+		cap->m_samples[i] = out.m_samples[i];
 	}
 
-	if(pack)
-		delete pack;
+	//Take ownership of the completed packets (an unfinished one is discarded along with the output)
+	m_packets.swap(out.m_packets);
 }
 
 void I2CDecoder::Refresh()
@@ -324,6 +152,239 @@ void I2CDecoder::Refresh()
 	cap->MarkModifiedFromCpu();
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// I2CStateMachine
+
+/**
+	@brief Gets a state at an arbitrary timestamp, waiting for the next start condition
+ */
+template<class T, class U>
+typename I2CStateMachine<T, U>::State I2CStateMachine<T, U>::Resync(int64_t position) const
+{
+	State s;
+	s.m_timestamp = position;
+	s.m_tstart = position;
+	s.m_isda = Filter::GetIndexAtTimestampScaled(m_sda, m_sdalen, position);
+	s.m_iscl = Filter::GetIndexAtTimestampScaled(m_scl, m_scllen, position);
+
+	//Start with the current pin state so we don't see a bogus edge
+	s.m_lastSda = m_sda->m_samples[s.m_isda];
+	s.m_lastScl = m_scl->m_samples[s.m_iscl];
+	return s;
+}
+
+template<class T, class U>
+void I2CStateMachine<T, U>::Append(Output& dst, Output& src, const Mark& from) const
+{
+	dst.m_offsets.insert(dst.m_offsets.end(), src.m_offsets.begin() + from.m_nsymbols, src.m_offsets.end());
+	dst.m_durations.insert(dst.m_durations.end(), src.m_durations.begin() + from.m_nsymbols, src.m_durations.end());
+	dst.m_samples.insert(dst.m_samples.end(), src.m_samples.begin() + from.m_nsymbols, src.m_samples.end());
+
+	//Packets (including the open one) are moved, and their copies in dst were identical so we can drop them
+	dst.m_packets.insert(dst.m_packets.end(), src.m_packets.begin() + from.m_npackets, src.m_packets.end());
+	src.m_packets.resize(from.m_npackets);
+
+	delete dst.m_pack;
+	dst.m_pack = src.m_pack;
+	src.m_pack = nullptr;
+}
+
+/**
+	@brief Finishes the open packet and adds it to the output
+ */
+template<class T, class U>
+void I2CStateMachine<T, U>::FinishPacket(State& s, Output& out) const
+{
+	auto pack = out.m_pack;
+	pack->m_len = s.m_timestamp - pack->m_offset;
+	pack->m_headers["Len"] = to_string(pack->m_data.size());
+	out.m_packets.push_back(pack);
+
+	out.m_pack = nullptr;
+	s.m_packOpen = false;
+	s.m_packOffset = 0;
+	s.m_packAddress = 0;
+	s.m_packLen = 0;
+}
+
+/**
+	@brief Processes the samples at the current timestamp and moves to the next event
+
+	@return False if we hit the end of the waveform
+ */
+template<class T, class U>
+bool I2CStateMachine<T, U>::Step(State& s, Output& out) const
+{
+	bool cur_sda = m_sda->m_samples[s.m_isda];
+	bool cur_scl = m_scl->m_samples[s.m_iscl];
+	int64_t timestamp = s.m_timestamp;
+
+	//SDA falling with SCL high is beginning of a start condition
+	if(!cur_sda && s.m_lastSda && cur_scl)
+	{
+		LogTrace("found i2c start at time %" PRId64 "\n", timestamp);
+
+		//If we're following an ACK, this is a restart
+		if(s.m_currentType == I2CSymbol::TYPE_DATA)
+		{
+			s.m_currentType = I2CSymbol::TYPE_RESTART;
+
+			//Finish existing packet, if we have one
+			if(out.m_pack)
+				FinishPacket(s, out);
+		}
+
+		//Otherwise, regular start
+		else
+		{
+			s.m_tstart = timestamp;
+			s.m_currentType = I2CSymbol::TYPE_START;
+		}
+
+		//Create a new packet. If we already have an incomplete one that got aborted, reset it
+		if(out.m_pack)
+		{
+			out.m_pack->m_data.clear();
+			out.m_pack->m_headers.clear();
+		}
+		else
+			out.m_pack = new Packet;
+		out.m_pack->m_offset = timestamp;
+		out.m_pack->m_len = 0;
+
+		s.m_packOpen = true;
+		s.m_packOffset = timestamp;
+		s.m_packAddress = 0;
+		s.m_packLen = 0;
+	}
+
+	//End a start bit when SDA goes high if the first data bit is a 1
+	//Otherwise end on a falling clock edge
+	else if( ((s.m_currentType == I2CSymbol::TYPE_START) || (s.m_currentType == I2CSymbol::TYPE_RESTART)) &&
+			(cur_sda || !cur_scl) )
+	{
+		out.push_back(s.m_tstart, timestamp - s.m_tstart, I2CSymbol(s.m_currentType, 0));
+
+		s.m_lastWasStart = true;
+		s.m_currentType = I2CSymbol::TYPE_DATA;
+		s.m_tstart = timestamp;
+		s.m_bitcount = 0;
+		s.m_currentByte = 0;
+	}
+
+	//SDA rising with SCL high is a stop condition
+	else if(cur_sda && !s.m_lastSda && cur_scl)
+	{
+		LogTrace("found i2c stop at time %" PRIx64 "\n", timestamp);
+
+		out.push_back(s.m_tstart, timestamp - s.m_tstart, I2CSymbol(I2CSymbol::TYPE_STOP, 0));
+
+		s.m_lastWasStart = false;
+
+		s.m_tstart = timestamp;
+
+		//Finish existing packet, if we have one
+		if(out.m_pack)
+			FinishPacket(s, out);
+	}
+
+	//On a rising SCL edge, end the current bit
+	else if(cur_scl && !s.m_lastScl)
+	{
+		if(s.m_currentType == I2CSymbol::TYPE_DATA)
+		{
+			//Save the current data bit
+			s.m_bitcount ++;
+			s.m_currentByte = (s.m_currentByte << 1);
+			if(cur_sda)
+				s.m_currentByte |= 1;
+
+			//Add a sample if the byte is over
+			if(s.m_bitcount == 8)
+			{
+				int64_t this_len = timestamp - s.m_tstart;
+				auto pack = out.m_pack;
+
+				if(s.m_lastWasStart)
+				{
+					//If the start bit was insanely long, shorten it
+					size_t nlast = out.m_offsets.size() - 1;
+					if(out.m_durations[nlast] > 3*this_len)
+					{
+						int64_t tend = out.m_offsets[nlast] + out.m_durations[nlast];
+						out.m_durations[nlast] = this_len;
+						out.m_offsets[nlast] = tend - this_len;
+					}
+
+					out.push_back(s.m_tstart, this_len, I2CSymbol(I2CSymbol::TYPE_ADDRESS, s.m_currentByte));
+
+					if(pack)
+					{
+						pack->m_headers["Address"] = to_string_hex(s.m_currentByte & 0xfe);
+						if(s.m_currentByte & 1)
+						{
+							pack->m_headers["Op"] = "Read";
+							pack->m_displayBackgroundColor =
+								PacketDecoder::m_backgroundColors[PacketDecoder::PROTO_COLOR_DATA_READ];
+						}
+						else
+						{
+							pack->m_headers["Op"] = "Write";
+							pack->m_displayBackgroundColor =
+								PacketDecoder::m_backgroundColors[PacketDecoder::PROTO_COLOR_DATA_WRITE];
+						}
+						s.m_packAddress = s.m_currentByte;
+					}
+				}
+				else
+				{
+					out.push_back(s.m_tstart, this_len, I2CSymbol(I2CSymbol::TYPE_DATA, s.m_currentByte));
+
+					if(pack)
+					{
+						pack->m_data.push_back(s.m_currentByte);
+						s.m_packLen ++;
+					}
+				}
+
+				s.m_lastWasStart = false;
+
+				s.m_bitcount = 0;
+				s.m_currentByte = 0;
+				s.m_tstart = timestamp;
+
+				s.m_currentType = I2CSymbol::TYPE_ACK;
+			}
+		}
+
+		//ACK/NAK
+		else if(s.m_currentType == I2CSymbol::TYPE_ACK)
+		{
+			out.push_back(s.m_tstart, timestamp - s.m_tstart, I2CSymbol(I2CSymbol::TYPE_ACK, cur_sda));
+
+			s.m_lastWasStart = false;
+
+			s.m_tstart = timestamp;
+			s.m_currentType = I2CSymbol::TYPE_DATA;
+		}
+	}
+
+	//Save old state of both pins
+	s.m_lastSda = cur_sda;
+	s.m_lastScl = cur_scl;
+
+	//Move on
+	int64_t next_sda = Filter::GetNextEventTimestampScaled(m_sda, s.m_isda, m_sdalen, timestamp);
+	int64_t next_scl = Filter::GetNextEventTimestampScaled(m_scl, s.m_iscl, m_scllen, timestamp);
+	int64_t next_timestamp = min(next_sda, next_scl);
+	if(next_timestamp == timestamp)
+		return false;
+	s.m_timestamp = next_timestamp;
+	Filter::AdvanceToTimestampScaled(m_sda, s.m_isda, m_sdalen, next_timestamp);
+	Filter::AdvanceToTimestampScaled(m_scl, s.m_iscl, m_scllen, next_timestamp);
+	return true;
+}
+
 std::string I2CWaveform::GetColor(size_t i)
 {
 	const I2CSymbol& s = m_samples[i];
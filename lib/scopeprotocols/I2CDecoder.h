@@ -78,6 +78,172 @@ public:
 	virtual std::string GetColor(size_t) override;
 };
 
+/**
+	@brief I2C state machine, for use with ChunkedDecoder
+
+	Position is the current timestamp. Every point just after an address byte is a sync point: the symbols before it
+	are never touched again, and the packet being built only depends on where it started and on the address.
+ */
+template<class T, class U>
+class I2CStateMachine
+{
+public:
+	I2CStateMachine(T* sda, U* scl)
+		: m_sda(sda)
+		, m_scl(scl)
+		, m_sdalen(sda->size())
+		, m_scllen(scl->size())
+	{}
+
+	/**
+		@brief Complete state of the decoder between two events
+	 */
+	class State
+	{
+	public:
+		State()
+			: m_lastScl(true)
+			, m_lastSda(true)
+			, m_tstart(0)
+			, m_currentType(I2CSymbol::TYPE_ERROR)
+			, m_currentByte(0)
+			, m_bitcount(0)
+			, m_lastWasStart(false)
+			, m_isda(0)
+			, m_iscl(0)
+			, m_timestamp(0)
+			, m_packOpen(false)
+			, m_packOffset(0)
+			, m_packAddress(0)
+			, m_packLen(0)
+		{}
+
+		bool operator==(const State& rhs) const
+		{
+			return
+				(m_lastScl == rhs.m_lastScl) &&
+				(m_lastSda == rhs.m_lastSda) &&
+				(m_tstart == rhs.m_tstart) &&
+				(m_currentType == rhs.m_currentType) &&
+				(m_currentByte == rhs.m_currentByte) &&
+				(m_bitcount == rhs.m_bitcount) &&
+				(m_lastWasStart == rhs.m_lastWasStart) &&
+				(m_isda == rhs.m_isda) &&
+				(m_iscl == rhs.m_iscl) &&
+				(m_timestamp == rhs.m_timestamp) &&
+				(m_packOpen == rhs.m_packOpen) &&
+				(m_packOffset == rhs.m_packOffset) &&
+				(m_packAddress == rhs.m_packAddress) &&
+				(m_packLen == rhs.m_packLen);
+		}
+
+		bool m_lastScl;
+		bool m_lastSda;
+		int64_t m_tstart;
+		I2CSymbol::stype m_currentType;
+		uint8_t m_currentByte;
+		uint8_t m_bitcount;
+		bool m_lastWasStart;
+		size_t m_isda;
+		size_t m_iscl;
+		int64_t m_timestamp;
+
+		///@brief True if Output::m_pack is valid
+		bool m_packOpen;
+
+		///@brief Start time of the open packet
+		int64_t m_packOffset;
+
+		///@brief Address byte of the open packet, if we've seen it yet
+		uint8_t m_packAddress;
+
+		///@brief Number of data bytes in the open packet
+		size_t m_packLen;
+	};
+
+	/**
+		@brief Decoded symbols and packets
+
+		The packet currently being built lives here rather than in the State, since it has to move along with the
+		output it belongs to.
+	 */
+	class Output
+	{
+	public:
+		Output()
+			: m_pack(nullptr)
+		{}
+
+		Output(const Output&) = delete;
+		Output& operator=(const Output&) = delete;
+
+		~Output()
+		{
+			for(auto p : m_packets)
+				delete p;
+			delete m_pack;
+		}
+
+		void push_back(int64_t offset, int64_t duration, I2CSymbol sample)
+		{
+			m_offsets.push_back(offset);
+			m_durations.push_back(duration);
+			m_samples.push_back(sample);
+		}
+
+		std::vector<int64_t> m_offsets;
+		std::vector<int64_t> m_durations;
+		std::vector<I2CSymbol> m_samples;
+
+		///@brief Completed packets (owned by this object)
+		std::vector<Packet*> m_packets;
+
+		///@brief The packet currently being built, if any (owned by this object)
+		Packet* m_pack;
+	};
+
+	/**
+		@brief Position within an Output
+	 */
+	class Mark
+	{
+	public:
+		Mark(size_t nsymbols = 0, size_t npackets = 0)
+			: m_nsymbols(nsymbols)
+			, m_npackets(npackets)
+		{}
+
+		size_t m_nsymbols;
+		size_t m_npackets;
+	};
+
+	State Begin() const
+	{ return State(); }
+
+	State Resync(int64_t position) const;
+
+	bool Step(State& s, Output& out) const;
+
+	int64_t GetPosition(const State& s) const
+	{ return s.m_timestamp; }
+
+	bool IsSyncPoint(const State& s) const
+	{ return s.m_packOpen && (s.m_packLen == 0) && (s.m_currentType == I2CSymbol::TYPE_ACK); }
+
+	Mark GetMark(const Output& out) const
+	{ return Mark(out.m_samples.size(), out.m_packets.size()); }
+
+	void Append(Output& dst, Output& src, const Mark& from) const;
+
+protected:
+	void FinishPacket(State& s, Output& out) const;
+
+	T* m_sda;
+	U* m_scl;
+	size_t m_sdalen;
+	size_t m_scllen;
+};
+
 class I2CDecoder : public PacketDecoder
 {
 public:
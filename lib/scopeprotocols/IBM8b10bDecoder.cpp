@@ -35,6 +35,12 @@
 
 #include "../scopehal/scopehal.h"
 #include "IBM8b10bDecoder.h"
+#ifdef __x86_64__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
 
 using namespace std;
 
@@ -85,9 +91,188 @@ string IBM8b10bDecoder::GetProtocolName()
 	return "8b/10b (IBM)";
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decode tables
+
+static const int code5_table[64] =
+{
+	 0,  0,  0,  0,  0, 23,  8,  7,	//00-07
+	 0, 27,  4, 20, 24, 12, 28, 28, //08-0f
+	 0, 29,  2, 18, 31, 10, 26, 15, //10-17
+	 0,  6, 22, 16, 14,  1, 30,  0,	//18-1f
+	 0, 30, 1,  17, 16,  9, 25,  0,	//20-27
+	15,  5, 21, 31, 13,  2, 29,  0,	//28-2f
+	28,  3, 19, 24, 11,  4, 27,  0,	//30-37
+	 7,  8, 23,  0,  0,  0,  0,  0  //38-3f
+};
+
+static const int disp5_table[64] =
+{
+	 0,  0,  0, 0,  0, -2, -2, 0,	//00-07
+	 0, -2, -2, 0, -2,  0,  0, 2,	//08-0f
+	 0, -2, -2, 0, -2,  0,  0, 2,	//10-17
+	-2,  0,  0, 2,  0,  2,  2, 0,	//18-1f
+	 0, -2, -2, 0, -2,  0,  0, 2,	//20-27
+	-2,  0,  0, 2,  0,  2,  2, 0,	//28-2f
+	-2,  0,  0, 2,  0,  2,  2, 0,	//30-37
+	 0,  2,  2, 0,  0,  0,  0, 0 	//38-3f
+};
+
+static const bool err5_table[64] =
+{
+	 true,  true,  true,  true,  true, false, false, false,	//00-07
+	 true, false, false, false, false, false, false, false, //08-0f
+	 true, false, false, false, false, false, false, false, //10-17
+	false, false, false, false, false, false, false,  true,	//18-1f
+	 true, false, false, false, false, false, false, false,	//20-27
+	false, false, false, false, false, false, false,  true,	//28-2f
+	false, false, false, false, false, false, false,  true,	//30-37
+	false, false, false,  true,  true,  true,  true,  true  //38-3f
+};
+
+static const bool ctl5_table[64] =
+{
+	false, false, false, false, false, false, false, false,	//00-07
+	false, false, false, false, false, false, false, true,  //08-0f
+	false, false, false, false, false, false, false, false, //10-17
+	false, false, false, false, false, false, false, false,	//18-1f
+	false, false, false, false, false, false, false, false,	//20-27
+	false, false, false, false, false, false, false, false,	//28-2f
+	true,  false, false, false, false, false, false, false,	//30-37
+	false, false, false, false, false, false, false, false  //38-3f
+};
+
+static const bool err3_ctl_table[16] =
+{
+	 true,  true, false, false, false, false, false, false,
+	false, false, false, false, false, false,  true,  true
+};
+
+static const int code3_pos_ctl_table[16] =	//if disp5 positive
+{
+	0, 0, 4, 3, 0, 2, 6, 7,
+	7, 1, 5, 0, 3, 4, 0, 0,
+};
+
+static const int code3_neg_ctl_table[16] =	//if disp5 negative
+{
+	0, 0, 4, 3, 0, 5, 1, 7,
+	7, 6, 2, 0, 3, 4, 0, 0
+};
+
+static const bool err3_table[16] =
+{
+	 true,  false, false, false, false, false, false, false,
+	false, false, false, false, false, false, false,  true
+};
+
+static const int code3_table[16] =
+{
+	0, 7, 4, 3, 0, 2, 6, 7,
+	7, 1, 5, 0, 3, 4, 7, 0
+};
+
+static const int disp3_table[16] =
+{
+	 0, -2, -2, 0, -2, 0, 0, 2,
+	-2, 0,  0, 2,  0, 2, 2, 0
+};
+
+//true only for Dx.A7
+static const bool alt3_table[16] =
+{
+	0, 0, 0, 0, 0, 0, 0, 1,
+	1, 0, 0, 0, 0, 0, 0, 0
+};
+
+/**
+	@brief Gets the combined 10b to 8b decode table
+
+	The table is indexed by a 10-bit code group with the first bit on the wire (a) in the LSB, which is the order
+	bits come out of the packed sample buffer. Each entry contains everything about the symbol that does not depend
+	on the running disparity, so the main decode loop is a single lookup per symbol.
+ */
+const IBM8b10bDecoder::DecodeTableEntry* IBM8b10bDecoder::GetDecodeTable()
+{
+	static const vector<DecodeTableEntry> table = BuildDecodeTable();
+	return &table[0];
+}
+
+/**
+	@brief Generates the combined decode table from the separate 5b/6b and 3b/4b tables
+ */
+vector<IBM8b10bDecoder::DecodeTableEntry> IBM8b10bDecoder::BuildDecodeTable()
+{
+	vector<DecodeTableEntry> table;
+	table.resize(1024);
+
+	for(unsigned int code=0; code<1024; code++)
+	{
+		//Convert back to the left-to-right bit ordering (abcdei fghj) used in the standard
+		unsigned int code6 = 0;
+		for(int j=0; j<6; j++)
+			code6 |= ((code >> j) & 1) << (5 - j);
+		unsigned int code4 = 0;
+		for(int j=0; j<4; j++)
+			code4 |= ((code >> (6 + j)) & 1) << (3 - j);
+
+		//5b/6b decode
+		int code5 = code5_table[code6];
+		int disp5 = disp5_table[code6];
+		bool err5 = err5_table[code6];
+		bool ctl5 = ctl5_table[code6];
+
+		//3b/4b decode
+		int code3 = 0;
+		bool err3 = false;
+		if(ctl5)
+		{
+			if(disp5 >= 0)
+				code3 = code3_pos_ctl_table[code4];
+			else
+				code3 = code3_neg_ctl_table[code4];
+			err3 = err3_ctl_table[code4];
+		}
+		else
+		{
+			code3 = code3_table[code4];
+			err3 = err3_table[code4];
+		}
+		int disp3 = disp3_table[code4];
+
+		//Special processing for a few control codes that use the .A7 format
+		if(alt3_table[code4])
+		{
+			if( (code5 == 23) || (code5 == 27) || (code5 == 29) || (code5 == 30) )
+				ctl5 = true;
+		}
+
+		auto& e = table[code];
+		e.m_data = (code3 << 5) | code5;
+		e.m_control = ctl5;
+		e.m_error5 = err5;
+		e.m_error3 = err3;
+		e.m_disparity = disp3 + disp5;
+	}
+
+	return table;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
+/**
+	@brief Extracts 64 consecutive bits from a packed bit buffer, starting at an arbitrary bit position
+ */
+static inline uint64_t ExtractBits(const uint64_t* bits, size_t pos)
+{
+	size_t word = pos >> 6;
+	size_t shift = pos & 63;
+	if(shift == 0)
+		return bits[word];
+	return (bits[word] >> shift) | (bits[word+1] << (64 - shift));
+}
+
 void IBM8b10bDecoder::Refresh()
 {
 	LogTrace("IBM8b10bDecoder::Refresh\n");
@@ -105,304 +290,319 @@ void IBM8b10bDecoder::Refresh()
 	din->PrepareForCpuAccess();
 	clkin->PrepareForCpuAccess();
 
-	//Create the capture
-	auto cap = new IBM8b10bWaveform(m_parameters[m_displayformat]);
-	cap->m_timescale = 1;
-	cap->m_startTimestamp = din->m_startTimestamp;
-	cap->m_startFemtoseconds = din->m_startFemtoseconds;
-	cap->PrepareForCpuAccess();
-
 	//Record the value of the data stream at each clock edge
 	//TODO: allow single rate clocks too?
 	SparseDigitalWaveform data;
 	SampleOnAnyEdgesBase(din, clkin, data);
 	data.PrepareForCpuAccess();
 
-	//Preallocate output buffer
-	cap->Reserve(data.m_samples.size() / 10);
-
-	//Decode the actual data
-	int last_disp = -1;
-	bool first = true;
 	size_t nsamples = data.m_samples.size();
 	if(nsamples < 11)
 	{
 		SetData(nullptr, 0);
 		return;
 	}
-	size_t dlen = nsamples - 11;
-	int64_t lastSymbolLength = 0;
-	int64_t lastSymbolEnd = 0;
-	int64_t lastSymbolStart = 0;
-	for(size_t i=0; i<dlen;i+=10)
+
+	//Pack the sampled data 64 UIs to a word so we can look at many bit positions at once
+	vector<uint64_t> bits;
+	PackBits(data, bits);
+
+	//Split the capture into segments at each gap (squelch closing, end of a burst, etc).
+	//Each segment has to be aligned separately, but can then be decoded independently of the others.
+	//Anything more than three symbols with no clock edges is considered a gap.
+	vector<Segment> segments;
+	size_t segstart = 0;
+	for(size_t i=2; i<nsamples; i++)
 	{
-		//Re-synchronize at start of waveform or if squelch is reopening
-		//If we have a gap
-		if(i == 0)
-			first = true;
-		if( (data.m_offsets[i] - lastSymbolEnd) > 3*lastSymbolLength)
-			first = true;
-		if(first)
+		int64_t ui = data.m_offsets[i] - data.m_offsets[i-1];
+		int64_t lastui = data.m_offsets[i-1] - data.m_offsets[i-2];
+		if(ui > 30*lastui)
 		{
-			LogTrace("Realigning at t=%s\n", Unit(Unit::UNIT_FS).PrettyPrint(data.m_offsets[i]).c_str());
-			Align(data, i);
+			segments.push_back(Segment(segstart, i));
+			segstart = i;
 		}
+	}
+	segments.push_back(Segment(segstart, nsamples));
+	LogTrace("Found %zu segments\n", segments.size());
 
-		//5b/6b decode
-
-		uint8_t code6 =
-			(data.m_samples[i+0] ? 32 : 0) |
-			(data.m_samples[i+1] ? 16 : 0) |
-			(data.m_samples[i+2] ? 8 : 0) |
-			(data.m_samples[i+3] ? 4 : 0) |
-			(data.m_samples[i+4] ? 2 : 0) |
-			(data.m_samples[i+5] ? 1 : 0);
+	//Find symbol alignment within each segment
+	size_t nsegs = segments.size();
+	#pragma omp parallel for schedule(dynamic)
+	for(size_t i=0; i<nsegs; i++)
+	{
+		auto& seg = segments[i];
+		seg.m_start += Align(bits, seg.m_start, seg.m_end);
 
-		static const int code5_table[64] =
-		{
-			 0,  0,  0,  0,  0, 23,  8,  7,	//00-07
-			 0, 27,  4, 20, 24, 12, 28, 28, //08-0f
-			 0, 29,  2, 18, 31, 10, 26, 15, //10-17
-			 0,  6, 22, 16, 14,  1, 30,  0,	//18-1f
-			 0, 30, 1,  17, 16,  9, 25,  0,	//20-27
-			15,  5, 21, 31, 13,  2, 29,  0,	//28-2f
-			28,  3, 19, 24, 11,  4, 27,  0,	//30-37
-			 7,  8, 23,  0,  0,  0,  0,  0  //38-3f
-		};
-
-		static const int disp5_table[64] =
-		{
-			 0,  0,  0, 0,  0, -2, -2, 0,	//00-07
-			 0, -2, -2, 0, -2,  0,  0, 2,	//08-0f
-			 0, -2, -2, 0, -2,  0,  0, 2,	//10-17
-			-2,  0,  0, 2,  0,  2,  2, 0,	//18-1f
-			 0, -2, -2, 0, -2,  0,  0, 2,	//20-27
-			-2,  0,  0, 2,  0,  2,  2, 0,	//28-2f
-			-2,  0,  0, 2,  0,  2,  2, 0,	//30-37
-			 0,  2,  2, 0,  0,  0,  0, 0 	//38-3f
-		};
-
-		static const bool err5_table[64] =
-		{
-			 true,  true,  true,  true,  true, false, false, false,	//00-07
-			 true, false, false, false, false, false, false, false, //08-0f
-			 true, false, false, false, false, false, false, false, //10-17
-			false, false, false, false, false, false, false,  true,	//18-1f
-			 true, false, false, false, false, false, false, false,	//20-27
-			false, false, false, false, false, false, false,  true,	//28-2f
-			false, false, false, false, false, false, false,  true,	//30-37
-			false, false, false,  true,  true,  true,  true,  true  //38-3f
-		};
-
-		static const bool ctl5_table[64] =
-		{
-			false, false, false, false, false, false, false, false,	//00-07
-			false, false, false, false, false, false, false, true,  //08-0f
-			false, false, false, false, false, false, false, false, //10-17
-			false, false, false, false, false, false, false, false,	//18-1f
-			false, false, false, false, false, false, false, false,	//20-27
-			false, false, false, false, false, false, false, false,	//28-2f
-			true,  false, false, false, false, false, false, false,	//30-37
-			false, false, false, false, false, false, false, false  //38-3f
-		};
+		//We need the start of the following symbol to know how long each one is
+		if(seg.m_end >= seg.m_start + 11)
+			seg.m_numSymbols = (seg.m_end - seg.m_start - 1) / 10;
+	}
 
-		int code5 = code5_table[code6];
-		int disp5 = disp5_table[code6];
-		bool err5 = err5_table[code6];
-		bool ctl5 = ctl5_table[code6];
+	//Figure out where each segment goes in the output, and break long segments into blocks
+	//so a single long burst doesn't end up decoded on one thread
+	const size_t blocksize = 65536;
+	vector<pair<size_t, size_t> > blocks;
+	size_t nsymbols = 0;
+	for(size_t i=0; i<nsegs; i++)
+	{
+		auto& seg = segments[i];
+		seg.m_firstSymbol = nsymbols;
+		nsymbols += seg.m_numSymbols;
 
-		//3b/4b decode
-		uint8_t code4 =
-			(data.m_samples[i+6] ? 8 : 0) |
-			(data.m_samples[i+7] ? 4 : 0) |
-			(data.m_samples[i+8] ? 2 : 0) |
-			(data.m_samples[i+9] ? 1 : 0);
+		for(size_t j=0; j<seg.m_numSymbols; j += blocksize)
+			blocks.push_back(pair<size_t, size_t>(i, j));
+	}
 
-		static const bool err3_ctl_table[16] =
+	//Create the capture
+	auto cap = new IBM8b10bWaveform(m_parameters[m_displayformat]);
+	cap->m_timescale = 1;
+	cap->m_startTimestamp = din->m_startTimestamp;
+	cap->m_startFemtoseconds = din->m_startFemtoseconds;
+	cap->PrepareForCpuAccess();
+	cap->Resize(nsymbols);
+
+	//Decode the actual data.
+	//Everything but the running disparity is a pure function of the 10b code group, so this is a single
+	//table lookup per symbol. Stash the symbol's own disparity in m_disparity for the next pass.
+	auto table = GetDecodeTable();
+	const uint64_t* pbits = &bits[0];
+	size_t nblocks = blocks.size();
+	#pragma omp parallel for
+	for(size_t b=0; b<nblocks; b++)
+	{
+		auto& seg = segments[blocks[b].first];
+		size_t first = blocks[b].second;
+		size_t last = min(first + blocksize, seg.m_numSymbols);
+		for(size_t j=first; j<last; j++)
 		{
-			 true,  true, false, false, false, false, false, false,
-			false, false, false, false, false, false,  true,  true
-		};
+			size_t i = seg.m_start + j*10;
+			size_t nout = seg.m_firstSymbol + j;
+			auto& e = table[ExtractBits(pbits, i) & 0x3ff];
+
+			//Horizontally shift the decoded symbol back by half a UI
+			//since the recovered clock edge is in the middle of the UI.
+			//We want the decoded signal boundaries to line up with the data edge, not the middle of the UI.
+			cap->m_offsets[nout] = data.m_offsets[i] - data.m_durations[i]/2;
+			cap->m_durations[nout] = data.m_offsets[i+10] - data.m_offsets[i];
+			cap->m_samples[nout] = IBM8b10bSymbol(
+				e.m_control, e.m_error5, e.m_error3, false, e.m_data, e.m_disparity);
+		}
+	}
 
-		static const int code3_pos_ctl_table[16] =	//if disp5 positive
-		{
-			0, 0, 4, 3, 0, 2, 6, 7,
-			7, 1, 5, 0, 3, 4, 0, 0,
-		};
+	//Running disparity tracking. This is inherently serial, but each segment starts from scratch
+	#pragma omp parallel for schedule(dynamic)
+	for(size_t i=0; i<nsegs; i++)
+	{
+		auto& seg = segments[i];
+		if(seg.m_numSymbols == 0)
+			continue;
 
-		static const int code3_neg_ctl_table[16] =	//if disp5 negative
-		{
-			0, 0, 4, 3, 0, 5, 1, 7,
-			7, 6, 2, 0, 3, 4, 0, 0
-		};
+		//Assume the first symbol of the segment has the correct disparity
+		int last_disp = -1;
+		if(cap->m_samples[seg.m_firstSymbol].m_disparity < 0)
+			last_disp = 1;
 
-		static const bool err3_table[16] =
+		size_t end = seg.m_firstSymbol + seg.m_numSymbols;
+		for(size_t j=seg.m_firstSymbol; j<end; j++)
 		{
-			 true,  false, false, false, false, false, false, false,
-			false, false, false, false, false, false, false,  true
-		};
+			auto& s = cap->m_samples[j];
+			int total_disp = s.m_disparity;
 
-		static const int code3_table[16] =
-		{
-			0, 7, 4, 3, 0, 2, 6, 7,
-			7, 1, 5, 0, 3, 4, 7, 0
-		};
+			if(total_disp > 0 && last_disp > 0)
+			{
+				s.m_errorDisp = true;
+				last_disp = 1;
+			}
+			else if(total_disp < 0 && last_disp < 0)
+			{
+				s.m_errorDisp = true;
+				last_disp = -1;
+			}
+			else
+				last_disp += total_disp;
 
-		static const int disp3_table[16] =
-		{
-			 0, -2, -2, 0, -2, 0, 0, 2,
-			-2, 0,  0, 2,  0, 2, 2, 0
-		};
+			s.m_disparity = last_disp;
+		}
+	}
 
-		//true only for Dx.A7
-		const bool alt3_table[16] =
-		{
-			0, 0, 0, 0, 0, 0, 0, 1,
-			1, 0, 0, 0, 0, 0, 0, 0
-		};
+	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+}
 
-		int code3 = false;
-		int disp3 = 0;
-		int err3 = false;
-		if(ctl5)
-		{
-			if(disp5 >= 0)
-				code3 = code3_pos_ctl_table[code4];
-			else
-				code3 = code3_neg_ctl_table[code4];
-			err3 = err3_ctl_table[code4];
-		}
-		else
-		{
-			code3 = code3_table[code4];
-			err3 = err3_table[code4];
-		}
-		disp3 = disp3_table[code4];
+/**
+	@brief Packs the sampled data into a bit buffer, 64 UIs per word with the first UI in the LSB
 
-		//Disparity tracking
-		int total_disp = disp3 + disp5;
-		if(first)
-		{
-			if(total_disp < 0)
-				last_disp = 1;
-			else
-				last_disp = -1;
-			first = false;
-		}
+	Two words of zero padding are added at the end so ExtractBits() never has to bounds check.
+ */
+void IBM8b10bDecoder::PackBits(SparseDigitalWaveform& data, vector<uint64_t>& bits)
+{
+	size_t len = data.size();
+	size_t nwords = (len + 63) / 64;
+	bits.resize(nwords + 2);
+	bits[nwords] = 0;
+	bits[nwords + 1] = 0;
+
+	//Pack 1M UIs per block
+	const size_t wblock = 16384;
+	size_t nblocks = (nwords + wblock - 1) / wblock;
+
+	#pragma omp parallel for
+	for(size_t i=0; i<nblocks; i++)
+	{
+		size_t wstart = i*wblock;
+		size_t wend = min(wstart + wblock, nwords);
 
-		bool disperr = false;
-		if(total_disp > 0 && last_disp > 0)
-		{
-			disperr = true;
-			last_disp = 1;
-		}
-		else if(total_disp < 0 && last_disp < 0)
-		{
-			disperr = true;
-			last_disp = -1;
-		}
+		#ifdef __x86_64__
+		if(g_hasAvx2)
+			PackBitsAVX2(data, bits, wstart, wend);
 		else
-			last_disp += total_disp;
+		#endif
+			PackBitsGeneric(data, bits, wstart, wend);
+	}
+}
 
-		//Special processing for a few control codes that use the .A7 format
-		bool alt = alt3_table[code4];
-		if(alt)
-		{
-			if( (code5 == 23) || (code5 == 27) || (code5 == 29) || (code5 == 30) )
-				ctl5 = true;
-		}
+void IBM8b10bDecoder::PackBitsGeneric(SparseDigitalWaveform& data, vector<uint64_t>& bits, size_t wstart, size_t wend)
+{
+	size_t len = data.size();
+	bool* samples = data.m_samples.GetCpuPointer();
+	for(size_t w=wstart; w<wend; w++)
+	{
+		size_t base = w*64;
+		size_t n = min((size_t)64, len - base);
 
-		//Horizontally shift the decoded symbol back by half a UI
-		//since the recovered clock edge is in the middle of the UI.
-		//We want the decoded signal boundaries to line up with the data edge, not the middle of the UI.
-		auto symbolStart = data.m_offsets[i] - data.m_durations[i]/2;
-		auto symbolLength = data.m_offsets[i+10] - data.m_offsets[i];
-		if( (symbolStart - lastSymbolStart) > 5*symbolLength)
-		{
-			LogTrace("Sync lost (big gap)\n");
-			first = true;
-		}
-		else
-		{
-			cap->m_offsets.push_back(symbolStart);
-			cap->m_durations.push_back(lastSymbolLength);
-			cap->m_samples.push_back(IBM8b10bSymbol(ctl5, err5, err3, disperr, (code3 << 5) | code5, last_disp));
-		}
+		uint64_t v = 0;
+		for(size_t j=0; j<n; j++)
+			v |= static_cast<uint64_t>(samples[base + j]) << j;
+		bits[w] = v;
+	}
+}
 
-		lastSymbolLength = symbolLength;
-		lastSymbolEnd = symbolStart + lastSymbolEnd;
-		lastSymbolStart = symbolStart;
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+void IBM8b10bDecoder::PackBitsAVX2(SparseDigitalWaveform& data, vector<uint64_t>& bits, size_t wstart, size_t wend)
+{
+	size_t len = data.size();
+	size_t fullwords = len / 64;
+	size_t wfull = min(wend, fullwords);
+
+	//Booleans are one byte each (0 or 1), so compare against zero and grab the sign bits
+	uint8_t* samples = reinterpret_cast<uint8_t*>(data.m_samples.GetCpuPointer());
+	__m256i zero = _mm256_setzero_si256();
+	for(size_t w=wstart; w<wfull; w++)
+	{
+		__m256i lo = _mm256_loadu_si256(reinterpret_cast<__m256i*>(samples + w*64));
+		__m256i hi = _mm256_loadu_si256(reinterpret_cast<__m256i*>(samples + w*64 + 32));
+
+		uint32_t mlo = _mm256_movemask_epi8(_mm256_cmpgt_epi8(lo, zero));
+		uint32_t mhi = _mm256_movemask_epi8(_mm256_cmpgt_epi8(hi, zero));
+
+		bits[w] = static_cast<uint64_t>(mlo) | (static_cast<uint64_t>(mhi) << 32);
 	}
 
-	SetData(cap, 0);
-	cap->MarkModifiedFromCpu();
+	//Partial word at the end
+	if(wend > wfull)
+		PackBitsGeneric(data, bits, max(wstart, wfull), wend);
 }
+#endif /* __x86_64__ */
+
+/**
+	@brief Finds the symbol alignment at the start of a segment
 
-void IBM8b10bDecoder::Align(SparseDigitalWaveform& data, size_t& i)
+	Checks every bit position in the search window for a comma, 60 positions at a time. Within each block, bit j
+	corresponds to alignment phase (j % 10), so a single AND + popcount per phase gives the number of commas seen
+	at each alignment.
+
+	@param bits		Packed sample data
+	@param start	Index of the first UI in the segment
+	@param end		Index of the first UI after the end of the segment
+
+	@return Offset from start to the first UI of the first aligned symbol
+ */
+size_t IBM8b10bDecoder::Align(const vector<uint64_t>& bits, size_t start, size_t end)
 {
 	size_t range = m_parameters[m_commaSearchWindow].GetIntVal();
 
-	//Look for commas in the data stream
-	//TODO: make this more efficient?
-	size_t max_commas = 0;
-	size_t max_offset = 0;
-	size_t dend = data.m_samples.size() - 20;
-	for(size_t offset=0; offset < 10; offset ++)
-	{
-		size_t num_commas = 0;
-		size_t num_errors = 0;
+	//Only check the first few symbols for alignment (default is 20K UIs, 2K symbols)
+	//to avoid wasting a ton of time repeatedly decoding a huge capture
+	size_t limit = start + ((range + 9) / 10) * 10;
+	if(end < start + 20)
+		return 0;
+	limit = min(limit, end - 19);
 
-		//Only check the first few symbols for alignment (default is 20K UIs, 2K symbols)
-		//to avoid wasting a ton of time repeatedly decoding a huge capture
-		for(size_t delta=0; delta<range; delta += 10)
+	//Masks for each phase within a 60-bit block
+	uint64_t phaseMasks[10] = {0};
+	for(size_t j=0; j<60; j++)
+		phaseMasks[j % 10] |= (1ULL << j);
+	const uint64_t blockMask = (1ULL << 60) - 1;
+
+	size_t num_commas[10] = {0};
+	size_t num_errors[10] = {0};
+
+	const uint64_t* pbits = &bits[0];
+	for(size_t base=start; base<limit; base += 60)
+	{
+		//Bit j of s[k] is bit k of the candidate symbol starting at base+j
+		uint64_t s[10];
+		for(size_t k=0; k<10; k++)
+			s[k] = ExtractBits(pbits, base + k);
+
+		//Ignore anything past the end of the search window
+		uint64_t valid = blockMask;
+		if(base + 60 > limit)
+			valid &= (1ULL << (limit - base)) - 1;
+
+		//Comma is always exactly five identical bits at positions 2...6 within the symbol (left-right bit ordering)
+		uint64_t comma =
+			(s[1] ^ s[2]) &
+			~(s[2] ^ s[3]) &
+			~(s[2] ^ s[4]) &
+			~(s[2] ^ s[5]) &
+			~(s[2] ^ s[6]) &
+			(s[7] ^ s[2]);
+		comma &= valid;
+
+		//Count number of 1s in each candidate symbol with a bit-sliced adder.
+		//Should always be equal (5/5) or two greater (4/6 or 6/4)
+		uint64_t c0 = 0;
+		uint64_t c1 = 0;
+		uint64_t c2 = 0;
+		uint64_t c3 = 0;
+		for(size_t k=0; k<10; k++)
 		{
-			size_t base = i + offset + delta;
-			if(base > dend)
-				break;
-
-			//Check if we have a comma (five identical bits) anywhere in the data stream
-			//Commas are always at positions 2...6 within the symbol (left-right bit ordering)
-			bool comma = true;
-			for(int j=3; j<=6; j++)
-			{
-				if(data.m_samples[base+j] != data.m_samples[base+2])
-				{
-					comma = false;
-					break;
-				}
-			}
+			uint64_t carry0 = c0 & s[k];
+			c0 ^= s[k];
+			uint64_t carry1 = c1 & carry0;
+			c1 ^= carry0;
+			uint64_t carry2 = c2 & carry1;
+			c2 ^= carry1;
+			c3 ^= carry2;
+		}
+		uint64_t ok = ~c3 & c2 & ~(c1 & c0);
+		uint64_t errors = ~ok & valid;
 
-			//Comma is always exactly five identical bits (so 1 and 7 must be different)
-			if(data.m_samples[base+1] == data.m_samples[base+2])
-				comma = false;
-			if(data.m_samples[base+7] == data.m_samples[base+2])
-				comma = false;
-
-			//Count number of 0s and 1s in the symbol
-			//Should always be equal (5/5) or two greater (4/6 or 6/4)
-			int nones = 0;
-			for(int j=0; j<10; j++)
-				nones += data.m_samples[base+j];
-			if( (nones != 4) && (nones != 5) && (nones != 6) )
-				num_errors ++;
-
-			if(comma)
-				num_commas ++;
+		for(size_t phase=0; phase<10; phase++)
+		{
+			num_commas[phase] += __builtin_popcountll(comma & phaseMasks[phase]);
+			num_errors[phase] += __builtin_popcountll(errors & phaseMasks[phase]);
 		}
+	}
 
+	size_t max_commas = 0;
+	size_t max_offset = 0;
+	for(size_t offset=0; offset<10; offset++)
+	{
 		//Allow a *few* errors, but discard any potential alignment with more errors than commas
-		if(num_errors > num_commas)
+		if(num_errors[offset] > num_commas[offset])
 		{}
 
-		else if(num_commas > max_commas)
+		else if(num_commas[offset] > max_commas)
 		{
-			max_commas = num_commas;
+			max_commas = num_commas[offset];
 			max_offset = offset;
 		}
-		LogTrace("Found %zu commas and %zu errors at offset %zu\n", num_commas, num_errors, offset);
 	}
 
-	i += max_offset;
+	return max_offset;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -105,7 +105,65 @@ protected:
 
 	std::string m_commaSearchWindow;
 
-	void Align(SparseDigitalWaveform& data, size_t& i);
+	/**
+		@brief One entry of the combined 10b to 8b lookup table
+	 */
+	class DecodeTableEntry
+	{
+	public:
+
+		///@brief Decoded 8-bit data value (HGF EDCBA)
+		uint8_t m_data;
+
+		///@brief True if the symbol is a control character
+		bool m_control;
+
+		///@brief True if the 6b sub-block is not a legal code
+		bool m_error5;
+
+		///@brief True if the 4b sub-block is not a legal code
+		bool m_error3;
+
+		///@brief Disparity of the full 10b symbol
+		int8_t m_disparity;
+	};
+
+	/**
+		@brief A run of UIs with no gaps, which can be aligned and decoded independently of the others
+	 */
+	class Segment
+	{
+	public:
+		Segment(size_t start, size_t end)
+		: m_start(start)
+		, m_end(end)
+		, m_firstSymbol(0)
+		, m_numSymbols(0)
+		{}
+
+		///@brief Index of the first UI in the segment
+		size_t m_start;
+
+		///@brief Index of the first UI after the end of the segment
+		size_t m_end;
+
+		///@brief Index of the first decoded symbol in the output waveform
+		size_t m_firstSymbol;
+
+		///@brief Number of symbols decoded from the segment
+		size_t m_numSymbols;
+	};
+
+	static const DecodeTableEntry* GetDecodeTable();
+	static std::vector<DecodeTableEntry> BuildDecodeTable();
+
+	static void PackBits(SparseDigitalWaveform& data, std::vector<uint64_t>& bits);
+	static void PackBitsGeneric(SparseDigitalWaveform& data, std::vector<uint64_t>& bits, size_t wstart, size_t wend);
+#ifdef __x86_64__
+	static void PackBitsAVX2(SparseDigitalWaveform& data, std::vector<uint64_t>& bits, size_t wstart, size_t wend);
+#endif
+
+	size_t Align(const std::vector<uint64_t>& bits, size_t start, size_t end);
 };
 
 #endif
@@ -92,7 +92,7 @@ void PcapngExportFilter::Export()
 		return;
 
 	//If file is not open, open it and write a section header block if necessary
-	if(!m_fp)
+	if(!m_writer.IsOpen())
 	{
 		LogTrace("File wasn't open, opening it\n");
 
@@ -100,20 +100,11 @@ void PcapngExportFilter::Export()
 
 		auto fname = m_parameters[m_fname].GetFileName();
 		bool append = (mode == MODE_CONTINUOUS_APPEND) || (mode == MODE_MANUAL_APPEND);
-		if(append)
-			m_fp = fopen(fname.c_str(), "ab");
-		else
-			m_fp = fopen(fname.c_str(), "wb");
-
-		if(!m_fp)
-		{
-			LogError("Failed to open file %s for writing\n", fname.c_str());
+		if(!m_writer.Open(fname, append))
 			return;
-		}
 
 		//See if file is empty. If so, write header
-		fseek(m_fp, 0, SEEK_END);
-		if(ftell(m_fp) == 0)
+		if(m_writer.GetSize() == 0)
 		{
 			LogTrace("File was empty, writing SHB\n");
 
@@ -122,95 +113,74 @@ void PcapngExportFilter::Export()
 
 			//Block type
 			uint32_t blocktype = 0x0a0d0d0a;
-			if(!fwrite(&blocktype, sizeof(blocktype), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(blocktype);
 
 			//Length of the SHB itself
 			uint32_t shblen = 28;
-			if(!fwrite(&shblen, sizeof(shblen), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(shblen);
 
 			//Byte order magic
 			uint32_t bom = 0x1a2b3c4d;
-			if(!fwrite(&bom, sizeof(bom), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(bom);
 
 			//File format version (1.0)
 			uint16_t major = 1;
 			uint16_t minor = 0;
-			if(!fwrite(&major, sizeof(major), 1, m_fp))
-				LogError("file write failure\n");
-			if(!fwrite(&minor, sizeof(minor), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(major);
+			m_writer.WriteObject(minor);
 
 			//Section length (unspecified since we append live as data comes in and don't know a priori)
 			int64_t seclen = -1;
-			if(!fwrite(&seclen, sizeof(seclen), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(seclen);
 
 			//Block total length again
-			if(!fwrite(&shblen, sizeof(shblen), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(shblen);
 
 			////////////////////////////////////////////////////////////////////////////////////////////////////////////
 			// Write the IDB
 
 			//Block type
 			blocktype = 0x1;
-			if(!fwrite(&blocktype, sizeof(blocktype), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(blocktype);
 
 			//Length of the IDB itself
 			uint32_t idblen = 40;
-			if(!fwrite(&idblen, sizeof(idblen), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(idblen);
 
 			//Link type
 			uint16_t linktype = 1;
-			if(!fwrite(&linktype, sizeof(linktype), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(linktype);
 
 			//Padding
 			uint16_t pad = 0;
-			if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(pad);
 
 			//Snapshot length
 			uint32_t snaplen = 0;
-			if(!fwrite(&snaplen, sizeof(snaplen), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(snaplen);
 
 			//Option if_name (total 8 bytes)
 			uint16_t optid = 2;
-			if(!fwrite(&optid, sizeof(optid), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(optid);
 			uint16_t optlen = 4;
-			if(!fwrite(&optlen, sizeof(optlen), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(optlen);
 			const char* ifname = "eth0";
-			if(!fwrite(ifname, strlen(ifname), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.Write(ifname, strlen(ifname));
 
 			//Option it_tsresol (total 8 bytes)
 			optid = 9;
 			optlen = 1;
-			if(!fwrite(&optid, sizeof(optid), 1, m_fp))
-				LogError("file write failure\n");
-			if(!fwrite(&optlen, sizeof(optlen), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(optid);
+			m_writer.WriteObject(optlen);
 			uint8_t tsresol[4] = {9, 0, 0, 0};	//nanosecond resolution
-			if(!fwrite(tsresol, sizeof(tsresol), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.Write(tsresol, sizeof(tsresol));
 
 			//Option endofopt (total 4 bytes)
-			if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-				LogError("file write failure\n");
-			if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(pad);
+			m_writer.WriteObject(pad);
 
 			//Write the IDB length again
-			if(!fwrite(&idblen, sizeof(idblen), 1, m_fp))
-				LogError("file write failure\n");
+			m_writer.WriteObject(idblen);
 		}
 	}
 
@@ -219,7 +189,7 @@ void PcapngExportFilter::Export()
 	if(wfm)
 		ExportEthernet(wfm);
 
-	fflush(m_fp);
+	m_writer.Submit();
 }
 
 /**
@@ -277,54 +247,42 @@ void PcapngExportFilter::ExportPacket(vector<uint8_t>& packet, time_t timestamp,
 
 	//Block type
 	uint32_t blocktype = 6;
-	if(!fwrite(&blocktype, sizeof(blocktype), 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.WriteObject(blocktype);
 
 	//Block length (padded up to next 32 bit boundary)
 	uint32_t blocklen = 36 + packet.size();
 	uint32_t paddinglen = 4 - (blocklen % 4);
 	if(paddinglen == 4)
 		paddinglen = 0;
-	if(!fwrite(&blocklen, sizeof(blocklen), 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.WriteObject(blocklen);
 
 	//Interface ID
 	uint32_t iface = 0;
-	if(!fwrite(&iface, sizeof(iface), 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.WriteObject(iface);
 
 	//Timestamp
 	uint32_t tshi = (ns >> 32);
 	uint32_t tslo = (ns & 0xffffffff);
-	if(!fwrite(&tshi, sizeof(tshi), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&tslo, sizeof(tslo), 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.WriteObject(tshi);
+	m_writer.WriteObject(tslo);
 
 	//Packet length repeated twice (original + captured, both always equal for us)
 	uint32_t packetlen = packet.size();
-	if(!fwrite(&packetlen, sizeof(packetlen), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&packetlen, sizeof(packetlen), 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.WriteObject(packetlen);
+	m_writer.WriteObject(packetlen);
 
 	//Packet data
-	if(!fwrite(&packet[0], packet.size(), 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.Write(packet.data(), packet.size());
 
 	//Pad out to 32 bit boundary
 	uint8_t padbuf[4] = {0};
-	if(!fwrite(&padbuf[0], paddinglen, 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.Write(padbuf, paddinglen);
 
 	//Option endofopt (total 4 bytes)
 	uint16_t pad = 0;
-	if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.WriteObject(pad);
+	m_writer.WriteObject(pad);
 
 	//Repeat block length
-	if(!fwrite(&blocklen, sizeof(blocklen), 1, m_fp))
-		LogError("file write failure\n");
+	m_writer.WriteObject(blocklen);
 }
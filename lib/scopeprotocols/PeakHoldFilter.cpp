@@ -88,93 +88,51 @@ void PeakHoldFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 	SetYAxisUnits(m_inputs[0].GetYAxisUnits(), 0);
 
 	auto din = GetInputWaveform(0);
-
-	//Create waveform if we don't have one already
+	din->PrepareForCpuAccess();
 	size_t len = din->size();
-	bool first = false;
 
 	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
 	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
 
+	//Set up the output, reusing the previous peaks if the input geometry is unchanged
 	if(sdin)
 	{
-		auto cap = dynamic_cast<SparseAnalogWaveform*>(GetData(0));
-		if(cap == NULL)
-		{
-			cap = new SparseAnalogWaveform;
-			cap->Resize(len);
-			SetData(cap, 0);
-			first = true;
-		}
-
-		//If sample size changed, clear it out
-		if(cap->size() != len)
-		{
-			cap->Resize(len);
-			first = true;
-		}
-
-		//Copy our time scales from the input
-		cap->m_timescale = din->m_timescale;
-		cap->m_startTimestamp = din->m_startTimestamp;
-		cap->m_startFemtoseconds = din->m_startFemtoseconds;
-
-		//Copy timestamps from the input
-		cap->CopyTimestamps(sdin);
-
-		//First waveform just copies the input
-		if(first)
-		{
-			for(size_t i=0; i<len; i++)
-				cap->m_samples[i] = sdin->m_samples[i];
-		}
-
-		//otherwise actually do peak holding
-		else
-		{
-			for(size_t i=0; i<len; i++)
-				cap->m_samples[i] = max((float)cap->m_samples[i], (float)sdin->m_samples[i]);
-		}
+		bool reset;
+		auto cap = SetupPersistentSparseAnalogOutputWaveform(sdin, 0, reset);
+		UpdatePeaks(cap->m_samples.GetCpuPointer(), sdin->m_samples.GetCpuPointer(), len, reset);
+		cap->MarkModifiedFromCpu();
 
 		FindPeaks(cap, cmdBuf, queue);
 	}
 	else
 	{
-		auto cap = dynamic_cast<UniformAnalogWaveform*>(GetData(0));
-		if(cap == NULL)
-		{
-			cap = new UniformAnalogWaveform;
-			cap->Resize(len);
-			SetData(cap, 0);
-			first = true;
-		}
-
-		//If sample size changed, clear it out
-		if(cap->size() != len)
-		{
-			cap->Resize(len);
-			first = true;
-		}
-
-		//Copy our time scales from the input
-		cap->m_timescale = din->m_timescale;
-		cap->m_startTimestamp = din->m_startTimestamp;
-		cap->m_startFemtoseconds = din->m_startFemtoseconds;
-
-		//First waveform just copies the input
-		if(first)
-		{
-			for(size_t i=0; i<len; i++)
-				cap->m_samples[i] = udin->m_samples[i];
-		}
-
-		//otherwise actually do peak holding
-		else
-		{
-			for(size_t i=0; i<len; i++)
-				cap->m_samples[i] = max((float)cap->m_samples[i], (float)udin->m_samples[i]);
-		}
+		bool reset;
+		auto cap = SetupPersistentUniformAnalogOutputWaveform(udin, 0, reset);
+		UpdatePeaks(cap->m_samples.GetCpuPointer(), udin->m_samples.GetCpuPointer(), len, reset);
+		cap->MarkModifiedFromCpu();
 
 		FindPeaks(cap, cmdBuf, queue);
 	}
 }
+
+/**
+	@brief Merges a new waveform into the held peaks
+
+	@param pout		Held peak values
+	@param pin		New input samples
+	@param len		Number of samples
+	@param reset	True if there is no valid held data, and the input should just be copied
+ */
+void PeakHoldFilter::UpdatePeaks(float* pout, const float* pin, size_t len, bool reset)
+{
+	//First waveform just copies the input
+	if(reset)
+		memcpy(pout, pin, len * sizeof(float));
+
+	//otherwise actually do peak holding
+	else
+	{
+		for(size_t i=0; i<len; i++)
+			pout[i] = max(pout[i], pin[i]);
+	}
+}
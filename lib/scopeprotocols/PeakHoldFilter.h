@@ -51,6 +51,7 @@ public:
 	PROTOCOL_DECODER_INITPROC(PeakHoldFilter)
 
 protected:
+	static void UpdatePeaks(float* pout, const float* pin, size_t len, bool reset);
 };
 
 #endif
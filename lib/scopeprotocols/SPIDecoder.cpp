@@ -97,13 +97,6 @@ void SPIDecoder::Refresh()
 	csn->PrepareForCpuAccess();
 	data->PrepareForCpuAccess();
 
-	auto sclk = dynamic_cast<SparseDigitalWaveform*>(clk);
-	auto uclk = dynamic_cast<UniformDigitalWaveform*>(clk);
-	auto scsn = dynamic_cast<SparseDigitalWaveform*>(csn);
-	auto ucsn = dynamic_cast<UniformDigitalWaveform*>(csn);
-	auto sdata = dynamic_cast<SparseDigitalWaveform*>(data);
-	auto udata = dynamic_cast<UniformDigitalWaveform*>(data);
-
 	//Create the capture
 	auto cap = new SPIWaveform;
 	cap->m_timescale = 1;
@@ -116,165 +109,205 @@ void SPIDecoder::Refresh()
 
 	//TODO: packets based on CS# pulses?
 
-	//Loop over the data and look for transactions
-	enum
+	//Get SPI clock polarity
+	auto cpol = m_parameters[m_cpol].GetIntVal();
+	SPIStateMachine dec(clk, csn, data, (cpol == 0));
+
+	//Split long captures into chunks at clock samples, and decode them in parallel
+	auto sclk = dynamic_cast<SparseDigitalWaveform*>(clk);
+	auto uclk = dynamic_cast<UniformDigitalWaveform*>(clk);
+	size_t clklen = clk->size();
+	size_t nchunks = PacketDecoder::GetChunkCount(clklen);
+	vector<int64_t> boundaries;
+	for(size_t i=1; i<nchunks; i++)
+		boundaries.push_back(GetOffsetScaled(sclk, uclk, i * clklen / nchunks));
+
+	SPIStateMachine::Output symbols;
+	ChunkedDecoder<SPIStateMachine>::Decode(dec, boundaries, symbols);
+
+	size_t nsymbols = symbols.m_samples.size();
+	cap->Resize(nsymbols);
+	for(size_t i=0; i<nsymbols; i++)
 	{
-		STATE_IDLE,
-		STATE_DESELECTED,
-		STATE_SELECTED_CLK_INACTIVE,
-		STATE_SELECTED_CLK_ACTIVE
-	} state = STATE_IDLE;
+		cap->m_offsets[i] = symbols.m_offsets[i];
+		cap->m_durations[i] = symbols.m_durations[i];
+		cap->m_samples[i] = symbols.m_samples[i];
+	}
 
-	uint8_t	current_byte	= 0;
-	uint8_t	bitcount 		= 0;
-	int64_t bytestart		= 0;
-	bool first				= false;
+	SetData(cap, 0);
 
-	size_t ics			= 0;
-	size_t iclk			= 0;
-	size_t idata		= 0;
+	cap->MarkModifiedFromCpu();
+}
 
-	int64_t timestamp	= 0;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SPIStateMachine
+
+SPIStateMachine::SPIStateMachine(WaveformBase* clk, WaveformBase* csn, WaveformBase* data, bool activeClk)
+	: m_sclk(dynamic_cast<SparseDigitalWaveform*>(clk))
+	, m_uclk(dynamic_cast<UniformDigitalWaveform*>(clk))
+	, m_scsn(dynamic_cast<SparseDigitalWaveform*>(csn))
+	, m_ucsn(dynamic_cast<UniformDigitalWaveform*>(csn))
+	, m_sdata(dynamic_cast<SparseDigitalWaveform*>(data))
+	, m_udata(dynamic_cast<UniformDigitalWaveform*>(data))
+	, m_clklen(clk->size())
+	, m_cslen(csn->size())
+	, m_datalen(data->size())
+	, m_activeClk(activeClk)
+{
+}
 
-	size_t clklen = clk->size();
-	size_t cslen = csn->size();
-	size_t datalen = data->size();
+/**
+	@brief Gets a state at an arbitrary timestamp, waiting for chip select to go high
+ */
+SPIStateMachine::State SPIStateMachine::Resync(int64_t position) const
+{
+	State s;
+	s.m_timestamp = position;
+	s.m_ics = Filter::GetIndexAtTimestampScaled(m_scsn, m_ucsn, m_cslen, position);
+	s.m_iclk = Filter::GetIndexAtTimestampScaled(m_sclk, m_uclk, m_clklen, position);
+	s.m_idata = Filter::GetIndexAtTimestampScaled(m_sdata, m_udata, m_datalen, position);
+	return s;
+}
 
-	//Get SPI clock polarity
-	auto cpol = m_parameters[m_cpol].GetIntVal();
+void SPIStateMachine::Append(Output& dst, Output& src, const Mark& from) const
+{
+	dst.m_offsets.insert(dst.m_offsets.end(), src.m_offsets.begin() + from, src.m_offsets.end());
+	dst.m_durations.insert(dst.m_durations.end(), src.m_durations.begin() + from, src.m_durations.end());
+	dst.m_samples.insert(dst.m_samples.end(), src.m_samples.begin() + from, src.m_samples.end());
+}
 
-	bool active_clk;
-	if(cpol == 0)
-		active_clk = true;
-	else
-		active_clk = false;
+/**
+	@brief Processes the samples at the current timestamp and moves to the next event
 
-	while(true)
+	@return False if we hit the end of the waveform
+ */
+bool SPIStateMachine::Step(State& s, Output& out) const
+{
+	//Get the current samples
+	bool cur_cs = GetValue(m_scsn, m_ucsn, s.m_ics);
+	bool cur_clk = GetValue(m_sclk, m_uclk, s.m_iclk);
+	bool cur_data = GetValue(m_sdata, m_udata, s.m_idata);
+	int64_t timestamp = s.m_timestamp;
+
+	switch(s.m_state)
 	{
-		//Get the current samples
-		bool cur_cs = GetValue(scsn, ucsn, ics);
-		bool cur_clk = GetValue(sclk, uclk, iclk);
-		bool cur_data = GetValue(sdata, udata, idata);
-
-		switch(state)
-		{
-			//Just started the decode, wait for CS# to go high (and don't attempt to decode a partial packet)
-			case STATE_IDLE:
-				if(cur_cs)
-					state = STATE_DESELECTED;
-				break;
-
-			//wait for falling edge of CS#
-			case STATE_DESELECTED:
-				if(!cur_cs)
-				{
-					state = STATE_SELECTED_CLK_INACTIVE;
-					current_byte = 0;
-					bitcount = 0;
-					bytestart = timestamp;
-					first = true;
-				}
-				break;
+		//Just started the decode, wait for CS# to go high (and don't attempt to decode a partial packet)
+		case STATE_IDLE:
+			if(cur_cs)
+			{
+				//Everything else is reset when CS# falls, but clear it now so we can resync here
+				s.m_state = STATE_DESELECTED;
+				s.m_currentByte = 0;
+				s.m_bitcount = 0;
+				s.m_bytestart = 0;
+				s.m_first = false;
+			}
+			break;
+
+		//wait for falling edge of CS#
+		case STATE_DESELECTED:
+			if(!cur_cs)
+			{
+				s.m_state = STATE_SELECTED_CLK_INACTIVE;
+				s.m_currentByte = 0;
+				s.m_bitcount = 0;
+				s.m_bytestart = timestamp;
+				s.m_first = true;
+			}
+			break;
 
-			//wait for rising edge of clk
-			case STATE_SELECTED_CLK_INACTIVE:
-				if(cur_clk == active_clk)
+		//wait for rising edge of clk
+		case STATE_SELECTED_CLK_INACTIVE:
+			if(cur_clk == m_activeClk)
+			{
+				if(s.m_bitcount == 0)
 				{
-					if(bitcount == 0)
+					//Add a "chip selected" event
+					if(s.m_first)
 					{
-						//Add a "chip selected" event
-						if(first)
-						{
-							cap->m_offsets.push_back(bytestart);
-							cap->m_durations.push_back(timestamp - bytestart);
-							cap->m_samples.push_back(SPISymbol(SPISymbol::TYPE_SELECT, 0));
-							first = false;
-						}
-
-						//Extend the last byte until this edge
-						else if(!cap->m_samples.empty())
-						{
-							size_t ilast = cap->m_samples.size()-1;
-							if(cap->m_samples[ilast].m_stype == SPISymbol::TYPE_DATA)
-								cap->m_durations[ilast] = timestamp - cap->m_offsets[ilast];
-						}
-
-						bytestart = timestamp;
+						out.push_back(s.m_bytestart, timestamp - s.m_bytestart, SPISymbol(SPISymbol::TYPE_SELECT, 0));
+						s.m_first = false;
 					}
 
-					state = STATE_SELECTED_CLK_ACTIVE;
-
-					//TODO: selectable msb/lsb first direction
-					bitcount ++;
-					if(cur_data)
-						current_byte = 1 | (current_byte << 1);
-					else
-						current_byte = (current_byte << 1);
-
-					if(bitcount == 8)
+					//Extend the last byte until this edge
+					else if(!out.m_samples.empty())
 					{
-						cap->m_offsets.push_back(bytestart);
-						cap->m_durations.push_back(timestamp - bytestart);
-						cap->m_samples.push_back(SPISymbol(SPISymbol::TYPE_DATA, current_byte));
-
-						bitcount = 0;
-						current_byte = 0;
-						bytestart = timestamp;
+						size_t ilast = out.m_samples.size()-1;
+						if(out.m_samples[ilast].m_stype == SPISymbol::TYPE_DATA)
+							out.m_durations[ilast] = timestamp - out.m_offsets[ilast];
 					}
-				}
-
-				//end of packet
-				//TODO: error if a byte is truncated
-				else if(cur_cs)
-				{
-					cap->m_offsets.push_back(bytestart);
-					cap->m_durations.push_back(timestamp - bytestart);
-					cap->m_samples.push_back(SPISymbol(SPISymbol::TYPE_DESELECT, 0));
 
-					bytestart = timestamp;
-					state = STATE_DESELECTED;
+					s.m_bytestart = timestamp;
 				}
-				break;
 
-			//wait for falling edge of clk
-			case STATE_SELECTED_CLK_ACTIVE:
-				if(cur_clk != active_clk)
-					state = STATE_SELECTED_CLK_INACTIVE;
+				s.m_state = STATE_SELECTED_CLK_ACTIVE;
 
-				//end of packet
-				//TODO: error if a byte is truncated
-				else if(cur_cs)
+				//TODO: selectable msb/lsb first direction
+				s.m_bitcount ++;
+				if(cur_data)
+					s.m_currentByte = 1 | (s.m_currentByte << 1);
+				else
+					s.m_currentByte = (s.m_currentByte << 1);
+
+				if(s.m_bitcount == 8)
 				{
-					cap->m_offsets.push_back(bytestart);
-					cap->m_durations.push_back(timestamp - bytestart);
-					cap->m_samples.push_back(SPISymbol(SPISymbol::TYPE_DESELECT, 0));
+					out.push_back(s.m_bytestart, timestamp - s.m_bytestart, SPISymbol(SPISymbol::TYPE_DATA, s.m_currentByte));
 
-					bytestart = timestamp;
-					state = STATE_DESELECTED;
+					s.m_bitcount = 0;
+					s.m_currentByte = 0;
+					s.m_bytestart = timestamp;
 				}
+			}
+
+			//end of packet
+			//TODO: error if a byte is truncated
+			else if(cur_cs)
+				Deselect(s, out);
+			break;
 
-				break;
-		}
+		//wait for falling edge of clk
+		case STATE_SELECTED_CLK_ACTIVE:
+			if(cur_clk != m_activeClk)
+				s.m_state = STATE_SELECTED_CLK_INACTIVE;
 
-		//Get timestamps of next event on each channel
-		int64_t next_cs = GetNextEventTimestampScaled(scsn, ucsn, ics, cslen, timestamp);
-		int64_t next_clk = GetNextEventTimestampScaled(sclk, uclk, iclk, clklen, timestamp);
+			//end of packet
+			//TODO: error if a byte is truncated
+			else if(cur_cs)
+				Deselect(s, out);
 
-		//If we can't move forward, stop (don't bother looking for glitches on data)
-		int64_t next_timestamp = min(next_clk, next_cs);
-		if(next_timestamp == timestamp)
 			break;
-
-		//All good, move on
-		timestamp = next_timestamp;
-		AdvanceToTimestampScaled(scsn, ucsn, ics, cslen, timestamp);
-		AdvanceToTimestampScaled(sclk, uclk, iclk, clklen, timestamp);
-		AdvanceToTimestampScaled(sdata, udata, idata, datalen, timestamp);
 	}
 
-	SetData(cap, 0);
+	//Get timestamps of next event on each channel
+	int64_t next_cs = Filter::GetNextEventTimestampScaled(m_scsn, m_ucsn, s.m_ics, m_cslen, timestamp);
+	int64_t next_clk = Filter::GetNextEventTimestampScaled(m_sclk, m_uclk, s.m_iclk, m_clklen, timestamp);
 
-	cap->MarkModifiedFromCpu();
+	//If we can't move forward, stop (don't bother looking for glitches on data)
+	int64_t next_timestamp = min(next_clk, next_cs);
+	if(next_timestamp == timestamp)
+		return false;
+
+	//All good, move on
+	s.m_timestamp = next_timestamp;
+	Filter::AdvanceToTimestampScaled(m_scsn, m_ucsn, s.m_ics, m_cslen, next_timestamp);
+	Filter::AdvanceToTimestampScaled(m_sclk, m_uclk, s.m_iclk, m_clklen, next_timestamp);
+	Filter::AdvanceToTimestampScaled(m_sdata, m_udata, s.m_idata, m_datalen, next_timestamp);
+	return true;
+}
+
+/**
+	@brief Ends a transaction when CS# goes high
+ */
+void SPIStateMachine::Deselect(State& s, Output& out) const
+{
+	out.push_back(s.m_bytestart, s.m_timestamp - s.m_bytestart, SPISymbol(SPISymbol::TYPE_DESELECT, 0));
+
+	//Nothing carries over to the next transaction, clear everything so we can resync here
+	s.m_state = STATE_DESELECTED;
+	s.m_currentByte = 0;
+	s.m_bitcount = 0;
+	s.m_bytestart = 0;
+	s.m_first = false;
 }
 
 std::string SPIWaveform::GetColor(size_t i)
@@ -36,6 +36,8 @@
 #ifndef SPIDecoder_h
 #define SPIDecoder_h
 
+#include "../scopehal/PacketDecoder.h"
+
 class SPISymbol
 {
 public:
@@ -72,6 +74,123 @@ public:
 	virtual std::string GetColor(size_t) override;
 };
 
+/**
+	@brief SPI state machine, for use with ChunkedDecoder
+
+	Position is the current timestamp. Every point between transactions (waiting for chip select to fall) is a sync point.
+ */
+class SPIStateMachine
+{
+public:
+	SPIStateMachine(WaveformBase* clk, WaveformBase* csn, WaveformBase* data, bool activeClk);
+
+	enum StateID
+	{
+		STATE_IDLE,
+		STATE_DESELECTED,
+		STATE_SELECTED_CLK_INACTIVE,
+		STATE_SELECTED_CLK_ACTIVE
+	};
+
+	/**
+		@brief Complete state of the decoder between two events
+	 */
+	class State
+	{
+	public:
+		State()
+			: m_state(STATE_IDLE)
+			, m_currentByte(0)
+			, m_bitcount(0)
+			, m_bytestart(0)
+			, m_first(false)
+			, m_ics(0)
+			, m_iclk(0)
+			, m_idata(0)
+			, m_timestamp(0)
+		{}
+
+		bool operator==(const State& rhs) const
+		{
+			return
+				(m_state == rhs.m_state) &&
+				(m_currentByte == rhs.m_currentByte) &&
+				(m_bitcount == rhs.m_bitcount) &&
+				(m_bytestart == rhs.m_bytestart) &&
+				(m_first == rhs.m_first) &&
+				(m_ics == rhs.m_ics) &&
+				(m_iclk == rhs.m_iclk) &&
+				(m_idata == rhs.m_idata) &&
+				(m_timestamp == rhs.m_timestamp);
+		}
+
+		StateID m_state;
+		uint8_t m_currentByte;
+		uint8_t m_bitcount;
+		int64_t m_bytestart;
+		bool m_first;
+		size_t m_ics;
+		size_t m_iclk;
+		size_t m_idata;
+		int64_t m_timestamp;
+	};
+
+	/**
+		@brief Decoded symbols
+	 */
+	class Output
+	{
+	public:
+		std::vector<int64_t> m_offsets;
+		std::vector<int64_t> m_durations;
+		std::vector<SPISymbol> m_samples;
+
+		void push_back(int64_t offset, int64_t duration, SPISymbol sample)
+		{
+			m_offsets.push_back(offset);
+			m_durations.push_back(duration);
+			m_samples.push_back(sample);
+		}
+	};
+
+	typedef size_t Mark;
+
+	State Begin() const
+	{ return State(); }
+
+	State Resync(int64_t position) const;
+
+	bool Step(State& s, Output& out) const;
+
+	int64_t GetPosition(const State& s) const
+	{ return s.m_timestamp; }
+
+	bool IsSyncPoint(const State& s) const
+	{ return s.m_state == STATE_DESELECTED; }
+
+	Mark GetMark(const Output& out) const
+	{ return out.m_samples.size(); }
+
+	void Append(Output& dst, Output& src, const Mark& from) const;
+
+protected:
+	void Deselect(State& s, Output& out) const;
+
+	SparseDigitalWaveform* m_sclk;
+	UniformDigitalWaveform* m_uclk;
+	SparseDigitalWaveform* m_scsn;
+	UniformDigitalWaveform* m_ucsn;
+	SparseDigitalWaveform* m_sdata;
+	UniformDigitalWaveform* m_udata;
+
+	size_t m_clklen;
+	size_t m_cslen;
+	size_t m_datalen;
+
+	///@brief Clock level on which data is sampled
+	bool m_activeClk;
+};
+
 class SPIDecoder : public Filter
 {
 public:
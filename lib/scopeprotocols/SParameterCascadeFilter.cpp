@@ -150,6 +150,24 @@ void SParameterCascadeFilter::Refresh()
 	SParameterVector s21b(GetInputWaveform(12), GetInputWaveform(13));
 	SParameterVector s22b(GetInputWaveform(14), GetInputWaveform(15));
 
+	//Interpolate all inputs to the frequencies of S11a up front, walking each one once instead of searching per point
+	SParameterVector r11a;
+	SParameterVector r12a;
+	SParameterVector r21a;
+	SParameterVector r22a;
+	SParameterVector r11b;
+	SParameterVector r12b;
+	SParameterVector r21b;
+	SParameterVector r22b;
+	s11a.InterpolatePoints(s11a, r11a);
+	s12a.InterpolatePoints(s11a, r12a);
+	s21a.InterpolatePoints(s11a, r21a);
+	s22a.InterpolatePoints(s11a, r22a);
+	s11b.InterpolatePoints(s11a, r11b);
+	s12b.InterpolatePoints(s11a, r12b);
+	s21b.InterpolatePoints(s11a, r21b);
+	s22b.InterpolatePoints(s11a, r22b);
+
 	//Vectors for output
 	size_t npoints = s11a.size();
 	SParameterVector s11o;
@@ -167,17 +185,16 @@ void SParameterCascadeFilter::Refresh()
 	{
 		float freq = s11a.m_points[i].m_frequency;
 
-		//Interpolate all inputs to our current frequency bin
-		//and convert from our default mag/angle representation to real/imaginary
-		auto p11a = s11a.InterpolatePoint(freq).ToComplex();
-		auto p12a = s12a.InterpolatePoint(freq).ToComplex();
-		auto p21a = s21a.InterpolatePoint(freq).ToComplex();
-		auto p22a = s22a.InterpolatePoint(freq).ToComplex();
-
-		auto p11b = s11b.InterpolatePoint(freq).ToComplex();
-		auto p12b = s12b.InterpolatePoint(freq).ToComplex();
-		auto p21b = s21b.InterpolatePoint(freq).ToComplex();
-		auto p22b = s22b.InterpolatePoint(freq).ToComplex();
+		//Convert from our default mag/angle representation to real/imaginary
+		auto p11a = r11a[i].ToComplex();
+		auto p12a = r12a[i].ToComplex();
+		auto p21a = r21a[i].ToComplex();
+		auto p22a = r22a[i].ToComplex();
+
+		auto p11b = r11b[i].ToComplex();
+		auto p12b = r12b[i].ToComplex();
+		auto p21b = r21b[i].ToComplex();
+		auto p22b = r22b[i].ToComplex();
 
 		//Do the actual math
 		auto one = complex<float>(1, 0);
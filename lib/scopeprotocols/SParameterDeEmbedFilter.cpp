@@ -157,6 +157,24 @@ void SParameterDeEmbedFilter::Refresh()
 	SParameterVector s21k(GetInputWaveform(12), GetInputWaveform(13));
 	SParameterVector s22k(GetInputWaveform(14), GetInputWaveform(15));
 
+	//Interpolate all inputs to the frequencies of S11c up front, walking each one once instead of searching per point
+	SParameterVector r11c;
+	SParameterVector r12c;
+	SParameterVector r21c;
+	SParameterVector r22c;
+	SParameterVector r11k;
+	SParameterVector r12k;
+	SParameterVector r21k;
+	SParameterVector r22k;
+	s11c.InterpolatePoints(s11c, r11c);
+	s12c.InterpolatePoints(s11c, r12c);
+	s21c.InterpolatePoints(s11c, r21c);
+	s22c.InterpolatePoints(s11c, r22c);
+	s11k.InterpolatePoints(s11c, r11k);
+	s12k.InterpolatePoints(s11c, r12k);
+	s21k.InterpolatePoints(s11c, r21k);
+	s22k.InterpolatePoints(s11c, r22k);
+
 	//Vectors for output
 	size_t npoints = s11c.size();
 	SParameterVector s11o;
@@ -176,17 +194,16 @@ void SParameterDeEmbedFilter::Refresh()
 	{
 		float freq = s11c.m_points[i].m_frequency;
 
-		//Interpolate all inputs to our current frequency bin
-		//and convert from our default mag/angle representation to real/imaginary
-		auto p11c = s11c.InterpolatePoint(freq).ToComplex();
-		auto p12c = s12c.InterpolatePoint(freq).ToComplex();
-		auto p21c = s21c.InterpolatePoint(freq).ToComplex();
-		auto p22c = s22c.InterpolatePoint(freq).ToComplex();
-
-		auto p11k = s11k.InterpolatePoint(freq).ToComplex();
-		auto p12k = s12k.InterpolatePoint(freq).ToComplex();
-		auto p21k = s21k.InterpolatePoint(freq).ToComplex();
-		auto p22k = s22k.InterpolatePoint(freq).ToComplex();
+		//Convert from our default mag/angle representation to real/imaginary
+		auto p11c = r11c[i].ToComplex();
+		auto p12c = r12c[i].ToComplex();
+		auto p21c = r21c[i].ToComplex();
+		auto p22c = r22c[i].ToComplex();
+
+		auto p11k = r11k[i].ToComplex();
+		auto p12k = r12k[i].ToComplex();
+		auto p21k = r21k[i].ToComplex();
+		auto p22k = r22k[i].ToComplex();
 
 		complex<float> p11;
 		complex<float> p12;
@@ -0,0 +1,248 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of SavedSessionLoader
+ */
+#include "scopeprotocols.h"
+#include "SavedSessionLoader.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Filter graph
+
+/**
+	@brief Creates every filter in the "decodes" section of a session and connects their inputs
+
+	@param node			The "decodes" node
+	@param idtable		ID table to register the new filters in, and look up inputs from
+	@param onCreated	Called for each filter as soon as it has been created and its parameters loaded,
+						before any inputs are hooked up
+	@param failed		Protocol names of any filters which couldn't be created are appended here
+ */
+void SavedSessionLoader::LoadFilters(
+	const YAML::Node& node,
+	IDTable& idtable,
+	function<void(Filter*)> onCreated,
+	vector<string>& failed)
+{
+	//No protocol decodes? Skip this section
+	if(!node)
+		return;
+
+	//Load each decode
+	for(auto it : node)
+	{
+		auto dnode = it.second;
+
+		//Create the decode
+		auto proto = dnode["protocol"].as<string>();
+		auto filter = Filter::CreateFilter(proto, dnode["color"].as<string>());
+		if(filter == nullptr)
+		{
+			failed.push_back(proto);
+			continue;
+		}
+
+		idtable.emplace(dnode["id"].as<uintptr_t>(), filter);
+
+		//Load parameters during the first pass.
+		//Parameters can't have dependencies on other channels etc.
+		//More importantly, parameters may change bus width etc
+		filter->LoadParameters(dnode, idtable);
+
+		//Resize eye patterns to a reasonable default size
+		//TODO: ngscopeclient should save actual size
+		auto eye = dynamic_cast<EyePattern*>(filter);
+		if(eye)
+		{
+			eye->SetWidth(512);
+			eye->SetHeight(512);
+		}
+
+		if(onCreated)
+			onCreated(filter);
+	}
+
+	//Make a second pass to configure the filter inputs, once all of them have been instantiated.
+	//Filters may depend on other filters as inputs, and serialization is not guaranteed to be a topological sort.
+	for(auto it : node)
+	{
+		auto dnode = it.second;
+		auto filter = static_cast<Filter*>(idtable[dnode["id"].as<uintptr_t>()]);
+		if(filter)
+			filter->LoadInputs(dnode, idtable);
+	}
+}
+
+/**
+	@brief Hooks up instrument channel inputs (e.g. external trigger sources) that reference filters
+
+	Instruments not in the ID table are skipped.
+
+	@param node		The "instruments" node
+	@param idtable	ID table containing the instruments and filters
+ */
+void SavedSessionLoader::LoadInstrumentInputs(const YAML::Node& node, IDTable& idtable)
+{
+	//Nothing to do? Skip this section
+	if(!node)
+		return;
+
+	//Check each instrument in the file and see if we have inputs that need to be hooked up
+	for(auto it : node)
+	{
+		auto inst = it.second;
+		LogTrace("Loading additional inputs for instrument \"%s\"\n", inst["nick"].as<string>().c_str());
+
+		auto pinst = static_cast<Instrument*>(idtable[inst["id"].as<uintptr_t>()]);
+		if(!pinst)
+			continue;
+
+		for(size_t i=0; i<pinst->GetChannelCount(); i++)
+		{
+			auto channelNode = inst["channels"]["ch" + to_string(i)];
+			if(channelNode)
+				pinst->GetChannel(i)->LoadInputs(channelNode, idtable);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Waveform data
+
+/**
+	@brief Loads the saved output of filters which persist their waveforms (e.g. memories)
+
+	This should be called before any scope waveforms are loaded, so no filter gets updated from nonexistent inputs and
+	changes state before its saved output is in place.
+
+	@param dataDir	Path to the _data directory of the session
+	@param idtable	ID table containing the filters
+ */
+void SavedSessionLoader::LoadFilterWaveforms(const string& dataDir, IDTable& idtable)
+{
+	string fname = dataDir + "/filter_metadata.yml";
+	FILE* fp = fopen(fname.c_str(), "r");
+	if(!fp)
+		return;
+	fclose(fp);
+
+	auto docs = YAML::LoadAllFromFile(fname);
+	if(docs.empty())
+		return;
+	auto waveforms = docs[0]["waveforms"];
+	if(!waveforms)
+		return;
+
+	string filtdir = dataDir + "/filter_waveforms";
+	for(auto it : waveforms)
+	{
+		auto ftag = it.second;
+		auto id = ftag["id"].as<uintptr_t>();
+
+		auto f = static_cast<OscilloscopeChannel*>(idtable[id]);
+		if(!f)
+			continue;
+
+		string datdir = filtdir + "/filter_" + to_string(id);
+		for(size_t i=0; i<f->GetStreamCount(); i++)
+		{
+			auto stag = ftag["streams"][string("s") + to_string(i)];
+			if(!stag)
+				continue;
+
+			//TODO: we need to encode a digital path in the YAML once MemoryFilter has digital channel support
+			//TODO: support non-analog/digital captures (eyes, spectrograms, etc)
+			if(f->GetType(0) != Stream::STREAM_TYPE_ANALOG)
+			{
+				LogError("unknown stream type loading waveform\n");
+				continue;
+			}
+
+			auto fmt = stag["format"].as<string>();
+			bool dense = (fmt == "densev1");
+			if( (fmt == "compressedv1") && stag["uniform"] )
+				dense = stag["uniform"].as<bool>();
+
+			WaveformBase* cap;
+			if(dense)
+				cap = new UniformAnalogWaveform;
+			else
+				cap = new SparseAnalogWaveform;
+
+			//Channel waveform metadata
+			cap->m_timescale = stag["timescale"].as<int64_t>();
+			cap->m_startTimestamp = ftag["timestamp"].as<int64_t>();
+			cap->m_startFemtoseconds = ftag["time_fsec"].as<int64_t>();
+			cap->m_triggerPhase = stag["trigphase"].as<long long>();
+			cap->m_flags = stag["flags"].as<int>();
+
+			//Actually load the waveform
+			string path = datdir + "/stream" + to_string(i) + ".bin";
+			f->SetData(SavedWaveformLoader::LoadStream(cap, fmt, path), i);
+		}
+	}
+}
+
+/**
+	@brief Parses the waveform metadata file of one scope, if it has one
+
+	No sample data is read yet, call SavedWaveformLoader::LoadAll() for that.
+
+	@param version		File format version of the session
+	@param scope		The scope
+	@param scopeID		ID of the scope in the session file
+	@param dataDir		Path to the _data directory of the session
+	@param waveforms	Parsed waveforms are appended here. Nothing is added if the scope has no saved waveforms.
+
+	@return True on success, false if the metadata is invalid
+ */
+bool SavedSessionLoader::ParseScopeWaveforms(
+	int version,
+	Oscilloscope* scope,
+	int scopeID,
+	const string& dataDir,
+	vector<SavedWaveformLoader::SavedWaveform>& waveforms)
+{
+	string fname = dataDir + "/scope_" + to_string(scopeID) + "_metadata.yml";
+	FILE* fp = fopen(fname.c_str(), "r");
+	if(!fp)
+		return true;
+	fclose(fp);
+
+	auto docs = YAML::LoadAllFromFile(fname);
+	if(docs.empty())
+		return true;
+
+	return SavedWaveformLoader::ParseScopeMetadata(version, docs[0], scope, scopeID, dataDir, waveforms);
+}
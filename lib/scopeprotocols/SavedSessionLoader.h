@@ -0,0 +1,68 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SavedSessionLoader
+ */
+#ifndef SavedSessionLoader_h
+#define SavedSessionLoader_h
+
+#include "SavedWaveformLoader.h"
+
+/**
+	@brief Loads the filter graph and saved waveforms of a .scopesession file
+
+	This covers everything that doesn't depend on how instruments are created or how waveforms are presented, so that
+	ngscopeclient and headless tools like ngscopebatch read the session format the same way. Instruments must already
+	have been created and added to the ID table.
+ */
+class SavedSessionLoader
+{
+public:
+	static void LoadFilters(
+		const YAML::Node& node,
+		IDTable& idtable,
+		std::function<void(Filter*)> onCreated,
+		std::vector<std::string>& failed);
+
+	static void LoadInstrumentInputs(const YAML::Node& node, IDTable& idtable);
+
+	static void LoadFilterWaveforms(const std::string& dataDir, IDTable& idtable);
+
+	static bool ParseScopeWaveforms(
+		int version,
+		Oscilloscope* scope,
+		int scopeID,
+		const std::string& dataDir,
+		std::vector<SavedWaveformLoader::SavedWaveform>& waveforms);
+};
+
+#endif
@@ -0,0 +1,592 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of SavedWaveformLoader
+ */
+#include "scopeprotocols.h"
+#include "SavedWaveformLoader.h"
+
+#include <cinttypes>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Metadata
+
+/**
+	@brief Parses the metadata file for a single scope and creates empty waveform objects for each saved stream
+
+	Duplicate timestamps within the file are dropped with a warning. No sample data is read yet, call LoadAll() for that.
+
+	@param version		File format version of the session
+	@param node			Root node of the scope_N_metadata.yml file
+	@param scope		The scope (used to guess waveform types for old files lacking type information)
+	@param scopeID		ID of the scope in the session file
+	@param dataDir		Path to the _data directory of the session
+	@param waveforms	Parsed waveforms are appended here, in file order
+
+	@return True on success
+ */
+bool SavedWaveformLoader::ParseScopeMetadata(
+	int version,
+	const YAML::Node& node,
+	Oscilloscope* scope,
+	int scopeID,
+	const string& dataDir,
+	vector<SavedWaveform>& waveforms)
+{
+	auto wavenode = node["waveforms"];
+	if(!wavenode)
+	{
+		//No waveforms
+		return true;
+	}
+
+	set< pair<time_t, int64_t> > times;
+	for(auto it : wavenode)
+	{
+		SavedWaveform rec;
+
+		//Top level metadata
+		bool timebase_is_ps = true;
+		auto wfm = it.second;
+		rec.m_timestamp = wfm["timestamp"].as<long long>();
+		if(wfm["time_psec"])
+		{
+			rec.m_fs = wfm["time_psec"].as<long long>() * 1000;
+			timebase_is_ps = true;
+		}
+		else
+		{
+			rec.m_fs = wfm["time_fsec"].as<long long>();
+			timebase_is_ps = false;
+		}
+		int waveform_id = wfm["id"].as<int>();
+		rec.m_pinned = false;
+		if(wfm["pinned"])
+		{
+			if(version <= 1)
+				rec.m_pinned = wfm["pinned"].as<int>();
+			else
+				rec.m_pinned = wfm["pinned"].as<bool>();
+		}
+		if(wfm["label"])
+			rec.m_label = wfm["label"].as<string>();
+
+		//Drop duplicate timestamps
+		auto time = pair<time_t, int64_t>(rec.m_timestamp, rec.m_fs);
+		if(times.find(time) != times.end())
+		{
+			LogWarning("Session contains duplicate data for time %" PRId64 ".%" PRId64 ", discarding\n",
+				static_cast<int64_t>(rec.m_timestamp), rec.m_fs);
+			continue;
+		}
+		times.emplace(time);
+
+		//Set up channel metadata
+		auto chans = wfm["channels"];
+		for(auto jt : chans)
+		{
+			auto ch = jt.second;
+			int channel_index = ch["index"].as<int>();
+			int stream = 0;
+			if(ch["stream"])
+				stream = ch["stream"].as<int>();
+			auto chan = scope->GetOscilloscopeChannel(channel_index);
+
+			//Waveform format defaults to sparsev1 as that's what was used before
+			//the metadata file contained a format ID at all
+			string format = "sparsev1";
+			if(ch["format"])
+				format = ch["format"].as<string>();
+
+			bool dense = (format == "densev1");
+			if( (format == "compressedv1") && ch["uniform"] )
+				dense = ch["uniform"].as<bool>();
+
+			//TODO: support non-analog/digital captures (eyes, spectrograms, etc)
+			WaveformBase* cap = nullptr;
+
+			//if datatype is specified, use that
+			if( ( (format == "sparsev1") || (format == "compressedv1") ) && ch["datatype"] )
+			{
+				auto dtype = ch["datatype"].as<string>();
+				if(dtype == "analog")
+					cap = new SparseAnalogWaveform;
+				else if(dtype == "digital")
+					cap = new SparseDigitalWaveform;
+				else if(dtype == "can")
+					cap = new CANWaveform;
+				else
+				{
+					LogError("Unrecognized sparsev1 datatype %s\n", dtype.c_str());
+					continue;
+				}
+			}
+
+			//if not guess based on stream type
+			else if(chan->GetType(0) == Stream::STREAM_TYPE_ANALOG)
+			{
+				if(dense)
+					cap = new UniformAnalogWaveform;
+				else
+					cap = new SparseAnalogWaveform;
+			}
+			else
+			{
+				if(dense)
+					cap = new UniformDigitalWaveform;
+				else
+					cap = new SparseDigitalWaveform;
+			}
+
+			//Channel waveform metadata
+			cap->m_timescale = ch["timescale"].as<long>();
+			cap->m_startTimestamp = rec.m_timestamp;
+			cap->m_startFemtoseconds = rec.m_fs;
+			if(timebase_is_ps)
+			{
+				cap->m_timescale *= 1000;
+				cap->m_triggerPhase = ch["trigphase"].as<float>() * 1000;
+			}
+			else
+				cap->m_triggerPhase = ch["trigphase"].as<long long>();
+
+			char tmp[512];
+			if(stream == 0)
+			{
+				snprintf(tmp, sizeof(tmp), "%s/scope_%d_waveforms/waveform_%d/channel_%d.bin",
+					dataDir.c_str(),
+					scopeID,
+					waveform_id,
+					channel_index);
+			}
+			else
+			{
+				snprintf(tmp, sizeof(tmp), "%s/scope_%d_waveforms/waveform_%d/channel_%d_stream%d.bin",
+					dataDir.c_str(),
+					scopeID,
+					waveform_id,
+					channel_index,
+					stream);
+			}
+
+			SavedStream s;
+			s.m_channel = channel_index;
+			s.m_stream = stream;
+			s.m_data = cap;
+			s.m_format = format;
+			s.m_path = tmp;
+			rec.m_streams.push_back(s);
+		}
+
+		waveforms.push_back(rec);
+	}
+
+	return true;
+}
+
+/**
+	@brief Loads sample data for every stream of every waveform
+
+	Files are spread across all cores, regardless of how many channels or history points there are.
+ */
+void SavedWaveformLoader::LoadAll(vector<SavedWaveform>& waveforms)
+{
+	vector<SavedStream*> jobs;
+	for(auto& w : waveforms)
+	{
+		for(auto& s : w.m_streams)
+			jobs.push_back(&s);
+	}
+
+	LogTrace("Loading %zu waveform files for %zu history points\n", jobs.size(), waveforms.size());
+
+	#pragma omp parallel for schedule(dynamic, 1) if(jobs.size() > 1)
+	for(size_t i=0; i<jobs.size(); i++)
+		jobs[i]->m_data = LoadStream(jobs[i]->m_data, jobs[i]->m_format, jobs[i]->m_path);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sample data
+
+/**
+	@brief Number of samples per block when de-interleaving a single large sparse waveform across multiple threads
+ */
+static const size_t SPARSE_LOAD_BLOCK_SIZE = 1024 * 1024;
+
+/**
+	@brief De-interleaves sparsev1 analog records (int64 offset, int64 duration, float sample) into separate arrays
+
+	@param buf			Raw file contents
+	@param start		Index of the first record to de-interleave
+	@param end			Index one past the last record to de-interleave
+	@param offsets		Output offset array (indexed by record, not relative to start)
+	@param durations	Output duration array
+	@param samples		Output sample array
+ */
+void SavedWaveformLoader::DeinterleaveSparseAnalog(
+	const uint8_t* buf,
+	size_t start,
+	size_t end,
+	int64_t* offsets,
+	int64_t* durations,
+	float* samples)
+{
+	#ifdef __x86_64__
+	if(g_hasAvx2)
+	{
+		DeinterleaveSparseAnalogAVX2(buf, start, end, offsets, durations, samples);
+		return;
+	}
+	#endif
+
+	DeinterleaveSparseAnalogGeneric(buf, start, end, offsets, durations, samples);
+}
+
+/**
+	@brief Generic backend for DeinterleaveSparseAnalog()
+ */
+void SavedWaveformLoader::DeinterleaveSparseAnalogGeneric(
+	const uint8_t* buf,
+	size_t start,
+	size_t end,
+	int64_t* offsets,
+	int64_t* durations,
+	float* samples)
+{
+	const size_t samplesize = 2*sizeof(int64_t) + sizeof(float);
+	for(size_t j=start; j<end; j++)
+	{
+		const uint8_t* p = buf + j*samplesize;
+
+		//The file format assumes "float" is IEEE754 32-bit float.
+		//If your platform doesn't do that, good luck.
+		memcpy(&offsets[j], p, sizeof(int64_t));
+		memcpy(&durations[j], p + sizeof(int64_t), sizeof(int64_t));
+		memcpy(&samples[j], p + 2*sizeof(int64_t), sizeof(float));
+	}
+}
+
+#ifdef __x86_64__
+/**
+	@brief AVX2 backend for DeinterleaveSparseAnalog(), gathering eight records per iteration
+ */
+__attribute__((target("avx2")))
+void SavedWaveformLoader::DeinterleaveSparseAnalogAVX2(
+	const uint8_t* buf,
+	size_t start,
+	size_t end,
+	int64_t* offsets,
+	int64_t* durations,
+	float* samples)
+{
+	const size_t samplesize = 2*sizeof(int64_t) + sizeof(float);
+
+	//Byte offsets of eight consecutive 20-byte records
+	__m256i index8 = _mm256_set_epi32(140, 120, 100, 80, 60, 40, 20, 0);
+	__m128i indexLo = _mm_set_epi32(60, 40, 20, 0);
+	__m128i indexHi = _mm_set_epi32(140, 120, 100, 80);
+
+	size_t count = end - start;
+	size_t end_rounded = start + count - (count % 8);
+
+	size_t j = start;
+	for(; j<end_rounded; j += 8)
+	{
+		const uint8_t* p = buf + j*samplesize;
+		auto p64 = reinterpret_cast<const long long*>(p);
+		auto pdur = reinterpret_cast<const long long*>(p + sizeof(int64_t));
+		auto pfloat = reinterpret_cast<const float*>(p + 2*sizeof(int64_t));
+
+		__m256i off0 = _mm256_i32gather_epi64(p64, indexLo, 1);
+		__m256i off1 = _mm256_i32gather_epi64(p64, indexHi, 1);
+		__m256i dur0 = _mm256_i32gather_epi64(pdur, indexLo, 1);
+		__m256i dur1 = _mm256_i32gather_epi64(pdur, indexHi, 1);
+		__m256 fsamples = _mm256_i32gather_ps(pfloat, index8, 1);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(offsets + j), off0);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(offsets + j + 4), off1);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(durations + j), dur0);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(durations + j + 4), dur1);
+		_mm256_storeu_ps(samples + j, fsamples);
+	}
+
+	DeinterleaveSparseAnalogGeneric(buf, j, end, offsets, durations, samples);
+}
+#endif /* __x86_64__ */
+
+/**
+	@brief Loads sample data for a single stream of a saved waveform
+
+	This does not touch any session or channel state, so it's safe to call for many streams in parallel.
+
+	@param cap		Empty waveform of the appropriate type, with metadata filled out
+	@param format	Waveform file format ("sparsev1", "densev1", or "compressedv1")
+	@param fname	Path to the waveform file
+
+	@return The loaded waveform. This may be a different object than cap if a sparse waveform turned out to be
+			uniformly sampled, in which case cap is deleted.
+ */
+WaveformBase* SavedWaveformLoader::LoadStream(
+	WaveformBase* cap,
+	const string& format,
+	const string& fname
+	)
+{
+	auto sacap = dynamic_cast<SparseAnalogWaveform*>(cap);
+	auto uacap = dynamic_cast<UniformAnalogWaveform*>(cap);
+	auto sdcap = dynamic_cast<SparseDigitalWaveform*>(cap);
+	auto udcap = dynamic_cast<UniformDigitalWaveform*>(cap);
+	auto ccap = dynamic_cast<CANWaveform*>(cap);
+
+	cap->PrepareForCpuAccess();
+
+	//Load samples into memory
+	unsigned char* buf = NULL;
+
+	//Windows: use generic file reads for now
+	#ifdef _WIN32
+		FILE* fp = fopen(fname.c_str(), "rb");
+		if(!fp)
+		{
+			LogError("couldn't open %s\n", fname.c_str());
+			return cap;
+		}
+
+		//Read the whole file into a buffer a megabyte at a time
+		fseek(fp, 0, SEEK_END);
+		long len = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		buf = new unsigned char[len];
+		long len_remaining = len;
+		long blocksize = 1024*1024;
+		long read_offset = 0;
+		while(len_remaining > 0)
+		{
+			if(blocksize > len_remaining)
+				blocksize = len_remaining;
+
+			//Most time is spent on the fread's when using this path
+			fread(buf + read_offset, 1, blocksize, fp);
+
+			len_remaining -= blocksize;
+			read_offset += blocksize;
+		}
+		fclose(fp);
+
+	//On POSIX, just memory map the file
+	#else
+		int fd = open(fname.c_str(), O_RDONLY);
+		if(fd < 0)
+		{
+			LogError("couldn't open %s\n", fname.c_str());
+			return cap;
+		}
+		size_t len = lseek(fd, 0, SEEK_END);
+		if(len == 0)
+		{
+			::close(fd);
+			return cap;
+		}
+		buf = (unsigned char*)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(buf == MAP_FAILED)
+		{
+			LogError("couldn't map %s\n", fname.c_str());
+			::close(fd);
+			return cap;
+		}
+
+		//We read the whole file front to back exactly once, so have the kernel start reading ahead right away
+		madvise(buf, len, MADV_SEQUENTIAL);
+		madvise(buf, len, MADV_WILLNEED);
+	#endif
+
+	//Sparse interleaved
+	if(format == "sparsev1")
+	{
+		//Figure out how many samples we have
+		size_t samplesize = 2*sizeof(int64_t);
+		if(sacap)
+			samplesize += sizeof(float);
+		else if(sdcap)
+			samplesize += sizeof(bool);
+		else if(ccap)
+			samplesize += 2*sizeof(int32_t);
+		size_t nsamples = len / samplesize;
+		cap->Resize(nsamples);
+
+		//Split large waveforms into blocks and de-interleave in parallel
+		//(this is a no-op if we're already running in parallel across multiple waveforms)
+		size_t nblocks = (nsamples + SPARSE_LOAD_BLOCK_SIZE - 1) / SPARSE_LOAD_BLOCK_SIZE;
+		#pragma omp parallel for if(nblocks > 1)
+		for(size_t block=0; block<nblocks; block++)
+		{
+			size_t start = block * SPARSE_LOAD_BLOCK_SIZE;
+			size_t end = min(nsamples, start + SPARSE_LOAD_BLOCK_SIZE);
+
+			if(sacap)
+			{
+				DeinterleaveSparseAnalog(
+					buf,
+					start,
+					end,
+					sacap->m_offsets.GetCpuPointer(),
+					sacap->m_durations.GetCpuPointer(),
+					sacap->m_samples.GetCpuPointer());
+			}
+
+			else if(sdcap)
+			{
+				for(size_t j=start; j<end; j++)
+				{
+					const uint8_t* p = buf + j*samplesize;
+					memcpy(&sdcap->m_offsets[j], p, sizeof(int64_t));
+					memcpy(&sdcap->m_durations[j], p + sizeof(int64_t), sizeof(int64_t));
+					sdcap->m_samples[j] = *reinterpret_cast<const bool*>(p + 2*sizeof(int64_t));
+				}
+			}
+
+			//CAN capture
+			else if(ccap)
+			{
+				for(size_t j=start; j<end; j++)
+				{
+					const uint8_t* p = buf + j*samplesize;
+					uint32_t sym[2];
+					memcpy(&ccap->m_offsets[j], p, sizeof(int64_t));
+					memcpy(&ccap->m_durations[j], p + sizeof(int64_t), sizeof(int64_t));
+					memcpy(sym, p + 2*sizeof(int64_t), sizeof(sym));
+
+					ccap->m_samples[j] = CANSymbol((CANSymbol::stype)sym[1], sym[0]);
+				}
+			}
+		}
+
+		//Quickly check if the waveform is dense packed, even if it was stored as sparse.
+		//Since we know samples must be monotonic and non-overlapping, we don't have to check every single one!
+		int64_t nlast = nsamples - 1;
+		if(sacap && nsamples)
+		{
+			if( (sacap->m_offsets[0] == 0) &&
+				(sacap->m_offsets[nlast] == nlast) &&
+				(sacap->m_durations[nlast] == 1) )
+			{
+				//Waveform was actually uniform, so convert it
+				cap = new UniformAnalogWaveform(*sacap);
+				delete sacap;
+			}
+		}
+	}
+
+	//Dense packed
+	else if(format == "densev1")
+	{
+		//Figure out length
+		size_t nsamples = 0;
+		if(uacap)
+			nsamples = len / sizeof(float);
+		else if(udcap)
+			nsamples = len / sizeof(bool);
+		cap->Resize(nsamples);
+
+		//Read sample data
+		if(uacap)
+			memcpy(uacap->m_samples.GetCpuPointer(), buf, nsamples*sizeof(float));
+		else
+			memcpy(udcap->m_samples.GetCpuPointer(), buf, nsamples*sizeof(bool));
+	}
+
+	//Compressed with WaveformCodec
+	else if(format == "compressedv1")
+	{
+		bool ok = false;
+
+		//CAN symbols are stored as a (data, type) column since the codec doesn't know about protocol waveforms
+		if(ccap)
+		{
+			size_t nsamples;
+			size_t ncols;
+			if(WaveformCodec::ReadHeader(buf, len, nsamples, ncols))
+			{
+				ccap->Resize(nsamples);
+				vector<uint32_t> syms(nsamples*2);
+				vector<WaveformCodec::Column> cols =
+				{
+					WaveformCodec::Column(ccap->m_offsets.GetCpuPointer(), sizeof(int64_t), true),
+					WaveformCodec::Column(ccap->m_durations.GetCpuPointer(), sizeof(int64_t), true),
+					WaveformCodec::Column(syms.data(), 2*sizeof(uint32_t))
+				};
+				ok = WaveformCodec::Decompress(buf, len, cols);
+				for(size_t j=0; ok && (j<nsamples); j++)
+					ccap->m_samples[j] = CANSymbol((CANSymbol::stype)syms[j*2 + 1], syms[j*2]);
+			}
+		}
+		else
+			ok = WaveformCodec::DecompressWaveform(buf, len, cap);
+
+		if(!ok)
+		{
+			LogError("Compressed waveform %s is corrupted\n", fname.c_str());
+			cap->Resize(0);
+		}
+	}
+
+	else
+	{
+		LogError(
+			"Unknown waveform format \"%s\", perhaps this file was created by a newer version of ngscopeclient?\n",
+			format.c_str());
+	}
+
+	cap->MarkModifiedFromCpu();
+	cap->PrepareForGpuAccess();
+
+	#ifdef _WIN32
+		delete[] buf;
+	#else
+		munmap(buf, len);
+		::close(fd);
+	#endif
+
+	return cap;
+}
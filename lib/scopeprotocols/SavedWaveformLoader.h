@@ -0,0 +1,130 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2023 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SavedWaveformLoader
+ */
+#ifndef SavedWaveformLoader_h
+#define SavedWaveformLoader_h
+
+/**
+	@brief Reads waveform data from the _data directory of a saved .scopesession
+
+	This only deals with the on-disk waveform formats and doesn't touch any session, channel, or UI state, so it can be
+	shared by ngscopeclient and headless tools. It lives in libscopeprotocols rather than libscopehal because sessions
+	may contain protocol waveforms (e.g. CAN) which are defined here.
+ */
+class SavedWaveformLoader
+{
+public:
+
+	/**
+		@brief A single stream of a saved waveform
+	 */
+	class SavedStream
+	{
+	public:
+		///@brief Index of the channel within the instrument
+		int m_channel;
+
+		///@brief Index of the stream within the channel
+		int m_stream;
+
+		///@brief The waveform (empty with only metadata filled out, until LoadAll() is called)
+		WaveformBase* m_data;
+
+		///@brief File format ("sparsev1", "densev1", or "compressedv1")
+		std::string m_format;
+
+		///@brief Path to the sample data file
+		std::string m_path;
+	};
+
+	/**
+		@brief All of the streams of one instrument captured at a single point in time (one history entry)
+	 */
+	class SavedWaveform
+	{
+	public:
+		///@brief Integer part of the capture timestamp
+		time_t m_timestamp;
+
+		///@brief Fractional part of the capture timestamp, in femtoseconds
+		int64_t m_fs;
+
+		///@brief True if the history entry was pinned
+		bool m_pinned;
+
+		///@brief Label of the history entry
+		std::string m_label;
+
+		///@brief The streams captured at this time
+		std::vector<SavedStream> m_streams;
+	};
+
+	static bool ParseScopeMetadata(
+		int version,
+		const YAML::Node& node,
+		Oscilloscope* scope,
+		int scopeID,
+		const std::string& dataDir,
+		std::vector<SavedWaveform>& waveforms);
+
+	static void LoadAll(std::vector<SavedWaveform>& waveforms);
+
+	static WaveformBase* LoadStream(WaveformBase* cap, const std::string& format, const std::string& fname);
+
+	static void DeinterleaveSparseAnalog(
+		const uint8_t* buf,
+		size_t start,
+		size_t end,
+		int64_t* offsets,
+		int64_t* durations,
+		float* samples);
+	static void DeinterleaveSparseAnalogGeneric(
+		const uint8_t* buf,
+		size_t start,
+		size_t end,
+		int64_t* offsets,
+		int64_t* durations,
+		float* samples);
+#ifdef __x86_64__
+	static void DeinterleaveSparseAnalogAVX2(
+		const uint8_t* buf,
+		size_t start,
+		size_t end,
+		int64_t* offsets,
+		int64_t* durations,
+		float* samples);
+#endif
+};
+
+#endif
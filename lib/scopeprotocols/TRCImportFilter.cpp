@@ -82,6 +82,70 @@ string TRCImportFilter::GetProtocolName()
 	return "TRC Import";
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Byte order conversion
+
+static_assert(sizeof(TRCImportFilter::WaveDesc) == 346, "Wrong size for WaveDesc");
+static_assert(sizeof(TRCImportFilter::TrigTime) == 16, "Wrong size for TrigTime");
+
+void TRCImportFilter::WaveDesc::SwapEndian()
+{
+	commType = MappedFile::ByteSwap(commType);
+	commOrder = MappedFile::ByteSwap(commOrder);
+	waveDescLength = MappedFile::ByteSwap(waveDescLength);
+	userTextLength = MappedFile::ByteSwap(userTextLength);
+	resDesc1Length = MappedFile::ByteSwap(resDesc1Length);
+	trigTimeLength = MappedFile::ByteSwap(trigTimeLength);
+	risTimeLength = MappedFile::ByteSwap(risTimeLength);
+	resArray1Length = MappedFile::ByteSwap(resArray1Length);
+	waveArray1Length = MappedFile::ByteSwap(waveArray1Length);
+	waveArray2Length = MappedFile::ByteSwap(waveArray2Length);
+	resArray2Length = MappedFile::ByteSwap(resArray2Length);
+	resArray3Length = MappedFile::ByteSwap(resArray3Length);
+	instrumentNumber = MappedFile::ByteSwap(instrumentNumber);
+	waveArrayCount = MappedFile::ByteSwap(waveArrayCount);
+	pointsPerScreen = MappedFile::ByteSwap(pointsPerScreen);
+	firstValidPoint = MappedFile::ByteSwap(firstValidPoint);
+	lastValidPoint = MappedFile::ByteSwap(lastValidPoint);
+	firstPoint = MappedFile::ByteSwap(firstPoint);
+	sparsingFactor = MappedFile::ByteSwap(sparsingFactor);
+	segmentIndex = MappedFile::ByteSwap(segmentIndex);
+	subarrayCount = MappedFile::ByteSwap(subarrayCount);
+	sweepsPerAcq = MappedFile::ByteSwap(sweepsPerAcq);
+	pointsPerPair = MappedFile::ByteSwap(pointsPerPair);
+	pairOffset = MappedFile::ByteSwap(pairOffset);
+	verticalGain = MappedFile::ByteSwap(verticalGain);
+	verticalOffset = MappedFile::ByteSwap(verticalOffset);
+	maxValue = MappedFile::ByteSwap(maxValue);
+	minValue = MappedFile::ByteSwap(minValue);
+	nominalBits = MappedFile::ByteSwap(nominalBits);
+	nomSubarrayCount = MappedFile::ByteSwap(nomSubarrayCount);
+	horizInterval = MappedFile::ByteSwap(horizInterval);
+	horizOffset = MappedFile::ByteSwap(horizOffset);
+	pixelOffset = MappedFile::ByteSwap(pixelOffset);
+	horizUncertainty = MappedFile::ByteSwap(horizUncertainty);
+	triggerSeconds = MappedFile::ByteSwap(triggerSeconds);
+	triggerYear = MappedFile::ByteSwap(triggerYear);
+	acqDuration = MappedFile::ByteSwap(acqDuration);
+	recordType = MappedFile::ByteSwap(recordType);
+	processingDone = MappedFile::ByteSwap(processingDone);
+	risSweeps = MappedFile::ByteSwap(risSweeps);
+	timebase = MappedFile::ByteSwap(timebase);
+	vertCoupling = MappedFile::ByteSwap(vertCoupling);
+	probeAtt = MappedFile::ByteSwap(probeAtt);
+	fixedVertGain = MappedFile::ByteSwap(fixedVertGain);
+	bandwidthLimit = MappedFile::ByteSwap(bandwidthLimit);
+	verticalVernier = MappedFile::ByteSwap(verticalVernier);
+	acqVertOffset = MappedFile::ByteSwap(acqVertOffset);
+	waveSource = MappedFile::ByteSwap(waveSource);
+}
+
+void TRCImportFilter::TrigTime::SwapEndian()
+{
+	triggerTime = MappedFile::ByteSwap(triggerTime);
+	triggerOffset = MappedFile::ByteSwap(triggerOffset);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -94,8 +158,8 @@ void TRCImportFilter::OnFileNameChanged()
 	LogTrace("Loading TRC waveform %s\n", fname.c_str());
 	LogIndenter li;
 
-	FILE* fp = fopen(fname.c_str(), "rb");
-	if(!fp)
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		LogError("Couldn't open TRC file \"%s\"\n", fname.c_str());
 		return;
@@ -104,232 +168,170 @@ void TRCImportFilter::OnFileNameChanged()
 	//Read the SCPI file length header
 	//Expect #9 followed by 9 digit ASCII length
 	char header[13] = {0};
-	if(11 != fread(header, 1, 11, fp))
+	size_t headerLen = 11;
+	if(!file.Contains(0, headerLen))
 	{
 		LogError("Failed to read file length header\n");
-		fclose(fp);
 		return;
 	}
+	memcpy(header, file.GetData(), headerLen);
 	if((header[0] != '#') || (header[1] != '9') )
 	{
 		//Really long files are #A followed by 10 digit length
 		if( (header[0] == '#') && (header[1] == 'A') )
 		{
-			if(1 != fread(&header[11], 1, 1, fp))
+			headerLen = 12;
+			if(!file.Contains(0, headerLen))
 			{
 				LogError("Failed to read file length header\n");
-				fclose(fp);
 				return;
 			}
+			header[11] = file.GetData()[11];
 		}
 
 		else
 		{
 			LogError("Invalid file length header\n");
-			fclose(fp);
 			return;
 		}
 	}
-	size_t len = stoull(header+2);
+	size_t len = strtoull(header+2, nullptr, 10);
 	LogTrace("File length from header: %zu bytes\n", len);
-	const size_t wavedescSize = 346;
-	if(len < wavedescSize)
+	if(len < sizeof(WaveDesc))
 	{
 		LogError("Invalid file length in header (too small for WAVEDESC)\n");
-		fclose(fp);
 		return;
 	}
 
 	//Read the WAVEDESC
-	uint8_t wavedesc[wavedescSize];
-	if(wavedescSize != fread(wavedesc, 1, wavedescSize, fp))
+	WaveDesc desc;
+	if(!file.Read(headerLen, desc))
 	{
 		LogError("Failed to read WAVEDESC\n");
-		fclose(fp);
 		return;
 	}
 
 	//Validate the WAVEDESC
-	if(0 != memcmp(wavedesc, "WAVEDESC", 8))
+	if(0 != memcmp(desc.descriptorName, "WAVEDESC", 8))
 	{
 		LogError("Malformed WAVEDESC (magic number is wrong)\n");
-		fclose(fp);
 		return;
 	}
 
+	//COMM_ORDER is 0 for big endian and 1 for little endian (which is what we run on)
+	bool byteswap = (desc.commOrder == 0);
+	if(byteswap)
+	{
+		LogTrace("Byte order:              big endian\n");
+		desc.SwapEndian();
+	}
+
 	//Figure out sample resolution
-	bool hdMode = (wavedesc[32] != 0);
+	bool hdMode = (desc.commType != 0);
 	if(hdMode)
 		LogTrace("Sample format:           int16_t\n");
 	else
 		LogTrace("Sample format:           int8_t\n");
 
-	//Assume little endian for now
-
 	//Get instrument format
-	char instName[17] = {0};
-	memcpy(instName, wavedesc + 76, 16);
-	LogTrace("Instrument name:         %s\n", instName);
-
-	//cppcheck-suppress invalidPointerCast
-	float v_gain = *reinterpret_cast<float*>(wavedesc + 156);
+	string instName(desc.instrumentName, strnlen(desc.instrumentName, sizeof(desc.instrumentName)));
+	LogTrace("Instrument name:         %s\n", instName.c_str());
 
-	//cppcheck-suppress invalidPointerCast
-	float v_off = *reinterpret_cast<float*>(wavedesc + 160);
-
-	//cppcheck-suppress invalidPointerCast
-	float interval = *reinterpret_cast<float*>(wavedesc + 176) * FS_PER_SECOND;
-
-	//cppcheck-suppress invalidPointerCast
-	double h_off = *reinterpret_cast<double*>(wavedesc + 180) * FS_PER_SECOND;	//fs from start of waveform to trigger
+	float v_gain = desc.verticalGain;
+	float v_off = desc.verticalOffset;
+	float interval = desc.horizInterval * FS_PER_SECOND;
+	double h_off = desc.horizOffset * FS_PER_SECOND;	//fs from start of waveform to trigger
 
 	double h_off_frac = fmodf(h_off, interval);						//fractional sample position, in fs
 	if(h_off_frac < 0)
-		h_off_frac = interval + h_off_frac;		//double h_unit = *reinterpret_cast<double*>(pdesc + 244);
+		h_off_frac = interval + h_off_frac;
 
-	//Get the waveform timestamp
+	//Get the waveform timestamp (the descriptor is in our byte order now, so it's safe to use the raw bytes)
 	double basetime;
-	auto ttime = LeCroyOscilloscope::ExtractTimestamp(wavedesc, basetime);
+	auto ttime = LeCroyOscilloscope::ExtractTimestamp(reinterpret_cast<unsigned char*>(&desc), basetime);
 
-	//TODO: support sequence mode .trc files here??
-
-	//Set up output stream
-	//Channel number is byte at offset 344 (zero based)
-	ClearStreams();
-	string chName = string("C") + to_string(wavedesc[344] + 1);
-	AddStream(Unit(Unit::UNIT_VOLTS), chName, Stream::STREAM_TYPE_ANALOG);
-	m_outputsChangedSignal.emit();
-
-	//Figure out length of actual waveform data
-	size_t datalen = len - wavedescSize;
-	size_t num_samples;
-	if(hdMode)
-		num_samples = datalen/2;
-	else
-		num_samples = datalen;
-	size_t num_per_segment = num_samples /* / num_sequences*/;
-
-	//Create output waveform
-	auto wfm = new UniformAnalogWaveform;
-	wfm->m_timescale = round(interval);
-	wfm->m_startTimestamp = ttime;
-	wfm->m_startFemtoseconds = basetime * FS_PER_SECOND;
-	wfm->m_triggerPhase = h_off_frac;
-	SetData(wfm, 0);
-	LogTrace("Sample interval: %s\n", Unit(Unit::UNIT_FS).PrettyPrint(wfm->m_timescale).c_str());
-	LogTrace("Trigger phase: %s\n", Unit(Unit::UNIT_FS).PrettyPrint(wfm->m_triggerPhase).c_str());
-
-	wfm->Resize(num_per_segment);
-
-	//16 bit sample path
-	if(hdMode)
+	//Find the blocks following the WAVEDESC
+	if(	(desc.waveDescLength < 0) || (desc.userTextLength < 0) || (desc.resDesc1Length < 0) ||
+		(desc.trigTimeLength < 0) || (desc.risTimeLength < 0) || (desc.resArray1Length < 0) ||
+		(desc.waveArray1Length < 0) )
 	{
-		AcceleratorBuffer<int16_t> buf;
-		buf.resize(num_per_segment);
-		buf.PrepareForCpuAccess();
-
-		if(num_per_segment != fread(&buf[0], sizeof(int16_t), num_per_segment, fp))
-		{
-			LogError("Failed to read sample data\n");
-			fclose(fp);
-			return;
-		}
-		buf.MarkModifiedFromCpu();
-
-		//The accelerated filter needs int16 support
-		/*if(g_hasShaderInt16 && g_gpuFilterEnabled)
-		{
-			m_commandBuffer->begin({});
-
-			//Update our descriptor sets with current buffers
-			m_computePipeline16Bit->BindBufferNonblocking(0, wfm->m_samples, *m_commandBuffer, true);
-			m_computePipeline16Bit->BindBufferNonblocking(1, buf, *m_commandBuffer);
-
-			ConvertRawSamplesShaderArgs args;
-			args.size = num_per_segment;
-			args.gain = v_gain;
-			args.offset = v_off;
-
-			//Dispatch the compute operation and block until it completes
-			//We are in an event handler, so use the global transfer queue here
-			m_computePipeline16Bit->Dispatch(*m_commandBuffer, args, GetComputeBlockCount(len, 64));
-			m_commandBuffer->end();
-
-			g_vkTransferQueue->SubmitAndBlock(*m_commandBuffer);
-
-			wfm->MarkModifiedFromGpu();
-		}
-
-		//Software fallback
-		else*/
-		{
-			wfm->PrepareForCpuAccess();
-
-			Oscilloscope::Convert16BitSamples(
-				(float*)&wfm->m_samples[0],
-				&buf[0],
-				v_gain,
-				v_off,
-				num_per_segment);
-
-			wfm->MarkModifiedFromCpu();
-		}
+		LogError("Malformed WAVEDESC (negative block length)\n");
+		return;
 	}
-
-	//8 bit sample path
-	else
+	size_t trigTimeStart =
+		headerLen + static_cast<size_t>(desc.waveDescLength) + desc.userTextLength + desc.resDesc1Length;
+	size_t dataStart = trigTimeStart + desc.trigTimeLength + desc.risTimeLength + desc.resArray1Length;
+	size_t datalen = desc.waveArray1Length;
+	if(!file.Contains(dataStart, datalen))
 	{
-		AcceleratorBuffer<int8_t> buf;
-		buf.resize(num_per_segment);
-		buf.PrepareForCpuAccess();
+		LogError("Failed to read sample data\n");
+		return;
+	}
 
-		if(num_per_segment != fread(&buf[0], sizeof(int8_t), num_per_segment, fp))
+	//Sequence mode files have one TRIGTIME entry per segment
+	size_t nsegments = 1;
+	vector<TrigTime> trigTimes;
+	if(desc.trigTimeLength > 0)
+	{
+		nsegments = desc.trigTimeLength / sizeof(TrigTime);
+		trigTimes.resize(nsegments);
+		for(size_t i=0; i<nsegments; i++)
 		{
-			LogError("Failed to read sample data\n");
-			fclose(fp);
-			return;
+			file.Read(trigTimeStart + i*sizeof(TrigTime), trigTimes[i]);
+			if(byteswap)
+				trigTimes[i].SwapEndian();
 		}
-		buf.MarkModifiedFromCpu();
-
-		//The accelerated filter needs int8 support
-		/*if(g_hasShaderInt8 && g_gpuFilterEnabled)
-		{
-			m_commandBuffer->begin({});
-
-			//Update our descriptor sets with current buffers
-			m_computePipeline8Bit->BindBufferNonblocking(0, wfm->m_samples, *m_commandBuffer, true);
-			m_computePipeline8Bit->BindBufferNonblocking(1, buf, *m_commandBuffer);
-
-			ConvertRawSamplesShaderArgs args;
-			args.size = num_per_segment;
-			args.gain = v_gain;
-			args.offset = v_off;
-
-			//Dispatch the compute operation and block until it completes
-			//We are in an event handler, so use the global transfer queue here
-			m_computePipeline8Bit->Dispatch(*m_commandBuffer, args, GetComputeBlockCount(len, 64));
-			m_commandBuffer->end();
-
-			g_vkTransferQueue->SubmitAndBlock(*m_commandBuffer);
-
-			wfm->MarkModifiedFromGpu();
-		}
-
-		//Software fallback
-		else*/
-		{
-			wfm->PrepareForCpuAccess();
+	}
+	if(nsegments == 0)
+	{
+		LogError("Malformed WAVEDESC (empty TRIGTIME array)\n");
+		return;
+	}
+	LogTrace("Segments:                %zu\n", nsegments);
 
-			Oscilloscope::Convert8BitSamples(
-				(float*)&wfm->m_samples[0],
-				&buf[0],
-				v_gain,
-				v_off,
-				num_per_segment);
+	//Figure out length of actual waveform data
+	size_t bytesPerSample = hdMode ? 2 : 1;
+	size_t num_samples = datalen / bytesPerSample;
+	size_t num_per_segment = num_samples / nsegments;
 
-			wfm->MarkModifiedFromCpu();
-		}
+	//Set up output streams, one per segment
+	//Channel number is WAVE_SOURCE (zero based)
+	ClearStreams();
+	string chName = string("C") + to_string(desc.waveSource + 1);
+	vector<RawSampleBlock> blocks;
+	for(size_t i=0; i<nsegments; i++)
+	{
+		if(nsegments == 1)
+			AddStream(Unit(Unit::UNIT_VOLTS), chName, Stream::STREAM_TYPE_ANALOG);
+		else
+			AddStream(Unit(Unit::UNIT_VOLTS), chName + "[" + to_string(i) + "]", Stream::STREAM_TYPE_ANALOG);
+
+		//Create output waveform
+		auto wfm = new UniformAnalogWaveform;
+		wfm->m_timescale = round(interval);
+		wfm->m_startTimestamp = ttime;
+		if(trigTimes.empty())
+			wfm->m_startFemtoseconds = basetime * FS_PER_SECOND;
+		else
+			wfm->m_startFemtoseconds = (basetime + trigTimes[i].triggerTime) * FS_PER_SECOND;
+		wfm->m_triggerPhase = h_off_frac;
+		SetData(wfm, i);
+
+		blocks.push_back(RawSampleBlock(
+			wfm,
+			file.GetData() + dataStart + i*num_per_segment*bytesPerSample,
+			num_per_segment,
+			hdMode,
+			byteswap,
+			v_gain,
+			v_off));
 	}
+	m_outputsChangedSignal.emit();
+	LogTrace("Sample interval: %s\n", Unit(Unit::UNIT_FS).PrettyPrint(round(interval)).c_str());
+	LogTrace("Trigger phase: %s\n", Unit(Unit::UNIT_FS).PrettyPrint(h_off_frac).c_str());
+
+	//Convert all segments in parallel
+	ConvertRawSamples(blocks);
 
-	LogTrace("Loaded %zu samples\n", wfm->size());
+	LogTrace("Loaded %zu samples\n", num_samples);
 }
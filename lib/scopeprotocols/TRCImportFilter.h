@@ -45,6 +45,86 @@ public:
 
 	PROTOCOL_DECODER_INITPROC(TRCImportFilter)
 
+	//Teledyne LeCroy WAVEDESC block (LECROY_2_3 template)
+	#pragma pack(push, 1)
+	struct WaveDesc
+	{
+		char descriptorName[16];	//"WAVEDESC"
+		char templateName[16];		//Template name
+		int16_t commType;			//0 = int8_t samples, 1 = int16_t samples
+		int16_t commOrder;			//0 = big endian, 1 = little endian
+		int32_t waveDescLength;		//Length of this block
+		int32_t userTextLength;		//Length of the USER_TEXT block
+		int32_t resDesc1Length;		//Length of the RES_DESC1 block
+		int32_t trigTimeLength;		//Length of the TRIGTIME array (16 bytes per segment)
+		int32_t risTimeLength;		//Length of the RIS_TIME array
+		int32_t resArray1Length;	//Length of the RES_ARRAY1 block
+		int32_t waveArray1Length;	//Length of the sample data, in bytes
+		int32_t waveArray2Length;	//Length of the second sample array, in bytes
+		int32_t resArray2Length;	//Length of the RES_ARRAY2 block
+		int32_t resArray3Length;	//Length of the RES_ARRAY3 block
+		char instrumentName[16];	//Instrument name
+		int32_t instrumentNumber;	//Instrument number
+		char traceLabel[16];		//Trace label
+		int16_t reserved1;
+		int16_t reserved2;
+		int32_t waveArrayCount;		//Number of samples
+		int32_t pointsPerScreen;	//Nominal number of samples on screen
+		int32_t firstValidPoint;	//First valid sample
+		int32_t lastValidPoint;		//Last valid sample
+		int32_t firstPoint;			//Offset of first sample
+		int32_t sparsingFactor;		//Sparsing factor
+		int32_t segmentIndex;		//Index of the transmitted segment
+		int32_t subarrayCount;		//Number of segments
+		int32_t sweepsPerAcq;		//Number of sweeps averaged
+		int16_t pointsPerPair;		//Points per data pair (peak detect)
+		int16_t pairOffset;			//Pair offset
+		float verticalGain;			//Volts per code
+		float verticalOffset;		//Volts subtracted after applying gain
+		float maxValue;				//Maximum code value
+		float minValue;				//Minimum code value
+		int16_t nominalBits;		//ADC resolution
+		int16_t nomSubarrayCount;	//Nominal number of segments
+		float horizInterval;		//Sample interval, in seconds
+		double horizOffset;			//Time from trigger to first sample, in seconds
+		double pixelOffset;			//Pixel offset
+		char vertUnit[48];			//Vertical unit
+		char horUnit[48];			//Horizontal unit
+		float horizUncertainty;		//Horizontal uncertainty
+		double triggerSeconds;		//Trigger time: seconds
+		uint8_t triggerMinutes;		//Trigger time: minutes
+		uint8_t triggerHours;		//Trigger time: hours
+		uint8_t triggerDays;		//Trigger time: day of month
+		uint8_t triggerMonths;		//Trigger time: month
+		uint16_t triggerYear;		//Trigger time: year
+		uint16_t triggerUnused;
+		float acqDuration;			//Acquisition duration
+		int16_t recordType;			//Record type
+		int16_t processingDone;		//Processing done
+		int16_t reserved5;
+		int16_t risSweeps;			//Number of RIS sweeps
+		int16_t timebase;			//Timebase setting
+		int16_t vertCoupling;		//Vertical coupling
+		float probeAtt;				//Probe attenuation
+		int16_t fixedVertGain;		//Vertical gain setting
+		int16_t bandwidthLimit;		//Bandwidth limit
+		float verticalVernier;		//Vertical vernier
+		float acqVertOffset;		//Acquisition vertical offset
+		int16_t waveSource;			//Channel number (zero based)
+
+		void SwapEndian();
+	};
+
+	//One entry of the TRIGTIME array
+	struct TrigTime
+	{
+		double triggerTime;			//Trigger time of the segment, relative to the first one
+		double triggerOffset;		//Time from trigger to first sample of the segment
+
+		void SwapEndian();
+	};
+	#pragma pack(pop)
+
 protected:
 	void OnFileNameChanged();
 
@@ -85,8 +85,9 @@ void TopMeasurement::Refresh()
 	size_t len = din->size();
 
 	//Make a histogram of the waveform
-	float min = GetMinVoltage(sdin, udin);
-	float max = GetMaxVoltage(sdin, udin);
+	float min;
+	float max;
+	GetMinMaxVoltage(sdin, udin, min, max);
 	size_t nbins = 64;
 	vector<size_t> hist = MakeHistogram(sdin, udin, min, max, nbins);
 
@@ -37,7 +37,6 @@ using namespace std;
 
 TrendFilter::TrendFilter(const string& color)
 	: PausableFilter(color, CAT_MATH)
-	, m_tlast(0)
 	, m_depthname("Buffer length")
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
@@ -100,53 +99,56 @@ void TrendFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, std::shared_ptr<Q
 	//See if we have output already
 	double now = GetTime();
 	auto wfm = dynamic_cast<SparseAnalogWaveform*>(GetData(0));
-	if(wfm)
-	{
-		//Remove old samples
-		size_t nmax = m_parameters[m_depthname].GetIntVal();
-		while(wfm->m_samples.size() > nmax)
-		{
-			wfm->m_samples.pop_front();
-			wfm->m_durations.pop_front();
-			wfm->m_offsets.pop_front();
-		}
-	}
-	else
+	if(!wfm)
 	{
 		wfm = new SparseAnalogWaveform;
 		SetData(wfm, 0);
 
 		wfm->m_triggerPhase = 0;
 		wfm->m_timescale = 1;
-		m_tlast = now;
 	}
 	wfm->PrepareForCpuAccess();
 	wfm->m_revision ++;
 
-	//Update timestamp
-	wfm->m_startTimestamp = floor(now);
-	wfm->m_startFemtoseconds = (now - wfm->m_startTimestamp) * FS_PER_SECOND;
-
-	//Update duration of previous sample
+	//Offsets are relative to a fixed epoch so that old samples never have to be touched when a new one is added.
+	//The start of the waveform is always the time of the newest sample, and the trigger phase is adjusted to keep
+	//it at t=0 with older samples at negative times.
 	size_t len = wfm->m_samples.size();
-	double dt = (now - m_tlast) * FS_PER_SECOND;
+	int64_t dt = 0;
+	int64_t offset = 0;
 	if(len > 0)
+	{
+		//Update duration of previous sample
+		double tlast = wfm->m_startTimestamp + wfm->m_startFemtoseconds * SECONDS_PER_FS;
+		dt = (now - tlast) * FS_PER_SECOND;
 		wfm->m_durations[len-1] = dt;
 
+		offset = wfm->m_offsets[len-1] + dt;
+	}
+
 	//Add the new sample
-	wfm->m_samples.push_back(GetInput(0).GetScalarValue());
+	wfm->m_samples.push_back(din.GetScalarValue());
+	wfm->m_offsets.push_back(offset);
 	wfm->m_durations.push_back(dt);
-	if(wfm->m_offsets.empty())
-		wfm->m_offsets.push_back(0);
-	else
-		wfm->m_offsets.push_back(dt + wfm->m_offsets[len-1]);
 
-	//Update offsets of old samples
-	len = wfm->m_samples.size();
-	for(size_t i=0; i<len; i++)
-		wfm->m_offsets[i] -= dt;
+	//Remove old samples
+	size_t nmax = max(m_parameters[m_depthname].GetIntVal(), (int64_t)1);
+	TrimHistory(wfm, nmax);
 
-	wfm->MarkModifiedFromCpu();
+	//Move the epoch up to the oldest sample once in a while so the offsets can't overflow
+	if(wfm->m_offsets[0] > MAX_EPOCH_AGE)
+	{
+		int64_t base = wfm->m_offsets[0];
+		len = wfm->m_offsets.size();
+		for(size_t i=0; i<len; i++)
+			wfm->m_offsets[i] -= base;
+		offset -= base;
+	}
+
+	//Update timestamp
+	wfm->m_startTimestamp = floor(now);
+	wfm->m_startFemtoseconds = (now - wfm->m_startTimestamp) * FS_PER_SECOND;
+	wfm->m_triggerPhase = -offset;
 
-	m_tlast = now;
+	wfm->MarkModifiedFromCpu();
 }
@@ -53,9 +53,10 @@ public:
 
 	PROTOCOL_DECODER_INITPROC(TrendFilter)
 
-protected:
-	double m_tlast;
+	///@brief Time (in fs) after which the oldest sample becomes the new epoch for sample offsets
+	static constexpr int64_t MAX_EPOCH_AGE = 3600LL * 1000000000000000LL;
 
+protected:
 	std::string m_depthname;
 };
 
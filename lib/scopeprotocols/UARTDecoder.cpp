@@ -114,72 +114,35 @@ void UARTDecoder::Refresh()
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
 	cap->m_triggerPhase = din->m_triggerPhase;
 
-	//Time-domain processing to reflect potentially variable sampling rate for RLE captures
-	int64_t next_value = 0;
-	size_t isample = 0;
+	//Find all of the bytes
+	vector<UARTByte> bytes;
+	if(sdin)
+		DecodeBytes(sdin, scaledbitper, bytes);
+	else
+		DecodeBytes(udin, scaledbitper, bytes);
+
+	size_t nbytes = bytes.size();
+	cap->Resize(nbytes);
+	for(size_t i=0; i<nbytes; i++)
+	{
+		cap->m_offsets[i] = bytes[i].m_start;
+		cap->m_durations[i] = bytes[i].m_end - bytes[i].m_start;
+		cap->m_samples[i] = bytes[i].m_data;
+	}
+
+	//Group them into packets
 	int64_t tlast = 0;
 	Packet* pack = NULL;
 	size_t len = din->size();
-	while(isample < len)
+	for(auto& b : bytes)
 	{
-		//Wait for signal to go high (idle state)
-		while( (isample < len) && !GetValue(sdin, udin, isample))
-			isample ++;
-		if(isample >= len)
-			break;
-
-		//Wait for a falling edge (start bit)
-		while( (isample < len) && GetValue(sdin, udin, isample))
-			isample ++;
-		if(isample >= len)
-			break;
-
-		//Time of the start bit
-		int64_t tstart = ::GetOffset(sdin, udin, isample);
-
-		//The next data bit should be measured 1.5 bit periods after the falling edge
-		next_value = tstart + scaledbitper + scaledbitper/2;
-
-		//Read eight data bits
-		unsigned char dval = 0;
-		for(int ibit=0; ibit<8; ibit++)
-		{
-			//Find the sample of interest
-			while( (isample < len) && ((::GetOffset(sdin, udin, isample) + GetDuration(sdin, udin, isample)) < next_value))
-				isample ++;
-			if(isample >= len)
-				break;
-
-			//Got the sample
-			dval = (dval >> 1) | (GetValue(sdin, udin, isample) ? 0x80 : 0);
-
-			//Go on to the next bit
-			next_value += scaledbitper;
-		}
-
-		//If we ran out of space before we hit the end of the buffer, abort
-		if(isample >= len)
-			break;
-
-		//All good, read the stop bit
-		while( (isample < len) && ((::GetOffset(sdin, udin, isample) + GetDuration(sdin, udin, isample)) < next_value))
-			isample ++;
-		if(isample >= len)
-			break;
-
-		//Save the sample
-		int64_t tend = next_value + (scaledbitper/2);
-		cap->m_offsets.push_back(tstart);
-		cap->m_durations.push_back(tend-tstart);
-		cap->m_samples.push_back(dval);
-
 		//If the last packet was more than 3 byte times ago, start a new one
 		if(pack != NULL)
 		{
-			int64_t delta = tstart - tlast;
+			int64_t delta = b.m_start - tlast;
 			if(delta > 30 * scaledbitper)
 			{
-				pack->m_len = (tend * din->m_timescale) - pack->m_offset;
+				pack->m_len = (b.m_end * din->m_timescale) - pack->m_offset;
 				FinishPacket(pack);
 				pack = NULL;
 			}
@@ -189,12 +152,12 @@ void UARTDecoder::Refresh()
 		if(pack == NULL)
 		{
 			pack = new Packet;
-			pack->m_offset = tstart * din->m_timescale + din->m_triggerPhase;
+			pack->m_offset = b.m_start * din->m_timescale + din->m_triggerPhase;
 		}
 
 		//Append to the existing packet
-		pack->m_data.push_back(dval);
-		tlast = tstart;
+		pack->m_data.push_back(b.m_data);
+		tlast = b.m_start;
 	}
 
 	//If we have a packet in progress, add it
@@ -205,6 +168,88 @@ void UARTDecoder::Refresh()
 	}
 
 	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+}
+
+/**
+	@brief Decodes all of the bytes in a waveform, splitting long captures into chunks decoded in parallel
+
+	@param din			Input waveform
+	@param scaledbitper	Bit period, in input timebase units
+	@param bytes		Output byte list
+ */
+template<class T>
+void UARTDecoder::DecodeBytes(T* din, int64_t scaledbitper, vector<UARTByte>& bytes)
+{
+	size_t len = din->size();
+	size_t nchunks = GetChunkCount(len);
+	vector<int64_t> boundaries;
+	for(size_t i=1; i<nchunks; i++)
+		boundaries.push_back(i * len / nchunks);
+
+	UARTByteDecoder<T> dec(din, scaledbitper);
+	ChunkedDecoder< UARTByteDecoder<T> >::Decode(dec, boundaries, bytes);
+}
+
+/**
+	@brief Decodes the next byte
+
+	Time-domain processing to reflect potentially variable sampling rate for RLE captures
+
+	@return False if we hit the end of the waveform
+ */
+template<class T>
+bool UARTByteDecoder<T>::Step(State& s, Output& out) const
+{
+	size_t isample = s.m_isample;
+	auto& samples = m_din->m_samples;
+
+	//Wait for signal to go high (idle state)
+	while( (isample < m_len) && !samples[isample])
+		isample ++;
+	if(isample >= m_len)
+		return false;
+
+	//Wait for a falling edge (start bit)
+	while( (isample < m_len) && samples[isample])
+		isample ++;
+	if(isample >= m_len)
+		return false;
+
+	//Time of the start bit
+	int64_t tstart = ::GetOffset(m_din, isample);
+
+	//The next data bit should be measured 1.5 bit periods after the falling edge
+	int64_t next_value = tstart + m_scaledbitper + m_scaledbitper/2;
+
+	//Read eight data bits
+	unsigned char dval = 0;
+	for(int ibit=0; ibit<8; ibit++)
+	{
+		//Find the sample of interest
+		while( (isample < m_len) && ((::GetOffset(m_din, isample) + ::GetDuration(m_din, isample)) < next_value))
+			isample ++;
+		if(isample >= m_len)
+			return false;
+
+		//Got the sample
+		dval = (dval >> 1) | (samples[isample] ? 0x80 : 0);
+
+		//Go on to the next bit
+		next_value += m_scaledbitper;
+	}
+
+	//All good, read the stop bit
+	while( (isample < m_len) && ((::GetOffset(m_din, isample) + ::GetDuration(m_din, isample)) < next_value))
+		isample ++;
+	if(isample >= m_len)
+		return false;
+
+	//Save the sample
+	out.push_back({tstart, next_value + (m_scaledbitper/2), dval});
+
+	s.m_isample = isample;
+	return true;
 }
 
 void UARTDecoder::FinishPacket(Packet* pack)
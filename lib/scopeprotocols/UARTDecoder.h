@@ -49,6 +49,88 @@ private:
 	const std::string& m_color;
 };
 
+/**
+	@brief A single decoded UART byte, before grouping into packets
+ */
+class UARTByte
+{
+public:
+	///@brief Timestamp of the start bit, in input timebase units
+	int64_t m_start;
+
+	///@brief Timestamp of the middle of the stop bit, in input timebase units
+	int64_t m_end;
+
+	///@brief The data byte
+	uint8_t m_data;
+};
+
+/**
+	@brief Byte level UART state machine, for use with ChunkedDecoder
+
+	Between bytes the only state is the current sample index, so every step ends at a sync point.
+ */
+template<class T>
+class UARTByteDecoder
+{
+public:
+	UARTByteDecoder(T* din, int64_t scaledbitper)
+		: m_din(din)
+		, m_len(din->size())
+		, m_scaledbitper(scaledbitper)
+	{}
+
+	/**
+		@brief Position of the decoder between bytes
+	 */
+	class State
+	{
+	public:
+		State(size_t isample = 0)
+			: m_isample(isample)
+		{}
+
+		bool operator==(const State& rhs) const
+		{ return m_isample == rhs.m_isample; }
+
+		///@brief Index of the next sample to look at
+		size_t m_isample;
+	};
+
+	typedef std::vector<UARTByte> Output;
+	typedef size_t Mark;
+
+	State Begin() const
+	{ return State(0); }
+
+	State Resync(int64_t position) const
+	{ return State(position); }
+
+	bool Step(State& s, Output& out) const;
+
+	int64_t GetPosition(const State& s) const
+	{ return s.m_isample; }
+
+	bool IsSyncPoint(const State& /*s*/) const
+	{ return true; }
+
+	Mark GetMark(const Output& out) const
+	{ return out.size(); }
+
+	void Append(Output& dst, Output& src, const Mark& from) const
+	{ dst.insert(dst.end(), src.begin() + from, src.end()); }
+
+protected:
+	///@brief The input waveform
+	T* m_din;
+
+	///@brief Number of samples in the input
+	size_t m_len;
+
+	///@brief Bit period, in input timebase units
+	int64_t m_scaledbitper;
+};
+
 class UARTDecoder : public PacketDecoder
 {
 public:
@@ -66,6 +148,9 @@ public:
 	PROTOCOL_DECODER_INITPROC(UARTDecoder)
 
 protected:
+	template<class T>
+	void DecodeBytes(T* din, int64_t scaledbitper, std::vector<UARTByte>& bytes);
+
 	void FinishPacket(Packet* pack);
 	std::string m_baudname;
 };
@@ -56,6 +56,18 @@ string VCDImportFilter::GetProtocolName()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
+/**
+	@brief Clears all parsed data from a block, but keeps its starting context
+ */
+void VCDImportFilter::Block::Clear()
+{
+	m_offsets.clear();
+	m_samples.clear();
+	m_busSamples.clear();
+	m_messages.clear();
+	m_aborted = false;
+}
+
 void VCDImportFilter::OnFileNameChanged()
 {
 	auto fname = m_parameters[m_fpname].ToString();
@@ -63,306 +75,147 @@ void VCDImportFilter::OnFileNameChanged()
 		return;
 
 	//Set waveform timestamp to file timestamp
-	time_t timestamp = 0;
-	int64_t fs = 0;
-	GetTimestampOfFile(fname, timestamp, fs);
+	ParseContext ctx;
+	GetTimestampOfFile(fname, ctx.m_timestamp, ctx.m_fs);
 
-	FILE* fp = fopen(fname.c_str(), "r");
-	if(!fp)
+	MappedFile file;
+	if(!file.Open(fname))
 	{
 		LogError("Couldn't open VCD file \"%s\"\n", fname.c_str());
 		return;
 	}
 
 	ClearStreams();
-
-	enum
+	m_symbols.clear();
+	m_widths.clear();
+
+	//Parse the header serially, since it creates all of the streams
+	const char* data = file.GetData();
+	const char* end = data + file.GetSize();
+	const char* p = data;
+	vector<Block> blocks(1);
+	blocks[0].m_start = ctx;
+	while(p < end)
 	{
-		STATE_IDLE,
-		STATE_DATE,
-		STATE_VERSION,
-		STATE_TIMESCALE,
-		STATE_VARS,
-		STATE_INITIAL,
-		STATE_DUMP,
-		STATE_DUMPALL,
-		STATE_COMMENT
-	} state = STATE_IDLE;
-
-	int64_t timescale = 1;
-
-	int64_t current_time = 0;
-
-	//Current scope prefix for signals
-	vector<string> scope;
-
-	//Map of signal IDs to signals
-	map<string, WaveformBase*> waveforms;
-	map<string, size_t> widths;
-
-	//VCD is a line based format, so process everything in lines
-	char buf[2048];
-	while(NULL != fgets(buf, sizeof(buf), fp))
-	{
-		string s = Trim(buf);
+		auto line = MappedFile::Trim(MappedFile::GetLine(p, end));
+		ParseLine(line, ctx, blocks[0], true);
+		if(line.find("$enddefinitions") != string_view::npos)
+			break;
+	}
+	blocks[0].m_end = ctx;
 
-		//Changing time is always legal, even before we get to the main variable dumping section.
-		//(Xilinx Vivado-generated VCDs include a #0 before the $dumpvars section.)
-		if(s[0] == '#')
+	//Split the value changes into blocks, each starting at a timestamp so it can be parsed independently
+	auto bounds = file.SplitLines(p - data, MappedFile::MIN_BLOCK_SIZE);
+	vector<size_t> starts;
+	starts.push_back(bounds[0]);
+	for(size_t i=1; i+1 < bounds.size(); i++)
+	{
+		const char* q = data + bounds[i];
+		const char* qend = data + bounds[i+1];
+		while(q < qend)
 		{
-			current_time = stoll(buf+1);
-			continue;
+			auto lineStart = q;
+			auto line = MappedFile::Trim(MappedFile::GetLine(q, qend));
+			if(!line.empty() && (line[0] == '#'))
+			{
+				starts.push_back(lineStart - data);
+				break;
+			}
 		}
+	}
+	starts.push_back(file.GetSize());
 
-		//Scope is a bit special since it can nest. Handle that separately.
-		else if(s.find("$scope") != string::npos)
+	//Parse all of the blocks in parallel.
+	//Blocks other than the first one assume they're in the middle of the value dump, which is almost always true.
+	size_t nblocks = starts.size() - 1;
+	blocks.resize(nblocks + 1);
+	for(size_t i=1; i<=nblocks; i++)
+	{
+		blocks[i].m_start = ctx;
+		if(i > 1)
+			blocks[i].m_start.m_state = STATE_DUMP;
+	}
+	#pragma omp parallel for
+	for(size_t i=1; i<=nblocks; i++)
+		ParseBlock(data + starts[i-1], data + starts[i], blocks[i], false);
+
+	//Re-parse any block whose guess turned out to be wrong, now that we know the state it really starts in.
+	//If new signals show up in the middle of the file, later blocks may have been parsed without them, so redo
+	//everything after that point too.
+	bool serial = false;
+	for(size_t i=1; i<=nblocks; i++)
+	{
+		auto& prev = blocks[i-1].m_end;
+		if(serial || blocks[i].m_aborted || (prev.m_state != blocks[i].m_start.m_state) )
 		{
-			//Get the actual scope
-			char name[128];
-			if(1 == sscanf(buf, "$scope module %127s", name))
-				scope.push_back(name);
-			state = STATE_VARS;
-			continue;
+			LogTrace("Block %zu needs to be parsed again\n", i);
+
+			size_t nsignals = m_widths.size();
+			blocks[i].m_start = prev;
+			ParseBlock(data + starts[i-1], data + starts[i], blocks[i], true);
+			if(m_widths.size() != nsignals)
+				serial = true;
 		}
+	}
 
-		//Main state machine
-		switch(state)
+	//Log any problems in the order they appear in the file
+	for(auto& b : blocks)
+	{
+		for(auto& m : b.m_messages)
 		{
-			case STATE_IDLE:
-				if(s == "$date")
-					state = STATE_DATE;
-				else if(s == "$version")
-					state = STATE_VERSION;
-				else if(s == "$timescale")
-					state = STATE_TIMESCALE;
-				else if(s == "$dumpvars")
-					state = STATE_INITIAL;
-				else if(s == "$dumpall")
-					state = STATE_DUMPALL;
-				else if(s.find("$comment") == 0)
-				{
-					if(s.find("$end") == string::npos)
-						state = STATE_COMMENT;
-					//else one-line comment, ignore but stay in idle state
-				}
-				else
-					LogWarning("Don't know what to do with line %s\n", s.c_str());
-				break;	//end STATE_IDLE
+			if(m.first == Severity::WARNING)
+				LogWarning("%s", m.second.c_str());
+			else
+				LogError("%s", m.second.c_str());
+		}
+	}
 
-			case STATE_DATE:
-				if(s[0] != '$')
-				{
-					tm now;
-					time_t tnow;
-					time(&tnow);
-					localtime_r(&tnow, &now);
-
-					tm stamp;
-
-					//Read the date
-					//Assume it's formatted "Fri May 21 07:16:38 2021" for now
-					char dow[16];
-					char month[16];
-					if(7 == sscanf(
-						buf,
-						"%3s %3s %d %d:%d:%d %d",
-						dow, month, &stamp.tm_mday, &stamp.tm_hour, &stamp.tm_min, &stamp.tm_sec, &stamp.tm_year))
-					{
-						string sm(month);
-						if(sm == "Jan")
-							stamp.tm_mon = 0;
-						else if(sm == "Feb")
-							stamp.tm_mon = 1;
-						else if(sm == "Mar")
-							stamp.tm_mon = 2;
-						else if(sm == "Apr")
-							stamp.tm_mon = 3;
-						else if(sm == "May")
-							stamp.tm_mon = 4;
-						else if(sm == "Jun")
-							stamp.tm_mon = 5;
-						else if(sm == "Jul")
-							stamp.tm_mon = 6;
-						else if(sm == "Aug")
-							stamp.tm_mon = 7;
-						else if(sm == "Sep")
-							stamp.tm_mon = 8;
-						else if(sm == "Oct")
-							stamp.tm_mon = 9;
-						else if(sm == "Nov")
-							stamp.tm_mon = 10;
-						else
-							stamp.tm_mon = 11;
-
-						//tm_year isn't absolute year, it's offset from 1900
-						stamp.tm_year -= 1900;
-
-						//TODO: figure out if this day/month/year was DST or not.
-						//For now, assume same as current. This is going to be off by an hour for half the year!
-						stamp.tm_isdst = now.tm_isdst;
-
-						//We can finally get the actual time_t
-						timestamp = mktime(&stamp);
-					}
-				}
-				break;	//end STATE_DATE;
+	//Nothing to do if we didn't get any channels
+	if(m_streams.empty())
+		return;
 
-			case STATE_VERSION:
-				//ignore
-				break;	//end STATE_VERSION
+	//Merge the value changes from each block into the output waveforms
+	#pragma omp parallel for
+	for(size_t i=0; i<m_streams.size(); i++)
+	{
+		size_t len = 0;
+		for(auto& b : blocks)
+		{
+			if(i < b.m_offsets.size())
+				len += b.m_offsets[i].size();
+		}
 
-			case STATE_TIMESCALE:
-				if(s[0] != '$')
-				{
-					Unit ufs(Unit::UNIT_FS);
-					timescale = ufs.ParseString(s);
-				}
-				break;	//end STATE_VERSION
+		auto wfm = dynamic_cast<SparseWaveformBase*>(GetData(i));
+		auto swfm = dynamic_cast<SparseDigitalWaveform*>(wfm);
+		auto bwfm = dynamic_cast<SparseDigitalBusWaveform*>(wfm);
+		wfm->Resize(len);
 
-			case STATE_VARS:
-				if(s.find("$upscope") != string::npos)
-				{
-					if(!scope.empty())
-						scope.pop_back();
-				}
-				else if(s.find("$enddefinitions") != string::npos)
-					state = STATE_IDLE;
+		size_t base = 0;
+		for(auto& b : blocks)
+		{
+			if(i >= b.m_offsets.size())
+				continue;
+
+			auto& offsets = b.m_offsets[i];
+			for(size_t j=0; j<offsets.size(); j++)
+			{
+				wfm->m_offsets[base + j] = offsets[j];
+				if(swfm)
+					swfm->m_samples[base + j] = b.m_samples[i][j];
 				else
-				{
-					//Format the current scope
-					string sscope;
-					for(auto level : scope)
-						sscope += level + "/";
-
-					//Parse the line
-					char vtype[16];	//"reg" or "wire", ignored
-					int width;
-					char symbol[16];
-					char name[128];
-					if(4 != sscanf(buf, " $var %15[^ ] %d %15[^ ] %127[^ ]", vtype, &width, symbol, name))
-						continue;
-
-					//If the symbol is already in use, skip it.
-					//We don't support one symbol with more than one name for now
-					if(waveforms.find(symbol) != waveforms.end())
-						continue;
-
-					//Create the stream
-					AddDigitalStream(sscope + name);
-
-					//Create the waveform
-					WaveformBase* wfm;
-					if(width == 1)
-						wfm = new SparseDigitalWaveform;
-					else
-						wfm = new SparseDigitalBusWaveform;
-					wfm->PrepareForCpuAccess();
-
-					wfm->m_timescale = timescale;
-					wfm->m_startTimestamp = timestamp;
-					wfm->m_startFemtoseconds = fs;
-					wfm->m_triggerPhase = 0;
-					waveforms[symbol] = wfm;
-					widths[symbol] = width;
-					SetData(wfm, m_streams.size() - 1);
-				}
-				break;	//end STATE_VARS
-
-			case STATE_INITIAL:
-			case STATE_DUMP:
-
-				//Parse the current line
-				if(s[0] != '$')
-				{
-					//Vector: first char is 'b', then data, space, symbol name
-					if(s[0] == 'b')
-					{
-						auto ispace = s.find(' ');
-						auto symbol = s.substr(ispace + 1);
-						auto wfm = dynamic_cast<SparseDigitalBusWaveform*>(waveforms[symbol]);
-						if(wfm)
-						{
-							//Parse the sample data (skipping the leading 'b')
-							vector<bool> sample;
-							for(size_t i = ispace-1; i > 0; i--)
-							{
-								if(s[i] == '1')
-									sample.push_back(true);
-								else
-									sample.push_back(false);
-							}
-
-							//Zero-pad the sample out to full width
-							auto width = widths[symbol];
-							while(sample.size() < width)
-								sample.push_back(false);
-
-							//Extend the previous sample, if there is one
-							auto len = wfm->size();
-							if(len)
-							{
-								auto last = len-1;
-								wfm->m_durations[last] = current_time - wfm->m_offsets[last];
-							}
-
-							//Add the new sample
-							wfm->m_offsets.push_back(current_time);
-							wfm->m_durations.push_back(1);
-							wfm->m_samples.push_back(sample);
-							wfm->MarkModifiedFromCpu();
-						}
-						else
-							LogError("Symbol \"%s\" is not a valid digital bus waveform\n", symbol.c_str());
-					}
-
-					//Scalar: first char is boolean value, rest is symbol name
-					else
-					{
-						auto symbol = s.substr(1);
-						auto wfm = dynamic_cast<SparseDigitalWaveform*>(waveforms[symbol]);
-						if(wfm)
-						{
-							//Extend the previous sample, if there is one
-							auto len = wfm->size();
-							if(len)
-							{
-								auto last = len-1;
-								wfm->m_durations[last] = current_time - wfm->m_offsets[last];
-							}
-
-							//Add the new sample
-							wfm->m_offsets.push_back(current_time);
-							wfm->m_durations.push_back(1);
-							wfm->m_samples.push_back(s[0] == '1');
-							wfm->MarkModifiedFromCpu();
-						}
-						else
-							LogError("Symbol \"%s\" is not a valid digital waveform\n", symbol.c_str());
-					}
-				}
-
-				break;	//end STATE_INITIAL / STATE_DUMP
-
-			case STATE_COMMENT:
-			case STATE_DUMPALL:
-				//nothing to do, ignore them
-				break;
+					bwfm->m_samples[base + j] = b.m_busSamples[i][j];
+			}
+			base += offsets.size();
 		}
 
-		//Reset at the end of a block
-		if(s.find("$end") != string::npos)
-		{
-			if(state == STATE_INITIAL)
-				state = STATE_DUMP;
-			else if(state != STATE_VARS)
-				state = STATE_IDLE;
-		}
-	}
-	fclose(fp);
+		//Each sample lasts until the next one, and the last one is a single tick
+		for(size_t j=0; j+1 < len; j++)
+			wfm->m_durations[j] = wfm->m_offsets[j+1] - wfm->m_offsets[j];
+		if(len)
+			wfm->m_durations[len-1] = 1;
 
-	//Nothing to do if we didn't get any channels
-	if(m_streams.empty())
-		return;
+		wfm->MarkModifiedFromCpu();
+	}
 
 	//Find the longest common prefix from all signal names
 	auto prefix = m_streams[0].m_name;
@@ -384,3 +237,281 @@ void VCDImportFilter::OnFileNameChanged()
 
 	m_outputsChangedSignal.emit();
 }
+
+/**
+	@brief Parses one block of lines from the file
+
+	@param start	First line of the block
+	@param end		End of the block
+	@param block	Block to parse into. The starting context must be set already.
+	@param serial	True if the block is being parsed in file order, and may define new signals
+ */
+void VCDImportFilter::ParseBlock(const char* start, const char* end, Block& block, bool serial)
+{
+	block.Clear();
+
+	auto ctx = block.m_start;
+	const char* p = start;
+	while(p < end)
+	{
+		if(!ParseLine(MappedFile::Trim(MappedFile::GetLine(p, end)), ctx, block, serial))
+		{
+			block.m_aborted = true;
+			return;
+		}
+	}
+	block.m_end = ctx;
+}
+
+/**
+	@brief Parses a single line of the file
+
+	@param s		The line, with whitespace trimmed
+	@param ctx		Parser context, updated as needed
+	@param block	Block to add value changes to
+	@param serial	True if the line is being parsed in file order, and may define new signals
+
+	@return False if the line starts a scope, but we're not parsing serially
+ */
+bool VCDImportFilter::ParseLine(string_view s, ParseContext& ctx, Block& block, bool serial)
+{
+	if(s.empty())
+		return true;
+
+	//Changing time is always legal, even before we get to the main variable dumping section.
+	//(Xilinx Vivado-generated VCDs include a #0 before the $dumpvars section.)
+	if(s[0] == '#')
+	{
+		MappedFile::ParseInteger(s.substr(1), ctx.m_time);
+		return true;
+	}
+
+	//Scope is a bit special since it can nest. Handle that separately.
+	else if(s.find("$scope") != string_view::npos)
+	{
+		//Signals can only be created in file order
+		if(!serial)
+			return false;
+
+		//Get the actual scope
+		char name[128];
+		if(1 == sscanf(string(s).c_str(), "$scope module %127s", name))
+			ctx.m_scope.push_back(name);
+		ctx.m_state = STATE_VARS;
+		return true;
+	}
+
+	//Main state machine
+	switch(ctx.m_state)
+	{
+		case STATE_IDLE:
+			if(s == "$date")
+				ctx.m_state = STATE_DATE;
+			else if(s == "$version")
+				ctx.m_state = STATE_VERSION;
+			else if(s == "$timescale")
+				ctx.m_state = STATE_TIMESCALE;
+			else if(s == "$dumpvars")
+				ctx.m_state = STATE_INITIAL;
+			else if(s == "$dumpall")
+				ctx.m_state = STATE_DUMPALL;
+			else if(s.find("$comment") == 0)
+			{
+				if(s.find("$end") == string_view::npos)
+					ctx.m_state = STATE_COMMENT;
+				//else one-line comment, ignore but stay in idle state
+			}
+			else
+			{
+				block.m_messages.push_back(pair<Severity, string>(
+					Severity::WARNING, string("Don't know what to do with line ") + string(s) + "\n"));
+			}
+			break;	//end STATE_IDLE
+
+		case STATE_DATE:
+			if(s[0] != '$')
+			{
+				tm now;
+				time_t tnow;
+				time(&tnow);
+				localtime_r(&tnow, &now);
+
+				tm stamp;
+
+				//Read the date
+				//Assume it's formatted "Fri May 21 07:16:38 2021" for now
+				char dow[16];
+				char month[16];
+				if(7 == sscanf(
+					string(s).c_str(),
+					"%3s %3s %d %d:%d:%d %d",
+					dow, month, &stamp.tm_mday, &stamp.tm_hour, &stamp.tm_min, &stamp.tm_sec, &stamp.tm_year))
+				{
+					string sm(month);
+					if(sm == "Jan")
+						stamp.tm_mon = 0;
+					else if(sm == "Feb")
+						stamp.tm_mon = 1;
+					else if(sm == "Mar")
+						stamp.tm_mon = 2;
+					else if(sm == "Apr")
+						stamp.tm_mon = 3;
+					else if(sm == "May")
+						stamp.tm_mon = 4;
+					else if(sm == "Jun")
+						stamp.tm_mon = 5;
+					else if(sm == "Jul")
+						stamp.tm_mon = 6;
+					else if(sm == "Aug")
+						stamp.tm_mon = 7;
+					else if(sm == "Sep")
+						stamp.tm_mon = 8;
+					else if(sm == "Oct")
+						stamp.tm_mon = 9;
+					else if(sm == "Nov")
+						stamp.tm_mon = 10;
+					else
+						stamp.tm_mon = 11;
+
+					//tm_year isn't absolute year, it's offset from 1900
+					stamp.tm_year -= 1900;
+
+					//TODO: figure out if this day/month/year was DST or not.
+					//For now, assume same as current. This is going to be off by an hour for half the year!
+					stamp.tm_isdst = now.tm_isdst;
+
+					//We can finally get the actual time_t
+					ctx.m_timestamp = mktime(&stamp);
+				}
+			}
+			break;	//end STATE_DATE;
+
+		case STATE_VERSION:
+			//ignore
+			break;	//end STATE_VERSION
+
+		case STATE_TIMESCALE:
+			if(s[0] != '$')
+			{
+				Unit ufs(Unit::UNIT_FS);
+				ctx.m_timescale = ufs.ParseString(string(s));
+			}
+			break;	//end STATE_VERSION
+
+		case STATE_VARS:
+			if(s.find("$upscope") != string_view::npos)
+			{
+				if(!ctx.m_scope.empty())
+					ctx.m_scope.pop_back();
+			}
+			else if(s.find("$enddefinitions") != string_view::npos)
+				ctx.m_state = STATE_IDLE;
+			else
+			{
+				//Format the current scope
+				string sscope;
+				for(auto level : ctx.m_scope)
+					sscope += level + "/";
+
+				//Parse the line
+				char vtype[16];	//"reg" or "wire", ignored
+				int width;
+				char symbol[16];
+				char name[128];
+				if(4 != sscanf(string(s).c_str(), " $var %15[^ ] %d %15[^ ] %127[^ ]", vtype, &width, symbol, name))
+					return true;
+
+				//If the symbol is already in use, skip it.
+				//We don't support one symbol with more than one name for now
+				if(m_symbols.find(symbol) != m_symbols.end())
+					return true;
+
+				//Create the stream
+				AddDigitalStream(sscope + name);
+
+				//Create the waveform
+				WaveformBase* wfm;
+				if(width == 1)
+					wfm = new SparseDigitalWaveform;
+				else
+					wfm = new SparseDigitalBusWaveform;
+				wfm->PrepareForCpuAccess();
+
+				wfm->m_timescale = ctx.m_timescale;
+				wfm->m_startTimestamp = ctx.m_timestamp;
+				wfm->m_startFemtoseconds = ctx.m_fs;
+				wfm->m_triggerPhase = 0;
+				m_symbols[symbol] = m_streams.size() - 1;
+				m_widths.push_back(width);
+				SetData(wfm, m_streams.size() - 1);
+			}
+			break;	//end STATE_VARS
+
+		case STATE_INITIAL:
+		case STATE_DUMP:
+
+			//Parse the current line
+			if(s[0] != '$')
+			{
+				//Vector: first char is 'b', then data, space, symbol name.
+				//Scalar: first char is boolean value, rest is symbol name
+				bool bus = (s[0] == 'b');
+				auto ispace = s.find(' ');
+				string symbol;
+				if(!bus)
+					symbol = s.substr(1);
+				else if(ispace != string_view::npos)
+					symbol = s.substr(ispace + 1);
+
+				auto it = m_symbols.find(symbol);
+				if( (it == m_symbols.end()) || ( (m_widths[it->second] != 1) != bus) )
+				{
+					block.m_messages.push_back(pair<Severity, string>(
+						Severity::ERROR,
+						string("Symbol \"") + symbol + "\" is not a valid digital " + (bus ? "bus " : "") + "waveform\n"));
+					break;
+				}
+
+				auto i = it->second;
+				if(block.m_offsets.size() <= i)
+				{
+					block.m_offsets.resize(m_widths.size());
+					block.m_samples.resize(m_widths.size());
+					block.m_busSamples.resize(m_widths.size());
+				}
+
+				block.m_offsets[i].push_back(ctx.m_time);
+				if(bus)
+				{
+					//Parse the sample data (skipping the leading 'b')
+					vector<bool> sample;
+					for(size_t j = ispace-1; j > 0; j--)
+						sample.push_back(s[j] == '1');
+
+					//Zero-pad the sample out to full width
+					sample.resize(max(sample.size(), m_widths[i]), false);
+					block.m_busSamples[i].push_back(sample);
+				}
+				else
+					block.m_samples[i].push_back(s[0] == '1');
+			}
+
+			break;	//end STATE_INITIAL / STATE_DUMP
+
+		case STATE_COMMENT:
+		case STATE_DUMPALL:
+			//nothing to do, ignore them
+			break;
+	}
+
+	//Reset at the end of a block
+	if(s.find("$end") != string_view::npos)
+	{
+		if(ctx.m_state == STATE_INITIAL)
+			ctx.m_state = STATE_DUMP;
+		else if(ctx.m_state != STATE_VARS)
+			ctx.m_state = STATE_IDLE;
+	}
+
+	return true;
+}
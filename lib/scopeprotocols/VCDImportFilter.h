@@ -46,6 +46,96 @@ public:
 
 protected:
 	void OnFileNameChanged();
+
+	///@brief States of the VCD line parser
+	enum ParseState
+	{
+		STATE_IDLE,
+		STATE_DATE,
+		STATE_VERSION,
+		STATE_TIMESCALE,
+		STATE_VARS,
+		STATE_INITIAL,
+		STATE_DUMP,
+		STATE_DUMPALL,
+		STATE_COMMENT
+	};
+
+	/**
+		@brief Everything the line parser needs to know about the lines before the current one
+	 */
+	class ParseContext
+	{
+	public:
+		ParseContext()
+			: m_state(STATE_IDLE)
+			, m_timescale(1)
+			, m_time(0)
+			, m_timestamp(0)
+			, m_fs(0)
+		{}
+
+		///@brief Current parser state
+		ParseState m_state;
+
+		///@brief Timescale of the file, in fs per tick
+		int64_t m_timescale;
+
+		///@brief Current timestamp, in ticks
+		int64_t m_time;
+
+		///@brief Start time of the waveform
+		time_t m_timestamp;
+
+		///@brief Fractional start time of the waveform
+		int64_t m_fs;
+
+		///@brief Current scope prefix for signals
+		std::vector<std::string> m_scope;
+	};
+
+	/**
+		@brief Value changes parsed from one block of the file, before they're merged into the output waveforms
+	 */
+	class Block
+	{
+	public:
+		Block()
+			: m_aborted(false)
+		{}
+
+		void Clear();
+
+		///@brief Parser context at the start of the block
+		ParseContext m_start;
+
+		///@brief Parser context at the end of the block
+		ParseContext m_end;
+
+		///@brief Offsets of the value changes for each signal
+		std::vector< std::vector<int64_t> > m_offsets;
+
+		///@brief Values of each scalar signal
+		std::vector< std::vector<bool> > m_samples;
+
+		///@brief Values of each bus signal
+		std::vector< std::vector< std::vector<bool> > > m_busSamples;
+
+		///@brief Messages to be logged once the block is merged, so they come out in file order
+		std::vector< std::pair<Severity, std::string> > m_messages;
+
+		///@brief True if the block contains variable definitions, and can't be parsed speculatively
+		bool m_aborted;
+	};
+
+	void ParseBlock(const char* start, const char* end, Block& block, bool serial);
+	bool ParseLine(std::string_view s, ParseContext& ctx, Block& block, bool serial);
+
+	///@brief Map of signal IDs to stream indexes
+	std::map<std::string, size_t> m_symbols;
+
+	///@brief Width of each signal, by stream index
+	std::vector<size_t> m_widths;
 };
 
 #endif
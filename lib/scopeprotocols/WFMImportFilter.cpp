@@ -54,636 +54,425 @@ string WFMImportFilter::GetProtocolName()
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Actual decoder logic
+// Byte order conversion
+
+static_assert(sizeof(WFMImportFilter::StaticFileInfo) == 78, "Wrong size for StaticFileInfo");
+static_assert(sizeof(WFMImportFilter::WaveformHeader) == 90, "Wrong size for WaveformHeader");
+static_assert(sizeof(WFMImportFilter::ExplicitDimension) == 160, "Wrong size for ExplicitDimension");
+static_assert(sizeof(WFMImportFilter::ImplicitDimension) == 136, "Wrong size for ImplicitDimension");
+static_assert(sizeof(WFMImportFilter::TimeBaseInfo) == 12, "Wrong size for TimeBaseInfo");
+static_assert(sizeof(WFMImportFilter::UpdateSpec) == 24, "Wrong size for UpdateSpec");
+static_assert(sizeof(WFMImportFilter::CurveInfo) == 30, "Wrong size for CurveInfo");
+static_assert(sizeof(WFMImportFilter::FileHeader) == 838, "Wrong size for FileHeader");
+
+void WFMImportFilter::StaticFileInfo::SwapEndian()
+{
+	byteOrder = MappedFile::ByteSwap(byteOrder);
+	bytesToEnd = MappedFile::ByteSwap(bytesToEnd);
+	curveOffset = MappedFile::ByteSwap(curveOffset);
+	hzoomScale = MappedFile::ByteSwap(hzoomScale);
+	hzoomPosition = MappedFile::ByteSwap(hzoomPosition);
+	vzoomScale = MappedFile::ByteSwap(vzoomScale);
+	vzoomPosition = MappedFile::ByteSwap(vzoomPosition);
+	numFrames = MappedFile::ByteSwap(numFrames);
+	headerSize = MappedFile::ByteSwap(headerSize);
+}
 
-void WFMImportFilter::OnFileNameChanged()
+void WFMImportFilter::WaveformHeader::SwapEndian()
 {
-	auto fname = m_parameters[m_fpname].ToString();
-	if(fname.empty())
-		return;
+	setType = MappedFile::ByteSwap(setType);
+	wfmCount = MappedFile::ByteSwap(wfmCount);
+	acqCounter = MappedFile::ByteSwap(acqCounter);
+	transactionCounter = MappedFile::ByteSwap(transactionCounter);
+	slotID = MappedFile::ByteSwap(slotID);
+	isStatic = MappedFile::ByteSwap(isStatic);
+	updateSpecCount = MappedFile::ByteSwap(updateSpecCount);
+	impDimCount = MappedFile::ByteSwap(impDimCount);
+	expDimCount = MappedFile::ByteSwap(expDimCount);
+	dataType = MappedFile::ByteSwap(dataType);
+	genCounter = MappedFile::ByteSwap(genCounter);
+	accumCount = MappedFile::ByteSwap(accumCount);
+	targetAccumCount = MappedFile::ByteSwap(targetAccumCount);
+	curveCount = MappedFile::ByteSwap(curveCount);
+	requestedFrames = MappedFile::ByteSwap(requestedFrames);
+	acquiredFrames = MappedFile::ByteSwap(acquiredFrames);
+	summaryFrame = MappedFile::ByteSwap(summaryFrame);
+	pixmapFormat = MappedFile::ByteSwap(pixmapFormat);
+	pixmapMax = MappedFile::ByteSwap(pixmapMax);
+}
 
-	LogDebug("Reading WFM file %s\n", fname.c_str());
-	LogIndenter li;
+void WFMImportFilter::ExplicitDimension::SwapEndian()
+{
+	scale = MappedFile::ByteSwap(scale);
+	offset = MappedFile::ByteSwap(offset);
+	size = MappedFile::ByteSwap(size);
+	extentMin = MappedFile::ByteSwap(extentMin);
+	extentMax = MappedFile::ByteSwap(extentMax);
+	resolution = MappedFile::ByteSwap(resolution);
+	refPoint = MappedFile::ByteSwap(refPoint);
+	format = MappedFile::ByteSwap(format);
+	storageType = MappedFile::ByteSwap(storageType);
+	nanValue = MappedFile::ByteSwap(nanValue);
+	overRange = MappedFile::ByteSwap(overRange);
+	underRange = MappedFile::ByteSwap(underRange);
+	highRange = MappedFile::ByteSwap(highRange);
+	lowRange = MappedFile::ByteSwap(lowRange);
+	userScale = MappedFile::ByteSwap(userScale);
+	userOffset = MappedFile::ByteSwap(userOffset);
+	pointDensity = MappedFile::ByteSwap(pointDensity);
+	href = MappedFile::ByteSwap(href);
+	trigDelay = MappedFile::ByteSwap(trigDelay);
+}
 
-	//Set waveform timestamp to file timestamp
-	time_t timestamp = 0;
-	int64_t fs = 0;
-	GetTimestampOfFile(fname, timestamp, fs);
+void WFMImportFilter::ImplicitDimension::SwapEndian()
+{
+	scale = MappedFile::ByteSwap(scale);
+	offset = MappedFile::ByteSwap(offset);
+	size = MappedFile::ByteSwap(size);
+	extentMin = MappedFile::ByteSwap(extentMin);
+	extentMax = MappedFile::ByteSwap(extentMax);
+	resolution = MappedFile::ByteSwap(resolution);
+	refPoint = MappedFile::ByteSwap(refPoint);
+	spacing = MappedFile::ByteSwap(spacing);
+	userScale = MappedFile::ByteSwap(userScale);
+	userOffset = MappedFile::ByteSwap(userOffset);
+	pointDensity = MappedFile::ByteSwap(pointDensity);
+	href = MappedFile::ByteSwap(href);
+	trigDelay = MappedFile::ByteSwap(trigDelay);
+}
 
-	FILE* fp = fopen(fname.c_str(), "rb");
-	if(!fp)
-	{
-		LogError("Couldn't open WFM file \"%s\"\n", fname.c_str());
-		return;
-	}
+void WFMImportFilter::TimeBaseInfo::SwapEndian()
+{
+	realPointSpacing = MappedFile::ByteSwap(realPointSpacing);
+	sweep = MappedFile::ByteSwap(sweep);
+	baseType = MappedFile::ByteSwap(baseType);
+}
 
-	//Byte order check (expect 0x0f0f)
-	uint16_t byteswap;
-	if(1 != fread(&byteswap, sizeof(byteswap), 1, fp))
-	{
-		LogError("Fail to read byte order mark\n");
-		fclose(fp);
-		return;
-	}
-	if(byteswap == 0xf0f0)
-	{
-		LogError("Byteswapped files not supported\n");
-		fclose(fp);
-		return;
-	}
-	if(byteswap != 0x0f0f)
-	{
-		LogError("Invalid magic number\n");
-		fclose(fp);
-		return;
-	}
+void WFMImportFilter::UpdateSpec::SwapEndian()
+{
+	realPointOffset = MappedFile::ByteSwap(realPointOffset);
+	triggerPhase = MappedFile::ByteSwap(triggerPhase);
+	fracSec = MappedFile::ByteSwap(fracSec);
+	gmtSec = MappedFile::ByteSwap(gmtSec);
+}
+
+void WFMImportFilter::CurveInfo::SwapEndian()
+{
+	stateFlags = MappedFile::ByteSwap(stateFlags);
+	checksumType = MappedFile::ByteSwap(checksumType);
+	checksum = MappedFile::ByteSwap(checksum);
+	prechargeStart = MappedFile::ByteSwap(prechargeStart);
+	dataStart = MappedFile::ByteSwap(dataStart);
+	postchargeStart = MappedFile::ByteSwap(postchargeStart);
+	postchargeStop = MappedFile::ByteSwap(postchargeStop);
+	endOfCurve = MappedFile::ByteSwap(endOfCurve);
+}
 
+void WFMImportFilter::FileHeader::SwapEndian()
+{
+	info.SwapEndian();
+	header.SwapEndian();
+	for(auto& d : explicitDims)
+		d.SwapEndian();
+	for(auto& d : implicitDims)
+		d.SwapEndian();
+	for(auto& t : timeBases)
+		t.SwapEndian();
+	updateSpec.SwapEndian();
+	curve.SwapEndian();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+/**
+	@brief Checks that the file header describes something we know how to import
+
+	@param fh	The header, in our byte order
+
+	@return True if the header is valid
+ */
+bool WFMImportFilter::ValidateHeader(FileHeader& fh)
+{
 	//Version number (expect ":WFM#003" file format version for now)
-	char version[9] = {0};
-	if(8 != fread(version, 1, 8, fp))
+	string version(fh.info.version, sizeof(fh.info.version));
+	LogDebug("Waveform version:     \"%s\"\n", version.c_str());
+	if(version != ":WFM#003")
 	{
-		LogError("Fail to read version number\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Waveform version:     \"%s\"\n", version);
-	if(strcmp(version, ":WFM#003") != 0)
-	{
-		LogError("Don't know what to do with file format \"%s\", expected version 3\n", version);
-		fclose(fp);
-		return;
+		LogError("Don't know what to do with file format \"%s\", expected version 3\n", version.c_str());
+		return false;
 	}
 
 	//Number of digits in ascii byte counts? not entirely sure what this is for
-	uint8_t ndigits;
-	if(1 != fread(&ndigits, 1, 1, fp))
-	{
-		LogError("Fail to read digit count\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Digit count:          %d\n", ndigits);
-
-	//Get file size (from this point)
-	uint32_t filesize;
-	if(1 != fread(&filesize, sizeof(filesize), 1, fp))
-	{
-		LogError("Fail to read file size\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("File size:            %d bytes\n", filesize);
+	LogDebug("Digit count:          %d\n", fh.info.digits);
+	LogDebug("File size:            %d bytes\n", fh.info.bytesToEnd);
 
-	uint8_t bytesperpoint;
-	if(1 != fread(&bytesperpoint, 1, 1, fp))
-	{
-		LogError("Fail to read bytes per point\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Bytes per point:      %d\n", bytesperpoint);
-	if( (bytesperpoint != 1) && (bytesperpoint != 2) )
+	LogDebug("Bytes per point:      %d\n", fh.info.bytesPerPoint);
+	if( (fh.info.bytesPerPoint != 1) && (fh.info.bytesPerPoint != 2) )
 	{
 		LogError("Only 1 or 2 bytes per point supported for now\n");
-		fclose(fp);
-		return;
+		return false;
 	}
 
 	//Offset to start of curve buffer (from start of file)
-	uint32_t curveoffset;
-	if(1 != fread(&curveoffset, sizeof(curveoffset), 1, fp))
-	{
-		LogError("Fail to read curve offset\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Curve data offset:    %d bytes\n", curveoffset);
-
-	//Skip some fields we don't care about, not interesting
-	//int32			Horizontal zoom scale
-	//float32		Horizontal zoom position
-	//float64		Vertical zoom scale
-	//float32		Vertical zoom position
-	fseek(fp, 20, SEEK_CUR);
+	LogDebug("Curve data offset:    %u bytes\n", fh.info.curveOffset);
 
 	//Waveform label (may be blank)
-	char wfmLabel[33] = {0};
-	if(32 != fread(wfmLabel, 1, 32, fp))
-	{
-		LogError("Fail to read waveform label\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Waveform label:       %s\n", wfmLabel);
-
-	//Number of curve objects
-	int32_t numFrames;
-	if(1 != fread(&numFrames, sizeof(numFrames), 1, fp))
-	{
-		LogError("Fail to read num frames\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Curve objects:        %d\n", numFrames);
-
-	//Size of waveform header
-	int16_t wfmHeaderSize;
-	if(1 != fread(&wfmHeaderSize, sizeof(wfmHeaderSize), 1, fp))
-	{
-		LogError("Fail to read waveform header size\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Waveform header size: %d\n", wfmHeaderSize);
+	string label(fh.info.label, strnlen(fh.info.label, sizeof(fh.info.label)));
+	LogDebug("Waveform label:       %s\n", label.c_str());
+	LogDebug("Extra frames:         %u\n", fh.info.numFrames);
+	LogDebug("Waveform header size: %d\n", fh.info.headerSize);
 
 	//Waveform dataset type
-	int32_t datasetType;
-	if(1 != fread(&datasetType, sizeof(datasetType), 1, fp))
-	{
-		LogError("Fail to read waveform header size\n");
-		fclose(fp);
-		return;
-	}
-	if(datasetType == 1)
-	{
+	if(fh.header.setType == 1)
 		LogDebug("Dataset type:         FastFrame\n");
-		LogError("FastFrame dataset type not supported\n");
-		fclose(fp);
-		return;
-	}
-	else if(datasetType == 0)
+	else if(fh.header.setType == 0)
 		LogDebug("Dataset type:         Normal\n");
 	else
 	{
-		LogError("Unrecognized dataset type %d\n", datasetType);
-		fclose(fp);
-		return;
+		LogError("Unrecognized dataset type %d\n", fh.header.setType);
+		return false;
 	}
 
-	//Number of waveforms in the dataset
-	int32_t wfmCnt;
-	if(1 != fread(&wfmCnt, sizeof(wfmCnt), 1, fp))
-	{
-		LogError("Fail to read waveform count\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Waveform count:       %d\n", wfmCnt);
-
-	//Skip some fields we don't care about
-	//int64		acquisitionCount
-	//int64		transactionCount
-	//int32		SlotID
-	//int32		StaticFlag
-	fseek(fp, 24, SEEK_CUR);
-
-	//Update spec count
-	int32_t updateSpecCount;
-	if(1 != fread(&updateSpecCount, sizeof(updateSpecCount), 1, fp))
-	{
-		LogError("Fail to read update spec count\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Update spec count:    %d\n", updateSpecCount);
+	LogDebug("Waveform count:       %d\n", fh.header.wfmCount);
+	LogDebug("Update spec count:    %d\n", fh.header.updateSpecCount);
 
-	//Implicit dimension count
-	int32_t implicitDimensionCount;
-	if(1 != fread(&implicitDimensionCount, sizeof(implicitDimensionCount), 1, fp))
-	{
-		LogError("Fail to read implicit dimension count\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Implicit dim count:   %d\n", implicitDimensionCount);
-	if(implicitDimensionCount != 1)
+	LogDebug("Implicit dim count:   %d\n", fh.header.impDimCount);
+	if(fh.header.impDimCount != 1)
 	{
 		LogError("Expected 1 implicit dimension (for waveform dataset\n");
-		fclose(fp);
-		return;
+		return false;
 	}
 
-	//Explicit dimension count
-	int32_t explicitDimensionCount;
-	if(1 != fread(&explicitDimensionCount, sizeof(explicitDimensionCount), 1, fp))
-	{
-		LogError("Fail to read explicit dimension count\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Explicit dim count:   %d\n", explicitDimensionCount);
-	if(explicitDimensionCount != 1)
+	LogDebug("Explicit dim count:   %d\n", fh.header.expDimCount);
+	if(fh.header.expDimCount != 1)
 	{
 		LogError("Expected 1 explicit dimension (for waveform dataset\n");
-		fclose(fp);
-		return;
+		return false;
 	}
 
 	//Waveform data type
-	int32_t dataType;
-	if(1 != fread(&dataType, sizeof(dataType), 1, fp))
-	{
-		LogError("Fail to read data type\n");
-		fclose(fp);
-		return;
-	}
-	if(dataType == 2)
+	if(fh.header.dataType == 2)
 		LogDebug("Data type:            vector\n");
 	else
 	{
-		LogError("Unknown waveform data type %d\n", dataType);
-		fclose(fp);
-		return;
+		LogError("Unknown waveform data type %d\n", fh.header.dataType);
+		return false;
 	}
 
-	//Skip fields we don't care about
-	//int64		counter
-	//int32		accumcount
-	//int32		targetcount
-	fseek(fp, 16, SEEK_CUR);
-
-	//Number of curve objects
-	int32_t curveCount;
-	if(1 != fread(&curveCount, sizeof(curveCount), 1, fp))
+	if(fh.header.curveCount != 1)
 	{
-		LogError("Fail to read curve count\n");
-		fclose(fp);
-		return;
+		LogError("Invalid curve count %d\n", fh.header.curveCount);
+		return false;
 	}
-	if(curveCount != 1)
-	{
-		LogError("Invalid curve count %d\n", curveCount);
-		fclose(fp);
-		return;
-	}
-
-	//Skip fields we don't care about
-	//int32		requestedFastFrames
-	//int32		acquiredFastFrames
-	//int16		summary
-	//int32		pixmapFormat
-	//int64		pixmapMax
-	fseek(fp, 22, SEEK_CUR);
 
 	//Explicit dimensions
 	//(assume only one is present for now)
-	double yscale;
-	if(1 != fread(&yscale, sizeof(yscale), 1, fp))
-	{
-		LogError("Fail to read Y axis scale\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Y axis scale:         %f\n", yscale);
-	double yoff;
-	if(1 != fread(&yoff, sizeof(yscale), 1, fp))
-	{
-		LogError("Fail to read Y axis scale\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Y axis offset:        %f\n", yoff);
-	int32_t yDataRange;
-	if(1 != fread(&yDataRange, sizeof(yDataRange), 1, fp))
-	{
-		LogError("Fail to read Y axis range\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Y axis range:         %d\n", yDataRange);
-	char yunits[21] = {0};
-	if(20 != fread(yunits, 1, 20, fp))
-	{
-		LogError("Fail to read Y axis units\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Y axis units:         %s\n", yunits);
-
-	//Skip fields we don't care about
-	//float64	minPossibleValue
-	//float64	maxPossibleValue
-	//float64	resolution
-	//float64	refPoint
-	fseek(fp, 32, SEEK_CUR);
-
-	//Format
-	int32_t format;
-	if(1 != fread(&format, sizeof(format), 1, fp))
-	{
-		LogError("Fail to read data format\n");
-		fclose(fp);
-		return;
-	}
-	if(format == 0)
+	auto& ydim = fh.explicitDims[0];
+	LogDebug("Y axis scale:         %f\n", ydim.scale);
+	LogDebug("Y axis offset:        %f\n", ydim.offset);
+	LogDebug("Y axis range:         %u\n", ydim.size);
+
+	if(ydim.format == 0)
 	{
 		LogDebug("Data format:          int16_t\n");
-		if(bytesperpoint != 2)
+		if(fh.info.bytesPerPoint != 2)
 		{
 			LogError("data format int16_t is only valid with 2 bytes per point\n");
-			fclose(fp);
-			return;
+			return false;
 		}
 	}
-	else if(format == 7)
+	else if(ydim.format == 7)
 	{
 		LogDebug("Data format:          int8_t (undocumented, guessed)\n");
 
-		if(bytesperpoint != 1)
+		if(fh.info.bytesPerPoint != 1)
 		{
 			LogError("data format int8_t is only valid with 1 byte per point\n");
-			fclose(fp);
-			return;
+			return false;
 		}
 	}
 	else
 	{
-		LogError("Data format:          %d (unimplemented)\n", format);
-		fclose(fp);
-		return;
+		LogError("Data format:          %d (unimplemented)\n", ydim.format);
+		return false;
 	}
 
 	//Data layout
-	int32_t layout;
-	if(1 != fread(&layout, sizeof(layout), 1, fp))
-	{
-		LogError("Fail to read data layout\n");
-		fclose(fp);
-		return;
-	}
-	if(layout == 0)
+	if(ydim.storageType == 0)
 		LogDebug("Data layout:          sample\n");
 	else
 	{
-		LogError("Data layout:          %d (unimplemented)\n", layout);
-		fclose(fp);
-		return;
+		LogError("Data layout:          %d (unimplemented)\n", ydim.storageType);
+		return false;
 	}
 
-	//Skip fields we don't care about
-	//int32		nanval
-	//int32		overrange
-	//int32		underange
-	//int32		highrange
-	//int32		lowrange
-	//float64	viewscale
-	//char[20]	viewscaleUnits
-	//float64	userOffset
-	//float64	pointDensity
-	//float64	triggerPositionPercent
-	//float64	triggerDelay
-	fseek(fp, 80, SEEK_CUR);
-
-	//Skip over the second explicit dimension
-	//(space is reserved in the file format even if the dimension is not present)
-	fseek(fp, 160, SEEK_CUR);
-
 	//Implicit dimensions
 	//(assume only one is present for now)
-	double xscale;
-	if(1 != fread(&xscale, sizeof(xscale), 1, fp))
-	{
-		LogError("Fail to read X axis scale\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("X axis scale:         %e\n", xscale);
-	double xoff;
-	if(1 != fread(&xoff, sizeof(xscale), 1, fp))
-	{
-		LogError("Fail to read X axis scale\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("X axis offset:        %f\n", xoff);
-	int32_t numPoints;
-	if(1 != fread(&numPoints, sizeof(numPoints), 1, fp))
-	{
-		LogError("Fail to read record length\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Record length:        %d points\n", numPoints);
-	char xunits[21] = {0};
-	if(20 != fread(xunits, 1, 20, fp))
-	{
-		LogError("Fail to read X axis units\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("X axis units:         %s\n", xunits);
-
-	//Skip fields we don't care about
-	//float64	extent min
-	//float64	extent max
-	//float64	resolution
-	//float64	refpoint
-	fseek(fp, 32, SEEK_CUR);
-
-	int32_t spacing;
-	if(1 != fread(&spacing, sizeof(spacing), 1, fp))
-	{
-		LogError("Fail to read sample spacing\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("X axis spacing:       %d\n", spacing);
+	auto& xdim = fh.implicitDims[0];
+	LogDebug("X axis scale:         %e\n", xdim.scale);
+	LogDebug("X axis offset:        %f\n", xdim.offset);
+	LogDebug("Record length:        %u points\n", xdim.size);
+	LogDebug("X axis spacing:       %d\n", xdim.spacing);
 
-	//Skip fields we don't care about
-	//float64	user scale
-	//char[20]	user units
-	//float64	user offset
-	//float64	point density
-	//float64	href
-	//float64	trigdelay
-	fseek(fp, 60, SEEK_CUR);
+	//Timebase information
+	LogDebug("Real point spacing:   %u\n", fh.timeBases[0].realPointSpacing);
+	LogDebug("Acq type:             %d\n", fh.timeBases[0].sweep);
+	LogDebug("Timebase type:        %d\n", fh.timeBases[0].baseType);
 
-	//Skip over the second implicit dimension
-	//(space is reserved in the file format even if the dimension is not present)
-	fseek(fp, 136, SEEK_CUR);
+	//Waveform update spec
+	LogDebug("Real point offset:    %u\n", fh.updateSpec.realPointOffset);
+	LogDebug("Trigger phase:        %f\n", fh.updateSpec.triggerPhase);
 
-	//Timebase information
-	int32_t realSpacing;
-	if(1 != fread(&realSpacing, sizeof(realSpacing), 1, fp))
+	//Waveform curve information
+	LogDebug("Precharge start:      %u\n", fh.curve.prechargeStart);
+	LogDebug("Data start:           %u\n", fh.curve.dataStart);
+	LogDebug("Postcharge start:     %u\n", fh.curve.postchargeStart);
+	LogDebug("Postcharge stop:      %u\n", fh.curve.postchargeStop);
+	if(fh.curve.postchargeStop < fh.curve.prechargeStart)
 	{
-		LogError("Fail to read real spacing\n");
-		fclose(fp);
-		return;
+		LogError("Invalid curve data range\n");
+		return false;
 	}
-	LogDebug("Real point spacing:   %d\n", realSpacing);
 
-	int32_t acqType;
-	if(1 != fread(&acqType, sizeof(acqType), 1, fp))
-	{
-		LogError("Fail to read acquisition type\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Acq type:             %d\n", acqType);
+	return true;
+}
 
-	int32_t baseType;
-	if(1 != fread(&baseType, sizeof(baseType), 1, fp))
-	{
-		LogError("Fail to read timebase type\n");
-		fclose(fp);
+void WFMImportFilter::OnFileNameChanged()
+{
+	auto fname = m_parameters[m_fpname].ToString();
+	if(fname.empty())
 		return;
-	}
-	LogDebug("Timebase type:        %d\n", baseType);
 
-	//Skip second timebase type
-	fseek(fp, 12, SEEK_CUR);
+	LogDebug("Reading WFM file %s\n", fname.c_str());
+	LogIndenter li;
 
-	//Waveform update spec
-	//TODO: there can be more than one so we need to loop
-	int32_t realPointOffset;
-	if(1 != fread(&realPointOffset, sizeof(realPointOffset), 1, fp))
+	MappedFile file;
+	if(!file.Open(fname))
 	{
-		LogError("Fail to read real point offset\n");
-		fclose(fp);
+		LogError("Couldn't open WFM file \"%s\"\n", fname.c_str());
 		return;
 	}
-	LogDebug("Real point offset:    %d\n", realPointOffset);
 
-	double triggerPhase;
-	if(1 != fread(&triggerPhase, sizeof(triggerPhase), 1, fp))
+	FileHeader fh;
+	if(!file.Read(0, fh))
 	{
-		LogError("Fail to read trigger phase\n");
-		fclose(fp);
+		LogError("Fail to read file header\n");
 		return;
 	}
-	LogDebug("Trigger phase:        %f\n", triggerPhase);
 
-	double fracSec;
-	if(1 != fread(&fracSec, sizeof(fracSec), 1, fp))
+	//Byte order check (expect 0x0f0f, or 0xf0f0 if written by a machine with the opposite byte order)
+	bool byteswap = false;
+	if(fh.info.byteOrder == 0xf0f0)
 	{
-		LogError("Fail to read fractional seconds\n");
-		fclose(fp);
-		return;
+		LogDebug("Byte order:           swapped\n");
+		byteswap = true;
+		fh.SwapEndian();
 	}
-	uint32_t gmtSec;
-	if(1 != fread(&gmtSec, sizeof(gmtSec), 1, fp))
+	else if(fh.info.byteOrder != 0x0f0f)
 	{
-		LogError("Fail to read GMT seconds\n");
-		fclose(fp);
+		LogError("Invalid magic number\n");
 		return;
 	}
 
-	//Waveform curve information
-	//Skip fields we don't care about
-	//int32 stateFlags
-	//int32 checksumType
-	//int16 curveChecksum
-	fseek(fp, 10, SEEK_CUR);
-
-	uint32_t prechargeStart;
-	if(1 != fread(&prechargeStart, sizeof(prechargeStart), 1, fp))
-	{
-		LogError("Fail to read precharge start\n");
-		fclose(fp);
+	if(!ValidateHeader(fh))
 		return;
-	}
-	LogDebug("Precharge start:      %d\n", prechargeStart);
 
-	uint32_t dataStart;
-	if(1 != fread(&dataStart, sizeof(dataStart), 1, fp))
+	//FastFrame files have an update spec (timestamp) and curve object for each additional frame after the header
+	size_t nframes = 1;
+	if(fh.header.setType == 1)
+		nframes += fh.info.numFrames;
+	size_t specStart = sizeof(FileHeader);
+	size_t curveStart = specStart + (nframes - 1) * sizeof(UpdateSpec);
+	if(!file.Contains(specStart, (nframes - 1) * (sizeof(UpdateSpec) + sizeof(CurveInfo))))
 	{
-		LogError("Fail to read data start\n");
-		fclose(fp);
+		LogError("Fail to read FastFrame headers\n");
 		return;
 	}
-	LogDebug("Data start:           %d\n", dataStart);
 
-	uint32_t postchargeStart;
-	if(1 != fread(&postchargeStart, sizeof(postchargeStart), 1, fp))
+	vector<UpdateSpec> specs(nframes);
+	vector<CurveInfo> curves(nframes);
+	specs[0] = fh.updateSpec;
+	curves[0] = fh.curve;
+	for(size_t i=1; i<nframes; i++)
 	{
-		LogError("Fail to read postcharge start\n");
-		fclose(fp);
-		return;
-	}
-	LogDebug("Postcharge start:     %d\n", postchargeStart);
+		file.Read(specStart + (i-1)*sizeof(UpdateSpec), specs[i]);
+		file.Read(curveStart + (i-1)*sizeof(CurveInfo), curves[i]);
 
-	uint32_t postchargeStop;
-	if(1 != fread(&postchargeStop, sizeof(postchargeStop), 1, fp))
-	{
-		LogError("Fail to read postcharge stop\n");
-		fclose(fp);
-		return;
+		if(byteswap)
+		{
+			specs[i].SwapEndian();
+			curves[i].SwapEndian();
+		}
 	}
-	LogDebug("Postcharge stop:      %d\n", postchargeStop);
 
-	//Skip roll mode data
-	fseek(fp, 4, SEEK_CUR);
-
-	//Calculate actual sample data size
-	size_t numBytes = (postchargeStop - prechargeStart);
-	size_t numRealSamples = numBytes / bytesperpoint;
-	LogDebug("Actual sample count:  %zu\n", numRealSamples);
-	LogDebug("Actual byte count:    %zu\n", numBytes);
+	//Frames are stored back to back in the curve buffer
+	size_t bytesperpoint = fh.info.bytesPerPoint;
+	size_t frameSize = fh.curve.endOfCurve;
+	if(frameSize == 0)
+		frameSize = fh.curve.postchargeStop;
+	LogDebug("Frame count:          %zu\n", nframes);
+	LogDebug("Frame size:           %zu bytes\n", frameSize);
 
 	//Figure out what unit to use for the stream
 	Unit yunit = Unit::UNIT_VOLTS;
-	string sunit(yunits);
+	string sunit(fh.explicitDims[0].units, strnlen(fh.explicitDims[0].units, sizeof(fh.explicitDims[0].units)));
 	if(sunit == "V")
 		yunit = Unit::UNIT_VOLTS;
 	else if(sunit == "A")
 		yunit = Unit::UNIT_AMPS;
 	else
-		LogWarning("Unrecognized Y axis unit \"%s\"\n", yunits);
+		LogWarning("Unrecognized Y axis unit \"%s\"\n", sunit.c_str());
 
-	//Create output waveform and stream
-	//TODO: handle multi channel etc
+	//Create output waveforms and streams, one per frame
 	ClearStreams();
-	AddStream(yunit, "data", Stream::STREAM_TYPE_ANALOG);
-	auto wfm = new UniformAnalogWaveform;
-	wfm->m_timescale = FS_PER_SECOND * (spacing+1) * xscale;
-	wfm->Resize(numRealSamples);
-	wfm->m_startTimestamp = gmtSec;
-	wfm->m_startFemtoseconds = fracSec * FS_PER_SECOND;
-	wfm->m_triggerPhase = triggerPhase * wfm->m_timescale;
-	wfm->PrepareForCpuAccess();
-	SetData(wfm, 0);
-
-	if(bytesperpoint == 2)
-	{
-		//Read sample data
-		int16_t* rawdata = new int16_t[numRealSamples];
-		fseek(fp, curveoffset, SEEK_SET);
-		if(numRealSamples != fread(rawdata, sizeof(int16_t), numRealSamples, fp))
+	double xscale = fh.implicitDims[0].scale;
+	int32_t spacing = fh.implicitDims[0].spacing;
+	float yscale = fh.explicitDims[0].scale;
+	float yoff = fh.explicitDims[0].offset;
+	vector<RawSampleBlock> blocks;
+	for(size_t i=0; i<nframes; i++)
+	{
+		//Calculate actual sample data size
+		auto& curve = curves[i];
+		if(curve.postchargeStop < curve.prechargeStart)
 		{
-			LogError("Fail to read waveform data\n");
-			delete[] rawdata;
-			return;
+			LogError("Invalid curve data range in frame %zu\n", i);
+			break;
 		}
-
-		//Convert (TODO vectorize)
-		for(size_t i=0; i<numRealSamples; i++)
-			wfm->m_samples[i] = (rawdata[i] * yscale) + yoff;
-
-		delete[] rawdata;
-	}
-	else //if(bytesperpoint == 1)
-	{
-		//Read sample data
-		int8_t* rawdata = new int8_t[numRealSamples];
-		fseek(fp, curveoffset, SEEK_SET);
-		if(numRealSamples != fread(rawdata, sizeof(int8_t), numRealSamples, fp))
+		size_t numBytes = (curve.postchargeStop - curve.prechargeStart);
+		size_t numRealSamples = numBytes / bytesperpoint;
+		size_t start = fh.info.curveOffset + i*frameSize + curve.prechargeStart;
+		if(!file.Contains(start, numRealSamples * bytesperpoint))
 		{
-			LogError("Fail to read waveform data\n");
-			delete[] rawdata;
-			return;
+			LogError("Fail to read waveform data for frame %zu\n", i);
+			break;
 		}
 
-		//Convert (TODO vectorize)
-		for(size_t i=0; i<numRealSamples; i++)
-			wfm->m_samples[i] = (rawdata[i] * yscale) + yoff;
+		if(nframes == 1)
+			AddStream(yunit, "data", Stream::STREAM_TYPE_ANALOG);
+		else
+			AddStream(yunit, string("data[") + to_string(i) + "]", Stream::STREAM_TYPE_ANALOG);
 
-		delete[] rawdata;
+		auto wfm = new UniformAnalogWaveform;
+		wfm->m_timescale = FS_PER_SECOND * (spacing+1) * xscale;
+		wfm->m_startTimestamp = specs[i].gmtSec;
+		wfm->m_startFemtoseconds = specs[i].fracSec * FS_PER_SECOND;
+		wfm->m_triggerPhase = specs[i].triggerPhase * wfm->m_timescale;
+		SetData(wfm, i);
+
+		//Samples are (raw * scale) + offset
+		blocks.push_back(RawSampleBlock(
+			wfm, file.GetData() + start, numRealSamples, (bytesperpoint == 2), byteswap, yscale, -yoff));
 	}
+	LogDebug("Actual sample count:  %zu\n", blocks.empty() ? 0 : blocks[0].m_count);
+
+	//Convert all frames in parallel
+	ConvertRawSamples(blocks);
 
 	//Done, set scale
-	wfm->MarkModifiedFromCpu();
-	AutoscaleVertical(0);
+	for(size_t i=0; i<blocks.size(); i++)
+		AutoscaleVertical(i);
 
-	//Clean up
-	fclose(fp);
+	m_outputsChangedSignal.emit();
 }
@@ -44,8 +44,150 @@ public:
 
 	PROTOCOL_DECODER_INITPROC(WFMImportFilter)
 
+	//Tektronix WFM#003 file structures
+	#pragma pack(push, 1)
+	struct StaticFileInfo
+	{
+		uint16_t byteOrder;			//0x0f0f if in our byte order
+		char version[8];			//":WFM#003"
+		uint8_t digits;				//Number of digits in byte count
+		int32_t bytesToEnd;			//Number of bytes to the end of the file
+		uint8_t bytesPerPoint;		//Bytes per sample
+		uint32_t curveOffset;		//Offset to start of curve buffer from start of file
+		int32_t hzoomScale;			//Horizontal zoom scale
+		float hzoomPosition;		//Horizontal zoom position
+		double vzoomScale;			//Vertical zoom scale
+		float vzoomPosition;		//Vertical zoom position
+		char label[32];				//Waveform label (may be blank)
+		uint32_t numFrames;			//Number of FastFrames minus one
+		uint16_t headerSize;		//Size of waveform header
+
+		void SwapEndian();
+	};
+
+	struct WaveformHeader
+	{
+		int32_t setType;			//0 = normal, 1 = FastFrame
+		int32_t wfmCount;			//Number of waveforms in the set
+		uint64_t acqCounter;		//Acquisition counter
+		uint64_t transactionCounter;//Transaction counter
+		int32_t slotID;				//Slot ID
+		int32_t isStatic;			//Static flag
+		int32_t updateSpecCount;	//Number of waveform update specifications
+		int32_t impDimCount;		//Number of implicit dimensions
+		int32_t expDimCount;		//Number of explicit dimensions
+		int32_t dataType;			//2 = vector
+		uint64_t genCounter;		//General purpose counter
+		int32_t accumCount;			//Accumulated waveform count
+		int32_t targetAccumCount;	//Target accumulation count
+		int32_t curveCount;			//Number of curve objects
+		int32_t requestedFrames;	//Number of requested FastFrames
+		int32_t acquiredFrames;		//Number of acquired FastFrames
+		uint16_t summaryFrame;		//Summary frame type
+		int32_t pixmapFormat;		//Pixmap display format
+		uint64_t pixmapMax;			//Pixmap max value
+
+		void SwapEndian();
+	};
+
+	struct ExplicitDimension
+	{
+		double scale;				//Scale (volts per code)
+		double offset;				//Offset (volts)
+		uint32_t size;				//Data range
+		char units[20];				//Units
+		double extentMin;			//Minimum possible value
+		double extentMax;			//Maximum possible value
+		double resolution;			//Resolution
+		double refPoint;			//Reference point
+		int32_t format;				//0 = int16_t, 7 = int8_t
+		int32_t storageType;		//0 = sample
+		int32_t nanValue;			//NaN value
+		int32_t overRange;			//Over range value
+		int32_t underRange;			//Under range value
+		int32_t highRange;			//High range value
+		int32_t lowRange;			//Low range value
+		double userScale;			//User scale
+		char userUnits[20];			//User units
+		double userOffset;			//User offset
+		double pointDensity;		//Point density
+		double href;				//Horizontal reference
+		double trigDelay;			//Trigger delay
+
+		void SwapEndian();
+	};
+
+	struct ImplicitDimension
+	{
+		double scale;				//Scale (seconds per sample)
+		double offset;				//Offset (seconds)
+		uint32_t size;				//Record length
+		char units[20];				//Units
+		double extentMin;			//Minimum extent
+		double extentMax;			//Maximum extent
+		double resolution;			//Resolution
+		double refPoint;			//Reference point
+		int32_t spacing;			//Sample spacing
+		double userScale;			//User scale
+		char userUnits[20];			//User units
+		double userOffset;			//User offset
+		double pointDensity;		//Point density
+		double href;				//Horizontal reference
+		double trigDelay;			//Trigger delay
+
+		void SwapEndian();
+	};
+
+	struct TimeBaseInfo
+	{
+		uint32_t realPointSpacing;	//Real point spacing
+		int32_t sweep;				//Acquisition type
+		int32_t baseType;			//Timebase type
+
+		void SwapEndian();
+	};
+
+	struct UpdateSpec
+	{
+		uint32_t realPointOffset;	//Real point offset
+		double triggerPhase;		//Trigger phase (fraction of a sample)
+		double fracSec;				//Fractional part of the trigger time
+		int32_t gmtSec;				//Integer part of the trigger time
+
+		void SwapEndian();
+	};
+
+	struct CurveInfo
+	{
+		uint32_t stateFlags;		//State flags
+		int32_t checksumType;		//Checksum type
+		int16_t checksum;			//Curve checksum
+		uint32_t prechargeStart;	//Offset of precharge data in the frame
+		uint32_t dataStart;			//Offset of real data in the frame
+		uint32_t postchargeStart;	//Offset of postcharge data in the frame
+		uint32_t postchargeStop;	//Offset of the end of postcharge data in the frame
+		uint32_t endOfCurve;		//Size of the frame
+
+		void SwapEndian();
+	};
+
+	struct FileHeader
+	{
+		StaticFileInfo info;
+		WaveformHeader header;
+		ExplicitDimension explicitDims[2];
+		ImplicitDimension implicitDims[2];
+		TimeBaseInfo timeBases[2];
+		UpdateSpec updateSpec;
+		CurveInfo curve;
+
+		void SwapEndian();
+	};
+	#pragma pack(pop)
+
 protected:
 	void OnFileNameChanged();
+	bool ValidateHeader(FileHeader& fh);
 };
 
 #endif
@@ -38,19 +38,28 @@ using namespace std;
 
 WaterfallWaveform::WaterfallWaveform(size_t width, size_t height)
 	: DensityFunctionWaveform(width, height)
-	, m_tempBuf("WaterfallWaveform.m_tempBuf")
+	, m_rowOffset(0)
 {
-	//Temporary buffer is GPU-only
-	m_tempBuf.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_NEVER);
-	m_tempBuf.SetGpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
-
-	m_tempBuf.resize(width*height);
 }
 
 WaterfallWaveform::~WaterfallWaveform()
 {
 }
 
+/**
+	@brief Scrolls the waterfall by one line
+
+	Everything moves down one logical row and the oldest line is discarded.
+
+	@return The physical row of the new top line, which the caller should overwrite with new data
+ */
+size_t WaterfallWaveform::AdvanceRow()
+{
+	size_t row = m_rowOffset;
+	m_rowOffset = (m_rowOffset + 1) % m_height;
+	return row;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
@@ -59,7 +68,7 @@ Waterfall::Waterfall(const string& color)
 	, m_width(1)
 	, m_height(1)
 	, m_maxwidth("Max width")
-	, m_computePipeline("shaders/WaterfallFilter.spv", 3, sizeof(WaterfallFilterArgs))
+	, m_computePipeline("shaders/WaterfallFilter.spv", 2, sizeof(WaterfallFilterArgs))
 {
 	AddStream(Unit(Unit::UNIT_DBM), "data", Stream::STREAM_TYPE_WATERFALL);
 	m_xAxisUnit = Unit(Unit::UNIT_HZ);
@@ -93,6 +102,12 @@ bool Waterfall::ValidateChannel(size_t i, StreamDescriptor stream)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Accessors
 
+Filter::DataLocation Waterfall::GetInputLocation()
+{
+	//We explicitly manage our input memory and don't care where it is when Refresh() is called
+	return LOC_DONTCARE;
+}
+
 float Waterfall::GetOffset(size_t /*stream*/)
 {
 	return 0;
@@ -161,36 +176,60 @@ void Waterfall::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle>
 	//TODO: is this OK or are we going to lose too much precision doing this?
 	args.timescaleRatio = cap->m_timescale * 1.0 / din->m_timescale;
 
-	//Make sure input is ready
-	din->PrepareForGpuAccess();
-	cap->PrepareForGpuAccess();
-	cap->m_tempBuf.PrepareForGpuAccess();
-
-	cmdBuf.begin({});
-
-	//Run the actual compute on the GPU
-	m_computePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
-	m_computePipeline.BindBufferNonblocking(1, cap->GetOutData(), cmdBuf);
-	m_computePipeline.BindBufferNonblocking(2, cap->m_tempBuf, cmdBuf, true);
-	m_computePipeline.Dispatch(cmdBuf, args, GetComputeBlockCount(args.width, 64), m_height);
-
-	//Wait for the shader to finish
-	cmdBuf.pipelineBarrier(
-		vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
-		vk::PipelineStageFlagBits::eTransfer,
-		{},
-		vk::MemoryBarrier(
-			vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
-			vk::AccessFlagBits::eTransferRead),
-		{},
-		{});
-
-	//Copy the output buffer over the input
-	vk::BufferCopy region(0, 0, cap->GetOutData().size() * sizeof(float));
-	cmdBuf.copyBuffer(cap->m_tempBuf.GetBuffer(), cap->GetOutData().GetBuffer(), {region});
-
-	cmdBuf.end();
-	queue->SubmitAndBlock(cmdBuf);
-
-	cap->GetOutData().MarkModifiedFromGpu();
+	//Scroll the ring buffer, then fill in only the new line
+	args.row = cap->AdvanceRow();
+
+	if(g_gpuFilterEnabled)
+	{
+		//Make sure input is ready
+		din->PrepareForGpuAccess();
+		cap->PrepareForGpuAccess();
+
+		cmdBuf.begin({});
+
+		m_computePipeline.BindBufferNonblocking(0, din->m_samples, cmdBuf);
+		m_computePipeline.BindBufferNonblocking(1, cap->GetOutData(), cmdBuf);
+		m_computePipeline.Dispatch(cmdBuf, args, GetComputeBlockCount(args.width, 64));
+
+		cmdBuf.end();
+		queue->SubmitAndBlock(cmdBuf);
+
+		cap->MarkModifiedFromGpu();
+	}
+
+	else
+	{
+		din->PrepareForCpuAccess();
+		cap->PrepareForCpuAccess();
+
+		FillRowGeneric(din, cap, args);
+
+		cap->MarkModifiedFromCpu();
+	}
+}
+
+/**
+	@brief Fills the newest line of the waterfall with the peak of each group of input bins
+ */
+void Waterfall::FillRowGeneric(UniformAnalogWaveform* din, WaterfallWaveform* cap, const WaterfallFilterArgs& args)
+{
+	const float vmin = 1.0 / 255.0;
+	float* in = din->m_samples.GetCpuPointer();
+	float* out = cap->GetOutData().GetCpuPointer() + args.row*args.width;
+
+	#pragma omp parallel for
+	for(size_t x=0; x<args.width; x++)
+	{
+		size_t binMin = round(x * args.timescaleRatio);
+		size_t binMax = round((x+1) * args.timescaleRatio);
+
+		float maxAmplitude = vmin;
+		for(size_t i=binMin; (i < binMax) && (i < args.inlen); i++)
+		{
+			float v = 1 - ( (in[i] - args.vfs) / -args.vrange);
+			maxAmplitude = max(maxAmplitude, v);
+		}
+
+		out[x] = maxAmplitude;
+	}
 }
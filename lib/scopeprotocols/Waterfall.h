@@ -45,8 +45,16 @@ struct WaterfallFilterArgs
 	float vrange;
 	float vfs;
 	float timescaleRatio;
+	uint32_t row;
 };
 
+/**
+	@brief Waveform object for a waterfall
+
+	Rows are stored as a ring buffer: adding a new line overwrites the oldest row in place rather than shifting the
+	whole image. Logical row 0 is the oldest line and logical row height-1 the newest (top of the display); use
+	GetPhysicalRow() to find where a logical row lives in the pixel buffer.
+ */
 class WaterfallWaveform : public DensityFunctionWaveform
 {
 public:
@@ -63,7 +71,19 @@ public:
 	virtual bool HasGpuBuffer() override
 	{ return false; }
 
-	AcceleratorBuffer<float> m_tempBuf;
+	///@brief Returns the physical row holding logical row 0 (the oldest line)
+	size_t GetRowOffset()
+	{ return m_rowOffset; }
+
+	///@brief Returns the physical row in the pixel buffer holding a logical row
+	size_t GetPhysicalRow(size_t y)
+	{ return (y + m_rowOffset) % m_height; }
+
+	size_t AdvanceRow();
+
+protected:
+	///@brief Physical row holding logical row 0
+	size_t m_rowOffset;
 };
 
 class Waterfall : public Filter
@@ -76,6 +96,7 @@ public:
 	Waterfall& operator=(const Waterfall&) =delete;
 
 	virtual void Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<QueueHandle> queue) override;
+	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
 
@@ -99,6 +120,8 @@ public:
 	PROTOCOL_DECODER_INITPROC(Waterfall)
 
 protected:
+	void FillRowGeneric(UniformAnalogWaveform* din, WaterfallWaveform* cap, const WaterfallFilterArgs& args);
+
 	double m_offsetHz;
 
 	size_t m_width;
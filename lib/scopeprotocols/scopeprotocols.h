@@ -189,6 +189,8 @@
 #include "QuadratureDecoder.h"
 #include "RISFilter.h"
 #include "RiseMeasurement.h"
+#include "SavedSessionLoader.h"
+#include "SavedWaveformLoader.h"
 #include "SawtoothGeneratorFilter.h"
 #include "ScalarPulseDelayFilter.h"
 #include "ScalarStairstepFilter.h"
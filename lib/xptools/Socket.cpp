@@ -40,6 +40,7 @@
 
 #ifndef _WIN32
 #include <netinet/tcp.h>
+#include <poll.h>
 #endif
 
 using namespace std;
@@ -365,6 +366,38 @@ void Socket::FlushRxBuffer(void)
 #endif
 }
 
+/**
+	@brief Blocks until the socket has data available to read (or has been closed by the peer), or a timeout expires
+
+	Does not consume any data.
+
+	@param microSeconds	Maximum time to wait
+
+	@return true if data is available, false on timeout or error
+ */
+bool Socket::WaitForReadable(unsigned int microSeconds)
+{
+	if(!IsValid())
+		return false;
+
+	//Round up so short timeouts don't turn into a nonblocking poll
+	int timeoutMs = (microSeconds + 999) / 1000;
+
+#ifdef _WIN32
+	WSAPOLLFD pfd;
+	pfd.fd = m_socket;
+	pfd.events = POLLRDNORM;
+	pfd.revents = 0;
+	return (WSAPoll(&pfd, 1, timeoutMs) > 0);
+#else
+	pollfd pfd;
+	pfd.fd = m_socket;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return (poll(&pfd, 1, timeoutMs) > 0);
+#endif
+}
+
 bool Socket::SetTxBuffer(int bufsize)
 {
 	if(0 != setsockopt((int)m_socket, SOL_SOCKET, SO_SNDBUF, (char*)&bufsize, sizeof(bufsize)))
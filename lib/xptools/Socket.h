@@ -90,6 +90,9 @@ public:
 	// Flush the incoming socket
 	void FlushRxBuffer(void);
 
+	//Block until data is available to read
+	bool WaitForReadable(unsigned int microSeconds);
+
 	//Send / receive rawdata
 	bool SendLooped(const unsigned char* buf, int count);
 	bool RecvLooped(unsigned char* buf, int len);
@@ -0,0 +1,320 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopebatch                                                                                                         *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of BatchSession
+ */
+#include "ngscopebatch.h"
+#include "BatchSession.h"
+#include "../scopehal/MockOscilloscope.h"
+
+#include <cinttypes>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+BatchSession::BatchSession(size_t executorThreads)
+	: m_version(0)
+	, m_executor(executorThreads)
+{
+}
+
+BatchSession::~BatchSession()
+{
+	//The waveforms belong to the caller, not us
+	DetachAllWaveforms();
+
+	//Export filters hold a reference to themselves, drop that first
+	for(auto e : m_exportFilters)
+		e->Release();
+	for(auto f : m_filters)
+		f->Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loading
+
+/**
+	@brief Loads instruments and filters from the root node of a .scopesession file
+
+	@param node		Root YAML node of the file
+	@param dataDir	Path to the _data directory associated with the session
+
+	@return True on success
+ */
+bool BatchSession::Load(const YAML::Node& node, const string& dataDir)
+{
+	if(node["version"])
+		m_version = node["version"].as<int>();
+
+	if(!LoadInstruments(node["instruments"]))
+		return false;
+	LoadFilters(node["decodes"]);
+	SavedSessionLoader::LoadInstrumentInputs(node["instruments"], m_idtable);
+	SavedSessionLoader::LoadFilterWaveforms(dataDir, m_idtable);
+
+	//The graph doesn't change between records, so build the node list once
+	for(auto f : m_filters)
+		m_nodes.emplace(f);
+	for(auto& it : m_scopes)
+	{
+		for(size_t i=0; i<it.second->GetChannelCount(); i++)
+			m_nodes.emplace(it.second->GetChannel(i));
+	}
+
+	return true;
+}
+
+/**
+	@brief Creates an offline copy of every oscilloscope in the session
+
+	Other instrument types can't provide waveforms to the filter graph, and are skipped.
+ */
+bool BatchSession::LoadInstruments(const YAML::Node& node)
+{
+	if(!node)
+	{
+		LogError("The session file is invalid because there is no \"instruments\" section.\n");
+		return false;
+	}
+
+	vector<string> drivers;
+	Oscilloscope::EnumDrivers(drivers);
+	set<string> scopeDrivers(drivers.begin(), drivers.end());
+
+	ConfigWarningList warnings;
+	for(auto it : node)
+	{
+		auto inst = it.second;
+		auto driver = inst["driver"].as<string>();
+		if(scopeDrivers.find(driver) == scopeDrivers.end())
+		{
+			LogDebug("Instrument \"%s\" is not an oscilloscope, skipping\n", inst["nick"].as<string>().c_str());
+			continue;
+		}
+
+		auto scope = make_shared<MockOscilloscope>(
+			inst["name"].as<string>(),
+			inst["vendor"].as<string>(),
+			inst["serial"].as<string>(),
+			inst["transport"].as<string>(),
+			driver,
+			inst["args"].as<string>()
+			);
+
+		auto id = inst["id"].as<uintptr_t>();
+		m_idtable.emplace(id, (Instrument*)scope.get());
+		m_scopes[id] = scope;
+
+		scope->PreLoadConfiguration(m_version, inst, m_idtable, warnings);
+	}
+
+	for(auto it : node)
+	{
+		auto inst = it.second;
+		auto jt = m_scopes.find(inst["id"].as<uintptr_t>());
+		if(jt != m_scopes.end())
+			jt->second->LoadConfiguration(m_version, inst, m_idtable);
+	}
+
+	return true;
+}
+
+/**
+	@brief Creates every filter in the session and connects their inputs
+ */
+void BatchSession::LoadFilters(const YAML::Node& node)
+{
+	vector<string> failed;
+	SavedSessionLoader::LoadFilters(
+		node,
+		m_idtable,
+		[this](Filter* filter)
+		{
+			//Nothing else holds a reference to filters in a headless session
+			filter->AddRef();
+			m_filters.push_back(filter);
+
+			auto e = dynamic_cast<ExportFilter*>(filter);
+			if(e)
+				m_exportFilters.push_back(e);
+		},
+		failed);
+
+	for(auto& proto : failed)
+		LogWarning("Unable to create filter \"%s\". Skipping...\n", proto.c_str());
+}
+
+/**
+	@brief Loads the saved waveforms of every scope in the session, merged into one record per timestamp
+
+	The records are sorted oldest first. The caller owns the waveforms and has to delete them once done with all
+	sessions using them.
+ */
+bool BatchSession::LoadWaveformData(const string& dataDir, vector<BatchRecord>& records)
+{
+	map<pair<time_t, int64_t>, BatchRecord> merged;
+	for(auto& it : m_scopes)
+	{
+		vector<SavedWaveformLoader::SavedWaveform> waveforms;
+		if(!SavedSessionLoader::ParseScopeWaveforms(
+			m_version, it.second.get(), static_cast<int>(it.first), dataDir, waveforms))
+		{
+			return false;
+		}
+		SavedWaveformLoader::LoadAll(waveforms);
+
+		for(auto& w : waveforms)
+		{
+			auto& rec = merged[pair<time_t, int64_t>(w.m_timestamp, w.m_fs)];
+			rec.m_timestamp = w.m_timestamp;
+			rec.m_fs = w.m_fs;
+			auto& streams = rec.m_streams[it.first];
+			streams.insert(streams.end(), w.m_streams.begin(), w.m_streams.end());
+		}
+	}
+
+	for(auto& it : merged)
+		records.push_back(it.second);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Processing
+
+/**
+	@brief Evaluates the filter graph for a single record
+
+	@param rec			The record to process
+	@param measurements	CSV rows (timestamp, filter, stream, value, unit) for every scalar filter output
+	@param packets		CSV rows (timestamp, filter, offset, length, headers) for every decoded packet
+ */
+void BatchSession::Process(BatchRecord& rec, vector<string>& measurements, vector<string>& packets)
+{
+	//Lend the saved waveforms to the scope channels
+	DetachAllWaveforms();
+	for(auto& it : rec.m_streams)
+	{
+		auto jt = m_scopes.find(it.first);
+		if(jt == m_scopes.end())
+			continue;
+
+		for(auto& s : it.second)
+		{
+			auto chan = jt->second->GetOscilloscopeChannel(s.m_channel);
+			if(chan)
+				chan->SetData(s.m_data, s.m_stream);
+		}
+	}
+
+	m_executor.RunBlocking(m_nodes);
+
+	//Manual mode export filters would never write anything, so export every record
+	for(auto e : m_exportFilters)
+	{
+		if(!e->IsContinuous())
+			e->PerformAction("Export");
+	}
+
+	for(auto& it : m_executor.GetRunTimes())
+	{
+		auto f = dynamic_cast<Filter*>(it.first);
+		if(f)
+			m_runTimes[f->GetDisplayName()] += it.second;
+	}
+
+	//Collect results
+	char stamp[64];
+	snprintf(stamp, sizeof(stamp), "%" PRId64 ".%015" PRId64, static_cast<int64_t>(rec.m_timestamp), rec.m_fs);
+	for(auto f : m_filters)
+	{
+		auto name = CSVEscape(f->GetDisplayName());
+
+		for(size_t i=0; i<f->GetStreamCount(); i++)
+		{
+			if(f->GetType(i) != Stream::STREAM_TYPE_ANALOG_SCALAR)
+				continue;
+
+			char value[32];
+			snprintf(value, sizeof(value), "%.9g", f->GetScalarValue(i));
+			measurements.push_back(
+				string(stamp) + "," +
+				name + "," +
+				CSVEscape(f->GetStreamName(i)) + "," +
+				value + "," +
+				CSVEscape(f->GetYAxisUnits(i).ToString()));
+		}
+
+		auto pd = dynamic_cast<PacketDecoder*>(f);
+		if(!pd)
+			continue;
+		for(auto p : pd->GetPackets())
+		{
+			string headers;
+			for(auto& h : p->m_headers)
+			{
+				if(!headers.empty())
+					headers += "; ";
+				headers += h.first + "=" + h.second;
+			}
+
+			packets.push_back(
+				string(stamp) + "," +
+				name + "," +
+				to_string(p->m_offset) + "," +
+				to_string(p->m_len) + "," +
+				CSVEscape(headers));
+		}
+	}
+
+	DetachAllWaveforms();
+}
+
+/**
+	@brief Removes waveforms from all scope channels without deleting them
+ */
+void BatchSession::DetachAllWaveforms()
+{
+	for(auto& it : m_scopes)
+	{
+		auto scope = it.second;
+		for(size_t i=0; i<scope->GetChannelCount(); i++)
+		{
+			auto chan = scope->GetOscilloscopeChannel(i);
+			if(!chan)
+				continue;
+			for(size_t j=0; j<chan->GetStreamCount(); j++)
+				chan->Detach(j);
+		}
+	}
+}
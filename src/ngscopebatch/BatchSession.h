@@ -0,0 +1,115 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopebatch                                                                                                         *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of BatchSession
+ */
+#ifndef BatchSession_h
+#define BatchSession_h
+
+/**
+	@brief One point of saved waveform history: the streams of every scope captured at the same time
+ */
+class BatchRecord
+{
+public:
+	///@brief Integer part of the capture timestamp
+	time_t m_timestamp;
+
+	///@brief Fractional part of the capture timestamp, in femtoseconds
+	int64_t m_fs;
+
+	///@brief Saved streams, indexed by the ID of their scope in the session file
+	std::map<uintptr_t, std::vector<SavedWaveformLoader::SavedStream> > m_streams;
+};
+
+/**
+	@brief A headless copy of the instruments and filter graph of a saved session
+
+	Instruments are always loaded in offline mode, and the filter graph is evaluated synchronously for one history
+	record at a time. Each BatchSession has its own copy of every filter, so several of them can process different
+	records in parallel.
+
+	Waveform data is loaded once by the caller and shared between sessions. Process() only lends it to the scope
+	channels for the duration of the call; it's never freed by the session.
+ */
+class BatchSession
+{
+public:
+	BatchSession(size_t executorThreads);
+	~BatchSession();
+
+	bool Load(const YAML::Node& node, const std::string& dataDir);
+
+	bool LoadWaveformData(const std::string& dataDir, std::vector<BatchRecord>& records);
+
+	void Process(BatchRecord& rec, std::vector<std::string>& measurements, std::vector<std::string>& packets);
+
+	///@brief Returns true if the session contains any export filters
+	bool HasExportFilters()
+	{ return !m_exportFilters.empty(); }
+
+	///@brief Returns the total run time of each filter so far, in femtoseconds
+	const std::map<std::string, int64_t>& GetRunTimes()
+	{ return m_runTimes; }
+
+protected:
+	bool LoadInstruments(const YAML::Node& node);
+	void LoadFilters(const YAML::Node& node);
+
+	void DetachAllWaveforms();
+
+	///@brief File format version of the session
+	int m_version;
+
+	///@brief Mapping of IDs in the session file to objects
+	IDTable m_idtable;
+
+	///@brief All oscilloscopes in the session (as offline mock instruments), by ID in the session file
+	std::map<uintptr_t, std::shared_ptr<Oscilloscope> > m_scopes;
+
+	///@brief All filters in the session, in the order they were loaded
+	std::vector<Filter*> m_filters;
+
+	///@brief Export filters in the session
+	std::vector<ExportFilter*> m_exportFilters;
+
+	///@brief Every node of the filter graph (filters and instrument channels)
+	std::set<FlowGraphNode*> m_nodes;
+
+	///@brief Filter graph scheduler
+	FilterGraphExecutor m_executor;
+
+	///@brief Total run time of each filter, by display name
+	std::map<std::string, int64_t> m_runTimes;
+};
+
+#endif
@@ -0,0 +1,357 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopebatch                                                                                                         *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Program entry point
+ */
+#include "ngscopebatch.h"
+#include "BatchSession.h"
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace std;
+
+static bool ProcessSessionFile(
+	const string& path,
+	size_t jobs,
+	size_t executorThreads,
+	FILE* measurements,
+	FILE* packets,
+	map<string, int64_t>& runTimes);
+
+/**
+	@brief Quotes a string for use as a CSV field, if needed
+ */
+string CSVEscape(const string& s)
+{
+	if(s.find_first_of(",\"\n") == string::npos)
+		return s;
+
+	string ret = "\"";
+	for(auto c : s)
+	{
+		if(c == '"')
+			ret += "\"\"";
+		else
+			ret += c;
+	}
+	return ret + "\"";
+}
+
+/**
+	@brief Parses the value of a numeric command line option
+
+	@param opt		Name of the option, for error messages
+	@param arg		The value given on the command line
+	@param value	Parsed value
+
+	@return True if arg is a positive integer, false (after printing an error) if not
+ */
+static bool ParseCountArgument(const string& opt, const string& arg, size_t& value)
+{
+	try
+	{
+		size_t pos;
+		value = stoul(arg, &pos);
+		if( (pos == arg.length()) && (arg[0] != '-') && (value > 0) )
+			return true;
+	}
+	catch(const invalid_argument&)
+	{}
+	catch(const out_of_range&)
+	{}
+
+	fprintf(stderr, "Invalid value \"%s\" for %s, expected a positive integer (use --help)\n", arg.c_str(), opt.c_str());
+	return false;
+}
+
+static void ShowUsage()
+{
+	fprintf(stderr,
+		"Usage: ngscopebatch [options] file.scopesession [file2.scopesession ...]\n"
+		"\n"
+		"Loads each session (and its _data directory) in offline mode, runs the filter graph over every saved\n"
+		"waveform, and writes the results as CSV.\n"
+		"\n"
+		"Options:\n"
+		"    --measurements FILE  Write scalar filter outputs to FILE (default: stdout)\n"
+		"    --packets FILE       Write decoded packets to FILE (default: not written)\n"
+		"    --jobs N             Number of waveforms to process in parallel (default: number of CPUs)\n"
+		"    --threads N          Filter graph executor threads per job (default: 1)\n"
+		"    --stats              Print total run time of each filter when done\n"
+		"\n"
+		"Filters which accumulate state across waveforms (eye patterns, averages, etc) only see the waveforms\n"
+		"processed by their own job, use --jobs 1 if these need to see the whole session. Sessions containing\n"
+		"export filters are always processed serially.\n"
+		"\n"
+		"Standard logging options (--quiet, --verbose, --debug, --trace, -l FILE) are also accepted.\n");
+}
+
+int main(int argc, char* argv[])
+{
+	//Keep the console quiet by default, since results may be going to stdout
+	Severity console_verbosity = Severity::WARNING;
+
+	vector<string> sessions;
+	string measurementsPath = "-";
+	string packetsPath;
+	size_t jobs = thread::hardware_concurrency();
+	size_t executorThreads = 1;
+	bool stats = false;
+
+	//Parse command-line arguments
+	for(int i=1; i<argc; i++)
+	{
+		string s(argv[i]);
+
+		//Let the logger eat its args first
+		if(ParseLoggerArguments(i, argc, argv, console_verbosity))
+			continue;
+
+		if( (s == "--help") || (s == "-h") )
+		{
+			ShowUsage();
+			return 0;
+		}
+		else if( (s == "--measurements") && (i+1 < argc) )
+			measurementsPath = argv[++i];
+		else if( (s == "--packets") && (i+1 < argc) )
+			packetsPath = argv[++i];
+		else if( (s == "--jobs") && (i+1 < argc) )
+		{
+			if(!ParseCountArgument(s, argv[++i], jobs))
+				return 1;
+		}
+		else if( (s == "--threads") && (i+1 < argc) )
+		{
+			if(!ParseCountArgument(s, argv[++i], executorThreads))
+				return 1;
+		}
+		else if(s == "--stats")
+			stats = true;
+		else if( (s[0] != '-') && (s.length() > 13) && (s.substr(s.length() - 13) == ".scopesession") )
+			sessions.push_back(s);
+		else
+		{
+			fprintf(stderr, "Unrecognized command-line argument \"%s\", use --help\n", s.c_str());
+			return 1;
+		}
+	}
+	if(sessions.empty())
+	{
+		ShowUsage();
+		return 1;
+	}
+	jobs = max(jobs, (size_t)1);
+	executorThreads = max(executorThreads, (size_t)1);
+
+	//Set up logging
+	g_log_sinks.emplace(g_log_sinks.begin(), new ColoredSTDLogSink(console_verbosity));
+
+	//Open output files
+	FILE* measurements = stdout;
+	if(measurementsPath != "-")
+	{
+		measurements = fopen(measurementsPath.c_str(), "w");
+		if(!measurements)
+		{
+			LogError("Couldn't open %s for writing\n", measurementsPath.c_str());
+			return 1;
+		}
+	}
+	FILE* packets = nullptr;
+	if(!packetsPath.empty())
+	{
+		packets = fopen(packetsPath.c_str(), "w");
+		if(!packets)
+		{
+			LogError("Couldn't open %s for writing\n", packetsPath.c_str());
+			return 1;
+		}
+	}
+	fprintf(measurements, "session,timestamp,filter,stream,value,unit\n");
+	if(packets)
+		fprintf(packets, "session,timestamp,filter,offset,length,headers\n");
+
+	//Initialize object creation tables for predefined libraries.
+	//No GLFW since we have no display, but we still need Vulkan (a software implementation is fine) for filters.
+	if(!VulkanInit(true))
+		return 1;
+	TransportStaticInit();
+	DriverStaticInit();
+	ScopeProtocolStaticInit();
+	InitializePlugins();
+
+	//When running from the build tree, shaders etc are copied to the ngscopeclient directory
+	g_searchPaths.push_back(GetDirOfCurrentExecutable() + "/../ngscopeclient/");
+
+	int ret = 0;
+	map<string, int64_t> runTimes;
+	for(auto& path : sessions)
+	{
+		if(!ProcessSessionFile(path, jobs, executorThreads, measurements, packets, runTimes))
+			ret = 1;
+	}
+
+	if(stats)
+	{
+		Unit fs(Unit::UNIT_FS);
+		LogNotice("Filter run times:\n");
+		LogIndenter li;
+		for(auto& it : runTimes)
+			LogNotice("%-40s %s\n", it.first.c_str(), fs.PrettyPrint(it.second).c_str());
+	}
+
+	//Done, clean up
+	if(measurements != stdout)
+		fclose(measurements);
+	if(packets)
+		fclose(packets);
+	ScopehalStaticCleanup();
+	return ret;
+}
+
+/**
+	@brief Loads a single session file and processes every waveform in it
+
+	@return True on success, false if the session couldn't be loaded
+ */
+static bool ProcessSessionFile(
+	const string& path,
+	size_t jobs,
+	size_t executorThreads,
+	FILE* measurements,
+	FILE* packets,
+	map<string, int64_t>& runTimes)
+{
+	string dataDir = path.substr(0, path.length() - strlen(".scopesession")) + "_data";
+	LogVerbose("Processing session \"%s\" (data directory %s)\n", path.c_str(), dataDir.c_str());
+	LogIndenter li;
+
+	vector<unique_ptr<BatchSession>> sessions;
+	vector<BatchRecord> records;
+	vector<vector<string>> mrows;
+	vector<vector<string>> prows;
+	bool ok = true;
+	try
+	{
+		auto docs = YAML::LoadAllFromFile(path);
+		if(docs.size() != 1)
+		{
+			LogError("%s: expected one YAML document, found %zu\n", path.c_str(), docs.size());
+			return false;
+		}
+
+		//Load the waveform data once, it's shared by all of the sessions
+		sessions.push_back(make_unique<BatchSession>(executorThreads));
+		if(!sessions[0]->Load(docs[0], dataDir) || !sessions[0]->LoadWaveformData(dataDir, records))
+			ok = false;
+
+		//Each job gets its own copy of the filter graph.
+		//Export filters write to files in record order, so they can't be run in parallel.
+		size_t nsessions = min(jobs, max(records.size(), (size_t)1));
+		if(sessions[0]->HasExportFilters() && (nsessions > 1) )
+		{
+			LogVerbose("Session contains export filters, processing serially\n");
+			nsessions = 1;
+		}
+		while(ok && (sessions.size() < nsessions) )
+		{
+			sessions.push_back(make_unique<BatchSession>(executorThreads));
+			ok = sessions.back()->Load(docs[0], dataDir);
+		}
+	}
+	catch(const YAML::Exception& ex)
+	{
+		LogError("%s: %s\n", path.c_str(), ex.what());
+		ok = false;
+	}
+
+	if(ok)
+	{
+		//Process records in parallel, but collect the results in order
+		mrows.resize(records.size());
+		prows.resize(records.size());
+		atomic<size_t> next(0);
+		double start = GetTime();
+		vector<thread> threads;
+		for(auto& s : sessions)
+		{
+			auto session = s.get();
+			threads.push_back(thread([&, session]
+			{
+				for(size_t i = next++; i < records.size(); i = next++)
+					session->Process(records[i], mrows[i], prows[i]);
+			}));
+		}
+		for(auto& t : threads)
+			t.join();
+		double dt = GetTime() - start;
+
+		LogVerbose("%zu waveforms processed in %.3f s using %zu jobs (%.1f waveforms/sec)\n",
+			records.size(), dt, sessions.size(), records.size() / dt);
+
+		auto sname = CSVEscape(path);
+		for(auto& rows : mrows)
+		{
+			for(auto& r : rows)
+				fprintf(measurements, "%s,%s\n", sname.c_str(), r.c_str());
+		}
+		if(packets)
+		{
+			for(auto& rows : prows)
+			{
+				for(auto& r : rows)
+					fprintf(packets, "%s,%s\n", sname.c_str(), r.c_str());
+			}
+		}
+
+		for(auto& s : sessions)
+		{
+			for(auto& it : s->GetRunTimes())
+				runTimes[it.first] += it.second;
+		}
+	}
+
+	//Destroy the sessions before the waveform data they were using
+	sessions.clear();
+	for(auto& rec : records)
+	{
+		for(auto& it : rec.m_streams)
+		{
+			for(auto& s : it.second)
+				delete s.m_data;
+		}
+	}
+
+	return ok;
+}
@@ -55,7 +55,10 @@ void BERTThread(BERTThreadArgs args)
 		bert->GetTransport()->FlushCommandQueue();
 
 		//Read real time BER
-		bert->AcquireData();
+		{
+			TraceSpan span("AcquireData", "acquisition");
+			bert->AcquireData();
+		}
 
 		//Check if we have any pending acquisition requests
 		for(size_t i=0; i<bert->GetChannelCount(); i++)
@@ -103,6 +103,22 @@ public:
 		m_ready = false;
 	}
 
+	/**
+		@brief Blocks until the event is signaled or a timeout expires
+
+		@param timeout	Maximum time to wait
+
+		@return True if the event was signaled, false on timeout
+	 */
+	bool Block(std::chrono::microseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if(!m_cond.wait_for(lock, timeout, [&]{ return m_ready.load(); }))
+			return false;
+		m_ready = false;
+		return true;
+	}
+
 	/**
 		@brief Checks if the event is signaled, and returns immediately without blocking regardless of event state.
 
@@ -230,29 +230,74 @@ void HistoryManager::AddHistory(
 	string nick,
 	TimePoint refTimeIfNoWaveforms)
 {
-	bool foundTimestamp = false;
-	TimePoint tp(0,0);
+	AddHistory(CaptureSnapshot(scopes), deleteOld, pin, nick, refTimeIfNoWaveforms);
+}
 
-	//First pass: find first waveform with a timestamp
+/**
+	@brief Grabs pointers to the current waveforms of a set of instruments without adding them to history
+
+	The snapshot remains valid after the instruments' channels are given new waveforms, as long as the old ones were
+	detached rather than deleted (as TriggerGroup::DownloadWaveforms does). This lets the waveform thread hand off
+	one acquisition to the UI thread for history processing while it starts working on the next one.
+
+	@param scopes		The instruments to capture
+ */
+WaveformSnapshot HistoryManager::CaptureSnapshot(const vector<shared_ptr<Oscilloscope>>& scopes)
+{
+	WaveformSnapshot snapshot;
 	for(auto scope : scopes)
 	{
+		WaveformHistory hist;
+
 		for(size_t i=0; i<scope->GetChannelCount(); i++)
 		{
 			auto chan = scope->GetOscilloscopeChannel(i);
 			if(!chan)
 				continue;
 			for(size_t j=0; j<chan->GetStreamCount(); j++)
+				hist[StreamDescriptor(chan, j)] = chan->GetData(j);
+		}
+
+		snapshot[scope] = hist;
+	}
+	return snapshot;
+}
+
+/**
+	@brief Adds a previously captured set of waveforms to history
+
+	@param snapshot		The waveforms to add
+	@param deleteOld	True to delete old data that rolled off the end of the history buffer
+	@param pin			True to pin into history
+	@param nick			Nickname
+	@param refTimeIfNoWaveforms	Timestamp to use if the snapshot contains no waveforms
+ */
+void HistoryManager::AddHistory(
+	const WaveformSnapshot& snapshot,
+	bool deleteOld,
+	bool pin,
+	string nick,
+	TimePoint refTimeIfNoWaveforms)
+{
+	bool foundTimestamp = false;
+	TimePoint tp(0,0);
+
+	//First pass: find first waveform with a timestamp
+	for(auto& it : snapshot)
+	{
+		for(auto& jt : it.second)
+		{
+			auto wfm = jt.second;
+			if(wfm)
 			{
-				auto wfm = chan->GetData(j);
-				if(wfm)
-				{
-					tp.SetSec(wfm->m_startTimestamp);
-					tp.SetFs(wfm->m_startFemtoseconds);
-					foundTimestamp = true;
-					break;
-				}
+				tp.SetSec(wfm->m_startTimestamp);
+				tp.SetFs(wfm->m_startFemtoseconds);
+				foundTimestamp = true;
+				break;
 			}
 		}
+		if(foundTimestamp)
+			break;
 	}
 
 	//If we get here, there were no waveforms anywhere!
@@ -271,23 +316,7 @@ void HistoryManager::AddHistory(
 	pt->m_time = tp;
 	pt->m_pinned = pin;
 	pt->m_nickname = nick;
-
-	//Add waveforms
-	for(auto scope : scopes)
-	{
-		WaveformHistory hist;
-
-		for(size_t i=0; i<scope->GetChannelCount(); i++)
-		{
-			auto chan = scope->GetOscilloscopeChannel(i);
-			if(!chan)
-				continue;
-			for(size_t j=0; j<chan->GetStreamCount(); j++)
-				hist[StreamDescriptor(chan, j)] = chan->GetData(j);
-		}
-
-		pt->m_history[scope] = hist;
-	}
+	pt->m_history = snapshot;
 
 	//TODO: check history size in MB/GB etc
 	//TODO: convert older stuff to disk, free GPU memory, etc?
@@ -40,6 +40,9 @@
 //Waveform history for a single instrument
 typedef std::map<StreamDescriptor, WaveformBase*> WaveformHistory;
 
+//Waveform data for a set of instruments at a single point in time
+typedef std::map<std::shared_ptr<Oscilloscope>, WaveformHistory> WaveformSnapshot;
+
 /**
 	@brief A single point of waveform history
  */
@@ -61,7 +64,7 @@ public:
 	std::string m_nickname;
 
 	///@brief Waveform data
-	std::map<std::shared_ptr<Oscilloscope>, WaveformHistory> m_history;
+	WaveformSnapshot m_history;
 
 	void LoadHistoryToSession(Session& session);
 };
@@ -84,6 +87,15 @@ public:
 		std::string nick = "",
 		TimePoint refTimeIfNoWaveforms = TimePoint(0, 0));
 
+	void AddHistory(
+		const WaveformSnapshot& snapshot,
+		bool deleteOld = true,
+		bool pin = false,
+		std::string nick = "",
+		TimePoint refTimeIfNoWaveforms = TimePoint(0, 0));
+
+	static WaveformSnapshot CaptureSnapshot(const std::vector<std::shared_ptr<Oscilloscope>>& scopes);
+
 	void LoadEmptyHistoryToSession(Session& session);
 
 	bool empty();
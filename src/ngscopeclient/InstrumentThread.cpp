@@ -39,6 +39,8 @@
 
 using namespace std;
 
+extern Event g_waveformThreadWakeEvent;
+
 void InstrumentThread(InstrumentThreadArgs args)
 {
 	pthread_setname_np_compat("InstrumentThread");
@@ -92,10 +94,12 @@ void InstrumentThread(InstrumentThreadArgs args)
 			}
 
 			//If trigger isn't armed, don't even bother polling for a while.
+			//(Drivers which can notify us of trigger activity will block at the end of the loop instead)
 			else if(!scope->IsTriggerArmed())
 			{
 				//LogTrace("Scope isn't armed, sleeping\n");
-				this_thread::sleep_for(chrono::milliseconds(5));
+				if(!scope->IsTriggerActivityWaitSupported())
+					this_thread::sleep_for(chrono::milliseconds(5));
 				if(!triggerUpToDate)
 				{	// Check for trigger state change
 					auto stat = scope->PollTrigger();
@@ -119,7 +123,11 @@ void InstrumentThread(InstrumentThreadArgs args)
 					//and we need to block in case a swapchain recreation comes in
 					shared_lock<shared_mutex> vlock(g_vulkanActivityMutex);
 
-					scope->AcquireData();
+					TraceSpan span("AcquireData", "acquisition");
+
+					//Let the waveform thread know right away rather than waiting for it to poll
+					if(scope->AcquireData())
+						g_waveformThreadWakeEvent.Signal();
 				}
 				triggerUpToDate = false;
 			}
@@ -127,7 +135,10 @@ void InstrumentThread(InstrumentThreadArgs args)
 
 		//Always acquire data from non-scope instruments
 		else
+		{
+			TraceSpan span("AcquireData", "acquisition");
 			inst->AcquireData();
+		}
 
 		//Populate scalar channel and do other instrument-specific processing
 		if(psu && psustate)
@@ -254,8 +265,19 @@ void InstrumentThread(InstrumentThreadArgs args)
 		session->RefreshDirtyFiltersNonblocking();
 
 		//Rate limit to 100 Hz to avoid saturating CPU with polls
-		//(this also provides a yield point for the gui thread to get mutex ownership etc)
-		this_thread::sleep_for(chrono::milliseconds(10));
+		//(this also provides a yield point for the gui thread to get mutex ownership etc).
+		//If the driver can tell us when the next waveform shows up, block on that instead so we don't add latency.
+		//Some drivers (e.g. demo) report activity continuously while armed, so only do that once the waveform thread
+		//has caught up. Otherwise nap briefly rather than spinning to produce waveforms nobody has consumed yet.
+		if(scope && scope->IsTriggerActivityWaitSupported())
+		{
+			if(scope->GetPendingWaveformCount() == 0)
+				scope->WaitForTriggerActivity(chrono::milliseconds(10));
+			else
+				this_thread::sleep_for(chrono::milliseconds(1));
+		}
+		else
+			this_thread::sleep_for(chrono::milliseconds(10));
 	}
 
 	LogTrace("Shutting down instrument thread\n");
@@ -91,6 +91,7 @@
 using namespace std;
 
 extern Event g_rerenderRequestedEvent;
+extern Event g_waveformThreadWakeEvent;
 extern unique_ptr<MainWindow> g_mainWindow;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -632,10 +633,13 @@ void MainWindow::RenderUI()
 		if(m_historyDialog != nullptr)
 			m_historyDialog->UpdateSelectionToLatest();
 
-		//Tell protocol analyzer dialogs a new waveform arrived
-		auto t = m_session.GetHistory().GetMostRecentPoint();
-		for(auto it : m_protocolAnalyzerDialogs)
-			it.second->OnWaveformLoaded(t);
+		//Tell protocol analyzer dialogs about every waveform that arrived, oldest first,
+		//since the waveform thread may have gotten more than one acquisition ahead of us
+		for(auto t : m_session.GetNewHistoryPoints())
+		{
+			for(auto it : m_protocolAnalyzerDialogs)
+				it.second->OnWaveformLoaded(t);
+		}
 	}
 
 	//Menu for main window
@@ -740,7 +744,10 @@ void MainWindow::RenderUI()
 	RenderLoadWarningPopup();
 
 	if(m_needRender)
+	{
 		g_rerenderRequestedEvent.Signal();
+		g_waveformThreadWakeEvent.Signal();
+	}
 
 	//DEBUG: draw the demo windows
 	if(m_showDemo)
@@ -45,6 +45,7 @@ using namespace std;
 MetricsDialog::MetricsDialog(Session* session)
 	: Dialog("Performance Metrics", "Metrics", ImVec2(300, 400))
 	, m_session(session)
+	, m_tracePath("ngscopeclient-trace.json")
 {
 	m_displayRefreshRate = 0;
 
@@ -292,6 +293,46 @@ bool MetricsDialog::DoRender()
 		}
 	}
 
+	if(ImGui::CollapsingHeader("Tracing"))
+	{
+		bool tracing = TraceRecorder::IsEnabled();
+		if(ImGui::Checkbox("Record trace", &tracing))
+		{
+			if(tracing)
+				TraceRecorder::Enable();
+			else
+				TraceRecorder::Disable();
+		}
+
+		HelpMarker(
+			"Records a timeline of instrument I/O, filter graph execution, buffer transfers, and rendering "
+			"on every thread.\n\n"
+			"Each thread keeps only its most recent events, so it's safe to leave this running.");
+
+		ImGui::BeginDisabled();
+			str = counts.PrettyPrint(TraceRecorder::GetEventCount());
+			ImGui::SetNextItemWidth(width);
+			ImGui::InputText("Events", &str);
+		ImGui::EndDisabled();
+
+		HelpMarker("Number of events currently held in the trace buffers");
+
+		ImGui::SetNextItemWidth(ImGui::GetFontSize() * 15);
+		ImGui::InputText("Trace file", &m_tracePath);
+
+		HelpMarker("Path to write the trace to");
+
+		if(ImGui::Button("Save"))
+			TraceRecorder::WriteChromeTrace(m_tracePath);
+		ImGui::SameLine();
+		if(ImGui::Button("Clear"))
+			TraceRecorder::Clear();
+
+		HelpMarker(
+			"The trace is written in Chrome trace JSON format.\n\n"
+			"Open it in ui.perfetto.dev or chrome://tracing to view it.");
+	}
+
 	return true;
 }
 
@@ -49,6 +49,9 @@ protected:
 	Session* m_session;
 
 	int m_displayRefreshRate;
+
+	///@brief Path to write timeline traces to
+	std::string m_tracePath;
 };
 
 #endif
@@ -415,13 +415,31 @@ void PreferenceManager::InitializeDefaults()
 					.EnumValue("48x48", 48)
 				);
 
-		/*auto& waveforms = appearance.AddCategory("Waveforms");
-			waveforms.AddPreference(
+		auto& waveforms = appearance.AddCategory("Waveforms");
+			/*waveforms.AddPreference(
 				Preference::Real("persist_decay_rate", 0.9)
 				.Label("Persistence decay rate (0 = none, 1 = infinite)")
 				.Description("Decay rate for persistence waveforms. ")
 				.Unit(Unit::UNIT_COUNTS));
-		*/
+			*/
+			waveforms.AddPreference(
+				Preference::Enum("rasterizer", RASTERIZER_AUTO)
+					.Label("Rasterizer")
+					.Description(
+						"Selects where analog and digital waveforms are rasterized before tone mapping.\n"
+						"\n"
+						"GPU uses Vulkan compute shaders. CPU uses a multithreaded software rasterizer, which is\n"
+						"much faster than running the shaders on a software Vulkan implementation (llvmpipe,\n"
+						"lavapipe, SwiftShader) on headless or virtualized hosts.\n"
+						"\n"
+						"Auto times both rasterizers on a synthetic waveform the first time a waveform is drawn\n"
+						"and uses whichever is faster (always the CPU if the Vulkan device is itself a CPU)."
+						)
+					.EnumValue("Auto", RASTERIZER_AUTO)
+					.EnumValue("GPU", RASTERIZER_GPU)
+					.EnumValue("CPU", RASTERIZER_CPU)
+				);
+
 		auto& windows = appearance.AddCategory("Windowing");
 			windows.AddPreference(
 				Preference::Enum("viewport_mode", VIEWPORT_ENABLE)
@@ -451,6 +469,16 @@ void PreferenceManager::InitializeDefaults()
 				)
 				.EnumValue("All non-MSO channels", HEADLESS_STARTUP_ALL_NON_MSO)
 				.EnumValue("Channel 1 only", HEADLESS_STARTUP_C1_ONLY) );
+			dgeneral.AddPreference(
+				Preference::Int("pipeline_depth", 2)
+				.Label("Acquisition pipeline depth")
+				.Description(
+				"Number of acquisitions which may be downloaded and run through the filter graph before the\n"
+				"user interface has finished displaying and adding to history the previous one.\n\n"
+				"Higher values improve trigger rate on fast instruments at the cost of more memory and display latency.\n"
+				"Set to 1 to process each acquisition in lock-step with the display."
+				)
+				.Unit(Unit::UNIT_COUNTS));
 
 		auto& rigol = drivers.AddCategory("Rigol DHO");
 			rigol.AddPreference(
@@ -509,6 +537,13 @@ void PreferenceManager::InitializeDefaults()
 			.Label("Max recent files")
 			.Description("Maximum number of recent .scopesession file paths to save in history")
 			.Unit(Unit::UNIT_COUNTS));
+		files.AddPreference(
+			Preference::Bool("compress_waveforms", false)
+			.Label("Compress waveforms")
+			.Description(
+				"Save waveform data in sessions using lossless compression.\n\n"
+				"Compressed sessions are typically several times smaller and faster to load from slow disks, "
+				"but cannot be opened by older versions of ngscopeclient."));
 
 	auto& misc = this->m_treeRoot.AddCategory("Miscellaneous");
 		auto& menus = misc.AddCategory("Menus");
@@ -68,4 +68,11 @@ enum HeadlessStartupMode
 	HEADLESS_STARTUP_C1_ONLY
 };
 
+enum WaveformRasterizer
+{
+	RASTERIZER_AUTO,
+	RASTERIZER_GPU,
+	RASTERIZER_CPU
+};
+
 #endif
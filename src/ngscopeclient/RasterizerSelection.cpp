@@ -0,0 +1,157 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Selection between the CPU and GPU waveform rasterizers
+ */
+#include "ngscopeclient.h"
+#include "RasterizerSelection.h"
+#include "PreferenceManager.h"
+
+using namespace std;
+
+static bool IsCpuRasterizerFaster();
+
+/**
+	@brief Decides whether waveforms should be rasterized on the CPU rather than by the Vulkan compute shader
+ */
+bool ShouldUseCpuRasterizer(const PreferenceManager& prefs)
+{
+	switch(prefs.GetEnumRaw("Appearance.Waveforms.rasterizer"))
+	{
+		case RASTERIZER_CPU:
+			return true;
+
+		case RASTERIZER_GPU:
+			return false;
+
+		//Hardware doesn't change while we're running, so only benchmark once
+		case RASTERIZER_AUTO:
+		default:
+			{
+				static bool cpuFaster = IsCpuRasterizerFaster();
+				return cpuFaster;
+			}
+	}
+}
+
+/**
+	@brief Times both rasterizers on a synthetic uniform analog waveform and reports whether the CPU was faster
+
+	The GPU time includes submission and the wait for completion, since the render path pays for those too.
+ */
+static bool IsCpuRasterizerFaster()
+{
+	//Software Vulkan implementations run compute shaders an order of magnitude slower than native code,
+	//so if our "GPU" is actually the CPU, don't bother measuring
+	if(g_vkComputePhysicalDevice->getProperties().deviceType == vk::PhysicalDeviceType::eCpu)
+	{
+		LogDebug("Vulkan device is a CPU, using CPU rasterizer\n");
+		return true;
+	}
+
+	//Deep enough to be representative of a zoomed-out capture, with some noise so columns aren't trivial
+	const size_t depth = 1000000;
+	const uint32_t width = 1024;
+	const uint32_t height = 256;
+	const int niter = 3;
+
+	UniformAnalogWaveform wfm;
+	wfm.m_timescale = 1;
+	wfm.m_triggerPhase = 0;
+	wfm.Resize(depth);
+	wfm.PrepareForCpuAccess();
+	for(size_t i=0; i<depth; i++)
+		wfm.m_samples[i] = sinf(i * 0.001f) + ((i * 7919) % 13) * 0.01f;
+	wfm.MarkModifiedFromCpu();
+
+	AcceleratorBuffer<float> img;
+	img.resize(width * height);
+
+	ConfigPushConstants config;
+	config.innerXoff = 0;
+	config.windowHeight = height;
+	config.windowWidth = width;
+	config.memDepth = depth;
+	config.offset_samples = 0;
+	config.alpha = 0.01;
+	config.xoff = 0;
+	config.xscale = float(width) / depth;
+	config.ybase = height * 0.5f;
+	config.yscale = height * 0.4f;
+	config.yoff = 0;
+	config.persistScale = 0;
+
+	//Best of several runs on the CPU
+	double tcpu = FLT_MAX;
+	img.PrepareForCpuAccess();
+	for(int i=0; i<niter; i++)
+	{
+		double start = GetTime();
+		RasterizeWaveformCPU(config, &wfm, nullptr, false, false, img.GetCpuPointer());
+		tcpu = min(tcpu, GetTime() - start);
+	}
+	img.MarkModifiedFromCpu();
+
+	//Same on the GPU. First dispatch is a warmup (pipeline creation and buffer upload aren't counted)
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("RasterizerBenchmark.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	string suffix;
+	if(g_hasShaderInt64)
+		suffix += ".int64";
+	ComputePipeline pipe("shaders/waveform-compute.analog" + suffix + ".dense.spv", 2, sizeof(ConfigPushConstants));
+
+	double tgpu = FLT_MAX;
+	for(int i=0; i<=niter; i++)
+	{
+		double start = GetTime();
+		cmdbuf.begin({});
+		pipe.BindBufferNonblocking(0, img, cmdbuf, true);
+		pipe.BindBufferNonblocking(1, wfm.m_samples, cmdbuf);
+		pipe.Dispatch(cmdbuf, config, width, 1, 1);
+		cmdbuf.end();
+		queue->SubmitAndBlock(cmdbuf);
+		if(i > 0)
+			tgpu = min(tgpu, GetTime() - start);
+	}
+	img.MarkModifiedFromGpu();
+
+	bool cpuFaster = (tcpu < tgpu);
+	LogDebug("Rasterizer benchmark: CPU %.2f ms, GPU %.2f ms, using %s\n",
+		tcpu * 1000, tgpu * 1000, cpuFaster ? "CPU" : "GPU");
+	return cpuFaster;
+}
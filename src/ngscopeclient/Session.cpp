@@ -36,6 +36,7 @@
 #include "ngscopeclient-version.h"
 #include "Session.h"
 #include "../scopeprotocols/ExportFilter.h"
+#include "../scopeprotocols/SavedWaveformLoader.h"
 #include "MainWindow.h"
 #include "BERTDialog.h"
 #include "FunctionGeneratorDialog.h"
@@ -70,6 +71,7 @@ extern Event g_rerenderDoneEvent;
 extern Event g_refilterRequestedEvent;
 extern Event g_partialRefilterRequestedEvent;
 extern Event g_refilterDoneEvent;
+extern Event g_waveformThreadWakeEvent;
 
 extern std::shared_mutex g_vulkanActivityMutex;
 
@@ -83,6 +85,7 @@ Session::Session(MainWindow* wnd)
 	, m_mainWindow(wnd)
 	, m_shuttingDown(false)
 	, m_modifiedSinceLastSave(false)
+	, m_pipelineDepth(1)
 	, m_tArm(0)
 	, m_tPrimaryTrigger(0)
 	, m_triggerArmed(false)
@@ -106,6 +109,8 @@ Session::Session(MainWindow* wnd)
 	SCPIBERT::EnumDrivers(m_driverNamesByType["bert"]);
 	SCPIMiscInstrument::EnumDrivers(m_driverNamesByType["misc"]);
 	SCPIVNA::EnumDrivers(m_driverNamesByType["vna"]);
+
+	UpdatePipelineDepth();
 }
 
 Session::~Session()
@@ -140,17 +145,25 @@ void Session::ClearBackgroundThreads()
 	}
 
 	//Clear our trigger state
-	//Important to signal the WaveformProcessingThread so it doesn't block waiting on response that's not going to come
+	//Important to signal the WaveformProcessingThread so it doesn't block waiting on response that's not going to come.
+	//The shutdown flag has to be set first, since the thread re-checks it every time it wakes up
 	g_waveformReadyEvent.Clear();
 	g_rerenderDoneEvent.Clear();
+	m_shuttingDown = true;
 	g_waveformProcessedEvent.Signal();
+	g_waveformThreadWakeEvent.Signal();
 
-	//Signal our other worker threads to exit, then wait until they do so
-	m_shuttingDown = true;
+	//Wait for our other worker threads to exit
 	if(m_waveformThread)
 		m_waveformThread->join();
 	m_waveformThread = nullptr;
 
+	//Anything the UI thread didn't get to yet still owns waveforms, so hand it off to history rather than leaking it
+	{
+		shared_lock<shared_mutex> lock(m_waveformDataMutex);
+		AddPendingHistory();
+	}
+
 	//Clear shutdown flag in case we're reusing the session object
 	m_shuttingDown = false;
 }
@@ -245,6 +258,7 @@ void Session::Clear()
 	m_triggerGroups.clear();
 	m_recentlyTriggeredScopes.clear();
 	m_recentlyTriggeredGroups.clear();
+	m_pendingHistory.clear();
 
 	//Remove any existing IDs
 	m_idtable.clear();
@@ -355,8 +369,7 @@ bool Session::LoadFromYaml(const YAML::Node& node, const string& dataDir, bool o
 		return false;
 	if(!LoadFilters(m_fileLoadVersion, node["decodes"]))
 		return false;
-	if(!LoadInstrumentInputs(m_fileLoadVersion, node["instruments"]))
-		return false;
+	SavedSessionLoader::LoadInstrumentInputs(node["instruments"], m_idtable);
 	if(!m_mainWindow->LoadUIConfiguration(m_fileLoadVersion, node["ui_config"]))
 		return false;
 	if(!LoadTriggerGroups(node["triggergroups"]))
@@ -397,18 +410,10 @@ bool Session::LoadWaveformData(int version, const string& dataDir)
 
 	//Load filter waveforms *before* scope data
 	//(we don't want any filters to be updated from nonexistent inputs and change state prior to getting output loaded)
-	string fname = dataDir + "/filter_metadata.yml";
-	FILE* fp = fopen(fname.c_str(), "r");
-	if(fp)
 	{
-		fclose(fp);
-
-		auto docs = YAML::LoadAllFromFile(fname);
-		if(docs.size())
-		{
-			if(!LoadWaveformDataForFilters(version, docs[0], dataDir))
-				return false;
-		}
+		//Block filter graph from running while loading
+		lock_guard<shared_mutex> lock(m_waveformDataMutex);
+		SavedSessionLoader::LoadFilterWaveforms(dataDir, m_idtable);
 	}
 
 	//Load data for each scope
@@ -417,133 +422,38 @@ bool Session::LoadWaveformData(int version, const string& dataDir)
 		auto scope = m_oscilloscopes[i];
 		int id = m_idtable[(Instrument*)scope.get()];
 
-		char tmp[512] = {0};
-		snprintf(tmp, sizeof(tmp), "%s/scope_%d_metadata.yml", dataDir.c_str(), id);
-		auto docs = YAML::LoadAllFromFile(tmp);
-
-		//Nothing there? No waveforms at all, skip loading
-		if(docs.empty())
-			return true;
-
-		if(!LoadWaveformDataForScope(version, docs[0], scope, dataDir))
+		vector<SavedWaveformLoader::SavedWaveform> parsed;
+		if(!SavedSessionLoader::ParseScopeWaveforms(version, scope.get(), id, dataDir, parsed))
 		{
-			LogTrace("Waveform data loading failed\n");
+			LogTrace("Waveform metadata parsing failed\n");
 			return false;
 		}
-	}
-
-	m_history.SetMaxToCurrentDepth();
-
-	return true;
-}
-
-/**
-	@brief Loads waveform data for filters that need to be preserved
- */
-bool Session::LoadWaveformDataForFilters(
-		int /*version*/,		//ignored for now, always 2 since older formats don't support filter waveforms
-		const YAML::Node& node,
-		const string& dataDir)
-{
-	//Block filter graph from running while loading
-	lock_guard<shared_mutex> lock(m_waveformDataMutex);
-
-	if(!node)
-		return true;
-	auto waveforms = node["waveforms"];
-	if(!waveforms)
-		return true;
-
-	string filtdir = dataDir + "/filter_waveforms";
-
-	for(auto it : waveforms)
-	{
-		auto ftag = it.second;
-		auto id = ftag["id"].as<intptr_t>();
 
-		auto timestamp = ftag["timestamp"].as<int64_t>();
-		auto time_fsec = ftag["time_fsec"].as<int64_t>();
-
-		string datdir = filtdir + "/filter_" + to_string(id);
-
-		auto f = static_cast<OscilloscopeChannel*>(m_idtable[id]);
-		if(!f)
+		//Nothing there? No waveforms for this scope, skip loading
+		if(parsed.empty())
 			continue;
-		for(size_t i=0; i<f->GetStreamCount(); i++)
-		{
-			auto stag = ftag["streams"][string("s") + to_string(i)];
-			if(!stag)
-				continue;
-
-			auto fmt = stag["format"].as<string>();
-			bool dense = (fmt == "densev1");
-
-			//TODO: we need to encode a digital path in the YAML once MemoryFilter has digital channel support
-			//TODO: support non-analog/digital captures (eyes, spectrograms, etc)
-
-			WaveformBase* cap = NULL;
-			SparseAnalogWaveform* sacap = NULL;
-			UniformAnalogWaveform* uacap = NULL;
-			//SparseDigitalWaveform* sdcap = NULL;
-			//UniformDigitalWaveform* udcap = NULL;
-			if(f->GetType(0) == Stream::STREAM_TYPE_ANALOG)
-			{
-				if(dense)
-					cap = uacap = new UniformAnalogWaveform;
-				else
-					cap = sacap = new SparseAnalogWaveform;
-			}
-			else
-			{
-				LogError("unknown stream type loading waveform\n");
-				/*
-				if(dense)
-					cap = udcap = new UniformDigitalWaveform;
-				else
-					cap = sdcap = new SparseDigitalWaveform;
-				*/
-			}
 
-			//Channel waveform metadata
-			cap->m_timescale = stag["timescale"].as<int64_t>();
-			cap->m_startTimestamp = timestamp;
-			cap->m_startFemtoseconds = time_fsec;
-			cap->m_triggerPhase = stag["trigphase"].as<long long>();
-			cap->m_flags = stag["flags"].as<int>();
-			f->SetData(cap, i);
-
-			//Actually load the waveform
-			string fname = datdir + "/stream" + to_string(i) + ".bin";
-			DoLoadWaveformDataForStream(f, i, fmt, fname);
-		}
+		LoadWaveformDataForScope(scope, parsed);
 	}
 
+	m_history.SetMaxToCurrentDepth();
+
 	return true;
 }
 
 /**
-	@brief Loads waveform data for a single scope
+	@brief Loads waveform data for a single scope and adds it to history
+
+	@param scope	The scope
+	@param parsed	Empty waveform objects for every history point, from SavedSessionLoader::ParseScopeWaveforms()
  */
-bool Session::LoadWaveformDataForScope(
-	int version,
-	const YAML::Node& node,
+void Session::LoadWaveformDataForScope(
 	shared_ptr<Oscilloscope> scope,
-	const std::string& dataDir)
+	vector<SavedWaveformLoader::SavedWaveform>& parsed)
 {
 	LogTrace("Loading waveform data for scope \"%s\"\n", scope->m_nickname.c_str());
 	LogIndenter li;
 
-	TimePoint time(0, 0);
-	TimePoint newest(0, 0);
-
-	auto wavenode = node["waveforms"];
-	if(!wavenode)
-	{
-		//No waveforms
-		return true;
-	}
-	int scope_id = m_idtable[(Instrument*)scope.get()];
-
 	//Clear out any old waveforms the instrument may have
 	for(size_t i=0; i<scope->GetChannelCount(); i++)
 	{
@@ -557,331 +467,47 @@ bool Session::LoadWaveformDataForScope(
 			chan->SetData(nullptr, j);
 	}
 
-	//Load the data for each waveform
-	for(auto it : wavenode)
+	//If we already have historical data from this timestamp, warn and drop the duplicate data
+	vector<SavedWaveformLoader::SavedWaveform> records;
+	for(auto& rec : parsed)
 	{
-		//Top level metadata
-		bool timebase_is_ps = true;
-		auto wfm = it.second;
-		time.first = wfm["timestamp"].as<long long>();
-		if(wfm["time_psec"])
-		{
-			time.second = wfm["time_psec"].as<long long>() * 1000;
-			timebase_is_ps = true;
-		}
-		else
-		{
-			time.second = wfm["time_fsec"].as<long long>();
-			timebase_is_ps = false;
-		}
-		int waveform_id = wfm["id"].as<int>();
-		bool pinned = false;
-		if(wfm["pinned"])
-		{
-			if(version <= 1)
-				pinned = wfm["pinned"].as<int>();
-			else
-				pinned = wfm["pinned"].as<bool>();
-		}
-		string label;
-		if(wfm["label"])
-			label = wfm["label"].as<string>();
-
-		LogTrace("Loading waveform data at time %s\n", time.PrettyPrint().c_str());
-
-		//If we already have historical data from this timestamp, warn and drop the duplicate data
+		TimePoint time(rec.m_timestamp, rec.m_fs);
 		auto hist = m_history.GetHistory(time);
-		if(hist && (hist->m_history.find(scope) != hist->m_history.end()))
+		if(hist && (hist->m_history.find(scope) != hist->m_history.end()) )
 		{
-			LogWarning("Session contains duplicate data for time %" PRId64 ".%" PRId64 ", discarding\n", static_cast<int64_t>(time.first), time.second);
+			LogWarning("Session contains duplicate data for time %" PRId64 ".%" PRId64 ", discarding\n",
+				static_cast<int64_t>(time.first), time.second);
+			for(auto& s : rec.m_streams)
+				delete s.m_data;
 			continue;
 		}
+		records.push_back(rec);
+	}
 
-		//Set up channel metadata first (serialized)
-		auto chans = wfm["channels"];
-		vector<pair<int, int>> channels;	//pair<channel, stream>
-		vector<string> formats;
-		for(auto jt : chans)
-		{
-			auto ch = jt.second;
-			int channel_index = ch["index"].as<int>();
-			int stream = 0;
-			if(ch["stream"])
-				stream = ch["stream"].as<int>();
-			auto chan = scope->GetOscilloscopeChannel(channel_index);
-			channels.push_back(pair<int, int>(channel_index, stream));
-
-			//Waveform format defaults to sparsev1 as that's what was used before
-			//the metadata file contained a format ID at all
-			string format = "sparsev1";
-			if(ch["format"])
-				format = ch["format"].as<string>();
-			formats.push_back(format);
-
-			bool dense = (format == "densev1");
-
-			//TODO: support non-analog/digital captures (eyes, spectrograms, etc)
-			WaveformBase* cap = nullptr;
-			SparseAnalogWaveform* sacap = nullptr;
-			UniformAnalogWaveform* uacap = nullptr;
-			SparseDigitalWaveform* sdcap = nullptr;
-			UniformDigitalWaveform* udcap = nullptr;
-			CANWaveform* sccap = nullptr;
-
-			//if datatype is specified, use that
-			if( (format == "sparsev1") && ch["datatype"] )
-			{
-				auto dtype = ch["datatype"].as<string>();
-				if(dtype == "analog")
-					cap = sacap = new SparseAnalogWaveform;
-				else if(dtype == "digital")
-					cap = sdcap = new SparseDigitalWaveform;
-				else if(dtype == "can")
-					cap = sccap = new CANWaveform;
-				else
-					LogError("Unrecognized sparsev1 datatype %s\n", dtype.c_str());
-			}
-
-			//if not guess based on stream type
-			else if(chan->GetType(0) == Stream::STREAM_TYPE_ANALOG)
-			{
-				if(dense)
-					cap = uacap = new UniformAnalogWaveform;
-				else
-					cap = sacap = new SparseAnalogWaveform;
-			}
-			else
-			{
-				if(dense)
-					cap = udcap = new UniformDigitalWaveform;
-				else
-					cap = sdcap = new SparseDigitalWaveform;
-			}
-
-			//Channel waveform metadata
-			cap->m_timescale = ch["timescale"].as<long>();
-			cap->m_startTimestamp = time.first;
-			cap->m_startFemtoseconds = time.second;
-			if(timebase_is_ps)
-			{
-				cap->m_timescale *= 1000;
-				cap->m_triggerPhase = ch["trigphase"].as<float>() * 1000;
-			}
-			else
-				cap->m_triggerPhase = ch["trigphase"].as<long long>();
+	//Actually load the sample data
+	SavedWaveformLoader::LoadAll(records);
 
-			chan->Detach(stream);
-			chan->SetData(cap, stream);
-		}
+	//Install each history point into the channels, oldest first, and add it to history
+	for(auto& rec : records)
+	{
+		TimePoint time(rec.m_timestamp, rec.m_fs);
+		LogTrace("Adding waveform data at time %s\n", time.PrettyPrint().c_str());
 
-		//Actually load the data for each channel
-		size_t nchans = channels.size();
-		char tmp[512];
-		for(size_t i=0; i<nchans; i++)
+		for(auto& s : rec.m_streams)
 		{
-			auto nchan = channels[i].first;
-			auto nstream = channels[i].second;
-
-			if(nstream == 0)
-			{
-				snprintf(tmp, sizeof(tmp), "%s/scope_%d_waveforms/waveform_%d/channel_%d.bin",
-					dataDir.c_str(),
-					scope_id,
-					waveform_id,
-					nchan);
-			}
-			else
-			{
-				snprintf(tmp, sizeof(tmp), "%s/scope_%d_waveforms/waveform_%d/channel_%d_stream%d.bin",
-					dataDir.c_str(),
-					scope_id,
-					waveform_id,
-					nchan,
-					nstream);
-			}
-
-			DoLoadWaveformDataForStream(
-				scope->GetOscilloscopeChannel(nchan),
-				nstream,
-				formats[i],
-				tmp);
+			auto chan = scope->GetOscilloscopeChannel(s.m_channel);
+			chan->Detach(s.m_stream);
+			chan->SetData(s.m_data, s.m_stream);
 		}
 
 		vector<shared_ptr<Oscilloscope>> temp;
 		temp.push_back(scope);
-		m_history.AddHistory(temp, false, pinned, label);
+		m_history.AddHistory(temp, false, rec.m_pinned, rec.m_label);
 
 		//TODO: this is not good for multiscope
 		//TODO: handle eye patterns (need to know window size for it to work right)
 		RefreshAllFilters();
 	}
-	return true;
-}
-
-void Session::DoLoadWaveformDataForStream(
-	OscilloscopeChannel* chan,
-	int stream,
-	string format,
-	string fname
-	)
-{
-	auto cap = chan->GetData(stream);
-	auto sacap = dynamic_cast<SparseAnalogWaveform*>(cap);
-	auto uacap = dynamic_cast<UniformAnalogWaveform*>(cap);
-	auto sdcap = dynamic_cast<SparseDigitalWaveform*>(cap);
-	auto udcap = dynamic_cast<UniformDigitalWaveform*>(cap);
-	auto ccap = dynamic_cast<CANWaveform*>(cap);
-
-	cap->PrepareForCpuAccess();
-
-	//Load samples into memory
-	unsigned char* buf = NULL;
-
-	//Windows: use generic file reads for now
-	#ifdef _WIN32
-		FILE* fp = fopen(fname.c_str(), "rb");
-		if(!fp)
-		{
-			LogError("couldn't open %s\n", fname.c_str());
-			return;
-		}
-
-		//Read the whole file into a buffer a megabyte at a time
-		fseek(fp, 0, SEEK_END);
-		long len = ftell(fp);
-		fseek(fp, 0, SEEK_SET);
-		buf = new unsigned char[len];
-		long len_remaining = len;
-		long blocksize = 1024*1024;
-		long read_offset = 0;
-		while(len_remaining > 0)
-		{
-			if(blocksize > len_remaining)
-				blocksize = len_remaining;
-
-			//Most time is spent on the fread's when using this path
-			fread(buf + read_offset, 1, blocksize, fp);
-
-			len_remaining -= blocksize;
-			read_offset += blocksize;
-		}
-		fclose(fp);
-
-	//On POSIX, just memory map the file
-	#else
-		int fd = open(fname.c_str(), O_RDONLY);
-		if(fd < 0)
-		{
-			LogError("couldn't open %s\n", fname.c_str());
-			return;
-		}
-		size_t len = lseek(fd, 0, SEEK_END);
-		buf = (unsigned char*)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
-	#endif
-
-	//Sparse interleaved
-	if(format == "sparsev1")
-	{
-		//Figure out how many samples we have
-		size_t samplesize = 2*sizeof(int64_t);
-		if(sacap)
-			samplesize += sizeof(float);
-		else if(sdcap)
-			samplesize += sizeof(bool);
-		else if(ccap)
-			samplesize += 2*sizeof(int32_t);
-		size_t nsamples = len / samplesize;
-		cap->Resize(nsamples);
-
-		//TODO: AVX this?
-		for(size_t j=0; j<nsamples; j++)
-		{
-			size_t offset = j*samplesize;
-
-			//Read start time and duration
-			int64_t* stime = reinterpret_cast<int64_t*>(buf+offset);
-			offset += 2*sizeof(int64_t);
-
-			//Read sample data
-			if(sacap)
-			{
-				//The file format assumes "float" is IEEE754 32-bit float.
-				//If your platform doesn't do that, good luck.
-				//cppcheck-suppress invalidPointerCast
-				sacap->m_samples[j] = *reinterpret_cast<float*>(buf+offset);
-
-				sacap->m_offsets[j] = stime[0];
-				sacap->m_durations[j] = stime[1];
-			}
-
-			else if(sdcap)
-			{
-				sdcap->m_samples[j] = *reinterpret_cast<bool*>(buf+offset);
-				sdcap->m_offsets[j] = stime[0];
-				sdcap->m_durations[j] = stime[1];
-			}
-
-			//CAN capture
-			else if(ccap)
-			{
-				uint32_t* p = reinterpret_cast<uint32_t*>(buf+offset);
-
-				ccap->m_samples[j] = CANSymbol((CANSymbol::stype)p[1], p[0]);
-				ccap->m_offsets[j] = stime[0];
-				ccap->m_durations[j] = stime[1];
-			}
-		}
-
-		//Quickly check if the waveform is dense packed, even if it was stored as sparse.
-		//Since we know samples must be monotonic and non-overlapping, we don't have to check every single one!
-		int64_t nlast = nsamples - 1;
-		if(sacap)
-		{
-			if( (sacap->m_offsets[0] == 0) &&
-				(sacap->m_offsets[nlast] == nlast) &&
-				(sacap->m_durations[nlast] == 1) )
-			{
-				//Waveform was actually uniform, so convert it
-				cap = new UniformAnalogWaveform(*sacap);
-				chan->SetData(cap, stream);
-			}
-		}
-	}
-
-	//Dense packed
-	else if(format == "densev1")
-	{
-		//Figure out length
-		size_t nsamples = 0;
-		if(uacap)
-			nsamples = len / sizeof(float);
-		else if(udcap)
-			nsamples = len / sizeof(bool);
-		cap->Resize(nsamples);
-
-		//Read sample data
-		if(uacap)
-			memcpy(uacap->m_samples.GetCpuPointer(), buf, nsamples*sizeof(float));
-		else
-			memcpy(udcap->m_samples.GetCpuPointer(), buf, nsamples*sizeof(bool));
-	}
-
-	else
-	{
-		LogError(
-			"Unknown waveform format \"%s\", perhaps this file was created by a newer version of ngscopeclient?\n",
-			format.c_str());
-	}
-
-	cap->MarkModifiedFromCpu();
-	cap->PrepareForGpuAccess();
-
-	#ifdef _WIN32
-		delete[] buf;
-	#else
-		munmap(buf, len);
-		::close(fd);
-	#endif
 }
 
 /**
@@ -1980,88 +1606,24 @@ shared_ptr<TriggerGroup> Session::GetTrendFilterGroup()
 
 bool Session::LoadFilters(int /*version*/, const YAML::Node& node)
 {
-	//No protocol decodes? Skip this section
-	if(!node)
-		return true;
-
-	//Load each decode
-	for(auto it : node)
-	{
-		auto dnode = it.second;
-
-		//Create the decode
-		auto proto = dnode["protocol"].as<string>();
-		auto filter = Filter::CreateFilter(proto, dnode["color"].as<string>());
-		if(filter == NULL)
-		{
-			m_mainWindow->ShowErrorPopup(
-				"Filter creation failed",
-				string("Unable to create filter \"") + proto + "\". Skipping...\n");
-			continue;
-		}
-
-		m_idtable.emplace(dnode["id"].as<uintptr_t>(), filter);
-
-		//Load parameters during the first pass.
-		//Parameters can't have dependencies on other channels etc.
-		//More importantly, parameters may change bus width etc
-		filter->LoadParameters(dnode, m_idtable);
-
-		//Create protocol analyzers
-		auto pd = dynamic_cast<PacketDecoder*>(filter);
-		if(pd)
-			AddPacketFilter(pd);
-
-		//Resize eye patterns to a reasonable default size
-		//TODO: ngscopeclient should save actual size
-		auto eye = dynamic_cast<EyePattern*>(filter);
-		if(eye)
+	vector<string> failed;
+	SavedSessionLoader::LoadFilters(
+		node,
+		m_idtable,
+		[this](Filter* filter)
 		{
-			eye->SetWidth(512);
-			eye->SetHeight(512);
-		}
-	}
-
-	//Make a second pass to configure the filter inputs, once all of them have been instantiated.
-	//Filters may depend on other filters as inputs, and serialization is not guaranteed to be a topological sort.
-	for(auto it : node)
-	{
-		auto dnode = it.second;
-		auto filter = static_cast<Filter*>(m_idtable[dnode["id"].as<uintptr_t>()]);
-		if(filter)
-			filter->LoadInputs(dnode, m_idtable);
-	}
-
-	return true;
-}
+			//Create protocol analyzers
+			auto pd = dynamic_cast<PacketDecoder*>(filter);
+			if(pd)
+				AddPacketFilter(pd);
+		},
+		failed);
 
-bool Session::LoadInstrumentInputs(int /*version*/, const YAML::Node& node)
-{
-	//Nothing to do? Skip this section
-	if(!node)
-		return true;
-
-	//Check each instrument in the file and see if we have inputs that need to be hooked up
-	//Load each instrument
-	for(auto it : node)
+	for(auto& proto : failed)
 	{
-		auto inst = it.second;
-		auto nick = inst["nick"].as<string>();
-		LogTrace("Loading additional inputs for instrument \"%s\"\n", nick.c_str());
-
-		auto pinst = reinterpret_cast<Instrument*>(m_idtable[inst["id"].as<uintptr_t>()]);
-		if(!pinst)
-			continue;
-
-		for(size_t i=0; i<pinst->GetChannelCount(); i++)
-		{
-			auto chan = pinst->GetChannel(i);
-			auto key = "ch" + to_string(i);
-			auto channelNode = inst["channels"][key];
-
-			if(channelNode)
-				chan->LoadInputs(channelNode, m_idtable);
-		}
+		m_mainWindow->ShowErrorPopup(
+			"Filter creation failed",
+			string("Unable to create filter \"") + proto + "\". Skipping...\n");
 	}
 
 	return true;
@@ -2214,6 +1776,8 @@ bool Session::SerializeWaveforms(const string& dataDir)
 	//Metadata nodes for each scope
 	std::map<std::shared_ptr<Oscilloscope>, YAML::Node> metadataNodes;
 
+	bool compress = m_preferences.GetBool("Files.compress_waveforms");
+
 	//Serialize data from each history point
 	size_t numwfm = 0;
 	for(auto& hpoint : m_history.m_history)
@@ -2285,8 +1849,16 @@ bool Session::SerializeWaveforms(const string& dataDir)
 					auto uniform = dynamic_cast<UniformWaveformBase*>(data);
 					if(sparse)
 					{
-						chnode["format"] = "sparsev1";
-						SerializeSparseWaveform(sparse, datapath);
+						if(compress)
+						{
+							chnode["format"] = "compressedv1";
+							SerializeCompressedWaveform(sparse, datapath);
+						}
+						else
+						{
+							chnode["format"] = "sparsev1";
+							SerializeSparseWaveform(sparse, datapath);
+						}
 
 						//Save type if it's a protocol waveform
 						//so if we do an offline load, we know what type of waveform to make
@@ -2297,6 +1869,12 @@ bool Session::SerializeWaveforms(const string& dataDir)
 						else if(dynamic_cast<CANWaveform*>(sparse) != nullptr)
 							chnode["datatype"] = "can";
 					}
+					else if(compress)
+					{
+						chnode["format"] = "compressedv1";
+						chnode["uniform"] = true;
+						SerializeCompressedWaveform(uniform, datapath);
+					}
 					else
 					{
 						chnode["format"] = "densev1";
@@ -2387,7 +1965,13 @@ bool Session::SerializeWaveforms(const string& dataDir)
 			string datapath = datdir + "/stream" + to_string(j) + ".bin";
 			auto sparse = dynamic_cast<SparseWaveformBase*>(data);
 			auto uniform = dynamic_cast<UniformWaveformBase*>(data);
-			if(sparse)
+			if(compress)
+			{
+				chnode["format"] = "compressedv1";
+				chnode["uniform"] = (uniform != nullptr);
+				SerializeCompressedWaveform(data, datapath);
+			}
+			else if(sparse)
 			{
 				chnode["format"] = "sparsev1";
 				SerializeSparseWaveform(sparse, datapath);
@@ -2615,6 +2199,59 @@ bool Session::SerializeUniformWaveform(UniformWaveformBase* wfm, const string& p
 	return true;
 }
 
+/**
+	@brief Saves waveform sample data in the "compressedv1" file format.
+
+	See WaveformCodec for details of the format. Sparse waveforms are stored as offset, duration, and sample columns,
+	uniform waveforms as just the sample column.
+
+	CAN waveforms store each symbol as a (uint32 data, uint32 type) pair, as in sparsev1.
+ */
+bool Session::SerializeCompressedWaveform(WaveformBase* wfm, const string& path)
+{
+	vector<uint8_t> buf;
+
+	auto cchan = dynamic_cast<CANWaveform*>(wfm);
+	if(cchan)
+	{
+		cchan->PrepareForCpuAccess();
+		size_t len = cchan->size();
+		vector<uint32_t> syms(len*2);
+		for(size_t i=0; i<len; i++)
+		{
+			syms[i*2] = cchan->m_samples[i].m_data;
+			syms[i*2 + 1] = cchan->m_samples[i].m_stype;
+		}
+
+		vector<WaveformCodec::Column> cols =
+		{
+			WaveformCodec::Column(cchan->m_offsets.GetCpuPointer(), sizeof(int64_t), true),
+			WaveformCodec::Column(cchan->m_durations.GetCpuPointer(), sizeof(int64_t), true),
+			WaveformCodec::Column(syms.data(), 2*sizeof(uint32_t))
+		};
+		WaveformCodec::Compress(cols, len, buf);
+	}
+	else if(!WaveformCodec::CompressWaveform(wfm, buf))
+	{
+		//TODO: support other waveform types (buses, eyes, etc)
+		LogError("unrecognized sample type\n");
+		return false;
+	}
+
+	FILE* fp = fopen(path.c_str(), "wb");
+	if(!fp)
+		return false;
+	if(buf.size() != fwrite(buf.data(), 1, buf.size(), fp))
+	{
+		LogError("file write error\n");
+		fclose(fp);
+		return false;
+	}
+
+	fclose(fp);
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Trigger group management
 
@@ -3204,6 +2841,90 @@ void Session::DownloadWaveforms()
 		m_triggerArmed = false;
 }
 
+/**
+	@brief Hands off the acquisition the waveform thread just finished processing to the UI thread
+
+	This runs in the waveform thread, after filters have been run and waveforms rendered.
+
+	Pointers to the current waveforms are captured immediately, because the next call to DownloadWaveforms() will
+	detach them from their channels. This allows the waveform thread to begin downloading and processing the next
+	acquisition before the UI thread has gotten around to adding this one to history.
+ */
+void Session::QueueProcessedWaveforms()
+{
+	shared_lock<shared_mutex> lock(m_waveformDataMutex);
+	lock_guard<mutex> lock2(m_recentlyTriggeredScopeMutex);
+
+	vector<shared_ptr<Oscilloscope>> scopes(m_recentlyTriggeredScopes.begin(), m_recentlyTriggeredScopes.end());
+	m_recentlyTriggeredScopes.clear();
+
+	PendingHistoryPoint point;
+	point.m_snapshot = HistoryManager::CaptureSnapshot(scopes);
+	point.m_groups = m_recentlyTriggeredGroups;
+	m_recentlyTriggeredGroups.clear();
+
+	m_pendingHistory.push_back(point);
+}
+
+/**
+	@brief Check if the waveform thread has to wait for the UI thread before processing another acquisition
+
+	The number of acquisitions that may be processed ahead of the UI thread is set by the
+	"Drivers.General.pipeline_depth" preference. A depth of 1 is fully lock-step: the waveform thread does not
+	download trigger N+1 until the UI thread has consumed trigger N.
+ */
+bool Session::IsProcessingPipelineFull()
+{
+	lock_guard<mutex> lock(m_recentlyTriggeredScopeMutex);
+	return m_pendingHistory.size() >= m_pipelineDepth;
+}
+
+/**
+	@brief Reloads the pipeline depth from preferences
+
+	This runs in the main GUI thread, once per frame, so changes in the preferences dialog take effect immediately.
+ */
+void Session::UpdatePipelineDepth()
+{
+	size_t depth = max((int64_t)1, m_preferences.GetInt("Drivers.General.pipeline_depth"));
+	size_t oldDepth = m_pipelineDepth.exchange(depth);
+
+	//If the pipeline got deeper, the waveform thread may be able to run ahead again
+	if(depth > oldDepth)
+		g_waveformProcessedEvent.Signal();
+}
+
+/**
+	@brief Moves all acquisitions queued by QueueProcessedWaveforms() into history, oldest first
+
+	The waveform data mutex must be locked (shared is OK) by the caller.
+
+	The timestamp of each new history point is appended to m_newHistoryPoints.
+
+	@return Set of trigger groups which need to be re-armed once the caller is done with the new data
+ */
+set<shared_ptr<TriggerGroup>> Session::AddPendingHistory()
+{
+	set<shared_ptr<TriggerGroup>> groups;
+	deque<PendingHistoryPoint> pending;
+	{
+		lock_guard<mutex> lock(m_recentlyTriggeredScopeMutex);
+		pending.swap(m_pendingHistory);
+	}
+
+	for(auto& point : pending)
+	{
+		m_history.AddHistory(point.m_snapshot);
+		groups.insert(point.m_groups.begin(), point.m_groups.end());
+
+		//Skip duplicate timestamps, which AddHistory() ignores
+		auto t = m_history.GetMostRecentPoint();
+		if(m_newHistoryPoints.empty() || (m_newHistoryPoints.back() != t))
+			m_newHistoryPoints.push_back(t);
+	}
+	return groups;
+}
+
 /**
 	@brief Check if new waveform data has arrived
 
@@ -3211,30 +2932,25 @@ void Session::DownloadWaveforms()
 
 	TODO: this might be best to move to MainWindow?
 
-	@return True if a new waveform came in, false if not
+	@return True if a new waveform came in, false if not. Timestamps of the new waveforms are available from
+			GetNewHistoryPoints().
  */
 bool Session::CheckForWaveforms(vk::raii::CommandBuffer& cmdbuf)
 {
 	bool hadNewWaveforms = false;
+	m_newHistoryPoints.clear();
+
+	UpdatePipelineDepth();
 
 	if(g_waveformReadyEvent.Peek())
 	{
 		LogTrace("Waveform is ready\n");
 
-		//Add to history
-		vector<shared_ptr<Oscilloscope>> scopes;
+		//Add everything the waveform thread has finished with to history
 		set<shared_ptr<TriggerGroup>> groups;
 		{
-			shared_lock<shared_mutex> lock2(m_waveformDataMutex);
-			lock_guard<mutex> lock(m_recentlyTriggeredScopeMutex);
-			for(auto scope : m_recentlyTriggeredScopes)
-				scopes.push_back(scope);
-			m_recentlyTriggeredScopes.clear();
-
-			groups = m_recentlyTriggeredGroups;
-			m_recentlyTriggeredGroups.clear();
-
-			m_history.AddHistory(scopes);
+			shared_lock<shared_mutex> lock(m_waveformDataMutex);
+			groups = AddPendingHistory();
 		}
 
 		//Tone-map all of our waveforms
@@ -3247,7 +2963,7 @@ bool Session::CheckForWaveforms(vk::raii::CommandBuffer& cmdbuf)
 			m_mainWindow->ToneMapAllWaveforms(cmdbuf);
 		}
 
-		//Release the waveform processing thread
+		//Release the waveform processing thread if it was waiting for room in the pipeline
 		g_waveformProcessedEvent.Signal();
 
 		//In multi-scope free-run mode, re-arm every instrument's trigger after we've processed all data
@@ -3281,6 +2997,7 @@ size_t Session::GetFilterCount()
 void Session::RefreshAllFiltersNonblocking()
 {
 	g_refilterRequestedEvent.Signal();
+	g_waveformThreadWakeEvent.Signal();
 }
 
 /**
@@ -3297,6 +3014,7 @@ void Session::RefreshDirtyFiltersNonblocking()
 	}
 
 	g_partialRefilterRequestedEvent.Signal();
+	g_waveformThreadWakeEvent.Signal();
 }
 
 /**
@@ -3336,6 +3054,7 @@ void Session::RefreshAllFilters()
 		//shared_lock<shared_mutex> lock3(g_vulkanActivityMutex);
 		m_graphExecutor.RunBlocking(nodes);
 		UpdatePacketManagers(nodes);
+		UpdateWaveformPyramids(nodes);
 	}
 
 	m_lastFilterGraphExecTime = (GetTime() - tstart) * FS_PER_SECOND;
@@ -3392,6 +3111,7 @@ bool Session::RefreshDirtyFilters()
 		shared_lock<shared_mutex> lock3(g_vulkanActivityMutex);
 		m_graphExecutor.RunBlocking(nodesToUpdate);
 		UpdatePacketManagers(nodesToUpdate);
+		UpdateWaveformPyramids(nodesToUpdate);
 	}
 
 	m_lastFilterGraphExecTime = (GetTime() - tstart) * FS_PER_SECOND;
@@ -3429,6 +3149,37 @@ void Session::ClearSweeps()
 		f->ClearSweeps();
 }
 
+/**
+	@brief Builds the min/max pyramids of deep analog and digital waveforms as soon as they're produced
+
+	This runs in the waveform thread right after the filter graph, so the pyramids are ready before rendering and
+	stay attached to each waveform (including in history) until its next revision.
+
+	The waveform data mutex must be locked by the caller.
+ */
+void Session::UpdateWaveformPyramids(const set<FlowGraphNode*>& nodes)
+{
+	TraceSpan span("UpdateWaveformPyramids", "render");
+
+	for(auto node : nodes)
+	{
+		auto chan = dynamic_cast<InstrumentChannel*>(node);
+		if(!chan)
+			continue;
+
+		for(size_t i=0; i<chan->GetStreamCount(); i++)
+		{
+			auto type = chan->GetType(i);
+			if( (type != Stream::STREAM_TYPE_ANALOG) && (type != Stream::STREAM_TYPE_DIGITAL) )
+				continue;
+
+			auto data = chan->GetData(i);
+			if(data)
+				data->UpdatePyramid();
+		}
+	}
+}
+
 /**
 	@brief Update all of the packet managers when new data arrives
  */
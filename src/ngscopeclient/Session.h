@@ -104,6 +104,18 @@ public:
 	bool HasOnlineScopes();
 	void DownloadWaveforms();
 	bool CheckForWaveforms(vk::raii::CommandBuffer& cmdbuf);
+	void QueueProcessedWaveforms();
+
+	/**
+		@brief Gets the timestamps of every acquisition added to history by the last CheckForWaveforms() call
+
+		Several acquisitions may be added in one call if the waveform thread is running ahead of the UI.
+		They are returned oldest first.
+	 */
+	const std::vector<TimePoint>& GetNewHistoryPoints()
+	{ return m_newHistoryPoints; }
+
+	bool IsProcessingPipelineFull();
 	void RefreshAllFilters();
 	void RefreshAllFiltersNonblocking();
 	void RefreshDirtyFiltersNonblocking();
@@ -130,6 +142,7 @@ public:
 	bool SerializeWaveforms(const std::string& dataDir);
 	bool SerializeSparseWaveform(SparseWaveformBase* wfm, const std::string& path);
 	bool SerializeUniformWaveform(UniformWaveformBase* wfm, const std::string& path);
+	bool SerializeCompressedWaveform(WaveformBase* wfm, const std::string& path);
 
 	void AddMultimeterDialog(std::shared_ptr<SCPIMultimeter> meter);
 	std::shared_ptr<PacketManager> AddPacketFilter(PacketDecoder* filter);
@@ -342,6 +355,7 @@ public:
 
 protected:
 	void UpdatePacketManagers(const std::set<FlowGraphNode*>& nodes);
+	void UpdateWaveformPyramids(const std::set<FlowGraphNode*>& nodes);
 
 	std::string GetRegisteredTypeOfDriver(const std::string& drivername);
 
@@ -361,22 +375,10 @@ protected:
 	bool PreLoadLoad(int version, const YAML::Node& node, bool online);
 	bool PreLoadMisc(int version, const YAML::Node& node, bool online);
 	bool LoadFilters(int version, const YAML::Node& node);
-	bool LoadInstrumentInputs(int version, const YAML::Node& node);
 	bool LoadWaveformData(int version, const std::string& dataDir);
-	bool LoadWaveformDataForScope(
-		int version,
-		const YAML::Node& node,
+	void LoadWaveformDataForScope(
 		std::shared_ptr<Oscilloscope> scope,
-		const std::string& dataDir);
-	bool LoadWaveformDataForFilters(
-		int version,
-		const YAML::Node& node,
-		const std::string& dataDir);
-	void DoLoadWaveformDataForStream(
-		OscilloscopeChannel* chan,
-		int stream,
-		std::string format,
-		std::string fname);
+		std::vector<SavedWaveformLoader::SavedWaveform>& parsed);
 
 	///@brief Version of the file being loaded
 	int m_fileLoadVersion;
@@ -444,9 +446,40 @@ protected:
 	///@brief Groups whose data is currently being processed
 	std::set<std::shared_ptr<TriggerGroup>> m_recentlyTriggeredGroups;
 
-	///@brief Mutex to synchronize access to m_recentlyTriggeredScopes
+	/**
+		@brief An acquisition which has been processed by the waveform thread but not yet added to history
+	 */
+	class PendingHistoryPoint
+	{
+	public:
+		///@brief Waveforms from every scope that triggered
+		WaveformSnapshot m_snapshot;
+
+		///@brief Trigger groups to re-arm once the acquisition has been added to history
+		std::set<std::shared_ptr<TriggerGroup>> m_groups;
+	};
+
+	///@brief Acquisitions waiting for the UI thread, oldest first
+	std::deque<PendingHistoryPoint> m_pendingHistory;
+
+	///@brief Mutex to synchronize access to m_recentlyTriggeredScopes and m_pendingHistory
 	std::mutex m_recentlyTriggeredScopeMutex;
 
+	std::set<std::shared_ptr<TriggerGroup>> AddPendingHistory();
+
+	///@brief Timestamps of the acquisitions added to history by the last CheckForWaveforms() call (GUI thread only)
+	std::vector<TimePoint> m_newHistoryPoints;
+
+	/**
+		@brief Number of acquisitions the waveform thread may process ahead of the UI thread
+
+		Copied from the "Drivers.General.pipeline_depth" preference by the UI thread so the waveform thread doesn't
+		have to look it up (or race with the preferences dialog) every time it checks.
+	 */
+	std::atomic<size_t> m_pipelineDepth;
+
+	void UpdatePipelineDepth();
+
 	///@brief Time we last armed the global trigger
 	double m_tArm;
 
@@ -444,6 +444,8 @@ float VulkanWindow::GetContentScale()
 
 void VulkanWindow::Render()
 {
+	TraceSpan span("Frame", "render");
+
 	if(m_softwareResizeRequested)
 	{
 		m_softwareResizeRequested = false;
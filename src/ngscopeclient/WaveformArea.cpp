@@ -35,6 +35,7 @@
 #include "ngscopeclient.h"
 #include "WaveformArea.h"
 #include "MainWindow.h"
+#include "RasterizerSelection.h"
 #include "../../scopehal/TwoLevelTrigger.h"
 #include "../../scopeprotocols/ConstellationFilter.h"
 #include "../../scopeprotocols/EyePattern.h"
@@ -2029,6 +2030,22 @@ void WaveformArea::RenderWaveformTextures(
 	}
 }
 
+/**
+	@brief Calculates the average number of samples of a waveform per pixel column at the current zoom
+ */
+static float GetSamplesPerPixel(WaveformBase* data, double pixelsPerX)
+{
+	auto udata = dynamic_cast<UniformWaveformBase*>(data);
+	auto sdata = dynamic_cast<SparseWaveformBase*>(data);
+
+	auto end = data->size() - 1;
+	int64_t firstOff = GetOffsetScaled(sdata, udata, 0);
+	int64_t lastOff = GetOffsetScaled(sdata, udata, end);
+	float capture_len = lastOff - firstOff;
+	float avg_sample_len = capture_len / data->size();
+	return 1.0 / (pixelsPerX * avg_sample_len);
+}
+
 void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 	shared_ptr<DisplayedChannel> channel,
 	vk::raii::CommandBuffer& cmdbuf,
@@ -2059,59 +2076,81 @@ void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 
 	shared_ptr<ComputePipeline> comp;
 
+	//When zoomed far out, render from the coarsest min/max summary level that still has several points per pixel
+	//so that rendering cost scales with the display width rather than the memory depth.
+	//Fill-under and zero-hold rendering draw individual samples and can't use a min/max summary.
+	//The pyramid is built by Session right after the filter graph runs, if it's not current just use the raw data.
+	double pixelsPerX = m_group->GetPixelsPerXUnit();
+	auto pyramid = data->GetPyramid();
+	if(pyramid && !channel->ShouldFillUnder() && !channel->ZeroHoldFlagSet())
+	{
+		auto level = pyramid->GetLevelForSamplesPerPixel(GetSamplesPerPixel(data, pixelsPerX));
+		if(level)
+			data = level;
+	}
+
 	//Calculate a bunch of constants
 	int64_t offset = m_group->GetXAxisOffset();
 	int64_t innerxoff = offset / data->m_timescale;
 	int64_t fractional_offset = offset % data->m_timescale;
 	int64_t offset_samples = (offset - data->m_triggerPhase) / data->m_timescale;
-	double pixelsPerX = m_group->GetPixelsPerXUnit();
 	double xscale = data->m_timescale * pixelsPerX;
 
-	//Figure out which shader to use
-	auto udata = dynamic_cast<UniformWaveformBase*>(data);
+	//Figure out which shader to use (if we're not rendering on the CPU)
 	auto sdata = dynamic_cast<SparseWaveformBase*>(data);
 	auto uadata = dynamic_cast<UniformAnalogWaveform*>(data);
 	auto sadata = dynamic_cast<SparseAnalogWaveform*>(data);
 	auto uddata = dynamic_cast<UniformDigitalWaveform*>(data);
 	auto sddata = dynamic_cast<SparseDigitalWaveform*>(data);
-	if(uadata)
+	bool useCpu = ShouldUseCpuRasterizer(m_parent->GetSession().GetPreferences());
+	if(!useCpu)
 	{
-		if(channel->ShouldFillUnder())
-			comp = channel->GetHistogramPipeline();
-		else
-			comp = channel->GetUniformAnalogPipeline();
-	}
-	else if(uddata)
-		comp = channel->GetUniformDigitalPipeline();
-	else if(sadata)
-		comp = channel->GetSparseAnalogPipeline();
-	else if(sddata)
-		comp = channel->GetSparseDigitalPipeline();
-	if(!comp)
-	{
-		LogWarning("no pipeline found\n");
-		return;
+		if(uadata)
+		{
+			if(channel->ShouldFillUnder())
+				comp = channel->GetHistogramPipeline();
+			else
+				comp = channel->GetUniformAnalogPipeline();
+		}
+		else if(uddata)
+			comp = channel->GetUniformDigitalPipeline();
+		else if(sadata)
+			comp = channel->GetSparseAnalogPipeline();
+		else if(sddata)
+			comp = channel->GetSparseDigitalPipeline();
+		if(!comp)
+		{
+			LogWarning("no pipeline found\n");
+			return;
+		}
 	}
 
 	//Bind input buffers
-	if(uadata)
-		comp->BindBufferNonblocking(1, uadata->m_samples, cmdbuf);
-	if(uddata)
-		comp->BindBufferNonblocking(1, uddata->m_samples, cmdbuf);
-	if(sdata)
+	if(!useCpu)
 	{
+		if(uadata)
+			comp->BindBufferNonblocking(1, uadata->m_samples, cmdbuf);
+		if(uddata)
+			comp->BindBufferNonblocking(1, uddata->m_samples, cmdbuf);
 		if(sadata)
 			comp->BindBufferNonblocking(1, sadata->m_samples, cmdbuf);
 		if(sddata)
 			comp->BindBufferNonblocking(1, sddata->m_samples, cmdbuf);
 
 		//Map offsets and, if requested, durations
-		comp->BindBufferNonblocking(2, sdata->m_offsets, cmdbuf);
-		if(channel->ShouldMapDurations())
-			comp->BindBufferNonblocking(4, sdata->m_durations, cmdbuf);
-
+		if(sdata)
+		{
+			comp->BindBufferNonblocking(2, sdata->m_offsets, cmdbuf);
+			if(channel->ShouldMapDurations())
+				comp->BindBufferNonblocking(4, sdata->m_durations, cmdbuf);
+		}
+	}
+	if(sdata)
+	{
 		//Calculate indexes for X axis
+		//(index buffer may not have been allocated yet if we're drawing a pyramid level of a uniform waveform)
 		auto& ibuf = channel->GetIndexBuffer();
+		ibuf.resize(w);
 		ibuf.PrepareForCpuAccess();
 		sdata->m_offsets.PrepareForCpuAccess();
 		for(size_t i=0; i<w; i++)
@@ -2123,26 +2162,23 @@ void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 				target);
 		}
 		ibuf.MarkModifiedFromCpu();
-		comp->BindBufferNonblocking(3, ibuf, cmdbuf);
+		if(!useCpu)
+			comp->BindBufferNonblocking(3, ibuf, cmdbuf);
 	}
 
 	//Bind output texture and bail if there's nothing there
 	auto& imgOut = channel->GetRasterizedWaveform();
 	if(imgOut.empty())
 		return;
-	comp->BindBufferNonblocking(0, imgOut, cmdbuf);
+	if(!useCpu)
+		comp->BindBufferNonblocking(0, imgOut, cmdbuf);
 
 	//Scale alpha by zoom.
 	//As we zoom out more, reduce alpha to get proper intensity grading
 	//TODO: make this constant, then apply a second alpha pass in tone mapping?
 	//This will eliminate the need for a (potentially heavy) re-render when adjusting the slider.
 	float alpha = m_parent->GetTraceAlpha();
-	auto end = data->size() - 1;
-	int64_t firstOff = GetOffsetScaled(sdata, udata, 0);
-	int64_t lastOff = GetOffsetScaled(sdata, udata, end);
-	float capture_len = lastOff - firstOff;
-	float avg_sample_len = capture_len / data->size();
-	float samplesPerPixel = 1.0 / (pixelsPerX * avg_sample_len);
+	float samplesPerPixel = GetSamplesPerPixel(data, pixelsPerX);
 	float alpha_scaled = alpha / sqrt(samplesPerPixel);
 	alpha_scaled = min(1.0f, alpha_scaled) * 2;
 
@@ -2179,6 +2215,22 @@ void WaveformArea::RasterizeAnalogOrDigitalWaveform(
 	else
 		config.persistScale = 0;
 
+	//Software rendering path
+	if(useCpu)
+	{
+		imgOut.PrepareForCpuAccess();
+		data->PrepareForCpuAccess();
+		RasterizeWaveformCPU(
+			config,
+			data,
+			sdata ? channel->GetIndexBuffer().GetCpuPointer() : nullptr,
+			uadata && channel->ShouldFillUnder(),
+			channel->ZeroHoldFlagSet(),
+			imgOut.GetCpuPointer());
+		imgOut.MarkModifiedFromCpu();
+		return;
+	}
+
 	//Dispatch the shader
 	comp->Dispatch(cmdbuf, config, w, 1, 1);
 	comp->AddComputeMemoryBarrier(cmdbuf);
@@ -2272,7 +2324,13 @@ void WaveformArea::ToneMapWaterfallWaveform(std::shared_ptr<DisplayedChannel> ch
 	double pixelsPerX = m_group->GetPixelsPerXUnit();
 	double xscale = data->m_timescale * pixelsPerX;
 
-	WaterfallToneMapArgs args(width, height, m_width, m_height, offset_samples, xscale );
+	//Waterfalls are stored as a ring buffer of lines, other density plots aren't
+	uint32_t rowOffset = 0;
+	auto wdata = dynamic_cast<WaterfallWaveform*>(data);
+	if(wdata)
+		rowOffset = wdata->GetRowOffset();
+
+	WaterfallToneMapArgs args(width, height, m_width, m_height, offset_samples, xscale, rowOffset);
 	pipe->Dispatch(cmdbuf, args, GetComputeBlockCount(m_width, 64), m_height);
 
 	//Add a barrier before we read from the fragment shader
@@ -87,13 +87,14 @@ public:
 class WaterfallToneMapArgs
 {
 public:
-	WaterfallToneMapArgs(uint32_t w, uint32_t h, uint32_t outwidth, uint32_t outheight, uint32_t o, float x)
+	WaterfallToneMapArgs(uint32_t w, uint32_t h, uint32_t outwidth, uint32_t outheight, uint32_t o, float x, uint32_t r)
 	: m_width(w)
 	, m_height(h)
 	, m_outwidth(outwidth)
 	, m_outheight(outheight)
 	, m_offsetSamples(o)
 	, m_xscale(x)
+	, m_rowOffset(r)
 	{}
 
 	uint32_t m_width;
@@ -102,6 +103,7 @@ public:
 	uint32_t m_outheight;
 	uint32_t m_offsetSamples;
 	float m_xscale;
+	uint32_t m_rowOffset;
 };
 
 class SpectrogramToneMapArgs
@@ -129,22 +131,6 @@ public:
 	float m_yscale;
 };
 
-struct ConfigPushConstants
-{
-	int64_t innerXoff;
-	uint32_t windowHeight;
-	uint32_t windowWidth;
-	uint32_t memDepth;
-	uint32_t offset_samples;
-	float alpha;
-	float xoff;
-	float xscale;
-	float ybase;
-	float yscale;
-	float yoff;
-	float persistScale;
-};
-
 /**
 	@brief State for a single peak label
 
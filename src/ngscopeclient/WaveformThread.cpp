@@ -49,6 +49,9 @@ Event g_refilterDoneEvent;
 Event g_waveformReadyEvent;
 Event g_waveformProcessedEvent;
 
+///@brief Signaled whenever there may be new work for the waveform thread (new data, refilter/rerender requests)
+Event g_waveformThreadWakeEvent;
+
 ///@brief Time spent on the last cycle of waveform rendering shaders
 atomic<int64_t> g_lastWaveformRenderTime;
 
@@ -122,10 +125,12 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 			continue;
 		}
 
-		//Wait for data to be available from all scopes
+		//Wait for data to be available from all scopes.
+		//Instrument threads wake us as soon as they have a waveform, the timeout is just a fallback for anything
+		//that produces data or requests work without signaling us.
 		if(!session->CheckForPendingWaveforms())
 		{
-			this_thread::sleep_for(chrono::milliseconds(1));
+			g_waveformThreadWakeEvent.Block(chrono::milliseconds(5));
 			continue;
 		}
 
@@ -136,9 +141,12 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 		//Rerun the heavyweight rendering shaders
 		RenderAllWaveforms(cmdbuf, session, queue);
 
-		//Unblock the UI threads, then wait for acknowledgement that it's processed
+		//Hand the processed waveforms off to the UI thread, then unblock it.
+		//Only wait for acknowledgement if it has fallen too far behind, otherwise go straight on to the next trigger
+		session->QueueProcessedWaveforms();
 		g_waveformReadyEvent.Signal();
-		g_waveformProcessedEvent.Block();
+		while(!*shuttingDown && session->IsProcessingPipelineFull())
+			g_waveformProcessedEvent.Block();
 	}
 
 	LogTrace("Shutting down\n");
@@ -147,6 +155,7 @@ void WaveformThread(Session* session, atomic<bool>* shuttingDown)
 void RenderAllWaveforms(vk::raii::CommandBuffer& cmdbuf, Session* session, shared_ptr<QueueHandle> queue)
 {
 	double tstart = GetTime();
+	TraceSpan span("RenderAllWaveforms", "render");
 
 	//Must lock mutexes in this order to avoid deadlock
 	shared_lock<shared_mutex> lock1(session->GetWaveformDataMutex());
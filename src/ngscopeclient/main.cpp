@@ -52,6 +52,7 @@ int main(int argc, char* argv[])
 {
 	//Global settings
 	Severity console_verbosity = Severity::NOTICE;
+	string tracePath;
 
 	for(int i=1; i<argc; i++)
 	{
@@ -61,6 +62,11 @@ int main(int argc, char* argv[])
 		if(ParseLoggerArguments(i, argc, argv, console_verbosity))
 			continue;
 
+		//Record a timeline trace for the whole run, and write it on exit
+		//(not --trace, the logger already uses that for its debug message filter)
+		if( (s == "--trace-file") && (i+1 < argc) )
+			tracePath = argv[++i];
+
 		//TODO: other arguments
 
 	}
@@ -106,6 +112,10 @@ int main(int argc, char* argv[])
 	Unit::SetDefaultLocale();
 	#endif
 
+	TraceRecorder::SetThreadName("GUI");
+	if(!tracePath.empty())
+		TraceRecorder::Enable();
+
 	//Initialize object creation tables for predefined libraries
 	if(!VulkanInit())
 		return 1;
@@ -138,6 +148,11 @@ int main(int argc, char* argv[])
 
 	//Done, clean up
 	g_mainWindow = nullptr;
+	if(!tracePath.empty())
+	{
+		TraceRecorder::Disable();
+		TraceRecorder::WriteChromeTrace(tracePath);
+	}
 	ScopehalStaticCleanup();
 	return 0;
 }
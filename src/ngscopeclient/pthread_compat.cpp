@@ -32,6 +32,7 @@
 #endif
 
 #include "pthread_compat.h"
+#include "../scopehal/TraceRecorder.h"
 
 void pthread_setname_np_compat(const char *name)
 {
@@ -44,4 +45,6 @@ void pthread_setname_np_compat(const char *name)
 		pthread_setname_np(name);
 	#endif
 #endif
+
+	TraceRecorder::SetThreadName(name);
 }
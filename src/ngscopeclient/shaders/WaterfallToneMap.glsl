@@ -47,6 +47,7 @@ layout(std430, push_constant) uniform constants
 	uint outheight;
 	uint offset_samples;
 	float xscale;
+	uint rowOffset;
 };
 
 layout(local_size_x=64, local_size_y=1, local_size_z=1) in;
@@ -61,6 +62,9 @@ void main()
 	//Move the entire output display down if needed, so topmost (newest) row is always visible
 	uint yreal = gl_GlobalInvocationID.y + (height - outheight);
 
+	//Rows are stored as a ring buffer, find where this one actually lives
+	yreal = (yreal + rowOffset) % height;
+
 	//Figure out which input pixel(s) contribute to this output pixel
 	uint istart = uint(floor(gl_GlobalInvocationID.x / xscale)) + offset_samples;
 	uint iend = uint(floor((gl_GlobalInvocationID.x + 1) / xscale)) + offset_samples;
@@ -293,6 +293,49 @@ TEST_CASE("Buffers_CpuGpu")
 		REQUIRE(buf.size() == 0);
 		REQUIRE(buf.empty());
 	}
+
+	//Fixed depth history: every new item at the end pushes the oldest one out at the front
+	SECTION("SlidingWindow")
+	{
+		LogVerbose("AcceleratorBuffer: push_back / pop_front sliding window\n");
+		LogIndenter li;
+
+		buf.SetCpuAccessHint(AcceleratorBuffer<int32_t>::HINT_LIKELY);
+		buf.SetGpuAccessHint(AcceleratorBuffer<int32_t>::HINT_LIKELY);
+
+		const size_t depth = 1000;
+		const size_t niter = 100*depth + depth/2;
+		FillBuffer(buf, depth);
+
+		//pop_front() should only skip over the removed item. Count the iterations where the content moved instead.
+		size_t nmoves = 0;
+		for(size_t i=0; i<niter; i++)
+		{
+			auto p = buf.GetCpuPointer();
+			buf.push_back(depth + i);
+			buf.pop_front();
+			if(buf.GetCpuPointer() != p+1)
+				nmoves ++;
+		}
+		LogVerbose("Content moved %zu times in %zu iterations\n", nmoves, niter);
+
+		//One reallocation to make room, then one move every time depth items have been skipped
+		REQUIRE(nmoves <= (niter / depth) + 2);
+
+		REQUIRE(buf.size() == depth);
+		for(size_t i=0; i<depth; i++)
+			REQUIRE(buf[i] == (int32_t)(niter + i));
+
+		//The GPU must see the content from the start of its buffer, round trip it through a GPU-only buffer
+		buf.PrepareForGpuAccess();
+		buf.SetCpuAccessHint(AcceleratorBuffer<int32_t>::HINT_NEVER, true);
+		buf.SetCpuAccessHint(AcceleratorBuffer<int32_t>::HINT_LIKELY, true);
+		buf.PrepareForCpuAccess();
+
+		REQUIRE(buf.size() == depth);
+		for(size_t i=0; i<depth; i++)
+			REQUIRE(buf[i] == (int32_t)(niter + i));
+	}
 }
 
 void FillBuffer(AcceleratorBuffer<int32_t>& buf, size_t len)
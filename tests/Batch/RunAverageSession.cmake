@@ -0,0 +1,27 @@
+# Runs ngscopebatch on data/average.scopesession and checks the output.
+#
+# The session has a single analog channel feeding an Average filter, with two saved waveforms:
+#   1700000000: 16 samples of 0.5
+#   1700000001: 0.25 and 2.75 alternating, 16 samples
+# --jobs 1 so the cumulative average sees both waveforms in order.
+
+execute_process(
+	COMMAND ${NGSCOPEBATCH} --jobs 1 --measurements ${OUTPUT} ${SESSION}
+	RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "ngscopebatch failed (${result})")
+endif()
+
+file(READ ${OUTPUT} csv)
+foreach(expected
+	"session,timestamp,filter,stream,value,unit\n"
+	",1700000000.000000000000000,Average1,latest,0.5,V\n"
+	",1700000000.000000000000000,Average1,cumulative,0.5,V\n"
+	",1700000001.000000000000000,Average1,latest,1.5,V\n"
+	",1700000001.000000000000000,Average1,cumulative,1,V\n"
+	",1700000001.000000000000000,Average1,totalSamples,32,")
+	string(FIND "${csv}" "${expected}" pos)
+	if(pos EQUAL -1)
+		message(FATAL_ERROR "Missing \"${expected}\" in output:\n${csv}")
+	endif()
+endforeach()
@@ -0,0 +1,178 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for BIN import filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+/**
+	@brief Appends a single buffer waveform to a BIN file being built in memory
+
+	@param buf		File content
+	@param label	Waveform label
+	@param digital	True for an 8-bit logic waveform, false for a float analog waveform
+	@param samples	Number of samples claimed by the headers
+	@param data		Sample data actually written (may be shorter than the headers claim, to make a truncated file)
+ */
+static void AppendWaveform(vector<uint8_t>& buf, const string& label, bool digital, size_t samples, const vector<uint8_t>& data)
+{
+	size_t width = digital ? 1 : sizeof(float);
+
+	BINImportFilter::WaveHeader wh;
+	memset(&wh, 0, sizeof(wh));
+	wh.size = sizeof(wh);
+	wh.type = digital ? 6 : 1;
+	wh.buffers = 1;
+	wh.samples = samples;
+	wh.interval = 1e-9;
+	memcpy(wh.hardware, "MSO9254A:MY12345678", 19);
+	strncpy(wh.label, label.c_str(), sizeof(wh.label));
+
+	BINImportFilter::DataHeader dh;
+	memset(&dh, 0, sizeof(dh));
+	dh.size = sizeof(dh);
+	dh.type = digital ? 6 : 1;
+	dh.depth = width;
+	dh.length = samples * width;
+
+	auto p = reinterpret_cast<const uint8_t*>(&wh);
+	buf.insert(buf.end(), p, p + sizeof(wh));
+	p = reinterpret_cast<const uint8_t*>(&dh);
+	buf.insert(buf.end(), p, p + sizeof(dh));
+	buf.insert(buf.end(), data.begin(), data.end());
+}
+
+/**
+	@brief Writes a BIN file and imports it
+ */
+static BINImportFilter* ImportBIN(const string& path, const vector<uint8_t>& buf, size_t count)
+{
+	BINImportFilter::FileHeader fh;
+	memcpy(fh.magic, "AG", 2);
+	memcpy(fh.version, "10", 2);
+	fh.length = sizeof(fh) + buf.size();
+	fh.count = count;
+
+	FILE* fp = fopen(path.c_str(), "wb");
+	REQUIRE(fp != nullptr);
+	fwrite(&fh, sizeof(fh), 1, fp);
+	fwrite(buf.data(), 1, buf.size(), fp);
+	fclose(fp);
+
+	//The filter holds a reference to itself
+	auto filter = new BINImportFilter("#ffffff");
+	filter->GetParameter("BIN File").SetFileName(path);
+	return filter;
+}
+
+TEST_CASE("Filter_BINImport")
+{
+	const size_t depth = 100000;
+	string path = "binimport-test.bin";
+
+	//Random analog and logic waveforms
+	vector<float> analog(depth);
+	auto vdist = uniform_real_distribution<float>(-1, 1);
+	for(auto& v : analog)
+		v = vdist(g_rng);
+	vector<uint8_t> analogBytes(depth * sizeof(float));
+	memcpy(analogBytes.data(), analog.data(), analogBytes.size());
+
+	vector<uint8_t> logic(depth);
+	auto bdist = uniform_int_distribution<int>(0, 255);
+	for(auto& b : logic)
+		b = bdist(g_rng);
+
+	SECTION("Truncated sample buffer")
+	{
+		//The last waveform claims more samples than are in the file
+		vector<uint8_t> buf;
+		AppendWaveform(buf, "CH1", false, depth, analogBytes);
+		AppendWaveform(buf, "LA", true, depth, logic);
+		AppendWaveform(buf, "CH2", false, depth,
+			vector<uint8_t>(analogBytes.begin(), analogBytes.begin() + analogBytes.size()/2));
+
+		//The complete waveforms should be imported intact, and the truncated one dropped
+		auto filter = ImportBIN(path, buf, 3);
+		REQUIRE(filter->GetStreamCount() == 9);
+
+		REQUIRE(filter->GetStreamName(0) == "CH1");
+		auto wfm = dynamic_cast<UniformAnalogWaveform*>(filter->GetData(0));
+		REQUIRE(wfm != nullptr);
+		wfm->PrepareForCpuAccess();
+		REQUIRE(wfm->size() == depth);
+		REQUIRE(wfm->m_timescale == 1000000);
+		for(size_t i=0; i<depth; i++)
+			REQUIRE(wfm->m_samples[i] == analog[i]);
+
+		for(size_t j=0; j<8; j++)
+		{
+			REQUIRE(filter->GetStreamName(j+1) == string("LA[") + to_string(j) + "]");
+			auto dwfm = dynamic_cast<UniformDigitalWaveform*>(filter->GetData(j+1));
+			REQUIRE(dwfm != nullptr);
+			dwfm->PrepareForCpuAccess();
+			REQUIRE(dwfm->size() == depth);
+			for(size_t i=0; i<depth; i++)
+				REQUIRE(dwfm->m_samples[i] == ( (logic[i] >> j) & 1) );
+		}
+
+		filter->Release();
+	}
+
+	SECTION("Truncated header")
+	{
+		//File ends partway through the second waveform's header
+		vector<uint8_t> buf;
+		AppendWaveform(buf, "CH1", false, depth, analogBytes);
+		AppendWaveform(buf, "CH2", false, depth, analogBytes);
+		buf.resize(buf.size() - analogBytes.size() - sizeof(BINImportFilter::DataHeader) - 8);
+
+		auto filter = ImportBIN(path, buf, 2);
+		REQUIRE(filter->GetStreamCount() == 1);
+		REQUIRE(filter->GetStreamName(0) == "CH1");
+		REQUIRE(filter->GetData(0)->size() == depth);
+
+		filter->Release();
+	}
+
+	remove(path.c_str());
+}
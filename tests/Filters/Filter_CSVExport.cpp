@@ -0,0 +1,212 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for CSV export filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+/**
+	@brief CSV export filter with a copy of the original stdio based export loop, used as the golden reference
+ */
+class CSVExportReference : public CSVExportFilter
+{
+public:
+	CSVExportReference()
+		: CSVExportFilter("#ffffff")
+	{}
+
+	void ExportWithWriter()
+	{
+		Export();
+		m_writer.Close();
+	}
+
+	void ExportWithStdio(const string& path)
+	{
+		FILE* fp = fopen(path.c_str(), "wb");
+		REQUIRE(fp != nullptr);
+
+		fprintf(fp, "Time (s)");
+		for(size_t i=0; i<GetInputCount(); i++)
+			fprintf(fp, ",%s", str_replace(",", "_", GetInput(i).GetName()).c_str());
+		fprintf(fp, "\n");
+
+		vector<SparseWaveformBase*> sparse;
+		vector<UniformWaveformBase*> uniform;
+		vector<SparseAnalogWaveform*> sa;
+		vector<UniformAnalogWaveform*> ua;
+		vector<SparseDigitalWaveform*> sd;
+		vector<UniformDigitalWaveform*> ud;
+		vector<size_t> indexes;
+		vector<size_t> lens;
+		for(size_t i=0; i<GetInputCount(); i++)
+		{
+			auto data = GetInput(i).GetData();
+			sparse.push_back(dynamic_cast<SparseWaveformBase*>(data));
+			uniform.push_back(dynamic_cast<UniformWaveformBase*>(data));
+			sa.push_back(dynamic_cast<SparseAnalogWaveform*>(data));
+			ua.push_back(dynamic_cast<UniformAnalogWaveform*>(data));
+			sd.push_back(dynamic_cast<SparseDigitalWaveform*>(data));
+			ud.push_back(dynamic_cast<UniformDigitalWaveform*>(data));
+			indexes.push_back(0);
+			lens.push_back(data->size());
+		}
+
+		int64_t timestamp = INT64_MIN;
+		bool first = true;
+		while(true)
+		{
+			int64_t next = INT64_MAX;
+			for(size_t i=0; i<GetInputCount(); i++)
+				next = min(next, GetNextEventTimestampScaled(sparse[i], uniform[i], indexes[i], lens[i], timestamp));
+			if( (next == INT64_MAX) || (next == timestamp) )
+				break;
+
+			if(!first)
+			{
+				fprintf(fp, "%.10e", timestamp / FS_PER_SECOND);
+				for(size_t i=0; i<GetInputCount(); i++)
+				{
+					if(GetInput(i).GetType() == Stream::STREAM_TYPE_ANALOG)
+						fprintf(fp, ",%f", GetValue(sa[i], ua[i], indexes[i]));
+					else
+						fprintf(fp, ",%d", GetValue(sd[i], ud[i], indexes[i]));
+				}
+				fprintf(fp, "\n");
+			}
+			first = false;
+
+			timestamp = next;
+			for(size_t i=0; i<GetInputCount(); i++)
+				AdvanceToTimestampScaled(sparse[i], uniform[i], indexes[i], lens[i], timestamp);
+		}
+
+		fclose(fp);
+	}
+};
+
+TEST_CASE("Filter_CSVExport")
+{
+	//Deep enough to span several formatting batches
+	const size_t depth = 600000;
+
+	//Uniform analog input with values spanning many orders of magnitude
+	UniformAnalogWaveform ua;
+	ua.m_timescale = 20000;
+	ua.m_triggerPhase = 0;
+	FillRandomWaveform(&ua, depth);
+	ua.PrepareForCpuAccess();
+	auto edist = uniform_real_distribution<float>(-12, 6);
+	for(size_t i=0; i<depth; i += 7)
+		ua.m_samples[i] *= powf(10, edist(g_rng));
+	ua.MarkModifiedFromCpu();
+
+	//Sparse analog input on a different timebase
+	SparseAnalogWaveform sa;
+	sa.m_timescale = 1000;
+	sa.m_triggerPhase = 500;
+	sa.PrepareForCpuAccess();
+	sa.Resize(depth / 3);
+	auto gapdist = uniform_int_distribution<int64_t>(1, 100);
+	auto vdist = uniform_real_distribution<float>(-100, 100);
+	int64_t t = 0;
+	for(size_t i=0; i<sa.size(); i++)
+	{
+		sa.m_offsets[i] = t;
+		sa.m_durations[i] = gapdist(g_rng);
+		sa.m_samples[i] = vdist(g_rng);
+		t += sa.m_durations[i];
+	}
+	sa.MarkModifiedFromCpu();
+
+	//Uniform digital input
+	UniformDigitalWaveform ud;
+	ud.m_timescale = 50000;
+	ud.m_triggerPhase = 0;
+	ud.PrepareForCpuAccess();
+	ud.Resize(depth / 2);
+	auto bdist = uniform_int_distribution<int>(0, 1);
+	for(size_t i=0; i<ud.size(); i++)
+		ud.m_samples[i] = bdist(g_rng);
+	ud.MarkModifiedFromCpu();
+
+	g_scope->GetOscilloscopeChannel(0)->SetData(&ua, 0);
+	g_scope->GetOscilloscopeChannel(1)->SetData(&sa, 0);
+	g_scope->GetOscilloscopeChannel(4)->SetData(&ud, 0);
+
+	//The filter holds a reference to itself
+	auto filter = new CSVExportReference;
+	filter->GetParameter("Columns").SetIntVal(3);
+	filter->SetInput(0, g_scope->GetOscilloscopeChannel(0));
+	filter->SetInput(1, g_scope->GetOscilloscopeChannel(1));
+	filter->SetInput(2, g_scope->GetOscilloscopeChannel(4));
+
+	string goldenPath = "csvexport-golden.csv";
+	string outPath = "csvexport-out.csv";
+	filter->GetParameter("File name").SetFileName(outPath);
+
+	double start = GetTime();
+	filter->ExportWithStdio(goldenPath);
+	double tgolden = GetTime() - start;
+
+	start = GetTime();
+	filter->ExportWithWriter();
+	double tout = GetTime() - start;
+
+	LogVerbose("stdio export: %.2f ms\n", tgolden * 1000);
+	LogVerbose("ExportWriter: %.2f ms (%.2fx speedup)\n", tout * 1000, tgolden / tout);
+
+	auto golden = ReadFile(goldenPath);
+	auto out = ReadFile(outPath);
+	LogVerbose("Output: %zu bytes\n", out.size());
+	REQUIRE(golden.size() > depth * 10);
+	REQUIRE(out == golden);
+
+	remove(goldenPath.c_str());
+	remove(outPath.c_str());
+
+	g_scope->GetOscilloscopeChannel(0)->Detach(0);
+	g_scope->GetOscilloscopeChannel(1)->Detach(0);
+	g_scope->GetOscilloscopeChannel(4)->Detach(0);
+
+	filter->Release();
+}
@@ -0,0 +1,133 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for CSV import filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+TEST_CASE("Filter_CSVImport")
+{
+	//Deep enough to be split into several blocks
+	const size_t depth = 200000;
+	const size_t badLine = depth - 1000;
+
+	string path = "csvimport-test.csv";
+	FILE* fp = fopen(path.c_str(), "wb");
+	REQUIRE(fp != nullptr);
+
+	//Irregular timebase so the output stays sparse
+	vector<int64_t> timestamps;
+	vector<float> analog;
+	vector<bool> digital;
+	auto gapdist = uniform_int_distribution<int64_t>(1, 100);
+	auto vdist = uniform_real_distribution<float>(-100, 100);
+	auto bdist = uniform_int_distribution<int>(0, 1);
+	int64_t t = 0;
+	fprintf(fp, "# Generated by Filter_CSVImport\n");
+	fprintf(fp, "Time (s),Voltage,Enable\n");
+	for(size_t i=0; i<depth; i++)
+	{
+		//Malformed line, everything after this should be ignored
+		if(i == badLine)
+		{
+			fprintf(fp, "1.0,2.0\n");
+			break;
+		}
+
+		//Comments in the middle of the data should be skipped
+		if( (i % 50000) == 1234)
+			fprintf(fp, "#comment\n");
+
+		t += gapdist(g_rng) * 1000;
+		char stime[64];
+		char svalue[64];
+		snprintf(stime, sizeof(stime), "%.10e", t / FS_PER_SECOND);
+		snprintf(svalue, sizeof(svalue), "%f", vdist(g_rng));
+		bool b = bdist(g_rng);
+		fprintf(fp, "%s,%s,%d\n", stime, svalue, b);
+
+		timestamps.push_back(static_cast<int64_t>(FS_PER_SECOND * strtod(stime, nullptr)));
+		analog.push_back(strtof(svalue, nullptr));
+		digital.push_back(b);
+	}
+	fclose(fp);
+
+	//The filter holds a reference to itself
+	auto filter = new CSVImportFilter("#ffffff");
+	double start = GetTime();
+	filter->GetParameter("CSV File").SetFileName(path);
+	double dt = GetTime() - start;
+	LogVerbose("Imported %zu lines in %.2f ms\n", timestamps.size(), dt * 1000);
+
+	REQUIRE(filter->GetStreamCount() == 2);
+	REQUIRE(filter->GetStreamName(0) == "Voltage");
+	REQUIRE(filter->GetStreamName(1) == "Enable");
+	REQUIRE(filter->GetType(0) == Stream::STREAM_TYPE_ANALOG);
+	REQUIRE(filter->GetType(1) == Stream::STREAM_TYPE_DIGITAL);
+
+	auto sa = dynamic_cast<SparseAnalogWaveform*>(filter->GetData(0));
+	auto sd = dynamic_cast<SparseDigitalWaveform*>(filter->GetData(1));
+	REQUIRE(sa != nullptr);
+	REQUIRE(sd != nullptr);
+	sa->PrepareForCpuAccess();
+	sd->PrepareForCpuAccess();
+
+	size_t len = timestamps.size();
+	REQUIRE(len == badLine);
+	REQUIRE(sa->size() == len);
+	REQUIRE(sd->size() == len);
+	for(size_t i=0; i<len; i++)
+	{
+		int64_t duration = (i+1 < len) ? (timestamps[i+1] - timestamps[i]) : (timestamps[i] - timestamps[i-1]);
+
+		REQUIRE(sa->m_offsets[i] == timestamps[i]);
+		REQUIRE(sa->m_durations[i] == duration);
+		REQUIRE(sa->m_samples[i] == analog[i]);
+
+		REQUIRE(sd->m_offsets[i] == timestamps[i]);
+		REQUIRE(sd->m_durations[i] == duration);
+		REQUIRE(sd->m_samples[i] == digital[i]);
+	}
+
+	remove(path.c_str());
+	filter->Release();
+}
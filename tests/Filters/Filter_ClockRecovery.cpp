@@ -0,0 +1,139 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Unit test for ClockRecoveryFilter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopehal/TestWaveformSource.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+#include <algorithm>
+
+using namespace std;
+
+TEST_CASE("Filter_ClockRecovery")
+{
+	TestWaveformSource source(g_rng);
+	auto filter = dynamic_cast<ClockRecoveryFilter*>(Filter::CreateFilter("Clock Recovery (PLL)", "#ffffff"));
+	REQUIRE(filter != nullptr);
+	filter->AddRef();
+
+	//Create a queue and command buffer
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("Filter_ClockRecovery.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdBuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//Generate the input signal: 1.25 Gbps PRBS-31, 50 Gsps, 8M points (about 200K UIs)
+	const int64_t uiWidth = 800000;
+	UniformAnalogWaveform data;
+	source.GeneratePRBS31(cmdBuf, queue, &data, 0.4, uiWidth, 20000, 8000000);
+	data.m_triggerPhase = 0;
+	g_scope->GetOscilloscopeChannel(0)->SetData(&data, 0);
+
+	filter->SetInput("IN", StreamDescriptor(g_scope->GetOscilloscopeChannel(0), 0));
+	filter->GetParameter("Symbol rate").SetFloatVal(FS_PER_SECOND / uiWidth);
+	filter->GetParameter("Lock-in Warmup").SetIntVal(1024);
+
+	//Run the baseline serial PLL and save the output
+	filter->GetParameter("Parallel PLL").SetBoolVal(false);
+	double start = GetTime();
+	filter->Refresh(cmdBuf, queue);
+	double tserial = GetTime() - start;
+
+	auto serialWfm = dynamic_cast<SparseDigitalWaveform*>(filter->GetData(0));
+	REQUIRE(serialWfm != nullptr);
+	serialWfm->PrepareForCpuAccess();
+	vector<int64_t> serial;
+	for(size_t i=0; i<serialWfm->size(); i++)
+		serial.push_back(serialWfm->m_offsets[i]);
+
+	//Run the parallel PLL
+	filter->GetParameter("Parallel PLL").SetBoolVal(true);
+	start = GetTime();
+	filter->Refresh(cmdBuf, queue);
+	double tparallel = GetTime() - start;
+
+	auto parallelWfm = dynamic_cast<SparseDigitalWaveform*>(filter->GetData(0));
+	REQUIRE(parallelWfm != nullptr);
+	parallelWfm->PrepareForCpuAccess();
+	size_t len = parallelWfm->size();
+
+	LogVerbose("Serial:   %zu edges, %.2f ms\n", serial.size(), tserial * 1000);
+	LogVerbose("Parallel: %zu edges, %.2f ms\n", len, tparallel * 1000);
+	LogVerbose("Stitch failures: %zu\n", filter->GetStitchFailures());
+
+	//Both PLLs should have locked at every segment boundary and recovered the same number of UIs (+/- a few)
+	REQUIRE(filter->GetStitchFailures() == 0);
+	REQUIRE(len + 16 >= serial.size());
+	REQUIRE(len <= serial.size() + 16);
+
+	//Data and durations must be consistent
+	REQUIRE(parallelWfm->m_durations.size() == len);
+	REQUIRE(parallelWfm->m_samples.size() == len);
+
+	//Edges must be monotonic, and after the serial PLL has had time to lock,
+	//each edge should be close to the corresponding serial clock edge
+	int64_t tlock = serial[min(serial.size()-1, (size_t)2048)];
+	int64_t maxerr = 0;
+	for(size_t i=1; i<len; i++)
+	{
+		int64_t t = parallelWfm->m_offsets[i];
+		REQUIRE(t > parallelWfm->m_offsets[i-1]);
+
+		if(t < tlock)
+			continue;
+
+		auto it = lower_bound(serial.begin(), serial.end(), t);
+		int64_t err = INT64_MAX;
+		if(it != serial.end())
+			err = min(err, i64abs(*it - t));
+		if(it != serial.begin())
+			err = min(err, i64abs(*(it-1) - t));
+		maxerr = max(maxerr, err);
+	}
+	LogVerbose("Max phase error vs serial: %s\n", Unit(Unit::UNIT_FS).PrettyPrint(maxerr).c_str());
+	REQUIRE(maxerr < uiWidth / 8);
+
+	g_scope->GetOscilloscopeChannel(0)->Detach(0);
+
+	filter->Release();
+}
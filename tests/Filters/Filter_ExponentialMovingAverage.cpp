@@ -0,0 +1,240 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for ExponentialMovingAverage filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+/**
+	@brief Fills a sparse waveform with random samples at irregular offsets
+ */
+static void FillRandomSparseWaveform(SparseAnalogWaveform* wfm, size_t size)
+{
+	auto rdist = uniform_real_distribution<float>(-1, 1);
+	auto gapdist = uniform_int_distribution<int64_t>(1, 5);
+
+	wfm->PrepareForCpuAccess();
+	wfm->Resize(size);
+
+	int64_t offset = 0;
+	for(size_t i=0; i<size; i++)
+	{
+		int64_t gap = gapdist(g_rng);
+		wfm->m_samples[i] = rdist(g_rng);
+		wfm->m_offsets[i] = offset;
+		wfm->m_durations[i] = gap;
+		offset += gap;
+	}
+
+	wfm->MarkModifiedFromCpu();
+
+	wfm->m_revision ++;
+	if(wfm->m_timescale == 0)
+		wfm->m_timescale = 1000;
+}
+
+/**
+	@brief Checks the filter output against the expected average, and that it's the right kind of waveform
+ */
+template<class T>
+static void VerifyEMAResult(const vector<float>& golden, Filter* filter)
+{
+	auto wfm = dynamic_cast<T*>(filter->GetData(0));
+	REQUIRE(wfm != nullptr);
+	REQUIRE(wfm->size() == golden.size());
+
+	wfm->PrepareForCpuAccess();
+	for(size_t i=0; i<golden.size(); i++)
+		REQUIRE(fabs(wfm->m_samples[i] - golden[i]) < 1e-6);
+}
+
+/**
+	@brief Checks that a sparse output has the timestamps of the input it was computed from
+ */
+static void VerifySparseTimestamps(SparseAnalogWaveform* din, Filter* filter)
+{
+	auto wfm = dynamic_cast<SparseAnalogWaveform*>(filter->GetData(0));
+	REQUIRE(wfm != nullptr);
+	REQUIRE(wfm->size() == din->size());
+	REQUIRE(wfm->m_timescale == din->m_timescale);
+
+	wfm->PrepareForCpuAccess();
+	din->PrepareForCpuAccess();
+	for(size_t i=0; i<din->size(); i++)
+	{
+		REQUIRE(wfm->m_offsets[i] == din->m_offsets[i]);
+		REQUIRE(wfm->m_durations[i] == din->m_durations[i]);
+	}
+}
+
+TEST_CASE("Filter_ExponentialMovingAverage")
+{
+	auto filter = dynamic_cast<ExponentialMovingAverageFilter*>(
+		Filter::CreateFilter("Exponential Moving Average", "#ffffff"));
+	REQUIRE(filter != nullptr);
+	filter->AddRef();
+
+	//Create a queue and command buffer
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("Filter_ExponentialMovingAverage.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//Set up filter configuration
+	const size_t depth = 100000;
+	UniformAnalogWaveform ua;
+	SparseAnalogWaveform sa;
+	filter->SetInput("din", g_scope->GetOscilloscopeChannel(0));
+
+	float hl = filter->GetParameter("Half-life").GetIntVal();
+	float decay = 1 / pow(2, 1/hl);
+
+	SECTION("Uniform")
+	{
+		g_scope->GetOscilloscopeChannel(0)->SetData(&ua, 0);
+
+		//The first trigger is copied as-is, later ones are blended into the running average
+		vector<float> golden;
+		const size_t niter = 50;
+		double start = GetTime();
+		for(size_t i=0; i<niter; i++)
+		{
+			FillRandomWaveform(&ua, depth);
+			ua.PrepareForCpuAccess();
+			if(i == 0)
+				golden.assign(ua.m_samples.GetCpuPointer(), ua.m_samples.GetCpuPointer() + ua.size());
+			else
+			{
+				for(size_t j=0; j<depth; j++)
+					golden[j] = golden[j]*decay + ua.m_samples[j]*(1-decay);
+			}
+
+			filter->Refresh(cmdbuf, queue);
+			VerifyEMAResult<UniformAnalogWaveform>(golden, filter);
+		}
+		double dt = GetTime() - start;
+		LogVerbose("%zu triggers: %.3f ms per trigger\n", niter, dt * 1000 / niter);
+
+		//Clearing sweeps should restart the average
+		filter->ClearSweeps();
+		FillRandomWaveform(&ua, depth);
+		ua.PrepareForCpuAccess();
+		golden.assign(ua.m_samples.GetCpuPointer(), ua.m_samples.GetCpuPointer() + ua.size());
+		filter->Refresh(cmdbuf, queue);
+		VerifyEMAResult<UniformAnalogWaveform>(golden, filter);
+
+		//So should changing the memory depth
+		FillRandomWaveform(&ua, depth * 2);
+		ua.PrepareForCpuAccess();
+		golden.assign(ua.m_samples.GetCpuPointer(), ua.m_samples.GetCpuPointer() + ua.size());
+		filter->Refresh(cmdbuf, queue);
+		VerifyEMAResult<UniformAnalogWaveform>(golden, filter);
+	}
+
+	SECTION("Sparse")
+	{
+		g_scope->GetOscilloscopeChannel(0)->SetData(&sa, 0);
+
+		//Same as the uniform case, and the output has to follow the timestamps of the newest input
+		vector<float> golden;
+		const size_t niter = 50;
+		double start = GetTime();
+		for(size_t i=0; i<niter; i++)
+		{
+			FillRandomSparseWaveform(&sa, depth);
+			sa.PrepareForCpuAccess();
+			if(i == 0)
+				golden.assign(sa.m_samples.GetCpuPointer(), sa.m_samples.GetCpuPointer() + sa.size());
+			else
+			{
+				for(size_t j=0; j<depth; j++)
+					golden[j] = golden[j]*decay + sa.m_samples[j]*(1-decay);
+			}
+
+			filter->Refresh(cmdbuf, queue);
+			VerifyEMAResult<SparseAnalogWaveform>(golden, filter);
+			VerifySparseTimestamps(&sa, filter);
+		}
+		double dt = GetTime() - start;
+		LogVerbose("%zu sparse triggers: %.3f ms per trigger\n", niter, dt * 1000 / niter);
+
+		//Changing the timebase should restart the average
+		FillRandomSparseWaveform(&sa, depth);
+		sa.m_timescale *= 2;
+		sa.PrepareForCpuAccess();
+		golden.assign(sa.m_samples.GetCpuPointer(), sa.m_samples.GetCpuPointer() + sa.size());
+		filter->Refresh(cmdbuf, queue);
+		VerifyEMAResult<SparseAnalogWaveform>(golden, filter);
+		VerifySparseTimestamps(&sa, filter);
+	}
+
+	SECTION("Sparse/uniform switch")
+	{
+		//Switching between sparse and uniform input of the same length must not blend in the other kind's average
+		g_scope->GetOscilloscopeChannel(0)->SetData(&sa, 0);
+		FillRandomSparseWaveform(&sa, depth);
+		filter->Refresh(cmdbuf, queue);
+
+		g_scope->GetOscilloscopeChannel(0)->SetData(&ua, 0);
+		FillRandomWaveform(&ua, depth);
+		ua.PrepareForCpuAccess();
+		vector<float> golden(ua.m_samples.GetCpuPointer(), ua.m_samples.GetCpuPointer() + ua.size());
+		filter->Refresh(cmdbuf, queue);
+		VerifyEMAResult<UniformAnalogWaveform>(golden, filter);
+
+		g_scope->GetOscilloscopeChannel(0)->SetData(&sa, 0);
+		FillRandomSparseWaveform(&sa, depth);
+		sa.PrepareForCpuAccess();
+		golden.assign(sa.m_samples.GetCpuPointer(), sa.m_samples.GetCpuPointer() + sa.size());
+		filter->Refresh(cmdbuf, queue);
+		VerifyEMAResult<SparseAnalogWaveform>(golden, filter);
+		VerifySparseTimestamps(&sa, filter);
+	}
+
+	g_scope->GetOscilloscopeChannel(0)->Detach(0);
+
+	filter->Release();
+}
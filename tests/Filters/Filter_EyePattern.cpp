@@ -38,6 +38,8 @@
 #include <catch2/catch.hpp>
 #endif
 
+#include <omp.h>
+
 #include "../../lib/scopehal/scopehal.h"
 #include "../../lib/scopehal/TestWaveformSource.h"
 #include "../../lib/scopeprotocols/scopeprotocols.h"
@@ -182,6 +184,69 @@ TEST_CASE("Filter_EyePattern")
 		LogVerbose("Mask hit rate: %e (error = %.2f %%)\n", hitrate, deltaHitRate * 100);
 	}
 
+	SECTION("Parallel")
+	{
+		LogVerbose("Parallel accumulation (expecting results identical to a single thread)\n");
+		LogIndenter li;
+
+		//Sparse copy of the same data
+		SparseAnalogWaveform sdata;
+		sdata.Resize(depth);
+		sdata.PrepareForCpuAccess();
+		sdata.m_timescale = data.m_timescale;
+		sdata.m_triggerPhase = data.m_triggerPhase;
+		for(size_t i=0; i<depth; i++)
+		{
+			sdata.m_offsets[i] = i;
+			sdata.m_durations[i] = 1;
+			sdata.m_samples[i] = data.m_samples[i];
+		}
+		sdata.MarkModifiedFromCpu();
+
+		WaveformBase* inputs[2] = {&data, &sdata};
+		const char* names[2] = {"Uniform", "Sparse"};
+		int nthreads = omp_get_max_threads();
+		size_t npixels = width * height;
+		for(int j=0; j<2; j++)
+		{
+			LogVerbose("%s\n", names[j]);
+			LogIndenter li2;
+
+			//Detach first so the previous (stack allocated) input isn't deleted
+			g_scope->GetOscilloscopeChannel(0)->Detach(0);
+			g_scope->GetOscilloscopeChannel(0)->SetData(inputs[j], 0);
+
+			//Reference: one thread
+			filter->ClearSweeps();
+			omp_set_num_threads(1);
+			double start = GetTime();
+			filter->Refresh(cmdbuf, queue);
+			double tserial = GetTime() - start;
+			omp_set_num_threads(nthreads);
+
+			auto eyewfm = dynamic_cast<EyeWaveform*>(filter->GetData(0));
+			REQUIRE(eyewfm != nullptr);
+			vector<int64_t> expected(eyewfm->GetAccumData(), eyewfm->GetAccumData() + npixels);
+			size_t expectedUIs = eyewfm->GetTotalUIs();
+
+			//All threads
+			filter->ClearSweeps();
+			start = GetTime();
+			filter->Refresh(cmdbuf, queue);
+			double tparallel = GetTime() - start;
+			LogVerbose("1 thread: %.2f ms, %d threads: %.2f ms\n", tserial * 1000, nthreads, tparallel * 1000);
+
+			eyewfm = dynamic_cast<EyeWaveform*>(filter->GetData(0));
+			REQUIRE(eyewfm != nullptr);
+			REQUIRE(eyewfm->GetTotalUIs() == expectedUIs);
+			vector<int64_t> actual(eyewfm->GetAccumData(), eyewfm->GetAccumData() + npixels);
+			REQUIRE(actual == expected);
+		}
+
+		g_scope->GetOscilloscopeChannel(0)->Detach(0);
+		g_scope->GetOscilloscopeChannel(0)->SetData(&data, 0);
+	}
+
 	g_scope->GetOscilloscopeChannel(0)->Detach(0);
 	g_scope->GetOscilloscopeChannel(4)->Detach(0);
 
@@ -0,0 +1,171 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for I2C decode
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+#include <omp.h>
+
+using namespace std;
+
+/**
+	@brief Appends one sample to the SDA and SCL waveforms, at an irregular interval after the previous one
+ */
+static void AddSample(SparseDigitalWaveform& sda, SparseDigitalWaveform& scl, int64_t& t, bool vsda, bool vscl)
+{
+	int64_t dt = 1000 * (1 + g_rng() % 4);
+
+	for(auto w : {&sda, &scl})
+	{
+		w->m_offsets.push_back(t);
+		w->m_durations.push_back(dt);
+	}
+	sda.m_samples.push_back(vsda);
+	scl.m_samples.push_back(vscl);
+
+	t += dt;
+}
+
+TEST_CASE("Filter_I2C")
+{
+	auto filter = dynamic_cast<I2CDecoder*>(Filter::CreateFilter("I2C", "#ffffff"));
+	REQUIRE(filter != nullptr);
+	filter->AddRef();
+
+	SparseDigitalWaveform sda;
+	SparseDigitalWaveform scl;
+	sda.m_timescale = 1;
+	scl.m_timescale = 1;
+	sda.PrepareForCpuAccess();
+	scl.PrepareForCpuAccess();
+
+	//Generate a long capture of transactions, some using repeated starts
+	vector<uint8_t> sent;
+	int64_t t = 0;
+	AddSample(sda, scl, t, true, true);
+	while(sda.size() < 2000000)
+	{
+		size_t idle = g_rng() % 8;
+		for(size_t i=0; i<idle; i++)
+			AddSample(sda, scl, t, true, true);
+
+		//Start
+		AddSample(sda, scl, t, false, true);
+		AddSample(sda, scl, t, false, false);
+
+		//Address and data bytes, each followed by an ACK or NAK
+		size_t nbytes = 1 + g_rng() % 6;
+		for(size_t i=0; i<nbytes; i++)
+		{
+			uint8_t b = g_rng();
+			sent.push_back(b);
+			for(int j=7; j>=0; j--)
+			{
+				bool v = (b >> j) & 1;
+				AddSample(sda, scl, t, v, false);
+				AddSample(sda, scl, t, v, true);
+				AddSample(sda, scl, t, v, false);
+			}
+
+			bool nak = (g_rng() % 8) == 0;
+			AddSample(sda, scl, t, nak, false);
+			AddSample(sda, scl, t, nak, true);
+			AddSample(sda, scl, t, nak, false);
+		}
+
+		//Either a repeated start or a stop
+		if( (g_rng() % 4) == 0)
+		{
+			AddSample(sda, scl, t, true, false);
+			AddSample(sda, scl, t, true, true);
+		}
+		else
+		{
+			AddSample(sda, scl, t, false, false);
+			AddSample(sda, scl, t, false, true);
+			AddSample(sda, scl, t, true, true);
+		}
+	}
+	sda.MarkModifiedFromCpu();
+	scl.MarkModifiedFromCpu();
+
+	g_scope->GetOscilloscopeChannel(4)->SetData(&sda, 0);
+	g_scope->GetOscilloscopeChannel(5)->SetData(&scl, 0);
+	filter->SetInput("sda", g_scope->GetOscilloscopeChannel(4), true);
+	filter->SetInput("scl", g_scope->GetOscilloscopeChannel(5), true);
+
+	//Decode serially first
+	int nthreads = omp_get_max_threads();
+	omp_set_num_threads(1);
+	filter->Refresh();
+
+	unique_ptr<WaveformBase> golden(filter->Detach(0));
+	auto goldenSymbols = dynamic_cast<I2CWaveform*>(golden.get());
+	REQUIRE(goldenSymbols != nullptr);
+
+	vector<uint8_t> received;
+	for(size_t i=0; i<goldenSymbols->size(); i++)
+	{
+		auto& s = goldenSymbols->m_samples[i];
+		if( (s.m_stype == I2CSymbol::TYPE_ADDRESS) || (s.m_stype == I2CSymbol::TYPE_DATA) )
+			received.push_back(s.m_data);
+	}
+	REQUIRE(received == sent);
+
+	auto goldenPackets = filter->GetPackets();
+	filter->DetachPackets();
+	REQUIRE(goldenPackets.size() > 1);
+
+	//Then in parallel chunks, which must give exactly the same output
+	omp_set_num_threads(8);
+	filter->Refresh();
+	omp_set_num_threads(nthreads);
+
+	VerifyMatchingSymbols<I2CSymbol>(goldenSymbols, dynamic_cast<I2CWaveform*>(filter->GetData(0)));
+	VerifyMatchingPackets(goldenPackets, filter->GetPackets());
+
+	for(auto p : goldenPackets)
+		delete p;
+
+	g_scope->GetOscilloscopeChannel(4)->Detach(0);
+	g_scope->GetOscilloscopeChannel(5)->Detach(0);
+
+	filter->Release();
+}
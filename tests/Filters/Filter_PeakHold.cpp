@@ -0,0 +1,115 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for PeakHold filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+static void VerifyPeakHoldResult(const vector<float>& golden, Filter* filter)
+{
+	auto wfm = dynamic_cast<UniformAnalogWaveform*>(filter->GetData(0));
+	REQUIRE(wfm != nullptr);
+	REQUIRE(wfm->size() == golden.size());
+
+	wfm->PrepareForCpuAccess();
+	for(size_t i=0; i<golden.size(); i++)
+		REQUIRE(wfm->m_samples[i] == golden[i]);
+}
+
+TEST_CASE("Filter_PeakHold")
+{
+	auto filter = dynamic_cast<PeakHoldFilter*>(Filter::CreateFilter("Peak Hold", "#ffffff"));
+	REQUIRE(filter != nullptr);
+	filter->AddRef();
+
+	//Create a queue and command buffer
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("Filter_PeakHold.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//Set up filter configuration
+	const size_t depth = 100000;
+	UniformAnalogWaveform ua;
+	g_scope->GetOscilloscopeChannel(0)->SetData(&ua, 0);
+	filter->SetInput("din", g_scope->GetOscilloscopeChannel(0));
+
+	//Peaks should accumulate across triggers
+	vector<float> golden(depth, -FLT_MAX);
+	const size_t niter = 50;
+	double start = GetTime();
+	for(size_t i=0; i<niter; i++)
+	{
+		FillRandomWaveform(&ua, depth);
+		ua.PrepareForCpuAccess();
+		for(size_t j=0; j<depth; j++)
+			golden[j] = max(golden[j], (float)ua.m_samples[j]);
+
+		filter->Refresh(cmdbuf, queue);
+		VerifyPeakHoldResult(golden, filter);
+	}
+	double dt = GetTime() - start;
+	LogVerbose("%zu triggers: %.3f ms per trigger\n", niter, dt * 1000 / niter);
+
+	//Clearing sweeps should discard the held peaks
+	filter->ClearSweeps();
+	FillRandomWaveform(&ua, depth);
+	ua.PrepareForCpuAccess();
+	golden.assign(ua.m_samples.GetCpuPointer(), ua.m_samples.GetCpuPointer() + ua.size());
+	filter->Refresh(cmdbuf, queue);
+	VerifyPeakHoldResult(golden, filter);
+
+	//So should changing the memory depth
+	FillRandomWaveform(&ua, depth / 2);
+	ua.PrepareForCpuAccess();
+	golden.assign(ua.m_samples.GetCpuPointer(), ua.m_samples.GetCpuPointer() + ua.size());
+	filter->Refresh(cmdbuf, queue);
+	VerifyPeakHoldResult(golden, filter);
+
+	g_scope->GetOscilloscopeChannel(0)->Detach(0);
+
+	filter->Release();
+}
@@ -0,0 +1,182 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for SPI decode
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+#include <omp.h>
+
+using namespace std;
+
+/**
+	@brief Appends one sample to each of the clock, chip select, and data waveforms
+ */
+static void AddSample(
+	vector<bool>& clk,
+	vector<bool>& csn,
+	vector<bool>& data,
+	bool vclk,
+	bool vcsn,
+	bool vdata)
+{
+	clk.push_back(vclk);
+	csn.push_back(vcsn);
+	data.push_back(vdata);
+}
+
+/**
+	@brief Copies a list of sample values into a sparse waveform using the given timestamps
+ */
+static void FillSparse(SparseDigitalWaveform& wfm, const vector<bool>& values, const vector<int64_t>& offsets)
+{
+	size_t len = values.size();
+	wfm.m_timescale = 1;
+	wfm.m_triggerPhase = 0;
+	wfm.Resize(len);
+	for(size_t i=0; i<len; i++)
+	{
+		wfm.m_offsets[i] = offsets[i];
+		wfm.m_durations[i] = (i+1 < len) ? (offsets[i+1] - offsets[i]) : 1;
+		wfm.m_samples[i] = values[i];
+	}
+	wfm.MarkModifiedFromCpu();
+}
+
+TEST_CASE("Filter_SPI")
+{
+	auto filter = dynamic_cast<SPIDecoder*>(Filter::CreateFilter("SPI", "#ffffff"));
+	REQUIRE(filter != nullptr);
+	filter->AddRef();
+
+	//Generate a long capture of transactions, with traffic to other devices in between
+	vector<bool> clk;
+	vector<bool> csn;
+	vector<bool> data;
+	vector<uint8_t> sent;
+
+	//Start in the middle of a transaction, which should be ignored
+	AddSample(clk, csn, data, false, false, true);
+	AddSample(clk, csn, data, true, false, true);
+	AddSample(clk, csn, data, false, false, false);
+
+	while(clk.size() < 1500000)
+	{
+		//Deselect with the clock idle, then toggle it randomly
+		AddSample(clk, csn, data, false, true, false);
+		size_t idle = g_rng() % 8;
+		for(size_t i=0; i<idle; i++)
+			AddSample(clk, csn, data, g_rng() & 1, true, g_rng() & 1);
+		AddSample(clk, csn, data, false, true, false);
+
+		AddSample(clk, csn, data, false, false, false);
+
+		//Whole bytes, with the occasional truncated one at the end
+		size_t nbytes = 1 + g_rng() % 8;
+		size_t nbits = nbytes * 8;
+		if( (g_rng() % 16) == 0)
+			nbits += 1 + g_rng() % 7;
+		uint8_t b = 0;
+		for(size_t i=0; i<nbits; i++)
+		{
+			bool v = g_rng() & 1;
+			b = (b << 1) | v;
+			if( (i & 7) == 7)
+				sent.push_back(b);
+
+			AddSample(clk, csn, data, false, false, v);
+			AddSample(clk, csn, data, true, false, v);
+		}
+		AddSample(clk, csn, data, false, false, false);
+	}
+	AddSample(clk, csn, data, false, true, false);
+
+	//Irregular sample spacing
+	vector<int64_t> offsets;
+	int64_t t = 0;
+	for(size_t i=0; i<clk.size(); i++)
+	{
+		offsets.push_back(t);
+		t += 1000 * (1 + g_rng() % 4);
+	}
+
+	SparseDigitalWaveform wclk;
+	SparseDigitalWaveform wcsn;
+	SparseDigitalWaveform wdata;
+	FillSparse(wclk, clk, offsets);
+	FillSparse(wcsn, csn, offsets);
+	FillSparse(wdata, data, offsets);
+
+	g_scope->GetOscilloscopeChannel(4)->SetData(&wclk, 0);
+	g_scope->GetOscilloscopeChannel(5)->SetData(&wcsn, 0);
+	g_scope->GetOscilloscopeChannel(6)->SetData(&wdata, 0);
+	filter->SetInput("clk", g_scope->GetOscilloscopeChannel(4), true);
+	filter->SetInput("cs#", g_scope->GetOscilloscopeChannel(5), true);
+	filter->SetInput("data", g_scope->GetOscilloscopeChannel(6), true);
+
+	//Decode serially first
+	int nthreads = omp_get_max_threads();
+	omp_set_num_threads(1);
+	filter->Refresh();
+
+	unique_ptr<WaveformBase> golden(filter->Detach(0));
+	auto goldenSymbols = dynamic_cast<SPIWaveform*>(golden.get());
+	REQUIRE(goldenSymbols != nullptr);
+
+	vector<uint8_t> received;
+	for(size_t i=0; i<goldenSymbols->size(); i++)
+	{
+		if(goldenSymbols->m_samples[i].m_stype == SPISymbol::TYPE_DATA)
+			received.push_back(goldenSymbols->m_samples[i].m_data);
+	}
+	REQUIRE(received == sent);
+
+	//Then in parallel chunks, which must give exactly the same output
+	omp_set_num_threads(8);
+	filter->Refresh();
+	omp_set_num_threads(nthreads);
+
+	VerifyMatchingSymbols<SPISymbol>(goldenSymbols, dynamic_cast<SPIWaveform*>(filter->GetData(0)));
+
+	g_scope->GetOscilloscopeChannel(4)->Detach(0);
+	g_scope->GetOscilloscopeChannel(5)->Detach(0);
+	g_scope->GetOscilloscopeChannel(6)->Detach(0);
+
+	filter->Release();
+}
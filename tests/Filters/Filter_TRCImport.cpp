@@ -0,0 +1,153 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for TRC import filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+/**
+	@brief Writes a sequence mode, 16-bit TRC file
+ */
+static void WriteTRC(const string& path, bool bigEndian, const vector<int16_t>& samples, size_t nsegments)
+{
+	TRCImportFilter::WaveDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	strncpy(desc.descriptorName, "WAVEDESC", sizeof(desc.descriptorName));
+	strncpy(desc.templateName, "LECROY_2_3", sizeof(desc.templateName));
+	strncpy(desc.instrumentName, "WAVERUNNER", sizeof(desc.instrumentName));
+	desc.commType = 1;
+	desc.commOrder = bigEndian ? 0 : 1;
+	desc.waveDescLength = sizeof(desc);
+	desc.trigTimeLength = nsegments * sizeof(TRCImportFilter::TrigTime);
+	desc.waveArray1Length = samples.size() * sizeof(int16_t);
+	desc.waveArrayCount = samples.size();
+	desc.subarrayCount = nsegments;
+	desc.verticalGain = 0.001;
+	desc.verticalOffset = 0.25;
+	desc.horizInterval = 1e-9;
+	desc.horizOffset = -5e-5;
+	desc.triggerSeconds = 12.5;
+	desc.triggerMinutes = 30;
+	desc.triggerHours = 15;
+	desc.triggerDays = 10;
+	desc.triggerMonths = 3;
+	desc.triggerYear = 2025;
+	desc.waveSource = 1;
+
+	vector<TRCImportFilter::TrigTime> times(nsegments);
+	for(size_t i=0; i<nsegments; i++)
+	{
+		times[i].triggerTime = i * 1e-3;
+		times[i].triggerOffset = -5e-5;
+	}
+
+	vector<int16_t> data = samples;
+	if(bigEndian)
+	{
+		desc.SwapEndian();
+		for(auto& t : times)
+			t.SwapEndian();
+		for(auto& s : data)
+			s = MappedFile::ByteSwap(s);
+	}
+
+	FILE* fp = fopen(path.c_str(), "wb");
+	REQUIRE(fp != nullptr);
+	size_t len = sizeof(desc) + times.size()*sizeof(TRCImportFilter::TrigTime) + data.size()*sizeof(int16_t);
+	fprintf(fp, "#9%09zu", len);
+	fwrite(&desc, sizeof(desc), 1, fp);
+	fwrite(times.data(), sizeof(TRCImportFilter::TrigTime), times.size(), fp);
+	fwrite(data.data(), sizeof(int16_t), data.size(), fp);
+	fclose(fp);
+}
+
+TEST_CASE("Filter_TRCImport")
+{
+	const size_t nsegments = 4;
+	const size_t depth = 100000;
+
+	vector<int16_t> samples;
+	auto dist = uniform_int_distribution<int>(-32768, 32767);
+	for(size_t i=0; i<nsegments*depth; i++)
+		samples.push_back(dist(g_rng));
+
+	//Both byte orders should decode to the same waveforms
+	for(int bigEndian=0; bigEndian<2; bigEndian++)
+	{
+		string path = "trcimport-test.trc";
+		WriteTRC(path, bigEndian, samples, nsegments);
+
+		//The filter holds a reference to itself
+		auto filter = new TRCImportFilter("#ffffff");
+		double start = GetTime();
+		filter->GetParameter("TRC File").SetFileName(path);
+		double dt = GetTime() - start;
+		LogVerbose("Imported %zu samples in %.2f ms\n", samples.size(), dt * 1000);
+
+		//One stream per segment
+		REQUIRE(filter->GetStreamCount() == nsegments);
+		for(size_t i=0; i<nsegments; i++)
+		{
+			REQUIRE(filter->GetStreamName(i) == string("C2[") + to_string(i) + "]");
+
+			auto wfm = dynamic_cast<UniformAnalogWaveform*>(filter->GetData(i));
+			REQUIRE(wfm != nullptr);
+			wfm->PrepareForCpuAccess();
+
+			REQUIRE(wfm->size() == depth);
+			REQUIRE(wfm->m_timescale == 1000000);
+
+			//Segments are 1 ms apart
+			int64_t delta = wfm->m_startFemtoseconds - filter->GetData(0)->m_startFemtoseconds;
+			REQUIRE(llabs(delta - static_cast<int64_t>(i * 1000000000000LL)) < 1000);
+
+			for(size_t j=0; j<depth; j++)
+			{
+				float expected = samples[i*depth + j] * 0.001f - 0.25f;
+				REQUIRE(fabs(wfm->m_samples[j] - expected) < 1e-5);
+			}
+		}
+
+		remove(path.c_str());
+		filter->Release();
+	}
+}
@@ -0,0 +1,127 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for SParameters::SaveToFile(), which writes the output of TouchstoneExportFilter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+/**
+	@brief Copy of the original stdio based SParameters::SaveToFile() loop, used as the golden reference
+ */
+static void ReferenceSaveToFile(SParameters& params, const string& path)
+{
+	FILE* fp = fopen(path.c_str(), "wb");
+	REQUIRE(fp != nullptr);
+
+	fprintf(fp, "# %s S MA R 50.000\n", "GHz");
+	float freqScale = 1e-9;
+
+	auto& s11 = params[SPair(1, 1)];
+	auto& s12 = params[SPair(1, 2)];
+	auto& s21 = params[SPair(2, 1)];
+	auto& s22 = params[SPair(2, 2)];
+
+	float rad2deg = 180 / M_PI;
+	for(size_t i=0; i<s11.size(); i++)
+	{
+		float freq = s11[i].m_frequency;
+		fprintf(fp, "%f %f %f %f %f %f %f %f %f\n", freq * freqScale,
+			s11[i].m_amplitude, s11[i].m_phase * rad2deg,
+			s21[i].m_amplitude, s21[i].m_phase * rad2deg,
+			s12[i].m_amplitude, s12[i].m_phase * rad2deg,
+			s22[i].m_amplitude, s22[i].m_phase * rad2deg);
+	}
+
+	fclose(fp);
+}
+
+TEST_CASE("Filter_TouchstoneExport")
+{
+	const size_t depth = 50000;
+
+	//Magnitude and angle waveforms on a 100 kHz grid, as a VNA would provide them
+	UniformAnalogWaveform mag;
+	mag.m_timescale = 100000;
+	mag.m_triggerPhase = 0;
+	FillRandomWaveform(&mag, depth, -80, 3);
+
+	UniformAnalogWaveform ang;
+	ang.m_timescale = 100000;
+	ang.m_triggerPhase = 0;
+	FillRandomWaveform(&ang, depth, -180, 180);
+
+	//Convert to S-parameters the same way TouchstoneExportFilter does, using different data for each parameter
+	SParameters params;
+	params.Allocate(2);
+	for(int to=1; to <= 2; to++)
+	{
+		for(int from=1; from <= 2; from++)
+		{
+			params[SPair(to, from)].ConvertFromWaveforms(&mag, &ang);
+			FillRandomWaveform(&mag, depth, -80, 3);
+			FillRandomWaveform(&ang, depth, -180, 180);
+		}
+	}
+
+	string goldenPath = "touchstoneexport-golden.s2p";
+	string outPath = "touchstoneexport-out.s2p";
+
+	double start = GetTime();
+	ReferenceSaveToFile(params, goldenPath);
+	double tgolden = GetTime() - start;
+
+	start = GetTime();
+	params.SaveToFile(outPath, SParameters::FORMAT_MAG_ANGLE, SParameters::FREQ_GHZ);
+	double tout = GetTime() - start;
+
+	LogVerbose("stdio export: %.2f ms\n", tgolden * 1000);
+	LogVerbose("SaveToFile:   %.2f ms (%.2fx speedup)\n", tout * 1000, tgolden / tout);
+
+	auto golden = ReadFile(goldenPath);
+	auto out = ReadFile(outPath);
+	LogVerbose("Output: %zu bytes\n", out.size());
+	REQUIRE(golden.size() > depth * 70);
+	REQUIRE(out == golden);
+
+	remove(goldenPath.c_str());
+	remove(outPath.c_str());
+}
@@ -0,0 +1,180 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for Trend filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+/**
+	@brief Checks that the trend holds the most recent values, oldest first, with the newest sample at t=0
+ */
+static void VerifyTrendResult(const deque<float>& golden, Filter* filter)
+{
+	auto wfm = dynamic_cast<SparseAnalogWaveform*>(filter->GetData(0));
+	REQUIRE(wfm != nullptr);
+	REQUIRE(wfm->size() == golden.size());
+
+	wfm->PrepareForCpuAccess();
+	size_t len = golden.size();
+	for(size_t i=0; i<len; i++)
+	{
+		REQUIRE(wfm->m_samples[i] == golden[i]);
+		if(i > 0)
+			REQUIRE(wfm->m_offsets[i] >= wfm->m_offsets[i-1]);
+	}
+	REQUIRE(GetOffsetScaled(wfm, len-1) == 0);
+}
+
+TEST_CASE("Filter_Trend")
+{
+	//Trend needs a scalar input, so trend the average of a waveform
+	auto avg = dynamic_cast<AverageFilter*>(Filter::CreateFilter("Average", "#ffffff"));
+	REQUIRE(avg != nullptr);
+	avg->AddRef();
+
+	auto filter = dynamic_cast<TrendFilter*>(Filter::CreateFilter("Trend", "#ffffff"));
+	REQUIRE(filter != nullptr);
+	filter->AddRef();
+
+	//Create a queue and command buffer
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("Filter_Trend.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//Set up filter configuration
+	UniformAnalogWaveform ua;
+	g_scope->GetOscilloscopeChannel(0)->SetData(&ua, 0);
+	avg->SetInput("in", g_scope->GetOscilloscopeChannel(0));
+	filter->SetInput("din", StreamDescriptor(avg, 0));
+
+	SECTION("History length")
+	{
+		//The history should never hold more than the buffer length
+		const size_t nmax = 100;
+		filter->GetParameter("Buffer length").SetIntVal(nmax);
+
+		deque<float> golden;
+		for(size_t i=0; i<3*nmax; i++)
+		{
+			FillRandomWaveform(&ua, 1000);
+			avg->Refresh(cmdbuf, queue);
+			golden.push_back(avg->GetScalarValue(0));
+			if(golden.size() > nmax)
+				golden.pop_front();
+
+			filter->Refresh(cmdbuf, queue);
+			VerifyTrendResult(golden, filter);
+		}
+
+		//Clearing sweeps should discard the history
+		filter->ClearSweeps();
+		FillRandomWaveform(&ua, 1000);
+		avg->Refresh(cmdbuf, queue);
+		golden = { avg->GetScalarValue(0) };
+		filter->Refresh(cmdbuf, queue);
+		VerifyTrendResult(golden, filter);
+	}
+
+	SECTION("Deep history")
+	{
+		//Start from a full history, as if it had been loaded from a session, so every trigger has to trim
+		const size_t nmax = 1000000;
+		filter->GetParameter("Buffer length").SetIntVal(nmax);
+
+		auto wfm = new SparseAnalogWaveform;
+		wfm->m_timescale = 1;
+		wfm->PrepareForCpuAccess();
+		wfm->Resize(nmax);
+		deque<float> golden;
+		for(size_t i=0; i<nmax; i++)
+		{
+			wfm->m_samples[i] = i;
+			wfm->m_offsets[i] = i * 1000000000LL;
+			wfm->m_durations[i] = 1000000000LL;
+			golden.push_back(i);
+		}
+		double now = GetTime();
+		wfm->m_startTimestamp = floor(now);
+		wfm->m_startFemtoseconds = (now - wfm->m_startTimestamp) * FS_PER_SECOND;
+		wfm->m_triggerPhase = -wfm->m_offsets[nmax-1];
+		wfm->MarkModifiedFromCpu();
+		filter->SetData(wfm, 0);
+
+		//Dropping the oldest sample should only skip over it, not move the rest of the history.
+		//Count the triggers after which the samples weren't where they would be if nothing had moved.
+		const size_t niter = 100;
+		size_t nmoves = 0;
+		double start = GetTime();
+		for(size_t i=0; i<niter; i++)
+		{
+			FillRandomWaveform(&ua, 1000);
+			avg->Refresh(cmdbuf, queue);
+
+			auto p = wfm->m_samples.GetCpuPointer();
+			filter->Refresh(cmdbuf, queue);
+			if(wfm->m_samples.GetCpuPointer() != p+1)
+				nmoves ++;
+
+			golden.push_back(avg->GetScalarValue(0));
+			golden.pop_front();
+		}
+		double dt = GetTime() - start;
+		LogVerbose("%zu triggers with %zu samples of history: %.3f ms per trigger, history moved %zu times\n",
+			niter, nmax, dt * 1000 / niter, nmoves);
+
+		//The history has to be reallocated once to get space to grow into, but after that it must not move again
+		//until as many samples have been dropped as it holds
+		REQUIRE(nmoves <= 1);
+
+		VerifyTrendResult(golden, filter);
+	}
+
+	g_scope->GetOscilloscopeChannel(0)->Detach(0);
+
+	filter->Release();
+	avg->Release();
+}
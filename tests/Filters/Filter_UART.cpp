@@ -0,0 +1,119 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for UART decode
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+#include <omp.h>
+
+using namespace std;
+
+TEST_CASE("Filter_UART")
+{
+	auto filter = dynamic_cast<UARTDecoder*>(Filter::CreateFilter("UART", "#ffffff"));
+	REQUIRE(filter != nullptr);
+	filter->AddRef();
+
+	//1 Mbps, 16 samples per bit
+	const size_t oversample = 16;
+	filter->GetParameter("Baud rate").SetIntVal(1000000);
+	UniformDigitalWaveform wfm;
+	wfm.m_timescale = static_cast<int64_t>(FS_PER_SECOND / (1000000 * oversample));
+
+	//Generate a long capture of bytes with random gaps, some long enough to start a new packet
+	vector<uint8_t> sent;
+	vector<bool> bits;
+	while(bits.size() < 3000000)
+	{
+		size_t gap = (g_rng() % 8) ? (g_rng() % 64) : (g_rng() % 1024);
+		for(size_t i=0; i<gap; i++)
+			bits.push_back(true);
+
+		uint8_t b = g_rng();
+		sent.push_back(b);
+		uint16_t frame = (b << 1) | 0x200;
+		for(size_t i=0; i<10; i++)
+		{
+			for(size_t j=0; j<oversample; j++)
+				bits.push_back( (frame >> i) & 1);
+		}
+	}
+	for(size_t i=0; i<oversample; i++)
+		bits.push_back(true);
+
+	wfm.Resize(bits.size());
+	for(size_t i=0; i<bits.size(); i++)
+		wfm.m_samples[i] = bits[i];
+	wfm.MarkModifiedFromCpu();
+
+	g_scope->GetOscilloscopeChannel(4)->SetData(&wfm, 0);
+	filter->SetInput("din", g_scope->GetOscilloscopeChannel(4), true);
+
+	//Decode serially first
+	int nthreads = omp_get_max_threads();
+	omp_set_num_threads(1);
+	filter->Refresh();
+
+	unique_ptr<WaveformBase> golden(filter->Detach(0));
+	auto goldenBytes = dynamic_cast<ByteWaveform*>(golden.get());
+	REQUIRE(goldenBytes != nullptr);
+	REQUIRE(goldenBytes->size() == sent.size());
+	for(size_t i=0; i<sent.size(); i++)
+		REQUIRE(static_cast<uint8_t>(goldenBytes->m_samples[i]) == sent[i]);
+
+	auto goldenPackets = filter->GetPackets();
+	filter->DetachPackets();
+	REQUIRE(goldenPackets.size() > 1);
+
+	//Then in parallel chunks, which must give exactly the same output
+	omp_set_num_threads(8);
+	filter->Refresh();
+	omp_set_num_threads(nthreads);
+
+	VerifyMatchingSymbols<char>(goldenBytes, dynamic_cast<ByteWaveform*>(filter->GetData(0)));
+	VerifyMatchingPackets(goldenPackets, filter->GetPackets());
+
+	for(auto p : goldenPackets)
+		delete p;
+
+	g_scope->GetOscilloscopeChannel(4)->Detach(0);
+
+	filter->Release();
+}
@@ -0,0 +1,154 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for VCD import filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+TEST_CASE("Filter_VCDImport")
+{
+	//Deep enough to be split into several blocks
+	const size_t depth = 300000;
+
+	string path = "vcdimport-test.vcd";
+	FILE* fp = fopen(path.c_str(), "wb");
+	REQUIRE(fp != nullptr);
+
+	fprintf(fp,
+		"$timescale\n"
+		"   1ns\n"
+		"$end\n"
+		"$scope module top $end\n"
+		"$var wire 1 ! clk $end\n"
+		"$var wire 8 \" data [7:0] $end\n"
+		"$upscope $end\n"
+		"$enddefinitions $end\n"
+		"#0\n"
+		"$dumpvars\n"
+		"0!\n"
+		"b0 \"\n"
+		"$end\n");
+
+	//Expected value changes for each signal
+	vector<int64_t> clkOffsets = {0};
+	vector<bool> clkSamples = {false};
+	vector<int64_t> dataOffsets = {0};
+	vector<uint8_t> dataSamples = {0};
+
+	auto gapdist = uniform_int_distribution<int64_t>(1, 10);
+	auto sigdist = uniform_int_distribution<int>(0, 2);
+	auto bytedist = uniform_int_distribution<int>(0, 255);
+	int64_t t = 0;
+	for(size_t i=0; i<depth; i++)
+	{
+		t += gapdist(g_rng);
+		fprintf(fp, "#%" PRId64 "\n", t);
+
+		int sig = sigdist(g_rng);
+		if(sig != 1)
+		{
+			bool b = !clkSamples.back();
+			fprintf(fp, "%d!\n", b);
+			clkOffsets.push_back(t);
+			clkSamples.push_back(b);
+		}
+		if(sig != 0)
+		{
+			//Leading zeroes are omitted
+			uint8_t v = bytedist(g_rng);
+			string bits;
+			for(uint8_t tmp = v; tmp != 0; tmp >>= 1)
+				bits = ((tmp & 1) ? "1" : "0") + bits;
+			if(bits.empty())
+				bits = "0";
+			fprintf(fp, "b%s \"\n", bits.c_str());
+			dataOffsets.push_back(t);
+			dataSamples.push_back(v);
+		}
+	}
+	fclose(fp);
+
+	//The filter holds a reference to itself
+	auto filter = new VCDImportFilter("#ffffff");
+	double start = GetTime();
+	filter->GetParameter("VCD File").SetFileName(path);
+	double dt = GetTime() - start;
+	LogVerbose("Imported %zu timestamps in %.2f ms\n", depth, dt * 1000);
+
+	REQUIRE(filter->GetStreamCount() == 2);
+
+	auto sd = dynamic_cast<SparseDigitalWaveform*>(filter->GetData(0));
+	auto sb = dynamic_cast<SparseDigitalBusWaveform*>(filter->GetData(1));
+	REQUIRE(sd != nullptr);
+	REQUIRE(sb != nullptr);
+	sd->PrepareForCpuAccess();
+	sb->PrepareForCpuAccess();
+	REQUIRE(sd->m_timescale == 1000000);
+	REQUIRE(sb->m_timescale == 1000000);
+
+	//Each sample lasts until the next one, the last one is a single tick
+	size_t len = clkOffsets.size();
+	REQUIRE(sd->size() == len);
+	for(size_t i=0; i<len; i++)
+	{
+		REQUIRE(sd->m_offsets[i] == clkOffsets[i]);
+		REQUIRE(sd->m_durations[i] == ((i+1 < len) ? (clkOffsets[i+1] - clkOffsets[i]) : 1));
+		REQUIRE(sd->m_samples[i] == clkSamples[i]);
+	}
+
+	len = dataOffsets.size();
+	REQUIRE(sb->size() == len);
+	for(size_t i=0; i<len; i++)
+	{
+		REQUIRE(sb->m_offsets[i] == dataOffsets[i]);
+		REQUIRE(sb->m_durations[i] == ((i+1 < len) ? (dataOffsets[i+1] - dataOffsets[i]) : 1));
+
+		//Bits are stored LSB first
+		auto& sample = sb->m_samples[i];
+		REQUIRE(sample.size() == 8);
+		for(size_t j=0; j<8; j++)
+			REQUIRE(sample[j] == (bool)((dataSamples[i] >> j) & 1));
+	}
+
+	remove(path.c_str());
+	filter->Release();
+}
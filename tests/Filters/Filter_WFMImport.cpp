@@ -0,0 +1,276 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for WFM import filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+/**
+	@brief Writes a WFM#003 file with one or more frames of raw samples
+
+	@param path				Path to the file
+	@param byteswap			True to write the file in the opposite byte order from ours (0xf0f0 magic)
+	@param bytesPerPoint	1 for int8_t samples, 2 for int16_t
+	@param samples			Raw samples for all frames, back to back
+	@param nframes			Number of frames (more than one makes a FastFrame file)
+ */
+static void WriteWFM(const string& path, bool byteswap, size_t bytesPerPoint, const vector<int16_t>& samples, size_t nframes)
+{
+	size_t depth = samples.size() / nframes;
+	size_t frameBytes = depth * bytesPerPoint;
+	size_t extraHeaders = (nframes - 1) * (sizeof(WFMImportFilter::UpdateSpec) + sizeof(WFMImportFilter::CurveInfo));
+
+	WFMImportFilter::FileHeader fh;
+	memset(&fh, 0, sizeof(fh));
+	fh.info.byteOrder = 0x0f0f;
+	memcpy(fh.info.version, ":WFM#003", sizeof(fh.info.version));
+	fh.info.digits = 9;
+	fh.info.bytesPerPoint = bytesPerPoint;
+	fh.info.curveOffset = sizeof(fh) + extraHeaders;
+	fh.info.bytesToEnd = fh.info.curveOffset + nframes*frameBytes - 15;	//counted from the end of this field
+	fh.info.numFrames = nframes - 1;
+	fh.info.headerSize = sizeof(WFMImportFilter::WaveformHeader);
+
+	fh.header.setType = (nframes > 1) ? 1 : 0;
+	fh.header.wfmCount = nframes;
+	fh.header.updateSpecCount = 1;
+	fh.header.impDimCount = 1;
+	fh.header.expDimCount = 1;
+	fh.header.dataType = 2;
+	fh.header.curveCount = 1;
+	fh.header.requestedFrames = nframes;
+	fh.header.acquiredFrames = nframes;
+
+	auto& ydim = fh.explicitDims[0];
+	ydim.scale = (bytesPerPoint == 2) ? 1.0 / 6400 : 1.0 / 25;
+	ydim.offset = 0.125;
+	strncpy(ydim.units, "V", sizeof(ydim.units));
+	ydim.format = (bytesPerPoint == 2) ? 0 : 7;
+	ydim.storageType = 0;
+
+	auto& xdim = fh.implicitDims[0];
+	xdim.scale = 1e-9;
+	xdim.offset = -5e-6;
+	xdim.size = depth;
+	strncpy(xdim.units, "s", sizeof(xdim.units));
+	xdim.spacing = 0;
+
+	//Frames are 1 us apart, all with the same trigger phase
+	vector<WFMImportFilter::UpdateSpec> specs(nframes);
+	vector<WFMImportFilter::CurveInfo> curves(nframes);
+	for(size_t i=0; i<nframes; i++)
+	{
+		memset(&specs[i], 0, sizeof(specs[i]));
+		specs[i].triggerPhase = 0.25;
+		specs[i].fracSec = i * 1e-6;
+		specs[i].gmtSec = 1700000000;
+
+		memset(&curves[i], 0, sizeof(curves[i]));
+		curves[i].prechargeStart = 0;
+		curves[i].dataStart = 0;
+		curves[i].postchargeStart = frameBytes;
+		curves[i].postchargeStop = frameBytes;
+		curves[i].endOfCurve = frameBytes;
+	}
+	fh.updateSpec = specs[0];
+	fh.curve = curves[0];
+
+	//Pack the sample data
+	vector<uint8_t> data(samples.size() * bytesPerPoint);
+	for(size_t i=0; i<samples.size(); i++)
+	{
+		if(bytesPerPoint == 1)
+			data[i] = static_cast<uint8_t>(static_cast<int8_t>(samples[i]));
+		else
+		{
+			int16_t s = byteswap ? MappedFile::ByteSwap(samples[i]) : samples[i];
+			memcpy(&data[i*2], &s, sizeof(s));
+		}
+	}
+
+	if(byteswap)
+	{
+		fh.SwapEndian();
+		for(auto& s : specs)
+			s.SwapEndian();
+		for(auto& c : curves)
+			c.SwapEndian();
+	}
+
+	FILE* fp = fopen(path.c_str(), "wb");
+	REQUIRE(fp != nullptr);
+	fwrite(&fh, sizeof(fh), 1, fp);
+	for(size_t i=1; i<nframes; i++)
+		fwrite(&specs[i], sizeof(specs[i]), 1, fp);
+	for(size_t i=1; i<nframes; i++)
+		fwrite(&curves[i], sizeof(curves[i]), 1, fp);
+	fwrite(data.data(), 1, data.size(), fp);
+	fclose(fp);
+}
+
+/**
+	@brief Writes a WFM file with random content, imports it, and checks every frame decoded correctly
+ */
+static void VerifyWFMImport(bool byteswap, size_t bytesPerPoint, size_t nframes)
+{
+	const size_t depth = 100000;
+
+	vector<int16_t> samples;
+	int smax = (bytesPerPoint == 2) ? 32767 : 127;
+	auto dist = uniform_int_distribution<int>(-smax-1, smax);
+	for(size_t i=0; i<nframes*depth; i++)
+		samples.push_back(dist(g_rng));
+
+	string path = "wfmimport-test.wfm";
+	WriteWFM(path, byteswap, bytesPerPoint, samples, nframes);
+
+	//The filter holds a reference to itself
+	auto filter = new WFMImportFilter("#ffffff");
+	double start = GetTime();
+	filter->GetParameter("WFM File").SetFileName(path);
+	double dt = GetTime() - start;
+	LogVerbose("Imported %zu samples in %.2f ms\n", samples.size(), dt * 1000);
+
+	//One stream per frame
+	float scale = (bytesPerPoint == 2) ? 1.0f / 6400 : 1.0f / 25;
+	REQUIRE(filter->GetStreamCount() == nframes);
+	for(size_t i=0; i<nframes; i++)
+	{
+		if(nframes == 1)
+			REQUIRE(filter->GetStreamName(i) == "data");
+		else
+			REQUIRE(filter->GetStreamName(i) == string("data[") + to_string(i) + "]");
+		REQUIRE(filter->GetYAxisUnits(i) == Unit(Unit::UNIT_VOLTS));
+
+		auto wfm = dynamic_cast<UniformAnalogWaveform*>(filter->GetData(i));
+		REQUIRE(wfm != nullptr);
+		wfm->PrepareForCpuAccess();
+
+		REQUIRE(wfm->size() == depth);
+		REQUIRE(wfm->m_timescale == 1000000);
+		REQUIRE(wfm->m_triggerPhase == 250000);
+		REQUIRE(wfm->m_startTimestamp == 1700000000);
+
+		//Frames are 1 us apart
+		int64_t delta = wfm->m_startFemtoseconds - filter->GetData(0)->m_startFemtoseconds;
+		REQUIRE(llabs(delta - static_cast<int64_t>(i * 1000000000LL)) < 1000);
+
+		for(size_t j=0; j<depth; j++)
+		{
+			float expected = samples[i*depth + j] * scale + 0.125f;
+			REQUIRE(fabs(wfm->m_samples[j] - expected) < 1e-5);
+		}
+	}
+
+	remove(path.c_str());
+	filter->Release();
+}
+
+TEST_CASE("Filter_WFMImport")
+{
+	SECTION("Normal, 16 bit")
+	{
+		VerifyWFMImport(false, 2, 1);
+	}
+
+	SECTION("Normal, 8 bit")
+	{
+		VerifyWFMImport(false, 1, 1);
+	}
+
+	SECTION("FastFrame, 16 bit")
+	{
+		VerifyWFMImport(false, 2, 5);
+	}
+
+	SECTION("FastFrame, 8 bit")
+	{
+		VerifyWFMImport(false, 1, 5);
+	}
+
+	SECTION("Swapped byte order, 16 bit")
+	{
+		VerifyWFMImport(true, 2, 1);
+	}
+
+	SECTION("Swapped byte order FastFrame, 16 bit")
+	{
+		VerifyWFMImport(true, 2, 5);
+	}
+
+	SECTION("Swapped byte order FastFrame, 8 bit")
+	{
+		VerifyWFMImport(true, 1, 5);
+	}
+
+	SECTION("Truncated curve buffer")
+	{
+		//Write a valid FastFrame file, then chop off the middle of the last frame
+		const size_t depth = 1000;
+		const size_t nframes = 3;
+		vector<int16_t> samples(nframes * depth, 0);
+		string path = "wfmimport-truncated.wfm";
+		WriteWFM(path, false, 2, samples, nframes);
+
+		FILE* fp = fopen(path.c_str(), "rb");
+		REQUIRE(fp != nullptr);
+		vector<uint8_t> buf(1024 * 1024);
+		buf.resize(fread(buf.data(), 1, buf.size(), fp));
+		fclose(fp);
+		buf.resize(buf.size() - depth);
+
+		fp = fopen(path.c_str(), "wb");
+		REQUIRE(fp != nullptr);
+		fwrite(buf.data(), 1, buf.size(), fp);
+		fclose(fp);
+
+		//Frames which are fully present are imported, the partial one is dropped
+		auto filter = new WFMImportFilter("#ffffff");
+		filter->GetParameter("WFM File").SetFileName(path);
+		REQUIRE(filter->GetStreamCount() == nframes - 1);
+		for(size_t i=0; i<filter->GetStreamCount(); i++)
+			REQUIRE(filter->GetData(i)->size() == depth);
+
+		remove(path.c_str());
+		filter->Release();
+	}
+}
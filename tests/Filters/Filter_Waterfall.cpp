@@ -0,0 +1,125 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for Waterfall filter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+TEST_CASE("Filter_Waterfall")
+{
+	//One filter for each implementation, fed the same spectra
+	auto cpuFilter = dynamic_cast<Waterfall*>(Filter::CreateFilter("Waterfall", "#ffffff"));
+	auto gpuFilter = dynamic_cast<Waterfall*>(Filter::CreateFilter("Waterfall", "#ffffff"));
+	REQUIRE(cpuFilter != nullptr);
+	REQUIRE(gpuFilter != nullptr);
+	cpuFilter->AddRef();
+	gpuFilter->AddRef();
+
+	//Create a queue and command buffer
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("Filter_Waterfall.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//Input is a spectrum with one waterfall pixel per bin
+	const size_t depth = 4096;
+	const size_t height = 16;
+	UniformAnalogWaveform ua;
+
+	g_scope->GetOscilloscopeChannel(0)->SetData(&ua, 0);
+	cpuFilter->SetInput("Spectrum", g_scope->GetOscilloscopeChannel(0), true);
+	gpuFilter->SetInput("Spectrum", g_scope->GetOscilloscopeChannel(0), true);
+	cpuFilter->SetHeight(height);
+	gpuFilter->SetHeight(height);
+
+	float vrange = cpuFilter->GetInput(0).GetVoltageRange();
+	float vfs = vrange/2 - cpuFilter->GetInput(0).GetOffset();
+
+	//Run enough lines to wrap the ring buffer a few times
+	vector< vector<float> > expected;
+	for(size_t i=0; i<3*height + 5; i++)
+	{
+		FillRandomWaveform(&ua, depth);
+		ua.PrepareForGpuAccess();
+		ua.PrepareForCpuAccess();
+
+		g_gpuFilterEnabled = false;
+		cpuFilter->Refresh(cmdbuf, queue);
+		g_gpuFilterEnabled = true;
+		gpuFilter->Refresh(cmdbuf, queue);
+
+		vector<float> row(depth);
+		for(size_t j=0; j<depth; j++)
+			row[j] = max(static_cast<float>(1.0 / 255.0), 1 - ( (ua.m_samples[j] - vfs) / -vrange));
+		expected.push_back(row);
+	}
+
+	auto cpuData = dynamic_cast<WaterfallWaveform*>(cpuFilter->GetData(0));
+	auto gpuData = dynamic_cast<WaterfallWaveform*>(gpuFilter->GetData(0));
+	REQUIRE(cpuData != nullptr);
+	REQUIRE(gpuData != nullptr);
+	REQUIRE(cpuData->GetWidth() == depth);
+	REQUIRE(cpuData->GetHeight() == height);
+
+	//Both implementations must agree, including where the ring buffer head is
+	REQUIRE(cpuData->GetRowOffset() == gpuData->GetRowOffset());
+	VerifyMatchingResult(cpuData->GetOutData(), gpuData->GetOutData());
+
+	//Newest line is at the top, older lines below it
+	float* pixels = cpuData->GetData();
+	for(size_t y=0; y<height; y++)
+	{
+		auto& row = expected[expected.size() - height + y];
+		float* line = pixels + cpuData->GetPhysicalRow(y) * depth;
+		for(size_t x=0; x<depth; x++)
+			REQUIRE(line[x] == row[x]);
+	}
+
+	g_scope->GetOscilloscopeChannel(0)->Detach(0);
+
+	cpuFilter->Release();
+	gpuFilter->Release();
+}
@@ -40,5 +40,34 @@ extern std::minstd_rand g_rng;
 
 void FillRandomWaveform(UniformAnalogWaveform* wfm, size_t size, float fmin=-1, float fmax=1);
 void VerifyMatchingResult(AcceleratorBuffer<float>& golden, AcceleratorBuffer<float>& observed, float tolerance = 1e-6f);
+void VerifyMatchingPackets(const std::vector<Packet*>& golden, const std::vector<Packet*>& observed);
+
+/**
+	@brief Verifies that two protocol decodes produced exactly the same symbols
+ */
+template<class T>
+void VerifyMatchingSymbols(SparseWaveform<T>* golden, SparseWaveform<T>* observed)
+{
+	REQUIRE(golden != nullptr);
+	REQUIRE(observed != nullptr);
+	REQUIRE(golden->size() == observed->size());
+
+	golden->PrepareForCpuAccess();
+	observed->PrepareForCpuAccess();
+	size_t len = golden->size();
+
+	for(size_t i=0; i<len; i++)
+	{
+		if( (golden->m_offsets[i] != observed->m_offsets[i]) ||
+			(golden->m_durations[i] != observed->m_durations[i]) ||
+			!(golden->m_samples[i] == observed->m_samples[i]) )
+		{
+			LogError("first fail at i=%zu\n", i);
+			REQUIRE(golden->m_offsets[i] == observed->m_offsets[i]);
+			REQUIRE(golden->m_durations[i] == observed->m_durations[i]);
+			REQUIRE(golden->m_samples[i] == observed->m_samples[i]);
+		}
+	}
+}
 
 #endif
@@ -0,0 +1,164 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ngscopeclient                                                                                                        *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for SParameterResampler
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Filters.h"
+
+using namespace std;
+
+TEST_CASE("SParameterResampler")
+{
+	//Random S-parameters, 1 MHz per point, same as Filter_DeEmbed
+	const size_t npoints = 100000;
+	UniformAnalogWaveform umag;
+	umag.m_timescale = 1e6;
+	umag.m_triggerPhase = 0;
+	UniformAnalogWaveform uang;
+	uang.m_timescale = 1e6;
+	uang.m_triggerPhase = 0;
+	FillRandomWaveform(&umag, npoints, -15, 0);
+	FillRandomWaveform(&uang, npoints, -180, 180);
+	umag.PrepareForCpuAccess();
+	uang.PrepareForCpuAccess();
+	SParameterVector params(&umag, &uang);
+
+	//FFT of a 2M point waveform at 10 Gsps
+	const size_t nouts = 1024*1024 + 1;
+	const float bin_hz = round(5e9f / nouts);
+	const float maxGain = pow(10, 30.0f / 20);
+
+	SParameterResampler::ClearCache();
+
+	SECTION("Interpolation")
+	{
+		//Walking the points must give exactly the same answers as searching for each one
+		vector<float> mag(nouts);
+		vector<float> phase(nouts);
+		params.InterpolateUniform(bin_hz, 0, nouts, mag.data(), phase.data());
+		for(size_t i=0; i<nouts; i++)
+		{
+			auto pt = params.InterpolatePoint(bin_hz * i);
+			REQUIRE(mag[i] == pt.m_amplitude);
+			REQUIRE(phase[i] == pt.m_phase);
+		}
+
+		//Same for a block starting partway through
+		size_t start = nouts / 3;
+		params.InterpolateUniform(bin_hz, start, 1000, mag.data(), phase.data());
+		for(size_t i=0; i<1000; i++)
+		{
+			auto pt = params.InterpolatePoint(bin_hz * (start + i));
+			REQUIRE(mag[i] == pt.m_amplitude);
+			REQUIRE(phase[i] == pt.m_phase);
+		}
+	}
+
+	for(int invert=0; invert<2; invert++)
+	{
+		SECTION(invert ? "DeEmbed" : "ChannelEmulation")
+		{
+			//Baseline: search and libm trig for every bin
+			AcceleratorBuffer<float> goldenSines;
+			AcceleratorBuffer<float> goldenCosines;
+			goldenSines.resize(nouts);
+			goldenCosines.resize(nouts);
+			goldenSines.PrepareForCpuAccess();
+			goldenCosines.PrepareForCpuAccess();
+			double start = GetTime();
+			for(size_t i=0; i<nouts; i++)
+			{
+				auto pt = params.InterpolatePoint(bin_hz * i);
+				float amp = pt.m_amplitude;
+				float ang = pt.m_phase;
+				if(invert)
+				{
+					amp = 0;
+					if(fabs(pt.m_amplitude) > FLT_EPSILON)
+						amp = 1.0f / pt.m_amplitude;
+					amp = min(amp, maxGain);
+					ang = -ang;
+				}
+
+				goldenSines[i] = sin(ang) * amp;
+				goldenCosines[i] = cos(ang) * amp;
+			}
+			double tbase = GetTime() - start;
+			goldenSines.MarkModifiedFromCpu();
+			goldenCosines.MarkModifiedFromCpu();
+			LogVerbose("Baseline      : %6.2f ms\n", tbase * 1000);
+
+			AcceleratorBuffer<float> sines;
+			AcceleratorBuffer<float> cosines;
+			start = GetTime();
+			SParameterResampler::Resample(params, bin_hz, nouts, invert, maxGain, sines, cosines);
+			double dt = GetTime() - start;
+			LogVerbose("Resampler     : %6.2f ms, %.2fx speedup\n", dt * 1000, tbase / dt);
+			REQUIRE(SParameterResampler::GetCacheSize() == 1);
+
+			float tolerance = invert ? 1e-4f : 1e-6f;
+			VerifyMatchingResult(goldenSines, sines, tolerance);
+			VerifyMatchingResult(goldenCosines, cosines, tolerance);
+
+			//Second time around should come from the cache, into a different buffer, with identical results
+			AcceleratorBuffer<float> cachedSines;
+			AcceleratorBuffer<float> cachedCosines;
+			start = GetTime();
+			SParameterResampler::Resample(params, bin_hz, nouts, invert, maxGain, cachedSines, cachedCosines);
+			dt = GetTime() - start;
+			LogVerbose("Cached        : %6.2f ms, %.2fx speedup\n", dt * 1000, tbase / dt);
+			REQUIRE(SParameterResampler::GetCacheSize() == 1);
+			VerifyMatchingResult(sines, cachedSines, FLT_MIN);
+			VerifyMatchingResult(cosines, cachedCosines, FLT_MIN);
+
+			//Any change to the key must not hit the cached result
+			SParameterResampler::Resample(params, bin_hz * 2, nouts, invert, maxGain, cachedSines, cachedCosines);
+			REQUIRE(SParameterResampler::GetCacheSize() == 2);
+			SParameterResampler::Resample(params, bin_hz, nouts, !invert, maxGain, cachedSines, cachedCosines);
+			REQUIRE(SParameterResampler::GetCacheSize() == 3);
+
+			params[npoints/2].m_amplitude *= 0.5;
+			SParameterResampler::Resample(params, bin_hz, nouts, invert, maxGain, cachedSines, cachedCosines);
+			REQUIRE(SParameterResampler::GetCacheSize() == 4);
+		}
+	}
+
+	SParameterResampler::ClearCache();
+}
@@ -87,6 +87,16 @@ public:
 			Unit(Unit::UNIT_FS),
 			Unit(Unit::UNIT_VOLTS),
 			Stream::STREAM_TYPE_DIGITAL));
+		g_scope->AddChannel(new OscilloscopeChannel(
+			g_scope, "D2", "#ffffffff",
+			Unit(Unit::UNIT_FS),
+			Unit(Unit::UNIT_VOLTS),
+			Stream::STREAM_TYPE_DIGITAL));
+		g_scope->AddChannel(new OscilloscopeChannel(
+			g_scope, "D3", "#ffffffff",
+			Unit(Unit::UNIT_FS),
+			Unit(Unit::UNIT_VOLTS),
+			Stream::STREAM_TYPE_DIGITAL));
 
 	}
 
@@ -146,3 +156,17 @@ void VerifyMatchingResult(AcceleratorBuffer<float>& golden, AcceleratorBuffer<fl
 		REQUIRE(delta < tolerance);
 	}
 }
+
+void VerifyMatchingPackets(const vector<Packet*>& golden, const vector<Packet*>& observed)
+{
+	REQUIRE(golden.size() == observed.size());
+
+	for(size_t i=0; i<golden.size(); i++)
+	{
+		REQUIRE(golden[i]->m_offset == observed[i]->m_offset);
+		REQUIRE(golden[i]->m_len == observed[i]->m_len);
+		REQUIRE(golden[i]->m_headers == observed[i]->m_headers);
+		REQUIRE(golden[i]->m_data == observed[i]->m_data);
+		REQUIRE(golden[i]->m_displayBackgroundColor == observed[i]->m_displayBackgroundColor);
+	}
+}
@@ -0,0 +1,222 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Trigger rate benchmark for the acquisition / processing / UI pipeline, using DemoOscilloscope
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopehal/DemoOscilloscope.h"
+#include "Primitives.h"
+#include <condition_variable>
+#include <thread>
+
+using namespace std;
+
+/**
+	@brief Detaches every waveform from a scope's channels without freeing them, like TriggerGroup::DetachAllWaveforms()
+ */
+static void DetachAllWaveforms(Oscilloscope& scope)
+{
+	for(size_t i=0; i<scope.GetChannelCount(); i++)
+	{
+		auto chan = scope.GetOscilloscopeChannel(i);
+		if(!chan)
+			continue;
+		for(size_t j=0; j<chan->GetStreamCount(); j++)
+			chan->Detach(j);
+	}
+}
+
+/**
+	@brief Runs DemoOscilloscope through the same three thread pipeline ngscopeclient uses, and measures the trigger rate
+
+	* The instrument thread polls the trigger and calls AcquireData(), keeping at most five waveforms pending, like
+	  InstrumentThread.
+	* The waveform thread pops each acquisition, touches every sample (standing in for the filter graph), then hands
+	  the waveforms off to the UI thread. It only blocks once pipelineDepth acquisitions are waiting, like
+	  WaveformThread and Session::IsProcessingPipelineFull().
+	* The UI thread wakes once per frame and moves everything waiting into "history", like
+	  Session::CheckForWaveforms().
+
+	@param scope			The instrument
+	@param pipelineDepth	Number of acquisitions the waveform thread may process ahead of the UI thread
+	@param frameTime		Time between UI frames, in seconds
+	@param duration			How long to run for, in seconds
+	@param stamps			Timestamps of every acquisition the UI thread received, in the order received
+
+	@return Triggers per second reaching the UI thread
+ */
+static double MeasureTriggerRate(
+	DemoOscilloscope& scope,
+	size_t pipelineDepth,
+	double frameTime,
+	double duration,
+	vector<pair<time_t, int64_t>>& stamps)
+{
+	atomic<bool> done(false);
+	mutex pendingMutex;
+	condition_variable pendingCond;
+	deque<vector<WaveformBase*>> pending;
+	float checksum = 0;
+
+	scope.Start();
+
+	thread instrumentThread([&]
+	{
+		while(!done)
+		{
+			if(scope.GetPendingWaveformCount() > 5)
+				this_thread::sleep_for(chrono::milliseconds(1));
+			else if(scope.IsTriggerArmed() && (scope.PollTrigger() == Oscilloscope::TRIGGER_MODE_TRIGGERED))
+				scope.AcquireData();
+			else
+				scope.WaitForTriggerActivity(chrono::milliseconds(10));
+		}
+	});
+
+	thread waveformThread([&]
+	{
+		while(!done)
+		{
+			if(!scope.HasPendingWaveforms())
+			{
+				this_thread::sleep_for(chrono::microseconds(100));
+				continue;
+			}
+
+			//Detach the previous waveforms (the UI thread owns them now), then grab the new ones
+			DetachAllWaveforms(scope);
+			scope.PopPendingWaveform();
+
+			//Stand-in for the filter graph: read every sample
+			vector<WaveformBase*> acquisition;
+			for(size_t i=0; i<scope.GetChannelCount(); i++)
+			{
+				auto chan = scope.GetOscilloscopeChannel(i);
+				if(!chan)
+					continue;
+				for(size_t j=0; j<chan->GetStreamCount(); j++)
+				{
+					auto data = chan->GetData(j);
+					if(!data)
+						continue;
+					acquisition.push_back(data);
+
+					auto uadata = dynamic_cast<UniformAnalogWaveform*>(data);
+					if(!uadata)
+						continue;
+					uadata->PrepareForCpuAccess();
+					for(size_t k=0; k<uadata->size(); k++)
+						checksum += uadata->m_samples[k];
+				}
+			}
+			if(acquisition.empty())
+				continue;
+
+			//Hand off, and only wait if the UI thread has fallen too far behind
+			unique_lock<mutex> lock(pendingMutex);
+			pending.push_back(acquisition);
+			pendingCond.wait(lock, [&]{ return done || (pending.size() < pipelineDepth); });
+		}
+	});
+
+	size_t count = 0;
+	double start = GetTime();
+	while( (GetTime() - start) < duration)
+	{
+		this_thread::sleep_for(chrono::duration<double>(frameTime));
+
+		deque<vector<WaveformBase*>> frame;
+		{
+			lock_guard<mutex> lock(pendingMutex);
+			frame.swap(pending);
+		}
+		pendingCond.notify_all();
+
+		for(auto& acquisition : frame)
+		{
+			stamps.push_back(pair<time_t, int64_t>(acquisition[0]->m_startTimestamp, acquisition[0]->m_startFemtoseconds));
+			for(auto w : acquisition)
+				delete w;
+			count ++;
+		}
+	}
+	double dt = GetTime() - start;
+
+	//Shut down and clean up everything still in flight
+	done = true;
+	pendingCond.notify_all();
+	scope.Stop();
+	instrumentThread.join();
+	waveformThread.join();
+
+	for(auto& acquisition : pending)
+	{
+		for(auto w : acquisition)
+			delete w;
+	}
+	scope.ClearPendingWaveforms();
+
+	//The last waveforms popped were already handed off above, so just let go of them
+	DetachAllWaveforms(scope);
+
+	LogTrace("Sample checksum: %f\n", checksum);
+
+	return count / dt;
+}
+
+TEST_CASE("Primitive_AcquisitionPipeline")
+{
+	DemoOscilloscope scope(new SCPINullTransport(""));
+	scope.SetSampleDepth(10000);
+
+	//UI frames at 60 Hz
+	const double frameTime = 1.0 / 60;
+	const double duration = 1;
+
+	for(size_t depth : {1, 2, 4})
+	{
+		vector<pair<time_t, int64_t>> stamps;
+		double rate = MeasureTriggerRate(scope, depth, frameTime, duration, stamps);
+		LogVerbose("Pipeline depth %zu: %7.1f triggers/sec\n", depth, rate);
+
+		//Every acquisition must reach the UI exactly once, in trigger order
+		REQUIRE(!stamps.empty());
+		for(size_t i=1; i<stamps.size(); i++)
+			REQUIRE(stamps[i-1] < stamps[i]);
+	}
+}
@@ -0,0 +1,274 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Golden image test comparing the CPU rasterizer against waveform-compute.glsl
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+
+using namespace std;
+
+/**
+	@brief Rasterizes a waveform with both the CPU and the shader and checks that the images match
+
+	Configuration is computed the same way as WaveformArea::RasterizeAnalogOrDigitalWaveform() does it, with the
+	view starting at the beginning of the waveform.
+ */
+static void CompareRasterizers(
+	vk::raii::CommandBuffer& cmdbuf,
+	shared_ptr<QueueHandle> queue,
+	WaveformBase* data,
+	float pixelsPerX,
+	bool histogram,
+	bool zeroHold)
+{
+	const uint32_t w = 640;
+	const uint32_t h = 256;
+
+	auto sdata = dynamic_cast<SparseWaveformBase*>(data);
+	bool digital =
+		(dynamic_cast<UniformDigitalWaveform*>(data) != nullptr) ||
+		(dynamic_cast<SparseDigitalWaveform*>(data) != nullptr);
+
+	//Pick the same shader variant WaveformArea would
+	string path = "shaders/waveform-compute.";
+	if(digital)
+		path += "digital";
+	else if(histogram)
+		path += "histogram";
+	else
+		path += "analog";
+	if(zeroHold && !digital)
+		path += ".zerohold";
+	if(g_hasShaderInt64)
+		path += ".int64";
+	if(!sdata)
+		path += ".dense";
+	path += ".spv";
+	int nbufs = 2;
+	if(sdata)
+		nbufs = (zeroHold && !digital) ? 5 : 4;
+	ComputePipeline pipe(path, nbufs, sizeof(ConfigPushConstants));
+
+	//X axis index buffer
+	double xscale = data->m_timescale * pixelsPerX;
+	AcceleratorBuffer<uint32_t> ibuf;
+	if(sdata)
+	{
+		ibuf.resize(w);
+		ibuf.PrepareForCpuAccess();
+		sdata->m_offsets.PrepareForCpuAccess();
+		for(size_t i=0; i<w; i++)
+		{
+			int64_t target = floor(i / xscale);
+			ibuf[i] = BinarySearchForGequal(sdata->m_offsets.GetCpuPointer(), data->size(), target);
+		}
+		ibuf.MarkModifiedFromCpu();
+	}
+
+	ConfigPushConstants config;
+	config.innerXoff = 0;
+	config.windowHeight = h;
+	config.windowWidth = w;
+	config.memDepth = data->size();
+	config.offset_samples = -2;
+	config.alpha = 0.25;
+	config.xoff = 0;
+	config.xscale = xscale;
+	if(digital)
+	{
+		config.yoff = 0;
+		config.yscale = h - 1;
+		config.ybase = 0;
+	}
+	else
+	{
+		config.yscale = h * 0.4f;
+		config.yoff = 0;
+		config.ybase = histogram ? 0 : h * 0.5f;
+	}
+	config.persistScale = 0;
+
+	//Software
+	AcceleratorBuffer<float> cpuOut;
+	cpuOut.resize(w*h);
+	cpuOut.PrepareForCpuAccess();
+	data->PrepareForCpuAccess();
+	double start = GetTime();
+	RasterizeWaveformCPU(config, data, sdata ? ibuf.GetCpuPointer() : nullptr, histogram, zeroHold, cpuOut.GetCpuPointer());
+	double tcpu = GetTime() - start;
+
+	//Shader
+	AcceleratorBuffer<float> gpuOut;
+	gpuOut.resize(w*h);
+	data->PrepareForGpuAccess();
+	cmdbuf.begin({});
+	pipe.BindBufferNonblocking(0, gpuOut, cmdbuf, true);
+	if(auto u = dynamic_cast<UniformAnalogWaveform*>(data))
+		pipe.BindBufferNonblocking(1, u->m_samples, cmdbuf);
+	else if(auto s = dynamic_cast<SparseAnalogWaveform*>(data))
+		pipe.BindBufferNonblocking(1, s->m_samples, cmdbuf);
+	else if(auto ud = dynamic_cast<UniformDigitalWaveform*>(data))
+		pipe.BindBufferNonblocking(1, ud->m_samples, cmdbuf);
+	else if(auto sd = dynamic_cast<SparseDigitalWaveform*>(data))
+		pipe.BindBufferNonblocking(1, sd->m_samples, cmdbuf);
+	if(sdata)
+	{
+		pipe.BindBufferNonblocking(2, sdata->m_offsets, cmdbuf);
+		pipe.BindBufferNonblocking(3, ibuf, cmdbuf);
+		if(nbufs == 5)
+			pipe.BindBufferNonblocking(4, sdata->m_durations, cmdbuf);
+	}
+	start = GetTime();
+	pipe.Dispatch(cmdbuf, config, w, 1, 1);
+	cmdbuf.end();
+	queue->SubmitAndBlock(cmdbuf);
+	double tgpu = GetTime() - start;
+	gpuOut.MarkModifiedFromGpu();
+	gpuOut.PrepareForCpuAccess();
+
+	LogVerbose("%-50s CPU %6.2f ms, GPU %6.2f ms\n", path.c_str(), tcpu * 1000, tgpu * 1000);
+
+	//The two implementations do the same float math, but the shader compiler may contract or reorder it.
+	//Allow a handful of pixels at segment endpoints to land one row over, but nothing more.
+	size_t mismatches = 0;
+	float total = 0;
+	for(size_t i=0; i<w*h; i++)
+	{
+		total += gpuOut[i];
+		if(fabs(cpuOut[i] - gpuOut[i]) > 1e-4f * max(1.0f, fabs(gpuOut[i])))
+			mismatches ++;
+	}
+	LogVerbose("%zu of %u pixels differ\n", mismatches, w*h);
+	REQUIRE(total > 0);
+	REQUIRE(mismatches <= (w*h) / 1000);
+}
+
+TEST_CASE("Primitive_CpuRasterizer")
+{
+	//Create a queue and command buffer
+	shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("Primitive_CpuRasterizer.queue"));
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		queue->m_family );
+	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+
+	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
+	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+
+	//Random walk plus noise, so columns contain both steep and flat regions
+	const size_t depth = 200000;
+	normal_distribution<float> noise(0, 0.05);
+	uniform_int_distribution<int64_t> gap(1, 5);
+	bernoulli_distribution toggle(0.02);
+
+	UniformAnalogWaveform ua;
+	SparseAnalogWaveform sa;
+	UniformDigitalWaveform ud;
+	SparseDigitalWaveform sd;
+	for(WaveformBase* p : initializer_list<WaveformBase*>{&ua, &sa, &ud, &sd})
+	{
+		p->m_timescale = 1;
+		p->m_triggerPhase = 0;
+		p->Resize(depth);
+		p->PrepareForCpuAccess();
+	}
+
+	float v = 0;
+	bool b = false;
+	int64_t t = 0;
+	for(size_t i=0; i<depth; i++)
+	{
+		v = v*0.999f + noise(g_rng);
+		if(toggle(g_rng))
+			b = !b;
+		int64_t dt = gap(g_rng);
+
+		ua.m_samples[i] = v;
+		ud.m_samples[i] = b;
+
+		sa.m_samples[i] = v;
+		sa.m_offsets[i] = t;
+		sa.m_durations[i] = dt;
+
+		sd.m_samples[i] = b;
+		sd.m_offsets[i] = t;
+		sd.m_durations[i] = dt;
+
+		t += dt;
+	}
+	for(WaveformBase* p : initializer_list<WaveformBase*>{&ua, &sa, &ud, &sd})
+		p->MarkModifiedFromCpu();
+
+	//Histograms are drawn from uniform waveforms with non-negative bin counts
+	UniformAnalogWaveform hist;
+	hist.m_timescale = 1;
+	hist.m_triggerPhase = 0;
+	hist.Resize(depth);
+	hist.PrepareForCpuAccess();
+	for(size_t i=0; i<depth; i++)
+		hist.m_samples[i] = fabs(ua.m_samples[i]);
+	hist.MarkModifiedFromCpu();
+
+	//Zoomed far out (hundreds of samples per pixel) and zoomed in (several pixels per sample)
+	for(float pixelsPerX : {0.003f, 4.0f})
+	{
+		SECTION(string("Uniform analog, ") + to_string(pixelsPerX) + " px/tick")
+		{
+			CompareRasterizers(cmdbuf, queue, &ua, pixelsPerX, false, false);
+			CompareRasterizers(cmdbuf, queue, &ua, pixelsPerX, false, true);
+		}
+		SECTION(string("Histogram, ") + to_string(pixelsPerX) + " px/tick")
+		{
+			CompareRasterizers(cmdbuf, queue, &hist, pixelsPerX, true, false);
+		}
+		SECTION(string("Sparse analog, ") + to_string(pixelsPerX) + " px/tick")
+		{
+			CompareRasterizers(cmdbuf, queue, &sa, pixelsPerX, false, false);
+			CompareRasterizers(cmdbuf, queue, &sa, pixelsPerX, false, true);
+		}
+		SECTION(string("Uniform digital, ") + to_string(pixelsPerX) + " px/tick")
+		{
+			CompareRasterizers(cmdbuf, queue, &ud, pixelsPerX, false, false);
+		}
+		SECTION(string("Sparse digital, ") + to_string(pixelsPerX) + " px/tick")
+		{
+			CompareRasterizers(cmdbuf, queue, &sd, pixelsPerX, false, false);
+		}
+	}
+}
@@ -0,0 +1,141 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit tests for ExportWriter
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+#include <cmath>
+
+using namespace std;
+
+static string Sprintf(const char* format, double value)
+{
+	char tmp[512];
+	snprintf(tmp, sizeof(tmp), format, value);
+	return tmp;
+}
+
+TEST_CASE("Primitive_ExportWriter")
+{
+	SECTION("Formatting")
+	{
+		//Must match printf exactly, including rounding, signs, and special values
+		vector<double> values =
+		{
+			0, -0.0, 1, -1, 0.5, 1.5, 2.5, 0.0000005, 0.0000015, -0.0000005, 123456789.123456789,
+			1e-300, 1e300, DBL_MAX, -DBL_MAX, FLT_MAX, FLT_MIN, INFINITY, -INFINITY
+		};
+
+		auto edist = uniform_real_distribution<double>(-20, 20);
+		auto mdist = uniform_real_distribution<double>(-10, 10);
+		for(size_t i=0; i<100000; i++)
+			values.push_back(mdist(g_rng) * pow(10, edist(g_rng)));
+
+		//Analog samples are floats promoted to double
+		for(size_t i=0; i<100000; i++)
+			values.push_back(static_cast<float>(mdist(g_rng) * pow(10, edist(g_rng))));
+
+		for(auto v : values)
+		{
+			string str;
+			ExportWriter::AppendFixed(str, v);
+			REQUIRE(str == Sprintf("%f", v));
+
+			str.clear();
+			ExportWriter::AppendScientific(str, v, 10);
+			REQUIRE(str == Sprintf("%.10e", v));
+		}
+
+		for(int64_t v : {int64_t(0), int64_t(-1), int64_t(1234567890123), INT64_MIN, INT64_MAX})
+		{
+			string str;
+			ExportWriter::AppendInteger(str, v);
+			REQUIRE(str == to_string(v));
+		}
+	}
+
+	SECTION("Write")
+	{
+		//Write enough data in odd sized pieces to fill the queue several times over
+		string path = "exportwriter-test.bin";
+		string expected;
+		{
+			ExportWriter writer;
+			REQUIRE(writer.Open(path, false));
+			REQUIRE(writer.GetSize() == 0);
+
+			auto ldist = uniform_int_distribution<size_t>(1, 100000);
+			auto bdist = uniform_int_distribution<int>(0, 255);
+			while(expected.size() < 6 * ExportWriter::MAX_QUEUED_BUFFERS * ExportWriter::BUFFER_SIZE)
+			{
+				string chunk(ldist(g_rng), '\0');
+				for(auto& c : chunk)
+					c = bdist(g_rng);
+				writer.Write(chunk);
+				expected += chunk;
+			}
+			REQUIRE(writer.GetSize() == expected.size());
+			REQUIRE(writer.Flush());
+
+			//Appending after a flush
+			writer.Write("tail");
+			expected += "tail";
+			REQUIRE(writer.Close());
+		}
+
+		//Reopen in append mode
+		{
+			ExportWriter writer;
+			REQUIRE(writer.Open(path, true));
+			REQUIRE(writer.GetSize() == expected.size());
+			uint32_t magic = 0xdeadbeef;
+			writer.WriteObject(magic);
+			expected.append(reinterpret_cast<char*>(&magic), sizeof(magic));
+		}
+
+		FILE* fp = fopen(path.c_str(), "rb");
+		REQUIRE(fp != nullptr);
+		string readback(expected.size() + 1, '\0');
+		readback.resize(fread(&readback[0], 1, readback.size(), fp));
+		fclose(fp);
+		remove(path.c_str());
+
+		REQUIRE(readback == expected);
+	}
+}
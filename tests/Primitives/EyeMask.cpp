@@ -0,0 +1,179 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for EyeMask hit testing
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopehal/EyeWaveform.h"
+#include "../../lib/scopehal/EyeMask.h"
+#include "Primitives.h"
+
+using namespace std;
+
+static size_t FillSyntheticEye(EyeWaveform& eye, float uiWidth);
+
+TEST_CASE("Primitive_EyeMask")
+{
+	auto maskpath = FindDataFile("masks/pcie-gen2-5gbps-rx.yml");
+	REQUIRE(maskpath != "");
+
+	EyeMask mask;
+	REQUIRE(mask.Load(maskpath));
+
+	const float range = 0.7;
+	const float uiWidth = 200000;
+	const size_t height = 96;
+
+	//Try a width that isn't a multiple of the bitmap word size as well as one that is
+	size_t widths[2] = {100, 256};
+
+	SECTION("HitRate")
+	{
+		for(auto width : widths)
+		{
+			LogVerbose("%zu x %zu\n", width, height);
+			LogIndenter li;
+
+			EyeWaveform eye(width, height, 0, EyeWaveform::EYE_NORMAL);
+			FillSyntheticEye(eye, uiWidth);
+			float xscale = width / (2*uiWidth);
+			float xoff = -uiWidth;
+
+			auto rate = mask.CalculateHitRate(&eye, width, height, range, xscale, xoff);
+
+			//Compare against a straightforward scan of the rendered image
+			vector<uint8_t> pixels;
+			mask.GetPixels(pixels);
+			REQUIRE(pixels.size() == width*height*4);
+			auto accum = eye.GetAccumData();
+			int64_t nhits = 0;
+			size_t nmasked = 0;
+			for(size_t y=0; y<height; y++)
+			{
+				for(size_t x=0; x<width; x++)
+				{
+					bool masked = (pixels[(y*width + x)*4] != 0);
+					REQUIRE(mask.IsMasked(x, y) == masked);
+					if(masked)
+					{
+						nhits += accum[y*width + x];
+						nmasked ++;
+					}
+				}
+			}
+			LogVerbose("%zu pixels in mask\n", nmasked);
+			REQUIRE(nmasked > 0);
+
+			float expected = nhits * 1.0 / (eye.GetTotalSamples() * EYE_ACCUM_SCALE);
+			LogVerbose("Hit rate: %e (expected %e)\n", rate, expected);
+			REQUIRE(rate == expected);
+
+			//Padding bits at the end of each row must be clear
+			auto& bitmap = mask.GetBitmap();
+			size_t wordsPerRow = mask.GetWordsPerRow();
+			REQUIRE(bitmap.size() == wordsPerRow * height);
+			for(size_t y=0; y<height; y++)
+			{
+				for(size_t x=width; x<wordsPerRow*64; x++)
+					REQUIRE( ((bitmap[y*wordsPerRow + x/64] >> (x%64)) & 1) == 0);
+			}
+		}
+	}
+
+	SECTION("Caching")
+	{
+		size_t width = widths[0];
+		EyeWaveform eye(width, height, 0, EyeWaveform::EYE_NORMAL);
+		size_t nsamples = FillSyntheticEye(eye, uiWidth);
+		float xscale = width / (2*uiWidth);
+		float xoff = -uiWidth;
+
+		//First call renders, subsequent calls with the same geometry reuse the bitmap
+		REQUIRE(mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+		REQUIRE(!mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+
+		//Adding more data to the eye shouldn't need a re-render, but has to be reflected in the hit rate
+		auto rate1 = mask.CalculateHitRate(&eye, width, height, range, xscale, xoff);
+		auto accum = eye.GetAccumData();
+		for(size_t i=0; i<width*height; i++)
+			accum[i] *= 2;
+		eye.IntegrateUIs(nsamples / 32, nsamples);
+		REQUIRE(!mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+		auto rate2 = mask.CalculateHitRate(&eye, width, height, range, xscale, xoff);
+		REQUIRE(rate2 == rate1);
+
+		//Changing any of the geometry should re-render
+		REQUIRE(mask.UpdateBitmap(&eye, width, height, range * 2, xscale, xoff));
+		REQUIRE(mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+		REQUIRE(mask.UpdateBitmap(&eye, width, height, range, xscale * 0.9, xoff));
+		REQUIRE(mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+		REQUIRE(!mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+
+		//This mask is specified in UIs, so the UI width matters too
+		eye.m_uiWidth = uiWidth * 1.1;
+		REQUIRE(mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+		eye.m_uiWidth = uiWidth;
+		REQUIRE(mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+
+		//and so should reloading the mask
+		REQUIRE(mask.Load(maskpath));
+		REQUIRE(mask.UpdateBitmap(&eye, width, height, range, xscale, xoff));
+	}
+}
+
+/**
+	@brief Fills an eye with random counts in every pixel
+
+	@return Number of samples integrated
+ */
+static size_t FillSyntheticEye(EyeWaveform& eye, float uiWidth)
+{
+	eye.m_uiWidth = uiWidth;
+	auto accum = eye.GetAccumData();
+	size_t npixels = eye.GetWidth() * eye.GetHeight();
+	uniform_int_distribution<int64_t> dist(0, 1000);
+	int64_t total = 0;
+	for(size_t i=0; i<npixels; i++)
+	{
+		accum[i] = dist(g_rng);
+		total += accum[i];
+	}
+	size_t nsamples = total / EYE_ACCUM_SCALE + 1;
+	eye.IntegrateUIs(nsamples / 32, nsamples);
+	return nsamples;
+}
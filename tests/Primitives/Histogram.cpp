@@ -0,0 +1,147 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for Histogram
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+#include <omp.h>
+
+using namespace std;
+
+TEST_CASE("Primitive_Histogram")
+{
+	#ifdef __x86_64__
+	bool reallyHasAvx2 = g_hasAvx2;
+	#endif
+
+	//Deep enough to be split into chunks, and deliberately not a multiple of the vector size.
+	//Range is narrower than the data so some samples fall outside it on both ends
+	const size_t n = 4000003;
+	const size_t nbins = 100;
+	const float low = -0.8;
+	const float high = 0.9;
+
+	vector<float> input(n);
+	normal_distribution<float> dist(0, 0.4);
+	for(size_t i=0; i<n; i++)
+		input[i] = dist(g_rng);
+	input[17] = NAN;
+
+	//Reference results from straightforward scalar loops
+	vector<size_t> clamped(nbins, 0);
+	vector<size_t> clipped(nbins, 0);
+	size_t nclipped = 0;
+	float vmin = FLT_MAX;
+	float vmax = -FLT_MAX;
+	float delta = high - low;
+	for(auto v : input)
+	{
+		if(v < vmin)
+			vmin = v;
+		if(v > vmax)
+			vmax = v;
+
+		float fbin = (v - low) / delta;
+		float fidx = floor(fbin * nbins);
+		if(fbin < 0)
+			clamped[0] ++;
+		else if(isnan(fidx) || (fidx >= nbins-1) )
+			clamped[nbins-1] ++;
+		else
+			clamped[static_cast<size_t>(fidx)] ++;
+
+		if( (fidx >= 0) && (fidx < nbins) )
+		{
+			clipped[static_cast<size_t>(fidx)] ++;
+			nclipped ++;
+		}
+	}
+
+	int nthreads = omp_get_max_threads();
+	for(int avx=0; avx<2; avx++)
+	{
+		#ifdef __x86_64__
+		if(avx && !reallyHasAvx2)
+			continue;
+		g_hasAvx2 = avx;
+		#else
+		if(avx)
+			continue;
+		#endif
+
+		for(int threads : {1, nthreads})
+		{
+			omp_set_num_threads(threads);
+
+			Histogram hclamp(low, high, nbins, Histogram::RANGE_CLAMP);
+			double start = GetTime();
+			hclamp.Add(input.data(), n);
+			LogVerbose("Clamped, %s, %d threads: %.3f ms\n", avx ? "AVX2" : "generic", threads, (GetTime() - start) * 1000);
+			REQUIRE(hclamp.GetBins() == clamped);
+			REQUIRE(hclamp.GetCount() == n);
+			REQUIRE(hclamp.GetMin() == vmin);
+			REQUIRE(hclamp.GetMax() == vmax);
+
+			Histogram hclip(low, high, nbins, Histogram::RANGE_CLIP);
+			hclip.Add(input.data(), n);
+			REQUIRE(hclip.GetBins() == clipped);
+			REQUIRE(hclip.GetCount() == nclipped);
+			REQUIRE(hclip.GetMin() == vmin);
+			REQUIRE(hclip.GetMax() == vmax);
+
+			//Adding the data in two pieces must give the same result
+			hclip.Clear();
+			hclip.Add(input.data(), n/3);
+			hclip.Add(input.data() + n/3, n - n/3);
+			REQUIRE(hclip.GetBins() == clipped);
+			REQUIRE(hclip.GetCount() == nclipped);
+
+			float gmin;
+			float gmax;
+			Histogram::GetMinMax(input.data(), n, gmin, gmax);
+			REQUIRE(gmin == vmin);
+			REQUIRE(gmax == vmax);
+		}
+	}
+
+	omp_set_num_threads(nthreads);
+	#ifdef __x86_64__
+	g_hasAvx2 = reallyHasAvx2;
+	#endif
+}
@@ -0,0 +1,149 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for QuadratureOscillator
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+#include <omp.h>
+
+using namespace std;
+
+TEST_CASE("Primitive_QuadratureOscillator")
+{
+	//Deliberately not a multiple of the vector, reseed, or chunk sizes
+	const size_t n = 1000003;
+	const int64_t timescale = 25000;		//40 Gsps
+	const int64_t triggerPhase = 1234;
+	const double freq = 2.4e9 + 12345;
+	const double phase = 0.3;
+
+	QuadratureOscillator lo(freq, phase);
+
+	vector<float> input(n);
+	uniform_real_distribution<float> dist(-1, 1);
+	for(size_t i=0; i<n; i++)
+		input[i] = dist(g_rng);
+
+	SECTION("SinCos")
+	{
+		const size_t nx = 100003;
+		uniform_real_distribution<float> xdist(-4*M_PI, 4*M_PI);
+		vector<float> x(nx);
+		for(size_t i=0; i<nx; i++)
+			x[i] = xdist(g_rng);
+
+		vector<float> sines(nx);
+		vector<float> cosines(nx);
+		QuadratureOscillator::SinCos(x.data(), sines.data(), cosines.data(), nx);
+		for(size_t i=0; i<nx; i++)
+		{
+			REQUIRE(fabs(sines[i] - sin(x[i])) < 1e-6);
+			REQUIRE(fabs(cosines[i] - cos(x[i])) < 1e-6);
+		}
+	}
+
+	SECTION("Uniform")
+	{
+		vector<float> sines(n);
+		vector<float> cosines(n);
+
+		double start = GetTime();
+		lo.Generate(sines.data(), cosines.data(), n, timescale, triggerPhase);
+		LogVerbose("Generate: %.3f ms\n", (GetTime() - start) * 1000);
+
+		//Compare against libm in double precision, using the absolute time of each sample
+		double rad_per_fs = 2 * M_PI * freq / FS_PER_SECOND;
+		for(size_t i=0; i<n; i++)
+		{
+			double p = phase + rad_per_fs * (static_cast<double>(i) * timescale + triggerPhase);
+			REQUIRE(fabs(sines[i] - sin(p)) < 1e-6);
+			REQUIRE(fabs(cosines[i] - cos(p)) < 1e-6);
+		}
+
+		//Output must not depend on how many threads did the work
+		int nthreads = omp_get_max_threads();
+		omp_set_num_threads(1);
+		vector<float> sines1(n);
+		vector<float> cosines1(n);
+		start = GetTime();
+		lo.Generate(sines1.data(), cosines1.data(), n, timescale, triggerPhase);
+		LogVerbose("Generate (1 thread): %.3f ms\n", (GetTime() - start) * 1000);
+		omp_set_num_threads(nthreads);
+
+		REQUIRE(sines1 == sines);
+		REQUIRE(cosines1 == cosines);
+
+		//Mixing must be the same as generating and multiplying
+		vector<float> iout(n);
+		vector<float> qout(n);
+		lo.MixUniform(input.data(), iout.data(), qout.data(), n, timescale, triggerPhase);
+		for(size_t i=0; i<n; i++)
+		{
+			REQUIRE(iout[i] == input[i] * sines[i]);
+			REQUIRE(qout[i] == input[i] * cosines[i]);
+		}
+	}
+
+	SECTION("Sparse")
+	{
+		//Random timestamps, increasing by 1-4 samples each
+		vector<int64_t> offsets(n);
+		uniform_int_distribution<int64_t> stepdist(1, 4);
+		int64_t t = 0;
+		for(size_t i=0; i<n; i++)
+		{
+			offsets[i] = t;
+			t += stepdist(g_rng);
+		}
+
+		vector<float> iout(n);
+		vector<float> qout(n);
+		double start = GetTime();
+		lo.MixSparse(input.data(), offsets.data(), iout.data(), qout.data(), n, timescale, triggerPhase);
+		LogVerbose("MixSparse: %.3f ms\n", (GetTime() - start) * 1000);
+
+		double rad_per_fs = 2 * M_PI * freq / FS_PER_SECOND;
+		for(size_t i=0; i<n; i++)
+		{
+			double p = phase + rad_per_fs * (static_cast<double>(offsets[i]) * timescale + triggerPhase);
+			REQUIRE(fabs(iout[i] - input[i]*sin(p)) < 1e-6);
+			REQUIRE(fabs(qout[i] - input[i]*cos(p)) < 1e-6);
+		}
+	}
+}
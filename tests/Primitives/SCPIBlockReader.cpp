@@ -0,0 +1,175 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for SCPITransport IEEE 488.2 block reading
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+
+using namespace std;
+
+/**
+	@brief Transport which serves canned reply data from memory
+ */
+class MemoryTransport : public SCPITransport
+{
+public:
+	MemoryTransport(const string& data)
+		: m_data(data)
+		, m_pos(0)
+	{}
+
+	virtual string GetConnectionString() override
+	{ return ""; }
+
+	virtual string GetName() override
+	{ return "memory"; }
+
+	virtual bool SendCommand(const string& /*cmd*/) override
+	{ return true; }
+
+	virtual string ReadReply(bool /*endOnSemicolon*/, function<void(float)> /*progress*/) override
+	{
+		string ret = m_data.substr(m_pos);
+		m_pos = m_data.size();
+		return ret;
+	}
+
+	virtual size_t ReadRawData(size_t len, unsigned char* buf, function<void(float)> /*progress*/) override
+	{
+		len = min(len, m_data.size() - m_pos);
+		memcpy(buf, m_data.data() + m_pos, len);
+		m_pos += len;
+		return len;
+	}
+
+	virtual void SendRawData(size_t /*len*/, const unsigned char* /*buf*/) override
+	{}
+
+	virtual bool IsCommandBatchingSupported() override
+	{ return false; }
+
+	virtual bool IsConnected() override
+	{ return true; }
+
+	size_t GetRemaining()
+	{ return m_data.size() - m_pos; }
+
+protected:
+	string m_data;
+	size_t m_pos;
+};
+
+TEST_CASE("Primitive_SCPIBlockReader")
+{
+	const size_t len = 3 * SCPITransport::BLOCK_CHUNK_SIZE + 1234;
+	string payload;
+	payload.resize(len);
+	uniform_int_distribution<int> bytedesc(0, 255);
+	for(size_t i=0; i<len; i++)
+		payload[i] = bytedesc(g_rng);
+
+	char header[32];
+	snprintf(header, sizeof(header), "#9%09zu", len);
+
+	AcceleratorBuffer<uint8_t> buf;
+	buf.SetCpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_LIKELY);
+	buf.SetGpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_NEVER);
+
+	SECTION("Header")
+	{
+		size_t blen;
+
+		MemoryTransport good(string("DAT1,") + header);
+		REQUIRE(good.ReadBlockHeader(blen));
+		REQUIRE(blen == len);
+
+		MemoryTransport noprefix(string("DAT1,") + header);
+		REQUIRE(!noprefix.ReadBlockHeader(blen, 0));
+
+		MemoryTransport indefinite("#0abcdef\n");
+		REQUIRE(!indefinite.ReadBlockHeader(blen));
+
+		MemoryTransport baddigit("#3a12");
+		REQUIRE(!baddigit.ReadBlockHeader(blen));
+
+		//Leading NUL must fail without skipping ahead to a later '#'
+		MemoryTransport nul(string("\0", 1) + header);
+		REQUIRE(!nul.ReadBlockHeader(blen));
+		REQUIRE(nul.GetRemaining() == strlen(header));
+	}
+
+	SECTION("Chunked")
+	{
+		MemoryTransport transport(string("DAT1,") + header + payload + "\n");
+
+		//Every chunk must be reported exactly once, in order
+		size_t expectedOffset = 0;
+		float lastProgress = 0;
+		REQUIRE(transport.ReadBinaryBlock(
+			buf,
+			[&](size_t offset, size_t n)
+			{
+				REQUIRE(offset == expectedOffset);
+				REQUIRE(n <= SCPITransport::BLOCK_CHUNK_SIZE);
+				REQUIRE(0 == memcmp(buf.GetCpuPointer() + offset, payload.data() + offset, n));
+				expectedOffset += n;
+			},
+			[&](float progress)
+			{
+				REQUIRE(progress >= lastProgress);
+				lastProgress = progress;
+			},
+			true));
+
+		REQUIRE(expectedOffset == len);
+		REQUIRE(lastProgress == 1.0f);
+		REQUIRE(buf.size() == len);
+		REQUIRE(0 == memcmp(buf.GetCpuPointer(), payload.data(), len));
+
+		//Terminator should have been consumed
+		REQUIRE(transport.GetRemaining() == 0);
+	}
+
+	SECTION("Truncated")
+	{
+		MemoryTransport transport(string(header) + payload.substr(0, len / 2));
+		REQUIRE(!transport.ReadBinaryBlock(buf));
+		REQUIRE(buf.size() == len / 2);
+	}
+}
@@ -0,0 +1,213 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for SCPIReplayTransport
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+#include <thread>
+
+using namespace std;
+
+///@brief Waveform payload served by LoopbackTransport
+static string g_loopbackWaveform;
+
+///@brief Time LoopbackTransport takes to start sending the waveform, in seconds
+static const double g_loopbackWaveformDelay = 0.05;
+
+/**
+	@brief Fake instrument answering a couple of fixed queries
+ */
+class LoopbackTransport : public SCPITransport
+{
+public:
+	LoopbackTransport(const string& /*args*/)
+		: m_pos(0)
+		, m_delayPending(false)
+	{}
+
+	static string GetTransportName()
+	{ return "loopback"; }
+
+	virtual string GetConnectionString() override
+	{ return ""; }
+
+	virtual bool SendCommand(const string& cmd) override
+	{
+		if(cmd == "*IDN?")
+			m_reply = "ACME,SCOPE,1234,1.0\n";
+		else if(cmd == "C1:WF? DAT1")
+		{
+			char header[32];
+			snprintf(header, sizeof(header), "DAT1,#9%09zu", g_loopbackWaveform.size());
+			m_reply = string(header) + g_loopbackWaveform + "\n";
+			m_delayPending = true;
+		}
+		else
+			m_reply = "";
+		m_pos = 0;
+		return true;
+	}
+
+	virtual string ReadReply(bool /*endOnSemicolon*/, function<void(float)> /*progress*/) override
+	{
+		auto end = m_reply.find('\n', m_pos);
+		string ret = m_reply.substr(m_pos, end - m_pos);
+		m_pos = m_reply.size();
+		return ret;
+	}
+
+	virtual size_t ReadRawData(size_t len, unsigned char* buf, function<void(float)> /*progress*/) override
+	{
+		if(m_delayPending)
+		{
+			this_thread::sleep_for(chrono::duration<double>(g_loopbackWaveformDelay));
+			m_delayPending = false;
+		}
+
+		len = min(len, m_reply.size() - m_pos);
+		memcpy(buf, m_reply.data() + m_pos, len);
+		m_pos += len;
+		return len;
+	}
+
+	virtual void SendRawData(size_t /*len*/, const unsigned char* /*buf*/) override
+	{}
+
+	virtual bool IsCommandBatchingSupported() override
+	{ return true; }
+
+	virtual bool IsConnected() override
+	{ return true; }
+
+	TRANSPORT_INITPROC(LoopbackTransport)
+
+protected:
+	string m_reply;
+	size_t m_pos;
+	bool m_delayPending;
+};
+
+TEST_CASE("Primitive_SCPIReplayTransport")
+{
+	AddTransportClass(LoopbackTransport);
+
+	const size_t len = 4 * 1024 * 1024;
+	g_loopbackWaveform.resize(len);
+	uniform_int_distribution<int> bytedesc(0, 255);
+	for(size_t i=0; i<len; i++)
+		g_loopbackWaveform[i] = bytedesc(g_rng);
+
+	const string fname = "Primitive_SCPIReplayTransport.scpirec";
+
+	AcceleratorBuffer<uint8_t> buf;
+	buf.SetCpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_LIKELY);
+	buf.SetGpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_NEVER);
+
+	//Record a session
+	{
+		unique_ptr<SCPITransport> transport(SCPITransport::CreateTransport("replay", "record;" + fname + ";loopback;"));
+		REQUIRE(transport->IsConnected());
+		REQUIRE(transport->IsCommandBatchingSupported());
+
+		REQUIRE(transport->SendCommandImmediateWithReply("*IDN?") == "ACME,SCOPE,1234,1.0");
+
+		lock_guard<recursive_mutex> lock(transport->GetMutex());
+		transport->SendCommand("C1:WF? DAT1");
+		REQUIRE(transport->ReadBinaryBlock(buf, nullptr, nullptr, true));
+		REQUIRE(buf.size() == len);
+	}
+
+	SECTION("Replay")
+	{
+		SCPIReplayTransport transport("replay;" + fname);
+		REQUIRE(transport.IsConnected());
+		REQUIRE(transport.IsCommandBatchingSupported());
+
+		REQUIRE(transport.SendCommandImmediateWithReply("*IDN?") == "ACME,SCOPE,1234,1.0");
+
+		transport.SendCommand("C1:WF? DAT1");
+		REQUIRE(transport.ReadBinaryBlock(buf, nullptr, nullptr, true));
+		REQUIRE(buf.size() == len);
+		REQUIRE(0 == memcmp(buf.GetCpuPointer(), g_loopbackWaveform.data(), len));
+
+		REQUIRE(transport.GetMismatchCount() == 0);
+		REQUIRE(transport.IsReplayComplete());
+
+		//Two commands, the *IDN? reply, and the whole block (header and payload) merged into one raw read
+		REQUIRE(transport.GetRecordCount() == 4);
+	}
+
+	SECTION("Mismatch")
+	{
+		SCPIReplayTransport transport("replay;" + fname);
+		transport.SendCommandImmediateWithReply("*RST");
+		REQUIRE(transport.GetMismatchCount() == 1);
+	}
+
+	SECTION("Bandwidth")
+	{
+		//4 MB at 200 MB/s should take at least 20 ms
+		SCPIReplayTransport transport("replay;" + fname + ";200e6;0.001");
+		transport.SendCommandImmediateWithReply("*IDN?");
+
+		double start = GetTime();
+		transport.SendCommand("C1:WF? DAT1");
+		REQUIRE(transport.ReadBinaryBlock(buf));
+		double dt = GetTime() - start;
+		LogVerbose("Replayed %zu bytes in %.2f ms\n", len, dt * 1000);
+		REQUIRE(dt >= 0.02);
+	}
+
+	SECTION("RecordedTiming")
+	{
+		//The waveform took at least g_loopbackWaveformDelay to arrive when recorded, so it must do so again
+		SCPIReplayTransport transport("replay;" + fname + ";recorded");
+		REQUIRE(transport.SendCommandImmediateWithReply("*IDN?") == "ACME,SCOPE,1234,1.0");
+
+		double start = GetTime();
+		transport.SendCommand("C1:WF? DAT1");
+		REQUIRE(transport.ReadBinaryBlock(buf));
+		double dt = GetTime() - start;
+		LogVerbose("Replayed %zu bytes in %.2f ms with recorded timing\n", len, dt * 1000);
+		REQUIRE(dt >= g_loopbackWaveformDelay * 0.9);
+		REQUIRE(0 == memcmp(buf.GetCpuPointer(), g_loopbackWaveform.data(), len));
+	}
+
+	remove(fname.c_str());
+}
@@ -145,3 +145,244 @@ TEST_CASE("Primitive_SampleOnRisingEdges")
 
 	//TODO: Add test for AnalogWaveform version
 }
+
+/**
+	@brief Scalar reference implementation of the SampleOn* primitives, used to verify the optimized versions
+
+	@param mode		0 = any edge, 1 = rising edge, 2 = falling edge
+ */
+template<class T, class R, class S>
+static void SampleOnEdgesReference(T* data, R* clock, SparseWaveform<S>& samples, int mode)
+{
+	samples.clear();
+	samples.PrepareForCpuAccess();
+
+	size_t len = clock->size();
+	size_t dlen = data->size();
+
+	size_t ndata = 0;
+	for(size_t i=1; i<len; i++)
+	{
+		bool cur = clock->m_samples[i];
+		bool prev = clock->m_samples[i-1];
+		if( (mode == 0) && (cur == prev) )
+			continue;
+		if( (mode == 1) && !(cur && !prev) )
+			continue;
+		if( (mode == 2) && !(!cur && prev) )
+			continue;
+
+		int64_t clkstart = GetOffsetScaled(clock, i);
+		while( (ndata+1 < dlen) && (GetOffsetScaled(data, ndata+1) < clkstart) )
+			ndata ++;
+		if(ndata >= dlen)
+			break;
+
+		samples.m_offsets.push_back(clkstart);
+		samples.m_durations.push_back(1);
+		samples.m_samples.push_back(data->m_samples[ndata]);
+	}
+
+	for(size_t i=1; i<samples.size(); i++)
+		samples.m_durations[i-1] = samples.m_offsets[i] - samples.m_offsets[i-1];
+}
+
+/**
+	@brief Generates a sparse clock with a random number of samples between toggles
+ */
+static void GenerateRandomSparseClock(SparseDigitalWaveform& clock, size_t len, int64_t timescale)
+{
+	uniform_int_distribution<int> togglelen(1, 8);
+	uniform_int_distribution<int> gaplen(1, 3);
+
+	clock.clear();
+	clock.PrepareForCpuAccess();
+	clock.m_timescale = timescale;
+	clock.m_triggerPhase = 0;
+
+	bool value = false;
+	int64_t t = 0;
+	int remaining = togglelen(g_rng);
+	for(size_t i=0; i<len; i++)
+	{
+		if(--remaining == 0)
+		{
+			value = !value;
+			remaining = togglelen(g_rng);
+		}
+
+		int64_t dur = gaplen(g_rng);
+		clock.m_offsets.push_back(t);
+		clock.m_durations.push_back(dur);
+		clock.m_samples.push_back(value);
+		t += dur;
+	}
+	clock.MarkModifiedFromCpu();
+}
+
+/**
+	@brief Fills a uniform analog waveform with random samples
+ */
+static void FillRandomWaveformForSampling(UniformAnalogWaveform& data, size_t len, int64_t timescale, int64_t phase)
+{
+	uniform_real_distribution<float> dist(-1, 1);
+
+	data.m_timescale = timescale;
+	data.m_triggerPhase = phase;
+	data.Resize(len);
+	data.PrepareForCpuAccess();
+	for(size_t i=0; i<len; i++)
+		data.m_samples[i] = dist(g_rng);
+	data.MarkModifiedFromCpu();
+}
+
+/**
+	@brief Verifies that two sampled waveforms are identical
+ */
+template<class S>
+static void VerifySampledWaveform(SparseWaveform<S>& expected, SparseWaveform<S>& observed)
+{
+	REQUIRE(expected.size() == observed.size());
+	REQUIRE(observed.m_offsets.size() == observed.size());
+	REQUIRE(observed.m_durations.size() == observed.size());
+
+	size_t len = expected.size();
+	for(size_t i=0; i<len; i++)
+	{
+		REQUIRE(expected.m_offsets[i] == observed.m_offsets[i]);
+		REQUIRE(expected.m_samples[i] == observed.m_samples[i]);
+
+		//Last sample has a constant duration, so don't compare
+		if(i+1 < len)
+			REQUIRE(expected.m_durations[i] == observed.m_durations[i]);
+	}
+}
+
+TEST_CASE("Primitive_SampleOnEdges")
+{
+	//Long enough to be split into several blocks for multithreading
+	const size_t wavelen = 2000000;
+
+	SECTION("UniformData_SparseClock")
+	{
+		//Oversampled analog data, with a trigger phase offset
+		UniformAnalogWaveform data;
+		FillRandomWaveformForSampling(data, wavelen, 7000, 1234);
+
+		SparseDigitalWaveform clock;
+		GenerateRandomSparseClock(clock, wavelen / 3, 20000);
+
+		for(int mode=0; mode<3; mode++)
+		{
+			SparseAnalogWaveform expected;
+			SparseAnalogWaveform observed;
+
+			double start = GetTime();
+			SampleOnEdgesReference(&data, &clock, expected, mode);
+			double tref = GetTime() - start;
+
+			start = GetTime();
+			if(mode == 0)
+				Filter::SampleOnAnyEdges(&data, &clock, observed);
+			else if(mode == 1)
+				Filter::SampleOnRisingEdges(&data, &clock, observed);
+			else
+				Filter::SampleOnFallingEdges(&data, &clock, observed);
+			double dt = GetTime() - start;
+
+			LogVerbose("Mode %d: %zu samples, reference %6.2f ms, optimized %6.2f ms (%.2fx speedup)\n",
+				mode, expected.size(), tref * 1000, dt * 1000, tref / dt);
+			VerifySampledWaveform(expected, observed);
+		}
+	}
+
+	SECTION("SparseData_SparseClock")
+	{
+		//Data much denser than the clock, so the galloping search has to skip many samples per edge
+		SparseDigitalWaveform data;
+		GenerateRandomSparseClock(data, wavelen, 5);
+
+		SparseDigitalWaveform clock;
+		GenerateRandomSparseClock(clock, wavelen / 16, 80);
+
+		SparseDigitalWaveform expected;
+		SparseDigitalWaveform observed;
+
+		double start = GetTime();
+		SampleOnEdgesReference(&data, &clock, expected, 0);
+		double tref = GetTime() - start;
+
+		start = GetTime();
+		Filter::SampleOnAnyEdges(&data, &clock, observed);
+		double dt = GetTime() - start;
+
+		LogVerbose("%zu samples, reference %6.2f ms, optimized %6.2f ms (%.2fx speedup)\n",
+			expected.size(), tref * 1000, dt * 1000, tref / dt);
+		VerifySampledWaveform(expected, observed);
+	}
+
+	SECTION("UniformData_UniformClock")
+	{
+		UniformDigitalWaveform data;
+		UniformDigitalWaveform clock;
+		data.m_timescale = 1000;
+		clock.m_timescale = 1000;
+		data.m_triggerPhase = 250;
+		clock.m_triggerPhase = 0;
+		data.Resize(wavelen);
+		clock.Resize(wavelen);
+		data.PrepareForCpuAccess();
+		clock.PrepareForCpuAccess();
+
+		uniform_int_distribution<int> bitdist(0, 1);
+		for(size_t i=0; i<wavelen; i++)
+		{
+			data.m_samples[i] = bitdist(g_rng);
+			clock.m_samples[i] = (i / 3) & 1;
+		}
+		data.MarkModifiedFromCpu();
+		clock.MarkModifiedFromCpu();
+
+		SparseDigitalWaveform expected;
+		SparseDigitalWaveform observed;
+		SampleOnEdgesReference(&data, &clock, expected, 1);
+		Filter::SampleOnRisingEdges(&data, &clock, observed);
+		VerifySampledWaveform(expected, observed);
+	}
+
+	SECTION("Interpolation")
+	{
+		UniformAnalogWaveform data;
+		FillRandomWaveformForSampling(data, wavelen, 10000, 0);
+
+		SparseDigitalWaveform clock;
+		GenerateRandomSparseClock(clock, wavelen / 2, 3333);
+
+		SparseAnalogWaveform observed;
+		Filter::SampleOnAnyEdgesWithInterpolation(&data, &clock, observed);
+
+		//Reference implementation
+		SparseAnalogWaveform expected;
+		size_t ndata = 0;
+		for(size_t i=1; i<clock.size(); i++)
+		{
+			if(clock.m_samples[i] == clock.m_samples[i-1])
+				continue;
+
+			int64_t clkstart = GetOffsetScaled(&clock, i);
+			while( (ndata+1 < wavelen) && (GetOffsetScaled(&data, ndata+1) < clkstart) )
+				ndata ++;
+
+			float frac = (clkstart - GetOffsetScaled(&data, ndata)) * 1.0 / data.m_timescale;
+			expected.m_offsets.push_back(clkstart);
+			expected.m_samples.push_back(Filter::InterpolateValue(&data, ndata, frac));
+		}
+
+		REQUIRE(expected.size() == observed.size());
+		for(size_t i=0; i<expected.size(); i++)
+		{
+			REQUIRE(expected.m_offsets[i] == observed.m_offsets[i]);
+			REQUIRE(expected.m_samples[i] == observed.m_samples[i]);
+		}
+	}
+}
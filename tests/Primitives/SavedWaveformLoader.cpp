@@ -0,0 +1,207 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test and benchmark for SavedWaveformLoader
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopeprotocols/scopeprotocols.h"
+#include "Primitives.h"
+
+using namespace std;
+
+///@brief Size of one sparsev1 analog record (int64 offset, int64 duration, float sample)
+static const size_t g_sparseRecordSize = 2*sizeof(int64_t) + sizeof(float);
+
+/**
+	@brief Generates n random sparsev1 analog records
+ */
+static vector<uint8_t> MakeSparseRecords(size_t n)
+{
+	uniform_int_distribution<int64_t> idesc(INT64_MIN, INT64_MAX);
+	uniform_real_distribution<float> fdesc(-1e6, 1e6);
+
+	vector<uint8_t> buf(n * g_sparseRecordSize);
+	for(size_t i=0; i<n; i++)
+	{
+		int64_t off = idesc(g_rng);
+		int64_t dur = idesc(g_rng);
+		float v = fdesc(g_rng);
+		uint8_t* p = buf.data() + i*g_sparseRecordSize;
+		memcpy(p, &off, sizeof(off));
+		memcpy(p + sizeof(int64_t), &dur, sizeof(dur));
+		memcpy(p + 2*sizeof(int64_t), &v, sizeof(v));
+	}
+	return buf;
+}
+
+TEST_CASE("Primitive_SavedWaveformLoader")
+{
+	#ifdef __x86_64__
+	bool reallyHasAvx2 = g_hasAvx2;
+	#endif
+
+	SECTION("Deinterleave")
+	{
+		//Odd lengths, lengths that aren't a multiple of the 8-record vector width, and ranges not starting on one
+		for(size_t n : {0, 1, 7, 8, 9, 15, 17, 63, 1001, 1000003})
+		{
+			auto buf = MakeSparseRecords(n);
+			for(size_t start : {(size_t)0, min(n, (size_t)3)})
+			{
+				LogVerbose("%zu records, starting at %zu\n", n, start);
+				LogIndenter li;
+
+				vector<int64_t> offGolden(n, 0);
+				vector<int64_t> durGolden(n, 0);
+				vector<float> samplesGolden(n, 0);
+				double tstart = GetTime();
+				SavedWaveformLoader::DeinterleaveSparseAnalogGeneric(
+					buf.data(), start, n, offGolden.data(), durGolden.data(), samplesGolden.data());
+				double tbase = GetTime() - tstart;
+				LogVerbose("CPU (no AVX)  : %6.3f ms\n", tbase * 1000);
+
+				//The reference must actually match the records we wrote
+				bool ok = true;
+				for(size_t i=start; i<n; i++)
+				{
+					const uint8_t* p = buf.data() + i*g_sparseRecordSize;
+					ok &= (0 == memcmp(&offGolden[i], p, sizeof(int64_t)));
+					ok &= (0 == memcmp(&durGolden[i], p + sizeof(int64_t), sizeof(int64_t)));
+					ok &= (0 == memcmp(&samplesGolden[i], p + 2*sizeof(int64_t), sizeof(float)));
+				}
+				REQUIRE(ok);
+
+				#ifdef __x86_64__
+				if(reallyHasAvx2)
+				{
+					vector<int64_t> off(n, 0);
+					vector<int64_t> dur(n, 0);
+					vector<float> samples(n, 0);
+					tstart = GetTime();
+					SavedWaveformLoader::DeinterleaveSparseAnalogAVX2(
+						buf.data(), start, n, off.data(), dur.data(), samples.data());
+					double dt = GetTime() - tstart;
+					LogVerbose("CPU (AVX2)    : %6.3f ms, %.2fx speedup\n", dt * 1000, tbase / dt);
+
+					//Bit exact, including the untouched entries before start
+					REQUIRE(0 == memcmp(off.data(), offGolden.data(), n * sizeof(int64_t)));
+					REQUIRE(0 == memcmp(dur.data(), durGolden.data(), n * sizeof(int64_t)));
+					REQUIRE(0 == memcmp(samples.data(), samplesGolden.data(), n * sizeof(float)));
+				}
+				#endif
+			}
+		}
+	}
+
+	SECTION("LoadStream")
+	{
+		//Deep enough to be split into several blocks, and not a multiple of the block or vector size.
+		//Offsets are spaced out so the loader doesn't convert the waveform to uniform.
+		const size_t n = 4000003;
+		vector<uint8_t> buf(n * g_sparseRecordSize);
+		uniform_real_distribution<float> fdesc(-1, 1);
+		for(size_t i=0; i<n; i++)
+		{
+			int64_t off = i*2;
+			int64_t dur = 2;
+			float v = fdesc(g_rng);
+			uint8_t* p = buf.data() + i*g_sparseRecordSize;
+			memcpy(p, &off, sizeof(off));
+			memcpy(p + sizeof(int64_t), &dur, sizeof(dur));
+			memcpy(p + 2*sizeof(int64_t), &v, sizeof(v));
+		}
+
+		const string fname = "Primitive_SavedWaveformLoader.bin";
+		FILE* fp = fopen(fname.c_str(), "wb");
+		REQUIRE(fp != nullptr);
+		REQUIRE(buf.size() == fwrite(buf.data(), 1, buf.size(), fp));
+		fclose(fp);
+
+		//Load once to warm up the page cache so both timed runs see the same I/O cost
+		delete SavedWaveformLoader::LoadStream(new SparseAnalogWaveform, "sparsev1", fname);
+
+		#ifdef __x86_64__
+		g_hasAvx2 = false;
+		#endif
+		double tstart = GetTime();
+		auto golden = dynamic_cast<SparseAnalogWaveform*>(
+			SavedWaveformLoader::LoadStream(new SparseAnalogWaveform, "sparsev1", fname));
+		double tbase = GetTime() - tstart;
+		LogVerbose("LoadStream, no AVX : %7.2f ms\n", tbase * 1000);
+
+		REQUIRE(golden != nullptr);
+		REQUIRE(golden->size() == n);
+		golden->PrepareForCpuAccess();
+		bool ok = true;
+		for(size_t i=0; i<n; i++)
+		{
+			const uint8_t* p = buf.data() + i*g_sparseRecordSize;
+			ok &= (golden->m_offsets[i] == (int64_t)(i*2));
+			ok &= (golden->m_durations[i] == 2);
+			ok &= (0 == memcmp(&golden->m_samples[i], p + 2*sizeof(int64_t), sizeof(float)));
+		}
+		REQUIRE(ok);
+
+		#ifdef __x86_64__
+		if(reallyHasAvx2)
+		{
+			g_hasAvx2 = true;
+			tstart = GetTime();
+			auto wfm = dynamic_cast<SparseAnalogWaveform*>(
+				SavedWaveformLoader::LoadStream(new SparseAnalogWaveform, "sparsev1", fname));
+			double dt = GetTime() - tstart;
+			LogVerbose("LoadStream, AVX2   : %7.2f ms, %.2fx speedup\n", dt * 1000, tbase / dt);
+
+			REQUIRE(wfm != nullptr);
+			REQUIRE(wfm->size() == n);
+			wfm->PrepareForCpuAccess();
+			REQUIRE(0 == memcmp(wfm->m_offsets.GetCpuPointer(), golden->m_offsets.GetCpuPointer(), n * sizeof(int64_t)));
+			REQUIRE(0 == memcmp(wfm->m_durations.GetCpuPointer(), golden->m_durations.GetCpuPointer(), n * sizeof(int64_t)));
+			REQUIRE(0 == memcmp(wfm->m_samples.GetCpuPointer(), golden->m_samples.GetCpuPointer(), n * sizeof(float)));
+			delete wfm;
+		}
+		#endif
+
+		delete golden;
+		remove(fname.c_str());
+	}
+
+	#ifdef __x86_64__
+	g_hasAvx2 = reallyHasAvx2;
+	#endif
+}
@@ -0,0 +1,158 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test and overhead benchmark for TraceRecorder
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+
+using namespace std;
+
+static size_t CountOccurrences(const string& haystack, const string& needle)
+{
+	size_t count = 0;
+	for(size_t pos = haystack.find(needle); pos != string::npos; pos = haystack.find(needle, pos + 1))
+		count ++;
+	return count;
+}
+
+TEST_CASE("Primitive_TraceRecorder")
+{
+	TraceRecorder::Disable();
+	TraceRecorder::Clear();
+
+	SECTION("Disabled")
+	{
+		//Spans must not record anything while tracing is off, and must cost no more than a few ns
+		const size_t niter = 10000000;
+		int64_t start = TraceRecorder::GetTimestamp();
+		for(size_t i=0; i<niter; i++)
+			TraceSpan span("disabled", "test");
+		int64_t dt = TraceRecorder::GetTimestamp() - start;
+
+		double nsPerSpan = dt * 1.0 / niter;
+		LogVerbose("Disabled span overhead: %.2f ns\n", nsPerSpan);
+		REQUIRE(nsPerSpan < 20);
+		REQUIRE(TraceRecorder::GetEventCount() == 0);
+	}
+
+	SECTION("Enabled")
+	{
+		TraceRecorder::Enable();
+
+		const size_t niter = 50000;
+		int64_t start = TraceRecorder::GetTimestamp();
+		for(size_t i=0; i<niter; i++)
+			TraceSpan span("enabled", "test");
+		int64_t dt = TraceRecorder::GetTimestamp() - start;
+
+		LogVerbose("Enabled span overhead: %.2f ns\n", dt * 1.0 / niter);
+		REQUIRE(TraceRecorder::GetEventCount() == niter);
+	}
+
+	SECTION("Wraparound")
+	{
+		//Only the most recent events should be kept once the ring fills up
+		TraceRecorder::Enable(8);
+		for(size_t i=0; i<20; i++)
+			TraceSpan span(TraceRecorder::Intern("span" + to_string(i)), "test");
+		REQUIRE(TraceRecorder::GetEventCount() == 8);
+
+		auto json = TraceRecorder::GetChromeTrace();
+		REQUIRE(json.find("\"span11\"") == string::npos);
+		for(size_t i=12; i<20; i++)
+			REQUIRE(json.find("\"span" + to_string(i) + "\"") != string::npos);
+
+		//Oldest first
+		REQUIRE(json.find("\"span12\"") < json.find("\"span19\""));
+	}
+
+	SECTION("ChromeTrace")
+	{
+		TraceRecorder::Enable();
+
+		//Record spans on a few other threads, with names that need escaping
+		vector<thread> threads;
+		for(size_t i=0; i<4; i++)
+		{
+			threads.push_back(thread([i]
+			{
+				TraceRecorder::SetThreadName("Worker \"" + to_string(i) + "\"");
+				TraceSpan outer("outer", "test");
+				{
+					TraceSpan inner("inner\\path", "test");
+					this_thread::sleep_for(chrono::milliseconds(1));
+				}
+			}));
+		}
+		for(auto& t : threads)
+			t.join();
+
+		REQUIRE(TraceRecorder::GetEventCount() == 8);
+
+		auto json = TraceRecorder::GetChromeTrace();
+		REQUIRE(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+		REQUIRE(CountOccurrences(json, "\"ph\":\"X\"") == 8);
+		REQUIRE(CountOccurrences(json, "\"args\":{\"name\":\"Worker \\\"") == 4);
+		REQUIRE(json.find("\"Worker \\\"2\\\"\"") != string::npos);
+		REQUIRE(json.find("\"inner\\\\path\"") != string::npos);
+
+		//Spans of at least 1 ms must be reported with a duration of at least 1000 us
+		size_t pos = json.find("\"inner\\\\path\"");
+		pos = json.find("\"dur\":", pos);
+		REQUIRE(pos != string::npos);
+		REQUIRE(stod(json.substr(pos + 6)) >= 1000);
+
+		//Round trip through a file
+		string path = "trace-test.json";
+		REQUIRE(TraceRecorder::WriteChromeTrace(path));
+		FILE* fp = fopen(path.c_str(), "rb");
+		REQUIRE(fp != nullptr);
+		string readback;
+		char buf[4096];
+		size_t n;
+		while( (n = fread(buf, 1, sizeof(buf), fp)) > 0)
+			readback.append(buf, n);
+		fclose(fp);
+		remove(path.c_str());
+		REQUIRE(readback == json);
+	}
+
+	TraceRecorder::Disable();
+	TraceRecorder::Clear();
+}
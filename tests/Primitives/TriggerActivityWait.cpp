@@ -0,0 +1,161 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test and trigger latency benchmark for Oscilloscope::WaitForTriggerActivity()
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "../../lib/scopehal/DemoOscilloscope.h"
+#include "Primitives.h"
+
+using namespace std;
+
+TEST_CASE("Primitive_TriggerActivityWait")
+{
+	DemoOscilloscope scope(new SCPINullTransport(""));
+	REQUIRE(scope.IsTriggerActivityWaitSupported());
+
+	SECTION("Timeout")
+	{
+		//Nothing to report while disarmed, so the full timeout must elapse
+		double start = GetTime();
+		REQUIRE(!scope.WaitForTriggerActivity(chrono::milliseconds(20)));
+		REQUIRE( (GetTime() - start) >= 0.015);
+	}
+
+	SECTION("Latency")
+	{
+		//Measure how long it takes for a blocked polling thread to notice the trigger being armed.
+		//The old fixed sleeps in the instrument thread added up to 15 ms here.
+		const size_t niter = 20;
+		double total = 0;
+		double worst = 0;
+		for(size_t i=0; i<niter; i++)
+		{
+			scope.Stop();
+
+			atomic<double> tWake(0);
+			bool woke = false;
+			thread waiter([&]
+			{
+				woke = scope.WaitForTriggerActivity(chrono::seconds(1));
+				tWake = GetTime();
+			});
+
+			this_thread::sleep_for(chrono::milliseconds(5));
+			double tArm = GetTime();
+			scope.Start();
+			waiter.join();
+
+			REQUIRE(woke);
+			double dt = tWake - tArm;
+			total += dt;
+			worst = max(worst, dt);
+		}
+
+		LogVerbose("Arm to wake latency: average %.3f ms, worst %.3f ms\n", total * 1e3 / niter, worst * 1e3);
+		REQUIRE(worst < 0.5);
+
+		//Once armed, waiting must not block at all
+		double start = GetTime();
+		REQUIRE(scope.WaitForTriggerActivity(chrono::seconds(1)));
+		REQUIRE( (GetTime() - start) < 0.5);
+
+		scope.Stop();
+	}
+
+	SECTION("Trigger to waveform")
+	{
+		//End to end through the driver: arm a single trigger and time how long it takes until a thread polling the
+		//scope the same way InstrumentThread does has a waveform in the pending queue. That is the point where the
+		//waveform thread picks it up, everything after it is the same no matter how the instrument thread waits.
+		atomic<bool> done(false);
+		atomic<double> tAcquire(0);
+		thread poller([&]
+		{
+			while(!done)
+			{
+				if(scope.IsTriggerArmed() && (scope.PollTrigger() == Oscilloscope::TRIGGER_MODE_TRIGGERED))
+				{
+					tAcquire = GetTime();
+					scope.AcquireData();
+				}
+
+				if(scope.GetPendingWaveformCount() == 0)
+					scope.WaitForTriggerActivity(chrono::milliseconds(10));
+				else
+					this_thread::sleep_for(chrono::milliseconds(1));
+			}
+		});
+
+		const size_t niter = 20;
+		double totalWake = 0;
+		double worstWake = 0;
+		double totalReady = 0;
+		double worstReady = 0;
+		for(size_t i=0; i<niter; i++)
+		{
+			//Give the poller time to go idle
+			this_thread::sleep_for(chrono::milliseconds(5));
+
+			double tArm = GetTime();
+			scope.StartSingleTrigger();
+			while(!scope.HasPendingWaveforms() && (GetTime() - tArm) < 5)
+				this_thread::yield();
+			double tReady = GetTime();
+			REQUIRE(scope.HasPendingWaveforms());
+			scope.ClearPendingWaveforms();
+
+			double wake = tAcquire - tArm;
+			double ready = tReady - tArm;
+			totalWake += wake;
+			worstWake = max(worstWake, wake);
+			totalReady += ready;
+			worstReady = max(worstReady, ready);
+		}
+
+		done = true;
+		scope.Stop();
+		poller.join();
+
+		LogVerbose("Arm to acquisition start: average %.3f ms, worst %.3f ms\n",
+			totalWake * 1e3 / niter, worstWake * 1e3);
+		LogVerbose("Arm to waveform ready:    average %.3f ms, worst %.3f ms\n",
+			totalReady * 1e3 / niter, worstReady * 1e3);
+		REQUIRE(worstWake < 0.5);
+	}
+}
@@ -0,0 +1,249 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test and benchmark for WaveformCodec
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+
+using namespace std;
+
+TEST_CASE("Primitive_WaveformCodec")
+{
+	SECTION("LZ")
+	{
+		//Short buffers, runs, random data, and small alphabets exercise all of the literal/match boundary cases
+		uniform_int_distribution<int> bytedist(0, 255);
+		uniform_int_distribution<int> smalldist(0, 2);
+		for(size_t len=0; len<600; len++)
+		{
+			for(int mode=0; mode<3; mode++)
+			{
+				vector<uint8_t> in(len);
+				for(size_t i=0; i<len; i++)
+				{
+					if(mode == 0)
+						in[i] = 0x55;
+					else if(mode == 1)
+						in[i] = bytedist(g_rng);
+					else
+						in[i] = smalldist(g_rng);
+				}
+
+				//Output buffer has some slack since random data may not compress
+				vector<uint8_t> compressed(len + len/16 + 16);
+				size_t clen = WaveformCodec::LZCompress(in.data(), len, compressed.data(), compressed.size());
+				REQUIRE(clen > 0);
+
+				vector<uint8_t> out(len);
+				REQUIRE(WaveformCodec::LZDecompress(compressed.data(), clen, out.data(), len));
+				REQUIRE(out == in);
+
+				//Wrong expected length must be rejected
+				vector<uint8_t> big(len + 1);
+				REQUIRE(!WaveformCodec::LZDecompress(compressed.data(), clen, big.data(), len + 1));
+			}
+		}
+
+		//Doesn't fit in the output buffer
+		vector<uint8_t> in(4096);
+		for(auto& b : in)
+			b = bytedist(g_rng);
+		vector<uint8_t> compressed(4096);
+		REQUIRE(WaveformCodec::LZCompress(in.data(), in.size(), compressed.data(), 1024) == 0);
+	}
+
+	SECTION("RoundTrip")
+	{
+		//Lengths around block boundaries
+		uniform_real_distribution<float> noise(-0.01, 0.01);
+		uniform_int_distribution<int> jitter(0, 9);
+		for(size_t len : {(size_t)0, (size_t)1, (size_t)100, WaveformCodec::BLOCK_SIZE, WaveformCodec::BLOCK_SIZE*3 + 17})
+		{
+			SparseAnalogWaveform sa;
+			SparseDigitalWaveform sd;
+			UniformAnalogWaveform ua;
+			UniformDigitalWaveform ud;
+			sa.Resize(len);
+			sd.Resize(len);
+			ua.Resize(len);
+			ud.Resize(len);
+			sa.PrepareForCpuAccess();
+			sd.PrepareForCpuAccess();
+			ua.PrepareForCpuAccess();
+			ud.PrepareForCpuAccess();
+
+			int64_t t = 0;
+			for(size_t i=0; i<len; i++)
+			{
+				int64_t dur = (jitter(g_rng) == 0) ? 3 : 2;
+				sa.m_offsets[i] = sd.m_offsets[i] = t;
+				sa.m_durations[i] = sd.m_durations[i] = dur;
+				t += dur;
+
+				float v = sin(i * 0.001) + noise(g_rng);
+				sa.m_samples[i] = ua.m_samples[i] = v;
+				sd.m_samples[i] = ud.m_samples[i] = (v > 0);
+			}
+
+			vector<uint8_t> buf;
+			SparseAnalogWaveform sa2;
+			REQUIRE(WaveformCodec::CompressWaveform(&sa, buf));
+			REQUIRE(WaveformCodec::DecompressWaveform(buf.data(), buf.size(), &sa2));
+			sa2.PrepareForCpuAccess();
+			REQUIRE(sa2.size() == len);
+			for(size_t i=0; i<len; i++)
+			{
+				REQUIRE(sa2.m_offsets[i] == sa.m_offsets[i]);
+				REQUIRE(sa2.m_durations[i] == sa.m_durations[i]);
+				REQUIRE(sa2.m_samples[i] == sa.m_samples[i]);
+			}
+
+			SparseDigitalWaveform sd2;
+			REQUIRE(WaveformCodec::CompressWaveform(&sd, buf));
+			REQUIRE(WaveformCodec::DecompressWaveform(buf.data(), buf.size(), &sd2));
+			sd2.PrepareForCpuAccess();
+			REQUIRE(sd2.size() == len);
+			for(size_t i=0; i<len; i++)
+			{
+				REQUIRE(sd2.m_offsets[i] == sd.m_offsets[i]);
+				REQUIRE(sd2.m_durations[i] == sd.m_durations[i]);
+				REQUIRE(sd2.m_samples[i] == sd.m_samples[i]);
+			}
+
+			UniformAnalogWaveform ua2;
+			REQUIRE(WaveformCodec::CompressWaveform(&ua, buf));
+			REQUIRE(WaveformCodec::DecompressWaveform(buf.data(), buf.size(), &ua2));
+			ua2.PrepareForCpuAccess();
+			REQUIRE(ua2.size() == len);
+			for(size_t i=0; i<len; i++)
+				REQUIRE(ua2.m_samples[i] == ua.m_samples[i]);
+
+			UniformDigitalWaveform ud2;
+			REQUIRE(WaveformCodec::CompressWaveform(&ud, buf));
+			REQUIRE(WaveformCodec::DecompressWaveform(buf.data(), buf.size(), &ud2));
+			ud2.PrepareForCpuAccess();
+			REQUIRE(ud2.size() == len);
+			for(size_t i=0; i<len; i++)
+				REQUIRE(ud2.m_samples[i] == ud.m_samples[i]);
+
+			//Data compressed from one waveform type can't be loaded into another
+			UniformAnalogWaveform wrong;
+			REQUIRE(!WaveformCodec::DecompressWaveform(buf.data(), buf.size(), &wrong));
+		}
+	}
+
+	SECTION("Corruption")
+	{
+		const size_t len = 100000;
+		SparseAnalogWaveform wfm;
+		wfm.Resize(len);
+		wfm.PrepareForCpuAccess();
+		for(size_t i=0; i<len; i++)
+		{
+			wfm.m_offsets[i] = i*2;
+			wfm.m_durations[i] = 2;
+			wfm.m_samples[i] = sin(i * 0.01);
+		}
+		vector<uint8_t> buf;
+		REQUIRE(WaveformCodec::CompressWaveform(&wfm, buf));
+
+		//Truncated files must be rejected
+		SparseAnalogWaveform out;
+		REQUIRE(!WaveformCodec::DecompressWaveform(buf.data(), buf.size() / 2, &out));
+		REQUIRE(!WaveformCodec::DecompressWaveform(buf.data(), 10, &out));
+
+		//Random bit flips may or may not be detected, but must never read or write out of bounds
+		uniform_int_distribution<size_t> posdist(0, buf.size() - 1);
+		uniform_int_distribution<int> bitdist(0, 7);
+		for(size_t i=0; i<100; i++)
+		{
+			auto corrupt = buf;
+			corrupt[posdist(g_rng)] ^= (1 << bitdist(g_rng));
+			WaveformCodec::DecompressWaveform(corrupt.data(), corrupt.size(), &out);
+		}
+	}
+
+	SECTION("Throughput")
+	{
+		//16M samples of a noisy sine wave on a slightly jittery timebase
+		const size_t len = 16 * 1024 * 1024;
+		SparseAnalogWaveform wfm;
+		wfm.Resize(len);
+		wfm.PrepareForCpuAccess();
+		uniform_real_distribution<float> noise(-0.01, 0.01);
+		uniform_int_distribution<int> jitter(0, 99);
+		int64_t t = 0;
+		for(size_t i=0; i<len; i++)
+		{
+			int64_t dur = (jitter(g_rng) == 0) ? 2 : 1;
+			wfm.m_offsets[i] = t;
+			wfm.m_durations[i] = dur;
+			wfm.m_samples[i] = sin(i * 0.0001) + noise(g_rng);
+			t += dur;
+		}
+
+		vector<uint8_t> buf;
+		double start = GetTime();
+		REQUIRE(WaveformCodec::CompressWaveform(&wfm, buf));
+		double tcomp = GetTime() - start;
+
+		SparseAnalogWaveform out;
+		start = GetTime();
+		REQUIRE(WaveformCodec::DecompressWaveform(buf.data(), buf.size(), &out));
+		double tdecomp = GetTime() - start;
+
+		//sparsev1 stores 20 bytes per sample
+		double rawsize = len * 20.0;
+		LogVerbose("Compressed size : %.2f MB (%.2fx smaller than sparsev1)\n", buf.size() * 1e-6, rawsize / buf.size());
+		LogVerbose("Compress        : %6.2f ms, %.0f MB/s\n", tcomp * 1000, rawsize * 1e-6 / tcomp);
+		LogVerbose("Decompress      : %6.2f ms, %.0f MB/s\n", tdecomp * 1000, rawsize * 1e-6 / tdecomp);
+
+		//Timestamps compress extremely well, so we should be well under half the size
+		REQUIRE(buf.size() < rawsize / 2);
+
+		//Compare in bulk, a REQUIRE per sample would dominate the run time at this depth
+		out.PrepareForCpuAccess();
+		REQUIRE(out.size() == len);
+		bool match =
+			(0 == memcmp(out.m_offsets.GetCpuPointer(), wfm.m_offsets.GetCpuPointer(), len * sizeof(int64_t))) &&
+			(0 == memcmp(out.m_durations.GetCpuPointer(), wfm.m_durations.GetCpuPointer(), len * sizeof(int64_t))) &&
+			(0 == memcmp(out.m_samples.GetCpuPointer(), wfm.m_samples.GetCpuPointer(), len * sizeof(float)));
+		REQUIRE(match);
+	}
+}
@@ -0,0 +1,247 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test and benchmark for WaveformConversionQueue
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+
+using namespace std;
+
+///@brief Raw ADC data for each channel served by ChannelLoopbackTransport
+static vector<string> g_channelData;
+
+/**
+	@brief Fake instrument answering LeCroy-style per-channel waveform queries ("Cn:WF? DAT1")
+
+	Used to record a canned download session, which is then replayed through SCPIReplayTransport at a modeled link
+	speed.
+ */
+class ChannelLoopbackTransport : public SCPITransport
+{
+public:
+	ChannelLoopbackTransport(const string& /*args*/)
+		: m_pos(0)
+	{}
+
+	static string GetTransportName()
+	{ return "chanloopback"; }
+
+	virtual string GetConnectionString() override
+	{ return ""; }
+
+	virtual bool SendCommand(const string& cmd) override
+	{
+		m_reply = "";
+		m_pos = 0;
+
+		unsigned int chan;
+		if( (1 == sscanf(cmd.c_str(), "C%u:WF? DAT1", &chan)) && (chan >= 1) && (chan <= g_channelData.size()) )
+		{
+			auto& data = g_channelData[chan-1];
+			char header[32];
+			snprintf(header, sizeof(header), "DAT1,#9%09zu", data.size());
+			m_reply = string(header) + data + "\n";
+		}
+		return true;
+	}
+
+	virtual string ReadReply(bool /*endOnSemicolon*/, function<void(float)> /*progress*/) override
+	{
+		string ret = m_reply.substr(m_pos);
+		m_pos = m_reply.size();
+		return ret;
+	}
+
+	virtual size_t ReadRawData(size_t len, unsigned char* buf, function<void(float)> /*progress*/) override
+	{
+		len = min(len, m_reply.size() - m_pos);
+		memcpy(buf, m_reply.data() + m_pos, len);
+		m_pos += len;
+		return len;
+	}
+
+	virtual void SendRawData(size_t /*len*/, const unsigned char* /*buf*/) override
+	{}
+
+	virtual bool IsCommandBatchingSupported() override
+	{ return true; }
+
+	virtual bool IsConnected() override
+	{ return true; }
+
+	TRANSPORT_INITPROC(ChannelLoopbackTransport)
+
+protected:
+	string m_reply;
+	size_t m_pos;
+};
+
+TEST_CASE("Primitive_WaveformConversionQueue")
+{
+	SECTION("Completion")
+	{
+		//Every job must have finished by the time Wait() returns
+		WaveformConversionQueue queue(4);
+		atomic<size_t> count(0);
+		for(size_t iter=0; iter<16; iter++)
+		{
+			for(size_t i=0; i<64; i++)
+				queue.Submit([&count] { count ++; });
+			queue.Wait();
+			REQUIRE(count == (iter+1) * 64);
+		}
+
+		//Wait() with nothing pending must not block
+		queue.Wait();
+	}
+
+	SECTION("Overlap")
+	{
+		//Four channels of raw ADC data, downloaded by replaying a recorded session over a modeled 1 GB/s link
+		const size_t nchans = 4;
+		const size_t wavelen = 4 * 1000 * 1000;
+		const string linkSpeed = "1e9";
+		float gain = 0.01;
+		float offset = -0.5;
+
+		AddTransportClass(ChannelLoopbackTransport);
+		g_channelData.resize(nchans);
+		uniform_int_distribution<int> indesc(-128, 127);
+		for(size_t i=0; i<nchans; i++)
+		{
+			g_channelData[i].resize(wavelen);
+			for(size_t j=0; j<wavelen; j++)
+				g_channelData[i][j] = indesc(g_rng);
+		}
+
+		vector<unique_ptr<AcceleratorBuffer<uint8_t>>> raw;
+		vector<unique_ptr<UniformAnalogWaveform>> serial;
+		vector<unique_ptr<UniformAnalogWaveform>> overlapped;
+		for(size_t i=0; i<nchans; i++)
+		{
+			raw.push_back(make_unique<AcceleratorBuffer<uint8_t>>());
+			raw.back()->SetCpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_LIKELY);
+			raw.back()->SetGpuAccessHint(AcceleratorBuffer<uint8_t>::HINT_NEVER);
+			serial.push_back(make_unique<UniformAnalogWaveform>());
+			serial.back()->Resize(wavelen);
+			overlapped.push_back(make_unique<UniformAnalogWaveform>());
+			overlapped.back()->Resize(wavelen);
+		}
+
+		//Record one download of every channel
+		const string fname = "Primitive_WaveformConversionQueue.scpirec";
+		{
+			SCPIReplayTransport transport("record;" + fname + ";chanloopback;");
+			REQUIRE(transport.IsConnected());
+			for(size_t i=0; i<nchans; i++)
+			{
+				transport.SendCommand(string("C") + to_string(i+1) + ":WF? DAT1");
+				REQUIRE(transport.ReadBinaryBlock(*raw[i], nullptr, nullptr, true));
+			}
+		}
+
+		//Baseline: download everything, then convert everything
+		SCPIReplayTransport serialLink("replay;" + fname + ";" + linkSpeed);
+		double start = GetTime();
+		for(size_t i=0; i<nchans; i++)
+		{
+			serialLink.SendCommand(string("C") + to_string(i+1) + ":WF? DAT1");
+			REQUIRE(serialLink.ReadBinaryBlock(*raw[i]));
+		}
+		for(size_t i=0; i<nchans; i++)
+		{
+			serial[i]->PrepareForCpuAccess();
+			Oscilloscope::Convert8BitSamples(
+				serial[i]->m_samples.GetCpuPointer(),
+				reinterpret_cast<int8_t*>(raw[i]->GetCpuPointer()),
+				gain,
+				offset,
+				wavelen);
+			serial[i]->MarkSamplesModifiedFromCpu();
+		}
+		double tserial = GetTime() - start;
+		REQUIRE(serialLink.GetMismatchCount() == 0);
+
+		//Convert each chunk while the rest of the block downloads, the same way LeCroyOscilloscope::AcquireData does
+		for(size_t i=0; i<nchans; i++)
+			overlapped[i]->PrepareForCpuAccess();
+		SCPIReplayTransport overlapLink("replay;" + fname + ";" + linkSpeed);
+		WaveformConversionQueue queue;
+		start = GetTime();
+		for(size_t i=0; i<nchans; i++)
+		{
+			auto cap = overlapped[i].get();
+			auto& buf = *raw[i];
+			overlapLink.SendCommand(string("C") + to_string(i+1) + ":WF? DAT1");
+			REQUIRE(overlapLink.ReadBinaryBlock(
+				buf,
+				[&queue, cap, &buf, gain, offset](size_t first, size_t count)
+				{
+					queue.Submit([cap, &buf, first, count, gain, offset]
+					{
+						Oscilloscope::Convert8BitSamples(
+							cap->m_samples.GetCpuPointer() + first,
+							reinterpret_cast<int8_t*>(buf.GetCpuPointer()) + first,
+							gain,
+							offset,
+							count);
+					});
+				}));
+		}
+		queue.Wait();
+		for(size_t i=0; i<nchans; i++)
+			overlapped[i]->MarkSamplesModifiedFromCpu();
+		double toverlap = GetTime() - start;
+		REQUIRE(overlapLink.GetMismatchCount() == 0);
+		REQUIRE(overlapLink.IsReplayComplete());
+
+		LogVerbose("Serial     : %6.2f ms\n", tserial * 1000);
+		LogVerbose("Overlapped : %6.2f ms, %.2fx speedup\n", toverlap * 1000, tserial / toverlap);
+
+		for(size_t i=0; i<nchans; i++)
+		{
+			serial[i]->PrepareForCpuAccess();
+			overlapped[i]->PrepareForCpuAccess();
+			for(size_t j=0; j<wavelen; j++)
+				REQUIRE(serial[i]->m_samples[j] == overlapped[i]->m_samples[j]);
+		}
+
+		remove(fname.c_str());
+	}
+}
@@ -0,0 +1,217 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Unit test for WaveformPyramid
+ */
+#ifdef _CATCH2_V3
+#include <catch2/catch_all.hpp>
+#else
+#include <catch2/catch.hpp>
+#endif
+
+#include "../../lib/scopehal/scopehal.h"
+#include "Primitives.h"
+
+using namespace std;
+
+/**
+	@brief Number of buckets in each level of a pyramid built from a waveform of the given depth
+ */
+static vector<size_t> GetBucketCounts(size_t depth)
+{
+	vector<size_t> counts;
+	size_t nbuckets = (depth + WaveformPyramid::BASE_BUCKET_SIZE - 1) / WaveformPyramid::BASE_BUCKET_SIZE;
+	while(true)
+	{
+		counts.push_back(nbuckets);
+		if(nbuckets < WaveformPyramid::MIN_LEVEL_BUCKETS)
+			break;
+		nbuckets = (nbuckets + WaveformPyramid::LEVEL_BUCKET_SIZE - 1) / WaveformPyramid::LEVEL_BUCKET_SIZE;
+	}
+	return counts;
+}
+
+/**
+	@brief Checks that samples of a level are in time order and durations are consistent with the offsets
+ */
+static void VerifyLevelTimestamps(SparseWaveformBase* level, int64_t end)
+{
+	size_t len = level->size();
+	for(size_t i=0; i+1<len; i++)
+	{
+		REQUIRE(level->m_offsets[i+1] > level->m_offsets[i]);
+		REQUIRE(level->m_durations[i] == level->m_offsets[i+1] - level->m_offsets[i]);
+	}
+	REQUIRE(level->m_offsets[len-1] < end);
+	REQUIRE(level->m_durations[len-1] == end - level->m_offsets[len-1]);
+}
+
+TEST_CASE("Primitive_WaveformPyramid")
+{
+	//Not a multiple of the bucket size, so the last bucket of every level is partial
+	const size_t depth = 3000005;
+	auto counts = GetBucketCounts(depth);
+
+	SECTION("Analog")
+	{
+		UniformAnalogWaveform wfm;
+		wfm.m_timescale = 1000;
+		wfm.Resize(depth);
+		wfm.PrepareForCpuAccess();
+
+		//Random data, with a flat region to get buckets where the minimum and maximum are the same sample
+		uniform_real_distribution<float> dist(-1, 1);
+		for(size_t i=0; i<depth; i++)
+			wfm.m_samples[i] = (i < 100000) ? 0.5f : dist(g_rng);
+		wfm.MarkModifiedFromCpu();
+		wfm.m_revision ++;
+
+		double start = GetTime();
+		wfm.UpdatePyramid();
+		LogVerbose("Built pyramid for %zu samples in %.2f ms\n", depth, (GetTime() - start) * 1000);
+
+		auto pyramid = wfm.GetPyramid();
+		REQUIRE(pyramid != nullptr);
+		REQUIRE(pyramid->GetLevelCount() == counts.size());
+
+		size_t bucketSize = WaveformPyramid::BASE_BUCKET_SIZE;
+		for(size_t n=0; n<pyramid->GetLevelCount(); n++)
+		{
+			auto level = dynamic_cast<SparseAnalogWaveform*>(pyramid->GetLevel(n));
+			REQUIRE(level != nullptr);
+			level->PrepareForCpuAccess();
+			VerifyLevelTimestamps(level, depth);
+
+			for(size_t b=0; b<counts[n]; b++)
+			{
+				//Full resolution extrema of the source samples covered by this bucket
+				size_t istart = b * bucketSize;
+				size_t iend = min(depth, istart + bucketSize);
+				float vmin = FLT_MAX;
+				float vmax = -FLT_MAX;
+				for(size_t i=istart; i<iend; i++)
+				{
+					vmin = min(vmin, (float)wfm.m_samples[i]);
+					vmax = max(vmax, (float)wfm.m_samples[i]);
+				}
+
+				//The level must reproduce them exactly, using samples at their original timestamps
+				size_t jstart = pyramid->GetBucketStart(n, b);
+				size_t jend = pyramid->GetBucketStart(n, b+1);
+				REQUIRE(jend - jstart == ((vmin == vmax) ? 1 : 2));
+
+				float lmin = FLT_MAX;
+				float lmax = -FLT_MAX;
+				for(size_t j=jstart; j<jend; j++)
+				{
+					int64_t off = level->m_offsets[j];
+					REQUIRE(off >= (int64_t)istart);
+					REQUIRE(off < (int64_t)iend);
+					REQUIRE(level->m_samples[j] == wfm.m_samples[off]);
+
+					lmin = min(lmin, (float)level->m_samples[j]);
+					lmax = max(lmax, (float)level->m_samples[j]);
+				}
+				REQUIRE(lmin == vmin);
+				REQUIRE(lmax == vmax);
+			}
+
+			bucketSize *= WaveformPyramid::LEVEL_BUCKET_SIZE;
+		}
+
+		//A new revision of the waveform invalidates the pyramid
+		wfm.m_revision ++;
+		REQUIRE(wfm.GetPyramid() == nullptr);
+	}
+
+	SECTION("Digital")
+	{
+		UniformDigitalWaveform wfm;
+		wfm.m_timescale = 1000;
+		wfm.Resize(depth);
+		wfm.PrepareForCpuAccess();
+
+		//Mostly idle with occasional edges, plus a burst of activity much narrower than a bucket
+		uniform_int_distribution<int> dist(0, 999);
+		bool value = false;
+		for(size_t i=0; i<depth; i++)
+		{
+			if( (dist(g_rng) == 0) || ( (i >= 200000) && (i < 200006) ) )
+				value = !value;
+			wfm.m_samples[i] = value;
+		}
+		wfm.MarkModifiedFromCpu();
+		wfm.m_revision ++;
+
+		wfm.UpdatePyramid();
+		auto pyramid = wfm.GetPyramid();
+		REQUIRE(pyramid != nullptr);
+		REQUIRE(pyramid->GetLevelCount() == counts.size());
+
+		size_t bucketSize = WaveformPyramid::BASE_BUCKET_SIZE;
+		for(size_t n=0; n<pyramid->GetLevelCount(); n++)
+		{
+			auto level = dynamic_cast<SparseDigitalWaveform*>(pyramid->GetLevel(n));
+			REQUIRE(level != nullptr);
+			level->PrepareForCpuAccess();
+			VerifyLevelTimestamps(level, depth);
+
+			for(size_t b=0; b<counts[n]; b++)
+			{
+				size_t istart = b * bucketSize;
+				size_t iend = min(depth, istart + bucketSize);
+				size_t transitions = 0;
+				for(size_t i=istart+1; i<iend; i++)
+					transitions += (wfm.m_samples[i] != wfm.m_samples[i-1]);
+
+				//Initial value at the start of the bucket
+				size_t jstart = pyramid->GetBucketStart(n, b);
+				size_t jend = pyramid->GetBucketStart(n, b+1);
+				REQUIRE(level->m_offsets[jstart] == (int64_t)istart);
+				REQUIRE(level->m_samples[jstart] == wfm.m_samples[istart]);
+
+				//Any activity at all must show up as a second sample with a different value
+				if(transitions == 0)
+					REQUIRE(jend - jstart == 1);
+				else
+				{
+					REQUIRE(jend - jstart == 2);
+					bool first = wfm.m_samples[istart];
+					bool last = wfm.m_samples[iend-1];
+					REQUIRE(level->m_samples[jstart+1] == ((first != last) ? last : !first));
+				}
+			}
+
+			bucketSize *= WaveformPyramid::LEVEL_BUCKET_SIZE;
+		}
+	}
+}